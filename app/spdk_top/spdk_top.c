@@ -29,6 +29,8 @@
 #define RPC_MAX_THREADS 1024
 #define RPC_MAX_POLLERS 8192
 #define RPC_MAX_CORES 1024
+#define RPC_MAX_LATENCY_BDEVS 256
+#define RPC_MAX_IO_CLASSES 12
 #define MAX_THREAD_NAME 128
 #define MAX_POLLER_NAME 128
 #define MAX_THREADS 4096
@@ -77,10 +79,22 @@
 #define POLLER_WIN_FIRST_COL 14
 #define FIRST_DATA_ROW 7
 #define HELP_WIN_WIDTH 88
-#define HELP_WIN_HEIGHT 24
+#define HELP_WIN_HEIGHT 27
 #define SCHEDULER_WIN_HEIGHT 7
 #define SCHEDULER_WIN_FIRST_COL 2
 #define MAX_SCHEDULER_PERIOD_STR_LEN 10
+#define BDEV_LATENCY_WIN_WIDTH 88
+#define BDEV_LATENCY_WIN_HEIGHT 24
+#define BDEV_LATENCY_WIN_FIRST_COL 2
+#define BDEV_LATENCY_WIN_FIRST_DATA_ROW 4
+#define BDEV_LATENCY_NAME_LEN 17
+#define CYCLES_WIN_WIDTH 104
+#define CYCLES_WIN_HEIGHT 24
+#define CYCLES_WIN_FIRST_COL 2
+#define CYCLES_WIN_FIRST_DATA_ROW 4
+#define CYCLES_THREAD_NAME_LEN 15
+#define CYCLES_CALLBACK_NAME_LEN 27
+#define CYCLES_BAR_LEN 16
 
 enum tabs {
 	THREADS_TAB,
@@ -168,6 +182,8 @@ uint8_t g_current_sort_col[NUMBER_OF_TABS] = {COL_THREADS_NAME, COL_POLLERS_NAME
 uint8_t g_current_sort_col2[NUMBER_OF_TABS] = {COL_THREADS_NONE, COL_POLLERS_NONE, COL_CORES_NONE};
 bool g_interval_data = true;
 bool g_quit_app = false;
+bool g_bdev_latency_popup = false;
+bool g_cycles_popup = false;
 pthread_mutex_t g_thread_lock;
 static struct col_desc g_col_desc[NUMBER_OF_TABS][TABS_COL_COUNT] = {
 	{	{.name = "Thread name", .max_data_string = MAX_THREAD_NAME_LEN},
@@ -270,10 +286,54 @@ struct rpc_scheduler {
 	uint64_t scheduler_period;
 };
 
+struct rpc_io_class_latency_ns {
+	uint64_t p50;
+	uint64_t p99;
+	uint64_t p999;
+	uint64_t max;
+};
+
+struct rpc_io_class_latency {
+	char *io_type;
+	char *size_class;
+	uint64_t count;
+	struct rpc_io_class_latency_ns latency_ns;
+};
+
+struct rpc_bdev_latency {
+	char *name;
+	size_t classes_count;
+	struct rpc_io_class_latency classes[RPC_MAX_IO_CLASSES];
+};
+
+struct rpc_bdevs_latency {
+	size_t bdevs_count;
+	struct rpc_bdev_latency bdevs[RPC_MAX_LATENCY_BDEVS];
+};
+
+struct rpc_cycles_entry {
+	char *name;
+	/* Callback type, NULL for pollers */
+	char *type;
+	uint64_t run_count;
+	uint64_t busy_tsc;
+	uint64_t idle_tsc;
+	char thread_name[MAX_THREAD_NAME];
+};
+
+struct rpc_cycles {
+	bool enabled;
+	uint64_t total_tsc;
+	uint64_t entries_count;
+	struct rpc_cycles_entry entries[RPC_MAX_POLLERS];
+};
+
 struct rpc_thread_info g_threads_info[RPC_MAX_THREADS];
 struct rpc_poller_info g_pollers_info[RPC_MAX_POLLERS];
 struct rpc_core_info g_cores_info[RPC_MAX_CORES];
 struct rpc_scheduler g_scheduler_info;
+struct rpc_bdevs_latency *g_bdev_latency;
+struct rpc_cycles *g_cycles;
 
 static void
 init_str_len(void)
@@ -390,8 +450,9 @@ rpc_decode_pollers_array(struct spdk_json_val *poller, struct rpc_poller_info *o
 			 thread_name);
 		out[*poller_count].type = poller_type;
 
-		rc = spdk_json_decode_object(poller, rpc_pollers_decoders,
-					     SPDK_COUNTOF(rpc_pollers_decoders), &out[*poller_count]);
+		rc = spdk_json_decode_object_relaxed(poller, rpc_pollers_decoders,
+						     SPDK_COUNTOF(rpc_pollers_decoders),
+						     &out[*poller_count]);
 		if (rc) {
 			printf("Could not decode poller object from JSON.\n");
 			return rc;
@@ -1130,6 +1191,295 @@ get_scheduler_data(void)
 	return rc;
 }
 
+static void
+free_rpc_bdevs_latency(struct rpc_bdevs_latency *latency)
+{
+	uint64_t i, j;
+
+	if (latency == NULL) {
+		return;
+	}
+
+	/* Counts are not reliable after a failed decode, so walk the whole arrays */
+	for (i = 0; i < RPC_MAX_LATENCY_BDEVS; i++) {
+		free(latency->bdevs[i].name);
+		for (j = 0; j < RPC_MAX_IO_CLASSES; j++) {
+			free(latency->bdevs[i].classes[j].io_type);
+			free(latency->bdevs[i].classes[j].size_class);
+		}
+	}
+
+	free(latency);
+}
+
+static const struct spdk_json_object_decoder rpc_io_class_latency_ns_decoders[] = {
+	{"p50", offsetof(struct rpc_io_class_latency_ns, p50), spdk_json_decode_uint64},
+	{"p99", offsetof(struct rpc_io_class_latency_ns, p99), spdk_json_decode_uint64},
+	{"p99.9", offsetof(struct rpc_io_class_latency_ns, p999), spdk_json_decode_uint64},
+	{"max", offsetof(struct rpc_io_class_latency_ns, max), spdk_json_decode_uint64},
+};
+
+static int
+rpc_decode_io_class_latency_ns(const struct spdk_json_val *val, void *out)
+{
+	return spdk_json_decode_object_relaxed(val, rpc_io_class_latency_ns_decoders,
+					       SPDK_COUNTOF(rpc_io_class_latency_ns_decoders), out);
+}
+
+static const struct spdk_json_object_decoder rpc_io_class_latency_decoders[] = {
+	{"io_type", offsetof(struct rpc_io_class_latency, io_type), spdk_json_decode_string},
+	{"size_class", offsetof(struct rpc_io_class_latency, size_class), spdk_json_decode_string},
+	{"count", offsetof(struct rpc_io_class_latency, count), spdk_json_decode_uint64},
+	{"latency_ns", offsetof(struct rpc_io_class_latency, latency_ns), rpc_decode_io_class_latency_ns},
+};
+
+static int
+rpc_decode_io_class_latency(const struct spdk_json_val *val, void *out)
+{
+	return spdk_json_decode_object(val, rpc_io_class_latency_decoders,
+				       SPDK_COUNTOF(rpc_io_class_latency_decoders), out);
+}
+
+static int
+rpc_decode_io_classes_array(const struct spdk_json_val *val, void *out)
+{
+	struct rpc_bdev_latency *bdev = SPDK_CONTAINEROF(out, struct rpc_bdev_latency, classes);
+
+	return spdk_json_decode_array(val, rpc_decode_io_class_latency, bdev->classes,
+				      RPC_MAX_IO_CLASSES, &bdev->classes_count,
+				      sizeof(struct rpc_io_class_latency));
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_latency_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_latency, name), spdk_json_decode_string},
+	{"classes", offsetof(struct rpc_bdev_latency, classes), rpc_decode_io_classes_array},
+};
+
+static int
+rpc_decode_bdev_latency(const struct spdk_json_val *val, void *out)
+{
+	return spdk_json_decode_object(val, rpc_bdev_latency_decoders,
+				       SPDK_COUNTOF(rpc_bdev_latency_decoders), out);
+}
+
+static int
+rpc_decode_bdevs_latency_array(const struct spdk_json_val *val, void *out)
+{
+	struct rpc_bdevs_latency *latency = SPDK_CONTAINEROF(out, struct rpc_bdevs_latency, bdevs);
+
+	return spdk_json_decode_array(val, rpc_decode_bdev_latency, latency->bdevs,
+				      RPC_MAX_LATENCY_BDEVS, &latency->bdevs_count,
+				      sizeof(struct rpc_bdev_latency));
+}
+
+static const struct spdk_json_object_decoder rpc_bdevs_latency_decoders[] = {
+	{"bdevs", offsetof(struct rpc_bdevs_latency, bdevs), rpc_decode_bdevs_latency_array},
+};
+
+static int
+get_bdev_latency_data(void)
+{
+	struct spdk_jsonrpc_client_response *json_resp = NULL;
+	struct rpc_bdevs_latency *latency, *tmp;
+	int rc = 0;
+
+	latency = calloc(1, sizeof(*latency));
+	if (latency == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = rpc_send_req("bdev_get_io_class_histograms", &json_resp);
+	if (rc) {
+		free(latency);
+		return rc;
+	}
+
+	if (spdk_json_decode_object_relaxed(json_resp->result, rpc_bdevs_latency_decoders,
+					    SPDK_COUNTOF(rpc_bdevs_latency_decoders), latency)) {
+		rc = -EINVAL;
+	} else {
+		pthread_mutex_lock(&g_thread_lock);
+		/* The pop-up might have been closed while waiting for the response */
+		if (g_bdev_latency_popup) {
+			tmp = g_bdev_latency;
+			g_bdev_latency = latency;
+			latency = tmp;
+		}
+		pthread_mutex_unlock(&g_thread_lock);
+	}
+
+	free_rpc_bdevs_latency(latency);
+	spdk_jsonrpc_client_free_response(json_resp);
+	return rc;
+}
+
+static void
+free_rpc_cycles(struct rpc_cycles *cycles)
+{
+	uint64_t i;
+
+	if (cycles == NULL) {
+		return;
+	}
+
+	for (i = 0; i < cycles->entries_count; i++) {
+		free(cycles->entries[i].name);
+		free(cycles->entries[i].type);
+	}
+
+	free(cycles);
+}
+
+static const struct spdk_json_object_decoder rpc_cycles_poller_decoders[] = {
+	{"name", offsetof(struct rpc_cycles_entry, name), spdk_json_decode_string},
+	{"run_count", offsetof(struct rpc_cycles_entry, run_count), spdk_json_decode_uint64},
+	{"busy_tsc", offsetof(struct rpc_cycles_entry, busy_tsc), spdk_json_decode_uint64, true},
+	{"idle_tsc", offsetof(struct rpc_cycles_entry, idle_tsc), spdk_json_decode_uint64, true},
+};
+
+static const struct spdk_json_object_decoder rpc_cycles_callback_decoders[] = {
+	{"name", offsetof(struct rpc_cycles_entry, name), spdk_json_decode_string},
+	{"type", offsetof(struct rpc_cycles_entry, type), spdk_json_decode_string},
+	{"run_count", offsetof(struct rpc_cycles_entry, run_count), spdk_json_decode_uint64},
+	{"tsc", offsetof(struct rpc_cycles_entry, busy_tsc), spdk_json_decode_uint64},
+};
+
+static int
+rpc_decode_cycles_array(struct spdk_json_val *val, const struct spdk_json_object_decoder *decoders,
+			size_t num_decoders, const char *thread_name, struct rpc_cycles *cycles)
+{
+	struct rpc_cycles_entry *entry;
+
+	for (val = spdk_json_array_first(val); val != NULL; val = spdk_json_next(val)) {
+		if (cycles->entries_count == RPC_MAX_POLLERS) {
+			return -ENOSPC;
+		}
+
+		entry = &cycles->entries[cycles->entries_count++];
+		if (spdk_json_decode_object_relaxed(val, decoders, num_decoders, entry)) {
+			return -EINVAL;
+		}
+
+		snprintf(entry->thread_name, sizeof(entry->thread_name), "%s", thread_name);
+		cycles->total_tsc += entry->busy_tsc + entry->idle_tsc;
+	}
+
+	return 0;
+}
+
+static int
+rpc_decode_cycles_threads_array(struct spdk_json_val *val, struct rpc_cycles *cycles)
+{
+	struct spdk_json_val *thread = val, *array;
+	struct rpc_thread_info thread_info = {};
+	const char *poller_typenames[] = { "active_pollers", "timed_pollers", "paused_pollers" };
+	uint64_t i;
+	int rc;
+
+	rc = spdk_json_find_array(thread, "threads", NULL, &thread);
+	if (rc) {
+		return rc;
+	}
+
+	for (thread = spdk_json_array_first(thread); thread != NULL;
+	     thread = spdk_json_next(thread)) {
+		rc = spdk_json_decode_object_relaxed(thread, rpc_thread_pollers_decoders,
+						     SPDK_COUNTOF(rpc_thread_pollers_decoders),
+						     &thread_info);
+		if (rc) {
+			goto end;
+		}
+
+		for (i = 0; i < SPDK_COUNTOF(poller_typenames); i++) {
+			rc = spdk_json_find(thread, poller_typenames[i], NULL, &array,
+					    SPDK_JSON_VAL_ARRAY_BEGIN);
+			if (rc) {
+				goto end;
+			}
+
+			rc = rpc_decode_cycles_array(array, rpc_cycles_poller_decoders,
+						     SPDK_COUNTOF(rpc_cycles_poller_decoders),
+						     thread_info.name, cycles);
+			if (rc) {
+				goto end;
+			}
+		}
+
+		/* Threads only report their callbacks while the cycle accounting is enabled */
+		if (spdk_json_find(thread, "callbacks", NULL, &array, SPDK_JSON_VAL_ARRAY_BEGIN)) {
+			continue;
+		}
+
+		cycles->enabled = true;
+		rc = rpc_decode_cycles_array(array, rpc_cycles_callback_decoders,
+					     SPDK_COUNTOF(rpc_cycles_callback_decoders),
+					     thread_info.name, cycles);
+		if (rc) {
+			goto end;
+		}
+	}
+
+end:
+	free(thread_info.name);
+	return rc;
+}
+
+static int
+sort_cycles(const void *p1, const void *p2)
+{
+	const struct rpc_cycles_entry *entry1 = p1;
+	const struct rpc_cycles_entry *entry2 = p2;
+	uint64_t tsc1 = entry1->busy_tsc + entry1->idle_tsc;
+	uint64_t tsc2 = entry2->busy_tsc + entry2->idle_tsc;
+
+	if (tsc2 > tsc1) {
+		return 1;
+	} else if (tsc2 < tsc1) {
+		return -1;
+	} else {
+		return 0;
+	}
+}
+
+static int
+get_cycles_data(void)
+{
+	struct spdk_jsonrpc_client_response *json_resp = NULL;
+	struct rpc_cycles *cycles, *tmp;
+	int rc = 0;
+
+	cycles = calloc(1, sizeof(*cycles));
+	if (cycles == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = rpc_send_req("thread_get_pollers", &json_resp);
+	if (rc) {
+		free(cycles);
+		return rc;
+	}
+
+	if (rpc_decode_cycles_threads_array(json_resp->result, cycles)) {
+		rc = -EINVAL;
+	} else {
+		qsort(cycles->entries, cycles->entries_count, sizeof(struct rpc_cycles_entry),
+		      sort_cycles);
+
+		pthread_mutex_lock(&g_thread_lock);
+		/* The pop-up might have been closed while waiting for the response */
+		if (g_cycles_popup) {
+			tmp = g_cycles;
+			g_cycles = cycles;
+			cycles = tmp;
+		}
+		pthread_mutex_unlock(&g_thread_lock);
+	}
+
+	free_rpc_cycles(cycles);
+	spdk_jsonrpc_client_free_response(json_resp);
+	return rc;
+}
+
 enum str_alignment {
 	ALIGN_LEFT,
 	ALIGN_RIGHT,
@@ -3041,11 +3391,341 @@ show_scheduler(uint8_t active_tab, uint8_t current_page)
 	delwin(scheduler_win);
 }
 
+static uint64_t
+get_bdev_latency_rows_count(void)
+{
+	uint64_t i, rows_count = 0;
+
+	if (g_bdev_latency == NULL) {
+		return 0;
+	}
+
+	for (i = 0; i < g_bdev_latency->bdevs_count; i++) {
+		rows_count += g_bdev_latency->bdevs[i].classes_count;
+	}
+
+	return rows_count;
+}
+
+static void
+draw_bdev_latency_popup(WINDOW *bdev_latency_win, uint64_t first_row)
+{
+	struct rpc_bdev_latency *bdev;
+	struct rpc_io_class_latency *io_class;
+	uint64_t i, j, row = 0;
+	int line = BDEV_LATENCY_WIN_FIRST_DATA_ROW;
+	int last_line = BDEV_LATENCY_WIN_HEIGHT - 4;
+	int col = BDEV_LATENCY_WIN_FIRST_COL;
+
+	for (i = line; i <= (uint64_t)last_line; i++) {
+		mvwhline(bdev_latency_win, i, 1, ' ', BDEV_LATENCY_WIN_WIDTH - 2);
+	}
+
+	if (g_bdev_latency == NULL) {
+		print_left(bdev_latency_win, line, col, BDEV_LATENCY_WIN_WIDTH,
+			   "Waiting for data...", COLOR_PAIR(10));
+		wnoutrefresh(bdev_latency_win);
+		return;
+	}
+
+	if (g_bdev_latency->bdevs_count == 0) {
+		print_left(bdev_latency_win, line, col, BDEV_LATENCY_WIN_WIDTH,
+			   "No bdevs with per I/O class histograms enabled", COLOR_PAIR(10));
+		wnoutrefresh(bdev_latency_win);
+		return;
+	}
+
+	for (i = 0; i < g_bdev_latency->bdevs_count; i++) {
+		bdev = &g_bdev_latency->bdevs[i];
+		for (j = 0; j < bdev->classes_count; j++, row++) {
+			if (row < first_row) {
+				continue;
+			}
+			if (line > last_line) {
+				wnoutrefresh(bdev_latency_win);
+				return;
+			}
+
+			io_class = &bdev->classes[j];
+			print_max_len(bdev_latency_win, line, col, BDEV_LATENCY_NAME_LEN,
+				      ALIGN_LEFT, bdev->name);
+			mvwprintw(bdev_latency_win, line, col + BDEV_LATENCY_NAME_LEN,
+				  "%-7s %-8s %10" PRIu64 " %9.1f %9.1f %9.1f %9.1f",
+				  io_class->io_type, io_class->size_class, io_class->count,
+				  (double)io_class->latency_ns.p50 / 1000,
+				  (double)io_class->latency_ns.p99 / 1000,
+				  (double)io_class->latency_ns.p999 / 1000,
+				  (double)io_class->latency_ns.max / 1000);
+			line++;
+		}
+	}
+
+	wnoutrefresh(bdev_latency_win);
+}
+
+static void
+show_bdev_latency(uint8_t active_tab, uint8_t current_page)
+{
+	PANEL *bdev_latency_panel;
+	WINDOW *bdev_latency_win;
+	uint64_t first_row = 0, max_first_row;
+	uint64_t data_rows = BDEV_LATENCY_WIN_HEIGHT - BDEV_LATENCY_WIN_FIRST_DATA_ROW - 3;
+	long int time_last, time_dif;
+	struct timespec time_now;
+	bool stop_loop = false;
+	int c;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_now);
+	time_last = time_now.tv_sec;
+
+	pthread_mutex_lock(&g_thread_lock);
+	g_bdev_latency_popup = true;
+	pthread_mutex_unlock(&g_thread_lock);
+
+	bdev_latency_win = newwin(BDEV_LATENCY_WIN_HEIGHT, BDEV_LATENCY_WIN_WIDTH,
+				  get_position_for_window(BDEV_LATENCY_WIN_HEIGHT, g_max_row),
+				  get_position_for_window(BDEV_LATENCY_WIN_WIDTH, g_max_col));
+
+	keypad(bdev_latency_win, TRUE);
+	bdev_latency_panel = new_panel(bdev_latency_win);
+
+	top_panel(bdev_latency_panel);
+	update_panels();
+	doupdate();
+
+	box(bdev_latency_win, 0, 0);
+	print_in_middle(bdev_latency_win, 1, 0, BDEV_LATENCY_WIN_WIDTH, "BDEV LATENCY",
+			COLOR_PAIR(3));
+	print_left(bdev_latency_win, 2, BDEV_LATENCY_WIN_FIRST_COL, BDEV_LATENCY_WIN_WIDTH,
+		   "Bdev name        Type    Size          Count  p50 [us]  p99 [us] p99.9[us]"
+		   "  max [us]", COLOR_PAIR(5));
+	mvwhline(bdev_latency_win, 3, 1, ACS_HLINE, BDEV_LATENCY_WIN_WIDTH - 2);
+	mvwhline(bdev_latency_win, BDEV_LATENCY_WIN_HEIGHT - 3, 1, ACS_HLINE,
+		 BDEV_LATENCY_WIN_WIDTH - 2);
+	print_in_middle(bdev_latency_win, BDEV_LATENCY_WIN_HEIGHT - 2, 0, BDEV_LATENCY_WIN_WIDTH,
+			"[Up/Down] Scroll  [Esc] Close this window", COLOR_PAIR(10));
+
+	pthread_mutex_lock(&g_thread_lock);
+	draw_bdev_latency_popup(bdev_latency_win, first_row);
+	pthread_mutex_unlock(&g_thread_lock);
+	refresh();
+
+	while (!stop_loop) {
+		c = getch();
+
+		pthread_mutex_lock(&g_thread_lock);
+		max_first_row = get_bdev_latency_rows_count();
+		max_first_row = max_first_row > data_rows ? max_first_row - data_rows : 0;
+		pthread_mutex_unlock(&g_thread_lock);
+
+		switch (c) {
+		case 27: /* ESC */
+			stop_loop = true;
+			break;
+		case KEY_UP:
+			if (first_row > 0) {
+				first_row--;
+			}
+			break;
+		case KEY_DOWN:
+			if (first_row < max_first_row) {
+				first_row++;
+			}
+			break;
+		default:
+			break;
+		}
+
+		first_row = spdk_min(first_row, max_first_row);
+
+		clock_gettime(CLOCK_MONOTONIC, &time_now);
+		time_dif = time_now.tv_sec - time_last;
+
+		if (c == KEY_UP || c == KEY_DOWN || time_dif >= g_sleep_time) {
+			time_last = time_now.tv_sec;
+			pthread_mutex_lock(&g_thread_lock);
+			refresh_tab(active_tab, current_page);
+			draw_bdev_latency_popup(bdev_latency_win, first_row);
+			refresh();
+			pthread_mutex_unlock(&g_thread_lock);
+		}
+	}
+
+	pthread_mutex_lock(&g_thread_lock);
+	g_bdev_latency_popup = false;
+	free_rpc_bdevs_latency(g_bdev_latency);
+	g_bdev_latency = NULL;
+	pthread_mutex_unlock(&g_thread_lock);
+
+	del_panel(bdev_latency_panel);
+	delwin(bdev_latency_win);
+}
+
+static void
+draw_cycles_popup(WINDOW *cycles_win, uint64_t first_row)
+{
+	struct rpc_cycles_entry *entry;
+	char bar[CYCLES_BAR_LEN + 1];
+	uint64_t i, tsc, busy_len, bar_len;
+	int line = CYCLES_WIN_FIRST_DATA_ROW;
+	int last_line = CYCLES_WIN_HEIGHT - 4;
+	int col = CYCLES_WIN_FIRST_COL;
+	int stats_col = col + CYCLES_THREAD_NAME_LEN + CYCLES_CALLBACK_NAME_LEN + 12;
+
+	for (i = line; i <= (uint64_t)last_line; i++) {
+		mvwhline(cycles_win, i, 1, ' ', CYCLES_WIN_WIDTH - 2);
+	}
+
+	if (g_cycles == NULL) {
+		print_left(cycles_win, line, col, CYCLES_WIN_WIDTH,
+			   "Waiting for data...", COLOR_PAIR(10));
+		wnoutrefresh(cycles_win);
+		return;
+	}
+
+	if (!g_cycles->enabled) {
+		print_left(cycles_win, line, col, CYCLES_WIN_WIDTH,
+			   "Cycle accounting is disabled, enable it with "
+			   "thread_enable_cycle_accounting", COLOR_PAIR(10));
+		wnoutrefresh(cycles_win);
+		return;
+	}
+
+	if (g_cycles->total_tsc == 0) {
+		print_left(cycles_win, line, col, CYCLES_WIN_WIDTH,
+			   "No cycles accounted yet", COLOR_PAIR(10));
+		wnoutrefresh(cycles_win);
+		return;
+	}
+
+	for (i = first_row; i < g_cycles->entries_count && line <= last_line; i++, line++) {
+		entry = &g_cycles->entries[i];
+		tsc = entry->busy_tsc + entry->idle_tsc;
+
+		/* Busy cycles are drawn with '#' and idle ones with '-', in proportion to the
+		 * cycles accounted on all the threads. */
+		bar_len = spdk_max(tsc * CYCLES_BAR_LEN / g_cycles->total_tsc, tsc ? 1 : 0);
+		busy_len = tsc ? (bar_len * entry->busy_tsc + tsc - 1) / tsc : 0;
+		memset(bar, '#', busy_len);
+		memset(bar + busy_len, '-', bar_len - busy_len);
+		bar[bar_len] = '\0';
+
+		print_max_len(cycles_win, line, col, CYCLES_THREAD_NAME_LEN, ALIGN_LEFT,
+			      entry->thread_name);
+		mvwprintw(cycles_win, line, col + CYCLES_THREAD_NAME_LEN + 1, "%-9s",
+			  entry->type != NULL ? entry->type : "poller");
+		print_max_len(cycles_win, line, col + CYCLES_THREAD_NAME_LEN + 11,
+			      CYCLES_CALLBACK_NAME_LEN, ALIGN_LEFT, entry->name);
+		mvwprintw(cycles_win, line, stats_col, "%10" PRIu64 " %10.3f %6.2f %s", entry->run_count,
+			  (double)tsc * SPDK_SEC_TO_MSEC / g_tick_rate,
+			  (double)tsc * 100 / g_cycles->total_tsc, bar);
+	}
+
+	wnoutrefresh(cycles_win);
+}
+
+static void
+show_cycles(uint8_t active_tab, uint8_t current_page)
+{
+	PANEL *cycles_panel;
+	WINDOW *cycles_win;
+	uint64_t first_row = 0, max_first_row;
+	uint64_t data_rows = CYCLES_WIN_HEIGHT - CYCLES_WIN_FIRST_DATA_ROW - 3;
+	long int time_last, time_dif;
+	struct timespec time_now;
+	bool stop_loop = false;
+	int c;
+
+	clock_gettime(CLOCK_MONOTONIC, &time_now);
+	time_last = time_now.tv_sec;
+
+	pthread_mutex_lock(&g_thread_lock);
+	g_cycles_popup = true;
+	pthread_mutex_unlock(&g_thread_lock);
+
+	cycles_win = newwin(CYCLES_WIN_HEIGHT, CYCLES_WIN_WIDTH,
+			    get_position_for_window(CYCLES_WIN_HEIGHT, g_max_row),
+			    get_position_for_window(CYCLES_WIN_WIDTH, g_max_col));
+
+	keypad(cycles_win, TRUE);
+	cycles_panel = new_panel(cycles_win);
+
+	top_panel(cycles_panel);
+	update_panels();
+	doupdate();
+
+	box(cycles_win, 0, 0);
+	print_in_middle(cycles_win, 1, 0, CYCLES_WIN_WIDTH, "CYCLE PROFILE", COLOR_PAIR(3));
+	print_left(cycles_win, 2, CYCLES_WIN_FIRST_COL, CYCLES_WIN_WIDTH,
+		   "Thread name     Type      Callback                          Runs  Time [ms]"
+		   "      % Busy(#)/Idle(-)", COLOR_PAIR(5));
+	mvwhline(cycles_win, 3, 1, ACS_HLINE, CYCLES_WIN_WIDTH - 2);
+	mvwhline(cycles_win, CYCLES_WIN_HEIGHT - 3, 1, ACS_HLINE, CYCLES_WIN_WIDTH - 2);
+	print_in_middle(cycles_win, CYCLES_WIN_HEIGHT - 2, 0, CYCLES_WIN_WIDTH,
+			"[Up/Down] Scroll  [Esc] Close this window", COLOR_PAIR(10));
+
+	pthread_mutex_lock(&g_thread_lock);
+	draw_cycles_popup(cycles_win, first_row);
+	pthread_mutex_unlock(&g_thread_lock);
+	refresh();
+
+	while (!stop_loop) {
+		c = getch();
+
+		pthread_mutex_lock(&g_thread_lock);
+		max_first_row = g_cycles != NULL ? g_cycles->entries_count : 0;
+		max_first_row = max_first_row > data_rows ? max_first_row - data_rows : 0;
+		pthread_mutex_unlock(&g_thread_lock);
+
+		switch (c) {
+		case 27: /* ESC */
+			stop_loop = true;
+			break;
+		case KEY_UP:
+			if (first_row > 0) {
+				first_row--;
+			}
+			break;
+		case KEY_DOWN:
+			if (first_row < max_first_row) {
+				first_row++;
+			}
+			break;
+		default:
+			break;
+		}
+
+		first_row = spdk_min(first_row, max_first_row);
+
+		clock_gettime(CLOCK_MONOTONIC, &time_now);
+		time_dif = time_now.tv_sec - time_last;
+
+		if (c == KEY_UP || c == KEY_DOWN || time_dif >= g_sleep_time) {
+			time_last = time_now.tv_sec;
+			pthread_mutex_lock(&g_thread_lock);
+			refresh_tab(active_tab, current_page);
+			draw_cycles_popup(cycles_win, first_row);
+			refresh();
+			pthread_mutex_unlock(&g_thread_lock);
+		}
+	}
+
+	pthread_mutex_lock(&g_thread_lock);
+	g_cycles_popup = false;
+	free_rpc_cycles(g_cycles);
+	g_cycles = NULL;
+	pthread_mutex_unlock(&g_thread_lock);
+
+	del_panel(cycles_panel);
+	delwin(cycles_win);
+}
+
 static void *
 data_thread_routine(void *arg)
 {
 	int rc;
 	uint64_t refresh_rate;
+	bool bdev_latency_popup, cycles_popup;
 
 	while (1) {
 		pthread_mutex_lock(&g_thread_lock);
@@ -3082,6 +3762,27 @@ data_thread_routine(void *arg)
 			print_bottom_message("ERROR occurred while getting scheduler data");
 		}
 
+		pthread_mutex_lock(&g_thread_lock);
+		bdev_latency_popup = g_bdev_latency_popup;
+		cycles_popup = g_cycles_popup;
+		pthread_mutex_unlock(&g_thread_lock);
+
+		/* Bdev latency is only fetched while its pop-up is displayed */
+		if (bdev_latency_popup) {
+			rc = get_bdev_latency_data();
+			if (rc) {
+				print_bottom_message("ERROR occurred while getting bdev latency");
+			}
+		}
+
+		/* Same for the cycle profile */
+		if (cycles_popup) {
+			rc = get_cycles_data();
+			if (rc) {
+				print_bottom_message("ERROR occurred while getting cycle profile");
+			}
+		}
+
 		usleep(refresh_rate);
 	}
 
@@ -3150,6 +3851,11 @@ help_window_display(void)
 		   "application or last refresh", COLOR_PAIR(10));
 	print_left(help_win, ++row, col,  HELP_WIN_WIDTH,
 		   "[g] Scheduler pop-up - display current scheduler information", COLOR_PAIR(10));
+	print_left(help_win, ++row, col,  HELP_WIN_WIDTH,
+		   "[b] Bdev latency	- display bdev latency by I/O type and size", COLOR_PAIR(10));
+	print_left(help_win, ++row, col,  HELP_WIN_WIDTH,
+		   "[p] Cycle profile	- display cycles spent by pollers, messages and interrupts",
+		   COLOR_PAIR(10));
 	print_left(help_win, ++row, col,  HELP_WIN_WIDTH, "[h] Help		- show this help window",
 		   COLOR_PAIR(10));
 
@@ -3290,6 +3996,14 @@ show_stats(pthread_t *data_thread)
 		case 'g':
 			show_scheduler(active_tab, current_page);
 			break;
+		case 'b':
+			show_bdev_latency(active_tab, current_page);
+			refresh_after_popup(active_tab, &max_pages, current_page);
+			break;
+		case 'p':
+			show_cycles(active_tab, current_page);
+			refresh_after_popup(active_tab, &max_pages, current_page);
+			break;
 		case KEY_NPAGE: /* PgDown */
 			if (current_page + 1 < max_pages) {
 				current_page++;
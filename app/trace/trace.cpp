@@ -11,6 +11,7 @@
 #include "spdk/util.h"
 
 #include <map>
+#include <vector>
 
 extern "C" {
 #include "spdk/trace_parser.h"
@@ -20,6 +21,26 @@ extern "C" {
 enum print_format_type {
 	PRINT_FMT_JSON,
 	PRINT_FMT_DEFAULT,
+	PRINT_FMT_WATERFALL,
+};
+
+/* A single layer of a bdev I/O span, recorded by BDEV_SPAN_START and BDEV_SPAN_DONE */
+struct span_io {
+	uint64_t	object_id;
+	/* Index of the parent I/O in the span, -1 for the root of the span */
+	int		parent;
+	uint16_t	owner_id;
+	uint32_t	size;
+	uint64_t	type;
+	uint64_t	offset;
+	uint64_t	start_tsc;
+	uint64_t	end_tsc;
+	int32_t		status;
+	bool		done;
+};
+
+struct span {
+	std::vector<struct span_io> ios;
 };
 
 static struct spdk_trace_parser *g_parser;
@@ -424,6 +445,175 @@ trace_print_json(void)
 	return 0;
 }
 
+static const struct spdk_trace_tpoint *
+find_tpoint(const char *name)
+{
+	struct spdk_trace_section_tpoint *tp_section;
+	size_t i;
+
+	tp_section = spdk_trace_get_tpoint_section(g_file);
+	for (i = 0; i < tp_section->count; ++i) {
+		if (tp_section->tpoint[i].tpoint_id != 0 &&
+		    strcmp(tp_section->tpoint[i].name, name) == 0) {
+			return &tp_section->tpoint[i];
+		}
+	}
+
+	return NULL;
+}
+
+/* Find the most recently started I/O of a span that has not completed yet */
+static int
+find_span_io(const struct span &sp, uint64_t object_id)
+{
+	int i;
+
+	for (i = (int)sp.ios.size() - 1; i >= 0; --i) {
+		if (sp.ios[i].object_id == object_id && !sp.ios[i].done) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* Time during which the I/O was not waiting on any of its children */
+static uint64_t
+get_span_io_self_tsc(const struct span &sp, int index)
+{
+	const struct span_io *io = &sp.ios[index];
+	uint64_t busy = 0, start = 0, end = 0;
+	size_t i;
+
+	/* The ios are ordered by start time, so the children intervals can be merged in one pass */
+	for (i = index + 1; i < sp.ios.size(); ++i) {
+		const struct span_io *child = &sp.ios[i];
+
+		if (child->parent != index || !child->done) {
+			continue;
+		}
+		if (child->start_tsc <= end) {
+			end = spdk_max(end, child->end_tsc);
+			continue;
+		}
+		busy += end - start;
+		start = child->start_tsc;
+		end = child->end_tsc;
+	}
+	busy += end - start;
+
+	return busy < io->end_tsc - io->start_tsc ? io->end_tsc - io->start_tsc - busy : 0;
+}
+
+static void
+print_span_io(const struct span &sp, int index, int depth, uint64_t tsc_rate)
+{
+	const struct span_io *io = &sp.ios[index];
+	const struct span_io *root = &sp.ios[0];
+	const char *name = "";
+	size_t i;
+
+	if (io->owner_id != OWNER_ID_NONE) {
+		struct spdk_trace_owner *owner = spdk_get_trace_owner(g_file, io->owner_id);
+
+		if (owner->tsc <= io->start_tsc) {
+			name = owner->description;
+		}
+	}
+
+	printf("  %12.3f ", get_us_from_tsc(io->start_tsc - root->start_tsc, tsc_rate));
+	if (io->done) {
+		printf("%12.3f %12.3f %6d ", get_us_from_tsc(io->end_tsc - io->start_tsc, tsc_rate),
+		       get_us_from_tsc(get_span_io_self_tsc(sp, index), tsc_rate), io->status);
+	} else {
+		printf("%12s %12s %6s ", "N/A", "N/A", "N/A");
+	}
+	printf("%*s%-*s type: %-2ju offset: %-12ju size: %u\n", depth * 2, "",
+	       spdk_max(48 - depth * 2, 0), name, io->type, io->offset, io->size);
+
+	for (i = index + 1; i < sp.ios.size(); ++i) {
+		if (sp.ios[i].parent == index) {
+			print_span_io(sp, i, depth + 1, tsc_rate);
+		}
+	}
+}
+
+static int
+trace_print_waterfall(void)
+{
+	struct spdk_trace_parser_entry	entry;
+	const struct spdk_trace_tpoint	*start_tpoint, *done_tpoint;
+	std::map<uint64_t, struct span>	spans;
+	uint64_t	tsc_rate = spdk_trace_get_tsc_rate(g_file);
+	uint64_t	tsc_base_offset;
+	int		index;
+
+	start_tpoint = find_tpoint("BDEV_SPAN_START");
+	done_tpoint = find_tpoint("BDEV_SPAN_DONE");
+	if (start_tpoint == NULL || done_tpoint == NULL) {
+		fprintf(stderr, "Trace file does not contain bdev span tracepoints\n");
+		return -1;
+	}
+
+	tsc_base_offset = spdk_trace_parser_get_tsc_offset(g_parser);
+	while (spdk_trace_parser_next_entry(g_parser, &entry)) {
+		struct spdk_trace_entry *e = entry.entry;
+
+		if (e->tsc < tsc_base_offset) {
+			continue;
+		}
+
+		if (e->tpoint_id == start_tpoint->tpoint_id) {
+			struct span &sp = spans[entry.args[0].u.integer];
+			uint64_t parent_id = (uint64_t)entry.args[1].u.pointer;
+			struct span_io io = {};
+
+			io.object_id = e->object_id;
+			io.parent = parent_id != 0 ? find_span_io(sp, parent_id) : -1;
+			io.owner_id = e->owner_id;
+			io.size = e->size;
+			io.type = entry.args[2].u.integer;
+			io.offset = entry.args[3].u.integer;
+			io.start_tsc = e->tsc;
+			/* Drop the I/Os whose parent was lost when the trace buffer wrapped */
+			if (parent_id != 0 ? io.parent < 0 : !sp.ios.empty()) {
+				continue;
+			}
+			sp.ios.push_back(io);
+		} else if (e->tpoint_id == done_tpoint->tpoint_id) {
+			auto it = spans.find(entry.args[0].u.integer);
+
+			if (it == spans.end()) {
+				continue;
+			}
+			index = find_span_io(it->second, e->object_id);
+			if (index < 0) {
+				continue;
+			}
+			it->second.ios[index].end_tsc = e->tsc;
+			it->second.ios[index].status = (int32_t)(int64_t)entry.args[1].u.integer;
+			it->second.ios[index].done = true;
+		}
+	}
+
+	printf("TSC Rate: %ju\n", tsc_rate);
+	for (auto &it : spans) {
+		const struct span &sp = it.second;
+
+		/* The span started before the oldest entry in the trace buffer */
+		if (sp.ios.empty()) {
+			continue;
+		}
+
+		printf("\nspan %ju: %zu I/Os\n", it.first, sp.ios.size());
+		printf("  %12s %12s %12s %6s %s\n", "start (us)", "total (us)", "self (us)",
+		       "status", "bdev");
+		print_span_io(sp, 0, 0, tsc_rate);
+	}
+
+	return 0;
+}
+
 static void
 usage(void)
 {
@@ -445,6 +635,8 @@ usage(void)
 	fprintf(stderr, "                      newest trace file in /dev/shm\n");
 #endif
 	fprintf(stderr, "                 '-j' to use JSON to format the output\n");
+	fprintf(stderr, "                 '-w' to print the sampled bdev I/O spans as\n");
+	fprintf(stderr, "                      per-layer waterfalls\n");
 }
 
 #if defined(__linux__)
@@ -477,7 +669,7 @@ main(int argc, char **argv)
 	int				shm_id = -1, shm_pid = -1;
 
 	g_exe_name = argv[0];
-	while ((op = getopt(argc, argv, "c:f:i:jp:s:tT")) != -1) {
+	while ((op = getopt(argc, argv, "c:f:i:jp:s:tTw")) != -1) {
 		switch (op) {
 		case 'c':
 			lcore = atoi(optarg);
@@ -509,6 +701,9 @@ main(int argc, char **argv)
 		case 'j':
 			print_format = PRINT_FMT_JSON;
 			break;
+		case 'w':
+			print_format = PRINT_FMT_WATERFALL;
+			break;
 		default:
 			usage();
 			exit(1);
@@ -562,6 +757,9 @@ main(int argc, char **argv)
 	case PRINT_FMT_JSON:
 		rc = trace_print_json();
 		break;
+	case PRINT_FMT_WATERFALL:
+		rc = trace_print_waterfall();
+		break;
 	case PRINT_FMT_DEFAULT:
 	default:
 		rc = trace_print(lcore);
@@ -56,7 +56,8 @@ enum spdk_accel_opcode {
 	SPDK_ACCEL_OPC_DIF_GENERATE_COPY	= 14,
 	SPDK_ACCEL_OPC_DIX_GENERATE		= 15,
 	SPDK_ACCEL_OPC_DIX_VERIFY		= 16,
-	SPDK_ACCEL_OPC_LAST			= 17,
+	SPDK_ACCEL_OPC_SHA256			= 17,
+	SPDK_ACCEL_OPC_LAST			= 18,
 };
 
 enum spdk_accel_cipher {
@@ -226,6 +227,32 @@ int spdk_accel_submit_crc32c(struct spdk_io_channel *ch, uint32_t *crc_dst, void
 int spdk_accel_submit_crc32cv(struct spdk_io_channel *ch, uint32_t *crc_dst, struct iovec *iovs,
 			      uint32_t iovcnt, uint32_t seed, spdk_accel_completion_cb cb_fn, void *cb_arg);
 
+/** Size of a SHA-256 digest in bytes */
+#define SPDK_ACCEL_SHA256_DIGEST_SIZE 32
+
+/**
+ * Submit a SHA-256 calculation request.
+ *
+ * This operation splits the source data into blocks of block_size bytes and calculates
+ * a separate SHA-256 digest of each of them, so the digests of many blocks can be
+ * calculated with a single operation.
+ *
+ * \param ch I/O channel associated with this call.
+ * \param digests Destination to write the digests to. It must be large enough to hold
+ * SPDK_ACCEL_SHA256_DIGEST_SIZE bytes for each block.
+ * \param iovs The io vector array which stores the src data and len.
+ * \param iovcnt The size of the iov.
+ * \param block_size Size of a block in bytes. The total size of the src data must be a
+ * multiple of it.
+ * \param cb_fn Called when this SHA-256 operation completes.
+ * \param cb_arg Callback argument.
+ *
+ * \return 0 on success, negative errno on failure.
+ */
+int spdk_accel_submit_sha256(struct spdk_io_channel *ch, uint8_t *digests, struct iovec *iovs,
+			     uint32_t iovcnt, uint32_t block_size, spdk_accel_completion_cb cb_fn,
+			     void *cb_arg);
+
 /**
  * Submit a copy with CRC-32C calculation request.
  *
@@ -136,6 +136,7 @@ struct spdk_accel_task {
 			uint32_t		iovcnt;
 		} d2;
 		uint32_t			seed;
+		uint8_t				*digests;
 		uint64_t			fill_pattern;
 		struct spdk_accel_crypto_key	*crypto_key;
 		struct {
@@ -151,7 +152,7 @@ struct spdk_accel_task {
 	union {
 		uint32_t		*crc_dst;
 		uint32_t		*output_size;
-		uint32_t		block_size; /* for crypto op */
+		uint32_t		block_size; /* for crypto and sha256 ops */
 	};
 	uint64_t			iv; /* Initialization vector (tweak) for crypto op */
 	struct spdk_accel_task_aux_data	*aux;
@@ -140,8 +140,40 @@ struct spdk_bdev_enable_histogram_opts {
 	uint64_t max_nsec;
 	uint8_t io_type;
 	uint8_t granularity;
+	/**
+	 * Also keep a separate histogram for each I/O type and size class, see
+	 * spdk_bdev_histogram_get_io_classes().
+	 */
+	bool per_io_class;
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_enable_histogram_opts) == 26, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_enable_histogram_opts) == 27, "Incorrect size");
+
+/** I/O types of the per I/O class histograms */
+enum spdk_bdev_histogram_io_type {
+	SPDK_BDEV_HISTOGRAM_IO_TYPE_READ,
+	SPDK_BDEV_HISTOGRAM_IO_TYPE_WRITE,
+	SPDK_BDEV_HISTOGRAM_IO_TYPE_UNMAP,
+	/** All other I/O types, accounted in the smallest size class */
+	SPDK_BDEV_HISTOGRAM_IO_TYPE_OTHER,
+	SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES /* Keep last */
+};
+
+/** I/O size classes of the per I/O class histograms */
+enum spdk_bdev_histogram_size_class {
+	/** Up to 4 KiB */
+	SPDK_BDEV_HISTOGRAM_SIZE_4K,
+	/** Over 4 KiB, up to 64 KiB */
+	SPDK_BDEV_HISTOGRAM_SIZE_64K,
+	/** Over 64 KiB */
+	SPDK_BDEV_HISTOGRAM_SIZE_LARGE,
+	SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES /* Keep last */
+};
+
+/** Histograms indexed by I/O type and size class */
+struct spdk_bdev_io_class_histograms {
+	struct spdk_histogram_data
+		*histogram[SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES];
+};
 
 /** bdev QoS rate limit type */
 enum spdk_bdev_qos_rate_limit_type {
@@ -321,6 +353,30 @@ void spdk_bdev_get_opts(struct spdk_bdev_opts *opts, size_t opts_size);
 
 int spdk_bdev_set_opts(struct spdk_bdev_opts *opts);
 
+/** Statistics of the per-thread bdev_io caches, summed over all threads */
+struct spdk_bdev_io_cache_stats {
+	/** bdev_io got from the per-thread cache */
+	uint64_t	cache;
+	/** bdev_io got from the shared pool, refilling the per-thread cache in a batch */
+	uint64_t	main;
+	/** bdev_io missed, the allocation failed or had to wait */
+	uint64_t	retry;
+};
+
+typedef void (*spdk_bdev_get_io_cache_stats_cb)(struct spdk_bdev_io_cache_stats *stats,
+		void *cb_arg);
+
+/**
+ * Get statistics of the per-thread bdev_io caches. The ratio of the bdev_io got from the cache
+ * to all of the allocations shows whether bdev_io_cache_size fits the workload.
+ *
+ * \param cb_fn Callback to be executed once the statistics of all threads are gathered.
+ * \param cb_arg Argument passed to the callback function.
+ *
+ * \return 0 on success, negative errno otherwise.
+ */
+int spdk_bdev_get_io_cache_stats(spdk_bdev_get_io_cache_stats_cb cb_fn, void *cb_arg);
+
 typedef void (*spdk_bdev_wait_for_examine_cb)(void *arg);
 
 enum spdk_bdev_reset_stat_mode {
@@ -899,6 +955,93 @@ void spdk_bdev_get_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits);
 void spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 				   void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
 
+/**
+ * Options of a QoS group.
+ */
+struct spdk_bdev_qos_group_opts {
+	/**
+	 * The size of spdk_bdev_qos_group_opts according to the caller of this library is used for
+	 * ABI compatibility. The library uses this field to know how many fields in this structure
+	 * are valid. And the library will populate any remaining fields with default values.
+	 */
+	size_t opts_size;
+
+	/**
+	 * Name of the parent group, NULL for a top-level group. The parent must be a top-level
+	 * group. Limits of the parent cap the sum of the I/O of all its child groups.
+	 */
+	const char *parent;
+
+	/**
+	 * Share of the limits of the parent group relative to the other child groups of the same
+	 * parent. Must be at least 1. Default value is 1.
+	 */
+	uint32_t weight;
+
+	/**
+	 * Read I/Os per second of the group allowed to bypass the limits of the group and of its
+	 * parent. 0 means no reservation, which is the default.
+	 */
+	uint64_t min_read_ios_per_sec;
+
+	/**
+	 * Rate limits of the group, ordered and in the units of spdk_bdev_set_qos_rate_limits().
+	 * 0 means unlimited, which is the default.
+	 */
+	uint64_t limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+};
+
+/**
+ * Initialize QoS group options to default values.
+ *
+ * \param opts Options to initialize.
+ * \param opts_size Size of the options structure.
+ */
+void spdk_bdev_qos_group_opts_init(struct spdk_bdev_qos_group_opts *opts, size_t opts_size);
+
+/**
+ * Create a QoS group. The limits of a group apply to the sum of the I/O of all its member
+ * bdevs, in addition to the rate limits set on each bdev.
+ *
+ * This function must be called from the application thread.
+ *
+ * \param name Name of the group.
+ * \param opts Options of the group.
+ * \return 0 on success, negated errno on failure.
+ */
+int spdk_bdev_qos_group_create(const char *name, const struct spdk_bdev_qos_group_opts *opts);
+
+/**
+ * Delete a QoS group. The group must not have any member bdevs or child groups.
+ *
+ * This function must be called from the application thread.
+ *
+ * \param name Name of the group.
+ * \return 0 on success, negated errno on failure.
+ */
+int spdk_bdev_qos_group_delete(const char *name);
+
+/**
+ * Add a bdev to a QoS group. A bdev can be a member of a single group.
+ *
+ * \param name Name of the group.
+ * \param bdev Block device.
+ * \param cb_fn Callback function to be called when the bdev has been added.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_qos_group_add_bdev(const char *name, struct spdk_bdev *bdev,
+				  void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
+/**
+ * Remove a bdev from its QoS group.
+ *
+ * \param bdev Block device.
+ * \param cb_fn Callback function to be called when the bdev has been removed.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_qos_group_remove_bdev(struct spdk_bdev *bdev,
+				     void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
 /**
  * Get minimum I/O buffer address alignment for a bdev.
  *
@@ -1136,6 +1279,55 @@ spdk_bdev_get_qd_sampling_period(const struct spdk_bdev *bdev);
  */
 void spdk_bdev_set_qd_sampling_period(struct spdk_bdev *bdev, uint64_t period);
 
+/**
+ * Set a tail latency target (SLO) for this bdev.
+ *
+ * Each channel of the bdev then limits the number of I/O outstanding on the underlying device,
+ * so that the 99th percentile of the read and write latency of the device stays under the target.
+ * The limit is lowered when the latency exceeds the target and raised again while the latency is
+ * met and the limit is reached. Read and write I/O over the limit are queued and submitted as the
+ * outstanding I/O complete.
+ *
+ * \param bdev Block device.
+ * \param target_latency_us 99th percentile latency target in microseconds. 0 disables the
+ * latency SLO.
+ * \param max_queue_depth Maximum number of I/O outstanding on each channel. 0 selects the default.
+ * \param cb_fn Callback function to be called when the SLO has been applied to all channels.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_set_latency_slo(struct spdk_bdev *bdev, uint64_t target_latency_us,
+			       uint32_t max_queue_depth,
+			       void (*cb_fn)(void *cb_arg, int status), void *cb_arg);
+
+/**
+ * Get the tail latency target of this bdev.
+ *
+ * \param bdev Block device to query.
+ *
+ * \return 99th percentile latency target in microseconds, 0 if there is no latency SLO.
+ */
+uint64_t spdk_bdev_get_latency_slo(const struct spdk_bdev *bdev);
+
+/**
+ * Set how often I/O are sampled for span tracing.
+ *
+ * One out of every sample_rate I/O submitted by bdev users on each channel starts a trace
+ * span.  The I/O submitted by the bdev modules on behalf of a sampled I/O, e.g. by virtual bdevs
+ * to their base bdevs, join its span, so the BDEV_SPAN_START and BDEV_SPAN_DONE tracepoints record
+ * the time spent in each layer of the bdev stack.  The tracepoints are only recorded when the bdev
+ * tracepoint group is enabled.
+ *
+ * \param sample_rate Sample one out of this many I/O. 0 disables span tracing.
+ */
+void spdk_bdev_set_span_sample_rate(uint32_t sample_rate);
+
+/**
+ * Get how often I/O are sampled for span tracing.
+ *
+ * \return Number of I/O per sampled I/O, 0 if span tracing is disabled.
+ */
+uint32_t spdk_bdev_get_span_sample_rate(void);
+
 /**
  * Get the time spent processing IO for this device.
  *
@@ -2471,6 +2663,22 @@ void spdk_bdev_histogram_get(struct spdk_bdev *bdev, struct spdk_histogram_data
 void spdk_bdev_channel_get_histogram(struct spdk_io_channel *ch, spdk_bdev_histogram_data_cb cb_fn,
 				     void *cb_arg);
 
+/**
+ * Get aggregated histogram data of a bdev for each I/O type and size class. The histograms
+ * must have been enabled with the per_io_class option, and each of the histograms passed in
+ * must have the granularity and range the histograms of the bdev were enabled with. The data
+ * of all channels is added to the histograms.
+ *
+ * \param bdev Block device.
+ * \param histograms Histograms for aggregated data.
+ * \param cb_fn Callback function to be called with the status once the data of all channels
+ * has been collected.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void spdk_bdev_histogram_get_io_classes(struct spdk_bdev *bdev,
+					struct spdk_bdev_io_class_histograms *histograms,
+					spdk_bdev_histogram_status_cb cb_fn, void *cb_arg);
+
 /**
  * Retrieves media events.  Can only be called from the context of
  * SPDK_BDEV_EVENT_MEDIA_MANAGEMENT event callback.  These events are sent by
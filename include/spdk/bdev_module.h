@@ -372,6 +372,18 @@ struct spdk_bdev_fn_table {
 
 	/** Check if bdev can handle spdk_accel_sequence to handle I/O of specific type. */
 	bool (*accel_sequence_supported)(void *ctx, enum spdk_bdev_io_type type);
+
+	/**
+	 * Get the number of blocks, starting at offset_blocks and up to num_blocks, that the bdev
+	 * module can take in a single READ or WRITE I/O even though they cross optimal_io_boundary,
+	 * e.g. because they are laid out contiguously on the same underlying bdev (optional).
+	 *
+	 * Only used when split_on_optimal_io_boundary is set.  The bdev layer then merges adjacent
+	 * split children instead of submitting them separately.  Returning a value not larger than
+	 * the number of blocks to the next boundary keeps the regular split.  This function is
+	 * called in the I/O path and may be called from any thread.
+	 */
+	uint64_t (*get_contiguous_blocks)(void *ctx, uint64_t offset_blocks, uint64_t num_blocks);
 };
 
 /** bdev I/O completion status */
@@ -508,7 +520,16 @@ struct spdk_bdev {
 
 		uint32_t memory_domains_supported : 1;
 
-		uint32_t reserved : 25;
+		/**
+		 * Specifies whether WRITE I/O that don't cover a whole write_unit_size
+		 * are allowed. This is only meaningful together with split_on_write_unit,
+		 * in which case the bdev layer still splits WRITE I/O that span the
+		 * write_unit_size, but doesn't fail the ones that are shorter than it,
+		 * leaving it to the bdev module to handle them.
+		 */
+		uint32_t allow_partial_write_unit : 1;
+
+		uint32_t reserved : 24;
 	};
 
 	/** Number of blocks required for write */
@@ -813,9 +834,17 @@ struct spdk_bdev {
 		bool	 histogram_in_progress;
 		uint8_t	 histogram_io_type;
 		uint8_t	 histogram_granularity;
+		/** histograms are also kept for each I/O type and size class */
+		bool	 histogram_per_io_class;
 		uint64_t histogram_min_val;
 		uint64_t histogram_max_val;
 
+		/** 99th percentile latency target in microseconds, 0 if there is no latency SLO */
+		uint64_t latency_slo_target_us;
+		/** Maximum queue depth of each channel allowed by the latency SLO */
+		uint32_t latency_slo_max_queue_depth;
+		bool	 latency_slo_in_progress;
+
 		/** Currently locked ranges for this bdev.  Used to populate new channels. */
 		lba_range_tailq_t locked_ranges;
 
@@ -1030,7 +1059,14 @@ struct spdk_bdev_io_internal_fields {
 	/** Retry state (resubmit, re-pull, re-push, etc.) */
 	uint8_t retry_state;
 
-	uint8_t	reserved[5];
+	/** Depth of this I/O in its trace span, 0 for the I/O that started the span. */
+	uint8_t span_depth;
+
+	/**
+	 * Lower 32 bits of the tsc when the I/O was submitted to the bdev module. Only set when
+	 * the bdev has a latency SLO, used to measure the latency of the underlying device.
+	 */
+	uint32_t slo_submit_tsc;
 
 	/** The bdev descriptor that was used when submitting this I/O. */
 	struct spdk_bdev_desc *desc;
@@ -1134,6 +1170,12 @@ struct spdk_bdev_io_internal_fields {
 
 	/** Data transfer completion callback */
 	void (*data_transfer_cpl)(void *ctx, int rc);
+
+	/** ID of the trace span this I/O belongs to, 0 if the I/O was not sampled. */
+	uint64_t span_id;
+
+	/** The I/O that submitted this one within the same trace span, NULL for the root. */
+	struct spdk_bdev_io *span_parent;
 };
 
 struct spdk_bdev_io {
@@ -1174,7 +1216,7 @@ struct spdk_bdev_io {
 	 *  must not read or write to these fields.
 	 */
 	struct spdk_bdev_io_internal_fields internal;
-	uint8_t reserved4[64];
+	uint8_t reserved4[48];
 
 	/**
 	 * Per I/O context for use by the bdev module.
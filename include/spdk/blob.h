@@ -558,6 +558,57 @@ uint64_t spdk_blob_get_next_allocated_io_unit(struct spdk_blob *blob, uint64_t o
  */
 uint64_t spdk_blob_get_next_unallocated_io_unit(struct spdk_blob *blob, uint64_t offset);
 
+/**
+ * Get the number of contiguous io_units
+ *
+ * Starting at 'offset' io_units into the blob, returns how many io_units, up to
+ * 'length', can be read or written with a single I/O to the blobstore device,
+ * i.e. they belong to allocated clusters placed at consecutive LBAs.  If 'offset'
+ * points to an unallocated io_unit, the number of io_units up to the next cluster
+ * boundary is returned.
+ *
+ * \param blob Blob struct to query.
+ * \param offset Offset is in io units from the beginning of the blob.
+ * \param length Maximum number of io units to check.
+ *
+ * \return number of io_units, 0 if 'offset' is beyond the end of the blob.
+ */
+uint64_t spdk_blob_get_num_contiguous_io_units(struct spdk_blob *blob, uint64_t offset,
+		uint64_t length);
+
+/**
+ * Get the LBA on the blobstore device backing a range of io_units
+ *
+ * The whole range must be allocated in the blob itself, i.e. not in its parent snapshot or
+ * external snapshot, and placed at consecutive LBAs, so that it can be accessed directly on
+ * the blobstore device.
+ *
+ * On success, the clusters of the range stay with the blob until spdk_blob_release_dev_lba()
+ * is called: operations that move clusters away from the blob, like creating a snapshot,
+ * wait for the release.  It must be called on a thread with a blobstore I/O channel.
+ *
+ * \param blob Blob struct to query.
+ * \param offset Offset is in io units from the beginning of the blob.
+ * \param length Number of io units in the range.
+ * \param lba On success, the LBA on the blobstore device backing 'offset'.
+ *
+ * \return 0 on success.
+ * \return -EINVAL if the range is empty or beyond the end of the blob.
+ * \return -EBUSY if I/O to the blob is frozen.
+ * \return -ENODATA if the range isn't fully allocated or isn't contiguous on the device.
+ */
+int spdk_blob_get_dev_lba(struct spdk_blob *blob, uint64_t offset, uint64_t length,
+			  uint64_t *lba);
+
+/**
+ * Release a range of the blobstore device obtained with spdk_blob_get_dev_lba()
+ *
+ * Must be called once the I/O to the range on the blobstore device is complete.
+ *
+ * \param blob Blob struct passed to spdk_blob_get_dev_lba().
+ */
+void spdk_blob_release_dev_lba(struct spdk_blob *blob);
+
 struct spdk_blob_xattr_opts {
 	/* Number of attributes */
 	size_t	count;
@@ -976,6 +1027,14 @@ struct spdk_io_channel *spdk_bs_alloc_io_channel(struct spdk_blob_store *bs);
  */
 void spdk_bs_free_io_channel(struct spdk_io_channel *channel);
 
+/**
+ * Get the blobstore device I/O channel used by a blobstore I/O channel.
+ *
+ * \param channel Blobstore I/O channel.
+ * \return a pointer to the I/O channel of the blobstore device.
+ */
+struct spdk_io_channel *spdk_bs_get_dev_io_channel(struct spdk_io_channel *channel);
+
 /**
  * Write data to a blob.
  *
@@ -84,6 +84,18 @@ void spdk_bdev_update_bs_blockcnt(struct spdk_bs_dev *bs_dev);
  */
 int spdk_bs_bdev_claim(struct spdk_bs_dev *bs_dev, struct spdk_bdev_module *module);
 
+/**
+ * Get the bdev descriptor of a blobstore block device.
+ *
+ * I/O can be submitted with this descriptor on the I/O channel returned by
+ * spdk_bs_get_dev_io_channel() for a blobstore created on this device.
+ *
+ * \param bs_dev Blobstore block device.
+ *
+ * \return the bdev descriptor.
+ */
+struct spdk_bdev_desc *spdk_bs_bdev_get_desc(struct spdk_bs_dev *bs_dev);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,81 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/**
+ * \file
+ * Galois field GF(2^8) utility functions
+ *
+ * The field is generated by the polynomial x^8 + x^4 + x^3 + x^2 + 1 (0x11d) with
+ * generator g = 2, which is the field used by RAID6 P+Q and by ISA-L erasure coding.
+ */
+
+#ifndef SPDK_GF_H
+#define SPDK_GF_H
+
+#include "spdk/stdinc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Multiply two elements of GF(2^8).
+ *
+ * \param a First element.
+ * \param b Second element.
+ * \return a * b.
+ */
+uint8_t spdk_gf_mul(uint8_t a, uint8_t b);
+
+/**
+ * Get the multiplicative inverse of an element of GF(2^8).
+ *
+ * \param a Element to invert. Must not be 0.
+ * \return a^-1, or 0 if a is 0.
+ */
+uint8_t spdk_gf_inv(uint8_t a);
+
+/**
+ * Raise the field generator to a power.
+ *
+ * \param e Exponent. Negative exponents are allowed.
+ * \return g^e.
+ */
+uint8_t spdk_gf_exp(int e);
+
+/**
+ * Generate RAID6 P and Q syndromes from multiple source buffers.
+ *
+ * P is the XOR of all sources, Q is the sum of g^i * sources[i] over GF(2^8).
+ *
+ * \param p Destination buffer for P.
+ * \param q Destination buffer for Q.
+ * \param sources Array of source buffers.
+ * \param n Number of source buffers in the array.
+ * \param len Length of each buffer in bytes.
+ * \return 0 on success, negative error code otherwise.
+ */
+int spdk_gf_gen_pq(void *p, void *q, void **sources, uint32_t n, uint32_t len);
+
+/**
+ * Calculate a GF(2^8) dot product of multiple source buffers.
+ *
+ * dest = sum of coefs[i] * sources[i] over GF(2^8).
+ *
+ * \param dest Destination buffer.
+ * \param sources Array of source buffers.
+ * \param coefs Array of coefficients, one per source buffer.
+ * \param n Number of source buffers in the array.
+ * \param len Length of each buffer in bytes.
+ * \return 0 on success, negative error code otherwise.
+ */
+int spdk_gf_vect_dot_prod(void *dest, void **sources, const uint8_t *coefs, uint32_t n,
+			  uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPDK_GF_H */
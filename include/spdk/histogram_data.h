@@ -360,6 +360,55 @@ spdk_histogram_get_borders_count_free_ctx(struct spdk_histogram_borders *ctx)
 	free(ctx);
 }
 
+struct spdk_histogram_percentiles {
+	const double *percentiles;
+	uint64_t *values;
+	size_t num_percentiles;
+	size_t index;
+};
+
+static inline void
+__spdk_histogram_get_percentiles_cb(void *_ctx, uint64_t start, uint64_t end, uint64_t count,
+				    uint64_t total, uint64_t so_far)
+{
+	struct spdk_histogram_percentiles *ctx = (struct spdk_histogram_percentiles *)_ctx;
+
+	if (count == 0) {
+		return;
+	}
+
+	while (ctx->index < ctx->num_percentiles &&
+	       (double)so_far * 100 >= ctx->percentiles[ctx->index] * total) {
+		ctx->values[ctx->index] = end;
+		ctx->index++;
+	}
+}
+
+/**
+ * Get percentiles of the datapoints in a histogram. Each value is the upper bound (exclusive)
+ * of the bucket holding the datapoint of that percentile, so it is exact up to the
+ * granularity of the histogram. Values are set to 0 if the histogram is empty.
+ *
+ * \param h The histogram data.
+ * \param percentiles An array of percentiles between 0 and 100, sorted in ascending order.
+ * \param values An array filled with the value of each percentile.
+ * \param num_percentiles The number of entries of the percentiles and values arrays.
+ */
+static inline void
+spdk_histogram_data_get_percentiles(const struct spdk_histogram_data *h,
+				    const double *percentiles, uint64_t *values,
+				    size_t num_percentiles)
+{
+	struct spdk_histogram_percentiles ctx = {
+		.percentiles = percentiles,
+		.values = values,
+		.num_percentiles = num_percentiles,
+	};
+
+	memset(values, 0, sizeof(*values) * num_percentiles);
+	spdk_histogram_data_iterate(h, __spdk_histogram_get_percentiles_cb, &ctx);
+}
+
 #ifdef __cplusplus
 }
 #endif
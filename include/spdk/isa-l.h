@@ -24,11 +24,13 @@ extern "C" {
 #ifdef SPDK_CONFIG_ISAL_INSTALLED
 #include <isa-l/crc.h>
 #include <isa-l/crc64.h>
+#include <isa-l/erasure_code.h>
 #include <isa-l/igzip_lib.h>
 #include <isa-l/raid.h>
 #else
 #include "../isa-l/include/crc.h"
 #include "../isa-l/include/crc64.h"
+#include "../isa-l/include/erasure_code.h"
 #include "../isa-l/include/igzip_lib.h"
 #include "../isa-l/include/raid.h"
 #endif
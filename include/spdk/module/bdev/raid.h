@@ -17,10 +17,22 @@ enum spdk_bdev_raid_level {
 	SPDK_BDEV_RAID_LEVEL_INVALID	= -1,
 	SPDK_BDEV_RAID_LEVEL_RAID0	= 0,
 	SPDK_BDEV_RAID_LEVEL_RAID1	= 1,
+	SPDK_BDEV_RAID_LEVEL_RAID6	= 6,
 	SPDK_BDEV_RAID_LEVEL_RAID5F	= 95, /* 0x5f */
 	SPDK_BDEV_RAID_LEVEL_CONCAT	= 99,
 };
 
+enum spdk_bdev_raid1_read_policy {
+	/* read from the base bdev with the fewest outstanding read blocks */
+	SPDK_BDEV_RAID1_READ_POLICY_QUEUE_DEPTH = 0,
+
+	/*
+	 * read from the base bdev with the lowest expected completion time, based on
+	 * the moving average of its read latency, and keep sequential reads on one base bdev
+	 */
+	SPDK_BDEV_RAID1_READ_POLICY_LATENCY,
+};
+
 enum spdk_bdev_raid_state {
 	/* raid bdev is ready and is seen by upper layers */
 	SPDK_BDEV_RAID_STATE_ONLINE = 0,
@@ -175,6 +175,8 @@ struct spdk_scheduler_thread_info {
 	struct spdk_thread_stats total_stats;
 	/* stats during the last scheduling period */
 	struct spdk_thread_stats current_stats;
+	/* NUMA affinity of the thread, see spdk_thread_get_numa_id() */
+	int32_t numa_id;
 };
 
 /**
@@ -275,6 +277,26 @@ void spdk_scheduler_set_period(uint64_t period);
  */
 uint64_t spdk_scheduler_get_period(void);
 
+/**
+ * Change the thread stealing period.
+ *
+ * A reactor that has been idle for a few stealing periods in a row takes a thread
+ * from the busiest overloaded reactor on the same NUMA node, without waiting for the
+ * next scheduling period.  Only threads that are not bound to their core and whose
+ * cpumask includes the idle reactor's core are taken.  Setting period to 0 disables
+ * thread stealing, which is the default.
+ *
+ * \param period Period to set in microseconds.
+ */
+void spdk_scheduler_set_thread_steal_period(uint64_t period);
+
+/**
+ * Get the thread stealing period.
+ *
+ * \return Thread stealing period in microseconds, 0 if thread stealing is disabled.
+ */
+uint64_t spdk_scheduler_get_thread_steal_period(void);
+
 /**
  * Add the given scheduler to the list of registered schedulers.
  * This function should be invoked by referencing the macro
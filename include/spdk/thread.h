@@ -349,6 +349,17 @@ void *spdk_thread_get_ctx(struct spdk_thread *thread);
  */
 struct spdk_cpuset *spdk_thread_get_cpumask(struct spdk_thread *thread);
 
+/**
+ * Get the NUMA affinity of a thread, i.e. the NUMA node of most of its I/O channels with a NUMA
+ * node set, see spdk_io_channel_set_numa_id().  May only be called while the thread is not
+ * being polled, e.g. from the thread itself.
+ *
+ * \param thread The thread to query.
+ *
+ * \return NUMA node ID, or SPDK_ENV_NUMA_ID_ANY if the thread has no NUMA affinity.
+ */
+int32_t spdk_thread_get_numa_id(struct spdk_thread *thread);
+
 /**
  * Set the current thread's cpumask to the specified value. The thread may be
  * rescheduled to one of the CPUs specified in the cpumask.
@@ -512,6 +523,59 @@ uint64_t spdk_thread_get_last_tsc(struct spdk_thread *thread);
  */
 int spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx);
 
+/**
+ * Send a batch of messages to the given thread, calling the same function with each of the
+ * given contexts.
+ *
+ * The messages are enqueued at once and the thread is notified once, and they are executed
+ * in order, after the messages previously sent by the calling thread to the same thread.
+ *
+ * Errors are handled internally and are fatal.
+ *
+ * \param thread The target thread.
+ * \param fn This function will be called on the given thread with each context.
+ * \param ctxs Array of the contexts to pass to fn.
+ * \param count Number of entries in ctxs.
+ *
+ * \return 0 left for consistency with spdk_thread_send_msg()
+ */
+int spdk_thread_send_msg_batch(const struct spdk_thread *thread, spdk_msg_fn fn, void **ctxs,
+			       uint32_t count);
+
+/**
+ * Enable or disable the message channels.
+ *
+ * When enabled, the messages sent by an SPDK thread to another one go through a ring dedicated
+ * to that pair of threads, instead of the ring shared by all the senders to the target thread.
+ * The target thread then only polls the rings with pending messages.  Message channels are not
+ * used in interrupt mode, or for messages sent from outside of an SPDK thread.
+ *
+ * Disabling them only stops creating new channels, the existing ones are kept in use to preserve
+ * the order of the messages.
+ *
+ * \param enable True to enable the message channels, false to disable them.
+ */
+void spdk_thread_enable_msg_channels(bool enable);
+
+/**
+ * Enable or disable the cycle accounting.
+ *
+ * When enabled, the threads measure the cycles spent in each run of their pollers, split by busy
+ * and idle runs, and in the messages and interrupt handlers they execute, aggregated by callback
+ * function.  The accounting costs two reads of the timestamp counter per callback, so it is
+ * disabled by default.  Disabling it keeps the cycles accounted so far.
+ *
+ * \param enable True to enable the cycle accounting, false to disable it.
+ */
+void spdk_thread_enable_cycle_accounting(bool enable);
+
+/**
+ * Check whether the cycle accounting is enabled.
+ *
+ * \return true if the cycle accounting is enabled, false otherwise.
+ */
+bool spdk_thread_cycle_accounting_is_enabled(void);
+
 /**
  * Send a message to the given thread. Only one critical message can be outstanding at the same
  * time. It's intended to use this function in any cases that might interrupt the execution of the
@@ -669,6 +733,24 @@ void spdk_poller_pause(struct spdk_poller *poller);
  */
 void spdk_poller_resume(struct spdk_poller *poller);
 
+/**
+ * Enable adaptive backoff of a poller on the current thread.
+ *
+ * A poller that keeps returning SPDK_POLLER_IDLE is then run exponentially less
+ * often, down to once every max_interval iterations of its thread.  It's run on
+ * every iteration again as soon as it returns SPDK_POLLER_BUSY.  Only pollers
+ * registered without a period are affected, and only while their thread is in
+ * poll mode.
+ *
+ * Since an idle poller may be skipped, backoff should only be enabled for pollers
+ * that can tolerate the extra latency of picking up new work.
+ *
+ * \param poller The poller to change.
+ * \param max_interval Maximum number of thread iterations between two runs of the
+ * poller.  0 or 1 disables the backoff.
+ */
+void spdk_poller_set_backoff(struct spdk_poller *poller, uint32_t max_interval);
+
 /**
  * Register the opaque io_device context as an I/O device.
  *
@@ -780,6 +862,27 @@ struct spdk_io_channel *spdk_io_channel_from_ctx(void *ctx);
  */
 struct spdk_thread *spdk_io_channel_get_thread(struct spdk_io_channel *ch);
 
+/**
+ * Set the NUMA node of the resources accessed through an I/O channel, e.g. the device or the
+ * memory it uses.  It is typically called from the create_cb of the io_device.
+ *
+ * The NUMA nodes of the I/O channels of a thread determine its NUMA affinity, see
+ * spdk_thread_get_numa_id().
+ *
+ * \param ch I/O channel.
+ * \param numa_id NUMA node ID, or SPDK_ENV_NUMA_ID_ANY if the channel has no NUMA affinity.
+ */
+void spdk_io_channel_set_numa_id(struct spdk_io_channel *ch, int32_t numa_id);
+
+/**
+ * Get the NUMA node of the resources accessed through an I/O channel.
+ *
+ * \param ch I/O channel.
+ *
+ * \return NUMA node ID, or SPDK_ENV_NUMA_ID_ANY if the channel has no NUMA affinity.
+ */
+int32_t spdk_io_channel_get_numa_id(struct spdk_io_channel *ch);
+
 /**
  * Call 'fn' on each channel associated with io_device.
  *
@@ -78,6 +78,18 @@ struct spdk_reactor {
 	struct spdk_fd_group				*fgrp;
 	int						resched_fd;
 	uint16_t					trace_id;
+
+	/* Thread stealing, see spdk_scheduler_set_thread_steal_period() */
+	uint64_t					steal_tsc_last;
+	uint64_t					steal_busy_tsc;
+	uint64_t					steal_idle_tsc;
+	/* Do not steal another thread before this time */
+	uint64_t					steal_resume_tsc;
+	/* Busy percentage during the last steal period, read by the other reactors */
+	uint32_t					steal_load;
+	/* Number of consecutive steal periods the reactor has been idle, or overloaded */
+	uint32_t					steal_idle_periods;
+	uint32_t					steal_busy_periods;
 } __attribute__((aligned(SPDK_CACHE_LINE_SIZE)));
 
 int spdk_reactors_init(size_t msg_mempool_size);
@@ -14,8 +14,34 @@ struct spdk_poller;
 struct spdk_poller_stats {
 	uint64_t	run_count;
 	uint64_t	busy_count;
+	/* Number of thread iterations the poller was skipped because of its backoff */
+	uint64_t	skip_count;
+	/* Cycles spent in busy and idle runs, only accounted when cycle accounting is enabled */
+	uint64_t	busy_tsc;
+	uint64_t	idle_tsc;
+	/* Current backoff interval of the poller, 0 if backoff is disabled */
+	uint32_t	backoff_interval;
 };
 
+enum spdk_thread_callback_type {
+	SPDK_THREAD_CALLBACK_MSG,
+	SPDK_THREAD_CALLBACK_INTERRUPT,
+	/* Messages and interrupt handlers which didn't fit in the thread's table */
+	SPDK_THREAD_CALLBACK_OTHER,
+};
+
+/* Cycles spent by a thread in a message or interrupt handler callback. */
+struct spdk_thread_callback_stats {
+	/* Callback function, NULL for the callbacks which didn't fit in the thread's table */
+	void				*fn;
+	enum spdk_thread_callback_type	type;
+	uint64_t			run_count;
+	uint64_t			tsc;
+};
+
+typedef void (*spdk_thread_callback_stats_fn)(const struct spdk_thread_callback_stats *stats,
+		void *ctx);
+
 struct io_device;
 struct spdk_thread;
 
@@ -37,6 +63,9 @@ struct spdk_poller *spdk_thread_get_next_timed_poller(struct spdk_poller *prev);
 struct spdk_poller *spdk_thread_get_first_paused_poller(struct spdk_thread *thread);
 struct spdk_poller *spdk_thread_get_next_paused_poller(struct spdk_poller *prev);
 
+void spdk_thread_get_callback_stats(struct spdk_thread *thread, spdk_thread_callback_stats_fn fn,
+				    void *ctx);
+
 struct spdk_io_channel *spdk_thread_get_first_io_channel(struct spdk_thread *thread);
 struct spdk_io_channel *spdk_thread_get_next_io_channel(struct spdk_io_channel *prev);
 
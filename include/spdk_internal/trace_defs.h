@@ -57,6 +57,8 @@
 #define TRACE_BDEV_IO_DONE		SPDK_TPOINT_ID(TRACE_GROUP_BDEV, 0x1)
 #define TRACE_BDEV_IOCH_CREATE		SPDK_TPOINT_ID(TRACE_GROUP_BDEV, 0x2)
 #define TRACE_BDEV_IOCH_DESTROY		SPDK_TPOINT_ID(TRACE_GROUP_BDEV, 0x3)
+#define TRACE_BDEV_SPAN_START		SPDK_TPOINT_ID(TRACE_GROUP_BDEV, 0x4)
+#define TRACE_BDEV_SPAN_DONE		SPDK_TPOINT_ID(TRACE_GROUP_BDEV, 0x5)
 
 /* NVMe-of TCP tracepoint  definitions */
 #define TRACE_TCP_REQUEST_STATE_NEW				SPDK_TPOINT_ID(TRACE_GROUP_NVMF_TCP, 0x00)
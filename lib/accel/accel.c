@@ -80,7 +80,7 @@ static const char *g_opcode_strings[SPDK_ACCEL_OPC_LAST] = {
 	"copy", "fill", "dualcast", "compare", "crc32c", "copy_crc32c",
 	"compress", "decompress", "encrypt", "decrypt", "xor",
 	"dif_verify", "dif_verify_copy", "dif_generate", "dif_generate_copy",
-	"dix_generate", "dix_verify"
+	"dix_generate", "dix_verify", "sha256"
 };
 
 enum accel_sequence_state {
@@ -666,6 +666,43 @@ spdk_accel_submit_copy_crc32cv(struct spdk_io_channel *ch, void *dst,
 	return accel_submit_task(accel_ch, accel_task);
 }
 
+/* Accel framework public API for SHA-256 function */
+int
+spdk_accel_submit_sha256(struct spdk_io_channel *ch, uint8_t *digests, struct iovec *iovs,
+			 uint32_t iovcnt, uint32_t block_size, spdk_accel_completion_cb cb_fn,
+			 void *cb_arg)
+{
+	struct accel_io_channel *accel_ch = spdk_io_channel_get_ctx(ch);
+	struct spdk_accel_task *accel_task;
+	uint64_t nbytes;
+
+	if (iovs == NULL || iovcnt == 0 || block_size == 0) {
+		return -EINVAL;
+	}
+
+	nbytes = accel_get_iovlen(iovs, iovcnt);
+	if (nbytes == 0 || nbytes % block_size != 0) {
+		SPDK_ERRLOG("Length %" PRIu64 " is not a multiple of block size %u\n", nbytes, block_size);
+		return -EINVAL;
+	}
+
+	accel_task = _get_task(accel_ch, cb_fn, cb_arg);
+	if (spdk_unlikely(accel_task == NULL)) {
+		return -ENOMEM;
+	}
+
+	accel_task->s.iovs = iovs;
+	accel_task->s.iovcnt = iovcnt;
+	accel_task->nbytes = nbytes;
+	accel_task->digests = digests;
+	accel_task->block_size = block_size;
+	accel_task->op_code = SPDK_ACCEL_OPC_SHA256;
+	accel_task->src_domain = NULL;
+	accel_task->dst_domain = NULL;
+
+	return accel_submit_task(accel_ch, accel_task);
+}
+
 int
 spdk_accel_get_compress_level_range(enum spdk_accel_comp_algo comp_algo,
 				    uint32_t *min_level, uint32_t *max_level)
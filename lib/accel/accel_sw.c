@@ -23,6 +23,8 @@
 #include <lz4.h>
 #endif
 
+#include <openssl/evp.h>
+
 #ifdef SPDK_CONFIG_ISAL
 #include "spdk/isa-l.h"
 #ifdef SPDK_CONFIG_ISAL_CRYPTO
@@ -63,6 +65,9 @@ struct sw_accel_io_channel {
 	LZ4_stream_t                    *lz4_stream;
 	LZ4_streamDecode_t              *lz4_stream_decode;
 #endif
+	/* for sha256 */
+	EVP_MD_CTX			*md_ctx;
+	const EVP_MD			*sha256;
 	struct spdk_poller		*completion_poller;
 	STAILQ_HEAD(, spdk_accel_task)	tasks_to_complete;
 };
@@ -112,6 +117,7 @@ sw_accel_supports_opcode(enum spdk_accel_opcode opc)
 	case SPDK_ACCEL_OPC_DIF_VERIFY_COPY:
 	case SPDK_ACCEL_OPC_DIX_GENERATE:
 	case SPDK_ACCEL_OPC_DIX_VERIFY:
+	case SPDK_ACCEL_OPC_SHA256:
 		return true;
 	default:
 		return false;
@@ -196,6 +202,51 @@ _sw_accel_crc32cv(uint32_t *crc_dst, struct iovec *iov, uint32_t iovcnt, uint32_
 	*crc_dst = spdk_crc32c_iov_update(iov, iovcnt, ~seed);
 }
 
+/* Digests of consecutive blocks are calculated in a single pass over the iovs. OpenSSL selects
+ * the SHA extensions or AVX2/SSSE3 code path supported by the CPU at runtime.
+ */
+static int
+_sw_accel_sha256(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
+{
+	struct iovec *iovs = accel_task->s.iovs;
+	uint32_t block_size = accel_task->block_size;
+	uint8_t *digest = accel_task->digests;
+	uint64_t iov_offset = 0, remaining, len, n;
+	uint32_t i = 0;
+
+	if (spdk_unlikely(block_size == 0 || accel_task->nbytes % block_size != 0)) {
+		return -EINVAL;
+	}
+
+	for (remaining = accel_task->nbytes; remaining > 0; remaining -= block_size) {
+		if (spdk_unlikely(EVP_DigestInit_ex(sw_ch->md_ctx, sw_ch->sha256, NULL) != 1)) {
+			return -EIO;
+		}
+
+		for (len = block_size; len > 0;) {
+			n = spdk_min(len, iovs[i].iov_len - iov_offset);
+			if (spdk_unlikely(EVP_DigestUpdate(sw_ch->md_ctx,
+							   (uint8_t *)iovs[i].iov_base + iov_offset, n) != 1)) {
+				return -EIO;
+			}
+
+			len -= n;
+			iov_offset += n;
+			if (iov_offset == iovs[i].iov_len) {
+				iov_offset = 0;
+				i++;
+			}
+		}
+
+		if (spdk_unlikely(EVP_DigestFinal_ex(sw_ch->md_ctx, digest, NULL) != 1)) {
+			return -EIO;
+		}
+		digest += SPDK_ACCEL_SHA256_DIGEST_SIZE;
+	}
+
+	return 0;
+}
+
 static int
 _sw_accel_compress_lz4(struct sw_accel_io_channel *sw_ch, struct spdk_accel_task *accel_task)
 {
@@ -778,6 +829,9 @@ sw_accel_submit_tasks(struct spdk_io_channel *ch, struct spdk_accel_task *accel_
 		case SPDK_ACCEL_OPC_DIX_VERIFY:
 			rc = _sw_accel_dix_verify(sw_ch, accel_task);
 			break;
+		case SPDK_ACCEL_OPC_SHA256:
+			rc = _sw_accel_sha256(sw_ch, accel_task);
+			break;
 		default:
 			assert(false);
 			break;
@@ -805,16 +859,25 @@ sw_accel_create_cb(void *io_device, void *ctx_buf)
 	STAILQ_INIT(&sw_ch->tasks_to_complete);
 	sw_ch->completion_poller = NULL;
 
+	sw_ch->sha256 = EVP_sha256();
+	sw_ch->md_ctx = EVP_MD_CTX_new();
+	if (sw_ch->md_ctx == NULL) {
+		SPDK_ERRLOG("Failed to allocate the sha256 digest context\n");
+		return -ENOMEM;
+	}
+
 #ifdef SPDK_CONFIG_HAVE_LZ4
 	sw_ch->lz4_stream = LZ4_createStream();
 	if (sw_ch->lz4_stream == NULL) {
 		SPDK_ERRLOG("Failed to create the lz4 stream for compression\n");
+		EVP_MD_CTX_free(sw_ch->md_ctx);
 		return -ENOMEM;
 	}
 	sw_ch->lz4_stream_decode = LZ4_createStreamDecode();
 	if (sw_ch->lz4_stream_decode == NULL) {
 		SPDK_ERRLOG("Failed to create the lz4 stream for decompression\n");
 		LZ4_freeStream(sw_ch->lz4_stream);
+		EVP_MD_CTX_free(sw_ch->md_ctx);
 		return -ENOMEM;
 	}
 #endif
@@ -857,6 +920,7 @@ sw_accel_destroy_cb(void *io_device, void *ctx_buf)
 	LZ4_freeStream(sw_ch->lz4_stream);
 	LZ4_freeStreamDecode(sw_ch->lz4_stream_decode);
 #endif
+	EVP_MD_CTX_free(sw_ch->md_ctx);
 	spdk_poller_unregister(&sw_ch->completion_poller);
 }
 
@@ -42,6 +42,7 @@ SPDK_LOG_DEPRECATION_REGISTER(bdev_get_memory_domains,
 #define SPDK_BDEV_IO_POOL_SIZE			(64 * 1024 - 1)
 #define SPDK_BDEV_IO_CACHE_SIZE			256
 #define BDEV_IO_BATCH_SIZE			64
+#define BDEV_IO_CACHE_BATCH_SIZE		32
 #define SPDK_BDEV_AUTO_EXAMINE			true
 #define BUF_SMALL_CACHE_SIZE			128
 #define BUF_LARGE_CACHE_SIZE			16
@@ -54,6 +55,14 @@ SPDK_LOG_DEPRECATION_REGISTER(bdev_get_memory_domains,
 #define SPDK_BDEV_QOS_MIN_BYTES_PER_SEC		(1024 * 1024)
 #define SPDK_BDEV_QOS_MAX_MBYTES_PER_SEC	(UINT64_MAX / (1024 * 1024))
 #define SPDK_BDEV_QOS_LIMIT_NOT_DEFINED		UINT64_MAX
+#define SPDK_BDEV_QOS_GRANTS_PER_TIMESLICE	16
+
+#define SPDK_BDEV_SLO_INTERVAL_IN_USEC		10000
+#define SPDK_BDEV_SLO_MAX_INTERVALS		10
+#define SPDK_BDEV_SLO_MIN_SAMPLES		32
+#define SPDK_BDEV_SLO_HIST_BUCKETS		64
+#define SPDK_BDEV_SLO_BUCKETS_PER_TARGET	16
+#define SPDK_BDEV_SLO_DEFAULT_MAX_QUEUE_DEPTH	256
 
 /* The maximum number of children requests for a UNMAP or WRITE ZEROES command
  * when splitting into children requests at a time.
@@ -95,7 +104,9 @@ bdev_name_cmp(struct spdk_bdev_name *name1, struct spdk_bdev_name *name2)
 RB_GENERATE_STATIC(bdev_name_tree, spdk_bdev_name, node, bdev_name_cmp);
 
 struct spdk_bdev_mgr {
-	struct spdk_mempool *bdev_io_pool;
+	/* Indexed by NUMA node id, only the first entry is used without per-NUMA pools */
+	struct spdk_mempool *bdev_io_pool[SPDK_CONFIG_MAX_NUMA_NODES];
+	bool bdev_io_pool_numa;
 
 	void *zero_buffer;
 
@@ -111,6 +122,8 @@ struct spdk_bdev_mgr {
 
 	TAILQ_HEAD(, spdk_bdev_open_async_ctx) async_bdev_opens;
 
+	TAILQ_HEAD(, spdk_bdev_qos_group) qos_groups;
+
 #ifdef SPDK_CONFIG_VTUNE
 	__itt_domain	*domain;
 #endif
@@ -123,6 +136,7 @@ static struct spdk_bdev_mgr g_bdev_mgr = {
 	.init_complete = false,
 	.module_init_complete = false,
 	.async_bdev_opens = TAILQ_HEAD_INITIALIZER(g_bdev_mgr.async_bdev_opens),
+	.qos_groups = TAILQ_HEAD_INITIALIZER(g_bdev_mgr.qos_groups),
 };
 
 static void
@@ -156,12 +170,33 @@ static struct spdk_bdev_opts	g_bdev_opts = {
 	.iobuf_large_cache_size = BUF_LARGE_CACHE_SIZE,
 };
 
+/* One out of this many top-level I/Os starts a trace span, 0 disables span tracing */
+static uint32_t			g_bdev_span_sample_rate = 0;
+static uint64_t			g_bdev_span_id = 0;
+
+/* I/O whose submission to its bdev module is currently in progress on this thread */
+static __thread struct spdk_bdev_io *tls_span_io = NULL;
+
 static spdk_bdev_init_cb	g_init_cb_fn = NULL;
 static void			*g_init_cb_arg = NULL;
 
 static spdk_bdev_fini_cb	g_fini_cb_fn = NULL;
 static void			*g_fini_cb_arg = NULL;
 
+/** Quota granted to a bdev channel by a QoS rate limit. */
+struct bdev_qos_quota {
+	/** IOs or bytes granted and not used yet. */
+	int64_t remaining;
+
+	/** IOs or bytes used in the current timeslice. */
+	int64_t used;
+
+	/** Size of the grants in the current timeslice, sized from the use in the previous one.
+	 *  Lightly loaded channels then take little more than they use.
+	 */
+	int64_t grant;
+};
+
 struct spdk_bdev_qos_limit {
 	/** IOs or bytes allowed per second (i.e., 1s). */
 	uint64_t limit;
@@ -179,15 +214,22 @@ struct spdk_bdev_qos_limit {
 	/** Maximum allowed IOs or bytes to be issued in one timeslice (e.g., 1ms). */
 	uint32_t max_per_timeslice;
 
+	/** Most IOs or bytes a channel takes from remaining_this_timeslice at once. The channel
+	 *  consumes them locally, so most IOs don't touch the shared counter.
+	 */
+	uint32_t quota_per_grant;
+
 	/** Function to check whether to queue the IO.
-	 * If The IO is allowed to pass, the quota will be reduced correspondingly.
+	 * If The IO is allowed to pass, the channel's quota will be reduced correspondingly.
 	 */
-	bool (*queue_io)(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io);
+	bool (*queue_io)(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			 struct spdk_bdev_io *io);
 
-	/** Function to rewind the quota once the IO was allowed to be sent by this
+	/** Function to rewind the channel's quota once the IO was allowed to be sent by this
 	 * limit but queued due to one of the further limits.
 	 */
-	void (*rewind_quota)(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io);
+	void (*rewind_quota)(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			     struct spdk_bdev_io *io);
 };
 
 struct spdk_bdev_qos {
@@ -206,8 +248,70 @@ struct spdk_bdev_qos {
 	/** Timestamp of start of last timeslice. */
 	uint64_t last_timeslice;
 
+	/** Number of timeslices started so far. Grants taken in earlier timeslices expire. */
+	uint64_t timeslice_id;
+
 	/** Poller that processes queued I/O commands each time slice. */
 	struct spdk_poller *poller;
+
+	/** QoS group the bdev is a member of. */
+	struct spdk_bdev_qos_group *group;
+};
+
+struct spdk_bdev_qos_group_limit {
+	/** IOs or bytes allowed per second (i.e., 1s) by the group's own limit. */
+	uint64_t limit;
+
+	/** IOs or bytes allowed in the current timeslice by the group's own limit and its
+	 *  share of the parent's limit. 0 if neither is defined.
+	 */
+	uint64_t alloc_per_timeslice;
+
+	/** Remaining IOs or bytes allowed in current timeslice. Allowed to run negative,
+	 *  like for the bdev rate limits.
+	 */
+	int64_t remaining_this_timeslice;
+};
+
+struct spdk_bdev_qos_group {
+	char				*name;
+
+	/** Top-level group whose limits are shared between this group and its siblings. */
+	struct spdk_bdev_qos_group	*parent;
+
+	/** Share of the parent's limits relative to the siblings. */
+	uint32_t			weight;
+
+	struct spdk_bdev_qos_group_limit rate_limits[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/** Read IOs per second allowed to bypass the limits of the group and its parent. */
+	uint64_t			min_read_ios_per_sec;
+
+	/** Remaining read IOs allowed to bypass the limits in current timeslice. */
+	int64_t				read_reserve_this_timeslice;
+
+	/** Number of member bdevs and child groups, protected by g_bdev_mgr.spinlock. */
+	uint32_t			num_bdevs;
+	uint32_t			num_children;
+
+	/** Usage statistics, updated by the channels of the member bdevs. */
+	uint64_t			num_ios;
+	uint64_t			bytes;
+	uint64_t			num_reserved_reads;
+
+	/** Set when an IO was queued by the group's limits in current timeslice. */
+	bool				throttled;
+
+	/** num_ios at the start of current timeslice. */
+	uint64_t			prev_num_ios;
+
+	/** Poller of a top-level group, refilling the quota of the group and its children. */
+	struct spdk_poller		*poller;
+
+	/** Timestamp of start of last timeslice. */
+	uint64_t			last_timeslice;
+
+	TAILQ_ENTRY(spdk_bdev_qos_group) link;
 };
 
 struct spdk_bdev_mgmt_channel {
@@ -221,6 +325,13 @@ struct spdk_bdev_mgmt_channel {
 	bdev_io_stailq_t per_thread_cache;
 	uint32_t	per_thread_cache_count;
 	uint32_t	bdev_io_cache_size;
+	/*
+	 * While set, freed bdev_io stay in the cache even if it is full, as the caller may still
+	 *  follow their links.
+	 */
+	uint32_t	defer_flush;
+
+	struct spdk_bdev_io_cache_stats stats;
 
 	struct spdk_iobuf_channel iobuf;
 
@@ -274,6 +385,29 @@ struct spdk_bdev_shared_resource {
 #define BDEV_CH_RESET_IN_PROGRESS	(1 << 0)
 #define BDEV_CH_QOS_ENABLED		(1 << 1)
 
+/*
+ * Per channel state of the latency SLO controller.  Completion latencies are sampled into a
+ * histogram whose buckets are 1/SPDK_BDEV_SLO_BUCKETS_PER_TARGET of the target latency, and
+ * at the end of each window the p99 latency of that window is used to adjust the queue depth
+ * limit of the channel.
+ */
+struct bdev_latency_slo {
+	uint64_t		target_ticks;
+	uint64_t		interval_ticks;
+	uint32_t		queue_depth_limit;
+	uint32_t		max_queue_depth;
+
+	/* Peak number of outstanding I/O seen in the current window */
+	uint32_t		peak_outstanding;
+	uint32_t		window_ios;
+	uint64_t		window_start;
+	uint32_t		latency_hist[SPDK_BDEV_SLO_HIST_BUCKETS];
+
+	/* p99 latency of the last complete window */
+	uint64_t		p99_ticks;
+	uint64_t		num_throttled;
+};
+
 struct spdk_bdev_channel {
 	struct spdk_bdev	*bdev;
 
@@ -320,6 +454,18 @@ struct spdk_bdev_channel {
 
 	struct spdk_histogram_data *histogram;
 
+	/* Histograms for each I/O type and size class, NULL unless enabled on the bdev */
+	struct spdk_bdev_io_class_histograms *io_class_histograms;
+
+	/* Latency SLO controller state, NULL if no SLO is set on the bdev */
+	struct bdev_latency_slo	*latency_slo;
+
+	/* I/Os held back because the channel is at its latency SLO queue depth limit */
+	bdev_io_tailq_t		latency_slo_queued_io;
+
+	/* Top-level I/Os submitted since the last one that started a trace span */
+	uint32_t		span_sample_count;
+
 #ifdef SPDK_CONFIG_VTUNE
 	uint64_t		start_tsc;
 	uint64_t		interval_tsc;
@@ -331,6 +477,12 @@ struct spdk_bdev_channel {
 
 	/** List of I/Os queued by QoS. */
 	bdev_io_tailq_t		qos_queued_io;
+
+	/** Quota granted to this channel by each QoS rate limit. */
+	struct bdev_qos_quota	qos_quota[SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES];
+
+	/** QoS timeslice in which qos_quota was granted. */
+	uint64_t		qos_quota_timeslice_id;
 };
 
 struct media_event_entry {
@@ -375,6 +527,9 @@ struct set_qos_limit_ctx {
 	void (*cb_fn)(void *cb_arg, int status);
 	void *cb_arg;
 	struct spdk_bdev *bdev;
+	/* QoS group joined or left by the bdev */
+	struct spdk_bdev_qos_group *join_group;
+	struct spdk_bdev_qos_group *leave_group;
 };
 
 struct spdk_bdev_channel_iter {
@@ -415,6 +570,9 @@ static void bdev_write_zero_buffer(void *bdev_io);
 static void bdev_enable_qos_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
 				struct spdk_io_channel *ch, void *_ctx);
 static void bdev_enable_qos_done(struct spdk_bdev *bdev, void *_ctx, int status);
+static void bdev_qos_group_put(struct spdk_bdev_qos_group *group);
+static void bdev_qos_groups_config_json(struct spdk_json_write_ctx *w);
+static void bdev_qos_groups_free(void);
 
 static int bdev_readv_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 				     struct iovec *iov, int iovcnt, void *md_buf, uint64_t offset_blocks,
@@ -1252,9 +1410,13 @@ static void
 bdev_io_get_buf_complete(struct spdk_bdev_io *bdev_io, bool status)
 {
 	struct spdk_io_channel *ch = spdk_bdev_io_get_io_channel(bdev_io);
+	struct spdk_bdev_io *prev_span_io = tls_span_io;
 
 	assert(bdev_io->internal.get_buf_cb != NULL);
+	/* Modules often submit their child I/Os from this callback */
+	tls_span_io = bdev_io;
 	bdev_io->internal.get_buf_cb(ch, bdev_io, status);
+	tls_span_io = prev_span_io;
 	bdev_io->internal.get_buf_cb = NULL;
 }
 
@@ -1637,6 +1799,8 @@ static inline void
 bdev_submit_request(struct spdk_bdev *bdev, struct spdk_io_channel *ioch,
 		    struct spdk_bdev_io *bdev_io)
 {
+	struct spdk_bdev_io *prev_span_io;
+
 	/* After a request is submitted to a bdev module, the ownership of an accel sequence
 	 * associated with that bdev_io is transferred to the bdev module. So, clear the internal
 	 * sequence pointer to make sure we won't touch it anymore. */
@@ -1654,7 +1818,122 @@ bdev_submit_request(struct spdk_bdev *bdev, struct spdk_io_channel *ioch,
 	       ((bdev_io->u.bdev.dif_check_flags & bdev->dif_check_flags) ==
 		bdev_io->u.bdev.dif_check_flags));
 
+	/* The I/Os the module submits from here join the span of this I/O, if it was sampled */
+	prev_span_io = tls_span_io;
+	tls_span_io = bdev_io;
 	bdev->fn_table->submit_request(ioch, bdev_io);
+	tls_span_io = prev_span_io;
+}
+
+static struct bdev_latency_slo *
+bdev_latency_slo_alloc(uint64_t target_latency_us, uint32_t max_queue_depth)
+{
+	struct bdev_latency_slo *slo;
+	uint64_t ticks_hz = spdk_get_ticks_hz();
+
+	slo = calloc(1, sizeof(*slo));
+	if (slo == NULL) {
+		return NULL;
+	}
+
+	slo->target_ticks = spdk_max(target_latency_us * ticks_hz / SPDK_SEC_TO_USEC, 1);
+	slo->interval_ticks = SPDK_BDEV_SLO_INTERVAL_IN_USEC * ticks_hz / SPDK_SEC_TO_USEC;
+	slo->max_queue_depth = max_queue_depth;
+	slo->queue_depth_limit = max_queue_depth;
+	slo->window_start = spdk_get_ticks();
+
+	return slo;
+}
+
+static inline bool
+bdev_latency_slo_throttled(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_io)
+{
+	struct bdev_latency_slo *slo = bdev_ch->latency_slo;
+
+	if (spdk_likely(slo == NULL)) {
+		return false;
+	}
+
+	if (bdev_io->type != SPDK_BDEV_IO_TYPE_READ && bdev_io->type != SPDK_BDEV_IO_TYPE_WRITE) {
+		return false;
+	}
+
+	/* Keep the ordering behind the I/Os that are already held back */
+	return !TAILQ_EMPTY(&bdev_ch->latency_slo_queued_io) ||
+	       bdev_ch->io_outstanding >= slo->queue_depth_limit;
+}
+
+static inline void
+bdev_latency_slo_stamp(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_io)
+{
+	if (spdk_unlikely(bdev_ch->latency_slo != NULL)) {
+		/* 0 means that the I/O was not stamped, so keep the lowest bit always set */
+		bdev_io->internal.slo_submit_tsc = (uint32_t)spdk_get_ticks() | 1;
+	}
+}
+
+static void
+bdev_latency_slo_end_window(struct bdev_latency_slo *slo, uint64_t now)
+{
+	uint32_t p99_count, count = 0, bucket, limit = slo->queue_depth_limit;
+
+	/* Find the bucket that holds the 99th percentile of the window */
+	p99_count = slo->window_ios - slo->window_ios / 100;
+	for (bucket = 0; bucket < SPDK_BDEV_SLO_HIST_BUCKETS - 1; bucket++) {
+		count += slo->latency_hist[bucket];
+		if (count >= p99_count) {
+			break;
+		}
+	}
+
+	slo->p99_ticks = (bucket + 1) * slo->target_ticks / SPDK_BDEV_SLO_BUCKETS_PER_TARGET;
+
+	if (bucket >= SPDK_BDEV_SLO_BUCKETS_PER_TARGET) {
+		/* The target was missed.  Scale the queue depth that was actually used by the
+		 * ratio of the target to the observed latency, but do not cut it by more than half.
+		 */
+		limit = spdk_min(limit, slo->peak_outstanding) * SPDK_BDEV_SLO_BUCKETS_PER_TARGET /
+			(bucket + 1);
+		limit = spdk_max(limit, slo->queue_depth_limit / 2);
+		slo->queue_depth_limit = spdk_max(limit, 1);
+	} else if (slo->peak_outstanding >= limit) {
+		/* The target was met while the limit was in use, probe for a higher queue depth */
+		limit += spdk_u32log2(limit) + 1;
+		slo->queue_depth_limit = spdk_min(limit, slo->max_queue_depth);
+	}
+
+	slo->window_start = now;
+	slo->window_ios = 0;
+	slo->peak_outstanding = 0;
+	memset(slo->latency_hist, 0, sizeof(slo->latency_hist));
+}
+
+static inline void
+bdev_latency_slo_sample(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_io)
+{
+	struct bdev_latency_slo *slo = bdev_ch->latency_slo;
+	uint64_t now, elapsed, bucket;
+	uint32_t latency;
+
+	if (spdk_likely(slo == NULL) || bdev_io->internal.slo_submit_tsc == 0) {
+		return;
+	}
+
+	now = spdk_get_ticks();
+	latency = (uint32_t)now - bdev_io->internal.slo_submit_tsc;
+	bdev_io->internal.slo_submit_tsc = 0;
+
+	bucket = (uint64_t)latency * SPDK_BDEV_SLO_BUCKETS_PER_TARGET / slo->target_ticks;
+	slo->latency_hist[spdk_min(bucket, SPDK_BDEV_SLO_HIST_BUCKETS - 1)]++;
+	slo->window_ios++;
+	/* This I/O was already removed from io_outstanding */
+	slo->peak_outstanding = spdk_max(slo->peak_outstanding, bdev_ch->io_outstanding + 1);
+
+	elapsed = now - slo->window_start;
+	if ((elapsed >= slo->interval_ticks && slo->window_ios >= SPDK_BDEV_SLO_MIN_SAMPLES) ||
+	    elapsed >= slo->interval_ticks * SPDK_BDEV_SLO_MAX_INTERVALS) {
+		bdev_latency_slo_end_window(slo, now);
+	}
 }
 
 static inline void
@@ -1663,6 +1942,7 @@ bdev_ch_resubmit_io(struct spdk_bdev_shared_resource *shared_resource, struct sp
 	struct spdk_bdev *bdev = bdev_io->bdev;
 
 	bdev_io_increment_outstanding(bdev_io->internal.ch, shared_resource);
+	bdev_latency_slo_stamp(bdev_io->internal.ch, bdev_io);
 	bdev_io->internal.error.nvme.cdw0 = 0;
 	bdev_io->num_retries++;
 	bdev_submit_request(bdev, spdk_bdev_io_get_io_channel(bdev_io), bdev_io);
@@ -2102,6 +2382,9 @@ bdev_enable_histogram_config_json(struct spdk_bdev *bdev, struct spdk_json_write
 	spdk_json_write_named_string(w, "name", bdev->name);
 
 	spdk_json_write_named_bool(w, "enable", bdev->internal.histogram_enabled);
+	if (bdev->internal.histogram_per_io_class) {
+		spdk_json_write_named_bool(w, "per_io_class", true);
+	}
 
 	if (bdev->internal.histogram_io_type) {
 		spdk_json_write_named_string(w, "opc",
@@ -2113,6 +2396,45 @@ bdev_enable_histogram_config_json(struct spdk_bdev *bdev, struct spdk_json_write
 	spdk_json_write_object_end(w);
 }
 
+static void
+bdev_latency_slo_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	if (bdev->internal.latency_slo_target_us == 0) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "bdev_set_latency_slo");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_string(w, "name", bdev->name);
+	spdk_json_write_named_uint64(w, "target_latency_us", bdev->internal.latency_slo_target_us);
+	spdk_json_write_named_uint32(w, "max_queue_depth",
+				     bdev->internal.latency_slo_max_queue_depth);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
+static void
+bdev_span_sample_rate_config_json(struct spdk_json_write_ctx *w)
+{
+	uint32_t sample_rate = spdk_bdev_get_span_sample_rate();
+
+	if (sample_rate == 0) {
+		return;
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "method", "bdev_set_span_sample_rate");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_uint32(w, "sample_rate", sample_rate);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+}
+
 static void
 bdev_qos_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 {
@@ -2126,19 +2448,39 @@ bdev_qos_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
 
 	spdk_bdev_get_qos_rate_limits(bdev, limits);
 
-	spdk_json_write_object_begin(w);
-	spdk_json_write_named_string(w, "method", "bdev_set_qos_limit");
-
-	spdk_json_write_named_object_begin(w, "params");
-	spdk_json_write_named_string(w, "name", bdev->name);
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 		if (limits[i] > 0) {
-			spdk_json_write_named_uint64(w, qos_rpc_type[i], limits[i]);
+			break;
 		}
 	}
-	spdk_json_write_object_end(w);
 
-	spdk_json_write_object_end(w);
+	if (i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_set_qos_limit");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", bdev->name);
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			if (limits[i] > 0) {
+				spdk_json_write_named_uint64(w, qos_rpc_type[i], limits[i]);
+			}
+		}
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+
+	if (qos->group != NULL) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_qos_group_add_bdev");
+
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "name", qos->group->name);
+		spdk_json_write_named_string(w, "bdev_name", bdev->name);
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_object_end(w);
+	}
 }
 
 void
@@ -2163,6 +2505,8 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_object_end(w);
 
 	bdev_examine_allowlist_config_json(w);
+	bdev_qos_groups_config_json(w);
+	bdev_span_sample_rate_config_json(w);
 
 	TAILQ_FOREACH(bdev_module, &g_bdev_mgr.bdev_modules, internal.tailq) {
 		if (bdev_module->config_json) {
@@ -2179,6 +2523,7 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 
 		bdev_qos_config_json(bdev, w);
 		bdev_enable_histogram_config_json(bdev, w);
+		bdev_latency_slo_config_json(bdev, w);
 	}
 
 	spdk_spin_unlock(&g_bdev_mgr.spinlock);
@@ -2191,6 +2536,72 @@ spdk_bdev_subsystem_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_array_end(w);
 }
 
+#define BDEV_IO_POOL_FOREACH_NUMA_ID(i)							\
+	for (i = g_bdev_mgr.bdev_io_pool_numa ? spdk_env_get_first_numa_id() : 0;	\
+	     i < INT32_MAX;								\
+	     i = g_bdev_mgr.bdev_io_pool_numa ? spdk_env_get_next_numa_id(i) : INT32_MAX)
+
+static struct spdk_mempool *
+bdev_io_pool_get_local(void)
+{
+	int32_t numa_id;
+
+	if (!g_bdev_mgr.bdev_io_pool_numa) {
+		return g_bdev_mgr.bdev_io_pool[0];
+	}
+
+	numa_id = spdk_env_get_numa_id(spdk_env_get_current_core());
+	if (numa_id < 0 || numa_id >= SPDK_CONFIG_MAX_NUMA_NODES ||
+	    g_bdev_mgr.bdev_io_pool[numa_id] == NULL) {
+		/* Not a reactor thread, any pool will do */
+		numa_id = spdk_env_get_first_numa_id();
+	}
+
+	return g_bdev_mgr.bdev_io_pool[numa_id];
+}
+
+static inline struct spdk_mempool *
+bdev_io_pool_get(struct spdk_bdev_io *bdev_io)
+{
+	int32_t numa_id;
+
+	if (!g_bdev_mgr.bdev_io_pool_numa) {
+		return g_bdev_mgr.bdev_io_pool[0];
+	}
+
+	/* Each pool is allocated from the memory of its own NUMA node */
+	numa_id = spdk_mem_get_numa_id(bdev_io, NULL);
+	if (spdk_unlikely(numa_id < 0 || numa_id >= SPDK_CONFIG_MAX_NUMA_NODES ||
+			  g_bdev_mgr.bdev_io_pool[numa_id] == NULL)) {
+		/* Node unknown, e.g. SPDK_ENV_NUMA_ID_ANY, fall back to the first pool */
+		numa_id = spdk_env_get_first_numa_id();
+	}
+
+	return g_bdev_mgr.bdev_io_pool[numa_id];
+}
+
+/* Return bdev_io to the pools they were taken from.  The cache of a thread that was moved to
+ * another NUMA node holds bdev_io from the pools of both nodes until they are all cycled.
+ */
+static void
+bdev_io_pool_put_bulk(struct spdk_bdev_io **bdev_ios, uint32_t count)
+{
+	struct spdk_mempool *pool, *next;
+	uint32_t i, start = 0;
+
+	pool = bdev_io_pool_get(bdev_ios[0]);
+	for (i = 1; i < count; i++) {
+		next = bdev_io_pool_get(bdev_ios[i]);
+		if (next != pool) {
+			spdk_mempool_put_bulk(pool, (void **)&bdev_ios[start], i - start);
+			pool = next;
+			start = i;
+		}
+	}
+
+	spdk_mempool_put_bulk(pool, (void **)&bdev_ios[start], count - start);
+}
+
 static void
 bdev_mgmt_channel_destroy(void *io_device, void *ctx_buf)
 {
@@ -2205,13 +2616,13 @@ bdev_mgmt_channel_destroy(void *io_device, void *ctx_buf)
 		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
 		ch->per_thread_cache_count--;
 		if (count == BDEV_IO_BATCH_SIZE) {
-			spdk_mempool_put_bulk(g_bdev_mgr.bdev_io_pool, (void **)bdev_ios, count);
+			bdev_io_pool_put_bulk(bdev_ios, count);
 			count = 0;
 		}
 	}
 
 	if (count > 0) {
-		spdk_mempool_put_bulk(g_bdev_mgr.bdev_io_pool, (void **)bdev_ios, count);
+		bdev_io_pool_put_bulk(bdev_ios, count);
 	}
 
 	assert(ch->per_thread_cache_count == 0);
@@ -2235,12 +2646,13 @@ bdev_mgmt_channel_create(void *io_device, void *ctx_buf)
 
 	STAILQ_INIT(&ch->per_thread_cache);
 	remaining = ch->bdev_io_cache_size = g_bdev_opts.bdev_io_cache_size;
+	memset(&ch->stats, 0, sizeof(ch->stats));
 
 	/* Pre-populate bdev_io cache to ensure this thread cannot be starved. */
 	ch->per_thread_cache_count = 0;
 	while (remaining > 0) {
 		count = spdk_min(remaining, BDEV_IO_BATCH_SIZE);
-		rc = spdk_mempool_get_bulk(g_bdev_mgr.bdev_io_pool, (void **)bdev_ios, count);
+		rc = spdk_mempool_get_bulk(bdev_io_pool_get_local(), (void **)bdev_ios, count);
 		if (rc) {
 			SPDK_ERRLOG("You need to increase bdev_io_pool_size using bdev_set_options RPC.\n");
 			assert(false);
@@ -2404,7 +2816,9 @@ bdev_modules_init(void)
 void
 spdk_bdev_initialize(spdk_bdev_init_cb cb_fn, void *cb_arg)
 {
+	struct spdk_iobuf_opts iobuf_opts;
 	int rc = 0;
+	int32_t numa_id;
 	char mempool_name[32];
 
 	assert(cb_fn != NULL);
@@ -2417,8 +2831,6 @@ spdk_bdev_initialize(spdk_bdev_init_cb cb_fn, void *cb_arg)
 	spdk_notify_type_register("bdev_unregister");
 	spdk_notify_type_register("bdev_resize");
 
-	snprintf(mempool_name, sizeof(mempool_name), "bdev_io_%d", getpid());
-
 	rc = spdk_iobuf_register_module("bdev");
 	if (rc != 0) {
 		SPDK_ERRLOG("could not register bdev iobuf module: %s\n", spdk_strerror(-rc));
@@ -2426,17 +2838,31 @@ spdk_bdev_initialize(spdk_bdev_init_cb cb_fn, void *cb_arg)
 		return;
 	}
 
-	g_bdev_mgr.bdev_io_pool = spdk_mempool_create(mempool_name,
-				  g_bdev_opts.bdev_io_pool_size,
-				  sizeof(struct spdk_bdev_io) +
-				  bdev_module_get_max_ctx_size(),
-				  0,
-				  SPDK_ENV_NUMA_ID_ANY);
+	/* Follow iobuf in keeping a separate pool of bdev_io on each NUMA node */
+	spdk_iobuf_get_opts(&iobuf_opts, sizeof(iobuf_opts));
+	g_bdev_mgr.bdev_io_pool_numa = iobuf_opts.enable_numa;
 
-	if (g_bdev_mgr.bdev_io_pool == NULL) {
-		SPDK_ERRLOG("could not allocate spdk_bdev_io pool\n");
-		bdev_init_complete(-1);
-		return;
+	BDEV_IO_POOL_FOREACH_NUMA_ID(numa_id) {
+		if (g_bdev_mgr.bdev_io_pool_numa) {
+			snprintf(mempool_name, sizeof(mempool_name), "bdev_io_%d_%d", getpid(),
+				 numa_id);
+		} else {
+			snprintf(mempool_name, sizeof(mempool_name), "bdev_io_%d", getpid());
+		}
+
+		g_bdev_mgr.bdev_io_pool[numa_id] = spdk_mempool_create(mempool_name,
+						   g_bdev_opts.bdev_io_pool_size,
+						   sizeof(struct spdk_bdev_io) +
+						   bdev_module_get_max_ctx_size(),
+						   0,
+						   g_bdev_mgr.bdev_io_pool_numa ? numa_id :
+						   SPDK_ENV_NUMA_ID_ANY);
+
+		if (g_bdev_mgr.bdev_io_pool[numa_id] == NULL) {
+			SPDK_ERRLOG("could not allocate spdk_bdev_io pool\n");
+			bdev_init_complete(-1);
+			return;
+		}
 	}
 
 	g_bdev_mgr.zero_buffer = spdk_zmalloc(ZERO_BUFFER_SIZE, ZERO_BUFFER_SIZE,
@@ -2471,21 +2897,29 @@ bdev_finish_complete(void *not_used)
 {
 	spdk_bdev_fini_cb cb_fn = g_fini_cb_fn;
 	void *cb_arg = g_fini_cb_arg;
+	struct spdk_mempool *pool;
+	int32_t numa_id;
 
 	assert(spdk_thread_is_app_thread(NULL));
 
-	if (g_bdev_mgr.bdev_io_pool) {
-		if (spdk_mempool_count(g_bdev_mgr.bdev_io_pool) != g_bdev_opts.bdev_io_pool_size) {
+	BDEV_IO_POOL_FOREACH_NUMA_ID(numa_id) {
+		pool = g_bdev_mgr.bdev_io_pool[numa_id];
+		if (pool == NULL) {
+			continue;
+		}
+
+		if (spdk_mempool_count(pool) != g_bdev_opts.bdev_io_pool_size) {
 			SPDK_ERRLOG("bdev IO pool count is %zu but should be %u\n",
-				    spdk_mempool_count(g_bdev_mgr.bdev_io_pool),
-				    g_bdev_opts.bdev_io_pool_size);
+				    spdk_mempool_count(pool), g_bdev_opts.bdev_io_pool_size);
 		}
 
-		spdk_mempool_free(g_bdev_mgr.bdev_io_pool);
+		spdk_mempool_free(pool);
+		g_bdev_mgr.bdev_io_pool[numa_id] = NULL;
 	}
 
 	spdk_free(g_bdev_mgr.zero_buffer);
 	bdev_examine_allowlist_free();
+	bdev_qos_groups_free();
 	g_fini_cb_fn = NULL;
 	g_fini_cb_arg = NULL;
 	cb_fn(cb_arg);
@@ -2684,6 +3118,78 @@ spdk_bdev_finish(spdk_bdev_fini_cb cb_fn, void *cb_arg)
 	}
 }
 
+static struct spdk_bdev_io *
+bdev_mgmt_channel_refill_io(struct spdk_bdev_mgmt_channel *ch)
+{
+	struct spdk_bdev_io *bdev_ios[BDEV_IO_CACHE_BATCH_SIZE];
+	/* The pool is looked up on each refill, as the thread may have moved to another node */
+	struct spdk_mempool *pool = bdev_io_pool_get_local();
+	uint32_t i, count;
+
+	/* Get a batch of bdev_io at once, so the following allocations hit the cache */
+	count = spdk_min(ch->bdev_io_cache_size, BDEV_IO_CACHE_BATCH_SIZE);
+	if (count > 1 && spdk_mempool_get_bulk(pool, (void **)bdev_ios, count) == 0) {
+		for (i = 1; i < count; i++) {
+			STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_ios[i], internal.buf_link);
+		}
+		ch->per_thread_cache_count += count - 1;
+
+		return bdev_ios[0];
+	}
+
+	/* Not enough bdev_io left in the pool for a whole batch */
+	return spdk_mempool_get(pool);
+}
+
+static void
+bdev_mgmt_channel_flush_io(struct spdk_bdev_mgmt_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_io *bdev_ios[BDEV_IO_CACHE_BATCH_SIZE];
+	uint32_t count = 0, max_count;
+
+	/* Return a batch of bdev_io at once, leaving room in the cache for the following frees */
+	max_count = spdk_min(ch->bdev_io_cache_size, BDEV_IO_CACHE_BATCH_SIZE);
+	bdev_ios[count++] = bdev_io;
+	while (count < max_count) {
+		assert(!STAILQ_EMPTY(&ch->per_thread_cache));
+		bdev_ios[count++] = STAILQ_FIRST(&ch->per_thread_cache);
+		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
+		ch->per_thread_cache_count--;
+	}
+
+	bdev_io_pool_put_bulk(bdev_ios, count);
+}
+
+static void
+bdev_mgmt_channel_defer_flush(struct spdk_bdev_mgmt_channel *ch)
+{
+	ch->defer_flush++;
+}
+
+/* Return the bdev_io which piled up in the cache while the flushes were deferred */
+static void
+bdev_mgmt_channel_resume_flush(struct spdk_bdev_mgmt_channel *ch)
+{
+	struct spdk_bdev_io *bdev_ios[BDEV_IO_CACHE_BATCH_SIZE];
+	uint32_t i, count;
+
+	assert(ch->defer_flush > 0);
+	if (--ch->defer_flush > 0) {
+		return;
+	}
+
+	while (ch->per_thread_cache_count > ch->bdev_io_cache_size) {
+		count = spdk_min(ch->per_thread_cache_count - ch->bdev_io_cache_size,
+				 BDEV_IO_CACHE_BATCH_SIZE);
+		for (i = 0; i < count; i++) {
+			bdev_ios[i] = STAILQ_FIRST(&ch->per_thread_cache);
+			STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
+		}
+		ch->per_thread_cache_count -= count;
+		bdev_io_pool_put_bulk(bdev_ios, count);
+	}
+}
+
 struct spdk_bdev_io *
 bdev_channel_get_io(struct spdk_bdev_channel *channel)
 {
@@ -2694,14 +3200,21 @@ bdev_channel_get_io(struct spdk_bdev_channel *channel)
 		bdev_io = STAILQ_FIRST(&ch->per_thread_cache);
 		STAILQ_REMOVE_HEAD(&ch->per_thread_cache, internal.buf_link);
 		ch->per_thread_cache_count--;
+		ch->stats.cache++;
 	} else if (spdk_unlikely(!TAILQ_EMPTY(&ch->io_wait_queue))) {
 		/*
 		 * Don't try to look for bdev_ios in the global pool if there are
 		 * waiters on bdev_ios - we don't want this caller to jump the line.
 		 */
 		bdev_io = NULL;
+		ch->stats.retry++;
 	} else {
-		bdev_io = spdk_mempool_get(g_bdev_mgr.bdev_io_pool);
+		bdev_io = bdev_mgmt_channel_refill_io(ch);
+		if (spdk_likely(bdev_io != NULL)) {
+			ch->stats.main++;
+		} else {
+			ch->stats.retry++;
+		}
 	}
 
 	return bdev_io;
@@ -2721,7 +3234,7 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 		bdev_io_put_buf(bdev_io);
 	}
 
-	if (ch->per_thread_cache_count < ch->bdev_io_cache_size) {
+	if (ch->per_thread_cache_count < ch->bdev_io_cache_size || ch->defer_flush > 0) {
 		ch->per_thread_cache_count++;
 		STAILQ_INSERT_HEAD(&ch->per_thread_cache, bdev_io, internal.buf_link);
 		while (ch->per_thread_cache_count > 0 && !TAILQ_EMPTY(&ch->io_wait_queue)) {
@@ -2734,35 +3247,83 @@ spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
 	} else {
 		/* We should never have a full cache with entries on the io wait queue. */
 		assert(TAILQ_EMPTY(&ch->io_wait_queue));
-		spdk_mempool_put(g_bdev_mgr.bdev_io_pool, (void *)bdev_io);
+		bdev_mgmt_channel_flush_io(ch, bdev_io);
 	}
 }
 
-static bool
-bdev_qos_is_iops_rate_limit(enum spdk_bdev_qos_rate_limit_type limit)
+struct bdev_io_cache_stats_ctx {
+	struct spdk_bdev_io_cache_stats	stats;
+	spdk_bdev_get_io_cache_stats_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+bdev_get_io_cache_stats_done(struct spdk_io_channel_iter *i, int status)
 {
-	assert(limit != SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES);
+	struct bdev_io_cache_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
 
-	switch (limit) {
-	case SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT:
-		return true;
-	case SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT:
-	case SPDK_BDEV_QOS_R_BPS_RATE_LIMIT:
-	case SPDK_BDEV_QOS_W_BPS_RATE_LIMIT:
-		return false;
-	case SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES:
-	default:
-		return false;
-	}
+	ctx->cb_fn(&ctx->stats, ctx->cb_arg);
+	free(ctx);
 }
 
-static bool
-bdev_qos_io_to_limit(struct spdk_bdev_io *bdev_io)
+static void
+bdev_get_io_cache_stats_channel(struct spdk_io_channel_iter *i)
 {
-	switch (bdev_io->type) {
-	case SPDK_BDEV_IO_TYPE_NVME_IO:
-	case SPDK_BDEV_IO_TYPE_NVME_IO_MD:
-	case SPDK_BDEV_IO_TYPE_READ:
+	struct bdev_io_cache_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bdev_mgmt_channel *ch = spdk_io_channel_get_ctx(_ch);
+
+	ctx->stats.cache += ch->stats.cache;
+	ctx->stats.main += ch->stats.main;
+	ctx->stats.retry += ch->stats.retry;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+int
+spdk_bdev_get_io_cache_stats(spdk_bdev_get_io_cache_stats_cb cb_fn, void *cb_arg)
+{
+	struct bdev_io_cache_stats_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_for_each_channel(&g_bdev_mgr, bdev_get_io_cache_stats_channel, ctx,
+			      bdev_get_io_cache_stats_done);
+
+	return 0;
+}
+
+static bool
+bdev_qos_is_iops_rate_limit(enum spdk_bdev_qos_rate_limit_type limit)
+{
+	assert(limit != SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES);
+
+	switch (limit) {
+	case SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT:
+		return true;
+	case SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT:
+	case SPDK_BDEV_QOS_R_BPS_RATE_LIMIT:
+	case SPDK_BDEV_QOS_W_BPS_RATE_LIMIT:
+		return false;
+	case SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES:
+	default:
+		return false;
+	}
+}
+
+static bool
+bdev_qos_io_to_limit(struct spdk_bdev_io *bdev_io)
+{
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_NVME_IO:
+	case SPDK_BDEV_IO_TYPE_NVME_IO_MD:
+	case SPDK_BDEV_IO_TYPE_READ:
 	case SPDK_BDEV_IO_TYPE_WRITE:
 		return true;
 	case SPDK_BDEV_IO_TYPE_ZCOPY:
@@ -2828,99 +3389,126 @@ bdev_get_io_size_in_byte(struct spdk_bdev_io *bdev_io)
 }
 
 static inline bool
-bdev_qos_rw_queue_io(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io, uint64_t delta)
+bdev_qos_rw_queue_io(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		     struct spdk_bdev_io *io, uint64_t delta)
 {
-	int64_t remaining_this_timeslice;
+	int64_t remaining_this_timeslice, grant;
 
 	if (!limit->max_per_timeslice) {
 		/* The QoS is disabled */
 		return false;
 	}
 
-	remaining_this_timeslice = __atomic_sub_fetch(&limit->remaining_this_timeslice, delta,
-				   __ATOMIC_RELAXED);
-	if (remaining_this_timeslice + (int64_t)delta > 0) {
-		/* There was still a quota for this delta -> the IO shouldn't be queued
-		 *
-		 * We allow a slight quota overrun here so an IO bigger than the per-timeslice
-		 * quota can be allowed once a while. Such overrun then taken into account in
-		 * the QoS poller, where the next timeslice quota is calculated.
-		 */
+	if (quota->remaining >= (int64_t)delta) {
+		/* The channel was already granted enough quota */
+		quota->remaining -= delta;
+		quota->used += delta;
 		return false;
 	}
 
-	/* There was no quota for this delta -> the IO should be queued
-	 * The remaining_this_timeslice must be rewinded so it reflects the real
-	 * amount of IOs or bytes allowed.
+	/* Take a grant from the quota shared by all the channels. Take what this channel used
+	 * in the previous timeslice, so that its following IOs don't need to touch the shared
+	 * counter, but no more than a fraction of what is left.  Channels which don't use their
+	 * grants then can't hold the quota away from the others.
 	 */
-	__atomic_add_fetch(
-		&limit->remaining_this_timeslice, delta, __ATOMIC_RELAXED);
-	return true;
+	remaining_this_timeslice = __atomic_load_n(&limit->remaining_this_timeslice,
+				   __ATOMIC_RELAXED);
+	do {
+		if (remaining_this_timeslice <= 0) {
+			/* There was no quota for this delta -> the IO should be queued */
+			return true;
+		}
+
+		/* We allow a slight quota overrun here so an IO bigger than the per-timeslice
+		 * quota can be allowed once a while. Such overrun then taken into account in
+		 * the QoS poller, where the next timeslice quota is calculated.
+		 */
+		grant = spdk_min(quota->grant,
+				 remaining_this_timeslice / SPDK_BDEV_QOS_GRANTS_PER_TIMESLICE);
+		grant = spdk_max((int64_t)delta - quota->remaining, grant);
+	} while (!__atomic_compare_exchange_n(&limit->remaining_this_timeslice,
+					      &remaining_this_timeslice,
+					      remaining_this_timeslice - grant, true,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	quota->remaining += grant - delta;
+	quota->used += delta;
+	return false;
 }
 
 static inline void
-bdev_qos_rw_rewind_io(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io, uint64_t delta)
+bdev_qos_rw_rewind_io(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		      struct spdk_bdev_io *io, uint64_t delta)
 {
-	__atomic_add_fetch(&limit->remaining_this_timeslice, delta, __ATOMIC_RELAXED);
+	quota->remaining += delta;
+	quota->used -= delta;
 }
 
 static bool
-bdev_qos_rw_iops_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_iops_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		       struct spdk_bdev_io *io)
 {
-	return bdev_qos_rw_queue_io(limit, io, 1);
+	return bdev_qos_rw_queue_io(limit, quota, io, 1);
 }
 
 static void
-bdev_qos_rw_iops_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_iops_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			      struct spdk_bdev_io *io)
 {
-	bdev_qos_rw_rewind_io(limit, io, 1);
+	bdev_qos_rw_rewind_io(limit, quota, io, 1);
 }
 
 static bool
-bdev_qos_rw_bps_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_bps_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		      struct spdk_bdev_io *io)
 {
-	return bdev_qos_rw_queue_io(limit, io, bdev_get_io_size_in_byte(io));
+	return bdev_qos_rw_queue_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 }
 
 static void
-bdev_qos_rw_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_rw_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			     struct spdk_bdev_io *io)
 {
-	bdev_qos_rw_rewind_io(limit, io, bdev_get_io_size_in_byte(io));
+	bdev_qos_rw_rewind_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 }
 
 static bool
-bdev_qos_r_bps_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_r_bps_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		     struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) == false) {
 		return false;
 	}
 
-	return bdev_qos_rw_bps_queue(limit, io);
+	return bdev_qos_rw_bps_queue(limit, quota, io);
 }
 
 static void
-bdev_qos_r_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_r_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			    struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) != false) {
-		bdev_qos_rw_rewind_io(limit, io, bdev_get_io_size_in_byte(io));
+		bdev_qos_rw_rewind_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 	}
 }
 
 static bool
-bdev_qos_w_bps_queue(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_w_bps_queue(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+		     struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) == true) {
 		return false;
 	}
 
-	return bdev_qos_rw_bps_queue(limit, io);
+	return bdev_qos_rw_bps_queue(limit, quota, io);
 }
 
 static void
-bdev_qos_w_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct spdk_bdev_io *io)
+bdev_qos_w_bps_rewind_quota(struct spdk_bdev_qos_limit *limit, struct bdev_qos_quota *quota,
+			    struct spdk_bdev_io *io)
 {
 	if (bdev_is_read_io(io) != true) {
-		bdev_qos_rw_rewind_io(limit, io, bdev_get_io_size_in_byte(io));
+		bdev_qos_rw_rewind_io(limit, quota, io, bdev_get_io_size_in_byte(io));
 	}
 }
 
@@ -2970,17 +3558,39 @@ _bdev_io_complete_in_submit(struct spdk_bdev_channel *bdev_ch,
 }
 
 static inline void
-bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_io)
+_bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_io)
 {
 	struct spdk_bdev *bdev = bdev_io->bdev;
 	struct spdk_io_channel *ch = bdev_ch->channel;
 	struct spdk_bdev_shared_resource *shared_resource = bdev_ch->shared_resource;
 
+	if (spdk_likely(TAILQ_EMPTY(&shared_resource->nomem_io))) {
+		bdev_io_increment_outstanding(bdev_ch, shared_resource);
+		bdev_latency_slo_stamp(bdev_ch, bdev_io);
+		bdev_io->internal.f.in_submit_request = true;
+		bdev_submit_request(bdev, ch, bdev_io);
+		bdev_io->internal.f.in_submit_request = false;
+	} else {
+		bdev_queue_nomem_io_tail(shared_resource, bdev_io, BDEV_IO_RETRY_STATE_SUBMIT);
+		if (shared_resource->nomem_threshold == 0 && shared_resource->io_outstanding == 0) {
+			/* Special case when we have nomem IOs and no outstanding IOs which completions
+			 * could trigger retry of queued IOs */
+			bdev_shared_ch_retry_io(shared_resource);
+		}
+	}
+}
+
+static inline void
+bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_shared_resource *shared_resource = bdev_ch->shared_resource;
+
 	if (spdk_unlikely(bdev_io->type == SPDK_BDEV_IO_TYPE_ABORT)) {
 		struct spdk_bdev_mgmt_channel *mgmt_channel = shared_resource->mgmt_ch;
 		struct spdk_bdev_io *bio_to_abort = bdev_io->u.abort.bio_to_abort;
 
 		if (bdev_abort_queued_io(&shared_resource->nomem_io, bio_to_abort) ||
+		    bdev_abort_queued_io(&bdev_ch->latency_slo_queued_io, bio_to_abort) ||
 		    bdev_abort_buf_io(mgmt_channel, bio_to_abort)) {
 			_bdev_io_complete_in_submit(bdev_ch, bdev_io,
 						    SPDK_BDEV_IO_STATUS_SUCCESS);
@@ -2990,6 +3600,7 @@ bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_i
 
 	if (spdk_unlikely(bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE &&
 			  bdev_io->bdev->split_on_write_unit &&
+			  !bdev_io->bdev->allow_partial_write_unit &&
 			  bdev_io->u.bdev.num_blocks < bdev_io->bdev->write_unit_size)) {
 		SPDK_ERRLOG("IO num_blocks %lu does not match the write_unit_size %u\n",
 			    bdev_io->u.bdev.num_blocks, bdev_io->bdev->write_unit_size);
@@ -2997,44 +3608,198 @@ bdev_io_do_submit(struct spdk_bdev_channel *bdev_ch, struct spdk_bdev_io *bdev_i
 		return;
 	}
 
-	if (spdk_likely(TAILQ_EMPTY(&shared_resource->nomem_io))) {
-		bdev_io_increment_outstanding(bdev_ch, shared_resource);
-		bdev_io->internal.f.in_submit_request = true;
-		bdev_submit_request(bdev, ch, bdev_io);
-		bdev_io->internal.f.in_submit_request = false;
-	} else {
-		bdev_queue_nomem_io_tail(shared_resource, bdev_io, BDEV_IO_RETRY_STATE_SUBMIT);
-		if (shared_resource->nomem_threshold == 0 && shared_resource->io_outstanding == 0) {
-			/* Special case when we have nomem IOs and no outstanding IOs which completions
-			 * could trigger retry of queued IOs */
-			bdev_shared_ch_retry_io(shared_resource);
+	if (spdk_unlikely(bdev_latency_slo_throttled(bdev_ch, bdev_io))) {
+		bdev_ch->latency_slo->num_throttled++;
+		TAILQ_INSERT_TAIL(&bdev_ch->latency_slo_queued_io, bdev_io, internal.link);
+		return;
+	}
+
+	_bdev_io_do_submit(bdev_ch, bdev_io);
+}
+
+/* Submit the I/Os held back by the latency SLO until the channel reaches its queue depth
+ * limit again.  Without an SLO, all of them are submitted.
+ */
+static void
+bdev_latency_slo_submit_queued_io(struct spdk_bdev_channel *bdev_ch)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	while (!TAILQ_EMPTY(&bdev_ch->latency_slo_queued_io)) {
+		if (bdev_ch->latency_slo != NULL &&
+		    bdev_ch->io_outstanding >= bdev_ch->latency_slo->queue_depth_limit) {
+			break;
+		}
+
+		bdev_io = TAILQ_FIRST(&bdev_ch->latency_slo_queued_io);
+		TAILQ_REMOVE(&bdev_ch->latency_slo_queued_io, bdev_io, internal.link);
+		_bdev_io_do_submit(bdev_ch, bdev_io);
+	}
+}
+
+static uint64_t
+bdev_qos_group_io_delta(int type, struct spdk_bdev_io *bdev_io)
+{
+	switch (type) {
+	case SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT:
+		return 1;
+	case SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT:
+		return bdev_get_io_size_in_byte(bdev_io);
+	case SPDK_BDEV_QOS_R_BPS_RATE_LIMIT:
+		return bdev_is_read_io(bdev_io) ? bdev_get_io_size_in_byte(bdev_io) : 0;
+	case SPDK_BDEV_QOS_W_BPS_RATE_LIMIT:
+		return bdev_is_read_io(bdev_io) ? 0 : bdev_get_io_size_in_byte(bdev_io);
+	default:
+		return 0;
+	}
+}
+
+static void
+bdev_qos_group_rewind_quota(struct spdk_bdev_qos_group *group, struct spdk_bdev_io *bdev_io,
+			    int num_types)
+{
+	struct spdk_bdev_qos_group_limit *limit;
+	uint64_t delta;
+	int i;
+
+	for (i = 0; i < num_types; i++) {
+		limit = &group->rate_limits[i];
+		delta = bdev_qos_group_io_delta(i, bdev_io);
+		if (limit->alloc_per_timeslice != 0 && delta != 0) {
+			__atomic_add_fetch(&limit->remaining_this_timeslice, delta,
+					   __ATOMIC_RELAXED);
+		}
+	}
+}
+
+/* Take the quota of all the group's limits for the IO. Returns false and leaves the quota
+ * untouched if any of the limits doesn't have any quota left. */
+static bool
+bdev_qos_group_take_quota(struct spdk_bdev_qos_group *group, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_qos_group_limit *limit;
+	uint64_t delta;
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		limit = &group->rate_limits[i];
+		delta = bdev_qos_group_io_delta(i, bdev_io);
+		if (limit->alloc_per_timeslice == 0 || delta == 0) {
+			continue;
+		}
+
+		/* As for the bdev limits, an IO is allowed if there was any quota left. */
+		if (__atomic_sub_fetch(&limit->remaining_this_timeslice, delta,
+				       __ATOMIC_RELAXED) + (int64_t)delta <= 0) {
+			__atomic_add_fetch(&limit->remaining_this_timeslice, delta,
+					   __ATOMIC_RELAXED);
+			bdev_qos_group_rewind_quota(group, bdev_io, i);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+bdev_qos_group_queue_io(struct spdk_bdev_qos_group *group, struct spdk_bdev_io *bdev_io)
+{
+	if (bdev_qos_group_take_quota(group, bdev_io)) {
+		if (group->parent == NULL || bdev_qos_group_take_quota(group->parent, bdev_io)) {
+			goto submit;
+		}
+		bdev_qos_group_rewind_quota(group, bdev_io, SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES);
+	}
+
+	/* Reads within the group's reservation are never queued by the group's limits. */
+	if (group->min_read_ios_per_sec != 0 && bdev_is_read_io(bdev_io)) {
+		if (__atomic_sub_fetch(&group->read_reserve_this_timeslice, 1,
+				       __ATOMIC_RELAXED) >= 0) {
+			__atomic_add_fetch(&group->num_reserved_reads, 1, __ATOMIC_RELAXED);
+			goto submit;
+		}
+		__atomic_add_fetch(&group->read_reserve_this_timeslice, 1, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&group->throttled, true, __ATOMIC_RELAXED);
+	return true;
+
+submit:
+	__atomic_add_fetch(&group->num_ios, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&group->bytes, bdev_get_io_size_in_byte(bdev_io), __ATOMIC_RELAXED);
+	return false;
+}
+
+/* Grants are only valid in the timeslice they were taken from. The quota of a new timeslice
+ * is refilled without them, so drop what is left, and size the next grants from what the
+ * channel used in the timeslice that just ended.
+ */
+static void
+bdev_qos_quota_expire(struct spdk_bdev_qos *qos, struct spdk_bdev_channel *ch,
+		      uint64_t timeslice_id)
+{
+	struct bdev_qos_quota *quota;
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		quota = &ch->qos_quota[i];
+		quota->remaining = 0;
+		if (ch->qos_quota_timeslice_id + 1 == timeslice_id) {
+			quota->grant = spdk_min(quota->used,
+						(int64_t)qos->rate_limits[i].quota_per_grant);
+		} else {
+			quota->grant = 0;
 		}
+		quota->used = 0;
 	}
+	ch->qos_quota_timeslice_id = timeslice_id;
 }
 
 static bool
 bdev_qos_queue_io(struct spdk_bdev_qos *qos, struct spdk_bdev_io *bdev_io)
 {
+	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+	struct bdev_qos_quota *quota = ch->qos_quota;
+	struct spdk_bdev_qos_group *group = qos->group;
+	uint64_t timeslice_id;
 	int i;
 
 	if (bdev_qos_io_to_limit(bdev_io) == true) {
+		timeslice_id = __atomic_load_n(&qos->timeslice_id, __ATOMIC_RELAXED);
+		if (spdk_unlikely(ch->qos_quota_timeslice_id != timeslice_id)) {
+			bdev_qos_quota_expire(qos, ch, timeslice_id);
+		}
+
 		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 			if (!qos->rate_limits[i].queue_io) {
 				continue;
 			}
 
-			if (qos->rate_limits[i].queue_io(&qos->rate_limits[i],
+			if (qos->rate_limits[i].queue_io(&qos->rate_limits[i], &quota[i],
 							 bdev_io) == true) {
 				for (i -= 1; i >= 0 ; i--) {
 					if (!qos->rate_limits[i].queue_io) {
 						continue;
 					}
 
-					qos->rate_limits[i].rewind_quota(&qos->rate_limits[i], bdev_io);
+					qos->rate_limits[i].rewind_quota(&qos->rate_limits[i], &quota[i],
+									 bdev_io);
 				}
 				return true;
 			}
 		}
+
+		if (group != NULL && bdev_qos_group_queue_io(group, bdev_io)) {
+			for (i = SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES - 1; i >= 0; i--) {
+				if (!qos->rate_limits[i].queue_io) {
+					continue;
+				}
+
+				qos->rate_limits[i].rewind_quota(&qos->rate_limits[i], &quota[i],
+								 bdev_io);
+			}
+			return true;
+		}
 	}
 
 	return false;
@@ -3091,6 +3856,23 @@ bdev_rw_get_io_boundary(struct spdk_bdev *bdev, uint8_t io_type)
 	return io_boundary;
 }
 
+/* Returns the number of blocks, starting at offset_blocks, that the bdev module accepts in a single
+ * I/O across optimal_io_boundary, or 0 if it can't merge split children.
+ */
+static inline uint64_t
+bdev_rw_get_contiguous_blocks(struct spdk_bdev_io *bdev_io, uint64_t offset_blocks,
+			      uint64_t num_blocks)
+{
+	struct spdk_bdev *bdev = bdev_io->bdev;
+
+	if (bdev->fn_table->get_contiguous_blocks == NULL || !bdev->split_on_optimal_io_boundary ||
+	    (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE && bdev->split_on_write_unit)) {
+		return 0;
+	}
+
+	return bdev->fn_table->get_contiguous_blocks(bdev->ctxt, offset_blocks, num_blocks);
+}
+
 static bool
 bdev_rw_should_split(struct spdk_bdev_io *bdev_io)
 {
@@ -3120,7 +3902,10 @@ bdev_rw_should_split(struct spdk_bdev_io *bdev_io)
 			end_stripe /= io_boundary;
 		}
 
-		if (start_stripe != end_stripe) {
+		if (start_stripe != end_stripe &&
+		    bdev_rw_get_contiguous_blocks(bdev_io, bdev_io->u.bdev.offset_blocks,
+						  bdev_io->u.bdev.num_blocks) <
+		    bdev_io->u.bdev.num_blocks) {
 			return true;
 		}
 	}
@@ -3215,6 +4000,16 @@ _to_next_boundary(uint64_t offset, uint32_t boundary)
 
 static void bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg);
 
+static inline void
+bdev_io_span_done(struct spdk_bdev_io *bdev_io, uint64_t tsc)
+{
+	if (spdk_unlikely(bdev_io->internal.span_id != 0)) {
+		spdk_trace_record_tsc(tsc, TRACE_BDEV_SPAN_DONE, bdev_io->internal.ch->trace_id, 0,
+				      (uintptr_t)bdev_io, bdev_io->internal.span_id,
+				      (int64_t)bdev_io->internal.status);
+	}
+}
+
 static void _bdev_rw_split(void *_bdev_io);
 
 static void bdev_unmap_split(struct spdk_bdev_io *bdev_io);
@@ -3335,6 +4130,7 @@ bdev_io_split_submit(struct spdk_bdev_io *bdev_io, struct iovec *iov, int iovcnt
 				spdk_trace_record(TRACE_BDEV_IO_DONE, bdev_io->internal.ch->trace_id,
 						  0, (uintptr_t)bdev_io, bdev_io->internal.caller_ctx,
 						  bdev_io->internal.ch->queue_depth);
+				bdev_io_span_done(bdev_io, 0);
 				bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
 			}
 		}
@@ -3349,7 +4145,7 @@ _bdev_rw_split(void *_bdev_io)
 	struct iovec *parent_iov, *iov;
 	struct spdk_bdev_io *bdev_io = _bdev_io;
 	struct spdk_bdev *bdev = bdev_io->bdev;
-	uint64_t parent_offset, current_offset, remaining;
+	uint64_t parent_offset, current_offset, remaining, contiguous;
 	uint32_t parent_iov_offset, parent_iovcnt, parent_iovpos, child_iovcnt;
 	uint32_t to_next_boundary, to_next_boundary_bytes, to_last_block_bytes;
 	uint32_t iovcnt, iov_len, child_iovsize;
@@ -3396,6 +4192,14 @@ _bdev_rw_split(void *_bdev_io)
 	while (remaining > 0 && parent_iovpos < parent_iovcnt &&
 	       child_iovcnt < SPDK_BDEV_IO_NUM_CHILD_IOV) {
 		to_next_boundary = _to_next_boundary(current_offset, io_boundary);
+		if (to_next_boundary < remaining) {
+			/* Merge the children the module can take in one I/O */
+			contiguous = bdev_rw_get_contiguous_blocks(bdev_io, current_offset,
+					remaining);
+			if (contiguous > to_next_boundary) {
+				to_next_boundary = spdk_min(contiguous, UINT32_MAX);
+			}
+		}
 		to_next_boundary = spdk_min(remaining, to_next_boundary);
 		to_next_boundary = spdk_min(max_size, to_next_boundary);
 		to_next_boundary_bytes = to_next_boundary * blocklen;
@@ -3467,6 +4271,7 @@ _bdev_rw_split(void *_bdev_io)
 								spdk_trace_record(TRACE_BDEV_IO_DONE, bdev_io->internal.ch->trace_id,
 										  0, (uintptr_t)bdev_io, bdev_io->internal.caller_ctx,
 										  bdev_io->internal.ch->queue_depth);
+								bdev_io_span_done(bdev_io, 0);
 								bdev_io->internal.cb(bdev_io, false, bdev_io->internal.caller_ctx);
 							}
 
@@ -3638,6 +4443,7 @@ bdev_io_split_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		spdk_trace_record(TRACE_BDEV_IO_DONE, parent_io->internal.ch->trace_id,
 				  0, (uintptr_t)parent_io, caller_ctx,
 				  parent_io->internal.ch->queue_depth);
+		bdev_io_span_done(parent_io, 0);
 
 		if (spdk_likely(parent_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS)) {
 			if (bdev_io_needs_sequence_exec(parent_io)) {
@@ -3821,6 +4627,44 @@ bdev_io_range_is_locked(struct spdk_bdev_io *bdev_io, struct lba_range *range)
 	}
 }
 
+static void
+bdev_io_span_start(struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bdev_channel *ch = bdev_io->internal.ch;
+	struct spdk_bdev_io *parent_io = tls_span_io;
+	uint32_t sample_rate;
+
+	if (bdev_io->internal.f.child_io) {
+		/* Split children are submitted outside of their parent's submit_request() */
+		parent_io = bdev_io->internal.caller_ctx;
+	}
+
+	if (parent_io != NULL) {
+		if (parent_io->internal.span_id == 0) {
+			return;
+		}
+		bdev_io->internal.span_id = parent_io->internal.span_id;
+		bdev_io->internal.span_parent = parent_io;
+		bdev_io->internal.span_depth = spdk_min(parent_io->internal.span_depth + 1,
+							UINT8_MAX);
+	} else {
+		sample_rate = __atomic_load_n(&g_bdev_span_sample_rate, __ATOMIC_RELAXED);
+		if (sample_rate == 0 || ++ch->span_sample_count < sample_rate) {
+			return;
+		}
+		ch->span_sample_count = 0;
+		bdev_io->internal.span_id = __atomic_add_fetch(&g_bdev_span_id, 1, __ATOMIC_RELAXED);
+		bdev_io->internal.span_parent = NULL;
+		bdev_io->internal.span_depth = 0;
+	}
+
+	spdk_trace_record_tsc(bdev_io->internal.submit_tsc, TRACE_BDEV_SPAN_START, ch->trace_id,
+			      bdev_io->u.bdev.num_blocks, (uintptr_t)bdev_io,
+			      bdev_io->internal.span_id, (uintptr_t)bdev_io->internal.span_parent,
+			      (uint64_t)bdev_io->type, bdev_io->u.bdev.offset_blocks,
+			      bdev_io->internal.span_depth);
+}
+
 void
 bdev_io_submit(struct spdk_bdev_io *bdev_io)
 {
@@ -3849,6 +4693,11 @@ bdev_io_submit(struct spdk_bdev_io *bdev_io)
 			      (uintptr_t)bdev_io, (uint64_t)bdev_io->type, bdev_io->internal.caller_ctx,
 			      bdev_io->u.bdev.offset_blocks, ch->queue_depth);
 
+	if (spdk_unlikely(g_bdev_span_sample_rate != 0 || tls_span_io != NULL ||
+			  bdev_io->internal.f.child_io)) {
+		bdev_io_span_start(bdev_io);
+	}
+
 	if (bdev_io->internal.f.split) {
 		bdev_io_split(bdev_io);
 		return;
@@ -4053,6 +4902,8 @@ bdev_io_init(struct spdk_bdev_io *bdev_io,
 	bdev_io->internal.f.in_submit_request = false;
 	bdev_io->internal.error.nvme.cdw0 = 0;
 	bdev_io->num_retries = 0;
+	bdev_io->internal.slo_submit_tsc = 0;
+	bdev_io->internal.span_id = 0;
 	bdev_io->internal.get_buf_cb = NULL;
 	bdev_io->internal.data_transfer_cpl = NULL;
 	bdev_io->internal.waitq_entry.dep_unblock = false;
@@ -4205,6 +5056,7 @@ bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
 	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
 		if (qos->rate_limits[i].limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
 			qos->rate_limits[i].max_per_timeslice = 0;
+			qos->rate_limits[i].quota_per_grant = 0;
 			continue;
 		}
 
@@ -4213,6 +5065,8 @@ bdev_qos_update_max_quota_per_timeslice(struct spdk_bdev_qos *qos)
 
 		qos->rate_limits[i].max_per_timeslice = spdk_max(max_per_timeslice,
 							qos->rate_limits[i].min_per_timeslice);
+		qos->rate_limits[i].quota_per_grant = spdk_max(qos->rate_limits[i].max_per_timeslice /
+						      SPDK_BDEV_QOS_GRANTS_PER_TIMESLICE, 1);
 
 		__atomic_store_n(&qos->rate_limits[i].remaining_this_timeslice,
 				 qos->rate_limits[i].max_per_timeslice, __ATOMIC_RELEASE);
@@ -4294,12 +5148,60 @@ bdev_channel_poll_qos(void *arg)
 		}
 	}
 
+	/* Expire the grants the channels took in the previous timeslices */
+	__atomic_add_fetch(&qos->timeslice_id, 1, __ATOMIC_RELAXED);
+
 	spdk_bdev_for_each_channel(bdev, bdev_channel_submit_qos_io, qos,
 				   bdev_channel_submit_qos_io_done);
 
 	return SPDK_POLLER_BUSY;
 }
 
+static void
+bdev_io_class_histograms_free(struct spdk_bdev_io_class_histograms *histograms)
+{
+	int type, size;
+
+	if (histograms == NULL) {
+		return;
+	}
+
+	for (type = 0; type < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; type++) {
+		for (size = 0; size < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size++) {
+			spdk_histogram_data_free(histograms->histogram[type][size]);
+		}
+	}
+	free(histograms);
+}
+
+static struct spdk_bdev_io_class_histograms *
+bdev_io_class_histograms_alloc(struct spdk_bdev *bdev)
+{
+	struct spdk_bdev_io_class_histograms *histograms;
+	struct spdk_histogram_data *histogram;
+	int type, size;
+
+	histograms = calloc(1, sizeof(*histograms));
+	if (histograms == NULL) {
+		return NULL;
+	}
+
+	for (type = 0; type < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; type++) {
+		for (size = 0; size < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size++) {
+			histogram = spdk_histogram_data_alloc_sized_ext(bdev->internal.histogram_granularity,
+					bdev->internal.histogram_min_val,
+					bdev->internal.histogram_max_val);
+			if (histogram == NULL) {
+				bdev_io_class_histograms_free(histograms);
+				return NULL;
+			}
+			histograms->histogram[type][size] = histogram;
+		}
+	}
+
+	return histograms;
+}
+
 static void
 bdev_channel_destroy_resource(struct spdk_bdev_channel *ch)
 {
@@ -4385,6 +5287,7 @@ bdev_enable_qos(struct spdk_bdev *bdev, struct spdk_bdev_channel *ch)
 							   SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
 		}
 
+		memset(ch->qos_quota, 0, sizeof(ch->qos_quota));
 		ch->flags |= BDEV_CH_QOS_ENABLED;
 	}
 }
@@ -4543,6 +5446,9 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 	spdk_trace_record(TRACE_BDEV_IOCH_CREATE, bdev->internal.trace_id, 0, 0,
 			  spdk_thread_get_id(spdk_io_channel_get_thread(ch->channel)));
 
+	/* Let the scheduler keep this thread close to the device. */
+	spdk_io_channel_set_numa_id(spdk_io_channel_from_ctx(ch), spdk_bdev_get_numa_id(bdev));
+
 	assert(ch->histogram == NULL);
 	if (bdev->internal.histogram_enabled) {
 		ch->histogram = spdk_histogram_data_alloc();
@@ -4551,6 +5457,23 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 		}
 	}
 
+	assert(ch->io_class_histograms == NULL);
+	if (bdev->internal.histogram_enabled && bdev->internal.histogram_per_io_class) {
+		ch->io_class_histograms = bdev_io_class_histograms_alloc(bdev);
+		if (ch->io_class_histograms == NULL) {
+			SPDK_ERRLOG("Could not allocate I/O class histograms\n");
+		}
+	}
+
+	assert(ch->latency_slo == NULL);
+	if (bdev->internal.latency_slo_target_us != 0) {
+		ch->latency_slo = bdev_latency_slo_alloc(bdev->internal.latency_slo_target_us,
+				  bdev->internal.latency_slo_max_queue_depth);
+		if (ch->latency_slo == NULL) {
+			SPDK_ERRLOG("Could not allocate latency SLO\n");
+		}
+	}
+
 	mgmt_io_ch = spdk_get_io_channel(&g_bdev_mgr);
 	if (!mgmt_io_ch) {
 		spdk_put_io_channel(ch->channel);
@@ -4588,6 +5511,7 @@ bdev_channel_create(void *io_device, void *ctx_buf)
 	ch->io_outstanding = 0;
 	TAILQ_INIT(&ch->locked_ranges);
 	TAILQ_INIT(&ch->qos_queued_io);
+	TAILQ_INIT(&ch->latency_slo_queued_io);
 	ch->flags = 0;
 	ch->trace_id = bdev->internal.trace_id;
 	ch->shared_resource = shared_resource;
@@ -4712,6 +5636,19 @@ bdev_abort_all_nomem_io(struct spdk_bdev_channel *ch)
 	shared_resource->nomem_abort_in_progress = false;
 }
 
+static inline void
+bdev_abort_all_latency_slo_io(struct spdk_bdev_channel *ch)
+{
+	bdev_io_tailq_t queue;
+
+	/* Take the I/Os off the channel first, so that the completion of each aborted I/O
+	 * doesn't submit the rest of them.
+	 */
+	TAILQ_INIT(&queue);
+	TAILQ_SWAP(&ch->latency_slo_queued_io, &queue, spdk_bdev_io, internal.link);
+	bdev_abort_all_queued_io(&queue, ch);
+}
+
 static bool
 bdev_abort_queued_io(bdev_io_tailq_t *queue, struct spdk_bdev_io *bio_to_abort)
 {
@@ -5039,6 +5976,7 @@ bdev_channel_abort_queued_ios(struct spdk_bdev_channel *ch)
 	struct spdk_bdev_shared_resource *shared_resource = ch->shared_resource;
 	struct spdk_bdev_mgmt_channel *mgmt_ch = shared_resource->mgmt_ch;
 
+	bdev_abort_all_latency_slo_io(ch);
 	bdev_abort_all_nomem_io(ch);
 	bdev_abort_all_buf_io(mgmt_ch, ch);
 }
@@ -5065,6 +6003,9 @@ bdev_channel_destroy(void *io_device, void *ctx_buf)
 		spdk_histogram_data_free(ch->histogram);
 	}
 
+	bdev_io_class_histograms_free(ch->io_class_histograms);
+	free(ch->latency_slo);
+
 	bdev_channel_destroy_resource(ch);
 }
 
@@ -5668,24 +6609,183 @@ spdk_bdev_set_qd_sampling_period(struct spdk_bdev *bdev, uint64_t period)
 				   bdev, period);
 }
 
-struct bdev_get_current_qd_ctx {
-	uint64_t current_qd;
-	spdk_bdev_get_current_qd_cb cb_fn;
+struct bdev_latency_slo_ctx {
+	struct spdk_bdev *bdev;
+	void (*cb_fn)(void *cb_arg, int status);
 	void *cb_arg;
+	int status;
 };
 
 static void
-bdev_get_current_qd_done(struct spdk_bdev *bdev, void *_ctx, int status)
+bdev_set_latency_slo_done(struct spdk_bdev *bdev, void *_ctx, int status)
 {
-	struct bdev_get_current_qd_ctx *ctx = _ctx;
+	struct bdev_latency_slo_ctx *ctx = _ctx;
 
-	ctx->cb_fn(bdev, ctx->current_qd, ctx->cb_arg, 0);
+	spdk_spin_lock(&bdev->internal.spinlock);
+	bdev->internal.latency_slo_in_progress = false;
+	spdk_spin_unlock(&bdev->internal.spinlock);
 
+	ctx->cb_fn(ctx->cb_arg, ctx->status);
 	free(ctx);
 }
 
 static void
-bdev_get_current_qd(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+bdev_disable_latency_slo_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+				 struct spdk_io_channel *_ch, void *_ctx)
+{
+	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
+
+	free(ch->latency_slo);
+	ch->latency_slo = NULL;
+	bdev_latency_slo_submit_queued_io(ch);
+
+	spdk_bdev_for_each_channel_continue(i, 0);
+}
+
+static void
+bdev_enable_latency_slo_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct bdev_latency_slo_ctx *ctx = _ctx;
+
+	if (status != 0) {
+		ctx->status = status;
+		bdev->internal.latency_slo_target_us = 0;
+		spdk_bdev_for_each_channel(bdev, bdev_disable_latency_slo_channel, ctx,
+					   bdev_set_latency_slo_done);
+	} else {
+		bdev_set_latency_slo_done(bdev, ctx, 0);
+	}
+}
+
+static void
+bdev_enable_latency_slo_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+				struct spdk_io_channel *_ch, void *_ctx)
+{
+	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
+	struct bdev_latency_slo *slo;
+	int status = 0;
+
+	slo = bdev_latency_slo_alloc(bdev->internal.latency_slo_target_us,
+				     bdev->internal.latency_slo_max_queue_depth);
+	if (slo == NULL) {
+		status = -ENOMEM;
+	} else {
+		free(ch->latency_slo);
+		ch->latency_slo = slo;
+	}
+
+	spdk_bdev_for_each_channel_continue(i, status);
+}
+
+void
+spdk_bdev_set_latency_slo(struct spdk_bdev *bdev, uint64_t target_latency_us,
+			  uint32_t max_queue_depth,
+			  void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct bdev_latency_slo_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->bdev = bdev;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.latency_slo_in_progress) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		free(ctx);
+		cb_fn(cb_arg, -EAGAIN);
+		return;
+	}
+
+	bdev->internal.latency_slo_in_progress = true;
+	spdk_spin_unlock(&bdev->internal.spinlock);
+
+	bdev->internal.latency_slo_target_us = target_latency_us;
+	bdev->internal.latency_slo_max_queue_depth = max_queue_depth != 0 ? max_queue_depth :
+			SPDK_BDEV_SLO_DEFAULT_MAX_QUEUE_DEPTH;
+
+	if (target_latency_us != 0) {
+		spdk_bdev_for_each_channel(bdev, bdev_enable_latency_slo_channel, ctx,
+					   bdev_enable_latency_slo_done);
+	} else {
+		spdk_bdev_for_each_channel(bdev, bdev_disable_latency_slo_channel, ctx,
+					   bdev_set_latency_slo_done);
+	}
+}
+
+uint64_t
+spdk_bdev_get_latency_slo(const struct spdk_bdev *bdev)
+{
+	return bdev->internal.latency_slo_target_us;
+}
+
+void
+spdk_bdev_set_span_sample_rate(uint32_t sample_rate)
+{
+	__atomic_store_n(&g_bdev_span_sample_rate, sample_rate, __ATOMIC_RELAXED);
+}
+
+uint32_t
+spdk_bdev_get_span_sample_rate(void)
+{
+	return __atomic_load_n(&g_bdev_span_sample_rate, __ATOMIC_RELAXED);
+}
+
+void
+bdev_dump_latency_slo_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	if (bdev->internal.latency_slo_target_us == 0) {
+		return;
+	}
+
+	spdk_json_write_named_object_begin(w, "latency_slo");
+	spdk_json_write_named_uint64(w, "target_latency_us", bdev->internal.latency_slo_target_us);
+	spdk_json_write_named_uint32(w, "max_queue_depth",
+				     bdev->internal.latency_slo_max_queue_depth);
+	spdk_json_write_object_end(w);
+}
+
+void
+bdev_channel_dump_latency_slo_json(struct spdk_io_channel *_ch, struct spdk_json_write_ctx *w)
+{
+	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
+	struct bdev_latency_slo *slo = ch->latency_slo;
+
+	if (slo == NULL) {
+		return;
+	}
+
+	spdk_json_write_named_object_begin(w, "latency_slo");
+	spdk_json_write_named_uint32(w, "queue_depth_limit", slo->queue_depth_limit);
+	spdk_json_write_named_uint64(w, "p99_latency_us",
+				     slo->p99_ticks * SPDK_SEC_TO_USEC / spdk_get_ticks_hz());
+	spdk_json_write_named_uint64(w, "num_throttled_ios", slo->num_throttled);
+	spdk_json_write_object_end(w);
+}
+
+struct bdev_get_current_qd_ctx {
+	uint64_t current_qd;
+	spdk_bdev_get_current_qd_cb cb_fn;
+	void *cb_arg;
+};
+
+static void
+bdev_get_current_qd_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct bdev_get_current_qd_ctx *ctx = _ctx;
+
+	ctx->cb_fn(bdev, ctx->current_qd, ctx->cb_arg, 0);
+
+	free(ctx);
+}
+
+static void
+bdev_get_current_qd(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
 		    struct spdk_io_channel *io_ch, void *_ctx)
 {
 	struct bdev_get_current_qd_ctx *ctx = _ctx;
@@ -7176,9 +8276,11 @@ bdev_reset_freeze_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bd
 	channel->flags |= BDEV_CH_RESET_IN_PROGRESS;
 
 	/**
-	 * Abort nomem I/Os first so that aborting other queued I/Os won't resubmit
-	 * nomem I/Os of this channel.
+	 * Abort I/Os held back by the latency SLO first, so that the completions of the aborted
+	 * nomem I/Os don't submit them.  Abort nomem I/Os next so that aborting other queued
+	 * I/Os won't resubmit nomem I/Os of this channel.
 	 */
+	bdev_abort_all_latency_slo_io(channel);
 	bdev_abort_all_nomem_io(channel);
 	bdev_abort_all_buf_io(mgmt_channel, channel);
 
@@ -7674,6 +8776,7 @@ _bdev_abort(struct spdk_bdev_io *parent_io)
 {
 	struct spdk_bdev_desc *desc = parent_io->internal.desc;
 	struct spdk_bdev_channel *channel = parent_io->internal.ch;
+	struct spdk_bdev_mgmt_channel *mgmt_ch = channel->shared_resource->mgmt_ch;
 	void *bio_cb_arg;
 	struct spdk_bdev_io *bio_to_abort;
 	uint32_t matched_ios;
@@ -7694,6 +8797,8 @@ _bdev_abort(struct spdk_bdev_io *parent_io)
 	matched_ios = 0;
 	parent_io->internal.status = SPDK_BDEV_IO_STATUS_SUCCESS;
 
+	/* The aborted I/O may complete, and be freed, while the list is walked */
+	bdev_mgmt_channel_defer_flush(mgmt_ch);
 	TAILQ_FOREACH(bio_to_abort, &channel->io_submitted, internal.ch_link) {
 		if (bio_to_abort->internal.caller_ctx != bio_cb_arg) {
 			continue;
@@ -7722,6 +8827,7 @@ _bdev_abort(struct spdk_bdev_io *parent_io)
 		}
 		matched_ios++;
 	}
+	bdev_mgmt_channel_resume_flush(mgmt_ch);
 
 	return matched_ios;
 }
@@ -7985,6 +9091,41 @@ _bdev_io_complete(void *ctx)
 			     bdev_io->internal.caller_ctx);
 }
 
+static inline void
+bdev_io_class_histogram_tally(struct spdk_bdev_io_class_histograms *histograms,
+			      struct spdk_bdev_io *bdev_io, uint64_t tsc_diff)
+{
+	enum spdk_bdev_histogram_io_type type;
+	enum spdk_bdev_histogram_size_class size_class = SPDK_BDEV_HISTOGRAM_SIZE_4K;
+	uint64_t num_bytes;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		type = SPDK_BDEV_HISTOGRAM_IO_TYPE_READ;
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		type = SPDK_BDEV_HISTOGRAM_IO_TYPE_WRITE;
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		type = SPDK_BDEV_HISTOGRAM_IO_TYPE_UNMAP;
+		break;
+	default:
+		type = SPDK_BDEV_HISTOGRAM_IO_TYPE_OTHER;
+		break;
+	}
+
+	if (type != SPDK_BDEV_HISTOGRAM_IO_TYPE_OTHER) {
+		num_bytes = bdev_io->u.bdev.num_blocks * spdk_bdev_get_block_size(bdev_io->bdev);
+		if (num_bytes > 64 * 1024) {
+			size_class = SPDK_BDEV_HISTOGRAM_SIZE_LARGE;
+		} else if (num_bytes > 4 * 1024) {
+			size_class = SPDK_BDEV_HISTOGRAM_SIZE_64K;
+		}
+	}
+
+	spdk_histogram_data_tally(histograms->histogram[type][size_class], tsc_diff);
+}
+
 static inline void
 bdev_io_complete(void *ctx)
 {
@@ -8008,6 +9149,7 @@ bdev_io_complete(void *ctx)
 	bdev_ch_remove_from_io_submitted(bdev_io);
 	spdk_trace_record_tsc(tsc, TRACE_BDEV_IO_DONE, bdev_ch->trace_id, 0, (uintptr_t)bdev_io,
 			      bdev_io->internal.caller_ctx, bdev_ch->queue_depth);
+	bdev_io_span_done(bdev_io, tsc);
 
 	if (bdev_ch->histogram) {
 		if (bdev_io->bdev->internal.histogram_io_type == 0 ||
@@ -8016,6 +9158,10 @@ bdev_io_complete(void *ctx)
 			 * Tally all I/O types if the histogram_io_type is set to 0.
 			 */
 			spdk_histogram_data_tally(bdev_ch->histogram, tsc_diff);
+			if (bdev_ch->io_class_histograms != NULL) {
+				bdev_io_class_histogram_tally(bdev_ch->io_class_histograms, bdev_io,
+							      tsc_diff);
+			}
 		}
 	}
 
@@ -8138,6 +9284,12 @@ spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status sta
 		return;
 	} else {
 		bdev_io_decrement_outstanding(bdev_ch, shared_resource);
+		if (status != SPDK_BDEV_IO_STATUS_NOMEM) {
+			bdev_latency_slo_sample(bdev_ch, bdev_io);
+		}
+		if (spdk_unlikely(!TAILQ_EMPTY(&bdev_ch->latency_slo_queued_io))) {
+			bdev_latency_slo_submit_queued_io(bdev_ch);
+		}
 		if (spdk_likely(status == SPDK_BDEV_IO_STATUS_SUCCESS)) {
 			if (bdev_io_needs_sequence_exec(bdev_io)) {
 				bdev_io_exec_sequence(bdev_io, bdev_io_complete_sequence_cb);
@@ -8626,6 +9778,9 @@ bdev_destroy_cb(void *io_device)
 	cb_arg = bdev->internal.unregister_ctx;
 
 	spdk_spin_destroy(&bdev->internal.spinlock);
+	if (bdev->internal.qos != NULL && bdev->internal.qos->group != NULL) {
+		bdev_qos_group_put(bdev->internal.qos->group);
+	}
 	free(bdev->internal.qos);
 	bdev_free_io_stat(bdev->internal.stat);
 	spdk_trace_unregister_owner(bdev->internal.trace_id);
@@ -10139,6 +11294,188 @@ bdev_write_zero_buffer_done(struct spdk_bdev_io *bdev_io, bool success, void *cb
 	parent_io->internal.cb(parent_io, success, parent_io->internal.caller_ctx);
 }
 
+static struct spdk_bdev_qos_group *
+bdev_qos_group_find(const char *name)
+{
+	struct spdk_bdev_qos_group *group;
+
+	assert(spdk_spin_held(&g_bdev_mgr.spinlock));
+
+	TAILQ_FOREACH(group, &g_bdev_mgr.qos_groups, link) {
+		if (strcmp(group->name, name) == 0) {
+			return group;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+bdev_qos_group_put(struct spdk_bdev_qos_group *group)
+{
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	assert(group->num_bdevs > 0);
+	group->num_bdevs--;
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+}
+
+static uint64_t
+bdev_qos_group_min_per_timeslice(int type)
+{
+	if (bdev_qos_is_iops_rate_limit(type)) {
+		return SPDK_BDEV_QOS_MIN_IO_PER_TIMESLICE;
+	}
+
+	return SPDK_BDEV_QOS_MIN_BYTE_PER_TIMESLICE;
+}
+
+static uint64_t
+bdev_qos_group_max_per_timeslice(struct spdk_bdev_qos_group *group, int type)
+{
+	uint64_t limit = group->rate_limits[type].limit;
+
+	if (limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+		return 0;
+	}
+
+	return spdk_max(limit * SPDK_BDEV_QOS_TIMESLICE_IN_USEC / SPDK_SEC_TO_USEC,
+			bdev_qos_group_min_per_timeslice(type));
+}
+
+static bool
+bdev_qos_group_is_active(struct spdk_bdev_qos_group *group)
+{
+	return __atomic_load_n(&group->num_ios, __ATOMIC_RELAXED) != group->prev_num_ios ||
+	       __atomic_load_n(&group->throttled, __ATOMIC_RELAXED);
+}
+
+static void
+bdev_qos_group_refill_limit(struct spdk_bdev_qos_group_limit *limit, uint64_t alloc_per_timeslice)
+{
+	int64_t remaining_last_timeslice;
+
+	limit->alloc_per_timeslice = alloc_per_timeslice;
+
+	/* As for the bdev limits, an overrun of the last timeslice reduces the next one. */
+	remaining_last_timeslice = __atomic_exchange_n(&limit->remaining_this_timeslice, 0,
+				   __ATOMIC_RELAXED);
+	if (remaining_last_timeslice < 0) {
+		__atomic_store_n(&limit->remaining_this_timeslice, remaining_last_timeslice,
+				 __ATOMIC_RELAXED);
+	}
+	__atomic_add_fetch(&limit->remaining_this_timeslice, alloc_per_timeslice, __ATOMIC_RELAXED);
+}
+
+static void
+bdev_qos_group_start_timeslice(struct spdk_bdev_qos_group *group)
+{
+	group->prev_num_ios = __atomic_load_n(&group->num_ios, __ATOMIC_RELAXED);
+	__atomic_store_n(&group->throttled, false, __ATOMIC_RELAXED);
+	__atomic_store_n(&group->read_reserve_this_timeslice, group->min_read_ios_per_sec *
+			 SPDK_BDEV_QOS_TIMESLICE_IN_USEC / SPDK_SEC_TO_USEC, __ATOMIC_RELAXED);
+}
+
+/*
+ * Refill the quota of a top-level group and of its children for the next timeslice.
+ * Each limit of the parent is split between the children in proportion to their weights.
+ * Only the children that were active in the last timeslice compete for the parent's limit,
+ * idle children get the share they would have if all the children were active. The limits
+ * of the parent are still enforced on their own, so the children never exceed them together.
+ */
+static void
+bdev_qos_group_refill(struct spdk_bdev_qos_group *root)
+{
+	struct spdk_bdev_qos_group *group;
+	uint64_t weights = 0, active_weights = 0;
+	uint64_t alloc_per_timeslice, share;
+	int i;
+
+	assert(root->parent == NULL);
+	assert(spdk_spin_held(&g_bdev_mgr.spinlock));
+
+	TAILQ_FOREACH(group, &g_bdev_mgr.qos_groups, link) {
+		if (group->parent == root) {
+			weights += group->weight;
+			if (bdev_qos_group_is_active(group)) {
+				active_weights += group->weight;
+			}
+		}
+	}
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		bdev_qos_group_refill_limit(&root->rate_limits[i],
+					    bdev_qos_group_max_per_timeslice(root, i));
+	}
+	bdev_qos_group_start_timeslice(root);
+
+	TAILQ_FOREACH(group, &g_bdev_mgr.qos_groups, link) {
+		if (group->parent != root) {
+			continue;
+		}
+
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			alloc_per_timeslice = bdev_qos_group_max_per_timeslice(group, i);
+			share = root->rate_limits[i].alloc_per_timeslice;
+			if (share != 0) {
+				if (bdev_qos_group_is_active(group)) {
+					share = share * group->weight / active_weights;
+				} else {
+					share = share * group->weight / weights;
+				}
+				share = spdk_max(share, bdev_qos_group_min_per_timeslice(i));
+
+				if (alloc_per_timeslice == 0 || share < alloc_per_timeslice) {
+					alloc_per_timeslice = share;
+				}
+			}
+
+			bdev_qos_group_refill_limit(&group->rate_limits[i], alloc_per_timeslice);
+		}
+		bdev_qos_group_start_timeslice(group);
+	}
+}
+
+static int
+bdev_qos_group_poll(void *arg)
+{
+	struct spdk_bdev_qos_group *group = arg;
+	uint64_t timeslice_size, now = spdk_get_ticks();
+
+	timeslice_size = SPDK_BDEV_QOS_TIMESLICE_IN_USEC * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	if (now < group->last_timeslice + timeslice_size) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	group->last_timeslice = now;
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	bdev_qos_group_refill(group);
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	/* IOs queued by the groups are resubmitted by the QoS pollers of the member bdevs. */
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+bdev_qos_group_free(struct spdk_bdev_qos_group *group)
+{
+	spdk_poller_unregister(&group->poller);
+	free(group->name);
+	free(group);
+}
+
+static void
+bdev_qos_groups_free(void)
+{
+	struct spdk_bdev_qos_group *group;
+
+	while (!TAILQ_EMPTY(&g_bdev_mgr.qos_groups)) {
+		group = TAILQ_FIRST(&g_bdev_mgr.qos_groups);
+		TAILQ_REMOVE(&g_bdev_mgr.qos_groups, group, link);
+		bdev_qos_group_free(group);
+	}
+}
+
 static void
 bdev_set_qos_limit_done(struct set_qos_limit_ctx *ctx, int status)
 {
@@ -10147,8 +11484,18 @@ bdev_set_qos_limit_done(struct set_qos_limit_ctx *ctx, int status)
 
 	spdk_spin_lock(&ctx->bdev->internal.spinlock);
 	ctx->bdev->internal.qos_mod_in_progress = false;
+	if (status != 0 && ctx->join_group != NULL && ctx->bdev->internal.qos != NULL) {
+		ctx->bdev->internal.qos->group = NULL;
+	}
 	spdk_spin_unlock(&ctx->bdev->internal.spinlock);
 
+	if (status != 0 && ctx->join_group != NULL) {
+		bdev_qos_group_put(ctx->join_group);
+	}
+	if (ctx->leave_group != NULL) {
+		bdev_qos_group_put(ctx->leave_group);
+	}
+
 	if (ctx->cb_fn) {
 		ctx->cb_fn(ctx->cb_arg, status);
 	}
@@ -10219,6 +11566,7 @@ bdev_disable_qos_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
 	struct spdk_bdev_io *bdev_io;
 
 	bdev_ch->flags &= ~BDEV_CH_QOS_ENABLED;
+	memset(bdev_ch->qos_quota, 0, sizeof(bdev_ch->qos_quota));
 
 	while (!TAILQ_EMPTY(&bdev_ch->qos_queued_io)) {
 		/* Re-submit the queued I/O. */
@@ -10295,11 +11643,12 @@ bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits)
 	}
 }
 
-void
-spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
-			      void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+/* Convert the bandwidth limits from megabytes to bytes and round the limits up to the
+ * minimum granularity. Returns true if none of the defined limits is greater than 0.
+ */
+static bool
+bdev_qos_normalize_rate_limits(uint64_t *limits)
 {
-	struct set_qos_limit_ctx	*ctx;
 	uint32_t			limit_set_complement;
 	uint64_t			min_limit_per_sec;
 	int				i;
@@ -10336,6 +11685,19 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 		}
 	}
 
+	return disable_rate_limit;
+}
+
+void
+spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
+			      void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx	*ctx;
+	int				i;
+	bool				disable_rate_limit;
+
+	disable_rate_limit = bdev_qos_normalize_rate_limits(limits);
+
 	ctx = calloc(1, sizeof(*ctx));
 	if (ctx == NULL) {
 		if (cb_fn) {
@@ -10371,6 +11733,11 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 		}
 	}
 
+	if (disable_rate_limit == true && bdev->internal.qos && bdev->internal.qos->group) {
+		/* QoS stays enabled for the limits of the group */
+		disable_rate_limit = false;
+	}
+
 	if (disable_rate_limit == false) {
 		if (bdev->internal.qos == NULL) {
 			bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
@@ -10412,14 +11779,444 @@ spdk_bdev_set_qos_rate_limits(struct spdk_bdev *bdev, uint64_t *limits,
 	spdk_spin_unlock(&bdev->internal.spinlock);
 }
 
-struct spdk_bdev_histogram_ctx {
-	spdk_bdev_histogram_status_cb cb_fn;
-	void *cb_arg;
-	struct spdk_bdev *bdev;
-	int status;
-};
-
-static void
+void
+spdk_bdev_qos_group_opts_init(struct spdk_bdev_qos_group_opts *opts, size_t opts_size)
+{
+	if (!opts) {
+		SPDK_ERRLOG("opts should not be NULL\n");
+		return;
+	}
+
+	if (!opts_size) {
+		SPDK_ERRLOG("opts_size should not be zero value\n");
+		return;
+	}
+
+	memset(opts, 0, opts_size);
+	opts->opts_size = opts_size;
+
+#define SET_FIELD(field, value) \
+	if (offsetof(struct spdk_bdev_qos_group_opts, field) + sizeof(opts->field) <= opts_size) { \
+		opts->field = value; \
+	} \
+
+	SET_FIELD(weight, 1);
+
+#undef SET_FIELD
+}
+
+static void
+bdev_qos_group_opts_copy(struct spdk_bdev_qos_group_opts *opts,
+			 const struct spdk_bdev_qos_group_opts *opts_src)
+{
+#define SET_FIELD(field) \
+	if (offsetof(struct spdk_bdev_qos_group_opts, field) + sizeof(opts->field) <= opts_src->opts_size) { \
+		memcpy(&opts->field, &opts_src->field, sizeof(opts->field)); \
+	} \
+
+	SET_FIELD(parent);
+	SET_FIELD(weight);
+	SET_FIELD(min_read_ios_per_sec);
+	SET_FIELD(limits);
+
+	/* Do not remove this statement, you should always update this statement when you adding a new field,
+	 * and do not forget to add the SET_FIELD statement for your added field. */
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_qos_group_opts) == 64, "Incorrect size");
+
+#undef SET_FIELD
+}
+
+int
+spdk_bdev_qos_group_create(const char *name, const struct spdk_bdev_qos_group_opts *_opts)
+{
+	struct spdk_bdev_qos_group_opts opts;
+	struct spdk_bdev_qos_group *group, *parent = NULL;
+	uint64_t complement;
+	int i;
+
+	assert(spdk_thread_is_app_thread(NULL));
+
+	if (name == NULL || _opts == NULL || _opts->opts_size == 0) {
+		return -EINVAL;
+	}
+
+	spdk_bdev_qos_group_opts_init(&opts, sizeof(opts));
+	bdev_qos_group_opts_copy(&opts, _opts);
+
+	if (opts.weight == 0) {
+		SPDK_ERRLOG("Weight of QoS group %s must be at least 1\n", name);
+		return -EINVAL;
+	}
+
+	bdev_qos_normalize_rate_limits(opts.limits);
+
+	complement = opts.min_read_ios_per_sec % SPDK_BDEV_QOS_MIN_IOS_PER_SEC;
+	if (complement) {
+		opts.min_read_ios_per_sec += SPDK_BDEV_QOS_MIN_IOS_PER_SEC - complement;
+	}
+
+	group = calloc(1, sizeof(*group));
+	if (group == NULL) {
+		return -ENOMEM;
+	}
+
+	group->name = strdup(name);
+	if (group->name == NULL) {
+		free(group);
+		return -ENOMEM;
+	}
+
+	group->weight = opts.weight;
+	group->min_read_ios_per_sec = opts.min_read_ios_per_sec;
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (opts.limits[i] == 0 || opts.limits[i] == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			group->rate_limits[i].limit = SPDK_BDEV_QOS_LIMIT_NOT_DEFINED;
+		} else {
+			group->rate_limits[i].limit = opts.limits[i];
+		}
+	}
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	if (bdev_qos_group_find(name) != NULL) {
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		SPDK_ERRLOG("QoS group %s already exists\n", name);
+		bdev_qos_group_free(group);
+		return -EEXIST;
+	}
+
+	if (opts.parent != NULL) {
+		parent = bdev_qos_group_find(opts.parent);
+		if (parent == NULL || parent->parent != NULL) {
+			spdk_spin_unlock(&g_bdev_mgr.spinlock);
+			SPDK_ERRLOG("Parent of QoS group %s must be an existing top-level group\n",
+				    name);
+			bdev_qos_group_free(group);
+			return parent == NULL ? -ENOENT : -EINVAL;
+		}
+		parent->num_children++;
+	}
+
+	group->parent = parent;
+	TAILQ_INSERT_TAIL(&g_bdev_mgr.qos_groups, group, link);
+	bdev_qos_group_refill(parent != NULL ? parent : group);
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	if (parent == NULL) {
+		group->last_timeslice = spdk_get_ticks();
+		group->poller = SPDK_POLLER_REGISTER(bdev_qos_group_poll, group,
+						     SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	}
+
+	return 0;
+}
+
+int
+spdk_bdev_qos_group_delete(const char *name)
+{
+	struct spdk_bdev_qos_group *group;
+
+	assert(spdk_thread_is_app_thread(NULL));
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	group = bdev_qos_group_find(name);
+	if (group == NULL) {
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		return -ENOENT;
+	}
+
+	if (group->num_bdevs != 0 || group->num_children != 0) {
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		SPDK_ERRLOG("QoS group %s still has members\n", name);
+		return -EBUSY;
+	}
+
+	TAILQ_REMOVE(&g_bdev_mgr.qos_groups, group, link);
+	if (group->parent != NULL) {
+		group->parent->num_children--;
+	}
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	bdev_qos_group_free(group);
+
+	return 0;
+}
+
+void
+spdk_bdev_qos_group_add_bdev(const char *name, struct spdk_bdev *bdev,
+			     void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx *ctx;
+	struct spdk_bdev_qos_group *group;
+	int rc = 0;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		if (cb_fn) {
+			cb_fn(cb_arg, -ENOMEM);
+		}
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->bdev = bdev;
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	group = bdev_qos_group_find(name);
+	if (group == NULL) {
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		free(ctx);
+		if (cb_fn) {
+			cb_fn(cb_arg, -ENOENT);
+		}
+		return;
+	}
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	if (bdev->internal.qos_mod_in_progress) {
+		rc = -EAGAIN;
+	} else if (bdev->internal.qos != NULL && bdev->internal.qos->group != NULL) {
+		SPDK_ERRLOG("Bdev %s is already a member of QoS group %s\n", bdev->name,
+			    bdev->internal.qos->group->name);
+		rc = -EEXIST;
+	}
+	if (rc != 0) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		spdk_spin_unlock(&g_bdev_mgr.spinlock);
+		free(ctx);
+		if (cb_fn) {
+			cb_fn(cb_arg, rc);
+		}
+		return;
+	}
+
+	group->num_bdevs++;
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	bdev->internal.qos_mod_in_progress = true;
+	ctx->join_group = group;
+
+	if (bdev->internal.qos == NULL) {
+		/* QoS without any limits of the bdev itself */
+		bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+		if (!bdev->internal.qos) {
+			spdk_spin_unlock(&bdev->internal.spinlock);
+			SPDK_ERRLOG("Unable to allocate memory for QoS tracking\n");
+			bdev_set_qos_limit_done(ctx, -ENOMEM);
+			return;
+		}
+	}
+
+	bdev->internal.qos->group = group;
+
+	if (bdev->internal.qos->thread == NULL) {
+		spdk_bdev_for_each_channel(bdev, bdev_enable_qos_msg, ctx,
+					   bdev_enable_qos_done);
+		spdk_spin_unlock(&bdev->internal.spinlock);
+	} else {
+		/* QoS is already enabled on all the channels */
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		bdev_set_qos_limit_done(ctx, 0);
+	}
+}
+
+static void
+bdev_qos_group_leave_msg(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+			 struct spdk_io_channel *ch, void *_ctx)
+{
+	/* Nothing to do, the group is released once no channel may use it anymore */
+	spdk_bdev_for_each_channel_continue(i, 0);
+}
+
+static void
+bdev_qos_group_leave_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	bdev_set_qos_limit_done(_ctx, status);
+}
+
+void
+spdk_bdev_qos_group_remove_bdev(struct spdk_bdev *bdev,
+				void (*cb_fn)(void *cb_arg, int status), void *cb_arg)
+{
+	struct set_qos_limit_ctx *ctx;
+	struct spdk_bdev_qos *qos;
+	int i, rc = 0;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		if (cb_fn) {
+			cb_fn(cb_arg, -ENOMEM);
+		}
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->bdev = bdev;
+
+	spdk_spin_lock(&bdev->internal.spinlock);
+	qos = bdev->internal.qos;
+	if (bdev->internal.qos_mod_in_progress) {
+		rc = -EAGAIN;
+	} else if (qos == NULL || qos->group == NULL) {
+		rc = -ENOENT;
+	}
+	if (rc != 0) {
+		spdk_spin_unlock(&bdev->internal.spinlock);
+		free(ctx);
+		if (cb_fn) {
+			cb_fn(cb_arg, rc);
+		}
+		return;
+	}
+
+	bdev->internal.qos_mod_in_progress = true;
+	ctx->leave_group = qos->group;
+	qos->group = NULL;
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		if (qos->rate_limits[i].limit > 0 &&
+		    qos->rate_limits[i].limit != SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			break;
+		}
+	}
+
+	if (i == SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES) {
+		/* The bdev doesn't have any limits of its own */
+		spdk_bdev_for_each_channel(bdev, bdev_disable_qos_msg, ctx,
+					   bdev_disable_qos_msg_done);
+	} else {
+		spdk_bdev_for_each_channel(bdev, bdev_qos_group_leave_msg, ctx,
+					   bdev_qos_group_leave_done);
+	}
+
+	spdk_spin_unlock(&bdev->internal.spinlock);
+}
+
+static void
+bdev_qos_group_limits_json(struct spdk_json_write_ctx *w, struct spdk_bdev_qos_group *group)
+{
+	uint64_t limit;
+	int i;
+
+	for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+		limit = group->rate_limits[i].limit;
+		if (limit == SPDK_BDEV_QOS_LIMIT_NOT_DEFINED) {
+			continue;
+		}
+		if (bdev_qos_is_iops_rate_limit(i) == false) {
+			limit = limit / 1024 / 1024;
+		}
+		spdk_json_write_named_uint64(w, qos_rpc_type[i], limit);
+	}
+}
+
+static void
+bdev_qos_groups_config_json(struct spdk_json_write_ctx *w)
+{
+	struct spdk_bdev_qos_group *group;
+	int pass;
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	/* Create the top-level groups first, then their children */
+	for (pass = 0; pass < 2; pass++) {
+		TAILQ_FOREACH(group, &g_bdev_mgr.qos_groups, link) {
+			if ((group->parent == NULL) != (pass == 0)) {
+				continue;
+			}
+
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "method", "bdev_qos_group_create");
+
+			spdk_json_write_named_object_begin(w, "params");
+			spdk_json_write_named_string(w, "name", group->name);
+			if (group->parent != NULL) {
+				spdk_json_write_named_string(w, "parent", group->parent->name);
+			}
+			spdk_json_write_named_uint32(w, "weight", group->weight);
+			if (group->min_read_ios_per_sec != 0) {
+				spdk_json_write_named_uint64(w, "min_read_ios_per_sec",
+							     group->min_read_ios_per_sec);
+			}
+			bdev_qos_group_limits_json(w, group);
+			spdk_json_write_object_end(w);
+
+			spdk_json_write_object_end(w);
+		}
+	}
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+}
+
+bool
+bdev_qos_group_exists(const char *name)
+{
+	bool exists;
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	exists = bdev_qos_group_find(name) != NULL;
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	return exists;
+}
+
+void
+bdev_qos_groups_dump_json(struct spdk_json_write_ctx *w, const char *name)
+{
+	struct spdk_bdev_qos_group *group;
+	uint64_t limit;
+	int i;
+
+	spdk_json_write_array_begin(w);
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	TAILQ_FOREACH(group, &g_bdev_mgr.qos_groups, link) {
+		if (name != NULL && strcmp(group->name, name) != 0) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "name", group->name);
+		if (group->parent != NULL) {
+			spdk_json_write_named_string(w, "parent", group->parent->name);
+		}
+		spdk_json_write_named_uint32(w, "weight", group->weight);
+		spdk_json_write_named_uint64(w, "min_read_ios_per_sec", group->min_read_ios_per_sec);
+		bdev_qos_group_limits_json(w, group);
+		spdk_json_write_named_uint32(w, "num_bdevs", group->num_bdevs);
+
+		/* Limits in current timeslice, including the share of the parent's limits */
+		spdk_json_write_named_object_begin(w, "current_limits");
+		for (i = 0; i < SPDK_BDEV_QOS_NUM_RATE_LIMIT_TYPES; i++) {
+			limit = group->rate_limits[i].alloc_per_timeslice * SPDK_SEC_TO_USEC /
+				SPDK_BDEV_QOS_TIMESLICE_IN_USEC;
+			if (bdev_qos_is_iops_rate_limit(i) == false) {
+				limit = limit / 1024 / 1024;
+			}
+			spdk_json_write_named_uint64(w, qos_rpc_type[i], limit);
+		}
+		spdk_json_write_object_end(w);
+
+		spdk_json_write_named_uint64(w, "num_ios",
+					     __atomic_load_n(&group->num_ios, __ATOMIC_RELAXED));
+		spdk_json_write_named_uint64(w, "bytes",
+					     __atomic_load_n(&group->bytes, __ATOMIC_RELAXED));
+		spdk_json_write_named_uint64(w, "num_reserved_reads", __atomic_load_n(
+						     &group->num_reserved_reads, __ATOMIC_RELAXED));
+		spdk_json_write_object_end(w);
+	}
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+
+	spdk_json_write_array_end(w);
+}
+
+struct spdk_bdev_histogram_ctx {
+	spdk_bdev_histogram_status_cb cb_fn;
+	void *cb_arg;
+	struct spdk_bdev *bdev;
+	int status;
+};
+
+static void
 bdev_histogram_disable_channel_cb(struct spdk_bdev *bdev, void *_ctx, int status)
 {
 	struct spdk_bdev_histogram_ctx *ctx = _ctx;
@@ -10441,6 +12238,8 @@ bdev_histogram_disable_channel(struct spdk_bdev_channel_iter *i, struct spdk_bde
 		spdk_histogram_data_free(ch->histogram);
 		ch->histogram = NULL;
 	}
+	bdev_io_class_histograms_free(ch->io_class_histograms);
+	ch->io_class_histograms = NULL;
 	spdk_bdev_for_each_channel_continue(i, 0);
 }
 
@@ -10452,6 +12251,7 @@ bdev_histogram_enable_channel_cb(struct spdk_bdev *bdev, void *_ctx, int status)
 	if (status != 0) {
 		ctx->status = status;
 		ctx->bdev->internal.histogram_enabled = false;
+		ctx->bdev->internal.histogram_per_io_class = false;
 		spdk_bdev_for_each_channel(ctx->bdev, bdev_histogram_disable_channel, ctx,
 					   bdev_histogram_disable_channel_cb);
 	} else {
@@ -10478,6 +12278,16 @@ bdev_histogram_enable_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev
 		}
 	}
 
+	if (bdev->internal.histogram_per_io_class && ch->io_class_histograms == NULL) {
+		ch->io_class_histograms = bdev_io_class_histograms_alloc(bdev);
+		if (ch->io_class_histograms == NULL) {
+			status = -ENOMEM;
+		}
+	} else if (!bdev->internal.histogram_per_io_class) {
+		bdev_io_class_histograms_free(ch->io_class_histograms);
+		ch->io_class_histograms = NULL;
+	}
+
 	spdk_bdev_for_each_channel_continue(i, status);
 }
 
@@ -10512,6 +12322,10 @@ spdk_bdev_histogram_enable_ext(struct spdk_bdev *bdev, spdk_bdev_histogram_statu
 	bdev->internal.histogram_enabled = enable;
 	bdev->internal.histogram_io_type = opts->io_type;
 	bdev->internal.histogram_granularity = opts->granularity;
+	bdev->internal.histogram_per_io_class = false;
+	if (enable && opts->size > offsetof(struct spdk_bdev_enable_histogram_opts, per_io_class)) {
+		bdev->internal.histogram_per_io_class = opts->per_io_class;
+	}
 	bdev->internal.histogram_min_val = opts->min_nsec * spdk_get_ticks_hz() / SPDK_SEC_TO_NSEC;
 	if (opts->max_nsec == UINT64_MAX) {
 		bdev->internal.histogram_max_val = UINT64_MAX;
@@ -10558,10 +12372,11 @@ spdk_bdev_enable_histogram_opts_init(struct spdk_bdev_enable_histogram_opts *opt
 	SET_FIELD(granularity, SPDK_HISTOGRAM_GRANULARITY_DEFAULT);
 	SET_FIELD(min_nsec, 0);
 	SET_FIELD(max_nsec, UINT64_MAX);
+	SET_FIELD(per_io_class, false);
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_enable_histogram_opts) == 26, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_bdev_enable_histogram_opts) == 27, "Incorrect size");
 
 #undef FIELD_OK
 #undef SET_FIELD
@@ -10634,6 +12449,65 @@ spdk_bdev_histogram_get(struct spdk_bdev *bdev, struct spdk_histogram_data *hist
 				   bdev_histogram_get_channel_cb);
 }
 
+struct bdev_io_class_histograms_ctx {
+	spdk_bdev_histogram_status_cb cb_fn;
+	void *cb_arg;
+	struct spdk_bdev_io_class_histograms *histograms;
+};
+
+static void
+bdev_io_class_histograms_get_done(struct spdk_bdev *bdev, void *_ctx, int status)
+{
+	struct bdev_io_class_histograms_ctx *ctx = _ctx;
+
+	ctx->cb_fn(ctx->cb_arg, status);
+	free(ctx);
+}
+
+static void
+bdev_io_class_histograms_get_channel(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bdev,
+				     struct spdk_io_channel *_ch, void *_ctx)
+{
+	struct spdk_bdev_channel *ch = __io_ch_to_bdev_ch(_ch);
+	struct bdev_io_class_histograms_ctx *ctx = _ctx;
+	int type, size, status = 0;
+
+	if (ch->io_class_histograms == NULL) {
+		spdk_bdev_for_each_channel_continue(i, -EFAULT);
+		return;
+	}
+
+	for (type = 0; type < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES && status == 0; type++) {
+		for (size = 0; size < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES && status == 0; size++) {
+			status = spdk_histogram_data_merge(ctx->histograms->histogram[type][size],
+							   ch->io_class_histograms->histogram[type][size]);
+		}
+	}
+
+	spdk_bdev_for_each_channel_continue(i, status);
+}
+
+void
+spdk_bdev_histogram_get_io_classes(struct spdk_bdev *bdev,
+				   struct spdk_bdev_io_class_histograms *histograms,
+				   spdk_bdev_histogram_status_cb cb_fn, void *cb_arg)
+{
+	struct bdev_io_class_histograms_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->histograms = histograms;
+
+	spdk_bdev_for_each_channel(bdev, bdev_io_class_histograms_get_channel, ctx,
+				   bdev_io_class_histograms_get_done);
+}
+
 void
 spdk_bdev_channel_get_histogram(struct spdk_io_channel *ch, spdk_bdev_histogram_data_cb cb_fn,
 				void *cb_arg)
@@ -11588,6 +13462,25 @@ bdev_trace(void)
 				{ "tid", SPDK_TRACE_ARG_TYPE_INT, 8 }
 			}
 		},
+		{
+			"BDEV_SPAN_START", TRACE_BDEV_SPAN_START,
+			OWNER_TYPE_BDEV, OBJECT_BDEV_IO, 0,
+			{
+				{ "span", SPDK_TRACE_ARG_TYPE_INT, 8 },
+				{ "parent", SPDK_TRACE_ARG_TYPE_PTR, 8 },
+				{ "type", SPDK_TRACE_ARG_TYPE_INT, 8 },
+				{ "offset", SPDK_TRACE_ARG_TYPE_INT, 8 },
+				{ "depth", SPDK_TRACE_ARG_TYPE_INT, 4 }
+			}
+		},
+		{
+			"BDEV_SPAN_DONE", TRACE_BDEV_SPAN_DONE,
+			OWNER_TYPE_BDEV, OBJECT_BDEV_IO, 0,
+			{
+				{ "span", SPDK_TRACE_ARG_TYPE_INT, 8 },
+				{ "status", SPDK_TRACE_ARG_TYPE_INT, 8 }
+			}
+		},
 	};
 
 
@@ -31,4 +31,12 @@ typedef void (*bdev_reset_device_stat_cb)(struct spdk_bdev *bdev, void *cb_arg,
 void bdev_reset_device_stat(struct spdk_bdev *bdev, enum spdk_bdev_reset_stat_mode mode,
 			    bdev_reset_device_stat_cb cb, void *cb_arg);
 
+struct spdk_json_write_ctx;
+
+bool bdev_qos_group_exists(const char *name);
+void bdev_qos_groups_dump_json(struct spdk_json_write_ctx *w, const char *name);
+
+void bdev_dump_latency_slo_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w);
+void bdev_channel_dump_latency_slo_json(struct spdk_io_channel *ch, struct spdk_json_write_ctx *w);
+
 #endif /* SPDK_BDEV_INTERNAL_H */
@@ -104,6 +104,40 @@ rpc_bdev_wait_for_examine(struct spdk_jsonrpc_request *request,
 }
 SPDK_RPC_REGISTER("bdev_wait_for_examine", rpc_bdev_wait_for_examine, SPDK_RPC_RUNTIME)
 
+static void
+rpc_bdev_get_io_cache_stats_done(struct spdk_bdev_io_cache_stats *stats, void *cb_arg)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_uint64(w, "cache", stats->cache);
+	spdk_json_write_named_uint64(w, "main", stats->main);
+	spdk_json_write_named_uint64(w, "retry", stats->retry);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_bdev_get_io_cache_stats(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	int rc;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "bdev_get_io_cache_stats requires no parameters");
+		return;
+	}
+
+	rc = spdk_bdev_get_io_cache_stats(rpc_bdev_get_io_cache_stats_done, request);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+	}
+}
+SPDK_RPC_REGISTER("bdev_get_io_cache_stats", rpc_bdev_get_io_cache_stats, SPDK_RPC_RUNTIME)
+
 static void
 rpc_bdev_examine(struct spdk_jsonrpc_request *request,
 		 const struct spdk_json_val *params)
@@ -243,6 +277,8 @@ bdev_get_iostat_done(struct spdk_bdev *bdev, struct spdk_bdev_io_stat *stat,
 					     spdk_bdev_get_weighted_io_time(bdev));
 	}
 
+	bdev_dump_latency_slo_json(bdev, w);
+
 	if (bdev->fn_table->dump_device_stat_json) {
 		spdk_json_write_named_object_begin(w, "driver_specific");
 		bdev->fn_table->dump_device_stat_json(bdev->ctxt, w);
@@ -282,6 +318,7 @@ bdev_get_per_channel_stat(struct spdk_bdev_channel_iter *i, struct spdk_bdev *bd
 	spdk_json_write_object_begin(w);
 	spdk_json_write_named_uint64(w, "thread_id", spdk_thread_get_id(spdk_get_thread()));
 	spdk_bdev_dump_io_stat_json(bdev_ctx->stat, w);
+	bdev_channel_dump_latency_slo_json(ch, w);
 	spdk_json_write_object_end(w);
 
 	spdk_bdev_for_each_channel_continue(i, 0);
@@ -789,6 +826,81 @@ SPDK_RPC_REGISTER("bdev_set_qd_sampling_period",
 		  rpc_bdev_set_qd_sampling_period,
 		  SPDK_RPC_RUNTIME)
 
+static void
+rpc_bdev_set_latency_slo_complete(void *cb_arg, int status)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (status != 0) {
+		spdk_jsonrpc_send_error_response_fmt(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						     "Failed to set latency SLO: %s",
+						     spdk_strerror(-status));
+		return;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+}
+
+static void
+rpc_bdev_set_latency_slo(struct spdk_jsonrpc_request *request,
+			 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_latency_slo_ctx req = {0};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_latency_slo_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_latency_slo_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_bdev_set_latency_slo(spdk_bdev_desc_get_bdev(desc), req.target_latency_us,
+				  req.max_queue_depth, rpc_bdev_set_latency_slo_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_set_latency_slo(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_set_latency_slo", rpc_bdev_set_latency_slo,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_set_span_sample_rate(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct rpc_bdev_set_span_sample_rate_ctx req = {0};
+
+	if (spdk_json_decode_object(params, rpc_bdev_set_span_sample_rate_decoders,
+				    SPDK_COUNTOF(rpc_bdev_set_span_sample_rate_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	spdk_bdev_set_span_sample_rate(req.sample_rate);
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_set_span_sample_rate(&req);
+}
+SPDK_RPC_REGISTER("bdev_set_span_sample_rate", rpc_bdev_set_span_sample_rate,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
 static void
 rpc_bdev_set_qos_limit_complete(void *cb_arg, int status)
 {
@@ -861,6 +973,174 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_set_qos_limit", rpc_bdev_set_qos_limit, SPDK_RPC_RUNTIME)
 
+static void
+rpc_bdev_qos_group_create(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_create_ctx req = {.weight = 1};
+	struct spdk_bdev_qos_group_opts opts;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_create_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	spdk_bdev_qos_group_opts_init(&opts, sizeof(opts));
+	opts.parent = req.parent;
+	opts.weight = req.weight;
+	opts.min_read_ios_per_sec = req.min_read_ios_per_sec;
+	opts.limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = req.rw_ios_per_sec;
+	opts.limits[SPDK_BDEV_QOS_RW_BPS_RATE_LIMIT] = req.rw_mbytes_per_sec;
+	opts.limits[SPDK_BDEV_QOS_R_BPS_RATE_LIMIT] = req.r_mbytes_per_sec;
+	opts.limits[SPDK_BDEV_QOS_W_BPS_RATE_LIMIT] = req.w_mbytes_per_sec;
+
+	rc = spdk_bdev_qos_group_create(req.name, &opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_qos_group_create(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_create", rpc_bdev_qos_group_create,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_qos_group_delete(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_delete_ctx req = {};
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_delete_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_qos_group_delete(req.name);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_qos_group_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_delete", rpc_bdev_qos_group_delete, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_qos_group_add_bdev(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_add_bdev_ctx req = {};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_add_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_add_bdev_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.bdev_name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.bdev_name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_bdev_qos_group_add_bdev(req.name, spdk_bdev_desc_get_bdev(desc),
+				     rpc_bdev_set_qos_limit_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_qos_group_add_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_add_bdev", rpc_bdev_qos_group_add_bdev, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_qos_group_remove_bdev(struct spdk_jsonrpc_request *request,
+			       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_group_remove_bdev_ctx req = {};
+	struct spdk_bdev_desc *desc;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_qos_group_remove_bdev_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_group_remove_bdev_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	rc = spdk_bdev_open_ext(req.bdev_name, false, dummy_bdev_event_cb, NULL, &desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev '%s': %d\n", req.bdev_name, rc);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_bdev_qos_group_remove_bdev(spdk_bdev_desc_get_bdev(desc),
+					rpc_bdev_set_qos_limit_complete, request);
+
+	spdk_bdev_close(desc);
+
+cleanup:
+	free_rpc_bdev_qos_group_remove_bdev(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_group_remove_bdev", rpc_bdev_qos_group_remove_bdev, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_qos_get_groups(struct spdk_jsonrpc_request *request,
+			const struct spdk_json_val *params)
+{
+	struct rpc_bdev_qos_get_groups_ctx req = {};
+	struct spdk_json_write_ctx *w;
+
+	if (params != NULL &&
+	    spdk_json_decode_object(params, rpc_bdev_qos_get_groups_decoders,
+				    SPDK_COUNTOF(rpc_bdev_qos_get_groups_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	if (req.name != NULL && !bdev_qos_group_exists(req.name)) {
+		spdk_jsonrpc_send_error_response(request, -ENOENT, spdk_strerror(ENOENT));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	bdev_qos_groups_dump_json(w, req.name);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_qos_get_groups(&req);
+}
+SPDK_RPC_REGISTER("bdev_qos_get_groups", rpc_bdev_qos_get_groups, SPDK_RPC_RUNTIME)
+
 static void
 bdev_histogram_status_cb(void *cb_arg, int status)
 {
@@ -918,6 +1198,7 @@ rpc_bdev_enable_histogram(struct spdk_jsonrpc_request *request,
 	opts.granularity = req.granularity;
 	opts.min_nsec = req.min_nsec;
 	opts.max_nsec = req.max_nsec;
+	opts.per_io_class = req.per_io_class;
 
 	spdk_bdev_histogram_enable_ext(spdk_bdev_desc_get_bdev(desc), bdev_histogram_status_cb,
 				       request, req.enable, &opts);
@@ -1133,3 +1414,275 @@ cleanup:
 }
 
 SPDK_RPC_REGISTER("bdev_get_histogram_borders", rpc_bdev_get_histogram_borders, SPDK_RPC_RUNTIME)
+
+/* SPDK_RPC_GET_BDEV_IO_CLASS_HISTOGRAMS */
+
+static const char *g_histogram_io_type_names[SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES] = {
+	"read", "write", "unmap", "other"
+};
+
+static const char *g_histogram_size_class_names[SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES] = {
+	"4k", "8k-64k", "128k+"
+};
+
+static const double g_io_class_percentiles[] = {50, 90, 99, 99.9, 99.99, 100};
+static const char *g_io_class_percentile_names[] = {"p50", "p90", "p99", "p99.9", "p99.99", "max"};
+SPDK_STATIC_ASSERT(SPDK_COUNTOF(g_io_class_percentiles) == SPDK_COUNTOF(g_io_class_percentile_names),
+		   "Incorrect number of percentile names");
+
+struct rpc_io_class_histograms_ctx {
+	struct spdk_jsonrpc_request *request;
+	struct spdk_json_write_ctx *w;
+	struct spdk_bdev_desc **descs;
+	size_t num_descs;
+	size_t index;
+	struct spdk_bdev_io_class_histograms histograms;
+	int rc;
+};
+
+static void rpc_io_class_histograms_next(struct rpc_io_class_histograms_ctx *ctx);
+
+static void
+rpc_io_class_histograms_free(struct spdk_bdev_io_class_histograms *histograms)
+{
+	int type, size;
+
+	for (type = 0; type < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; type++) {
+		for (size = 0; size < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size++) {
+			spdk_histogram_data_free(histograms->histogram[type][size]);
+			histograms->histogram[type][size] = NULL;
+		}
+	}
+}
+
+static void
+rpc_io_class_histograms_start(struct rpc_io_class_histograms_ctx *ctx)
+{
+	if (ctx->w != NULL) {
+		return;
+	}
+
+	ctx->w = spdk_jsonrpc_begin_result(ctx->request);
+	spdk_json_write_object_begin(ctx->w);
+	spdk_json_write_named_uint64(ctx->w, "tsc_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_array_begin(ctx->w, "bdevs");
+}
+
+static void
+rpc_histogram_count_cb(void *cb_arg, uint64_t start, uint64_t end, uint64_t count,
+		       uint64_t total, uint64_t so_far)
+{
+	uint64_t *num_ios = cb_arg;
+
+	*num_ios += count;
+}
+
+static uint64_t
+rpc_ticks_to_nsec(uint64_t ticks, uint64_t ticks_hz)
+{
+	/* Avoid overflowing for the large values of the last buckets */
+	return ticks / ticks_hz * SPDK_SEC_TO_NSEC + ticks % ticks_hz * SPDK_SEC_TO_NSEC / ticks_hz;
+}
+
+static void
+rpc_dump_io_class_histograms(struct rpc_io_class_histograms_ctx *ctx, struct spdk_bdev *bdev)
+{
+	struct spdk_json_write_ctx *w = ctx->w;
+	struct spdk_histogram_data *histogram;
+	uint64_t values[SPDK_COUNTOF(g_io_class_percentiles)];
+	uint64_t num_ios, ticks_hz = spdk_get_ticks_hz();
+	int type, size;
+	size_t i;
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(bdev));
+	spdk_json_write_named_array_begin(w, "classes");
+
+	for (type = 0; type < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; type++) {
+		for (size = 0; size < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size++) {
+			histogram = ctx->histograms.histogram[type][size];
+
+			num_ios = 0;
+			spdk_histogram_data_iterate(histogram, rpc_histogram_count_cb, &num_ios);
+			if (num_ios == 0) {
+				continue;
+			}
+
+			spdk_histogram_data_get_percentiles(histogram, g_io_class_percentiles,
+							    values, SPDK_COUNTOF(values));
+
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_string(w, "io_type", g_histogram_io_type_names[type]);
+			spdk_json_write_named_string(w, "size_class",
+						     g_histogram_size_class_names[size]);
+			spdk_json_write_named_uint64(w, "count", num_ios);
+			spdk_json_write_named_object_begin(w, "latency_ns");
+			for (i = 0; i < SPDK_COUNTOF(g_io_class_percentiles); i++) {
+				spdk_json_write_named_uint64(w, g_io_class_percentile_names[i],
+							     rpc_ticks_to_nsec(values[i], ticks_hz));
+			}
+			spdk_json_write_object_end(w);
+			spdk_json_write_object_end(w);
+		}
+	}
+
+	spdk_json_write_array_end(w);
+	spdk_json_write_object_end(w);
+}
+
+static void
+rpc_io_class_histograms_done(void *cb_arg, int status)
+{
+	struct rpc_io_class_histograms_ctx *ctx = cb_arg;
+	struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(ctx->descs[ctx->index]);
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to get I/O class histograms of bdev %s: %s\n",
+			    spdk_bdev_get_name(bdev), spdk_strerror(-status));
+		if (ctx->rc == 0) {
+			ctx->rc = status;
+		}
+	} else {
+		rpc_io_class_histograms_start(ctx);
+		rpc_dump_io_class_histograms(ctx, bdev);
+	}
+
+	rpc_io_class_histograms_free(&ctx->histograms);
+	spdk_bdev_close(ctx->descs[ctx->index]);
+	ctx->index++;
+
+	rpc_io_class_histograms_next(ctx);
+}
+
+static void
+rpc_io_class_histograms_next(struct rpc_io_class_histograms_ctx *ctx)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_histogram_data *histogram;
+	int type, size;
+
+	while (ctx->index < ctx->num_descs) {
+		bdev = spdk_bdev_desc_get_bdev(ctx->descs[ctx->index]);
+
+		for (type = 0; type < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; type++) {
+			for (size = 0; size < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; size++) {
+				histogram = spdk_histogram_data_alloc_sized_ext(bdev->internal.histogram_granularity,
+						bdev->internal.histogram_min_val,
+						bdev->internal.histogram_max_val);
+				if (histogram == NULL) {
+					goto nomem;
+				}
+				ctx->histograms.histogram[type][size] = histogram;
+			}
+		}
+
+		spdk_bdev_histogram_get_io_classes(bdev, &ctx->histograms,
+						   rpc_io_class_histograms_done, ctx);
+		return;
+nomem:
+		rpc_io_class_histograms_free(&ctx->histograms);
+		if (ctx->rc == 0) {
+			ctx->rc = -ENOMEM;
+		}
+		spdk_bdev_close(ctx->descs[ctx->index]);
+		ctx->index++;
+	}
+
+	if (ctx->w == NULL && ctx->rc != 0) {
+		spdk_jsonrpc_send_error_response(ctx->request, ctx->rc, spdk_strerror(-ctx->rc));
+	} else {
+		rpc_io_class_histograms_start(ctx);
+		spdk_json_write_array_end(ctx->w);
+		spdk_json_write_object_end(ctx->w);
+		spdk_jsonrpc_end_result(ctx->request, ctx->w);
+	}
+
+	free(ctx->descs);
+	free(ctx);
+}
+
+static int
+rpc_io_class_histograms_add_bdev(void *_ctx, struct spdk_bdev *bdev)
+{
+	struct rpc_io_class_histograms_ctx *ctx = _ctx;
+	struct spdk_bdev_desc **descs;
+	int rc;
+
+	if (!bdev->internal.histogram_per_io_class) {
+		return 0;
+	}
+
+	descs = realloc(ctx->descs, (ctx->num_descs + 1) * sizeof(*descs));
+	if (descs == NULL) {
+		return -ENOMEM;
+	}
+	ctx->descs = descs;
+
+	rc = spdk_bdev_open_ext(spdk_bdev_get_name(bdev), false, dummy_bdev_event_cb, NULL,
+				&ctx->descs[ctx->num_descs]);
+	if (rc != 0) {
+		return rc;
+	}
+	ctx->num_descs++;
+
+	return 0;
+}
+
+static void
+rpc_bdev_get_io_class_histograms(struct spdk_jsonrpc_request *request,
+				 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_get_io_class_histograms_ctx req = {};
+	struct rpc_io_class_histograms_ctx *ctx;
+	struct spdk_bdev *bdev;
+	size_t i;
+	int rc;
+
+	if (params != NULL && spdk_json_decode_object(params, rpc_bdev_get_io_class_histograms_decoders,
+			SPDK_COUNTOF(rpc_bdev_get_io_class_histograms_decoders),
+			&req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		goto cleanup;
+	}
+	ctx->request = request;
+
+	if (req.name != NULL) {
+		bdev = spdk_bdev_get_by_name(req.name);
+		if (bdev == NULL) {
+			rc = -ENODEV;
+		} else if (!bdev->internal.histogram_per_io_class) {
+			SPDK_ERRLOG("I/O class histograms are not enabled on bdev %s\n", req.name);
+			rc = -EINVAL;
+		} else {
+			rc = rpc_io_class_histograms_add_bdev(ctx, bdev);
+		}
+	} else {
+		rc = spdk_for_each_bdev(ctx, rpc_io_class_histograms_add_bdev);
+	}
+
+	if (rc != 0) {
+		for (i = 0; i < ctx->num_descs; i++) {
+			spdk_bdev_close(ctx->descs[i]);
+		}
+		free(ctx->descs);
+		free(ctx);
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	rpc_io_class_histograms_next(ctx);
+
+cleanup:
+	free_rpc_bdev_get_io_class_histograms(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_get_io_class_histograms", rpc_bdev_get_io_class_histograms,
+		  SPDK_RPC_RUNTIME)
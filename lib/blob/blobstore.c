@@ -26,6 +26,12 @@
 
 #define BLOB_CRC32C_INITIAL    0xffffffffUL
 
+/* Dirty load replays the md region in windows, each read with multiple I/Os in parallel */
+#define BS_LOAD_REPLAY_WINDOW_PAGES	1024
+#define BS_LOAD_REPLAY_IO_PAGES		32
+/* Period of the check for device ranges of a blob released, once I/O to the blob is frozen */
+#define BLOB_FREEZE_DEV_LBA_POLL_US	100
+
 static int bs_register_md_thread(struct spdk_blob_store *bs);
 static int bs_unregister_md_thread(struct spdk_blob_store *bs);
 static void blob_close_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno);
@@ -156,6 +162,69 @@ bs_release_cluster(struct spdk_blob_store *bs, uint32_t cluster_num)
 	bs->num_free_clusters++;
 }
 
+/* Reserve a batch of free clusters for allocations from a channel, so that used_lock is taken
+ * only once per batch.  Reserved clusters are still reported as free.  Once free clusters run
+ * low, a single cluster is reserved at a time, to avoid stranding them in idle channels.
+ */
+static void
+bs_channel_reserve_clusters(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+	uint32_t clusters[SPDK_BS_CHANNEL_RESERVED_CLUSTERS];
+	uint32_t i, num_clusters = SPDK_BS_CHANNEL_RESERVED_CLUSTERS;
+
+	assert(spdk_spin_held(&bs->used_lock));
+	assert(ch->num_reserved_clusters == 0);
+
+	if (bs->num_free_clusters < 8 * SPDK_BS_CHANNEL_RESERVED_CLUSTERS) {
+		num_clusters = 1;
+	}
+
+	for (i = 0; i < num_clusters; i++) {
+		clusters[i] = bs_claim_cluster(bs);
+		if (clusters[i] == UINT32_MAX) {
+			break;
+		}
+	}
+
+	/* Clusters are handed out from the end, lowest first */
+	for (ch->num_reserved_clusters = 0; ch->num_reserved_clusters < i; ch->num_reserved_clusters++) {
+		ch->reserved_clusters[ch->num_reserved_clusters] = clusters[i - 1 - ch->num_reserved_clusters];
+	}
+	__atomic_fetch_add(&bs->num_reserved_clusters, i, __ATOMIC_RELAXED);
+}
+
+/* Return the clusters reserved by a channel to used_clusters */
+static void
+bs_channel_release_clusters(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+
+	assert(spdk_spin_held(&bs->used_lock));
+
+	__atomic_fetch_sub(&bs->num_reserved_clusters, ch->num_reserved_clusters, __ATOMIC_RELAXED);
+	while (ch->num_reserved_clusters > 0) {
+		bs_release_cluster(bs, ch->reserved_clusters[--ch->num_reserved_clusters]);
+	}
+}
+
+static uint32_t
+bs_channel_claim_cluster(struct spdk_bs_channel *ch)
+{
+	if (ch->num_reserved_clusters == 0) {
+		spdk_spin_lock(&ch->bs->used_lock);
+		bs_channel_reserve_clusters(ch);
+		spdk_spin_unlock(&ch->bs->used_lock);
+		if (ch->num_reserved_clusters == 0) {
+			return UINT32_MAX;
+		}
+	}
+
+	__atomic_fetch_sub(&ch->bs->num_reserved_clusters, 1, __ATOMIC_RELAXED);
+
+	return ch->reserved_clusters[--ch->num_reserved_clusters];
+}
+
 static int
 blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t cluster)
 {
@@ -173,6 +242,26 @@ blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t clust
 	return 0;
 }
 
+static int
+bs_claim_extent_page(struct spdk_blob_store *bs, uint32_t *lowest_free_md_page)
+{
+	assert(spdk_spin_held(&bs->used_lock));
+
+	/* Extent page shall never occupy md_page so start the search from 1 */
+	if (*lowest_free_md_page == 0) {
+		*lowest_free_md_page = 1;
+	}
+	*lowest_free_md_page = spdk_bit_array_find_first_clear(bs->used_md_pages,
+			       *lowest_free_md_page);
+	if (*lowest_free_md_page == UINT32_MAX) {
+		/* No more free md pages. Cannot satisfy the request */
+		return -ENOSPC;
+	}
+	bs_claim_md_page(bs, *lowest_free_md_page);
+
+	return 0;
+}
+
 static int
 bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 		    uint64_t *cluster, uint32_t *lowest_free_md_page, bool update_map)
@@ -189,20 +278,10 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 
 	if (blob->use_extent_table) {
 		extent_page = bs_cluster_to_extent_page(blob, cluster_num);
-		if (*extent_page == 0) {
-			/* Extent page shall never occupy md_page so start the search from 1 */
-			if (*lowest_free_md_page == 0) {
-				*lowest_free_md_page = 1;
-			}
-			/* No extent_page is allocated for the cluster */
-			*lowest_free_md_page = spdk_bit_array_find_first_clear(blob->bs->used_md_pages,
-					       *lowest_free_md_page);
-			if (*lowest_free_md_page == UINT32_MAX) {
-				/* No more free md pages. Cannot satisfy the request */
-				bs_release_cluster(blob->bs, *cluster);
-				return -ENOSPC;
-			}
-			bs_claim_md_page(blob->bs, *lowest_free_md_page);
+		/* No extent_page is allocated for the cluster */
+		if (*extent_page == 0 && bs_claim_extent_page(blob->bs, lowest_free_md_page) != 0) {
+			bs_release_cluster(blob->bs, *cluster);
+			return -ENOSPC;
 		}
 	}
 
@@ -219,6 +298,40 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 	return 0;
 }
 
+/* Allocate a cluster from the channel's reservation for a write to a thin provisioned blob.
+ * used_lock is only taken to refill the reservation or to claim a new extent page.  The
+ * cluster map itself is still updated on the md thread.
+ */
+static int
+bs_channel_allocate_cluster(struct spdk_bs_channel *ch, struct spdk_blob *blob,
+			    uint32_t cluster_num, uint64_t *cluster, uint32_t *lowest_free_md_page)
+{
+	int rc;
+
+	*cluster = bs_channel_claim_cluster(ch);
+	if (*cluster == UINT32_MAX) {
+		/* No more free clusters. Cannot satisfy the request */
+		return -ENOSPC;
+	}
+
+	if (blob->use_extent_table && *bs_cluster_to_extent_page(blob, cluster_num) == 0) {
+		spdk_spin_lock(&blob->bs->used_lock);
+		rc = bs_claim_extent_page(blob->bs, lowest_free_md_page);
+		if (rc != 0) {
+			bs_release_cluster(blob->bs, *cluster);
+		}
+		spdk_spin_unlock(&blob->bs->used_lock);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	SPDK_DEBUGLOG(blob, "Claiming cluster %" PRIu64 " for blob 0x%" PRIx64 "\n", *cluster,
+		      blob->id);
+
+	return 0;
+}
+
 static void
 blob_xattrs_init(struct spdk_blob_xattr_opts *xattrs)
 {
@@ -482,6 +595,7 @@ blob_set_back_bs_dev(struct spdk_blob *blob, struct spdk_bs_dev *back_bs_dev,
 struct freeze_io_ctx {
 	struct spdk_bs_cpl cpl;
 	struct spdk_blob *blob;
+	struct spdk_poller *poller;
 };
 
 static void
@@ -523,6 +637,41 @@ blob_io_cpl(struct spdk_io_channel_iter *i, int status)
 	free(ctx);
 }
 
+static int
+blob_freeze_io_poll(void *arg)
+{
+	struct freeze_io_ctx *ctx = arg;
+
+	if (__atomic_load_n(&ctx->blob->dev_lba_refcnt, __ATOMIC_ACQUIRE) > 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_poller_unregister(&ctx->poller);
+	ctx->cpl.u.blob_basic.cb_fn(ctx->cpl.u.blob_basic.cb_arg, 0);
+	free(ctx);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+blob_freeze_io_cpl(struct spdk_io_channel_iter *i, int status)
+{
+	struct freeze_io_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_blob *blob = ctx->blob;
+
+	/* No channel hands out device LBAs anymore, wait for the ones handed out to be released */
+	if (__atomic_load_n(&blob->dev_lba_refcnt, __ATOMIC_ACQUIRE) > 0) {
+		ctx->poller = SPDK_POLLER_REGISTER(blob_freeze_io_poll, ctx,
+						   BLOB_FREEZE_DEV_LBA_POLL_US);
+		if (ctx->poller == NULL) {
+			spdk_for_each_channel(blob->bs, blob_io_sync, ctx, blob_freeze_io_cpl);
+		}
+		return;
+	}
+
+	blob_io_cpl(i, status);
+}
+
 static void
 blob_freeze_io(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
 {
@@ -544,7 +693,7 @@ blob_freeze_io(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg
 	/* Freeze I/O on blob */
 	blob->frozen_refcnt++;
 
-	spdk_for_each_channel(blob->bs, blob_io_sync, ctx, blob_io_cpl);
+	spdk_for_each_channel(blob->bs, blob_io_sync, ctx, blob_freeze_io_cpl);
 }
 
 static void
@@ -2291,6 +2440,7 @@ blob_resize(struct spdk_blob *blob, uint64_t sz)
 	 */
 	if (sz > num_clusters && spdk_blob_is_thin_provisioned(blob) == false) {
 		spdk_spin_lock(&bs->used_lock);
+		bs_channel_release_clusters(spdk_io_channel_get_ctx(bs->md_channel));
 		if ((sz - num_clusters) > bs->num_free_clusters) {
 			rc = -ENOSPC;
 			goto out;
@@ -2859,6 +3009,81 @@ blob_copy(struct spdk_blob_copy_cluster_ctx *ctx, spdk_bs_user_op_t *op, uint64_
 			     blob_write_copy_cpl, ctx);
 }
 
+static void
+bs_channel_reclaim_clusters(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+
+	spdk_spin_lock(&ch->bs->used_lock);
+	bs_channel_release_clusters(ch);
+	spdk_spin_unlock(&ch->bs->used_lock);
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+bs_channel_reclaim_clusters_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bs_channel *ch = spdk_io_channel_iter_get_ctx(i);
+	TAILQ_HEAD(, spdk_bs_request_set) requests;
+	spdk_bs_user_op_t *op;
+
+	TAILQ_INIT(&requests);
+	TAILQ_SWAP(&ch->need_cluster_alloc, &requests, spdk_bs_request_set, link);
+
+	/* Retry the allocations, but fail them if the pool is still empty */
+	ch->clusters_reclaimed = true;
+	while (!TAILQ_EMPTY(&requests)) {
+		op = TAILQ_FIRST(&requests);
+		TAILQ_REMOVE(&requests, op, link);
+		bs_user_op_execute(op);
+	}
+	ch->clusters_reclaimed = false;
+}
+
+struct spdk_bs_reclaim_ctx {
+	spdk_blob_op_complete	cb_fn;
+	void			*cb_arg;
+};
+
+static void
+bs_reclaim_reserved_clusters_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_bs_reclaim_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->cb_arg, status);
+	free(ctx);
+}
+
+/* Return the clusters reserved by every channel to used_clusters.  Thick provisioned
+ * allocations claim clusters from used_clusters only, so they need this before failing with
+ * ENOSPC while spdk_bs_free_cluster_count() still reports enough free clusters.
+ */
+static void
+bs_reclaim_reserved_clusters(struct spdk_blob_store *bs, spdk_blob_op_complete cb_fn,
+			     void *cb_arg)
+{
+	struct spdk_bs_reclaim_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	spdk_for_each_channel(bs, bs_channel_reclaim_clusters, ctx,
+			      bs_reclaim_reserved_clusters_done);
+}
+
+static bool
+bs_has_reserved_clusters(struct spdk_blob_store *bs)
+{
+	return __atomic_load_n(&bs->num_reserved_clusters, __ATOMIC_RELAXED) > 0;
+}
+
 static void
 bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 			     struct spdk_io_channel *_ch,
@@ -2929,13 +3154,20 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 		}
 	}
 
-	spdk_spin_lock(&blob->bs->used_lock);
-	rc = bs_allocate_cluster(blob, cluster_number, &ctx->new_cluster, &ctx->new_extent_page,
-				 false);
-	spdk_spin_unlock(&blob->bs->used_lock);
+	rc = bs_channel_allocate_cluster(ch, blob, cluster_number, &ctx->new_cluster,
+					 &ctx->new_extent_page);
 	if (rc != 0) {
 		spdk_free(ctx->buf);
 		free(ctx);
+		if (rc == -ENOSPC && !ch->clusters_reclaimed && bs_has_reserved_clusters(blob->bs)) {
+			/* Other channels still hold reserved clusters.  Return them to the pool
+			 * and retry, holding back the next allocations on this channel meanwhile.
+			 */
+			TAILQ_INSERT_TAIL(&ch->need_cluster_alloc, op, link);
+			spdk_for_each_channel(blob->bs, bs_channel_reclaim_clusters, ch,
+					      bs_channel_reclaim_clusters_done);
+			return;
+		}
 		bs_user_op_abort(op, rc);
 		return;
 	}
@@ -3412,7 +3644,8 @@ rw_iov_split_next(void *cb_arg, int bserrno)
 	}
 
 	io_unit_offset = ctx->io_unit_offset;
-	io_units_to_boundary = bs_num_io_units_to_cluster_boundary(blob, io_unit_offset);
+	io_units_to_boundary = bs_num_io_units_contiguous(blob, io_unit_offset,
+			       ctx->io_units_remaining);
 	io_units_count = spdk_min(ctx->io_units_remaining, io_units_to_boundary);
 	/*
 	 * Get index and offset into the original iov array for our current position in the I/O sequence.
@@ -3503,7 +3736,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 	 *  in a batch.  That would also require creating an intermediate spdk_bs_cpl that would get called
 	 *  when the batch was completed, to allow for freeing the memory for the iov arrays.
 	 */
-	if (spdk_likely(length <= bs_num_io_units_to_cluster_boundary(blob, offset))) {
+	if (spdk_likely(length <= bs_num_io_units_contiguous(blob, offset, length))) {
 		uint64_t lba_count;
 		uint64_t lba;
 		bool is_allocated;
@@ -3725,6 +3958,10 @@ bs_channel_destroy(void *io_device, void *ctx_buf)
 
 	blob_esnap_destroy_bs_channel(channel);
 
+	spdk_spin_lock(&channel->bs->used_lock);
+	bs_channel_release_clusters(channel);
+	spdk_spin_unlock(&channel->bs->used_lock);
+
 	free(channel->req_mem);
 	spdk_free(channel->new_cluster_page);
 	spdk_free(channel->release_cluster_page);
@@ -3929,11 +4166,18 @@ struct spdk_bs_load_ctx {
 	struct spdk_bs_super_block	*super;
 
 	struct spdk_bs_md_mask		*mask;
-	bool				in_page_chain;
-	uint32_t			page_index;
 	uint32_t			cur_page;
 	struct spdk_blob_md_page	*page;
 
+	/* Window of the md region being replayed after a dirty shutdown */
+	void				*md_window;
+	uint32_t			window_start;
+	uint32_t			window_len;
+	/* Pages continuing md page chains outside of the window */
+	uint32_t			*chain_page_num;
+	uint32_t			num_chain_pages;
+	void				*chain_pages;
+
 	uint64_t			num_extent_pages;
 	uint32_t			*extent_page_num;
 	struct spdk_blob_md_page	*extent_pages;
@@ -4723,10 +4967,9 @@ bs_load_cur_extent_page_valid(struct spdk_blob_md_page *page)
 }
 
 static bool
-bs_load_cur_md_page_valid(struct spdk_bs_load_ctx *ctx)
+bs_load_md_page_valid(struct spdk_blob_md_page *page, uint32_t page_num)
 {
 	uint32_t crc;
-	struct spdk_blob_md_page *page = ctx->page;
 
 	crc = blob_md_page_calc_crc(page);
 	if (crc != page->crc) {
@@ -4735,7 +4978,7 @@ bs_load_cur_md_page_valid(struct spdk_bs_load_ctx *ctx)
 
 	/* First page of a sequence should match the blobid. */
 	if (page->sequence_num == 0 &&
-	    bs_page_to_blobid(ctx->cur_page) != page->id) {
+	    bs_page_to_blobid(page_num) != page->id) {
 		return false;
 	}
 	assert(bs_load_cur_extent_page_valid(page) == false);
@@ -4743,7 +4986,7 @@ bs_load_cur_md_page_valid(struct spdk_bs_load_ctx *ctx)
 	return true;
 }
 
-static void bs_load_replay_cur_md_page(struct spdk_bs_load_ctx *ctx);
+static void bs_load_replay_md_window(struct spdk_bs_load_ctx *ctx);
 
 static void
 bs_load_write_used_clusters_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
@@ -4800,30 +5043,45 @@ bs_load_write_used_md(struct spdk_bs_load_ctx *ctx)
 }
 
 static void
-bs_load_replay_md_chain_cpl(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_md_fail(struct spdk_bs_load_ctx *ctx, int bserrno)
+{
+	spdk_free(ctx->md_window);
+	spdk_free(ctx->chain_pages);
+	spdk_free(ctx->extent_pages);
+	free(ctx->chain_page_num);
+	free(ctx->extent_page_num);
+	bs_load_ctx_fail(ctx, bserrno);
+}
+
+static void
+bs_load_replay_md_done(struct spdk_bs_load_ctx *ctx)
 {
 	uint64_t num_md_clusters;
 	uint64_t i;
 
-	ctx->in_page_chain = false;
+	/* Claim all of the clusters used by the metadata */
+	num_md_clusters = spdk_divide_round_up(
+				  ctx->super->md_start + ctx->super->md_len, ctx->bs->pages_per_cluster);
+	for (i = 0; i < num_md_clusters; i++) {
+		spdk_bit_array_set(ctx->used_clusters, i);
+	}
+	ctx->bs->num_free_clusters -= num_md_clusters;
 
-	do {
-		ctx->page_index++;
-	} while (spdk_bit_array_get(ctx->bs->used_md_pages, ctx->page_index) == true);
+	spdk_free(ctx->md_window);
+	ctx->md_window = NULL;
+	free(ctx->chain_page_num);
+	ctx->chain_page_num = NULL;
+	bs_load_write_used_md(ctx);
+}
 
-	if (ctx->page_index < ctx->super->md_len) {
-		ctx->cur_page = ctx->page_index;
-		bs_load_replay_cur_md_page(ctx);
+static void
+bs_load_replay_md_window_done(struct spdk_bs_load_ctx *ctx)
+{
+	ctx->window_start += ctx->window_len;
+	if (ctx->window_start < ctx->super->md_len) {
+		bs_load_replay_md_window(ctx);
 	} else {
-		/* Claim all of the clusters used by the metadata */
-		num_md_clusters = spdk_divide_round_up(
-					  ctx->super->md_start + ctx->super->md_len, ctx->bs->pages_per_cluster);
-		for (i = 0; i < num_md_clusters; i++) {
-			spdk_bit_array_set(ctx->used_clusters, i);
-		}
-		ctx->bs->num_free_clusters -= num_md_clusters;
-		spdk_free(ctx->page);
-		bs_load_write_used_md(ctx);
+		bs_load_replay_md_done(ctx);
 	}
 }
 
@@ -4835,8 +5093,7 @@ bs_load_replay_extent_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrn
 	uint64_t i;
 
 	if (bserrno != 0) {
-		spdk_free(ctx->extent_pages);
-		bs_load_ctx_fail(ctx, bserrno);
+		bs_load_replay_md_fail(ctx, bserrno);
 		return;
 	}
 
@@ -4844,28 +5101,28 @@ bs_load_replay_extent_page_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrn
 		/* Extent pages are only read when present within in chain md.
 		 * Integrity of md is not right if that page was not a valid extent page. */
 		if (bs_load_cur_extent_page_valid(&ctx->extent_pages[i]) != true) {
-			spdk_free(ctx->extent_pages);
-			bs_load_ctx_fail(ctx, -EILSEQ);
+			bs_load_replay_md_fail(ctx, -EILSEQ);
 			return;
 		}
 
 		page_num = ctx->extent_page_num[i];
 		spdk_bit_array_set(ctx->bs->used_md_pages, page_num);
 		if (bs_load_replay_md_parse_page(ctx, &ctx->extent_pages[i])) {
-			spdk_free(ctx->extent_pages);
-			bs_load_ctx_fail(ctx, -EILSEQ);
+			bs_load_replay_md_fail(ctx, -EILSEQ);
 			return;
 		}
 	}
 
 	spdk_free(ctx->extent_pages);
+	ctx->extent_pages = NULL;
 	free(ctx->extent_page_num);
 	ctx->extent_page_num = NULL;
 	ctx->num_extent_pages = 0;
 
-	bs_load_replay_md_chain_cpl(ctx);
+	bs_load_replay_md_window_done(ctx);
 }
 
+/* Read the extent pages of all blobs found in the window with a single batch */
 static void
 bs_load_replay_extent_pages(struct spdk_bs_load_ctx *ctx)
 {
@@ -4874,10 +5131,15 @@ bs_load_replay_extent_pages(struct spdk_bs_load_ctx *ctx)
 	uint64_t lba;
 	uint64_t i;
 
+	if (ctx->num_extent_pages == 0) {
+		bs_load_replay_md_window_done(ctx);
+		return;
+	}
+
 	ctx->extent_pages = spdk_zmalloc(ctx->super->md_page_size * ctx->num_extent_pages, 0,
 					 NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
 	if (!ctx->extent_pages) {
-		bs_load_ctx_fail(ctx, -ENOMEM);
+		bs_load_replay_md_fail(ctx, -ENOMEM);
 		return;
 	}
 
@@ -4894,72 +5156,203 @@ bs_load_replay_extent_pages(struct spdk_bs_load_ctx *ctx)
 	bs_batch_close(batch);
 }
 
+static inline struct spdk_blob_md_page *
+bs_load_replay_buf_page(struct spdk_bs_load_ctx *ctx, void *buf, uint32_t idx)
+{
+	return (struct spdk_blob_md_page *)((uint8_t *)buf + (uint64_t)idx * ctx->bs->md_page_size);
+}
+
+/* Replay the chain of md pages starting at page, for as long as the pages are in the window.
+ * Returns the number of the next page of the chain that has to be read, or
+ * SPDK_INVALID_MD_PAGE if the chain ends.
+ */
+static int
+bs_load_replay_md_chain(struct spdk_bs_load_ctx *ctx, struct spdk_blob_md_page *page,
+			uint32_t page_num, uint32_t *next)
+{
+	*next = SPDK_INVALID_MD_PAGE;
+
+	while (true) {
+		spdk_spin_lock(&ctx->bs->used_lock);
+		bs_claim_md_page(ctx->bs, page_num);
+		spdk_spin_unlock(&ctx->bs->used_lock);
+		if (page->sequence_num == 0) {
+			SPDK_NOTICELOG("Recover: blob 0x%" PRIx32 "\n", page_num);
+			spdk_bit_array_set(ctx->bs->used_blobids, page_num);
+		}
+		if (bs_load_replay_md_parse_page(ctx, page)) {
+			return -EILSEQ;
+		}
+
+		page_num = page->next;
+		if (page_num == SPDK_INVALID_MD_PAGE || page_num >= ctx->super->md_len) {
+			return 0;
+		}
+
+		if (page_num < ctx->window_start || page_num >= ctx->window_start + ctx->window_len) {
+			*next = page_num;
+			return 0;
+		}
+
+		page = bs_load_replay_buf_page(ctx, ctx->md_window, page_num - ctx->window_start);
+		if (spdk_bit_array_get(ctx->bs->used_md_pages, page_num) ||
+		    !bs_load_md_page_valid(page, page_num)) {
+			return 0;
+		}
+	}
+}
+
+static void bs_load_replay_chain_pages(struct spdk_bs_load_ctx *ctx);
+
 static void
-bs_load_replay_md_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+bs_load_replay_chain_pages_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
 	struct spdk_bs_load_ctx *ctx = cb_arg;
-	uint32_t page_num;
 	struct spdk_blob_md_page *page;
+	uint32_t i, num_chain_pages = 0;
+	uint32_t page_num, next;
 
 	if (bserrno != 0) {
-		bs_load_ctx_fail(ctx, bserrno);
+		bs_load_replay_md_fail(ctx, bserrno);
 		return;
 	}
 
-	page_num = ctx->cur_page;
-	page = ctx->page;
-	if (bs_load_cur_md_page_valid(ctx) == true) {
-		if (page->sequence_num == 0 || ctx->in_page_chain == true) {
-			spdk_spin_lock(&ctx->bs->used_lock);
-			bs_claim_md_page(ctx->bs, page_num);
-			spdk_spin_unlock(&ctx->bs->used_lock);
-			if (page->sequence_num == 0) {
-				SPDK_NOTICELOG("Recover: blob 0x%" PRIx32 "\n", page_num);
-				spdk_bit_array_set(ctx->bs->used_blobids, page_num);
-			}
-			if (bs_load_replay_md_parse_page(ctx, page)) {
-				bs_load_ctx_fail(ctx, -EILSEQ);
-				return;
-			}
-			if (page->next != SPDK_INVALID_MD_PAGE) {
-				ctx->in_page_chain = true;
-				ctx->cur_page = page->next;
-				bs_load_replay_cur_md_page(ctx);
-				return;
-			}
-			if (ctx->num_extent_pages != 0) {
-				bs_load_replay_extent_pages(ctx);
-				return;
-			}
+	/* Each chain continues with at most one page, so the list is compacted in place */
+	for (i = 0; i < ctx->num_chain_pages; i++) {
+		page_num = ctx->chain_page_num[i];
+		page = bs_load_replay_buf_page(ctx, ctx->chain_pages, i);
+		if (spdk_bit_array_get(ctx->bs->used_md_pages, page_num) ||
+		    !bs_load_md_page_valid(page, page_num)) {
+			continue;
+		}
+
+		if (bs_load_replay_md_chain(ctx, page, page_num, &next)) {
+			bs_load_replay_md_fail(ctx, -EILSEQ);
+			return;
+		}
+		if (next != SPDK_INVALID_MD_PAGE) {
+			ctx->chain_page_num[num_chain_pages++] = next;
 		}
 	}
-	bs_load_replay_md_chain_cpl(ctx);
+
+	spdk_free(ctx->chain_pages);
+	ctx->chain_pages = NULL;
+	ctx->num_chain_pages = num_chain_pages;
+
+	bs_load_replay_chain_pages(ctx);
 }
 
+/* Read the pages continuing the chains outside of the window, one batch per chain link */
 static void
-bs_load_replay_cur_md_page(struct spdk_bs_load_ctx *ctx)
+bs_load_replay_chain_pages(struct spdk_bs_load_ctx *ctx)
 {
-	uint64_t lba;
+	spdk_bs_batch_t *batch;
+	uint32_t i;
 
-	assert(ctx->cur_page < ctx->super->md_len);
-	lba = bs_md_page_to_lba(ctx->bs, ctx->cur_page);
-	bs_sequence_read_dev(ctx->seq, ctx->page, lba,
-			     bs_byte_to_lba(ctx->bs, ctx->super->md_page_size),
-			     bs_load_replay_md_cpl, ctx);
+	if (ctx->num_chain_pages == 0) {
+		bs_load_replay_extent_pages(ctx);
+		return;
+	}
+
+	ctx->chain_pages = spdk_zmalloc((uint64_t)ctx->bs->md_page_size * ctx->num_chain_pages, 0,
+					NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (!ctx->chain_pages) {
+		bs_load_replay_md_fail(ctx, -ENOMEM);
+		return;
+	}
+
+	batch = bs_sequence_to_batch(ctx->seq, bs_load_replay_chain_pages_cpl, ctx);
+
+	for (i = 0; i < ctx->num_chain_pages; i++) {
+		bs_batch_read_dev(batch, bs_load_replay_buf_page(ctx, ctx->chain_pages, i),
+				  bs_md_page_to_lba(ctx->bs, ctx->chain_page_num[i]),
+				  bs_byte_to_lba(ctx->bs, ctx->bs->md_page_size));
+	}
+
+	bs_batch_close(batch);
+}
+
+static void
+bs_load_replay_md_window_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_bs_load_ctx *ctx = cb_arg;
+	struct spdk_blob_md_page *page;
+	uint32_t i, page_num, next;
+
+	if (bserrno != 0) {
+		bs_load_replay_md_fail(ctx, bserrno);
+		return;
+	}
+
+	ctx->num_chain_pages = 0;
+	for (i = 0; i < ctx->window_len; i++) {
+		page_num = ctx->window_start + i;
+		page = bs_load_replay_buf_page(ctx, ctx->md_window, i);
+
+		/* Only the first page of a blob starts a chain, the other pages are claimed through
+		 * the chain.
+		 */
+		if (spdk_bit_array_get(ctx->bs->used_md_pages, page_num) ||
+		    !bs_load_md_page_valid(page, page_num) || page->sequence_num != 0) {
+			continue;
+		}
+
+		if (bs_load_replay_md_chain(ctx, page, page_num, &next)) {
+			bs_load_replay_md_fail(ctx, -EILSEQ);
+			return;
+		}
+		if (next != SPDK_INVALID_MD_PAGE) {
+			ctx->chain_page_num[ctx->num_chain_pages++] = next;
+		}
+	}
+
+	bs_load_replay_chain_pages(ctx);
+}
+
+/* Read the next window of the md region with multiple I/Os outstanding */
+static void
+bs_load_replay_md_window(struct spdk_bs_load_ctx *ctx)
+{
+	spdk_bs_batch_t *batch;
+	uint32_t i, num_pages;
+
+	ctx->window_len = spdk_min(BS_LOAD_REPLAY_WINDOW_PAGES,
+				   ctx->super->md_len - ctx->window_start);
+
+	batch = bs_sequence_to_batch(ctx->seq, bs_load_replay_md_window_cpl, ctx);
+
+	for (i = 0; i < ctx->window_len; i += num_pages) {
+		num_pages = spdk_min(BS_LOAD_REPLAY_IO_PAGES, ctx->window_len - i);
+		bs_batch_read_dev(batch, bs_load_replay_buf_page(ctx, ctx->md_window, i),
+				  bs_md_page_to_lba(ctx->bs, ctx->window_start + i),
+				  bs_byte_to_lba(ctx->bs, (uint64_t)num_pages * ctx->bs->md_page_size));
+	}
+
+	bs_batch_close(batch);
 }
 
 static void
 bs_load_replay_md(struct spdk_bs_load_ctx *ctx)
 {
-	ctx->page_index = 0;
-	ctx->cur_page = 0;
-	ctx->page = spdk_zmalloc(ctx->bs->md_page_size, 0,
-				 NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
-	if (!ctx->page) {
-		bs_load_ctx_fail(ctx, -ENOMEM);
+	uint32_t window_pages = spdk_min(BS_LOAD_REPLAY_WINDOW_PAGES, ctx->super->md_len);
+
+	ctx->window_start = 0;
+	ctx->window_len = 0;
+	if (window_pages == 0) {
+		bs_load_replay_md_done(ctx);
 		return;
 	}
-	bs_load_replay_cur_md_page(ctx);
+
+	ctx->md_window = spdk_zmalloc((uint64_t)ctx->bs->md_page_size * window_pages, 0,
+				      NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	/* A window can't continue more chains than it has pages */
+	ctx->chain_page_num = calloc(window_pages, sizeof(uint32_t));
+	if (!ctx->md_window || !ctx->chain_page_num) {
+		bs_load_replay_md_fail(ctx, -ENOMEM);
+		return;
+	}
+
+	bs_load_replay_md_window(ctx);
 }
 
 static void
@@ -6018,6 +6411,11 @@ spdk_bs_unload(struct spdk_blob_store *bs, spdk_bs_op_complete cb_fn, void *cb_a
 		return;
 	}
 
+	/* Clusters reserved by the md thread channel must not be persisted as used */
+	spdk_spin_lock(&bs->used_lock);
+	bs_channel_release_clusters(spdk_io_channel_get_ctx(bs->md_channel));
+	spdk_spin_unlock(&bs->used_lock);
+
 	ctx = calloc(1, sizeof(*ctx));
 	if (!ctx) {
 		cb_fn(cb_arg, -ENOMEM);
@@ -6201,7 +6599,7 @@ spdk_bs_get_io_unit_size(struct spdk_blob_store *bs)
 uint64_t
 spdk_bs_free_cluster_count(struct spdk_blob_store *bs)
 {
-	return bs->num_free_clusters;
+	return bs->num_free_clusters + __atomic_load_n(&bs->num_reserved_clusters, __ATOMIC_RELAXED);
 }
 
 uint64_t
@@ -6290,6 +6688,49 @@ spdk_blob_get_next_unallocated_io_unit(struct spdk_blob *blob, uint64_t offset)
 	return blob_find_io_unit(blob, offset, false);
 }
 
+uint64_t
+spdk_blob_get_num_contiguous_io_units(struct spdk_blob *blob, uint64_t offset, uint64_t length)
+{
+	uint64_t blob_io_unit_num = spdk_blob_get_num_io_units(blob);
+
+	if (offset >= blob_io_unit_num) {
+		return 0;
+	}
+
+	length = spdk_min(length, blob_io_unit_num - offset);
+
+	return spdk_min(length, bs_num_io_units_contiguous(blob, offset, length));
+}
+
+int
+spdk_blob_get_dev_lba(struct spdk_blob *blob, uint64_t offset, uint64_t length, uint64_t *lba)
+{
+	if (length == 0 || offset + length > spdk_blob_get_num_io_units(blob)) {
+		return -EINVAL;
+	}
+
+	if (blob->frozen_refcnt) {
+		return -EBUSY;
+	}
+
+	if (!bs_io_unit_is_allocated(blob, offset) ||
+	    bs_num_io_units_contiguous(blob, offset, length) < length) {
+		return -ENODATA;
+	}
+
+	*lba = bs_blob_io_unit_to_lba(blob, offset);
+	__atomic_fetch_add(&blob->dev_lba_refcnt, 1, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+void
+spdk_blob_release_dev_lba(struct spdk_blob *blob)
+{
+	assert(__atomic_load_n(&blob->dev_lba_refcnt, __ATOMIC_RELAXED) > 0);
+	__atomic_fetch_sub(&blob->dev_lba_refcnt, 1, __ATOMIC_RELEASE);
+}
+
 /* START spdk_bs_create_blob */
 
 static void
@@ -6367,6 +6808,71 @@ blob_opts_copy(const struct spdk_blob_opts *src, struct spdk_blob_opts *dst)
 #undef SET_FIELD
 }
 
+static void
+bs_create_blob_fail(struct spdk_blob_store *bs, struct spdk_blob *blob, uint32_t page_idx,
+		    uint64_t num_clusters, int rc, spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	SPDK_ERRLOG("Failed to create blob: %s, size in clusters/size: %lu (clusters)\n",
+		    spdk_strerror(rc), num_clusters);
+	if (blob != NULL) {
+		blob_free(blob);
+	}
+	spdk_spin_lock(&bs->used_lock);
+	spdk_bit_array_clear(bs->used_blobids, page_idx);
+	bs_release_md_page(bs, page_idx);
+	spdk_spin_unlock(&bs->used_lock);
+	cb_fn(cb_arg, 0, rc);
+}
+
+static void
+bs_create_blob_persist(struct spdk_blob *blob, uint64_t num_clusters,
+		       spdk_blob_op_with_id_complete cb_fn, void *cb_arg)
+{
+	struct spdk_bs_cpl	cpl;
+	spdk_bs_sequence_t	*seq;
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
+	cpl.u.blobid.cb_fn = cb_fn;
+	cpl.u.blobid.cb_arg = cb_arg;
+	cpl.u.blobid.blobid = blob->id;
+
+	seq = bs_sequence_start_bs(blob->bs->md_channel, &cpl);
+	if (!seq) {
+		bs_create_blob_fail(blob->bs, blob, bs_blobid_to_page(blob->id), num_clusters,
+				    -ENOMEM, cb_fn, cb_arg);
+		return;
+	}
+
+	blob_persist(seq, blob, bs_create_blob_cpl, blob);
+}
+
+struct spdk_bs_create_ctx {
+	struct spdk_blob		*blob;
+	uint64_t			num_clusters;
+	spdk_blob_op_with_id_complete	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+bs_create_blob_reclaim_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_bs_create_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+
+	/* Retry with the clusters the channels had reserved back in used_clusters */
+	if (bserrno == 0) {
+		bserrno = blob_resize(blob, ctx->num_clusters);
+	}
+
+	if (bserrno == 0) {
+		bs_create_blob_persist(blob, ctx->num_clusters, ctx->cb_fn, ctx->cb_arg);
+	} else {
+		bs_create_blob_fail(blob->bs, blob, bs_blobid_to_page(blob->id), ctx->num_clusters,
+				    bserrno, ctx->cb_fn, ctx->cb_arg);
+	}
+	free(ctx);
+}
+
 static void
 bs_create_blob(struct spdk_blob_store *bs,
 	       const struct spdk_blob_opts *opts,
@@ -6375,10 +6881,9 @@ bs_create_blob(struct spdk_blob_store *bs,
 {
 	struct spdk_blob	*blob;
 	uint32_t		page_idx;
-	struct spdk_bs_cpl	cpl;
 	struct spdk_blob_opts	opts_local;
 	struct spdk_blob_xattr_opts internal_xattrs_default;
-	spdk_bs_sequence_t	*seq;
+	struct spdk_bs_create_ctx *ctx;
 	spdk_blob_id		id;
 	int rc;
 
@@ -6454,34 +6959,29 @@ bs_create_blob(struct spdk_blob_store *bs,
 	}
 
 	rc = blob_resize(blob, opts_local.num_clusters);
-	if (rc < 0) {
-		goto error;
-	}
-	cpl.type = SPDK_BS_CPL_TYPE_BLOBID;
-	cpl.u.blobid.cb_fn = cb_fn;
-	cpl.u.blobid.cb_arg = cb_arg;
-	cpl.u.blobid.blobid = blob->id;
+	if (rc == -ENOSPC && bs_has_reserved_clusters(bs)) {
+		ctx = calloc(1, sizeof(*ctx));
+		if (ctx == NULL) {
+			rc = -ENOMEM;
+			goto error;
+		}
 
-	seq = bs_sequence_start_bs(bs->md_channel, &cpl);
-	if (!seq) {
-		rc = -ENOMEM;
+		ctx->blob = blob;
+		ctx->num_clusters = opts_local.num_clusters;
+		ctx->cb_fn = cb_fn;
+		ctx->cb_arg = cb_arg;
+		bs_reclaim_reserved_clusters(bs, bs_create_blob_reclaim_cpl, ctx);
+		return;
+	}
+	if (rc < 0) {
 		goto error;
 	}
 
-	blob_persist(seq, blob, bs_create_blob_cpl, blob);
+	bs_create_blob_persist(blob, opts_local.num_clusters, cb_fn, cb_arg);
 	return;
 
 error:
-	SPDK_ERRLOG("Failed to create blob: %s, size in clusters/size: %lu (clusters)\n",
-		    spdk_strerror(rc), opts_local.num_clusters);
-	if (blob != NULL) {
-		blob_free(blob);
-	}
-	spdk_spin_lock(&bs->used_lock);
-	spdk_bit_array_clear(bs->used_blobids, page_idx);
-	bs_release_md_page(bs, page_idx);
-	spdk_spin_unlock(&bs->used_lock);
-	cb_fn(cb_arg, 0, rc);
+	bs_create_blob_fail(bs, blob, page_idx, opts_local.num_clusters, rc, cb_fn, cb_arg);
 }
 
 void
@@ -7288,7 +7788,12 @@ bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 		}
 	}
 
-	if (clusters_needed > _blob->bs->num_free_clusters) {
+	spdk_spin_lock(&_blob->bs->used_lock);
+	bs_channel_release_clusters(spdk_io_channel_get_ctx(_blob->bs->md_channel));
+	spdk_spin_unlock(&_blob->bs->used_lock);
+
+	/* The clusters are allocated by the writes, which reclaim the channels' reservations */
+	if (clusters_needed > spdk_bs_free_cluster_count(_blob->bs)) {
 		/* Not enough free clusters. Cannot satisfy the request. */
 		bs_clone_snapshot_origblob_cleanup(ctx, -ENOSPC);
 		return;
@@ -8001,6 +8506,16 @@ bs_resize_unfreeze_cpl(void *cb_arg, int rc)
 	free(ctx);
 }
 
+static void
+bs_resize_reclaim_cpl(void *cb_arg, int rc)
+{
+	struct spdk_bs_resize_ctx *ctx = (struct spdk_bs_resize_ctx *)cb_arg;
+
+	ctx->rc = rc == 0 ? blob_resize(ctx->blob, ctx->sz) : rc;
+
+	blob_unfreeze_io(ctx->blob, bs_resize_unfreeze_cpl, ctx);
+}
+
 static void
 bs_resize_freeze_cpl(void *cb_arg, int rc)
 {
@@ -8014,6 +8529,10 @@ bs_resize_freeze_cpl(void *cb_arg, int rc)
 	}
 
 	ctx->rc = blob_resize(ctx->blob, ctx->sz);
+	if (ctx->rc == -ENOSPC && bs_has_reserved_clusters(ctx->blob->bs)) {
+		bs_reclaim_reserved_clusters(ctx->blob->bs, bs_resize_reclaim_cpl, ctx);
+		return;
+	}
 
 	blob_unfreeze_io(ctx->blob, bs_resize_unfreeze_cpl, ctx);
 }
@@ -8876,6 +9395,9 @@ struct spdk_blob_cluster_op_ctx {
 	/* for serializing concurrent cluster alloc/release operations on the same extent page */
 	spdk_msg_fn		msg_fn;
 	TAILQ_ENTRY(spdk_blob_cluster_op_ctx) link;
+
+	/* cluster insertions persisted together with this one by a single extent page write */
+	TAILQ_HEAD(, spdk_blob_cluster_op_ctx) batch;
 };
 
 static void
@@ -8972,6 +9494,21 @@ blob_op_cluster_msg_cb(void *arg, int bserrno)
 	spdk_thread_send_msg(ctx->thread, blob_op_cluster_msg_cpl, ctx);
 }
 
+static void
+blob_insert_cluster_batch_cb(void *arg, int bserrno)
+{
+	struct spdk_blob_cluster_op_ctx *ctx = arg;
+	struct spdk_blob_cluster_op_ctx *tmp;
+
+	while ((tmp = TAILQ_FIRST(&ctx->batch)) != NULL) {
+		TAILQ_REMOVE(&ctx->batch, tmp, link);
+		tmp->rc = bserrno;
+		spdk_thread_send_msg(tmp->thread, blob_op_cluster_msg_cpl, tmp);
+	}
+
+	blob_op_cluster_msg_cb(ctx, bserrno);
+}
+
 static void
 blob_insert_new_ep_cb(void *arg, int bserrno)
 {
@@ -8981,7 +9518,7 @@ blob_insert_new_ep_cb(void *arg, int bserrno)
 	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
 	*extent_page = ctx->extent_page;
 	ctx->blob->state = SPDK_BLOB_STATE_DIRTY;
-	blob_sync_md(ctx->blob, blob_op_cluster_msg_cb, ctx);
+	blob_sync_md(ctx->blob, blob_insert_cluster_batch_cb, ctx);
 }
 
 struct spdk_blob_write_extent_page_ctx {
@@ -9088,6 +9625,61 @@ blob_write_extent_page(struct spdk_blob *blob, uint32_t extent, uint64_t cluster
 	bs_mark_dirty(seq, blob->bs, blob_write_extent_page_ready, ctx);
 }
 
+static void blob_insert_cluster_msg(void *arg);
+
+static void
+blob_insert_cluster_release_ep(struct spdk_blob_cluster_op_ctx *ctx)
+{
+	if (ctx->extent_page != 0) {
+		spdk_spin_lock(&ctx->blob->bs->used_lock);
+		assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
+		bs_release_md_page(ctx->blob->bs, ctx->extent_page);
+		spdk_spin_unlock(&ctx->blob->bs->used_lock);
+		ctx->extent_page = 0;
+	}
+}
+
+/*
+ * Cluster insertions queued behind ctx on the same extent page were waiting for the previous
+ * write of that page to complete. Insert their clusters now too, so that the extent page
+ * written for ctx persists all of them, and complete them together with ctx.
+ * Queued frees stop the batch to keep the ordering of operations on the extent page.
+ */
+static void
+blob_insert_cluster_gather(struct spdk_blob_cluster_op_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_cluster_op_ctx *tmp, *next;
+	uint32_t table_id = bs_cluster_to_extent_table_id(ctx->cluster_num);
+	bool found = false;
+	int rc;
+
+	TAILQ_FOREACH_SAFE(tmp, &blob->cluster_op_queue, link, next) {
+		if (tmp == ctx) {
+			found = true;
+			continue;
+		}
+		if (!found || bs_cluster_to_extent_table_id(tmp->cluster_num) != table_id) {
+			continue;
+		}
+		if (tmp->msg_fn != blob_insert_cluster_msg) {
+			break;
+		}
+
+		TAILQ_REMOVE(&blob->cluster_op_queue, tmp, link);
+		rc = blob_insert_cluster(blob, tmp->cluster_num, tmp->cluster);
+		if (rc != 0) {
+			tmp->rc = rc;
+			spdk_thread_send_msg(tmp->thread, blob_op_cluster_msg_cpl, tmp);
+			continue;
+		}
+
+		/* The extent page written for ctx is used, release the one claimed for tmp. */
+		blob_insert_cluster_release_ep(tmp);
+		TAILQ_INSERT_TAIL(&ctx->batch, tmp, link);
+	}
+}
+
 static void
 blob_insert_cluster_msg(void *arg)
 {
@@ -9108,6 +9700,8 @@ blob_insert_cluster_msg(void *arg)
 		return;
 	}
 
+	blob_insert_cluster_gather(ctx);
+
 	extent_page = bs_cluster_to_extent_page(ctx->blob, ctx->cluster_num);
 	if (*extent_page == 0) {
 		/* Extent page requires allocation.
@@ -9120,17 +9714,11 @@ blob_insert_cluster_msg(void *arg)
 		/* It is possible for original thread to allocate extent page for
 		 * different cluster in the same extent page. In such case proceed with
 		 * updating the existing extent page, but release the additional one. */
-		if (ctx->extent_page != 0) {
-			spdk_spin_lock(&ctx->blob->bs->used_lock);
-			assert(spdk_bit_array_get(ctx->blob->bs->used_md_pages, ctx->extent_page) == true);
-			bs_release_md_page(ctx->blob->bs, ctx->extent_page);
-			spdk_spin_unlock(&ctx->blob->bs->used_lock);
-			ctx->extent_page = 0;
-		}
+		blob_insert_cluster_release_ep(ctx);
 		/* Extent page already allocated.
-		 * Every cluster allocation, requires just an update of single extent page. */
+		 * Every batch of cluster allocations requires just an update of single extent page. */
 		blob_write_extent_page(ctx->blob, *extent_page, ctx->cluster_num, ctx->page,
-				       blob_op_cluster_msg_cb, ctx);
+				       blob_insert_cluster_batch_cb, ctx);
 	}
 }
 
@@ -9156,6 +9744,7 @@ blob_insert_cluster_on_md_thread(struct spdk_blob *blob, uint32_t cluster_num,
 	ctx->cb_fn = cb_fn;
 	ctx->cb_arg = cb_arg;
 	ctx->msg_fn = blob_insert_cluster_msg;
+	TAILQ_INIT(&ctx->batch);
 
 	spdk_thread_send_msg(blob->bs->md_thread, _blob_cluster_op, ctx);
 }
@@ -9317,6 +9906,14 @@ spdk_bs_free_io_channel(struct spdk_io_channel *channel)
 	spdk_put_io_channel(channel);
 }
 
+struct spdk_io_channel *
+spdk_bs_get_dev_io_channel(struct spdk_io_channel *channel)
+{
+	struct spdk_bs_channel *bs_channel = spdk_io_channel_get_ctx(channel);
+
+	return bs_channel->dev_channel;
+}
+
 void
 spdk_blob_io_unmap(struct spdk_blob *blob, struct spdk_io_channel *channel,
 		   uint64_t offset, uint64_t length, spdk_blob_op_complete cb_fn, void *cb_arg)
@@ -138,6 +138,8 @@ struct spdk_blob {
 	RB_ENTRY(spdk_blob) link;
 
 	uint32_t frozen_refcnt;
+	/* Ranges of the device handed out by spdk_blob_get_dev_lba(), freeze waits for them */
+	uint32_t dev_lba_refcnt;
 	bool locked_operation_in_progress;
 	enum blob_clear_method clear_method;
 	bool extent_rle_found;
@@ -178,6 +180,8 @@ struct spdk_blob_store {
 	uint64_t			total_clusters;
 	uint64_t			total_data_clusters;
 	uint64_t			num_free_clusters;	/* Protected by used_lock */
+	/* Free clusters reserved by channels, updated atomically */
+	uint64_t			num_reserved_clusters;
 	uint64_t			pages_per_cluster;
 	uint64_t			io_units_per_cluster;
 	uint8_t				pages_per_cluster_shift;
@@ -207,6 +211,9 @@ struct spdk_blob_store {
 	void				*esnap_unload_cb_arg;
 };
 
+/* Number of free clusters a channel reserves at once for thin provisioning allocations */
+#define SPDK_BS_CHANNEL_RESERVED_CLUSTERS	16
+
 struct spdk_bs_channel {
 	struct spdk_bs_request_set	*req_mem;
 	TAILQ_HEAD(, spdk_bs_request_set) reqs;
@@ -227,6 +234,12 @@ struct spdk_bs_channel {
 
 	TAILQ_HEAD(, spdk_blob_free_cluster_ctx) pending_free_cluster;
 
+	/* Clusters claimed from used_clusters but not yet allocated, in descending order */
+	uint32_t			reserved_clusters[SPDK_BS_CHANNEL_RESERVED_CLUSTERS];
+	uint32_t			num_reserved_clusters;
+	/* Set while retrying allocations after other channels' reservations were reclaimed */
+	bool				clusters_reclaimed;
+
 	RB_HEAD(blob_esnap_channel_tree, blob_esnap_channel) esnap_channels;
 };
 
@@ -618,6 +631,33 @@ bs_num_io_units_to_cluster_boundary(struct spdk_blob *blob, uint64_t io_unit)
 	return io_units_per_cluster - (io_unit % io_units_per_cluster);
 }
 
+/* Given an io_unit offset into a blob, look up the number of io_units, up to length, that are
+ * allocated at consecutive LBAs on the blobstore device.  If the cluster containing the io_unit
+ * is not allocated, the number of io_units until the next cluster boundary is returned.
+ */
+static inline uint64_t
+bs_num_io_units_contiguous(struct spdk_blob *blob, uint64_t io_unit, uint64_t length)
+{
+	uint64_t	io_units = bs_num_io_units_to_cluster_boundary(blob, io_unit);
+	uint64_t	cluster = io_unit / bs_io_units_per_cluster(blob);
+	uint64_t	lba_per_cluster = bs_cluster_to_lba(blob->bs, 1);
+	uint64_t	lba;
+
+	lba = blob->active.clusters[cluster];
+	if (lba == 0) {
+		return io_units;
+	}
+
+	while (io_units < length && cluster + 1 < blob->active.num_clusters &&
+	       blob->active.clusters[cluster + 1] == lba + lba_per_cluster) {
+		io_units += bs_io_units_per_cluster(blob);
+		lba += lba_per_cluster;
+		cluster++;
+	}
+
+	return io_units;
+}
+
 /* Given an io_unit offset into a blob, look up the number of io_unit into blob to beginning of current cluster */
 static inline uint64_t
 bs_io_unit_to_cluster_start(struct spdk_blob *blob, uint64_t io_unit)
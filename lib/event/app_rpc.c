@@ -20,6 +20,8 @@
 #include "spdk_internal/rpc_autogen.h"
 #include "event_internal.h"
 
+#include <dlfcn.h>
+
 static void
 rpc_spdk_kill_instance(struct spdk_jsonrpc_request *request,
 		       const struct spdk_json_val *params)
@@ -187,6 +189,69 @@ rpc_get_poller(struct spdk_poller *poller, struct spdk_json_write_ctx *w)
 	if (period_ticks) {
 		spdk_json_write_named_uint64(w, "period_ticks", period_ticks);
 	}
+	if (stats.backoff_interval) {
+		spdk_json_write_named_uint64(w, "skip_count", stats.skip_count);
+		spdk_json_write_named_uint32(w, "backoff_interval", stats.backoff_interval);
+	}
+	if (spdk_thread_cycle_accounting_is_enabled()) {
+		spdk_json_write_named_uint64(w, "busy_tsc", stats.busy_tsc);
+		spdk_json_write_named_uint64(w, "idle_tsc", stats.idle_tsc);
+	}
+	spdk_json_write_object_end(w);
+}
+
+/*
+ * Most callbacks are static functions, missing from the dynamic symbol table, so name them by
+ * their object and offset instead, which addr2line resolves. Exported ones keep their symbol.
+ */
+static void
+rpc_get_callback_name(void *fn, char *buf, size_t len)
+{
+	Dl_info info;
+	const char *object;
+
+	if (dladdr(fn, &info) == 0 || info.dli_fname == NULL) {
+		snprintf(buf, len, "%p", fn);
+		return;
+	}
+
+	if (info.dli_sname != NULL && info.dli_saddr == fn) {
+		snprintf(buf, len, "%s", info.dli_sname);
+		return;
+	}
+
+	object = strrchr(info.dli_fname, '/');
+	object = object != NULL ? object + 1 : info.dli_fname;
+	snprintf(buf, len, "%s+0x%" PRIxPTR, object, (uintptr_t)fn - (uintptr_t)info.dli_fbase);
+}
+
+static void
+rpc_get_callback(const struct spdk_thread_callback_stats *stats, void *ctx)
+{
+	struct spdk_json_write_ctx *w = ctx;
+	char name[128];
+
+	if (stats->fn != NULL) {
+		rpc_get_callback_name(stats->fn, name, sizeof(name));
+	} else {
+		snprintf(name, sizeof(name), "other");
+	}
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", name);
+	switch (stats->type) {
+	case SPDK_THREAD_CALLBACK_MSG:
+		spdk_json_write_named_string(w, "type", "msg");
+		break;
+	case SPDK_THREAD_CALLBACK_INTERRUPT:
+		spdk_json_write_named_string(w, "type", "interrupt");
+		break;
+	default:
+		spdk_json_write_named_string(w, "type", "other");
+		break;
+	}
+	spdk_json_write_named_uint64(w, "run_count", stats->run_count);
+	spdk_json_write_named_uint64(w, "tsc", stats->tsc);
 	spdk_json_write_object_end(w);
 }
 
@@ -222,6 +287,12 @@ _rpc_thread_get_pollers(void *arg)
 	}
 	spdk_json_write_array_end(ctx->w);
 
+	if (spdk_thread_cycle_accounting_is_enabled()) {
+		spdk_json_write_named_array_begin(ctx->w, "callbacks");
+		spdk_thread_get_callback_stats(thread, rpc_get_callback, ctx->w);
+		spdk_json_write_array_end(ctx->w);
+	}
+
 	spdk_json_write_object_end(ctx->w);
 }
 
@@ -240,6 +311,116 @@ rpc_thread_get_pollers(struct spdk_jsonrpc_request *request,
 
 SPDK_RPC_REGISTER("thread_get_pollers", rpc_thread_get_pollers, SPDK_RPC_RUNTIME)
 
+static void
+rpc_thread_set_poller_backoff_done(void *arg)
+{
+	struct rpc_thread_set_poller_backoff_ctx *ctx = arg;
+
+	spdk_jsonrpc_send_bool_response(ctx->request, true);
+	free_rpc_thread_set_poller_backoff_heap(ctx);
+}
+
+static void
+_rpc_thread_set_poller_backoff(void *arg)
+{
+	struct rpc_thread_set_poller_backoff_ctx *ctx = arg;
+	struct spdk_thread *thread = spdk_get_thread();
+	struct spdk_poller *poller;
+
+	for (poller = spdk_thread_get_first_active_poller(thread); poller != NULL;
+	     poller = spdk_thread_get_next_active_poller(poller)) {
+		if (strcmp(spdk_poller_get_name(poller), ctx->name) == 0) {
+			spdk_poller_set_backoff(poller, ctx->max_interval);
+		}
+	}
+
+	for (poller = spdk_thread_get_first_paused_poller(thread); poller != NULL;
+	     poller = spdk_thread_get_next_paused_poller(poller)) {
+		if (spdk_poller_get_period_ticks(poller) == 0 &&
+		    strcmp(spdk_poller_get_name(poller), ctx->name) == 0) {
+			spdk_poller_set_backoff(poller, ctx->max_interval);
+		}
+	}
+}
+
+static void
+rpc_thread_set_poller_backoff(struct spdk_jsonrpc_request *request,
+			      const struct spdk_json_val *params)
+{
+	struct rpc_thread_set_poller_backoff_ctx *ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (spdk_json_decode_object(params, rpc_thread_set_poller_backoff_decoders,
+				    SPDK_COUNTOF(rpc_thread_set_poller_backoff_decoders),
+				    ctx)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "spdk_json_decode_object failed");
+		free_rpc_thread_set_poller_backoff_heap(ctx);
+		return;
+	}
+
+	ctx->request = request;
+	spdk_for_each_thread(_rpc_thread_set_poller_backoff, ctx,
+			     rpc_thread_set_poller_backoff_done);
+}
+
+SPDK_RPC_REGISTER("thread_set_poller_backoff", rpc_thread_set_poller_backoff, SPDK_RPC_RUNTIME)
+
+static void
+rpc_thread_enable_msg_channels(struct spdk_jsonrpc_request *request,
+			       const struct spdk_json_val *params)
+{
+	struct rpc_thread_enable_msg_channels_ctx req = {};
+
+	if (spdk_json_decode_object(params, rpc_thread_enable_msg_channels_decoders,
+				    SPDK_COUNTOF(rpc_thread_enable_msg_channels_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	spdk_thread_enable_msg_channels(req.enabled);
+
+	spdk_jsonrpc_send_bool_response(request, true);
+	free_rpc_thread_enable_msg_channels(&req);
+}
+
+SPDK_RPC_REGISTER("thread_enable_msg_channels", rpc_thread_enable_msg_channels,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
+static void
+rpc_thread_enable_cycle_accounting(struct spdk_jsonrpc_request *request,
+				   const struct spdk_json_val *params)
+{
+	struct rpc_thread_enable_cycle_accounting_ctx req = {};
+
+	if (spdk_json_decode_object(params, rpc_thread_enable_cycle_accounting_decoders,
+				    SPDK_COUNTOF(rpc_thread_enable_cycle_accounting_decoders),
+				    &req)) {
+		SPDK_ERRLOG("spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "spdk_json_decode_object failed");
+		return;
+	}
+
+	spdk_thread_enable_cycle_accounting(req.enabled);
+
+	spdk_jsonrpc_send_bool_response(request, true);
+	free_rpc_thread_enable_cycle_accounting(&req);
+}
+
+SPDK_RPC_REGISTER("thread_enable_cycle_accounting", rpc_thread_enable_cycle_accounting,
+		  SPDK_RPC_STARTUP | SPDK_RPC_RUNTIME)
+
 static void
 rpc_get_io_channel(struct spdk_io_channel *ch, struct spdk_json_write_ctx *w)
 {
@@ -409,7 +590,8 @@ rpc_framework_set_scheduler(struct spdk_jsonrpc_request *request,
 		goto end;
 	} else {
 		has_custom_opts = (req.load_limit != 0 || req.core_limit != 0 ||
-				   req.core_busy != 0 || req.mappings != NULL);
+				   req.core_busy != 0 || req.numa_imbalance != 0 ||
+				   req.mappings != NULL);
 	}
 
 	if (req.period != 0) {
@@ -472,6 +654,8 @@ rpc_framework_get_scheduler(struct spdk_jsonrpc_request *request,
 	spdk_json_write_named_uint64(w, "scheduler_period", scheduler_period);
 	spdk_json_write_named_string(w, "isolated_core_mask", scheduler_get_isolated_core_mask());
 	spdk_json_write_named_uint32(w, "scheduling_core", scheduling_core);
+	spdk_json_write_named_uint64(w, "thread_steal_period",
+				     spdk_scheduler_get_thread_steal_period());
 	if (governor != NULL) {
 		spdk_json_write_named_string(w, "governor_name", governor->name);
 	}
@@ -550,6 +734,7 @@ rpc_scheduler_set_options(struct spdk_jsonrpc_request *request,
 	struct spdk_cpuset core_mask;
 
 	req.scheduling_core = spdk_scheduler_get_scheduling_lcore();
+	req.thread_steal_period = spdk_scheduler_get_thread_steal_period();
 
 	if (spdk_json_decode_object(params, rpc_scheduler_set_options_decoders,
 				    SPDK_COUNTOF(rpc_scheduler_set_options_decoders), &req)) {
@@ -578,6 +763,8 @@ rpc_scheduler_set_options(struct spdk_jsonrpc_request *request,
 		goto end;
 	}
 
+	spdk_scheduler_set_thread_steal_period(req.thread_steal_period);
+
 	spdk_jsonrpc_send_bool_response(request, true);
 end:
 	free_rpc_scheduler_set_options(&req);
@@ -49,6 +49,8 @@ static struct spdk_reactor *g_scheduling_reactor;
 bool g_scheduling_in_progress = false;
 static uint64_t g_scheduler_period_in_tsc = 0;
 static uint64_t g_scheduler_period_in_us;
+static uint64_t g_thread_steal_period_in_tsc = 0;
+static uint64_t g_thread_steal_period_in_us;
 static uint32_t g_scheduler_core_number;
 static struct spdk_scheduler_core_info *g_core_infos = NULL;
 static struct spdk_cpuset g_scheduler_isolated_core_mask;
@@ -146,6 +148,19 @@ spdk_scheduler_set_period(uint64_t period)
 	g_scheduler_period_in_tsc = period * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
 }
 
+uint64_t
+spdk_scheduler_get_thread_steal_period(void)
+{
+	return g_thread_steal_period_in_us;
+}
+
+void
+spdk_scheduler_set_thread_steal_period(uint64_t period)
+{
+	g_thread_steal_period_in_us = period;
+	g_thread_steal_period_in_tsc = period * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+}
+
 void
 spdk_scheduler_register(struct spdk_scheduler *scheduler)
 {
@@ -870,6 +885,7 @@ _reactors_scheduler_gather_metrics(void *arg1, void *arg2)
 			core_info->thread_infos[i].thread_id = spdk_thread_get_id(thread);
 			core_info->thread_infos[i].total_stats = lw_thread->total_stats;
 			core_info->thread_infos[i].current_stats = lw_thread->current_stats;
+			core_info->thread_infos[i].numa_id = spdk_thread_get_numa_id(thread);
 			core_info->threads_count++;
 			assert(core_info->threads_count <= reactor->thread_count);
 
@@ -940,6 +956,217 @@ reactor_post_process_lw_thread(struct spdk_reactor *reactor, struct spdk_lw_thre
 	return false;
 }
 
+/* Busy percentage during a steal period below which a reactor is idle */
+#define REACTOR_STEAL_IDLE_LOAD		20
+/* Busy percentage during a steal period above which a reactor is overloaded */
+#define REACTOR_STEAL_BUSY_LOAD		95
+/* Number of consecutive idle steal periods after which a reactor steals a thread, and of
+ * overloaded ones after which a reactor hands a thread to a reactor in interrupt mode.
+ */
+#define REACTOR_STEAL_IDLE_PERIODS	2
+/* Number of steal periods during which a moved thread can't be stolen, and during which
+ * a reactor that took or gave away a thread doesn't move another one.
+ */
+#define REACTOR_STEAL_HOLDOFF_PERIODS	10
+
+/* Busy time of a thread since the last scheduling period or since it was moved */
+static uint64_t
+_lw_thread_get_busy_tsc(struct spdk_lw_thread *lw_thread)
+{
+	struct spdk_thread_stats stats;
+
+	spdk_set_thread(spdk_thread_get_from_ctx(lw_thread));
+	spdk_thread_get_stats(&stats);
+	spdk_set_thread(NULL);
+
+	return stats.busy_tsc - lw_thread->total_stats.busy_tsc;
+}
+
+/* Runs on the overloaded reactor, which picks one of its threads and moves it to the
+ * other reactor through the regular rescheduling path.
+ */
+static void
+reactor_give_thread(struct spdk_reactor *reactor, struct spdk_reactor *target)
+{
+	struct spdk_lw_thread *lw_thread, *victim = NULL;
+	struct spdk_thread *thread;
+	uint64_t busy_tsc, half_busy_tsc, total_busy_tsc = 0, distance;
+	uint64_t best_distance = UINT64_MAX;
+	uint64_t holdoff_tsc = REACTOR_STEAL_HOLDOFF_PERIODS * g_thread_steal_period_in_tsc;
+
+	TAILQ_FOREACH(lw_thread, &reactor->threads, link) {
+		total_busy_tsc += _lw_thread_get_busy_tsc(lw_thread);
+	}
+
+	/* Move the thread whose load is the closest to half the load of the reactor */
+	half_busy_tsc = total_busy_tsc / 2;
+	TAILQ_FOREACH(lw_thread, &reactor->threads, link) {
+		thread = spdk_thread_get_from_ctx(lw_thread);
+		if (lw_thread->resched || spdk_thread_is_bound(thread) ||
+		    !spdk_thread_is_running(thread) ||
+		    !spdk_cpuset_get_cpu(spdk_thread_get_cpumask(thread), target->lcore) ||
+		    lw_thread->tsc_start + holdoff_tsc > reactor->tsc_last) {
+			continue;
+		}
+
+		busy_tsc = _lw_thread_get_busy_tsc(lw_thread);
+		distance = spdk_max(busy_tsc, half_busy_tsc) - spdk_min(busy_tsc, half_busy_tsc);
+		if (distance < best_distance) {
+			best_distance = distance;
+			victim = lw_thread;
+		}
+	}
+
+	if (victim == NULL) {
+		return;
+	}
+
+	SPDK_DEBUGLOG(reactor, "Core %u moves thread %s to core %u\n", reactor->lcore,
+		      spdk_thread_get_name(spdk_thread_get_from_ctx(victim)), target->lcore);
+
+	reactor->steal_resume_tsc = reactor->tsc_last + holdoff_tsc;
+	victim->lcore = target->lcore;
+	victim->resched = true;
+}
+
+static void
+_reactor_steal_thread(void *arg1, void *arg2)
+{
+	struct spdk_reactor *thief = arg1;
+	struct spdk_reactor *reactor;
+
+	reactor = spdk_reactor_get(spdk_env_get_current_core());
+	assert(reactor != NULL);
+
+	/* The load might have dropped since the idle reactor looked at it, or the reactor might
+	 * have just handed a thread to a reactor in interrupt mode.
+	 */
+	if (g_reactor_state != SPDK_REACTOR_STATE_RUNNING || g_scheduling_in_progress ||
+	    reactor->in_interrupt || reactor->thread_count < 2 ||
+	    reactor->steal_load < REACTOR_STEAL_BUSY_LOAD ||
+	    reactor->tsc_last < reactor->steal_resume_tsc) {
+		return;
+	}
+
+	reactor_give_thread(reactor, thief);
+}
+
+static struct spdk_reactor *
+reactor_find_steal_victim(struct spdk_reactor *thief)
+{
+	struct spdk_reactor *reactor, *victim = NULL;
+	int32_t numa_id = spdk_env_get_numa_id(thief->lcore);
+	uint32_t i;
+
+	SPDK_ENV_FOREACH_CORE(i) {
+		reactor = spdk_reactor_get(i);
+		assert(reactor != NULL);
+
+		/* The other reactors' state is read without synchronization, _reactor_steal_thread()
+		 * checks it again on the victim's core.
+		 */
+		if (reactor == thief || reactor->in_interrupt || reactor->thread_count < 2 ||
+		    reactor->steal_load < REACTOR_STEAL_BUSY_LOAD ||
+		    spdk_env_get_numa_id(i) != numa_id || scheduler_is_isolated_core(i)) {
+			continue;
+		}
+
+		if (victim == NULL || reactor->steal_load > victim->steal_load) {
+			victim = reactor;
+		}
+	}
+
+	return victim;
+}
+
+/* Reactors in interrupt mode don't run steal periods, since the dynamic scheduler only puts
+ * idle ones in that mode, so the overloaded reactor hands them a thread instead.  The event
+ * scheduling the thread wakes the reactor up.
+ */
+static struct spdk_reactor *
+reactor_find_steal_target(struct spdk_reactor *reactor)
+{
+	struct spdk_reactor *target = NULL, *other;
+	int32_t numa_id = spdk_env_get_numa_id(reactor->lcore);
+	uint32_t i;
+
+	SPDK_ENV_FOREACH_CORE(i) {
+		other = spdk_reactor_get(i);
+		assert(other != NULL);
+
+		if (other == reactor || !other->in_interrupt ||
+		    other->set_interrupt_mode_in_progress || spdk_env_get_numa_id(i) != numa_id ||
+		    scheduler_is_isolated_core(i)) {
+			continue;
+		}
+
+		if (target == NULL || other->thread_count < target->thread_count) {
+			target = other;
+		}
+	}
+
+	return target;
+}
+
+static void
+reactor_steal_period(struct spdk_reactor *reactor)
+{
+	struct spdk_reactor *victim, *target;
+	uint64_t busy_tsc, idle_tsc;
+
+	busy_tsc = reactor->busy_tsc - reactor->steal_busy_tsc;
+	idle_tsc = reactor->idle_tsc - reactor->steal_idle_tsc;
+	reactor->steal_busy_tsc = reactor->busy_tsc;
+	reactor->steal_idle_tsc = reactor->idle_tsc;
+	reactor->steal_tsc_last = reactor->tsc_last;
+
+	reactor->steal_load = busy_tsc + idle_tsc == 0 ? 0 : busy_tsc * 100 / (busy_tsc + idle_tsc);
+
+	if (g_scheduling_in_progress || scheduler_is_isolated_core(reactor->lcore)) {
+		reactor->steal_idle_periods = 0;
+		reactor->steal_busy_periods = 0;
+		return;
+	}
+
+	if (reactor->steal_load >= REACTOR_STEAL_BUSY_LOAD) {
+		reactor->steal_idle_periods = 0;
+		reactor->steal_busy_periods++;
+		if (reactor->steal_busy_periods < REACTOR_STEAL_IDLE_PERIODS ||
+		    reactor->thread_count < 2 || reactor->tsc_last < reactor->steal_resume_tsc) {
+			return;
+		}
+
+		target = reactor_find_steal_target(reactor);
+		if (target != NULL) {
+			reactor->steal_busy_periods = 0;
+			reactor_give_thread(reactor, target);
+		}
+		return;
+	}
+
+	reactor->steal_busy_periods = 0;
+	if (reactor->steal_load >= REACTOR_STEAL_IDLE_LOAD) {
+		reactor->steal_idle_periods = 0;
+		return;
+	}
+
+	reactor->steal_idle_periods++;
+	if (reactor->steal_idle_periods < REACTOR_STEAL_IDLE_PERIODS ||
+	    reactor->tsc_last < reactor->steal_resume_tsc) {
+		return;
+	}
+
+	victim = reactor_find_steal_victim(reactor);
+	if (victim == NULL) {
+		return;
+	}
+
+	reactor->steal_idle_periods = 0;
+	reactor->steal_resume_tsc = reactor->tsc_last +
+				    REACTOR_STEAL_HOLDOFF_PERIODS * g_thread_steal_period_in_tsc;
+	_event_call(victim->lcore, _reactor_steal_thread, reactor, NULL);
+}
+
 static void
 reactor_interrupt_run(struct spdk_reactor *reactor)
 {
@@ -1013,6 +1240,12 @@ reactor_run(void *arg)
 			_reactor_run(reactor);
 		}
 
+		if (spdk_unlikely(g_thread_steal_period_in_tsc > 0 && !reactor->in_interrupt &&
+				  (reactor->tsc_last - reactor->steal_tsc_last) >
+				  g_thread_steal_period_in_tsc)) {
+			reactor_steal_period(reactor);
+		}
+
 		if (g_framework_context_switch_monitor_enabled) {
 			if ((reactor->last_rusage + g_rusage_period) < reactor->tsc_last) {
 				get_rusage(reactor);
@@ -36,8 +36,29 @@
 #define SPDK_THREAD_EXIT_TIMEOUT_SEC	5
 #define SPDK_MAX_POLLER_NAME_LEN	256
 #define SPDK_MAX_THREAD_NAME_LEN	256
+/* Number of consecutive idle runs after which the backoff interval of a poller is doubled */
+#define SPDK_POLLER_BACKOFF_IDLE_RUNS	8
+/* Number of entries of the ring of a message channel between two threads */
+#define SPDK_MSG_CHANNEL_SIZE		1024
+/* Number of bits of the message doorbell of a thread */
+#define SPDK_MSG_CHANNEL_BITS		64
+/*
+ * Maximum number of message channels to a thread, and in total, as each one takes a memzone.
+ *  The other producers use the regular ring of the consumer.
+ */
+#define SPDK_MSG_CHANNELS_PER_THREAD	16
+#define SPDK_MSG_CHANNELS_MAX		1024
+/* Time before a producer tries again to create a channel it failed to create */
+#define SPDK_MSG_CHANNEL_RETRY_SEC	1
+/* Maximum number of messages enqueued at once by spdk_thread_send_msg_batch() */
+#define SPDK_MSG_SEND_BATCH_SIZE	32
+/* Number of distinct callbacks accounted per thread, the others share a last entry */
+#define SPDK_THREAD_CALLBACK_STATS_SIZE	64
 
 static struct spdk_thread *g_app_thread;
+static bool g_msg_channels_enabled = false;
+static uint32_t g_msg_channel_count;
+static bool g_cycle_accounting_enabled = false;
 
 struct spdk_interrupt {
 	int			efd;
@@ -80,6 +101,10 @@ struct spdk_poller {
 	uint64_t			next_run_tick;
 	uint64_t			run_count;
 	uint64_t			busy_count;
+	uint64_t			skip_count;
+	/* Cycles spent in the busy and idle runs of the poller, see cycle accounting */
+	uint64_t			busy_tsc;
+	uint64_t			idle_tsc;
 	uint64_t			id;
 	spdk_poller_fn			fn;
 	void				*arg;
@@ -88,6 +113,15 @@ struct spdk_poller {
 	spdk_poller_set_interrupt_mode_cb set_intr_cb_fn;
 	void				*set_intr_cb_arg;
 
+	/* Adaptive backoff of active pollers, see spdk_poller_set_backoff().  An idle poller
+	 * is run once every backoff_interval iterations of its thread, backoff_skip is the
+	 * number of iterations left to skip before its next run.
+	 */
+	uint32_t			backoff_max;
+	uint32_t			backoff_interval;
+	uint32_t			backoff_skip;
+	uint32_t			backoff_idle_runs;
+
 	char				name[SPDK_MAX_POLLER_NAME_LEN + 1];
 };
 
@@ -111,6 +145,34 @@ struct spdk_thread_post_poller_handler {
 
 #define SPDK_THREAD_MAX_POST_POLLER_HANDLERS (4)
 
+/*
+ * A message channel carries the messages sent by one thread (the producer) to another one
+ * (the consumer) over a single-producer, single-consumer ring, so that the producers do not
+ * contend on the multi-producer ring of the consumer.
+ */
+struct spdk_msg_channel {
+	/* NULL if the channel could not be created, until retry_tsc. */
+	struct spdk_ring		*ring;
+	struct spdk_thread		*consumer;
+	uint64_t			consumer_id;
+	uint64_t			retry_tsc;
+
+	/* Set by the consumer once it polls the channel. */
+	bool				active;
+	uint8_t				doorbell_bit;
+	bool				consumer_gone;
+	bool				producer_gone;
+	int				refcnt;
+
+	/* Messages that did not fit in the ring, only accessed by the producer. */
+	STAILQ_HEAD(, spdk_msg)		overflow;
+	/* Number of messages on the overflow list, also read by the consumer when exiting. */
+	uint32_t			overflow_count;
+
+	TAILQ_ENTRY(spdk_msg_channel)	producer_link;
+	TAILQ_ENTRY(spdk_msg_channel)	consumer_link;
+};
+
 struct spdk_thread {
 	uint64_t			tsc_last;
 	struct spdk_thread_stats	stats;
@@ -148,6 +210,30 @@ struct spdk_thread {
 	RB_HEAD(io_channel_tree, spdk_io_channel)	io_channels;
 	TAILQ_ENTRY(spdk_thread)			tailq;
 
+	/* Message channels from the threads sending messages to this one, by doorbell bit. */
+	TAILQ_HEAD(, spdk_msg_channel)	msg_channels_in[SPDK_MSG_CHANNEL_BITS];
+	uint32_t			msg_channel_next_bit;
+	/* Doorbell bit to start from, after a poll that did not get to all the channels. */
+	uint32_t			msg_doorbell_start;
+	/* Message channels to the threads this one sends messages to. */
+	TAILQ_HEAD(, spdk_msg_channel)	msg_channels_out;
+	struct spdk_msg_channel		*last_msg_channel;
+	uint32_t			msg_overflow_count;
+
+	/*
+	 * Cycles spent in the messages and interrupt handlers executed by this thread, by
+	 *  callback.  Allocated on first use when cycle accounting is enabled.
+	 */
+	struct spdk_thread_callback_stats	*callback_stats;
+
+	/*
+	 * Doorbell bits of the message channels with pending messages.  It is set by the
+	 *  producers, so it starts a new cache line, shared only with the name of the thread.
+	 */
+	uint64_t			msg_doorbell __attribute__((aligned(SPDK_CACHE_LINE_SIZE)));
+	/* Number of message channels to this thread, counted by the producers creating them. */
+	uint32_t			msg_channel_count;
+
 	char				name[SPDK_MAX_THREAD_NAME_LEN + 1];
 	struct spdk_cpuset		cpumask;
 	uint64_t			exit_timeout_tsc;
@@ -312,6 +398,7 @@ struct spdk_msg {
 	void			*arg;
 
 	SLIST_ENTRY(spdk_msg)	link;
+	STAILQ_ENTRY(spdk_msg)	overflow_link;
 };
 
 static struct spdk_mempool *g_spdk_msg_mempool = NULL;
@@ -398,6 +485,62 @@ _thread_lib_init(size_t ctx_sz, size_t msg_mempool_sz)
 static void thread_interrupt_destroy(struct spdk_thread *thread);
 static int thread_interrupt_create(struct spdk_thread *thread);
 
+static void
+msg_channel_put(struct spdk_msg_channel *ch)
+{
+	/* Both the producer and the consumer hold a reference, the last one frees the channel. */
+	if (__atomic_sub_fetch(&ch->refcnt, 1, __ATOMIC_ACQ_REL) != 0) {
+		return;
+	}
+
+	if (ch->ring != NULL) {
+		spdk_ring_free(ch->ring);
+		__atomic_fetch_sub(&g_msg_channel_count, 1, __ATOMIC_RELAXED);
+	}
+	free(ch);
+}
+
+static void
+thread_remove_msg_channel_in(struct spdk_thread *thread, uint32_t bit,
+			     struct spdk_msg_channel *ch)
+{
+	TAILQ_REMOVE(&thread->msg_channels_in[bit], ch, consumer_link);
+	__atomic_fetch_sub(&thread->msg_channel_count, 1, __ATOMIC_RELAXED);
+	msg_channel_put(ch);
+}
+
+static void
+thread_release_msg_channels(struct spdk_thread *thread)
+{
+	struct spdk_msg_channel *ch;
+	struct spdk_msg *msg;
+	uint32_t i;
+
+	for (i = 0; i < SPDK_MSG_CHANNEL_BITS; i++) {
+		while ((ch = TAILQ_FIRST(&thread->msg_channels_in[i])) != NULL) {
+			while (spdk_ring_dequeue(ch->ring, (void **)&msg, 1) == 1) {
+				spdk_mempool_put(g_spdk_msg_mempool, msg);
+			}
+			__atomic_store_n(&ch->consumer_gone, true, __ATOMIC_RELEASE);
+			thread_remove_msg_channel_in(thread, i, ch);
+		}
+	}
+
+	while ((ch = TAILQ_FIRST(&thread->msg_channels_out)) != NULL) {
+		TAILQ_REMOVE(&thread->msg_channels_out, ch, producer_link);
+		while ((msg = STAILQ_FIRST(&ch->overflow)) != NULL) {
+			STAILQ_REMOVE_HEAD(&ch->overflow, overflow_link);
+			spdk_mempool_put(g_spdk_msg_mempool, msg);
+		}
+		__atomic_store_n(&ch->overflow_count, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&ch->producer_gone, true, __ATOMIC_RELEASE);
+		msg_channel_put(ch);
+	}
+
+	thread->last_msg_channel = NULL;
+	thread->msg_overflow_count = 0;
+}
+
 static void
 _free_thread(struct spdk_thread *thread)
 {
@@ -440,6 +583,9 @@ _free_thread(struct spdk_thread *thread)
 	TAILQ_REMOVE(&g_threads, thread, tailq);
 	pthread_mutex_unlock(&g_devlist_mutex);
 
+	thread_release_msg_channels(thread);
+	free(thread->callback_stats);
+
 	msg = SLIST_FIRST(&thread->msg_cache);
 	while (msg != NULL) {
 		SLIST_REMOVE_HEAD(&thread->msg_cache, link);
@@ -553,6 +699,10 @@ spdk_thread_create(const char *name, const struct spdk_cpuset *cpumask)
 	TAILQ_INIT(&thread->paused_pollers);
 	SLIST_INIT(&thread->msg_cache);
 	thread->msg_cache_count = 0;
+	for (i = 0; i < SPDK_MSG_CHANNEL_BITS; i++) {
+		TAILQ_INIT(&thread->msg_channels_in[i]);
+	}
+	TAILQ_INIT(&thread->msg_channels_out);
 
 	thread->tsc_last = spdk_get_ticks();
 
@@ -669,6 +819,29 @@ spdk_set_thread(struct spdk_thread *thread)
 	tls_thread = thread;
 }
 
+static bool
+thread_has_channel_msgs(struct spdk_thread *thread)
+{
+	struct spdk_msg_channel *ch;
+	uint32_t i;
+
+	/* Messages this thread could not enqueue yet to the message channels of other threads */
+	if (thread->msg_overflow_count > 0) {
+		return true;
+	}
+
+	for (i = 0; i < SPDK_MSG_CHANNEL_BITS; i++) {
+		TAILQ_FOREACH(ch, &thread->msg_channels_in[i], consumer_link) {
+			if (spdk_ring_count(ch->ring) > 0 ||
+			    __atomic_load_n(&ch->overflow_count, __ATOMIC_RELAXED) > 0) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
 static void
 thread_exit(struct spdk_thread *thread, uint64_t now)
 {
@@ -686,6 +859,12 @@ thread_exit(struct spdk_thread *thread, uint64_t now)
 		return;
 	}
 
+	if (thread_has_channel_msgs(thread)) {
+		SPDK_INFOLOG(thread, "thread %s still has messages on its message channels\n",
+			     thread->name);
+		return;
+	}
+
 	if (thread->for_each_count > 0) {
 		SPDK_INFOLOG(thread, "thread %s is still executing %u for_each_channels/threads\n",
 			     thread->name, thread->for_each_count);
@@ -811,6 +990,55 @@ spdk_thread_get_cpumask(struct spdk_thread *thread)
 	return &thread->cpumask;
 }
 
+/* Maximum number of different NUMA nodes considered for the affinity of a thread */
+#define THREAD_NUMA_MAX_NODES	16
+
+int32_t
+spdk_thread_get_numa_id(struct spdk_thread *thread)
+{
+	struct spdk_io_channel *ch;
+	struct {
+		int32_t		numa_id;
+		uint32_t	count;
+	} nodes[THREAD_NUMA_MAX_NODES];
+	uint32_t i, num_nodes = 0, max_count = 0;
+	int32_t numa_id = SPDK_ENV_NUMA_ID_ANY;
+
+	RB_FOREACH(ch, io_channel_tree, &thread->io_channels) {
+		if (ch->numa_id == SPDK_ENV_NUMA_ID_ANY) {
+			continue;
+		}
+
+		for (i = 0; i < num_nodes; i++) {
+			if (nodes[i].numa_id == ch->numa_id) {
+				break;
+			}
+		}
+
+		if (i == num_nodes) {
+			if (num_nodes == THREAD_NUMA_MAX_NODES) {
+				continue;
+			}
+			nodes[i].numa_id = ch->numa_id;
+			nodes[i].count = 0;
+			num_nodes++;
+		}
+		nodes[i].count++;
+	}
+
+	/* The node with the most channels wins, there is no affinity on a tie. */
+	for (i = 0; i < num_nodes; i++) {
+		if (nodes[i].count > max_count) {
+			max_count = nodes[i].count;
+			numa_id = nodes[i].numa_id;
+		} else if (nodes[i].count == max_count) {
+			numa_id = SPDK_ENV_NUMA_ID_ANY;
+		}
+	}
+
+	return numa_id;
+}
+
 int
 spdk_thread_set_cpumask(struct spdk_cpuset *cpumask)
 {
@@ -853,10 +1081,167 @@ spdk_thread_get_from_ctx(void *ctx)
 	return SPDK_CONTAINEROF(ctx, struct spdk_thread, ctx);
 }
 
+static inline bool
+cycle_accounting_is_enabled(void)
+{
+	return __atomic_load_n(&g_cycle_accounting_enabled, __ATOMIC_RELAXED);
+}
+
+static void
+thread_account_callback(struct spdk_thread *thread, void *fn,
+			enum spdk_thread_callback_type type, uint64_t tsc)
+{
+	struct spdk_thread_callback_stats *stats;
+	uint32_t i, slot;
+
+	if (spdk_unlikely(thread->callback_stats == NULL)) {
+		/* The last entry accounts the callbacks which don't fit in the table. */
+		thread->callback_stats = calloc(SPDK_THREAD_CALLBACK_STATS_SIZE + 1,
+						sizeof(*thread->callback_stats));
+		if (thread->callback_stats == NULL) {
+			return;
+		}
+		thread->callback_stats[SPDK_THREAD_CALLBACK_STATS_SIZE].type =
+			SPDK_THREAD_CALLBACK_OTHER;
+	}
+
+	slot = (((uintptr_t)fn >> 4) ^ type) % SPDK_THREAD_CALLBACK_STATS_SIZE;
+	for (i = 0; i < SPDK_THREAD_CALLBACK_STATS_SIZE; i++) {
+		stats = &thread->callback_stats[slot];
+		if (stats->fn == NULL) {
+			stats->fn = fn;
+			stats->type = type;
+			break;
+		}
+		if (stats->fn == fn && stats->type == type) {
+			break;
+		}
+		slot = (slot + 1) % SPDK_THREAD_CALLBACK_STATS_SIZE;
+	}
+
+	if (i == SPDK_THREAD_CALLBACK_STATS_SIZE) {
+		stats = &thread->callback_stats[SPDK_THREAD_CALLBACK_STATS_SIZE];
+	}
+
+	stats->run_count++;
+	stats->tsc += tsc;
+}
+
+static inline void
+msg_execute(struct spdk_thread *thread, void **messages, uint32_t count)
+{
+	uint64_t tsc;
+	uint32_t i;
+
+	for (i = 0; i < count; i++) {
+		struct spdk_msg *msg = messages[i];
+
+		assert(msg != NULL);
+
+		SPDK_DTRACE_PROBE2(msg_exec, msg->fn, msg->arg);
+
+		if (spdk_unlikely(cycle_accounting_is_enabled())) {
+			tsc = spdk_get_ticks();
+			msg->fn(msg->arg);
+			thread_account_callback(thread, msg->fn, SPDK_THREAD_CALLBACK_MSG,
+						spdk_get_ticks() - tsc);
+		} else {
+			msg->fn(msg->arg);
+		}
+
+		SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
+
+		if (thread->msg_cache_count < SPDK_MSG_MEMPOOL_CACHE_SIZE) {
+			/* Insert the messages at the head. We want to re-use the hot
+			 * ones. */
+			SLIST_INSERT_HEAD(&thread->msg_cache, msg, link);
+			thread->msg_cache_count++;
+		} else {
+			spdk_mempool_put(g_spdk_msg_mempool, msg);
+		}
+	}
+}
+
+static void
+msg_channel_register(void *ctx)
+{
+	struct spdk_msg_channel *ch = ctx, *tmp, *gone;
+	struct spdk_thread *thread = _get_thread();
+	uint32_t bit;
+
+	bit = thread->msg_channel_next_bit++ % SPDK_MSG_CHANNEL_BITS;
+
+	/* Reclaim the channels of the producers that have gone since. */
+	TAILQ_FOREACH_SAFE(gone, &thread->msg_channels_in[bit], consumer_link, tmp) {
+		if (__atomic_load_n(&gone->producer_gone, __ATOMIC_ACQUIRE) &&
+		    spdk_ring_count(gone->ring) == 0) {
+			thread_remove_msg_channel_in(thread, bit, gone);
+		}
+	}
+
+	ch->doorbell_bit = bit;
+	TAILQ_INSERT_TAIL(&thread->msg_channels_in[bit], ch, consumer_link);
+	__atomic_store_n(&ch->active, true, __ATOMIC_RELEASE);
+
+	/* The producer did not ring the doorbell for the messages it sent before. */
+	__atomic_fetch_or(&thread->msg_doorbell, 1ULL << bit, __ATOMIC_SEQ_CST);
+}
+
+/* Run up to max_msgs messages from the channels, in total */
+static uint32_t
+msg_channels_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
+{
+	struct spdk_msg_channel *ch, *tmp;
+	void *messages[SPDK_MSG_BATCH_SIZE];
+	uint64_t doorbell, backlog = 0;
+	uint32_t start, bit, count, total = 0;
+
+	if (spdk_likely(__atomic_load_n(&thread->msg_doorbell, __ATOMIC_RELAXED) == 0) ||
+	    max_msgs == 0) {
+		return 0;
+	}
+
+	/* Start from the channels left over by the previous poll, so that they all get a turn */
+	start = thread->msg_doorbell_start;
+	doorbell = __atomic_exchange_n(&thread->msg_doorbell, 0, __ATOMIC_SEQ_CST);
+	doorbell = start == 0 ? doorbell : (doorbell >> start) |
+		   (doorbell << (SPDK_MSG_CHANNEL_BITS - start));
+	while (doorbell != 0) {
+		bit = (__builtin_ctzll(doorbell) + start) % SPDK_MSG_CHANNEL_BITS;
+		doorbell &= doorbell - 1;
+
+		TAILQ_FOREACH_SAFE(ch, &thread->msg_channels_in[bit], consumer_link, tmp) {
+			count = 0;
+			if (total < max_msgs) {
+				count = spdk_ring_dequeue(ch->ring, messages, max_msgs - total);
+				msg_execute(thread, messages, count);
+				total += count;
+				if (total == max_msgs) {
+					thread->msg_doorbell_start = (bit + 1) %
+								     SPDK_MSG_CHANNEL_BITS;
+				}
+			}
+
+			if (__atomic_load_n(&ch->producer_gone, __ATOMIC_ACQUIRE) &&
+			    spdk_ring_count(ch->ring) == 0) {
+				thread_remove_msg_channel_in(thread, bit, ch);
+			} else if (spdk_ring_count(ch->ring) != 0) {
+				backlog |= 1ULL << bit;
+			}
+		}
+	}
+
+	if (backlog != 0) {
+		__atomic_fetch_or(&thread->msg_doorbell, backlog, __ATOMIC_SEQ_CST);
+	}
+
+	return total;
+}
+
 static inline uint32_t
 msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 {
-	unsigned count, i;
+	unsigned count;
 	void *messages[SPDK_MSG_BATCH_SIZE];
 	uint64_t notify = 1;
 	int rc;
@@ -876,7 +1261,10 @@ msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 		max_msgs = SPDK_MSG_BATCH_SIZE;
 	}
 
-	count = spdk_ring_dequeue(thread->messages, messages, max_msgs);
+	/* The regular ring leaves half of the batch to the message channels with messages */
+	count = spdk_ring_dequeue(thread->messages, messages,
+				  __atomic_load_n(&thread->msg_doorbell, __ATOMIC_RELAXED) == 0 ?
+				  max_msgs : (max_msgs + 1) / 2);
 	if (spdk_unlikely(thread->in_interrupt) &&
 	    spdk_ring_count(thread->messages) != 0) {
 		rc = write(thread->msg_fd, &notify, sizeof(notify));
@@ -884,32 +1272,11 @@ msg_queue_run_batch(struct spdk_thread *thread, uint32_t max_msgs)
 			SPDK_ERRLOG("failed to notify msg_queue: %s.\n", spdk_strerror(errno));
 		}
 	}
-	if (count == 0) {
-		return 0;
-	}
 
-	for (i = 0; i < count; i++) {
-		struct spdk_msg *msg = messages[i];
+	msg_execute(thread, messages, count);
 
-		assert(msg != NULL);
-
-		SPDK_DTRACE_PROBE2(msg_exec, msg->fn, msg->arg);
-
-		msg->fn(msg->arg);
-
-		SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
-
-		if (thread->msg_cache_count < SPDK_MSG_MEMPOOL_CACHE_SIZE) {
-			/* Insert the messages at the head. We want to re-use the hot
-			 * ones. */
-			SLIST_INSERT_HEAD(&thread->msg_cache, msg, link);
-			thread->msg_cache_count++;
-		} else {
-			spdk_mempool_put(g_spdk_msg_mempool, msg);
-		}
-	}
-
-	return count;
+	/* Message channels are not used in interrupt mode, so the doorbell stays clear there. */
+	return count + msg_channels_run_batch(thread, max_msgs - count);
 }
 
 static void
@@ -977,6 +1344,48 @@ thread_update_stats(struct spdk_thread *thread, uint64_t end,
 	thread->tsc_last = end;
 }
 
+static inline void
+poller_update_backoff(struct spdk_thread *thread, struct spdk_poller *poller, int rc)
+{
+	if (rc > 0 || thread->in_interrupt) {
+		poller->backoff_interval = 1;
+		poller->backoff_idle_runs = 0;
+		return;
+	}
+
+	if (++poller->backoff_idle_runs >= SPDK_POLLER_BACKOFF_IDLE_RUNS &&
+	    poller->backoff_interval < poller->backoff_max) {
+		poller->backoff_interval = spdk_min((uint64_t)poller->backoff_interval * 2,
+						    poller->backoff_max);
+		poller->backoff_idle_runs = 0;
+	}
+
+	poller->backoff_skip = poller->backoff_interval - 1;
+}
+
+static inline int
+poller_run(struct spdk_poller *poller)
+{
+	uint64_t tsc;
+	int rc;
+
+	if (spdk_likely(!cycle_accounting_is_enabled())) {
+		return poller->fn(poller->arg);
+	}
+
+	tsc = spdk_get_ticks();
+	rc = poller->fn(poller->arg);
+	tsc = spdk_get_ticks() - tsc;
+
+	if (rc > 0) {
+		poller->busy_tsc += tsc;
+	} else {
+		poller->idle_tsc += tsc;
+	}
+
+	return rc;
+}
+
 static inline int
 thread_execute_poller(struct spdk_thread *thread, struct spdk_poller *poller)
 {
@@ -999,8 +1408,17 @@ thread_execute_poller(struct spdk_thread *thread, struct spdk_poller *poller)
 		break;
 	}
 
+	/* Threads in interrupt mode only run their pollers when there is an event, so the
+	 * backoff doesn't apply to them.
+	 */
+	if (poller->backoff_skip != 0 && !thread->in_interrupt) {
+		poller->backoff_skip--;
+		poller->skip_count++;
+		return 0;
+	}
+
 	poller->state = SPDK_POLLER_STATE_RUNNING;
-	rc = poller->fn(poller->arg);
+	rc = poller_run(poller);
 
 	SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
 
@@ -1009,6 +1427,10 @@ thread_execute_poller(struct spdk_thread *thread, struct spdk_poller *poller)
 		poller->busy_count++;
 	}
 
+	if (poller->backoff_max != 0) {
+		poller_update_backoff(thread, poller, rc);
+	}
+
 #ifdef DEBUG
 	if (rc == -1) {
 		SPDK_DEBUGLOG(thread, "Poller %s returned -1\n", poller->name);
@@ -1061,7 +1483,7 @@ thread_execute_timed_poller(struct spdk_thread *thread, struct spdk_poller *poll
 	}
 
 	poller->state = SPDK_POLLER_STATE_RUNNING;
-	rc = poller->fn(poller->arg);
+	rc = poller_run(poller);
 
 	SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
 
@@ -1116,6 +1538,8 @@ thread_run_pp_handlers(struct spdk_thread *thread)
 	thread->num_pp_handlers = 0;
 }
 
+static void thread_flush_msg_overflow(struct spdk_thread *thread);
+
 static int
 thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 {
@@ -1133,6 +1557,10 @@ thread_poll(struct spdk_thread *thread, uint32_t max_msgs, uint64_t now)
 		rc = 1;
 	}
 
+	if (spdk_unlikely(thread->msg_overflow_count > 0)) {
+		thread_flush_msg_overflow(thread);
+	}
+
 	msg_count = msg_queue_run_batch(thread, max_msgs);
 	if (msg_count) {
 		rc = 1;
@@ -1302,6 +1730,8 @@ bool
 spdk_thread_is_idle(struct spdk_thread *thread)
 {
 	if (spdk_ring_count(thread->messages) ||
+	    __atomic_load_n(&thread->msg_doorbell, __ATOMIC_RELAXED) != 0 ||
+	    thread->msg_overflow_count > 0 ||
 	    thread_has_unpaused_pollers(thread) ||
 	    thread->critical_msg != NULL) {
 		return false;
@@ -1412,23 +1842,11 @@ thread_send_msg_notification(const struct spdk_thread *target_thread)
 	}
 }
 
-int
-spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx)
+static inline struct spdk_msg *
+thread_msg_get(struct spdk_thread *local_thread)
 {
-	struct spdk_thread *local_thread;
-	struct spdk_msg *msg;
-	int rc;
-
-	assert(thread != NULL);
-
-	if (spdk_unlikely(thread->state == SPDK_THREAD_STATE_EXITED)) {
-		SPDK_ERRLOG("Thread %s is marked as exited.\n", thread->name);
-		abort();
-	}
+	struct spdk_msg *msg = NULL;
 
-	local_thread = _get_thread();
-
-	msg = NULL;
 	if (local_thread != NULL) {
 		if (local_thread->msg_cache_count > 0) {
 			msg = SLIST_FIRST(&local_thread->msg_cache);
@@ -1446,20 +1864,321 @@ spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx
 		}
 	}
 
-	msg->fn = fn;
-	msg->arg = ctx;
+	return msg;
+}
 
-	rc = spdk_ring_enqueue(thread->messages, (void **)&msg, 1, NULL);
-	if (rc != 1) {
+static void
+thread_enqueue_msgs(const struct spdk_thread *thread, struct spdk_msg **msgs, uint32_t count)
+{
+	if (spdk_ring_enqueue(thread->messages, (void **)msgs, count, NULL) != count) {
 		SPDK_ERRLOG("msg could not be enqueued\n");
 		abort();
 	}
 
 	thread_send_msg_notification(thread);
+}
+
+static void
+msg_channel_ring_doorbell(struct spdk_msg_channel *ch)
+{
+	uint64_t bit;
+
+	/* Pairs with the doorbell exchange of the consumer, which dequeues after it. */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	/* Until the consumer registers the channel, it polls it without a doorbell. */
+	if (!__atomic_load_n(&ch->active, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+
+	bit = 1ULL << ch->doorbell_bit;
+	if ((__atomic_load_n(&ch->consumer->msg_doorbell, __ATOMIC_RELAXED) & bit) == 0) {
+		__atomic_fetch_or(&ch->consumer->msg_doorbell, bit, __ATOMIC_SEQ_CST);
+	}
+}
+
+static struct spdk_ring *
+msg_channel_ring_create(struct spdk_thread *thread)
+{
+	struct spdk_ring *ring = NULL;
+
+	if (__atomic_fetch_add(&thread->msg_channel_count, 1, __ATOMIC_RELAXED) >=
+	    SPDK_MSG_CHANNELS_PER_THREAD) {
+		goto err;
+	}
+
+	if (__atomic_fetch_add(&g_msg_channel_count, 1, __ATOMIC_RELAXED) < SPDK_MSG_CHANNELS_MAX) {
+		ring = spdk_ring_create(SPDK_RING_TYPE_SP_SC, SPDK_MSG_CHANNEL_SIZE,
+					SPDK_ENV_NUMA_ID_ANY);
+		if (ring != NULL) {
+			return ring;
+		}
+	}
+
+	__atomic_fetch_sub(&g_msg_channel_count, 1, __ATOMIC_RELAXED);
+err:
+	__atomic_fetch_sub(&thread->msg_channel_count, 1, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+static struct spdk_msg_channel *
+msg_channel_create(struct spdk_thread *local_thread, const struct spdk_thread *thread)
+{
+	struct spdk_msg_channel *ch;
+	struct spdk_msg *msg;
+
+	ch = calloc(1, sizeof(*ch));
+	if (ch == NULL) {
+		return NULL;
+	}
+
+	ch->consumer = (struct spdk_thread *)thread;
+	ch->consumer_id = thread->id;
+	STAILQ_INIT(&ch->overflow);
+	TAILQ_INSERT_HEAD(&local_thread->msg_channels_out, ch, producer_link);
+
+	/*
+	 * Keep the channel without a ring for a while, so that the messages sent to the consumer
+	 *  meanwhile go straight to its regular ring.
+	 */
+	ch->ring = msg_channel_ring_create(ch->consumer);
+	if (ch->ring == NULL) {
+		ch->refcnt = 1;
+		ch->retry_tsc = spdk_get_ticks() + SPDK_MSG_CHANNEL_RETRY_SEC * spdk_get_ticks_hz();
+		return ch;
+	}
+
+	ch->refcnt = 2;
+
+	SPDK_DEBUGLOG(thread, "Creating message channel from thread %s to thread %s\n",
+		      local_thread->name, thread->name);
+
+	/*
+	 * The registration goes through the ring of the consumer, after all the messages sent
+	 *  to it by this thread so far, so that the consumer only starts polling the channel
+	 *  once it has executed all of them.
+	 */
+	msg = thread_msg_get(local_thread);
+	msg->fn = msg_channel_register;
+	msg->arg = ch;
+	thread_enqueue_msgs(thread, &msg, 1);
+
+	return ch;
+}
+
+static struct spdk_msg_channel *
+thread_get_msg_channel(struct spdk_thread *local_thread, const struct spdk_thread *thread)
+{
+	struct spdk_msg_channel *ch, *tmp;
+
+	if (local_thread == NULL || local_thread == thread ||
+	    local_thread->state == SPDK_THREAD_STATE_EXITED ||
+	    spdk_interrupt_mode_is_enabled()) {
+		return NULL;
+	}
+
+	ch = local_thread->last_msg_channel;
+	if (spdk_likely(ch != NULL && ch->consumer_id == thread->id)) {
+		if (spdk_likely(ch->ring != NULL)) {
+			return ch;
+		} else if (spdk_get_ticks() < ch->retry_tsc) {
+			return NULL;
+		}
+	}
+
+	TAILQ_FOREACH_SAFE(ch, &local_thread->msg_channels_out, producer_link, tmp) {
+		if (ch->ring == NULL && spdk_get_ticks() >= ch->retry_tsc) {
+			/* Retry creating the channel, or forget about a consumer that may be gone */
+			TAILQ_REMOVE(&local_thread->msg_channels_out, ch, producer_link);
+			if (local_thread->last_msg_channel == ch) {
+				local_thread->last_msg_channel = NULL;
+			}
+			msg_channel_put(ch);
+			continue;
+		}
+
+		if (ch->consumer_id == thread->id) {
+			local_thread->last_msg_channel = ch;
+			return ch->ring != NULL ? ch : NULL;
+		}
+
+		if (__atomic_load_n(&ch->consumer_gone, __ATOMIC_ACQUIRE)) {
+			TAILQ_REMOVE(&local_thread->msg_channels_out, ch, producer_link);
+			if (local_thread->last_msg_channel == ch) {
+				local_thread->last_msg_channel = NULL;
+			}
+			msg_channel_put(ch);
+		}
+	}
+
+	/* Channels already in use are kept even once disabled, to keep the messages ordered. */
+	if (!__atomic_load_n(&g_msg_channels_enabled, __ATOMIC_RELAXED)) {
+		return NULL;
+	}
+
+	ch = msg_channel_create(local_thread, thread);
+	local_thread->last_msg_channel = ch;
+
+	return ch != NULL && ch->ring != NULL ? ch : NULL;
+}
+
+static void
+msg_channel_enqueue(struct spdk_thread *local_thread, struct spdk_msg_channel *ch,
+		    struct spdk_msg **msgs, uint32_t count)
+{
+	uint32_t i;
+
+	if (spdk_likely(STAILQ_EMPTY(&ch->overflow)) &&
+	    spdk_ring_enqueue(ch->ring, (void **)msgs, count, NULL) == count) {
+		msg_channel_ring_doorbell(ch);
+		return;
+	}
+
+	/* Keep the messages in order behind the ones already waiting for room in the ring. */
+	for (i = 0; i < count; i++) {
+		STAILQ_INSERT_TAIL(&ch->overflow, msgs[i], overflow_link);
+	}
+
+	__atomic_store_n(&ch->overflow_count, ch->overflow_count + count, __ATOMIC_RELAXED);
+	local_thread->msg_overflow_count += count;
+}
+
+static void
+thread_flush_msg_overflow(struct spdk_thread *thread)
+{
+	struct spdk_msg_channel *ch;
+	struct spdk_msg *msg;
+	uint32_t count;
+
+	TAILQ_FOREACH(ch, &thread->msg_channels_out, producer_link) {
+		count = 0;
+		while ((msg = STAILQ_FIRST(&ch->overflow)) != NULL) {
+			if (spdk_ring_enqueue(ch->ring, (void **)&msg, 1, NULL) != 1) {
+				break;
+			}
+
+			STAILQ_REMOVE_HEAD(&ch->overflow, overflow_link);
+			count++;
+		}
+
+		if (count > 0) {
+			__atomic_store_n(&ch->overflow_count, ch->overflow_count - count,
+					 __ATOMIC_RELAXED);
+			thread->msg_overflow_count -= count;
+			msg_channel_ring_doorbell(ch);
+		}
+	}
+}
+
+static void
+thread_send_msgs(struct spdk_thread *local_thread, const struct spdk_thread *thread,
+		 struct spdk_msg **msgs, uint32_t count)
+{
+	struct spdk_msg_channel *ch;
+
+	ch = thread_get_msg_channel(local_thread, thread);
+	if (ch != NULL) {
+		msg_channel_enqueue(local_thread, ch, msgs, count);
+	} else {
+		thread_enqueue_msgs(thread, msgs, count);
+	}
+}
+
+int
+spdk_thread_send_msg(const struct spdk_thread *thread, spdk_msg_fn fn, void *ctx)
+{
+	struct spdk_thread *local_thread;
+	struct spdk_msg *msg;
+
+	assert(thread != NULL);
+
+	if (spdk_unlikely(thread->state == SPDK_THREAD_STATE_EXITED)) {
+		SPDK_ERRLOG("Thread %s is marked as exited.\n", thread->name);
+		abort();
+	}
+
+	local_thread = _get_thread();
+
+	msg = thread_msg_get(local_thread);
+	msg->fn = fn;
+	msg->arg = ctx;
+
+	thread_send_msgs(local_thread, thread, &msg, 1);
 
 	return 0;
 }
 
+int
+spdk_thread_send_msg_batch(const struct spdk_thread *thread, spdk_msg_fn fn, void **ctxs,
+			   uint32_t count)
+{
+	struct spdk_thread *local_thread;
+	struct spdk_msg *msgs[SPDK_MSG_SEND_BATCH_SIZE];
+	uint32_t i, num;
+
+	assert(thread != NULL);
+
+	if (spdk_unlikely(thread->state == SPDK_THREAD_STATE_EXITED)) {
+		SPDK_ERRLOG("Thread %s is marked as exited.\n", thread->name);
+		abort();
+	}
+
+	local_thread = _get_thread();
+
+	while (count > 0) {
+		num = spdk_min(count, SPDK_MSG_SEND_BATCH_SIZE);
+		for (i = 0; i < num; i++) {
+			msgs[i] = thread_msg_get(local_thread);
+			msgs[i]->fn = fn;
+			msgs[i]->arg = ctxs[i];
+		}
+
+		thread_send_msgs(local_thread, thread, msgs, num);
+
+		ctxs += num;
+		count -= num;
+	}
+
+	return 0;
+}
+
+void
+spdk_thread_enable_msg_channels(bool enable)
+{
+	__atomic_store_n(&g_msg_channels_enabled, enable, __ATOMIC_RELAXED);
+}
+
+void
+spdk_thread_enable_cycle_accounting(bool enable)
+{
+	__atomic_store_n(&g_cycle_accounting_enabled, enable, __ATOMIC_RELAXED);
+}
+
+bool
+spdk_thread_cycle_accounting_is_enabled(void)
+{
+	return cycle_accounting_is_enabled();
+}
+
+void
+spdk_thread_get_callback_stats(struct spdk_thread *thread, spdk_thread_callback_stats_fn fn,
+			       void *ctx)
+{
+	uint32_t i;
+
+	assert(thread == spdk_get_thread());
+
+	if (thread->callback_stats == NULL) {
+		return;
+	}
+
+	for (i = 0; i <= SPDK_THREAD_CALLBACK_STATS_SIZE; i++) {
+		if (thread->callback_stats[i].run_count != 0) {
+			fn(&thread->callback_stats[i], ctx);
+		}
+	}
+}
+
 int
 spdk_thread_send_critical_msg(struct spdk_thread *thread, spdk_msg_fn fn)
 {
@@ -1495,7 +2214,7 @@ interrupt_timerfd_process(void *arg)
 
 	SPDK_DTRACE_PROBE2(timerfd_exec, poller->fn, poller->arg);
 
-	return poller->fn(poller->arg);
+	return poller_run(poller);
 }
 
 static int
@@ -1948,6 +2667,28 @@ spdk_poller_resume(struct spdk_poller *poller)
 	}
 }
 
+void
+spdk_poller_set_backoff(struct spdk_poller *poller, uint32_t max_interval)
+{
+	struct spdk_thread *thread;
+
+	thread = spdk_get_thread();
+	if (!thread) {
+		assert(false);
+		return;
+	}
+
+	if (poller->thread != thread) {
+		wrong_thread(__func__, poller->name, poller->thread, thread);
+		return;
+	}
+
+	poller->backoff_max = max_interval > 1 ? max_interval : 0;
+	poller->backoff_interval = 1;
+	poller->backoff_skip = 0;
+	poller->backoff_idle_runs = 0;
+}
+
 const char *
 spdk_poller_get_name(struct spdk_poller *poller)
 {
@@ -1990,6 +2731,10 @@ spdk_poller_get_stats(struct spdk_poller *poller, struct spdk_poller_stats *stat
 {
 	stats->run_count = poller->run_count;
 	stats->busy_count = poller->busy_count;
+	stats->skip_count = poller->skip_count;
+	stats->busy_tsc = poller->busy_tsc;
+	stats->idle_tsc = poller->idle_tsc;
+	stats->backoff_interval = poller->backoff_max != 0 ? poller->backoff_interval : 0;
 }
 
 struct spdk_poller *
@@ -2423,6 +3168,7 @@ spdk_get_io_channel(void *io_device)
 	ch->thread = thread;
 	ch->ref = 1;
 	ch->destroy_ref = 0;
+	ch->numa_id = SPDK_ENV_NUMA_ID_ANY;
 	RB_INSERT(io_channel_tree, &thread->io_channels, ch);
 
 	SPDK_DEBUGLOG(thread, "Get io_channel %p for io_device %s (%p) on thread %s refcnt %u\n",
@@ -2587,6 +3333,18 @@ spdk_io_channel_get_thread(struct spdk_io_channel *ch)
 	return ch->thread;
 }
 
+void
+spdk_io_channel_set_numa_id(struct spdk_io_channel *ch, int32_t numa_id)
+{
+	ch->numa_id = numa_id;
+}
+
+int32_t
+spdk_io_channel_get_numa_id(struct spdk_io_channel *ch)
+{
+	return ch->numa_id;
+}
+
 void *
 spdk_io_channel_get_io_device(struct spdk_io_channel *ch)
 {
@@ -2889,6 +3647,8 @@ _interrupt_wrapper(void *ctx)
 {
 	struct spdk_interrupt *intr = ctx;
 	struct spdk_thread *orig_thread, *thread;
+	spdk_interrupt_fn fn;
+	uint64_t tsc;
 	int rc;
 
 	orig_thread = spdk_get_thread();
@@ -2899,7 +3659,16 @@ _interrupt_wrapper(void *ctx)
 	SPDK_DTRACE_PROBE4(interrupt_fd_process, intr->name, intr->efd,
 			   intr->fn, intr->arg);
 
-	rc = intr->fn(intr->arg);
+	if (spdk_unlikely(cycle_accounting_is_enabled())) {
+		/* The handler may unregister, and free, its interrupt */
+		fn = intr->fn;
+		tsc = spdk_get_ticks();
+		rc = fn(intr->arg);
+		thread_account_callback(thread, fn, SPDK_THREAD_CALLBACK_INTERRUPT,
+					spdk_get_ticks() - tsc);
+	} else {
+		rc = intr->fn(intr->arg);
+	}
 
 	SPIN_ASSERT(thread->lock_count == 0, SPIN_ERR_HOLD_DURING_SWITCH);
 
@@ -0,0 +1,269 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/gf.h"
+#include "spdk/config.h"
+#include "spdk/assert.h"
+#include "spdk/util.h"
+
+/* x^8 + x^4 + x^3 + x^2 + 1 */
+#define SPDK_GF_POLY		0x11d
+
+/* maximum number of source buffers */
+#define SPDK_GF_MAX_SRC		255
+
+static uint8_t g_gf_exp[255 * 2];
+static uint8_t g_gf_log[256];
+
+__attribute__((constructor)) static void
+gf_init_tables(void)
+{
+	uint32_t x = 1;
+	int i;
+
+	for (i = 0; i < 255; i++) {
+		g_gf_exp[i] = x;
+		g_gf_exp[i + 255] = x;
+		g_gf_log[x] = i;
+
+		x <<= 1;
+		if (x & 0x100) {
+			x ^= SPDK_GF_POLY;
+		}
+	}
+}
+
+uint8_t
+spdk_gf_mul(uint8_t a, uint8_t b)
+{
+	if (a == 0 || b == 0) {
+		return 0;
+	}
+
+	return g_gf_exp[g_gf_log[a] + g_gf_log[b]];
+}
+
+uint8_t
+spdk_gf_inv(uint8_t a)
+{
+	if (a == 0) {
+		return 0;
+	}
+
+	return g_gf_exp[255 - g_gf_log[a]];
+}
+
+uint8_t
+spdk_gf_exp(int e)
+{
+	e %= 255;
+	if (e < 0) {
+		e += 255;
+	}
+
+	return g_gf_exp[e];
+}
+
+static inline bool
+is_aligned(void *ptr, size_t alignment)
+{
+	uintptr_t p = (uintptr_t)ptr;
+
+	return p == SPDK_ALIGN_FLOOR(p, alignment);
+}
+
+static bool
+buffers_aligned(void *p, void *q, void **sources, uint32_t n, size_t alignment)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		if (!is_aligned(sources[i], alignment)) {
+			return false;
+		}
+	}
+
+	return is_aligned(p, alignment) && is_aligned(q, alignment);
+}
+
+static inline uint8_t
+gf_mul2(uint8_t b)
+{
+	return (b << 1) ^ ((b & 0x80) ? (SPDK_GF_POLY & 0xff) : 0);
+}
+
+/* Multiply each of the 8 bytes packed in a word by 2 */
+static inline uint64_t
+gf_mul2_u64(uint64_t w)
+{
+	uint64_t hi = w & 0x8080808080808080ULL;
+	uint64_t mask = (hi << 1) - (hi >> 7);
+
+	return ((w << 1) & 0xfefefefefefefefeULL) ^ (mask & 0x1d1d1d1d1d1d1d1dULL);
+}
+
+static void
+gen_pq_unaligned(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	uint32_t i;
+	int j;
+
+	for (i = 0; i < len; i++) {
+		uint8_t pb = 0, qb = 0;
+
+		/* Horner's scheme: q = ((s[n-1] * g + s[n-2]) * g + ...) * g + s[0] */
+		for (j = n - 1; j >= 0; j--) {
+			uint8_t b = ((uint8_t *)sources[j])[i];
+
+			pb ^= b;
+			qb = gf_mul2(qb) ^ b;
+		}
+		((uint8_t *)p)[i] = pb;
+		((uint8_t *)q)[i] = qb;
+	}
+}
+
+static void
+gen_pq_basic(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	uint32_t shift;
+	uint32_t len_div, len_rem;
+	uint32_t i;
+	int j;
+
+	if (!buffers_aligned(p, q, sources, n, sizeof(uint64_t))) {
+		gen_pq_unaligned(p, q, sources, n, len);
+		return;
+	}
+
+	shift = spdk_u32log2(sizeof(uint64_t));
+	len_div = len >> shift;
+	len_rem = len_div << shift;
+
+	for (i = 0; i < len_div; i++) {
+		uint64_t pw = 0, qw = 0;
+
+		for (j = n - 1; j >= 0; j--) {
+			uint64_t w = ((uint64_t *)sources[j])[i];
+
+			pw ^= w;
+			qw = gf_mul2_u64(qw) ^ w;
+		}
+		((uint64_t *)p)[i] = pw;
+		((uint64_t *)q)[i] = qw;
+	}
+
+	if (len_rem < len) {
+		void *sources2[SPDK_GF_MAX_SRC];
+
+		for (i = 0; i < n; i++) {
+			sources2[i] = (uint8_t *)sources[i] + len_rem;
+		}
+
+		gen_pq_unaligned((uint8_t *)p + len_rem, (uint8_t *)q + len_rem, sources2, n,
+				 len - len_rem);
+	}
+}
+
+#ifdef SPDK_CONFIG_ISAL
+#include "spdk/isa-l.h"
+
+#define SPDK_GF_BUF_ALIGN 32
+
+static int
+do_gen_pq(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	if (buffers_aligned(p, q, sources, n, SPDK_GF_BUF_ALIGN) && len % SPDK_GF_BUF_ALIGN == 0) {
+		void *buffers[SPDK_GF_MAX_SRC + 2];
+
+		memcpy(buffers, sources, n * sizeof(buffers[0]));
+		buffers[n] = p;
+		buffers[n + 1] = q;
+
+		if (pq_gen(n + 2, len, buffers)) {
+			return -EINVAL;
+		}
+	} else {
+		gen_pq_basic(p, q, sources, n, len);
+	}
+
+	return 0;
+}
+
+static int
+do_vect_dot_prod(void *dest, void **sources, const uint8_t *coefs, uint32_t n, uint32_t len)
+{
+	uint8_t gftbls[32 * SPDK_GF_MAX_SRC];
+	uint8_t *coding[1] = { dest };
+
+	ec_init_tables(n, 1, (uint8_t *)coefs, gftbls);
+	ec_encode_data(len, n, 1, gftbls, (uint8_t **)sources, coding);
+
+	return 0;
+}
+
+#else
+
+static void
+vect_dot_prod_basic(void *dest, void **sources, const uint8_t *coefs, uint32_t n, uint32_t len)
+{
+	uint8_t *d = dest;
+	uint32_t i, j;
+
+	memset(d, 0, len);
+
+	for (j = 0; j < n; j++) {
+		const uint8_t *s = sources[j];
+		uint8_t log_c;
+
+		if (coefs[j] == 0) {
+			continue;
+		}
+
+		log_c = g_gf_log[coefs[j]];
+
+		for (i = 0; i < len; i++) {
+			if (s[i] != 0) {
+				d[i] ^= g_gf_exp[log_c + g_gf_log[s[i]]];
+			}
+		}
+	}
+}
+
+static inline int
+do_gen_pq(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	gen_pq_basic(p, q, sources, n, len);
+	return 0;
+}
+
+static inline int
+do_vect_dot_prod(void *dest, void **sources, const uint8_t *coefs, uint32_t n, uint32_t len)
+{
+	vect_dot_prod_basic(dest, sources, coefs, n, len);
+	return 0;
+}
+
+#endif
+
+int
+spdk_gf_gen_pq(void *p, void *q, void **sources, uint32_t n, uint32_t len)
+{
+	if (n < 2 || n > SPDK_GF_MAX_SRC) {
+		return -EINVAL;
+	}
+
+	return do_gen_pq(p, q, sources, n, len);
+}
+
+int
+spdk_gf_vect_dot_prod(void *dest, void **sources, const uint8_t *coefs, uint32_t n, uint32_t len)
+{
+	if (n < 1 || n > SPDK_GF_MAX_SRC) {
+		return -EINVAL;
+	}
+
+	return do_vect_dot_prod(dest, sources, coefs, n, len);
+}
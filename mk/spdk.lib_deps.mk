@@ -149,6 +149,10 @@ DEPDIRS-bdev_split := $(BDEV_DEPS)
 
 DEPDIRS-bdev_aio := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_crypto := $(BDEV_DEPS_THREAD) accel dma
+DEPDIRS-bdev_compress := $(BDEV_DEPS_THREAD) accel
+DEPDIRS-bdev_dedup := $(BDEV_DEPS_THREAD) accel
+DEPDIRS-bdev_rcache := $(BDEV_DEPS_THREAD)
+DEPDIRS-bdev_wbcache := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_delay := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_error := $(BDEV_DEPS_THREAD)
 DEPDIRS-bdev_iscsi := $(BDEV_DEPS_THREAD)
@@ -6,7 +6,7 @@
 
 BLOCKDEV_MODULES_LIST = bdev_malloc bdev_null bdev_nvme bdev_passthru bdev_lvol
 BLOCKDEV_MODULES_LIST += bdev_raid bdev_error bdev_gpt bdev_split bdev_delay
-BLOCKDEV_MODULES_LIST += bdev_zone_block
+BLOCKDEV_MODULES_LIST += bdev_zone_block bdev_compress bdev_dedup bdev_rcache bdev_wbcache
 BLOCKDEV_MODULES_LIST += blob_bdev blob lvol nvme
 
 # Some bdev modules don't have pollers, so they can directly run in interrupt mode
@@ -0,0 +1,2265 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_compress.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/bit_array.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/log.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+#include "spdk/uuid.h"
+
+#define COMP_SB_SIGNATURE	"SPDKCOMP"
+#define COMP_SB_VERSION		1
+#define COMP_LOG_MAGIC		0x474f4c504d4f43ULL /* "COMPLOG" */
+
+/* Size of the metadata log region */
+#define COMP_LOG_SIZE		(4 * 1024 * 1024)
+/* Number of chunk requests that can be processed concurrently per vbdev */
+#define COMP_NUM_REQS		128
+/* Number of chunk map blocks written concurrently during a checkpoint */
+#define COMP_CKPT_QD		32
+/* Number of replaced chunks whose data units are collected before a base bdev flush frees them */
+#define COMP_QUARANTINE_CHUNKS	64
+#define COMP_BUF_ALIGN		0x1000
+
+/*
+ * On-disk layout of the base bdev:
+ *
+ * | superblock | chunk map | metadata log | data units ... |
+ *
+ * The chunk map holds one 64-bit entry per logical chunk.  Bits 0-39 contain the first data
+ * unit the chunk is stored at and bits 40-63 the length of the stored data in bytes.  A length
+ * of 0 means the chunk is not allocated and reads as zeroes, a length equal to the chunk size
+ * means the chunk is stored uncompressed.  Chunks are never overwritten in place, each write
+ * allocates new data units and records the new map entry in the metadata log.  Once the log is
+ * full, the dirty part of the chunk map is written back and the log is restarted with a new
+ * generation number.
+ */
+#define COMP_MAP_UNIT_BITS	40
+#define COMP_MAP_UNIT_MASK	((1ULL << COMP_MAP_UNIT_BITS) - 1)
+
+struct vbdev_compress_sb {
+	uint8_t			signature[8];
+	uint32_t		version;
+	uint32_t		length;
+	uint32_t		crc;
+	uint32_t		block_size;
+	uint32_t		chunk_size;
+	uint32_t		io_unit_size;
+	uint8_t			comp_algo;
+	uint8_t			reserved0[3];
+	uint32_t		comp_level;
+	struct spdk_uuid	uuid;
+	char			name[64];
+	uint64_t		num_chunks;
+	/* Offsets and sizes of the regions, in base bdev blocks */
+	uint64_t		map_offset;
+	uint64_t		map_blocks;
+	uint64_t		log_offset;
+	uint64_t		log_blocks;
+	uint64_t		data_offset;
+	uint64_t		data_units;
+	uint64_t		generation;
+	uint8_t			reserved[328];
+} __attribute__((packed));
+SPDK_STATIC_ASSERT(sizeof(struct vbdev_compress_sb) == 512, "incorrect size");
+
+struct vbdev_compress_log_hdr {
+	uint64_t		magic;
+	struct spdk_uuid	uuid;
+	uint64_t		generation;
+	uint32_t		seq;
+	uint32_t		num_entries;
+	uint32_t		crc;
+	uint32_t		reserved;
+};
+SPDK_STATIC_ASSERT(sizeof(struct vbdev_compress_log_hdr) == 48, "incorrect size");
+
+struct vbdev_compress_log_entry {
+	uint64_t		chunk;
+	uint64_t		map_entry;
+};
+
+struct comp_log_waiter {
+	void			(*fn)(void *arg, int status);
+	void			*arg;
+	TAILQ_ENTRY(comp_log_waiter) link;
+};
+
+/* A metadata log block, either accumulating new entries or being written */
+struct comp_log_block {
+	void			*buf;
+	/* Map entries replaced by the entries of this block, released once it is persisted */
+	uint64_t		*old_entries;
+	uint32_t		num_entries;
+	TAILQ_HEAD(, comp_log_waiter) waiters;
+};
+
+struct comp_bdev_io;
+
+/* Context of a read or write of a single chunk */
+struct comp_req {
+	struct vbdev_compress	*comp;
+	struct comp_bdev_io	*io;
+	uint64_t		chunk;
+	uint64_t		new_entry;
+	uint32_t		comp_len;
+	/* Decompressed chunk data */
+	void			*chunk_buf;
+	/* Compressed chunk data */
+	void			*comp_buf;
+	struct iovec		chunk_iov;
+	struct iovec		comp_iov;
+	struct iovec		data_iov;
+	struct iovec		part_iov;
+	struct comp_log_waiter	log_waiter;
+	TAILQ_ENTRY(comp_req)	link;
+};
+
+struct vbdev_compress {
+	struct spdk_bdev		comp_bdev;
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	bool				base_claimed;
+	/* Metadata thread and its channels, all chunk I/O is done on this thread */
+	struct spdk_thread		*thread;
+	struct spdk_io_channel		*base_ch;
+	struct spdk_io_channel		*accel_ch;
+
+	struct vbdev_compress_sb	*sb;
+	uint32_t			blocklen;
+	uint32_t			chunk_blocks;
+	uint32_t			unit_blocks;
+	uint32_t			chunk_units;
+
+	/* Chunk map and the map blocks modified since the last checkpoint */
+	uint64_t			*map;
+	struct spdk_bit_array		*map_dirty;
+	/* Allocated data units */
+	struct spdk_bit_array		*allocated;
+	uint32_t			alloc_hint;
+	/* Chunks with a request in progress */
+	struct spdk_bit_array		*chunk_busy;
+
+	/*
+	 * Data units replaced by persisted log entries.  A log write isn't durable until the base
+	 * bdev is flushed, and until then the previous map entry may still be the one found on
+	 * disk after a crash, so the units can't be reused yet.  They're freed once a flush issued
+	 * after they were quarantined completes.
+	 */
+	struct spdk_bit_array		*quarantine;
+	uint32_t			quarantine_units;
+	/* Quarantined units covered by the flush in progress */
+	struct spdk_bit_array		*quarantine_flushing;
+	bool				quarantine_flush_active;
+	/* Requests waiting for the flush in progress to free some data units */
+	TAILQ_HEAD(, comp_log_waiter)	unit_waiters;
+
+	struct comp_req			*reqs;
+	void				*req_bufs;
+	TAILQ_HEAD(, comp_req)		free_reqs;
+	/* I/Os waiting for a free request or a busy chunk */
+	TAILQ_HEAD(, comp_bdev_io)	queued_ios;
+	bool				resuming;
+
+	/* Metadata log */
+	struct comp_log_block		log[2];
+	struct comp_log_block		*log_open;
+	uint32_t			log_entries_per_block;
+	uint32_t			log_seq;
+	bool				log_writing;
+	/* Waiters for free space in the open log block */
+	TAILQ_HEAD(, comp_log_waiter)	log_space_waiters;
+
+	/* Checkpoint state */
+	bool				ckpt_active;
+	uint32_t			ckpt_next;
+	uint32_t			ckpt_outstanding;
+	int				ckpt_status;
+	void				(*ckpt_cb)(struct vbdev_compress *comp, int status);
+
+	/* Statistics */
+	uint64_t			allocated_chunks;
+	uint64_t			stored_bytes;
+	uint64_t			used_units;
+
+	/* Volume initialization or load completion */
+	void				(*init_cb)(void *cb_arg, int status);
+	void				*init_cb_arg;
+	void				*init_buf;
+
+	/* Destroy the volume metadata when the vbdev is destructed */
+	bool				delete_pending;
+	/* Destruct waits for the flush of quarantined units in progress */
+	bool				destruct_pending;
+	TAILQ_ENTRY(vbdev_compress)	link;
+};
+
+static TAILQ_HEAD(, vbdev_compress) g_vbdev_compress = TAILQ_HEAD_INITIALIZER(g_vbdev_compress);
+
+struct comp_io_channel {
+	struct spdk_io_channel		*base_ch;
+};
+
+/* Per I/O context that the bdev layer allocates for us */
+struct comp_bdev_io {
+	struct vbdev_compress		*comp;
+	struct spdk_thread		*orig_thread;
+	enum spdk_bdev_io_status	status;
+	/* Next chunk to unmap */
+	uint64_t			unmap_chunk;
+	struct comp_log_waiter		log_waiter;
+	TAILQ_ENTRY(comp_bdev_io)	link;
+};
+
+static struct spdk_bdev_module compress_if;
+
+static void comp_log_flush(struct vbdev_compress *comp);
+static void comp_resume_queued(struct vbdev_compress *comp);
+static bool comp_unmap(struct comp_bdev_io *io);
+static void _vbdev_compress_destruct(void *ctx);
+
+static inline uint64_t
+comp_map_entry(uint64_t unit, uint32_t len)
+{
+	return ((uint64_t)len << COMP_MAP_UNIT_BITS) | unit;
+}
+
+static inline uint64_t
+comp_map_entry_unit(uint64_t entry)
+{
+	return entry & COMP_MAP_UNIT_MASK;
+}
+
+static inline uint32_t
+comp_map_entry_len(uint64_t entry)
+{
+	return entry >> COMP_MAP_UNIT_BITS;
+}
+
+static inline uint32_t
+comp_len_to_units(struct vbdev_compress *comp, uint32_t len)
+{
+	return spdk_divide_round_up(len, comp->sb->io_unit_size);
+}
+
+static inline uint64_t
+comp_unit_to_block(struct vbdev_compress *comp, uint64_t unit)
+{
+	return comp->sb->data_offset + unit * comp->unit_blocks;
+}
+
+static uint32_t
+comp_sb_crc(struct vbdev_compress_sb *sb)
+{
+	uint32_t crc, prev = sb->crc;
+
+	sb->crc = 0;
+	crc = spdk_crc32c_update(sb, sb->length, 0);
+	sb->crc = prev;
+
+	return crc;
+}
+
+static uint32_t
+comp_log_crc(struct vbdev_compress *comp, struct vbdev_compress_log_hdr *hdr)
+{
+	uint32_t crc, prev = hdr->crc;
+
+	hdr->crc = 0;
+	crc = spdk_crc32c_update(hdr, comp->blocklen, 0);
+	hdr->crc = prev;
+
+	return crc;
+}
+
+static inline struct vbdev_compress_log_entry *
+comp_log_entries(void *buf)
+{
+	return (struct vbdev_compress_log_entry *)((uint8_t *)buf +
+			sizeof(struct vbdev_compress_log_hdr));
+}
+
+/* Find and allocate num_units contiguous data units, starting from the last allocation. */
+static int
+comp_alloc_units(struct vbdev_compress *comp, uint32_t num_units, uint64_t *unit)
+{
+	uint32_t total = comp->sb->data_units;
+	uint32_t start = comp->alloc_hint, end, i;
+	bool wrapped = false;
+
+	while (true) {
+		if (wrapped && start >= comp->alloc_hint) {
+			break;
+		}
+
+		start = spdk_bit_array_find_first_clear(comp->allocated, start);
+		if (start == UINT32_MAX || (uint64_t)start + num_units > total) {
+			if (wrapped) {
+				break;
+			}
+			wrapped = true;
+			start = 0;
+			continue;
+		}
+
+		end = spdk_bit_array_find_first_set(comp->allocated, start);
+		if (end == UINT32_MAX) {
+			end = total;
+		}
+
+		if (end - start >= num_units) {
+			for (i = start; i < start + num_units; i++) {
+				spdk_bit_array_set(comp->allocated, i);
+			}
+			comp->used_units += num_units;
+			comp->alloc_hint = start + num_units;
+			if (comp->alloc_hint >= total) {
+				comp->alloc_hint = 0;
+			}
+			*unit = start;
+			return 0;
+		}
+
+		start = end;
+	}
+
+	return -ENOSPC;
+}
+
+static void
+comp_free_units(struct vbdev_compress *comp, uint64_t unit, uint32_t num_units)
+{
+	uint32_t i;
+
+	for (i = 0; i < num_units; i++) {
+		assert(spdk_bit_array_get(comp->allocated, unit + i));
+		spdk_bit_array_clear(comp->allocated, unit + i);
+	}
+	comp->used_units -= num_units;
+}
+
+static void
+comp_free_entry(struct vbdev_compress *comp, uint64_t entry)
+{
+	uint32_t len = comp_map_entry_len(entry);
+
+	if (len != 0) {
+		comp_free_units(comp, comp_map_entry_unit(entry), comp_len_to_units(comp, len));
+	}
+}
+
+static void comp_quarantine_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg);
+
+/* Flush the base bdev to free the quarantined units, unless there's too few of them to bother.
+ * All of the base bdev is flushed so that the data of the replacing entries is persisted too.
+ */
+static int
+comp_quarantine_flush(struct vbdev_compress *comp, bool force)
+{
+	struct spdk_bit_array *tmp;
+	int rc;
+
+	if (comp->quarantine_flush_active || comp->quarantine_units == 0 ||
+	    (!force && comp->quarantine_units < COMP_QUARANTINE_CHUNKS * comp->chunk_units)) {
+		return 0;
+	}
+
+	rc = spdk_bdev_flush_blocks(comp->base_desc, comp->base_ch, 0,
+				    spdk_bdev_get_num_blocks(comp->base_bdev),
+				    comp_quarantine_flush_done, comp);
+	if (rc != 0) {
+		/* Retried with the next log write */
+		return rc;
+	}
+
+	tmp = comp->quarantine_flushing;
+	comp->quarantine_flushing = comp->quarantine;
+	comp->quarantine = tmp;
+	comp->quarantine_units = 0;
+	comp->quarantine_flush_active = true;
+
+	return 0;
+}
+
+static void
+comp_quarantine_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+	struct comp_log_waiter *waiter, *tmp;
+	TAILQ_HEAD(, comp_log_waiter) waiters;
+	struct spdk_bit_array *flushed = comp->quarantine_flushing;
+	uint32_t unit = 0;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to flush base bdev of compress bdev %s\n", comp->sb->name);
+	}
+
+	/* Units of a failed flush are kept for the next one */
+	while ((unit = spdk_bit_array_find_first_set(flushed, unit)) != UINT32_MAX) {
+		spdk_bit_array_clear(flushed, unit);
+		if (success) {
+			spdk_bit_array_clear(comp->allocated, unit);
+		} else {
+			spdk_bit_array_set(comp->quarantine, unit);
+			comp->quarantine_units++;
+		}
+	}
+	comp->quarantine_flush_active = false;
+
+	if (comp->destruct_pending) {
+		assert(TAILQ_EMPTY(&comp->unit_waiters));
+		_vbdev_compress_destruct(comp);
+		return;
+	}
+
+	TAILQ_INIT(&waiters);
+	TAILQ_SWAP(&waiters, &comp->unit_waiters, comp_log_waiter, link);
+	TAILQ_FOREACH_SAFE(waiter, &waiters, link, tmp) {
+		TAILQ_REMOVE(&waiters, waiter, link);
+		waiter->fn(waiter->arg, success ? 0 : -EIO);
+	}
+
+	if (success) {
+		comp_quarantine_flush(comp, false);
+	}
+}
+
+/* Quarantine the data units referenced by a map entry that was replaced in the log. They no
+ * longer count as used, but stay allocated until the base bdev is flushed.
+ */
+static void
+comp_quarantine_entry(struct vbdev_compress *comp, uint64_t entry)
+{
+	uint32_t len = comp_map_entry_len(entry);
+	uint32_t num_units = comp_len_to_units(comp, len);
+	uint64_t unit = comp_map_entry_unit(entry);
+	uint32_t i;
+
+	if (len == 0) {
+		return;
+	}
+
+	/* Without a volatile write cache, a completed write is persistent */
+	if (!spdk_bdev_io_type_supported(comp->base_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		comp_free_units(comp, unit, num_units);
+		return;
+	}
+
+	for (i = 0; i < num_units; i++) {
+		assert(spdk_bit_array_get(comp->allocated, unit + i));
+		spdk_bit_array_set(comp->quarantine, unit + i);
+	}
+	comp->quarantine_units += num_units;
+	comp->used_units -= num_units;
+}
+
+/* Wait for quarantined units to be freed when there's no free space left. Returns -ENOSPC if
+ * there's nothing to wait for.
+ */
+static int
+comp_quarantine_wait(struct vbdev_compress *comp, struct comp_log_waiter *waiter)
+{
+	int rc;
+
+	if (!comp->quarantine_flush_active) {
+		if (comp->quarantine_units == 0) {
+			return -ENOSPC;
+		}
+
+		rc = comp_quarantine_flush(comp, true);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&comp->unit_waiters, waiter, link);
+
+	return 0;
+}
+
+static void
+comp_update_stats(struct vbdev_compress *comp, uint64_t old_entry, uint64_t new_entry)
+{
+	uint32_t old_len = comp_map_entry_len(old_entry);
+	uint32_t new_len = comp_map_entry_len(new_entry);
+
+	comp->stored_bytes = comp->stored_bytes - old_len + new_len;
+	if (old_len == 0 && new_len != 0) {
+		comp->allocated_chunks++;
+	} else if (old_len != 0 && new_len == 0) {
+		comp->allocated_chunks--;
+	}
+}
+
+/* Update the chunk map and record the change in the open log block. The caller has to make
+ * sure the open block has a free slot. Data units referenced by the previous entry are
+ * quarantined once the log block is persisted.
+ */
+static void
+comp_log_append(struct vbdev_compress *comp, uint64_t chunk, uint64_t entry)
+{
+	struct comp_log_block *block = comp->log_open;
+	struct vbdev_compress_log_entry *log_entry;
+	uint64_t old_entry = comp->map[chunk];
+
+	assert(block->num_entries < comp->log_entries_per_block);
+
+	log_entry = &comp_log_entries(block->buf)[block->num_entries];
+	log_entry->chunk = chunk;
+	log_entry->map_entry = entry;
+	block->old_entries[block->num_entries++] = old_entry;
+
+	comp->map[chunk] = entry;
+	spdk_bit_array_set(comp->map_dirty, chunk * sizeof(uint64_t) / comp->blocklen);
+	comp_update_stats(comp, old_entry, entry);
+}
+
+/* Undo an entry of a log block that failed to be written. Its data units were never referenced
+ * on disk, so they're freed right away.
+ */
+static void
+comp_log_rollback(struct vbdev_compress *comp, struct comp_log_block *block, uint32_t idx)
+{
+	struct vbdev_compress_log_entry *log_entry = &comp_log_entries(block->buf)[idx];
+	struct comp_log_block *open = comp->log_open;
+	uint64_t chunk = log_entry->chunk;
+	uint64_t old_entry = block->old_entries[idx];
+	uint32_t i;
+
+	if (comp->map[chunk] == log_entry->map_entry) {
+		comp->map[chunk] = old_entry;
+		spdk_bit_array_set(comp->map_dirty, chunk * sizeof(uint64_t) / comp->blocklen);
+	} else {
+		/* The chunk was changed again in the open block, that entry replaces the old one */
+		assert(open != block);
+		for (i = 0; i < open->num_entries; i++) {
+			if (comp_log_entries(open->buf)[i].chunk == chunk &&
+			    open->old_entries[i] == log_entry->map_entry) {
+				open->old_entries[i] = old_entry;
+				break;
+			}
+		}
+		assert(i < open->num_entries);
+	}
+
+	comp_update_stats(comp, log_entry->map_entry, old_entry);
+	comp_free_entry(comp, log_entry->map_entry);
+}
+
+static inline bool
+comp_log_has_space(struct vbdev_compress *comp)
+{
+	return comp->log_open->num_entries < comp->log_entries_per_block;
+}
+
+/* Call waiter->fn once all log entries appended so far are persisted. */
+static void
+comp_log_wait(struct vbdev_compress *comp, struct comp_log_waiter *waiter)
+{
+	TAILQ_INSERT_TAIL(&comp->log_open->waiters, waiter, link);
+	comp_log_flush(comp);
+}
+
+/* Quarantine the data units replaced by the entries of a persisted block, or roll the entries
+ * back if the block couldn't be written, and notify its waiters.
+ */
+static void
+comp_log_block_done(struct vbdev_compress *comp, struct comp_log_block *block, bool success)
+{
+	struct comp_log_waiter *waiter, *tmp;
+	TAILQ_HEAD(, comp_log_waiter) waiters;
+	uint32_t i;
+
+	if (success) {
+		for (i = 0; i < block->num_entries; i++) {
+			comp_quarantine_entry(comp, block->old_entries[i]);
+		}
+	} else {
+		/* Later entries for the same chunk are undone first */
+		for (i = block->num_entries; i > 0; i--) {
+			comp_log_rollback(comp, block, i - 1);
+		}
+	}
+	block->num_entries = 0;
+
+	TAILQ_INIT(&waiters);
+	TAILQ_SWAP(&waiters, &block->waiters, comp_log_waiter, link);
+
+	while ((waiter = TAILQ_FIRST(&comp->log_space_waiters)) && comp_log_has_space(comp)) {
+		TAILQ_REMOVE(&comp->log_space_waiters, waiter, link);
+		waiter->fn(waiter->arg, 0);
+	}
+
+	TAILQ_FOREACH_SAFE(waiter, &waiters, link, tmp) {
+		TAILQ_REMOVE(&waiters, waiter, link);
+		waiter->fn(waiter->arg, success ? 0 : -EIO);
+	}
+}
+
+static void
+comp_log_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+	struct comp_log_block *block = comp->log_open == &comp->log[0] ? &comp->log[1] : &comp->log[0];
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (success) {
+		comp->log_seq++;
+	} else {
+		SPDK_ERRLOG("Failed to write metadata log of compress bdev %s\n", comp->sb->name);
+	}
+
+	/* Entries appended by the waiters are written together once they're all notified */
+	comp_log_block_done(comp, block, success);
+	comp->log_writing = false;
+	comp_log_flush(comp);
+	comp_quarantine_flush(comp, false);
+}
+
+static void comp_checkpoint(struct vbdev_compress *comp,
+			    void (*cb_fn)(struct vbdev_compress *comp, int status));
+
+static void
+comp_log_checkpoint_done(struct vbdev_compress *comp, int status)
+{
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to checkpoint compress bdev %s: %s\n", comp->sb->name,
+			    spdk_strerror(-status));
+		comp->log_writing = true;
+		comp_log_block_done(comp, comp->log_open, false);
+		comp->log_writing = false;
+	}
+
+	comp_log_flush(comp);
+}
+
+/* Write the open log block if there's no other write in progress. */
+static void
+comp_log_flush(struct vbdev_compress *comp)
+{
+	struct comp_log_block *block = comp->log_open;
+	struct vbdev_compress_log_hdr *hdr;
+	int rc;
+
+	if (comp->log_writing || comp->ckpt_active || block->num_entries == 0) {
+		return;
+	}
+
+	if (comp->log_seq == comp->sb->log_blocks) {
+		comp_checkpoint(comp, comp_log_checkpoint_done);
+		return;
+	}
+
+	hdr = block->buf;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = COMP_LOG_MAGIC;
+	hdr->uuid = comp->sb->uuid;
+	hdr->generation = comp->sb->generation;
+	hdr->seq = comp->log_seq;
+	hdr->num_entries = block->num_entries;
+	memset(&comp_log_entries(block->buf)[block->num_entries], 0,
+	       (comp->log_entries_per_block - block->num_entries) *
+	       sizeof(struct vbdev_compress_log_entry));
+	hdr->crc = comp_log_crc(comp, hdr);
+
+	/* Further entries go to the other block while this one is being written */
+	comp->log_open = block == &comp->log[0] ? &comp->log[1] : &comp->log[0];
+	comp->log_writing = true;
+
+	rc = spdk_bdev_write_blocks(comp->base_desc, comp->base_ch, block->buf,
+				    comp->sb->log_offset + comp->log_seq, 1,
+				    comp_log_write_done, comp);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to submit metadata log write: %s\n", spdk_strerror(-rc));
+		comp_log_write_done(NULL, false, comp);
+	}
+}
+
+static void
+comp_checkpoint_complete(struct vbdev_compress *comp, int status)
+{
+	comp->ckpt_active = false;
+	comp->ckpt_cb(comp, status);
+}
+
+static void
+comp_checkpoint_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to write superblock of compress bdev %s\n", comp->sb->name);
+		comp_checkpoint_complete(comp, -EIO);
+		return;
+	}
+
+	comp->log_seq = 0;
+	comp_checkpoint_complete(comp, 0);
+}
+
+static void
+comp_checkpoint_write_sb(struct vbdev_compress *comp)
+{
+	int rc;
+
+	comp->sb->generation++;
+	comp->sb->crc = comp_sb_crc(comp->sb);
+
+	rc = spdk_bdev_write_blocks(comp->base_desc, comp->base_ch, comp->sb, 0, 1,
+				    comp_checkpoint_sb_done, comp);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to submit superblock write: %s\n", spdk_strerror(-rc));
+		comp->sb->generation--;
+		comp_checkpoint_complete(comp, rc);
+	}
+}
+
+static void
+comp_checkpoint_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		comp_checkpoint_complete(comp, -EIO);
+		return;
+	}
+
+	comp_checkpoint_write_sb(comp);
+}
+
+/* The chunk map has to be persisted before the new log generation starts */
+static void
+comp_checkpoint_map_done(struct vbdev_compress *comp)
+{
+	int rc;
+
+	if (comp->ckpt_status != 0) {
+		comp_checkpoint_complete(comp, comp->ckpt_status);
+		return;
+	}
+
+	if (!spdk_bdev_io_type_supported(comp->base_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		comp_checkpoint_write_sb(comp);
+		return;
+	}
+
+	rc = spdk_bdev_flush_blocks(comp->base_desc, comp->base_ch, comp->sb->map_offset,
+				    comp->sb->map_blocks, comp_checkpoint_flush_done, comp);
+	if (rc != 0) {
+		comp_checkpoint_complete(comp, rc);
+	}
+}
+
+static void comp_checkpoint_write_map(struct vbdev_compress *comp);
+
+static void
+comp_checkpoint_map_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	assert(comp->ckpt_outstanding > 0);
+	comp->ckpt_outstanding--;
+	if (!success) {
+		comp->ckpt_status = -EIO;
+	}
+
+	comp_checkpoint_write_map(comp);
+}
+
+static void
+comp_checkpoint_write_map(struct vbdev_compress *comp)
+{
+	uint32_t block;
+	int rc;
+
+	while (comp->ckpt_status == 0 && comp->ckpt_outstanding < COMP_CKPT_QD) {
+		block = spdk_bit_array_find_first_set(comp->map_dirty, comp->ckpt_next);
+		if (block == UINT32_MAX) {
+			break;
+		}
+
+		rc = spdk_bdev_write_blocks(comp->base_desc, comp->base_ch,
+					    (uint8_t *)comp->map + (uint64_t)block * comp->blocklen,
+					    comp->sb->map_offset + block, 1,
+					    comp_checkpoint_map_write_done, comp);
+		if (rc != 0) {
+			if (rc == -ENOMEM && comp->ckpt_outstanding > 0) {
+				/* Retry when one of the outstanding writes completes */
+				break;
+			}
+			comp->ckpt_status = rc;
+			break;
+		}
+
+		spdk_bit_array_clear(comp->map_dirty, block);
+		comp->ckpt_next = block + 1;
+		comp->ckpt_outstanding++;
+	}
+
+	if (comp->ckpt_outstanding == 0) {
+		comp_checkpoint_map_done(comp);
+	}
+}
+
+/* Write back the dirty chunk map blocks and start a new log generation. */
+static void
+comp_checkpoint(struct vbdev_compress *comp, void (*cb_fn)(struct vbdev_compress *comp, int status))
+{
+	assert(!comp->ckpt_active);
+	assert(!comp->log_writing);
+
+	SPDK_DEBUGLOG(vbdev_compress, "%s: checkpoint of generation %" PRIu64 "\n",
+		      comp->sb->name, comp->sb->generation);
+
+	comp->ckpt_active = true;
+	comp->ckpt_next = 0;
+	comp->ckpt_outstanding = 0;
+	comp->ckpt_status = 0;
+	comp->ckpt_cb = cb_fn;
+
+	comp_checkpoint_write_map(comp);
+}
+
+static void
+_comp_io_complete(void *ctx)
+{
+	struct comp_bdev_io *io = ctx;
+
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), io->status);
+}
+
+static void
+comp_io_complete(struct comp_bdev_io *io, int status)
+{
+	if (spdk_likely(status == 0)) {
+		io->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	} else if (status == -ENOMEM) {
+		io->status = SPDK_BDEV_IO_STATUS_NOMEM;
+	} else {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	if (io->orig_thread != spdk_get_thread()) {
+		spdk_thread_send_msg(io->orig_thread, _comp_io_complete, io);
+	} else {
+		_comp_io_complete(io);
+	}
+}
+
+static void
+comp_req_complete(struct comp_req *req, int status)
+{
+	struct vbdev_compress *comp = req->comp;
+	struct comp_bdev_io *io = req->io;
+
+	spdk_bit_array_clear(comp->chunk_busy, req->chunk);
+	TAILQ_INSERT_HEAD(&comp->free_reqs, req, link);
+
+	comp_io_complete(io, status);
+	comp_resume_queued(comp);
+}
+
+static void
+comp_req_logged(void *arg, int status)
+{
+	struct comp_req *req = arg;
+
+	comp_req_complete(req, status);
+}
+
+static void
+comp_req_log(void *arg, int status)
+{
+	struct comp_req *req = arg;
+	struct vbdev_compress *comp = req->comp;
+
+	if (!comp_log_has_space(comp)) {
+		req->log_waiter.fn = comp_req_log;
+		TAILQ_INSERT_TAIL(&comp->log_space_waiters, &req->log_waiter, link);
+		return;
+	}
+
+	comp_log_append(comp, req->chunk, req->new_entry);
+
+	req->log_waiter.fn = comp_req_logged;
+	comp_log_wait(comp, &req->log_waiter);
+}
+
+static void comp_write_data(struct comp_req *req, int status);
+
+static void
+comp_write_data_retry(void *arg, int status)
+{
+	struct comp_req *req = arg;
+
+	if (status != 0) {
+		comp_req_complete(req, status);
+		return;
+	}
+
+	comp_write_data(req, 0);
+}
+
+static void
+comp_write_data_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct comp_req *req = cb_arg;
+	struct vbdev_compress *comp = req->comp;
+	uint32_t len = comp_map_entry_len(req->new_entry);
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		comp_free_units(comp, comp_map_entry_unit(req->new_entry), comp_len_to_units(comp, len));
+		comp_req_complete(req, -EIO);
+		return;
+	}
+
+	comp_req_log(req, 0);
+}
+
+/* Store the compressed chunk, or the raw data if compression didn't save any space. */
+static void
+comp_write_data(struct comp_req *req, int status)
+{
+	struct vbdev_compress *comp = req->comp;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	struct iovec *iovs;
+	uint32_t len, num_units;
+	uint64_t unit;
+	int iovcnt, rc;
+
+	if (status == 0 && comp_len_to_units(comp, req->comp_len) < comp->chunk_units) {
+		len = req->comp_len;
+		num_units = comp_len_to_units(comp, len);
+		req->data_iov.iov_base = req->comp_buf;
+		req->data_iov.iov_len = num_units * comp->sb->io_unit_size;
+		iovs = &req->data_iov;
+		iovcnt = 1;
+	} else {
+		len = comp->sb->chunk_size;
+		num_units = comp->chunk_units;
+		if (bdev_io->u.bdev.num_blocks == comp->chunk_blocks) {
+			iovs = bdev_io->u.bdev.iovs;
+			iovcnt = bdev_io->u.bdev.iovcnt;
+		} else {
+			iovs = &req->chunk_iov;
+			iovcnt = 1;
+		}
+	}
+
+	rc = comp_alloc_units(comp, num_units, &unit);
+	if (rc != 0) {
+		/* Retry with the same length once the quarantined units are freed */
+		req->comp_len = len;
+		req->log_waiter.fn = comp_write_data_retry;
+		if (comp_quarantine_wait(comp, &req->log_waiter) == 0) {
+			return;
+		}
+
+		SPDK_ERRLOG("%s: no space left to store chunk %" PRIu64 "\n", comp->sb->name, req->chunk);
+		comp_req_complete(req, rc);
+		return;
+	}
+	req->new_entry = comp_map_entry(unit, len);
+
+	rc = spdk_bdev_writev_blocks_ext(comp->base_desc, comp->base_ch, iovs, iovcnt,
+					 comp_unit_to_block(comp, unit), num_units * comp->unit_blocks,
+					 comp_write_data_done, req, NULL);
+	if (rc != 0) {
+		comp_free_units(comp, unit, num_units);
+		comp_req_complete(req, rc);
+	}
+}
+
+static void
+comp_compress_done(void *cb_arg, int status)
+{
+	struct comp_req *req = cb_arg;
+
+	if (status != 0) {
+		SPDK_DEBUGLOG(vbdev_compress, "Chunk %" PRIu64 " not compressed: %d\n", req->chunk, status);
+	}
+
+	comp_write_data(req, status);
+}
+
+static void
+comp_compress(struct comp_req *req, struct iovec *iovs, int iovcnt)
+{
+	struct vbdev_compress *comp = req->comp;
+	int rc;
+
+	rc = spdk_accel_submit_compress_ext(comp->accel_ch, req->comp_buf, comp->sb->chunk_size,
+					    iovs, iovcnt, comp->sb->comp_algo, comp->sb->comp_level,
+					    &req->comp_len, comp_compress_done, req);
+	if (rc != 0) {
+		/* Store the data uncompressed */
+		comp_write_data(req, rc);
+	}
+}
+
+/* Merge the new data into the current chunk contents and compress the result */
+static void
+comp_write_merge(struct comp_req *req)
+{
+	struct vbdev_compress *comp = req->comp;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	uint64_t offset = bdev_io->u.bdev.offset_blocks - req->chunk * comp->chunk_blocks;
+
+	spdk_copy_iovs_to_buf((uint8_t *)req->chunk_buf + offset * comp->blocklen,
+			      bdev_io->u.bdev.num_blocks * comp->blocklen,
+			      bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+
+	comp_compress(req, &req->chunk_iov, 1);
+}
+
+static void
+comp_write_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct comp_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		comp_req_complete(req, -EIO);
+		return;
+	}
+
+	comp_write_merge(req);
+}
+
+/* Read the chunk into chunk_buf, decompressing it on the way if needed. */
+static int
+comp_read_chunk(struct comp_req *req, spdk_bdev_io_completion_cb cb_fn)
+{
+	struct vbdev_compress *comp = req->comp;
+	uint64_t entry = comp->map[req->chunk];
+	uint32_t len = comp_map_entry_len(entry);
+	uint32_t num_units = comp_len_to_units(comp, len);
+	struct spdk_bdev_ext_io_opts opts = {};
+	struct spdk_accel_sequence *seq = NULL;
+	int rc;
+
+	if (len == comp->sb->chunk_size) {
+		return spdk_bdev_readv_blocks_ext(comp->base_desc, comp->base_ch, &req->chunk_iov, 1,
+						  comp_unit_to_block(comp, comp_map_entry_unit(entry)),
+						  comp->chunk_blocks, cb_fn, req, NULL);
+	}
+
+	req->comp_iov.iov_base = req->comp_buf;
+	req->comp_iov.iov_len = len;
+	req->data_iov.iov_base = req->comp_buf;
+	req->data_iov.iov_len = num_units * comp->sb->io_unit_size;
+
+	rc = spdk_accel_append_decompress_ext(&seq, comp->accel_ch, &req->chunk_iov, 1, NULL, NULL,
+					      &req->comp_iov, 1, NULL, NULL, comp->sb->comp_algo,
+					      NULL, NULL);
+	if (rc != 0) {
+		return rc;
+	}
+
+	opts.size = sizeof(opts);
+	opts.accel_sequence = seq;
+	rc = spdk_bdev_readv_blocks_ext(comp->base_desc, comp->base_ch, &req->data_iov, 1,
+					comp_unit_to_block(comp, comp_map_entry_unit(entry)),
+					num_units * comp->unit_blocks, cb_fn, req, &opts);
+	if (rc != 0) {
+		spdk_accel_sequence_abort(seq);
+	}
+
+	return rc;
+}
+
+static void
+comp_write(struct comp_req *req)
+{
+	struct vbdev_compress *comp = req->comp;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	int rc;
+
+	if (bdev_io->u.bdev.num_blocks == comp->chunk_blocks) {
+		comp_compress(req, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt);
+		return;
+	}
+
+	/* Partial chunk write, read-modify-write the whole chunk */
+	if (comp_map_entry_len(comp->map[req->chunk]) == 0) {
+		memset(req->chunk_buf, 0, comp->sb->chunk_size);
+		comp_write_merge(req);
+		return;
+	}
+
+	rc = comp_read_chunk(req, comp_write_read_done);
+	if (rc != 0) {
+		comp_req_complete(req, rc);
+	}
+}
+
+static void
+comp_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct comp_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	comp_req_complete(req, success ? 0 : -EIO);
+}
+
+/* Read a chunk, the decompression (and the copy of a partial chunk to the destination buffers)
+ * is executed as an accel sequence chained to the base bdev read.
+ */
+static void
+comp_read(struct comp_req *req)
+{
+	struct vbdev_compress *comp = req->comp;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	uint64_t entry = comp->map[req->chunk];
+	uint64_t offset = bdev_io->u.bdev.offset_blocks - req->chunk * comp->chunk_blocks;
+	uint32_t len = comp_map_entry_len(entry);
+	uint32_t num_units = comp_len_to_units(comp, len);
+	struct spdk_bdev_ext_io_opts opts = {};
+	struct spdk_accel_sequence *seq = NULL;
+	int rc;
+
+	if (len == 0) {
+		spdk_iov_memset(bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, 0);
+		comp_req_complete(req, 0);
+		return;
+	}
+
+	if (len == comp->sb->chunk_size) {
+		rc = spdk_bdev_readv_blocks_ext(comp->base_desc, comp->base_ch,
+						bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+						comp_unit_to_block(comp, comp_map_entry_unit(entry)) + offset,
+						bdev_io->u.bdev.num_blocks, comp_read_done, req, NULL);
+		if (rc != 0) {
+			comp_req_complete(req, rc);
+		}
+		return;
+	}
+
+	req->comp_iov.iov_base = req->comp_buf;
+	req->comp_iov.iov_len = len;
+	req->data_iov.iov_base = req->comp_buf;
+	req->data_iov.iov_len = num_units * comp->sb->io_unit_size;
+
+	if (bdev_io->u.bdev.num_blocks == comp->chunk_blocks) {
+		rc = spdk_accel_append_decompress_ext(&seq, comp->accel_ch,
+						      bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+						      NULL, NULL, &req->comp_iov, 1, NULL, NULL,
+						      comp->sb->comp_algo, NULL, NULL);
+	} else {
+		rc = spdk_accel_append_decompress_ext(&seq, comp->accel_ch, &req->chunk_iov, 1,
+						      NULL, NULL, &req->comp_iov, 1, NULL, NULL,
+						      comp->sb->comp_algo, NULL, NULL);
+		if (rc == 0) {
+			req->part_iov.iov_base = (uint8_t *)req->chunk_buf + offset * comp->blocklen;
+			req->part_iov.iov_len = bdev_io->u.bdev.num_blocks * comp->blocklen;
+			rc = spdk_accel_append_copy(&seq, comp->accel_ch,
+						    bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+						    NULL, NULL, &req->part_iov, 1, NULL, NULL,
+						    NULL, NULL);
+		}
+	}
+	if (rc != 0) {
+		spdk_accel_sequence_abort(seq);
+		comp_req_complete(req, rc);
+		return;
+	}
+
+	opts.size = sizeof(opts);
+	opts.accel_sequence = seq;
+	rc = spdk_bdev_readv_blocks_ext(comp->base_desc, comp->base_ch, &req->data_iov, 1,
+					comp_unit_to_block(comp, comp_map_entry_unit(entry)),
+					num_units * comp->unit_blocks, comp_read_done, req, &opts);
+	if (rc != 0) {
+		spdk_accel_sequence_abort(seq);
+		comp_req_complete(req, rc);
+	}
+}
+
+static void
+comp_unmap_continue(struct comp_bdev_io *io)
+{
+	/* Resumed with the queued I/Os once the busy chunk is released */
+	if (!comp_unmap(io)) {
+		TAILQ_INSERT_TAIL(&io->comp->queued_ios, io, link);
+	}
+}
+
+static void
+comp_unmap_logged(void *arg, int status)
+{
+	struct comp_bdev_io *io = arg;
+
+	if (status != 0) {
+		comp_io_complete(io, status);
+		return;
+	}
+
+	comp_unmap_continue(io);
+}
+
+static void
+comp_unmap_retry(void *arg, int status)
+{
+	comp_unmap_continue(arg);
+}
+
+/* Release the chunks fully covered by the unmapped range. Partially covered chunks are left
+ * untouched. Returns false if the unmap has to wait for the request in progress on a chunk.
+ */
+static bool
+comp_unmap(struct comp_bdev_io *io)
+{
+	struct vbdev_compress *comp = io->comp;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	uint64_t end = (bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks) /
+		       comp->chunk_blocks;
+	bool busy = false, appended = false;
+
+	for (; io->unmap_chunk < end; io->unmap_chunk++) {
+		/* A read or a write in progress still uses the current map entry */
+		if (spdk_bit_array_get(comp->chunk_busy, io->unmap_chunk)) {
+			busy = true;
+			break;
+		}
+
+		if (comp_map_entry_len(comp->map[io->unmap_chunk]) == 0) {
+			continue;
+		}
+
+		if (!comp_log_has_space(comp)) {
+			break;
+		}
+
+		comp_log_append(comp, io->unmap_chunk, 0);
+		appended = true;
+	}
+
+	if (appended) {
+		io->log_waiter.fn = comp_unmap_logged;
+		comp_log_wait(comp, &io->log_waiter);
+	} else if (busy) {
+		return false;
+	} else if (io->unmap_chunk < end) {
+		io->log_waiter.fn = comp_unmap_retry;
+		TAILQ_INSERT_TAIL(&comp->log_space_waiters, &io->log_waiter, link);
+	} else {
+		comp_io_complete(io, 0);
+	}
+
+	return true;
+}
+
+/* Start processing a chunk I/O, returns false if it has to wait for a request or for another
+ * request to the same chunk.
+ */
+static bool
+comp_io_start(struct comp_bdev_io *io)
+{
+	struct vbdev_compress *comp = io->comp;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	uint64_t chunk = bdev_io->u.bdev.offset_blocks / comp->chunk_blocks;
+	struct comp_req *req;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_UNMAP) {
+		return comp_unmap(io);
+	}
+
+	assert(bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks <=
+	       (chunk + 1) * comp->chunk_blocks);
+
+	req = TAILQ_FIRST(&comp->free_reqs);
+	if (req == NULL || spdk_bit_array_get(comp->chunk_busy, chunk)) {
+		return false;
+	}
+
+	TAILQ_REMOVE(&comp->free_reqs, req, link);
+	spdk_bit_array_set(comp->chunk_busy, chunk);
+	req->io = io;
+	req->chunk = chunk;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_READ) {
+		comp_read(req);
+	} else {
+		comp_write(req);
+	}
+
+	return true;
+}
+
+static void
+comp_resume_queued(struct vbdev_compress *comp)
+{
+	struct comp_bdev_io *io, *tmp;
+
+	/* Requests completed synchronously while resuming will be picked up by this loop */
+	if (comp->resuming) {
+		return;
+	}
+
+	comp->resuming = true;
+	TAILQ_FOREACH_SAFE(io, &comp->queued_ios, link, tmp) {
+		if (TAILQ_EMPTY(&comp->free_reqs)) {
+			break;
+		}
+
+		TAILQ_REMOVE(&comp->queued_ios, io, link);
+		if (!comp_io_start(io)) {
+			if (tmp != NULL) {
+				TAILQ_INSERT_BEFORE(tmp, io, link);
+			} else {
+				TAILQ_INSERT_TAIL(&comp->queued_ios, io, link);
+			}
+		}
+	}
+	comp->resuming = false;
+}
+
+static void
+_comp_io_submit(void *ctx)
+{
+	struct comp_bdev_io *io = ctx;
+	struct vbdev_compress *comp = io->comp;
+
+	/* Keep the order of I/Os to the same chunk */
+	if (!TAILQ_EMPTY(&comp->queued_ios) || !comp_io_start(io)) {
+		TAILQ_INSERT_TAIL(&comp->queued_ios, io, link);
+	}
+}
+
+/* All chunk I/O is executed on the metadata thread */
+static void
+comp_io_submit(struct comp_bdev_io *io)
+{
+	if (io->comp->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(io->comp->thread, _comp_io_submit, io);
+	} else {
+		_comp_io_submit(io);
+	}
+}
+
+static void
+comp_base_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete_base_io_status(orig_io, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+comp_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	comp_io_submit((struct comp_bdev_io *)bdev_io->driver_ctx);
+}
+
+static void
+vbdev_compress_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_compress *comp = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_compress,
+				      comp_bdev);
+	struct comp_io_channel *comp_ch = spdk_io_channel_get_ctx(ch);
+	struct comp_bdev_io *io = (struct comp_bdev_io *)bdev_io->driver_ctx;
+	int rc = 0;
+
+	memset(io, 0, sizeof(*io));
+	io->comp = comp;
+	io->orig_thread = spdk_get_thread();
+	io->log_waiter.arg = io;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, comp_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		comp_io_submit(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		io->unmap_chunk = spdk_divide_round_up(bdev_io->u.bdev.offset_blocks, comp->chunk_blocks);
+		comp_io_submit(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		/* Chunks may be stored anywhere in the data region, flush the whole base bdev */
+		rc = spdk_bdev_flush_blocks(comp->base_desc, comp_ch->base_ch, 0,
+					    spdk_bdev_get_num_blocks(comp->base_bdev),
+					    comp_base_io_done, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(comp->base_desc, comp_ch->base_ch, comp_base_io_done, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("compress: unknown I/O type %d\n", bdev_io->type);
+		rc = -EINVAL;
+		break;
+	}
+
+	if (rc != 0) {
+		if (rc == -ENOMEM) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+		} else {
+			SPDK_ERRLOG("Failed to submit bdev_io!\n");
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+	}
+}
+
+/* Write zeroes are not reported as supported so that the bdev layer emulates them with
+ * regular writes of zeroed buffers, which compress to almost nothing.
+ */
+static bool
+vbdev_compress_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_compress *comp = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		return true;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(comp->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_compress_get_io_channel(void *ctx)
+{
+	struct vbdev_compress *comp = ctx;
+
+	return spdk_get_io_channel(comp);
+}
+
+static const char *
+comp_algo_str(uint8_t algo)
+{
+	switch (algo) {
+	case SPDK_ACCEL_COMP_ALGO_DEFLATE:
+		return "deflate";
+	case SPDK_ACCEL_COMP_ALGO_LZ4:
+		return "lz4";
+	default:
+		return "unknown";
+	}
+}
+
+static int
+vbdev_compress_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_compress *comp = ctx;
+	struct vbdev_compress_sb *sb = comp->sb;
+
+	spdk_json_write_name(w, "compress");
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&comp->comp_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(comp->base_bdev));
+	spdk_json_write_named_uint32(w, "chunk_size", sb->chunk_size);
+	spdk_json_write_named_uint32(w, "io_unit_size", sb->io_unit_size);
+	spdk_json_write_named_string(w, "comp_algo", comp_algo_str(sb->comp_algo));
+	spdk_json_write_named_uint32(w, "comp_level", sb->comp_level);
+	spdk_json_write_named_uint64(w, "allocated_chunks", comp->allocated_chunks);
+	spdk_json_write_named_uint64(w, "stored_bytes", comp->stored_bytes);
+	spdk_json_write_named_uint64(w, "used_bytes", comp->used_units * sb->io_unit_size);
+	spdk_json_write_named_uint64(w, "capacity_bytes", sb->data_units * sb->io_unit_size);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+comp_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct vbdev_compress *comp = io_device;
+	struct comp_io_channel *comp_ch = ctx_buf;
+
+	comp_ch->base_ch = spdk_bdev_get_io_channel(comp->base_desc);
+	if (comp_ch->base_ch == NULL) {
+		SPDK_ERRLOG("Failed to get base bdev IO channel (bdev: %s)\n", comp->comp_bdev.name);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+comp_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct comp_io_channel *comp_ch = ctx_buf;
+
+	spdk_put_io_channel(comp_ch->base_ch);
+}
+
+static void
+comp_free(struct vbdev_compress *comp)
+{
+	uint32_t i;
+
+	if (comp->base_ch != NULL) {
+		spdk_put_io_channel(comp->base_ch);
+	}
+	if (comp->accel_ch != NULL) {
+		spdk_put_io_channel(comp->accel_ch);
+	}
+	if (comp->base_claimed) {
+		spdk_bdev_module_release_bdev(comp->base_bdev);
+	}
+	if (comp->base_desc != NULL) {
+		spdk_bdev_close(comp->base_desc);
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(comp->log); i++) {
+		spdk_free(comp->log[i].buf);
+		free(comp->log[i].old_entries);
+	}
+	spdk_bit_array_free(&comp->map_dirty);
+	spdk_bit_array_free(&comp->allocated);
+	spdk_bit_array_free(&comp->chunk_busy);
+	spdk_bit_array_free(&comp->quarantine);
+	spdk_bit_array_free(&comp->quarantine_flushing);
+	spdk_free(comp->map);
+	spdk_free(comp->req_bufs);
+	spdk_free(comp->init_buf);
+	spdk_free(comp->sb);
+	free(comp->reqs);
+	free(comp->comp_bdev.name);
+	free(comp);
+}
+
+static void
+comp_device_unregister_cb(void *io_device)
+{
+	struct vbdev_compress *comp = io_device;
+
+	spdk_bdev_destruct_done(&comp->comp_bdev, 0);
+	comp_free(comp);
+}
+
+static void
+comp_destruct_wipe_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to clear superblock of compress bdev %s\n", comp->sb->name);
+	}
+
+	spdk_io_device_unregister(comp, comp_device_unregister_cb);
+}
+
+static void
+_vbdev_compress_destruct(void *ctx)
+{
+	struct vbdev_compress *comp = ctx;
+	int rc;
+
+	assert(TAILQ_EMPTY(&comp->queued_ios));
+	assert(!comp->log_writing && !comp->ckpt_active);
+
+	if (comp->quarantine_flush_active) {
+		comp->destruct_pending = true;
+		return;
+	}
+
+	if (comp->delete_pending) {
+		memset(comp->sb, 0, comp->blocklen);
+		rc = spdk_bdev_write_blocks(comp->base_desc, comp->base_ch, comp->sb, 0, 1,
+					    comp_destruct_wipe_done, comp);
+		if (rc == 0) {
+			return;
+		}
+		SPDK_ERRLOG("Failed to clear superblock of compress bdev %s: %s\n",
+			    comp->comp_bdev.name, spdk_strerror(-rc));
+	}
+
+	spdk_io_device_unregister(comp, comp_device_unregister_cb);
+}
+
+static int
+vbdev_compress_destruct(void *ctx)
+{
+	struct vbdev_compress *comp = ctx;
+
+	TAILQ_REMOVE(&g_vbdev_compress, comp, link);
+
+	/* The metadata channels belong to the metadata thread */
+	if (comp->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(comp->thread, _vbdev_compress_destruct, comp);
+	} else {
+		_vbdev_compress_destruct(comp);
+	}
+
+	return 1;
+}
+
+static const struct spdk_bdev_fn_table vbdev_compress_fn_table = {
+	.destruct		= vbdev_compress_destruct,
+	.submit_request		= vbdev_compress_submit_request,
+	.io_type_supported	= vbdev_compress_io_type_supported,
+	.get_io_channel		= vbdev_compress_get_io_channel,
+	.dump_info_json		= vbdev_compress_dump_info_json,
+};
+
+static void
+comp_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *event_ctx)
+{
+	struct vbdev_compress *comp, *tmp;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		TAILQ_FOREACH_SAFE(comp, &g_vbdev_compress, link, tmp) {
+			if (comp->base_bdev == bdev) {
+				spdk_bdev_unregister(&comp->comp_bdev, NULL, NULL);
+			}
+		}
+		break;
+	default:
+		/* The volume layout is fixed at creation, a resize of the base bdev is ignored */
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static int
+comp_open(const char *base_bdev_name, struct vbdev_compress **_comp)
+{
+	struct vbdev_compress *comp;
+	int rc;
+
+	comp = calloc(1, sizeof(*comp));
+	if (comp == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_bdev_open_ext(base_bdev_name, true, comp_base_bdev_event_cb, NULL, &comp->base_desc);
+	if (rc != 0) {
+		free(comp);
+		return rc;
+	}
+
+	comp->base_bdev = spdk_bdev_desc_get_bdev(comp->base_desc);
+	comp->blocklen = spdk_bdev_get_block_size(comp->base_bdev);
+	comp->thread = spdk_get_thread();
+
+	comp->base_ch = spdk_bdev_get_io_channel(comp->base_desc);
+	comp->accel_ch = spdk_accel_get_io_channel();
+	if (comp->base_ch == NULL || comp->accel_ch == NULL) {
+		comp_free(comp);
+		return -ENOMEM;
+	}
+
+	comp->sb = spdk_zmalloc(comp->blocklen, COMP_BUF_ALIGN, NULL, SPDK_ENV_NUMA_ID_ANY,
+				SPDK_MALLOC_DMA);
+	if (comp->sb == NULL) {
+		comp_free(comp);
+		return -ENOMEM;
+	}
+
+	*_comp = comp;
+
+	return 0;
+}
+
+/* Allocate the runtime structures described by the superblock */
+static int
+comp_init_runtime(struct vbdev_compress *comp)
+{
+	struct vbdev_compress_sb *sb = comp->sb;
+	struct comp_req *req;
+	uint8_t *buf;
+	uint32_t i;
+
+	comp->chunk_blocks = sb->chunk_size / comp->blocklen;
+	comp->unit_blocks = sb->io_unit_size / comp->blocklen;
+	comp->chunk_units = sb->chunk_size / sb->io_unit_size;
+	comp->log_entries_per_block = (comp->blocklen - sizeof(struct vbdev_compress_log_hdr)) /
+				      sizeof(struct vbdev_compress_log_entry);
+
+	comp->map = spdk_zmalloc(sb->map_blocks * comp->blocklen, COMP_BUF_ALIGN, NULL,
+				 SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	comp->map_dirty = spdk_bit_array_create(sb->map_blocks);
+	comp->allocated = spdk_bit_array_create(sb->data_units);
+	comp->chunk_busy = spdk_bit_array_create(sb->num_chunks);
+	comp->quarantine = spdk_bit_array_create(sb->data_units);
+	comp->quarantine_flushing = spdk_bit_array_create(sb->data_units);
+	if (comp->map == NULL || comp->map_dirty == NULL || comp->allocated == NULL ||
+	    comp->chunk_busy == NULL || comp->quarantine == NULL ||
+	    comp->quarantine_flushing == NULL) {
+		return -ENOMEM;
+	}
+	TAILQ_INIT(&comp->unit_waiters);
+
+	for (i = 0; i < SPDK_COUNTOF(comp->log); i++) {
+		comp->log[i].buf = spdk_zmalloc(comp->blocklen, COMP_BUF_ALIGN, NULL,
+						SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+		comp->log[i].old_entries = calloc(comp->log_entries_per_block, sizeof(uint64_t));
+		if (comp->log[i].buf == NULL || comp->log[i].old_entries == NULL) {
+			return -ENOMEM;
+		}
+		TAILQ_INIT(&comp->log[i].waiters);
+	}
+	comp->log_open = &comp->log[0];
+	TAILQ_INIT(&comp->log_space_waiters);
+
+	comp->reqs = calloc(COMP_NUM_REQS, sizeof(*comp->reqs));
+	comp->req_bufs = spdk_zmalloc((size_t)COMP_NUM_REQS * 2 * sb->chunk_size, COMP_BUF_ALIGN,
+				      NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (comp->reqs == NULL || comp->req_bufs == NULL) {
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&comp->free_reqs);
+	TAILQ_INIT(&comp->queued_ios);
+	buf = comp->req_bufs;
+	for (i = 0; i < COMP_NUM_REQS; i++) {
+		req = &comp->reqs[i];
+		req->comp = comp;
+		req->log_waiter.arg = req;
+		req->chunk_buf = buf;
+		req->chunk_iov.iov_base = buf;
+		req->chunk_iov.iov_len = sb->chunk_size;
+		buf += sb->chunk_size;
+		req->comp_buf = buf;
+		buf += sb->chunk_size;
+		TAILQ_INSERT_TAIL(&comp->free_reqs, req, link);
+	}
+
+	return 0;
+}
+
+static int
+comp_register(struct vbdev_compress *comp)
+{
+	struct spdk_bdev *base_bdev = comp->base_bdev;
+	struct spdk_accel_operation_exec_ctx opctx = {};
+	int rc;
+
+	comp->comp_bdev.name = strdup(comp->sb->name);
+	if (comp->comp_bdev.name == NULL) {
+		return -ENOMEM;
+	}
+
+	comp->comp_bdev.product_name = "compress";
+	comp->comp_bdev.write_cache = base_bdev->write_cache;
+	comp->comp_bdev.blocklen = comp->blocklen;
+	comp->comp_bdev.blockcnt = comp->sb->num_chunks * comp->chunk_blocks;
+	/* Each I/O has to stay within a single chunk */
+	comp->comp_bdev.optimal_io_boundary = comp->chunk_blocks;
+	comp->comp_bdev.split_on_optimal_io_boundary = true;
+
+	opctx.size = SPDK_SIZEOF(&opctx, block_size);
+	opctx.block_size = comp->blocklen;
+	comp->comp_bdev.required_alignment =
+		spdk_max(base_bdev->required_alignment,
+			 spdk_max(spdk_accel_get_buf_align(SPDK_ACCEL_OPC_COMPRESS, &opctx),
+				  spdk_accel_get_buf_align(SPDK_ACCEL_OPC_DECOMPRESS, &opctx)));
+
+	comp->comp_bdev.uuid = comp->sb->uuid;
+	comp->comp_bdev.numa = base_bdev->numa;
+	comp->comp_bdev.ctxt = comp;
+	comp->comp_bdev.fn_table = &vbdev_compress_fn_table;
+	comp->comp_bdev.module = &compress_if;
+
+	spdk_io_device_register(comp, comp_bdev_ch_create_cb, comp_bdev_ch_destroy_cb,
+				sizeof(struct comp_io_channel), comp->comp_bdev.name);
+
+	rc = spdk_bdev_register(&comp->comp_bdev);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to register compress bdev %s: %s\n", comp->comp_bdev.name,
+			    spdk_strerror(-rc));
+		spdk_io_device_unregister(comp, NULL);
+		return rc;
+	}
+
+	TAILQ_INSERT_TAIL(&g_vbdev_compress, comp, link);
+	SPDK_DEBUGLOG(vbdev_compress, "Registered compress bdev %s on %s\n", comp->comp_bdev.name,
+		      spdk_bdev_get_name(base_bdev));
+
+	return 0;
+}
+
+static void
+comp_init_done(struct vbdev_compress *comp, int status)
+{
+	void (*cb_fn)(void *cb_arg, int status) = comp->init_cb;
+	void *cb_arg = comp->init_cb_arg;
+
+	spdk_free(comp->init_buf);
+	comp->init_buf = NULL;
+
+	if (status == 0) {
+		status = comp_register(comp);
+	}
+	if (status != 0) {
+		comp_free(comp);
+	}
+
+	cb_fn(cb_arg, status);
+}
+
+static void
+comp_create_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	comp_init_done(comp, success ? 0 : -EIO);
+}
+
+static void
+comp_create_map_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		comp_init_done(comp, -EIO);
+		return;
+	}
+
+	/* The superblock goes last, the volume doesn't exist until it's written */
+	comp->sb->crc = comp_sb_crc(comp->sb);
+	rc = spdk_bdev_write_blocks(comp->base_desc, comp->base_ch, comp->sb, 0, 1,
+				    comp_create_sb_done, comp);
+	if (rc != 0) {
+		comp_init_done(comp, rc);
+	}
+}
+
+static int
+comp_init_sb(struct vbdev_compress *comp, const struct vbdev_compress_opts *opts)
+{
+	struct vbdev_compress_sb *sb = comp->sb;
+	uint64_t base_blocks = spdk_bdev_get_num_blocks(comp->base_bdev);
+	uint64_t logical_size, unit_blocks;
+	uint32_t min_level, max_level;
+
+	sb->chunk_size = opts->chunk_size ? opts->chunk_size : VBDEV_COMPRESS_DEFAULT_CHUNK_SIZE;
+	sb->io_unit_size = opts->io_unit_size ? opts->io_unit_size :
+			   VBDEV_COMPRESS_DEFAULT_IO_UNIT_SIZE;
+	if (sb->io_unit_size % comp->blocklen != 0 || sb->chunk_size % sb->io_unit_size != 0 ||
+	    sb->chunk_size > VBDEV_COMPRESS_MAX_CHUNK_SIZE) {
+		SPDK_ERRLOG("Chunk size %u must be a multiple of io unit size %u, which must be a "
+			    "multiple of block size %u, max chunk size is %u\n", sb->chunk_size,
+			    sb->io_unit_size, comp->blocklen, VBDEV_COMPRESS_MAX_CHUNK_SIZE);
+		return -EINVAL;
+	}
+
+	if (spdk_accel_get_compress_level_range(opts->comp_algo, &min_level, &max_level) != 0 ||
+	    opts->comp_level < min_level || opts->comp_level > max_level) {
+		SPDK_ERRLOG("Compression algorithm %s with level %u is not supported\n",
+			    comp_algo_str(opts->comp_algo), opts->comp_level);
+		return -EINVAL;
+	}
+
+	memcpy(sb->signature, COMP_SB_SIGNATURE, sizeof(sb->signature));
+	sb->version = COMP_SB_VERSION;
+	sb->length = sizeof(*sb);
+	sb->block_size = comp->blocklen;
+	sb->comp_algo = opts->comp_algo;
+	sb->comp_level = opts->comp_level;
+	spdk_uuid_generate(&sb->uuid);
+	snprintf(sb->name, sizeof(sb->name), "%s", opts->name);
+	sb->generation = 1;
+
+	logical_size = opts->size_in_mib ? opts->size_in_mib * 1024 * 1024 :
+		       base_blocks * comp->blocklen;
+	sb->num_chunks = logical_size / sb->chunk_size;
+
+	unit_blocks = sb->io_unit_size / comp->blocklen;
+	sb->map_offset = unit_blocks;
+	sb->map_blocks = SPDK_ALIGN_CEIL(spdk_divide_round_up(sb->num_chunks * sizeof(uint64_t),
+					 comp->blocklen), unit_blocks);
+	sb->log_offset = sb->map_offset + sb->map_blocks;
+	sb->log_blocks = SPDK_ALIGN_CEIL(spdk_divide_round_up(COMP_LOG_SIZE, comp->blocklen),
+					 unit_blocks);
+	sb->data_offset = sb->log_offset + sb->log_blocks;
+	if (sb->num_chunks == 0 || sb->data_offset >= base_blocks) {
+		SPDK_ERRLOG("Base bdev %s is too small\n", spdk_bdev_get_name(comp->base_bdev));
+		return -ENOSPC;
+	}
+	sb->data_units = (base_blocks - sb->data_offset) / unit_blocks;
+
+	/* The allocation bitmaps are indexed with 32-bit values */
+	if (sb->num_chunks > UINT32_MAX || sb->data_units > UINT32_MAX) {
+		SPDK_ERRLOG("Volume too large, use larger chunk and io unit sizes\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int
+create_compress_disk(const struct vbdev_compress_opts *opts, vbdev_compress_create_cb cb_fn,
+		     void *cb_arg)
+{
+	struct vbdev_compress *comp;
+	int rc;
+
+	if (strnlen(opts->name, sizeof(comp->sb->name)) == sizeof(comp->sb->name)) {
+		SPDK_ERRLOG("Compress bdev name %s is too long\n", opts->name);
+		return -EINVAL;
+	}
+
+	if (spdk_bdev_get_by_name(opts->name) != NULL) {
+		SPDK_ERRLOG("Bdev %s already exists\n", opts->name);
+		return -EEXIST;
+	}
+
+	rc = comp_open(opts->base_bdev_name, &comp);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev %s: %s\n", opts->base_bdev_name, spdk_strerror(-rc));
+		return rc;
+	}
+
+	rc = comp_init_sb(comp, opts);
+	if (rc != 0) {
+		goto err;
+	}
+
+	rc = spdk_bdev_module_claim_bdev(comp->base_bdev, comp->base_desc, &compress_if);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to claim bdev %s\n", opts->base_bdev_name);
+		goto err;
+	}
+	comp->base_claimed = true;
+
+	rc = comp_init_runtime(comp);
+	if (rc != 0) {
+		goto err;
+	}
+
+	comp->init_cb = cb_fn;
+	comp->init_cb_arg = cb_arg;
+
+	/* Start with an empty chunk map, the log needs no initialization as its blocks are
+	 * only valid if they match the volume UUID and the current generation.
+	 */
+	rc = spdk_bdev_write_blocks(comp->base_desc, comp->base_ch, comp->map, comp->sb->map_offset,
+				    comp->sb->map_blocks, comp_create_map_done, comp);
+	if (rc != 0) {
+		goto err;
+	}
+
+	return 0;
+err:
+	comp_free(comp);
+	return rc;
+}
+
+static bool
+comp_sb_valid(struct vbdev_compress *comp)
+{
+	struct vbdev_compress_sb *sb = comp->sb;
+	uint64_t base_blocks = spdk_bdev_get_num_blocks(comp->base_bdev);
+
+	if (memcmp(sb->signature, COMP_SB_SIGNATURE, sizeof(sb->signature)) != 0) {
+		return false;
+	}
+
+	if (sb->version != COMP_SB_VERSION || sb->length != sizeof(*sb) ||
+	    sb->crc != comp_sb_crc(sb)) {
+		SPDK_WARNLOG("Invalid compress superblock on bdev %s\n",
+			     spdk_bdev_get_name(comp->base_bdev));
+		return false;
+	}
+
+	if (sb->block_size != comp->blocklen || sb->io_unit_size % comp->blocklen != 0 ||
+	    sb->io_unit_size == 0 || sb->chunk_size == 0 || sb->chunk_size % sb->io_unit_size != 0 ||
+	    sb->chunk_size > VBDEV_COMPRESS_MAX_CHUNK_SIZE ||
+	    sb->num_chunks > UINT32_MAX || sb->data_units > UINT32_MAX ||
+	    sb->name[sizeof(sb->name) - 1] != '\0' ||
+	    sb->map_blocks * comp->blocklen < sb->num_chunks * sizeof(uint64_t) ||
+	    sb->log_blocks == 0 || sb->log_offset < sb->map_offset + sb->map_blocks ||
+	    sb->data_offset < sb->log_offset + sb->log_blocks ||
+	    sb->data_offset + sb->data_units * (sb->io_unit_size / comp->blocklen) > base_blocks) {
+		SPDK_ERRLOG("Unsupported compress volume parameters on bdev %s\n",
+			    spdk_bdev_get_name(comp->base_bdev));
+		return false;
+	}
+
+	return true;
+}
+
+/* Apply the log blocks of the current generation to the chunk map */
+static int
+comp_load_replay(struct vbdev_compress *comp)
+{
+	struct vbdev_compress_sb *sb = comp->sb;
+	struct vbdev_compress_log_hdr *hdr;
+	struct vbdev_compress_log_entry *entries;
+	uint32_t seq, i;
+
+	for (seq = 0; seq < sb->log_blocks; seq++) {
+		hdr = (void *)((uint8_t *)comp->init_buf + (uint64_t)seq * comp->blocklen);
+		if (hdr->magic != COMP_LOG_MAGIC || spdk_uuid_compare(&hdr->uuid, &sb->uuid) != 0 ||
+		    hdr->generation != sb->generation || hdr->seq != seq ||
+		    hdr->num_entries > comp->log_entries_per_block ||
+		    hdr->crc != comp_log_crc(comp, hdr)) {
+			break;
+		}
+
+		entries = comp_log_entries(hdr);
+		for (i = 0; i < hdr->num_entries; i++) {
+			if (entries[i].chunk >= sb->num_chunks) {
+				SPDK_ERRLOG("Invalid chunk %" PRIu64 " in metadata log\n", entries[i].chunk);
+				return -EILSEQ;
+			}
+			comp->map[entries[i].chunk] = entries[i].map_entry;
+			spdk_bit_array_set(comp->map_dirty,
+					   entries[i].chunk * sizeof(uint64_t) / comp->blocklen);
+		}
+	}
+
+	SPDK_DEBUGLOG(vbdev_compress, "%s: replayed %u log blocks of generation %" PRIu64 "\n",
+		      sb->name, seq, sb->generation);
+
+	return 0;
+}
+
+static int
+comp_load_build_allocator(struct vbdev_compress *comp)
+{
+	uint64_t chunk, entry, unit;
+	uint32_t len, num_units, i;
+
+	for (chunk = 0; chunk < comp->sb->num_chunks; chunk++) {
+		entry = comp->map[chunk];
+		len = comp_map_entry_len(entry);
+		if (len == 0) {
+			continue;
+		}
+
+		unit = comp_map_entry_unit(entry);
+		num_units = comp_len_to_units(comp, len);
+		if (len > comp->sb->chunk_size || unit + num_units > comp->sb->data_units) {
+			SPDK_ERRLOG("Invalid map entry 0x%" PRIx64 " of chunk %" PRIu64 "\n", entry, chunk);
+			return -EILSEQ;
+		}
+
+		for (i = 0; i < num_units; i++) {
+			if (spdk_bit_array_get(comp->allocated, unit + i)) {
+				SPDK_ERRLOG("Data unit %" PRIu64 " referenced by multiple chunks\n", unit + i);
+				return -EILSEQ;
+			}
+			spdk_bit_array_set(comp->allocated, unit + i);
+		}
+
+		comp->used_units += num_units;
+		comp->stored_bytes += len;
+		comp->allocated_chunks++;
+	}
+
+	return 0;
+}
+
+static void
+comp_load_checkpoint_done(struct vbdev_compress *comp, int status)
+{
+	comp_init_done(comp, status);
+}
+
+static void
+comp_load_log_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		comp_init_done(comp, -EIO);
+		return;
+	}
+
+	rc = comp_load_replay(comp);
+	if (rc == 0) {
+		rc = comp_load_build_allocator(comp);
+	}
+	if (rc != 0) {
+		comp_init_done(comp, rc);
+		return;
+	}
+
+	/* Always start a new log generation, so that stale blocks following the last valid
+	 * one can never be replayed.
+	 */
+	comp_checkpoint(comp, comp_load_checkpoint_done);
+}
+
+static void
+comp_load_map_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		comp_init_done(comp, -EIO);
+		return;
+	}
+
+	comp->init_buf = spdk_zmalloc(comp->sb->log_blocks * comp->blocklen, COMP_BUF_ALIGN, NULL,
+				      SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (comp->init_buf == NULL) {
+		comp_init_done(comp, -ENOMEM);
+		return;
+	}
+
+	rc = spdk_bdev_read_blocks(comp->base_desc, comp->base_ch, comp->init_buf,
+				   comp->sb->log_offset, comp->sb->log_blocks, comp_load_log_done, comp);
+	if (rc != 0) {
+		comp_init_done(comp, rc);
+	}
+}
+
+static void
+comp_examine_done(void *cb_arg, int status)
+{
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to load compress volume: %s\n", spdk_strerror(-status));
+	}
+
+	spdk_bdev_module_examine_done(&compress_if);
+}
+
+static void
+comp_load_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_compress *comp = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success || !comp_sb_valid(comp)) {
+		comp_free(comp);
+		spdk_bdev_module_examine_done(&compress_if);
+		return;
+	}
+
+	SPDK_NOTICELOG("Found compress volume %s on bdev %s\n", comp->sb->name,
+		       spdk_bdev_get_name(comp->base_bdev));
+
+	rc = spdk_bdev_module_claim_bdev(comp->base_bdev, comp->base_desc, &compress_if);
+	if (rc != 0) {
+		comp_init_done(comp, rc);
+		return;
+	}
+	comp->base_claimed = true;
+
+	rc = comp_init_runtime(comp);
+	if (rc != 0) {
+		comp_init_done(comp, rc);
+		return;
+	}
+
+	rc = spdk_bdev_read_blocks(comp->base_desc, comp->base_ch, comp->map, comp->sb->map_offset,
+				   comp->sb->map_blocks, comp_load_map_done, comp);
+	if (rc != 0) {
+		comp_init_done(comp, rc);
+	}
+}
+
+static void
+vbdev_compress_examine(struct spdk_bdev *bdev)
+{
+	struct vbdev_compress *comp;
+	int rc;
+
+	rc = comp_open(spdk_bdev_get_name(bdev), &comp);
+	if (rc != 0) {
+		spdk_bdev_module_examine_done(&compress_if);
+		return;
+	}
+
+	comp->init_cb = comp_examine_done;
+
+	rc = spdk_bdev_read_blocks(comp->base_desc, comp->base_ch, comp->sb, 0, 1,
+				   comp_load_sb_done, comp);
+	if (rc != 0) {
+		comp_free(comp);
+		spdk_bdev_module_examine_done(&compress_if);
+	}
+}
+
+void
+delete_compress_disk(const char *bdev_name, vbdev_compress_delete_cb cb_fn, void *cb_arg)
+{
+	struct spdk_bdev *bdev;
+	struct vbdev_compress *comp;
+	int rc;
+
+	bdev = spdk_bdev_get_by_name(bdev_name);
+	if (bdev == NULL || bdev->module != &compress_if) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	comp = SPDK_CONTAINEROF(bdev, struct vbdev_compress, comp_bdev);
+	comp->delete_pending = true;
+
+	rc = spdk_bdev_unregister_by_name(bdev_name, &compress_if, cb_fn, cb_arg);
+	if (rc != 0) {
+		comp->delete_pending = false;
+		cb_fn(cb_arg, rc);
+	}
+}
+
+static int
+vbdev_compress_init(void)
+{
+	return 0;
+}
+
+static int
+vbdev_compress_get_ctx_size(void)
+{
+	return sizeof(struct comp_bdev_io);
+}
+
+static struct spdk_bdev_module compress_if = {
+	.name = "compress",
+	.module_init = vbdev_compress_init,
+	.get_ctx_size = vbdev_compress_get_ctx_size,
+	.examine_disk = vbdev_compress_examine,
+};
+
+SPDK_BDEV_MODULE_REGISTER(compress, &compress_if)
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_compress)
@@ -0,0 +1,62 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_COMPRESS_H
+#define SPDK_VBDEV_COMPRESS_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/accel.h"
+#include "spdk/bdev.h"
+
+#define VBDEV_COMPRESS_DEFAULT_CHUNK_SIZE	(16 * 1024)
+#define VBDEV_COMPRESS_DEFAULT_IO_UNIT_SIZE	4096
+#define VBDEV_COMPRESS_MAX_CHUNK_SIZE		(1024 * 1024)
+
+/* Options used to create a new compress vbdev on top of a base bdev. */
+struct vbdev_compress_opts {
+	/* Name of the compress vbdev to create */
+	const char			*name;
+	/* Name of the base bdev */
+	const char			*base_bdev_name;
+	/* Logical size in MiB, 0 means the size of the base bdev */
+	uint64_t			size_in_mib;
+	/* Logical chunk size in bytes, the unit of compression */
+	uint32_t			chunk_size;
+	/* Backing allocation unit size in bytes */
+	uint32_t			io_unit_size;
+	/* Compression algorithm and level passed to the accel framework */
+	enum spdk_accel_comp_algo	comp_algo;
+	uint32_t			comp_level;
+};
+
+typedef void (*vbdev_compress_create_cb)(void *cb_arg, int bdeverrno);
+typedef void (*vbdev_compress_delete_cb)(void *cb_arg, int bdeverrno);
+
+/**
+ * Initialize a compress volume on the base bdev and create a compress vbdev on top of it.
+ *
+ * Any data previously stored on the base bdev is discarded.  The volume metadata is persisted
+ * on the base bdev, so the vbdev is recreated automatically when the base bdev is examined.
+ *
+ * \param opts Compress vbdev options.
+ * \param cb_fn Function to call after the volume is initialized and the vbdev registered.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if initialization was started, negative errno on failure. cb_fn is only called
+ * if 0 is returned.
+ */
+int create_compress_disk(const struct vbdev_compress_opts *opts, vbdev_compress_create_cb cb_fn,
+			 void *cb_arg);
+
+/**
+ * Delete a compress vbdev and destroy the volume metadata on its base bdev.
+ *
+ * \param bdev_name Compress bdev name.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void delete_compress_disk(const char *bdev_name, vbdev_compress_delete_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_COMPRESS_H */
@@ -0,0 +1,105 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_compress.h"
+
+#include "spdk/rpc.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+#include "spdk_internal/rpc_autogen.h"
+
+static void
+rpc_bdev_compress_create_cb(void *cb_arg, int bdeverrno)
+{
+	struct rpc_bdev_compress_create_ctx *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (bdeverrno == 0) {
+		w = spdk_jsonrpc_begin_result(req->request);
+		spdk_json_write_string(w, req->name);
+		spdk_jsonrpc_end_result(req->request, w);
+	} else {
+		spdk_jsonrpc_send_error_response(req->request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+
+	free_rpc_bdev_compress_create_heap(req);
+}
+
+static void
+rpc_bdev_compress_create(struct spdk_jsonrpc_request *request,
+			 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_compress_create_ctx *req;
+	struct vbdev_compress_opts opts = {};
+	int rc;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (spdk_json_decode_object(params, rpc_bdev_compress_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_compress_create_decoders),
+				    req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	req->request = request;
+	opts.name = req->name;
+	opts.base_bdev_name = req->base_bdev_name;
+	opts.size_in_mib = req->size_in_mib;
+	opts.chunk_size = req->chunk_size;
+	opts.io_unit_size = req->io_unit_size;
+	opts.comp_algo = (enum spdk_accel_comp_algo)req->comp_algo;
+	opts.comp_level = req->comp_level;
+
+	rc = create_compress_disk(&opts, rpc_bdev_compress_create_cb, req);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	return;
+
+cleanup:
+	free_rpc_bdev_compress_create_heap(req);
+}
+SPDK_RPC_REGISTER("bdev_compress_create", rpc_bdev_compress_create, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_compress_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_compress_delete(struct spdk_jsonrpc_request *request,
+			 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_compress_delete_ctx req = {};
+
+	if (spdk_json_decode_object(params, rpc_bdev_compress_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_compress_delete_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	delete_compress_disk(req.name, rpc_bdev_compress_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_compress_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_compress_delete", rpc_bdev_compress_delete, SPDK_RPC_RUNTIME)
@@ -0,0 +1,2448 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_dedup.h"
+
+#include "spdk/accel.h"
+#include "spdk/bdev_module.h"
+#include "spdk/bit_array.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/log.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+#include "spdk/uuid.h"
+
+#define DEDUP_SB_SIGNATURE	"SPDKDDUP"
+#define DEDUP_SB_VERSION	1
+#define DEDUP_LOG_MAGIC		0x474f4c5055444544ULL /* "DEDUPLOG" */
+
+/* Size of the metadata log region */
+#define DEDUP_LOG_SIZE		(4 * 1024 * 1024)
+/* Number of requests that can be processed concurrently per vbdev */
+#define DEDUP_NUM_REQS		128
+/* Maximum size of a single read or write, in dedup blocks, and its number of iovecs */
+#define DEDUP_MAX_IO_BLOCKS	32
+#define DEDUP_MAX_IOVS		32
+/* A request is split into runs of contiguous physical blocks, each one can add an iovec */
+#define DEDUP_REQ_IOVS		(DEDUP_MAX_IOVS + DEDUP_MAX_IO_BLOCKS)
+/* Number of fingerprint batches in flight and the number of writes in a batch */
+#define DEDUP_HASH_BATCHES	2
+#define DEDUP_HASH_BATCH_REQS	16
+/* Number of metadata blocks written concurrently during a checkpoint */
+#define DEDUP_CKPT_QD		32
+/* Number of released physical blocks collected before a base bdev flush makes them reusable */
+#define DEDUP_QUARANTINE_BLOCKS	256
+#define DEDUP_BUF_ALIGN		0x1000
+#define DEDUP_FP_SIZE		SPDK_ACCEL_SHA256_DIGEST_SIZE
+
+SPDK_STATIC_ASSERT(DEDUP_MAX_IO_BLOCKS <= 64, "new block mask too small");
+
+/*
+ * On-disk layout of the base bdev:
+ *
+ * | superblock | block map | fingerprints | metadata log | data blocks ... |
+ *
+ * The block map holds one 64-bit entry per logical block, 0 if the block is not mapped and reads
+ * as zeroes, otherwise the index of the physical data block plus one.  Any number of logical
+ * blocks with the same contents can map to the same physical block.  The fingerprint table holds
+ * the SHA-256 digest of each physical block.  Both are only written back during a checkpoint,
+ * every change in between is recorded in the metadata log.  Physical blocks are never
+ * overwritten while they're referenced, nor before the base bdev is flushed after their release,
+ * so a crash can only lose writes that were not completed, or not flushed on a base bdev with a
+ * volatile write cache.
+ *
+ * The fingerprint index and the reference counts are not persisted, they are rebuilt from the
+ * block map and the fingerprint table when the volume is loaded.
+ */
+#define DEDUP_LOG_FP		(1ULL << 63)
+
+struct vbdev_dedup_sb {
+	uint8_t			signature[8];
+	uint32_t		version;
+	uint32_t		length;
+	uint32_t		crc;
+	uint32_t		block_size;
+	uint32_t		dedup_block_size;
+	uint32_t		reserved0;
+	struct spdk_uuid	uuid;
+	char			name[64];
+	uint64_t		num_blocks;
+	/* Offsets and sizes of the regions, in base bdev blocks.  The fingerprint table directly
+	 * follows the block map. */
+	uint64_t		md_offset;
+	uint64_t		map_blocks;
+	uint64_t		fp_blocks;
+	uint64_t		log_offset;
+	uint64_t		log_blocks;
+	uint64_t		data_offset;
+	/* Number of physical data blocks, in dedup blocks */
+	uint64_t		data_blocks;
+	uint64_t		generation;
+	uint8_t			reserved[328];
+} __attribute__((packed));
+SPDK_STATIC_ASSERT(sizeof(struct vbdev_dedup_sb) == 512, "incorrect size");
+
+struct vbdev_dedup_log_hdr {
+	uint64_t		magic;
+	struct spdk_uuid	uuid;
+	uint64_t		generation;
+	uint32_t		seq;
+	uint32_t		num_entries;
+	uint32_t		crc;
+	uint32_t		reserved;
+};
+SPDK_STATIC_ASSERT(sizeof(struct vbdev_dedup_log_hdr) == 48, "incorrect size");
+
+/* A block map update, with the fingerprint of the physical block if it's a newly stored one,
+ * which is indicated by DEDUP_LOG_FP set in map_entry.
+ */
+struct vbdev_dedup_log_entry {
+	uint64_t		lba;
+	uint64_t		map_entry;
+	uint8_t			fp[DEDUP_FP_SIZE];
+};
+SPDK_STATIC_ASSERT(sizeof(struct vbdev_dedup_log_entry) == 48, "incorrect size");
+
+struct dedup_log_waiter {
+	void			(*fn)(void *arg, int status);
+	void			*arg;
+	TAILQ_ENTRY(dedup_log_waiter) link;
+};
+
+/* One of the two log blocks: the open one collects block map updates, the other is in flight */
+struct dedup_log_block {
+	void			*buf;
+	/* Previous block map entries, their references are dropped once this block is persisted */
+	uint64_t		*old_entries;
+	uint32_t		num_entries;
+	TAILQ_HEAD(, dedup_log_waiter) waiters;
+};
+
+struct dedup_bdev_io;
+
+/* Context of a read or write */
+struct dedup_req {
+	struct vbdev_dedup	*dedup;
+	struct dedup_bdev_io	*io;
+	uint64_t		offset;
+	uint32_t		num_blocks;
+	uint32_t		outstanding;
+	int			status;
+	/* Next block to record in the metadata log */
+	uint32_t		log_next;
+	/* Blocks of a write stored in newly allocated physical blocks */
+	uint64_t		new_blocks;
+	uint64_t		pbas[DEDUP_MAX_IO_BLOCKS];
+	uint8_t			fps[DEDUP_MAX_IO_BLOCKS][DEDUP_FP_SIZE];
+	struct iovec		iovs[DEDUP_REQ_IOVS];
+	uint32_t		iovs_used;
+	struct dedup_log_waiter	log_waiter;
+	TAILQ_ENTRY(dedup_req)	link;
+};
+
+/* Fingerprints of the writes collected while the previous batches were being calculated */
+struct dedup_hash_batch {
+	struct vbdev_dedup	*dedup;
+	bool			busy;
+	uint8_t			*fps;
+	struct iovec		iovs[DEDUP_HASH_BATCH_REQS * DEDUP_MAX_IOVS];
+	TAILQ_HEAD(, dedup_req)	reqs;
+};
+
+struct vbdev_dedup {
+	struct spdk_bdev		dedup_bdev;
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	bool				base_claimed;
+	/* Metadata thread and its channels, all I/O is done on this thread */
+	struct spdk_thread		*thread;
+	struct spdk_io_channel		*base_ch;
+	struct spdk_io_channel		*accel_ch;
+
+	struct vbdev_dedup_sb		*sb;
+	/* Block size of the base bdev and the number of its blocks in a dedup block */
+	uint32_t			base_blocklen;
+	uint32_t			unit_blocks;
+
+	/* Block map followed by the fingerprint table, and the blocks modified since the last
+	 * checkpoint */
+	void				*md;
+	uint64_t			*map;
+	uint8_t				*fps;
+	struct spdk_bit_array		*md_dirty;
+
+	/* Fingerprint index, an open addressing hash table with linear probing.  Each slot holds
+	 * a physical block plus one, 0 marks an empty slot. */
+	uint32_t			*index;
+	uint64_t			index_mask;
+	/* Number of logical blocks (and in-flight requests) referencing each physical block */
+	uint32_t			*refcnt;
+	struct spdk_bit_array		*allocated;
+	uint32_t			alloc_hint;
+	/* Logical blocks with a request in progress */
+	struct spdk_bit_array		*block_busy;
+
+	/*
+	 * Physical blocks that lost their last reference.  Until the base bdev is flushed, the
+	 * log entries that dropped the references may be lost in a crash, leaving the on-disk
+	 * block map pointing to them, so they can't be reused yet.  They're out of the index and
+	 * become free once a flush issued after they were released completes.
+	 */
+	struct spdk_bit_array		*quarantine;
+	uint32_t			quarantine_blocks;
+	/* Quarantined blocks covered by the flush in progress */
+	struct spdk_bit_array		*quarantine_flushing;
+	bool				quarantine_flush_active;
+	/* Writes waiting for the flush in progress to free some physical blocks */
+	TAILQ_HEAD(, dedup_log_waiter)	block_waiters;
+
+	struct dedup_req		*reqs;
+	TAILQ_HEAD(, dedup_req)		free_reqs;
+	/* I/Os waiting for a free request or a busy block */
+	TAILQ_HEAD(, dedup_bdev_io)	queued_ios;
+	bool				resuming;
+
+	/* Writes waiting for a fingerprint batch */
+	struct dedup_hash_batch		batches[DEDUP_HASH_BATCHES];
+	TAILQ_HEAD(, dedup_req)		hash_queue;
+
+	/* Metadata log */
+	struct dedup_log_block		log[2];
+	struct dedup_log_block		*log_open;
+	uint32_t			log_entries_per_block;
+	uint32_t			log_seq;
+	bool				log_writing;
+	/* Writes and unmaps waiting for a free slot in the open log block */
+	TAILQ_HEAD(, dedup_log_waiter)	log_space_waiters;
+
+	/* Checkpoint state */
+	bool				ckpt_active;
+	uint32_t			ckpt_next;
+	uint32_t			ckpt_outstanding;
+	int				ckpt_status;
+	void				(*ckpt_cb)(struct vbdev_dedup *dedup, int status);
+
+	/* Statistics */
+	uint64_t			mapped_blocks;
+	uint64_t			used_blocks;
+	uint64_t			dedup_hits;
+
+	/* Completion of bdev_dedup_create or of examine */
+	void				(*init_cb)(void *cb_arg, int status);
+	void				*init_cb_arg;
+	void				*init_buf;
+
+	/* bdev_dedup_delete was called, wipe the superblock on destruct */
+	bool				delete_pending;
+	/* Destruct waits for the flush of quarantined blocks in progress */
+	bool				destruct_pending;
+	TAILQ_ENTRY(vbdev_dedup)	link;
+};
+
+static TAILQ_HEAD(, vbdev_dedup) g_vbdev_dedup = TAILQ_HEAD_INITIALIZER(g_vbdev_dedup);
+
+struct dedup_io_channel {
+	struct spdk_io_channel		*base_ch;
+};
+
+/* Per I/O context that the bdev layer allocates for us */
+struct dedup_bdev_io {
+	struct vbdev_dedup		*dedup;
+	struct spdk_thread		*orig_thread;
+	enum spdk_bdev_io_status	status;
+	/* Next block to unmap */
+	uint64_t			unmap_block;
+	struct dedup_log_waiter		log_waiter;
+	TAILQ_ENTRY(dedup_bdev_io)	link;
+};
+
+static struct spdk_bdev_module dedup_if;
+
+static void dedup_log_flush(struct vbdev_dedup *dedup);
+static void dedup_resume_queued(struct vbdev_dedup *dedup);
+static bool dedup_unmap(struct dedup_bdev_io *io);
+static void _vbdev_dedup_destruct(void *ctx);
+
+static inline uint64_t
+dedup_pba_to_block(struct vbdev_dedup *dedup, uint64_t pba)
+{
+	return dedup->sb->data_offset + pba * dedup->unit_blocks;
+}
+
+static inline uint8_t *
+dedup_fp(struct vbdev_dedup *dedup, uint64_t pba)
+{
+	return dedup->fps + pba * DEDUP_FP_SIZE;
+}
+
+static inline void
+dedup_map_set_dirty(struct vbdev_dedup *dedup, uint64_t lba)
+{
+	spdk_bit_array_set(dedup->md_dirty, lba * sizeof(uint64_t) / dedup->base_blocklen);
+}
+
+static inline void
+dedup_fp_set_dirty(struct vbdev_dedup *dedup, uint64_t pba)
+{
+	spdk_bit_array_set(dedup->md_dirty, dedup->sb->map_blocks +
+			   pba * DEDUP_FP_SIZE / dedup->base_blocklen);
+}
+
+static uint32_t
+dedup_sb_crc(struct vbdev_dedup_sb *sb)
+{
+	uint32_t crc, prev = sb->crc;
+
+	sb->crc = 0;
+	crc = spdk_crc32c_update(sb, sb->length, 0);
+	sb->crc = prev;
+
+	return crc;
+}
+
+static uint32_t
+dedup_log_crc(struct vbdev_dedup *dedup, struct vbdev_dedup_log_hdr *hdr)
+{
+	uint32_t crc, prev = hdr->crc;
+
+	hdr->crc = 0;
+	crc = spdk_crc32c_update(hdr, dedup->base_blocklen, 0);
+	hdr->crc = prev;
+
+	return crc;
+}
+
+static inline struct vbdev_dedup_log_entry *
+dedup_log_entries(void *buf)
+{
+	return (struct vbdev_dedup_log_entry *)((uint8_t *)buf +
+			sizeof(struct vbdev_dedup_log_hdr));
+}
+
+/* SHA-256 digests are uniformly distributed, so any part of them makes a good hash */
+static inline uint64_t
+dedup_index_slot(struct vbdev_dedup *dedup, const uint8_t *fp)
+{
+	uint64_t hash;
+
+	memcpy(&hash, fp, sizeof(hash));
+
+	return hash & dedup->index_mask;
+}
+
+static bool
+dedup_index_lookup(struct vbdev_dedup *dedup, const uint8_t *fp, uint64_t *pba)
+{
+	uint64_t slot;
+
+	for (slot = dedup_index_slot(dedup, fp); dedup->index[slot] != 0;
+	     slot = (slot + 1) & dedup->index_mask) {
+		if (memcmp(dedup_fp(dedup, dedup->index[slot] - 1), fp, DEDUP_FP_SIZE) == 0) {
+			*pba = dedup->index[slot] - 1;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* The index has at least twice as many slots as there are physical blocks, so it never fills */
+static void
+dedup_index_insert(struct vbdev_dedup *dedup, uint64_t pba)
+{
+	uint64_t slot;
+
+	for (slot = dedup_index_slot(dedup, dedup_fp(dedup, pba)); dedup->index[slot] != 0;
+	     slot = (slot + 1) & dedup->index_mask) {
+	}
+
+	dedup->index[slot] = pba + 1;
+}
+
+/* Remove a physical block from the index, if present, and move back the following entries of
+ * its probe sequence, so that lookups don't need tombstones.
+ */
+static void
+dedup_index_remove(struct vbdev_dedup *dedup, uint64_t pba)
+{
+	uint64_t slot, next, home;
+
+	for (slot = dedup_index_slot(dedup, dedup_fp(dedup, pba)); dedup->index[slot] != pba + 1;
+	     slot = (slot + 1) & dedup->index_mask) {
+		if (dedup->index[slot] == 0) {
+			return;
+		}
+	}
+
+	next = slot;
+	while (true) {
+		next = (next + 1) & dedup->index_mask;
+		if (dedup->index[next] == 0) {
+			break;
+		}
+
+		/* The entry can't move before its home slot */
+		home = dedup_index_slot(dedup, dedup_fp(dedup, dedup->index[next] - 1));
+		if (((next - home) & dedup->index_mask) >= ((next - slot) & dedup->index_mask)) {
+			dedup->index[slot] = dedup->index[next];
+			slot = next;
+		}
+	}
+
+	dedup->index[slot] = 0;
+}
+
+static int
+dedup_alloc_block(struct vbdev_dedup *dedup, uint64_t *pba)
+{
+	uint32_t block;
+
+	block = spdk_bit_array_find_first_clear(dedup->allocated, dedup->alloc_hint);
+	if (block == UINT32_MAX) {
+		block = spdk_bit_array_find_first_clear(dedup->allocated, 0);
+		if (block == UINT32_MAX) {
+			return -ENOSPC;
+		}
+	}
+
+	assert(dedup->refcnt[block] == 0);
+	spdk_bit_array_set(dedup->allocated, block);
+	dedup->refcnt[block] = 1;
+	dedup->used_blocks++;
+	dedup->alloc_hint = block + 1;
+	*pba = block;
+
+	return 0;
+}
+
+static inline void
+dedup_get_block(struct vbdev_dedup *dedup, uint64_t pba)
+{
+	assert(dedup->refcnt[pba] > 0);
+	dedup->refcnt[pba]++;
+}
+
+static void dedup_quarantine_flush_done(struct spdk_bdev_io *bdev_io, bool success,
+					void *cb_arg);
+
+/* Flush the base bdev to free the quarantined blocks, unless there's too few of them to bother.
+ * All of the base bdev is flushed so that the blocks written in their place are persisted too.
+ */
+static int
+dedup_quarantine_flush(struct vbdev_dedup *dedup, bool force)
+{
+	struct spdk_bit_array *tmp;
+	int rc;
+
+	if (dedup->quarantine_flush_active || dedup->quarantine_blocks == 0 ||
+	    (!force && dedup->quarantine_blocks < DEDUP_QUARANTINE_BLOCKS)) {
+		return 0;
+	}
+
+	rc = spdk_bdev_flush_blocks(dedup->base_desc, dedup->base_ch, 0,
+				    spdk_bdev_get_num_blocks(dedup->base_bdev),
+				    dedup_quarantine_flush_done, dedup);
+	if (rc != 0) {
+		/* dedup_log_write_done() tries again */
+		return rc;
+	}
+
+	tmp = dedup->quarantine_flushing;
+	dedup->quarantine_flushing = dedup->quarantine;
+	dedup->quarantine = tmp;
+	dedup->quarantine_blocks = 0;
+	dedup->quarantine_flush_active = true;
+
+	return 0;
+}
+
+static void
+dedup_quarantine_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	struct spdk_bit_array *flushed = dedup->quarantine_flushing;
+	struct dedup_log_waiter *waiter, *tmp;
+	TAILQ_HEAD(, dedup_log_waiter) waiters;
+	uint32_t pba = 0;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to flush base bdev of dedup bdev %s\n", dedup->sb->name);
+	}
+
+	/* Blocks of a failed flush wait for the next one */
+	while ((pba = spdk_bit_array_find_first_set(flushed, pba)) != UINT32_MAX) {
+		spdk_bit_array_clear(flushed, pba);
+		if (success) {
+			spdk_bit_array_clear(dedup->allocated, pba);
+		} else {
+			spdk_bit_array_set(dedup->quarantine, pba);
+			dedup->quarantine_blocks++;
+		}
+	}
+	dedup->quarantine_flush_active = false;
+
+	if (dedup->destruct_pending) {
+		assert(TAILQ_EMPTY(&dedup->block_waiters));
+		_vbdev_dedup_destruct(dedup);
+		return;
+	}
+
+	TAILQ_INIT(&waiters);
+	TAILQ_SWAP(&waiters, &dedup->block_waiters, dedup_log_waiter, link);
+	TAILQ_FOREACH_SAFE(waiter, &waiters, link, tmp) {
+		TAILQ_REMOVE(&waiters, waiter, link);
+		waiter->fn(waiter->arg, success ? 0 : -EIO);
+	}
+
+	if (success) {
+		dedup_quarantine_flush(dedup, false);
+	}
+}
+
+/* Park a write that found no free physical block until the quarantine flush completes.
+ * Returns -ENOSPC if no block is quarantined.
+ */
+static int
+dedup_quarantine_wait(struct vbdev_dedup *dedup, struct dedup_log_waiter *waiter)
+{
+	int rc;
+
+	if (!dedup->quarantine_flush_active) {
+		if (dedup->quarantine_blocks == 0) {
+			return -ENOSPC;
+		}
+
+		rc = dedup_quarantine_flush(dedup, true);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&dedup->block_waiters, waiter, link);
+
+	return 0;
+}
+
+/* Drop a reference to a physical block. With the last one, the block is removed from the index
+ * and quarantined until the base bdev is flushed.
+ */
+static void
+dedup_put_block(struct vbdev_dedup *dedup, uint64_t pba)
+{
+	assert(dedup->refcnt[pba] > 0);
+	if (--dedup->refcnt[pba] > 0) {
+		return;
+	}
+
+	dedup_index_remove(dedup, pba);
+	dedup->used_blocks--;
+
+	/* The log write dropping the reference is already persistent without a volatile cache */
+	if (!spdk_bdev_io_type_supported(dedup->base_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		spdk_bit_array_clear(dedup->allocated, pba);
+		return;
+	}
+
+	spdk_bit_array_set(dedup->quarantine, pba);
+	dedup->quarantine_blocks++;
+}
+
+static void
+dedup_update_stats(struct vbdev_dedup *dedup, uint64_t old_entry, uint64_t new_entry)
+{
+	if (old_entry == 0 && new_entry != 0) {
+		dedup->mapped_blocks++;
+	} else if (old_entry != 0 && new_entry == 0) {
+		dedup->mapped_blocks--;
+	}
+}
+
+/* Update the block map and record the change in the open log block. The caller has to make
+ * sure the open block has a free slot. The physical block referenced by the previous entry is
+ * released once the log block is persisted.
+ */
+static void
+dedup_log_append(struct vbdev_dedup *dedup, uint64_t lba, uint64_t entry, const uint8_t *fp)
+{
+	struct dedup_log_block *block = dedup->log_open;
+	struct vbdev_dedup_log_entry *log_entry;
+	uint64_t old_entry = dedup->map[lba];
+
+	assert(block->num_entries < dedup->log_entries_per_block);
+
+	log_entry = &dedup_log_entries(block->buf)[block->num_entries];
+	log_entry->lba = lba;
+	log_entry->map_entry = entry;
+	if (fp != NULL) {
+		log_entry->map_entry |= DEDUP_LOG_FP;
+		memcpy(log_entry->fp, fp, DEDUP_FP_SIZE);
+	} else {
+		memset(log_entry->fp, 0, DEDUP_FP_SIZE);
+	}
+	block->old_entries[block->num_entries++] = old_entry;
+
+	dedup->map[lba] = entry;
+	dedup_map_set_dirty(dedup, lba);
+	dedup_update_stats(dedup, old_entry, entry);
+}
+
+/* Undo an entry of a log block that failed to be written, dropping the reference held by the
+ * new entry instead of the previous one.
+ */
+static void
+dedup_log_rollback(struct vbdev_dedup *dedup, struct dedup_log_block *block, uint32_t idx)
+{
+	struct vbdev_dedup_log_entry *log_entry = &dedup_log_entries(block->buf)[idx];
+	struct dedup_log_block *open = dedup->log_open;
+	uint64_t entry = log_entry->map_entry & ~DEDUP_LOG_FP;
+	uint64_t old_entry = block->old_entries[idx];
+	uint64_t lba = log_entry->lba;
+	uint32_t i;
+
+	if (dedup->map[lba] == entry) {
+		dedup->map[lba] = old_entry;
+		dedup_map_set_dirty(dedup, lba);
+	} else {
+		/* The block was remapped again in the open log block, which now replaces the
+		 * previous entry, so the reference to it is dropped once that block is persisted */
+		assert(open != block);
+		for (i = 0; i < open->num_entries; i++) {
+			if (dedup_log_entries(open->buf)[i].lba == lba &&
+			    open->old_entries[i] == entry) {
+				open->old_entries[i] = old_entry;
+				break;
+			}
+		}
+		assert(i < open->num_entries);
+	}
+
+	dedup_update_stats(dedup, entry, old_entry);
+	if (entry != 0) {
+		dedup_put_block(dedup, entry - 1);
+	}
+}
+
+static inline bool
+dedup_log_has_space(struct vbdev_dedup *dedup)
+{
+	return dedup->log_open->num_entries < dedup->log_entries_per_block;
+}
+
+/* Notify waiter once the block map updates appended so far are on disk. */
+static void
+dedup_log_wait(struct vbdev_dedup *dedup, struct dedup_log_waiter *waiter)
+{
+	TAILQ_INSERT_TAIL(&dedup->log_open->waiters, waiter, link);
+	dedup_log_flush(dedup);
+}
+
+/* Drop the references of the block map entries replaced by a persisted log block, or roll its
+ * entries back if it couldn't be written, and notify its waiters.
+ */
+static void
+dedup_log_block_done(struct vbdev_dedup *dedup, struct dedup_log_block *block, bool success)
+{
+	struct dedup_log_waiter *waiter, *tmp;
+	TAILQ_HEAD(, dedup_log_waiter) waiters;
+	uint32_t i;
+
+	if (success) {
+		for (i = 0; i < block->num_entries; i++) {
+			if (block->old_entries[i] != 0) {
+				dedup_put_block(dedup, block->old_entries[i] - 1);
+			}
+		}
+	} else {
+		/* Later entries for the same logical block are undone first */
+		for (i = block->num_entries; i > 0; i--) {
+			dedup_log_rollback(dedup, block, i - 1);
+		}
+	}
+	block->num_entries = 0;
+
+	TAILQ_INIT(&waiters);
+	TAILQ_SWAP(&waiters, &block->waiters, dedup_log_waiter, link);
+
+	while ((waiter = TAILQ_FIRST(&dedup->log_space_waiters)) && dedup_log_has_space(dedup)) {
+		TAILQ_REMOVE(&dedup->log_space_waiters, waiter, link);
+		waiter->fn(waiter->arg, 0);
+	}
+
+	TAILQ_FOREACH_SAFE(waiter, &waiters, link, tmp) {
+		TAILQ_REMOVE(&waiters, waiter, link);
+		waiter->fn(waiter->arg, success ? 0 : -EIO);
+	}
+}
+
+static void
+dedup_log_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	struct dedup_log_block *block = dedup->log_open == &dedup->log[0] ? &dedup->log[1] :
+					&dedup->log[0];
+
+	if (bdev_io != NULL) {
+		spdk_bdev_free_io(bdev_io);
+	}
+
+	if (success) {
+		dedup->log_seq++;
+	} else {
+		SPDK_ERRLOG("Failed to write metadata log of dedup bdev %s\n", dedup->sb->name);
+	}
+
+	/* Writes resumed by the waiters append their mappings first, so they share the next block */
+	dedup_log_block_done(dedup, block, success);
+	dedup->log_writing = false;
+	dedup_log_flush(dedup);
+	dedup_quarantine_flush(dedup, false);
+}
+
+static void dedup_checkpoint(struct vbdev_dedup *dedup,
+			     void (*cb_fn)(struct vbdev_dedup *dedup, int status));
+
+static void
+dedup_log_checkpoint_done(struct vbdev_dedup *dedup, int status)
+{
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to checkpoint dedup bdev %s: %s\n", dedup->sb->name,
+			    spdk_strerror(-status));
+		dedup->log_writing = true;
+		dedup_log_block_done(dedup, dedup->log_open, false);
+		dedup->log_writing = false;
+	}
+
+	dedup_log_flush(dedup);
+}
+
+/* Submit the open log block, unless the other one is still being written or a checkpoint runs. */
+static void
+dedup_log_flush(struct vbdev_dedup *dedup)
+{
+	struct dedup_log_block *block = dedup->log_open;
+	struct vbdev_dedup_log_hdr *hdr;
+	int rc;
+
+	if (dedup->log_writing || dedup->ckpt_active || block->num_entries == 0) {
+		return;
+	}
+
+	if (dedup->log_seq == dedup->sb->log_blocks) {
+		dedup_checkpoint(dedup, dedup_log_checkpoint_done);
+		return;
+	}
+
+	hdr = block->buf;
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = DEDUP_LOG_MAGIC;
+	hdr->uuid = dedup->sb->uuid;
+	hdr->generation = dedup->sb->generation;
+	hdr->seq = dedup->log_seq;
+	hdr->num_entries = block->num_entries;
+	memset(&dedup_log_entries(block->buf)[block->num_entries], 0,
+	       (dedup->log_entries_per_block - block->num_entries) *
+	       sizeof(struct vbdev_dedup_log_entry));
+	hdr->crc = dedup_log_crc(dedup, hdr);
+
+	/* Mappings of the writes completing meanwhile accumulate in the other block */
+	dedup->log_open = block == &dedup->log[0] ? &dedup->log[1] : &dedup->log[0];
+	dedup->log_writing = true;
+
+	rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->base_ch, block->buf,
+				    dedup->sb->log_offset + dedup->log_seq, 1,
+				    dedup_log_write_done, dedup);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to submit metadata log write: %s\n", spdk_strerror(-rc));
+		dedup_log_write_done(NULL, false, dedup);
+	}
+}
+
+static void
+dedup_checkpoint_complete(struct vbdev_dedup *dedup, int status)
+{
+	dedup->ckpt_active = false;
+	dedup->ckpt_cb(dedup, status);
+}
+
+static void
+dedup_checkpoint_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to write superblock of dedup bdev %s\n", dedup->sb->name);
+		dedup_checkpoint_complete(dedup, -EIO);
+		return;
+	}
+
+	dedup->log_seq = 0;
+	dedup_checkpoint_complete(dedup, 0);
+}
+
+static void
+dedup_checkpoint_write_sb(struct vbdev_dedup *dedup)
+{
+	int rc;
+
+	dedup->sb->generation++;
+	dedup->sb->crc = dedup_sb_crc(dedup->sb);
+
+	rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->base_ch, dedup->sb, 0, 1,
+				    dedup_checkpoint_sb_done, dedup);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to submit superblock write: %s\n", spdk_strerror(-rc));
+		dedup->sb->generation--;
+		dedup_checkpoint_complete(dedup, rc);
+	}
+}
+
+static void
+dedup_checkpoint_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		dedup_checkpoint_complete(dedup, -EIO);
+		return;
+	}
+
+	dedup_checkpoint_write_sb(dedup);
+}
+
+/* The metadata has to be persisted before the new log generation starts */
+static void
+dedup_checkpoint_md_done(struct vbdev_dedup *dedup)
+{
+	int rc;
+
+	if (dedup->ckpt_status != 0) {
+		dedup_checkpoint_complete(dedup, dedup->ckpt_status);
+		return;
+	}
+
+	if (!spdk_bdev_io_type_supported(dedup->base_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		dedup_checkpoint_write_sb(dedup);
+		return;
+	}
+
+	rc = spdk_bdev_flush_blocks(dedup->base_desc, dedup->base_ch, dedup->sb->md_offset,
+				    dedup->sb->map_blocks + dedup->sb->fp_blocks,
+				    dedup_checkpoint_flush_done, dedup);
+	if (rc != 0) {
+		dedup_checkpoint_complete(dedup, rc);
+	}
+}
+
+static void dedup_checkpoint_write_md(struct vbdev_dedup *dedup);
+
+static void
+dedup_checkpoint_md_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	assert(dedup->ckpt_outstanding > 0);
+	dedup->ckpt_outstanding--;
+	if (!success) {
+		dedup->ckpt_status = -EIO;
+	}
+
+	dedup_checkpoint_write_md(dedup);
+}
+
+static void
+dedup_checkpoint_write_md(struct vbdev_dedup *dedup)
+{
+	uint32_t block;
+	int rc;
+
+	while (dedup->ckpt_status == 0 && dedup->ckpt_outstanding < DEDUP_CKPT_QD) {
+		block = spdk_bit_array_find_first_set(dedup->md_dirty, dedup->ckpt_next);
+		if (block == UINT32_MAX) {
+			break;
+		}
+
+		rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->base_ch,
+					    (uint8_t *)dedup->md + (uint64_t)block * dedup->base_blocklen,
+					    dedup->sb->md_offset + block, 1,
+					    dedup_checkpoint_md_write_done, dedup);
+		if (rc != 0) {
+			if (rc == -ENOMEM && dedup->ckpt_outstanding > 0) {
+				/* One of the metadata writes in flight will resubmit it */
+				break;
+			}
+			dedup->ckpt_status = rc;
+			break;
+		}
+
+		spdk_bit_array_clear(dedup->md_dirty, block);
+		dedup->ckpt_next = block + 1;
+		dedup->ckpt_outstanding++;
+	}
+
+	if (dedup->ckpt_outstanding == 0) {
+		dedup_checkpoint_md_done(dedup);
+	}
+}
+
+/* Write back the dirty block map and fingerprint table blocks and start a new log generation. */
+static void
+dedup_checkpoint(struct vbdev_dedup *dedup, void (*cb_fn)(struct vbdev_dedup *dedup, int status))
+{
+	assert(!dedup->ckpt_active);
+	assert(!dedup->log_writing);
+
+	SPDK_DEBUGLOG(vbdev_dedup, "%s: checkpoint of generation %" PRIu64 "\n",
+		      dedup->sb->name, dedup->sb->generation);
+
+	dedup->ckpt_active = true;
+	dedup->ckpt_next = 0;
+	dedup->ckpt_outstanding = 0;
+	dedup->ckpt_status = 0;
+	dedup->ckpt_cb = cb_fn;
+
+	dedup_checkpoint_write_md(dedup);
+}
+
+static void
+_dedup_io_complete(void *ctx)
+{
+	struct dedup_bdev_io *io = ctx;
+
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), io->status);
+}
+
+static void
+dedup_io_complete(struct dedup_bdev_io *io, int status)
+{
+	if (spdk_likely(status == 0)) {
+		io->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	} else if (status == -ENOMEM) {
+		io->status = SPDK_BDEV_IO_STATUS_NOMEM;
+	} else {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	if (io->orig_thread != spdk_get_thread()) {
+		spdk_thread_send_msg(io->orig_thread, _dedup_io_complete, io);
+	} else {
+		_dedup_io_complete(io);
+	}
+}
+
+static void
+dedup_req_complete(struct dedup_req *req, int status)
+{
+	struct vbdev_dedup *dedup = req->dedup;
+	struct dedup_bdev_io *io = req->io;
+	uint32_t i;
+
+	for (i = 0; i < req->num_blocks; i++) {
+		spdk_bit_array_clear(dedup->block_busy, req->offset + i);
+	}
+	TAILQ_INSERT_HEAD(&dedup->free_reqs, req, link);
+
+	dedup_io_complete(io, status);
+	dedup_resume_queued(dedup);
+}
+
+/* Drop the references a write took on the physical blocks that are not recorded in the log */
+static void
+dedup_req_release(struct dedup_req *req, uint32_t first, uint32_t last)
+{
+	uint32_t i;
+
+	for (i = first; i < last; i++) {
+		dedup_put_block(req->dedup, req->pbas[i]);
+	}
+}
+
+/* Fill iovs with the part of the I/O buffers at the given offset */
+static uint32_t
+dedup_req_slice_iovs(struct dedup_req *req, struct iovec **iovs, uint64_t offset, uint64_t len)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	struct iovec *src, *dst = &req->iovs[req->iovs_used];
+	uint32_t i, iovcnt = 0;
+	uint64_t n;
+
+	for (i = 0; i < (uint32_t)bdev_io->u.bdev.iovcnt && len > 0; i++) {
+		src = &bdev_io->u.bdev.iovs[i];
+		if (offset >= src->iov_len) {
+			offset -= src->iov_len;
+			continue;
+		}
+
+		assert(req->iovs_used + iovcnt < DEDUP_REQ_IOVS);
+		n = spdk_min(len, src->iov_len - offset);
+		dst[iovcnt].iov_base = (uint8_t *)src->iov_base + offset;
+		dst[iovcnt].iov_len = n;
+		iovcnt++;
+		len -= n;
+		offset = 0;
+	}
+
+	req->iovs_used += iovcnt;
+	*iovs = dst;
+
+	return iovcnt;
+}
+
+static void
+dedup_req_logged(void *arg, int status)
+{
+	struct dedup_req *req = arg;
+
+	dedup_req_complete(req, status);
+}
+
+/* Record the new block mappings in the metadata log, continuing once there's space in the log
+ * if they don't fit in the open log block.
+ */
+static void
+dedup_req_log(void *arg, int status)
+{
+	struct dedup_req *req = arg;
+	struct vbdev_dedup *dedup = req->dedup;
+	uint64_t pba;
+	bool appended = false;
+	uint32_t i;
+
+	if (status != 0) {
+		dedup_req_release(req, req->log_next, req->num_blocks);
+		dedup_req_complete(req, status);
+		return;
+	}
+
+	for (; req->log_next < req->num_blocks; req->log_next++) {
+		if (!dedup_log_has_space(dedup)) {
+			break;
+		}
+
+		i = req->log_next;
+		pba = req->pbas[i];
+		if (req->new_blocks & (1ULL << i)) {
+			/* The block is written, so other writes can share it from now on */
+			memcpy(dedup_fp(dedup, pba), req->fps[i], DEDUP_FP_SIZE);
+			dedup_fp_set_dirty(dedup, pba);
+			dedup_index_insert(dedup, pba);
+			dedup_log_append(dedup, req->offset + i, pba + 1, req->fps[i]);
+		} else {
+			dedup_log_append(dedup, req->offset + i, pba + 1, NULL);
+		}
+		appended = true;
+	}
+
+	if (req->log_next == req->num_blocks) {
+		req->log_waiter.fn = dedup_req_logged;
+		dedup_log_wait(dedup, &req->log_waiter);
+	} else if (appended) {
+		req->log_waiter.fn = dedup_req_log;
+		dedup_log_wait(dedup, &req->log_waiter);
+	} else {
+		req->log_waiter.fn = dedup_req_log;
+		TAILQ_INSERT_TAIL(&dedup->log_space_waiters, &req->log_waiter, link);
+	}
+}
+
+static void
+dedup_write_data_put(struct dedup_req *req)
+{
+	assert(req->outstanding > 0);
+	if (--req->outstanding > 0) {
+		return;
+	}
+
+	if (req->status != 0) {
+		dedup_req_release(req, 0, req->num_blocks);
+		dedup_req_complete(req, req->status);
+		return;
+	}
+
+	req->log_next = 0;
+	dedup_req_log(req, 0);
+}
+
+static void
+dedup_write_data_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		req->status = -EIO;
+	}
+
+	dedup_write_data_put(req);
+}
+
+/* Store the blocks that were not found in the index, with a single write for each run of
+ * consecutive physical blocks.
+ */
+static void
+dedup_write_data(struct dedup_req *req)
+{
+	struct vbdev_dedup *dedup = req->dedup;
+	uint32_t blocklen = dedup->dedup_bdev.blocklen;
+	struct iovec *iovs;
+	uint32_t i, j, iovcnt;
+	int rc;
+
+	req->outstanding = 1;
+	req->iovs_used = 0;
+
+	for (i = 0; i < req->num_blocks; i = j) {
+		j = i + 1;
+		if (!(req->new_blocks & (1ULL << i))) {
+			continue;
+		}
+
+		while (j < req->num_blocks && (req->new_blocks & (1ULL << j)) &&
+		       req->pbas[j] == req->pbas[j - 1] + 1) {
+			j++;
+		}
+
+		iovcnt = dedup_req_slice_iovs(req, &iovs, (uint64_t)i * blocklen,
+					      (uint64_t)(j - i) * blocklen);
+		rc = spdk_bdev_writev_blocks(dedup->base_desc, dedup->base_ch, iovs, iovcnt,
+					     dedup_pba_to_block(dedup, req->pbas[i]),
+					     (j - i) * dedup->unit_blocks, dedup_write_data_done, req);
+		if (rc != 0) {
+			req->status = rc;
+			break;
+		}
+		req->outstanding++;
+	}
+
+	dedup_write_data_put(req);
+}
+
+static void dedup_write_map(struct dedup_req *req);
+
+static void
+dedup_write_map_retry(void *arg, int status)
+{
+	struct dedup_req *req = arg;
+
+	if (status != 0) {
+		dedup_req_complete(req, status);
+		return;
+	}
+
+	dedup_write_map(req);
+}
+
+/* Map each block of a write to a physical block with the same fingerprint, or allocate a new
+ * one if there's none.
+ */
+static void
+dedup_write_map(struct dedup_req *req)
+{
+	struct vbdev_dedup *dedup = req->dedup;
+	uint64_t pba;
+	uint32_t i, j;
+	int rc;
+
+	req->new_blocks = 0;
+	for (i = 0; i < req->num_blocks; i++) {
+		if (dedup_index_lookup(dedup, req->fps[i], &pba)) {
+			dedup_get_block(dedup, pba);
+			req->pbas[i] = pba;
+			dedup->dedup_hits++;
+			continue;
+		}
+
+		/* Blocks stored by this write aren't in the index yet */
+		for (j = 0; j < i; j++) {
+			if ((req->new_blocks & (1ULL << j)) &&
+			    memcmp(req->fps[j], req->fps[i], DEDUP_FP_SIZE) == 0) {
+				break;
+			}
+		}
+		if (j < i) {
+			dedup_get_block(dedup, req->pbas[j]);
+			req->pbas[i] = req->pbas[j];
+			dedup->dedup_hits++;
+			continue;
+		}
+
+		rc = dedup_alloc_block(dedup, &pba);
+		if (rc != 0) {
+			dedup_req_release(req, 0, i);
+
+			/* Start over once the quarantined blocks are freed */
+			req->log_waiter.fn = dedup_write_map_retry;
+			if (dedup_quarantine_wait(dedup, &req->log_waiter) == 0) {
+				return;
+			}
+
+			SPDK_ERRLOG("%s: no space left to store block %" PRIu64 "\n", dedup->sb->name,
+				    req->offset + i);
+			dedup_req_complete(req, rc);
+			return;
+		}
+		req->pbas[i] = pba;
+		req->new_blocks |= 1ULL << i;
+	}
+
+	dedup_write_data(req);
+}
+
+static void dedup_hash_submit(struct vbdev_dedup *dedup);
+
+static void
+dedup_hash_done(void *cb_arg, int status)
+{
+	struct dedup_hash_batch *batch = cb_arg;
+	struct vbdev_dedup *dedup = batch->dedup;
+	struct dedup_req *req, *tmp;
+	uint8_t *fp = batch->fps;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to calculate fingerprints: %s\n", spdk_strerror(-status));
+	}
+
+	/* The batch is only released afterwards, as a new batch could overwrite the fingerprints */
+	TAILQ_FOREACH_SAFE(req, &batch->reqs, link, tmp) {
+		TAILQ_REMOVE(&batch->reqs, req, link);
+		if (status != 0) {
+			dedup_req_complete(req, status);
+			continue;
+		}
+
+		memcpy(req->fps, fp, (size_t)req->num_blocks * DEDUP_FP_SIZE);
+		fp += (size_t)req->num_blocks * DEDUP_FP_SIZE;
+		dedup_write_map(req);
+	}
+	batch->busy = false;
+
+	dedup_hash_submit(dedup);
+}
+
+/* Calculate the fingerprints of all queued writes with a single accel operation per batch.
+ * Writes submitted while the batches are busy are collected and fingerprinted together.
+ */
+static void
+dedup_hash_submit(struct vbdev_dedup *dedup)
+{
+	struct dedup_hash_batch *batch;
+	struct spdk_bdev_io *bdev_io;
+	struct dedup_req *req;
+	uint32_t i, num_reqs, iovcnt;
+	int rc;
+
+	while (!TAILQ_EMPTY(&dedup->hash_queue)) {
+		batch = NULL;
+		for (i = 0; i < DEDUP_HASH_BATCHES; i++) {
+			if (!dedup->batches[i].busy) {
+				batch = &dedup->batches[i];
+				break;
+			}
+		}
+		if (batch == NULL) {
+			return;
+		}
+
+		num_reqs = 0;
+		iovcnt = 0;
+		while ((req = TAILQ_FIRST(&dedup->hash_queue)) && num_reqs < DEDUP_HASH_BATCH_REQS) {
+			bdev_io = spdk_bdev_io_from_ctx(req->io);
+			assert(bdev_io->u.bdev.iovcnt <= DEDUP_MAX_IOVS);
+
+			TAILQ_REMOVE(&dedup->hash_queue, req, link);
+			TAILQ_INSERT_TAIL(&batch->reqs, req, link);
+			memcpy(&batch->iovs[iovcnt], bdev_io->u.bdev.iovs,
+			       bdev_io->u.bdev.iovcnt * sizeof(struct iovec));
+			iovcnt += bdev_io->u.bdev.iovcnt;
+			num_reqs++;
+		}
+
+		batch->busy = true;
+		rc = spdk_accel_submit_sha256(dedup->accel_ch, batch->fps, batch->iovs, iovcnt,
+					      dedup->dedup_bdev.blocklen, dedup_hash_done, batch);
+		if (rc != 0) {
+			dedup_hash_done(batch, rc);
+		}
+	}
+}
+
+static void
+dedup_write(struct dedup_req *req)
+{
+	TAILQ_INSERT_TAIL(&req->dedup->hash_queue, req, link);
+	dedup_hash_submit(req->dedup);
+}
+
+static void
+dedup_read_put(struct dedup_req *req)
+{
+	assert(req->outstanding > 0);
+	if (--req->outstanding > 0) {
+		return;
+	}
+
+	dedup_req_complete(req, req->status);
+}
+
+static void
+dedup_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct dedup_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		req->status = -EIO;
+	}
+
+	dedup_read_put(req);
+}
+
+/* Look up the blocks in the block map and read each run of consecutive physical blocks with
+ * a single I/O.  Unmapped blocks read as zeroes.
+ */
+static void
+dedup_read(struct dedup_req *req)
+{
+	struct vbdev_dedup *dedup = req->dedup;
+	uint32_t blocklen = dedup->dedup_bdev.blocklen;
+	struct iovec *iovs;
+	uint64_t entry;
+	uint32_t i, j, iovcnt;
+	int rc;
+
+	req->outstanding = 1;
+	req->iovs_used = 0;
+
+	for (i = 0; i < req->num_blocks; i = j) {
+		entry = dedup->map[req->offset + i];
+		for (j = i + 1; j < req->num_blocks; j++) {
+			if (dedup->map[req->offset + j] != (entry == 0 ? 0 : entry + j - i)) {
+				break;
+			}
+		}
+
+		iovcnt = dedup_req_slice_iovs(req, &iovs, (uint64_t)i * blocklen,
+					      (uint64_t)(j - i) * blocklen);
+		if (entry == 0) {
+			spdk_iov_memset(iovs, iovcnt, 0);
+			continue;
+		}
+
+		rc = spdk_bdev_readv_blocks(dedup->base_desc, dedup->base_ch, iovs, iovcnt,
+					    dedup_pba_to_block(dedup, entry - 1),
+					    (j - i) * dedup->unit_blocks, dedup_read_done, req);
+		if (rc != 0) {
+			req->status = rc;
+			break;
+		}
+		req->outstanding++;
+	}
+
+	dedup_read_put(req);
+}
+
+static void
+dedup_unmap_continue(struct dedup_bdev_io *io)
+{
+	/* Resumed with the queued I/Os once the busy block is released */
+	if (!dedup_unmap(io)) {
+		TAILQ_INSERT_TAIL(&io->dedup->queued_ios, io, link);
+	}
+}
+
+static void
+dedup_unmap_logged(void *arg, int status)
+{
+	struct dedup_bdev_io *io = arg;
+
+	if (status != 0) {
+		dedup_io_complete(io, status);
+		return;
+	}
+
+	dedup_unmap_continue(io);
+}
+
+static void
+dedup_unmap_retry(void *arg, int status)
+{
+	dedup_unmap_continue(arg);
+}
+
+/* Unmap the logical blocks in the range, dropping their references to the physical blocks.
+ * Returns false if the unmap has to wait for a request in progress on one of the blocks.
+ */
+static bool
+dedup_unmap(struct dedup_bdev_io *io)
+{
+	struct vbdev_dedup *dedup = io->dedup;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	uint64_t end = bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks;
+	bool busy = false, appended = false;
+
+	for (; io->unmap_block < end; io->unmap_block++) {
+		/* Reads in progress still use the current mapping and writes replace it */
+		if (spdk_bit_array_get(dedup->block_busy, io->unmap_block)) {
+			busy = true;
+			break;
+		}
+
+		if (dedup->map[io->unmap_block] == 0) {
+			continue;
+		}
+
+		if (!dedup_log_has_space(dedup)) {
+			break;
+		}
+
+		dedup_log_append(dedup, io->unmap_block, 0, NULL);
+		appended = true;
+	}
+
+	if (appended) {
+		io->log_waiter.fn = dedup_unmap_logged;
+		dedup_log_wait(dedup, &io->log_waiter);
+	} else if (busy) {
+		return false;
+	} else if (io->unmap_block < end) {
+		io->log_waiter.fn = dedup_unmap_retry;
+		TAILQ_INSERT_TAIL(&dedup->log_space_waiters, &io->log_waiter, link);
+	} else {
+		dedup_io_complete(io, 0);
+	}
+
+	return true;
+}
+
+/* Start processing an I/O, returns false if it has to wait for a request or for another
+ * request to the same blocks.
+ */
+static bool
+dedup_io_start(struct dedup_bdev_io *io)
+{
+	struct vbdev_dedup *dedup = io->dedup;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	uint64_t offset = bdev_io->u.bdev.offset_blocks;
+	uint32_t i, num_blocks = bdev_io->u.bdev.num_blocks;
+	struct dedup_req *req;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_UNMAP) {
+		return dedup_unmap(io);
+	}
+
+	assert(num_blocks <= DEDUP_MAX_IO_BLOCKS);
+
+	req = TAILQ_FIRST(&dedup->free_reqs);
+	if (req == NULL) {
+		return false;
+	}
+
+	for (i = 0; i < num_blocks; i++) {
+		if (spdk_bit_array_get(dedup->block_busy, offset + i)) {
+			return false;
+		}
+	}
+
+	TAILQ_REMOVE(&dedup->free_reqs, req, link);
+	for (i = 0; i < num_blocks; i++) {
+		spdk_bit_array_set(dedup->block_busy, offset + i);
+	}
+	req->io = io;
+	req->offset = offset;
+	req->num_blocks = num_blocks;
+	req->status = 0;
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_READ) {
+		dedup_read(req);
+	} else {
+		dedup_write(req);
+	}
+
+	return true;
+}
+
+static void
+dedup_resume_queued(struct vbdev_dedup *dedup)
+{
+	struct dedup_bdev_io *io, *tmp;
+
+	/* E.g. a read of unmapped blocks completes inline and calls back here, the loop covers it */
+	if (dedup->resuming) {
+		return;
+	}
+
+	dedup->resuming = true;
+	TAILQ_FOREACH_SAFE(io, &dedup->queued_ios, link, tmp) {
+		if (TAILQ_EMPTY(&dedup->free_reqs)) {
+			break;
+		}
+
+		TAILQ_REMOVE(&dedup->queued_ios, io, link);
+		if (!dedup_io_start(io)) {
+			if (tmp != NULL) {
+				TAILQ_INSERT_BEFORE(tmp, io, link);
+			} else {
+				TAILQ_INSERT_TAIL(&dedup->queued_ios, io, link);
+			}
+		}
+	}
+	dedup->resuming = false;
+}
+
+static void
+_dedup_io_submit(void *ctx)
+{
+	struct dedup_bdev_io *io = ctx;
+	struct vbdev_dedup *dedup = io->dedup;
+
+	/* Keep the order of I/Os to the same blocks */
+	if (!TAILQ_EMPTY(&dedup->queued_ios) || !dedup_io_start(io)) {
+		TAILQ_INSERT_TAIL(&dedup->queued_ios, io, link);
+	}
+}
+
+/* All I/O is executed on the metadata thread, where the block map and the index live */
+static void
+dedup_io_submit(struct dedup_bdev_io *io)
+{
+	if (io->dedup->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(io->dedup->thread, _dedup_io_submit, io);
+	} else {
+		_dedup_io_submit(io);
+	}
+}
+
+static void
+dedup_base_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete_base_io_status(orig_io, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+dedup_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	dedup_io_submit((struct dedup_bdev_io *)bdev_io->driver_ctx);
+}
+
+static void
+vbdev_dedup_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_dedup *dedup = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_dedup, dedup_bdev);
+	struct dedup_io_channel *dedup_ch = spdk_io_channel_get_ctx(ch);
+	struct dedup_bdev_io *io = (struct dedup_bdev_io *)bdev_io->driver_ctx;
+	int rc = 0;
+
+	memset(io, 0, sizeof(*io));
+	io->dedup = dedup;
+	io->orig_thread = spdk_get_thread();
+	io->log_waiter.arg = io;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, dedup_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		dedup_io_submit(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		io->unmap_block = bdev_io->u.bdev.offset_blocks;
+		dedup_io_submit(io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		/* Blocks may be stored anywhere in the data region, flush the whole base bdev */
+		rc = spdk_bdev_flush_blocks(dedup->base_desc, dedup_ch->base_ch, 0,
+					    spdk_bdev_get_num_blocks(dedup->base_bdev),
+					    dedup_base_io_done, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(dedup->base_desc, dedup_ch->base_ch, dedup_base_io_done, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("dedup: unknown I/O type %d\n", bdev_io->type);
+		rc = -EINVAL;
+		break;
+	}
+
+	if (rc != 0) {
+		if (rc == -ENOMEM) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+		} else {
+			SPDK_ERRLOG("Failed to submit bdev_io!\n");
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		}
+	}
+}
+
+/* Write zeroes are not reported as supported so that the bdev layer emulates them with
+ * regular writes of zeroed buffers, which all share a single physical block.
+ */
+static bool
+vbdev_dedup_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		return true;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(dedup->base_bdev, io_type);
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_dedup_get_io_channel(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	return spdk_get_io_channel(dedup);
+}
+
+static int
+vbdev_dedup_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_dedup *dedup = ctx;
+	struct vbdev_dedup_sb *sb = dedup->sb;
+
+	spdk_json_write_name(w, "dedup");
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&dedup->dedup_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(dedup->base_bdev));
+	spdk_json_write_named_uint32(w, "block_size", sb->dedup_block_size);
+	spdk_json_write_named_uint64(w, "mapped_blocks", dedup->mapped_blocks);
+	spdk_json_write_named_uint64(w, "used_blocks", dedup->used_blocks);
+	spdk_json_write_named_uint64(w, "capacity_blocks", sb->data_blocks);
+	spdk_json_write_named_uint64(w, "dedup_hits", dedup->dedup_hits);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+dedup_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct vbdev_dedup *dedup = io_device;
+	struct dedup_io_channel *dedup_ch = ctx_buf;
+
+	dedup_ch->base_ch = spdk_bdev_get_io_channel(dedup->base_desc);
+	if (dedup_ch->base_ch == NULL) {
+		SPDK_ERRLOG("Failed to get base bdev IO channel (bdev: %s)\n", dedup->dedup_bdev.name);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+dedup_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct dedup_io_channel *dedup_ch = ctx_buf;
+
+	spdk_put_io_channel(dedup_ch->base_ch);
+}
+
+static void
+dedup_free(struct vbdev_dedup *dedup)
+{
+	uint32_t i;
+
+	if (dedup->base_ch != NULL) {
+		spdk_put_io_channel(dedup->base_ch);
+	}
+	if (dedup->accel_ch != NULL) {
+		spdk_put_io_channel(dedup->accel_ch);
+	}
+	if (dedup->base_claimed) {
+		spdk_bdev_module_release_bdev(dedup->base_bdev);
+	}
+	if (dedup->base_desc != NULL) {
+		spdk_bdev_close(dedup->base_desc);
+	}
+
+	for (i = 0; i < SPDK_COUNTOF(dedup->log); i++) {
+		spdk_free(dedup->log[i].buf);
+		free(dedup->log[i].old_entries);
+	}
+	for (i = 0; i < SPDK_COUNTOF(dedup->batches); i++) {
+		spdk_free(dedup->batches[i].fps);
+	}
+	spdk_bit_array_free(&dedup->md_dirty);
+	spdk_bit_array_free(&dedup->allocated);
+	spdk_bit_array_free(&dedup->block_busy);
+	spdk_bit_array_free(&dedup->quarantine);
+	spdk_bit_array_free(&dedup->quarantine_flushing);
+	spdk_free(dedup->md);
+	spdk_free(dedup->index);
+	spdk_free(dedup->refcnt);
+	spdk_free(dedup->init_buf);
+	spdk_free(dedup->sb);
+	free(dedup->reqs);
+	free(dedup->dedup_bdev.name);
+	free(dedup);
+}
+
+static void
+dedup_device_unregister_cb(void *io_device)
+{
+	struct vbdev_dedup *dedup = io_device;
+
+	spdk_bdev_destruct_done(&dedup->dedup_bdev, 0);
+	dedup_free(dedup);
+}
+
+static void
+dedup_destruct_wipe_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to clear superblock of dedup bdev %s\n", dedup->sb->name);
+	}
+
+	spdk_io_device_unregister(dedup, dedup_device_unregister_cb);
+}
+
+static void
+_vbdev_dedup_destruct(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+	int rc;
+
+	assert(TAILQ_EMPTY(&dedup->queued_ios));
+	assert(TAILQ_EMPTY(&dedup->hash_queue));
+	assert(!dedup->log_writing && !dedup->ckpt_active);
+
+	if (dedup->quarantine_flush_active) {
+		dedup->destruct_pending = true;
+		return;
+	}
+
+	if (dedup->delete_pending) {
+		memset(dedup->sb, 0, dedup->base_blocklen);
+		rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->base_ch, dedup->sb, 0, 1,
+					    dedup_destruct_wipe_done, dedup);
+		if (rc == 0) {
+			return;
+		}
+		SPDK_ERRLOG("Failed to clear superblock of dedup bdev %s: %s\n",
+			    dedup->dedup_bdev.name, spdk_strerror(-rc));
+	}
+
+	spdk_io_device_unregister(dedup, dedup_device_unregister_cb);
+}
+
+static int
+vbdev_dedup_destruct(void *ctx)
+{
+	struct vbdev_dedup *dedup = ctx;
+
+	TAILQ_REMOVE(&g_vbdev_dedup, dedup, link);
+
+	/* The base bdev and accel channels used for the block map are tied to dedup->thread */
+	if (dedup->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(dedup->thread, _vbdev_dedup_destruct, dedup);
+	} else {
+		_vbdev_dedup_destruct(dedup);
+	}
+
+	return 1;
+}
+
+static const struct spdk_bdev_fn_table vbdev_dedup_fn_table = {
+	.destruct		= vbdev_dedup_destruct,
+	.submit_request		= vbdev_dedup_submit_request,
+	.io_type_supported	= vbdev_dedup_io_type_supported,
+	.get_io_channel		= vbdev_dedup_get_io_channel,
+	.dump_info_json		= vbdev_dedup_dump_info_json,
+};
+
+static void
+dedup_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *event_ctx)
+{
+	struct vbdev_dedup *dedup, *tmp;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		TAILQ_FOREACH_SAFE(dedup, &g_vbdev_dedup, link, tmp) {
+			if (dedup->base_bdev == bdev) {
+				spdk_bdev_unregister(&dedup->dedup_bdev, NULL, NULL);
+			}
+		}
+		break;
+	default:
+		/* The block map and data regions are sized at creation, a resize can't grow them */
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static int
+dedup_open(const char *base_bdev_name, struct vbdev_dedup **_dedup)
+{
+	struct vbdev_dedup *dedup;
+	int rc;
+
+	dedup = calloc(1, sizeof(*dedup));
+	if (dedup == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_bdev_open_ext(base_bdev_name, true, dedup_base_bdev_event_cb, NULL,
+				&dedup->base_desc);
+	if (rc != 0) {
+		free(dedup);
+		return rc;
+	}
+
+	dedup->base_bdev = spdk_bdev_desc_get_bdev(dedup->base_desc);
+	dedup->base_blocklen = spdk_bdev_get_block_size(dedup->base_bdev);
+	dedup->thread = spdk_get_thread();
+
+	dedup->base_ch = spdk_bdev_get_io_channel(dedup->base_desc);
+	dedup->accel_ch = spdk_accel_get_io_channel();
+	if (dedup->base_ch == NULL || dedup->accel_ch == NULL) {
+		dedup_free(dedup);
+		return -ENOMEM;
+	}
+
+	dedup->sb = spdk_zmalloc(dedup->base_blocklen, DEDUP_BUF_ALIGN, NULL, SPDK_ENV_NUMA_ID_ANY,
+				 SPDK_MALLOC_DMA);
+	if (dedup->sb == NULL) {
+		dedup_free(dedup);
+		return -ENOMEM;
+	}
+
+	*_dedup = dedup;
+
+	return 0;
+}
+
+/* Allocate the runtime structures described by the superblock.  The metadata, the fingerprint
+ * index and the reference counts are all kept in hugepage memory.
+ */
+static int
+dedup_init_runtime(struct vbdev_dedup *dedup)
+{
+	struct vbdev_dedup_sb *sb = dedup->sb;
+	uint64_t index_size;
+	uint32_t i;
+
+	dedup->unit_blocks = sb->dedup_block_size / dedup->base_blocklen;
+	dedup->log_entries_per_block = (dedup->base_blocklen - sizeof(struct vbdev_dedup_log_hdr)) /
+				       sizeof(struct vbdev_dedup_log_entry);
+
+	dedup->md = spdk_zmalloc((sb->map_blocks + sb->fp_blocks) * dedup->base_blocklen,
+				 DEDUP_BUF_ALIGN, NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	dedup->md_dirty = spdk_bit_array_create(sb->map_blocks + sb->fp_blocks);
+	if (dedup->md == NULL || dedup->md_dirty == NULL) {
+		return -ENOMEM;
+	}
+	dedup->map = dedup->md;
+	dedup->fps = (uint8_t *)dedup->md + sb->map_blocks * dedup->base_blocklen;
+
+	index_size = spdk_align64pow2(sb->data_blocks * 2);
+	dedup->index_mask = index_size - 1;
+	dedup->index = spdk_zmalloc(index_size * sizeof(uint32_t), DEDUP_BUF_ALIGN, NULL,
+				    SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	dedup->refcnt = spdk_zmalloc(sb->data_blocks * sizeof(uint32_t), DEDUP_BUF_ALIGN, NULL,
+				     SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	dedup->allocated = spdk_bit_array_create(sb->data_blocks);
+	dedup->block_busy = spdk_bit_array_create(sb->num_blocks);
+	dedup->quarantine = spdk_bit_array_create(sb->data_blocks);
+	dedup->quarantine_flushing = spdk_bit_array_create(sb->data_blocks);
+	if (dedup->index == NULL || dedup->refcnt == NULL || dedup->allocated == NULL ||
+	    dedup->block_busy == NULL || dedup->quarantine == NULL ||
+	    dedup->quarantine_flushing == NULL) {
+		return -ENOMEM;
+	}
+	TAILQ_INIT(&dedup->block_waiters);
+
+	for (i = 0; i < SPDK_COUNTOF(dedup->log); i++) {
+		dedup->log[i].buf = spdk_zmalloc(dedup->base_blocklen, DEDUP_BUF_ALIGN, NULL,
+						 SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+		dedup->log[i].old_entries = calloc(dedup->log_entries_per_block, sizeof(uint64_t));
+		if (dedup->log[i].buf == NULL || dedup->log[i].old_entries == NULL) {
+			return -ENOMEM;
+		}
+		TAILQ_INIT(&dedup->log[i].waiters);
+	}
+	dedup->log_open = &dedup->log[0];
+	TAILQ_INIT(&dedup->log_space_waiters);
+
+	for (i = 0; i < SPDK_COUNTOF(dedup->batches); i++) {
+		dedup->batches[i].dedup = dedup;
+		dedup->batches[i].fps = spdk_zmalloc(DEDUP_HASH_BATCH_REQS * DEDUP_MAX_IO_BLOCKS *
+						     DEDUP_FP_SIZE, DEDUP_BUF_ALIGN, NULL,
+						     SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+		if (dedup->batches[i].fps == NULL) {
+			return -ENOMEM;
+		}
+		TAILQ_INIT(&dedup->batches[i].reqs);
+	}
+	TAILQ_INIT(&dedup->hash_queue);
+
+	dedup->reqs = calloc(DEDUP_NUM_REQS, sizeof(*dedup->reqs));
+	if (dedup->reqs == NULL) {
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&dedup->free_reqs);
+	TAILQ_INIT(&dedup->queued_ios);
+	for (i = 0; i < DEDUP_NUM_REQS; i++) {
+		dedup->reqs[i].dedup = dedup;
+		dedup->reqs[i].log_waiter.arg = &dedup->reqs[i];
+		TAILQ_INSERT_TAIL(&dedup->free_reqs, &dedup->reqs[i], link);
+	}
+
+	return 0;
+}
+
+static int
+dedup_register(struct vbdev_dedup *dedup)
+{
+	struct spdk_bdev *base_bdev = dedup->base_bdev;
+	struct spdk_accel_operation_exec_ctx opctx = {};
+	int rc;
+
+	dedup->dedup_bdev.name = strdup(dedup->sb->name);
+	if (dedup->dedup_bdev.name == NULL) {
+		return -ENOMEM;
+	}
+
+	dedup->dedup_bdev.product_name = "dedup";
+	dedup->dedup_bdev.write_cache = base_bdev->write_cache;
+	dedup->dedup_bdev.blocklen = dedup->sb->dedup_block_size;
+	dedup->dedup_bdev.blockcnt = dedup->sb->num_blocks;
+	/* Bound the per-request state, larger I/Os are split by the bdev layer */
+	dedup->dedup_bdev.max_rw_size = DEDUP_MAX_IO_BLOCKS;
+	dedup->dedup_bdev.max_num_segments = DEDUP_MAX_IOVS;
+	dedup->dedup_bdev.max_segment_size = DEDUP_MAX_IO_BLOCKS * dedup->sb->dedup_block_size;
+
+	opctx.size = SPDK_SIZEOF(&opctx, block_size);
+	opctx.block_size = dedup->sb->dedup_block_size;
+	dedup->dedup_bdev.required_alignment =
+		spdk_max(base_bdev->required_alignment,
+			 spdk_accel_get_buf_align(SPDK_ACCEL_OPC_SHA256, &opctx));
+
+	dedup->dedup_bdev.uuid = dedup->sb->uuid;
+	dedup->dedup_bdev.numa = base_bdev->numa;
+	dedup->dedup_bdev.ctxt = dedup;
+	dedup->dedup_bdev.fn_table = &vbdev_dedup_fn_table;
+	dedup->dedup_bdev.module = &dedup_if;
+
+	spdk_io_device_register(dedup, dedup_bdev_ch_create_cb, dedup_bdev_ch_destroy_cb,
+				sizeof(struct dedup_io_channel), dedup->dedup_bdev.name);
+
+	rc = spdk_bdev_register(&dedup->dedup_bdev);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to register dedup bdev %s: %s\n", dedup->dedup_bdev.name,
+			    spdk_strerror(-rc));
+		spdk_io_device_unregister(dedup, NULL);
+		return rc;
+	}
+
+	TAILQ_INSERT_TAIL(&g_vbdev_dedup, dedup, link);
+	SPDK_DEBUGLOG(vbdev_dedup, "Registered dedup bdev %s on %s\n", dedup->dedup_bdev.name,
+		      spdk_bdev_get_name(base_bdev));
+
+	return 0;
+}
+
+static void
+dedup_init_done(struct vbdev_dedup *dedup, int status)
+{
+	void (*cb_fn)(void *cb_arg, int status) = dedup->init_cb;
+	void *cb_arg = dedup->init_cb_arg;
+
+	spdk_free(dedup->init_buf);
+	dedup->init_buf = NULL;
+
+	if (status == 0) {
+		status = dedup_register(dedup);
+	}
+	if (status != 0) {
+		dedup_free(dedup);
+	}
+
+	cb_fn(cb_arg, status);
+}
+
+static void
+dedup_create_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	dedup_init_done(dedup, success ? 0 : -EIO);
+}
+
+static void
+dedup_create_map_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		dedup_init_done(dedup, -EIO);
+		return;
+	}
+
+	/* Examine only recognizes the volume by its superblock, so that one is written last */
+	dedup->sb->crc = dedup_sb_crc(dedup->sb);
+	rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->base_ch, dedup->sb, 0, 1,
+				    dedup_create_sb_done, dedup);
+	if (rc != 0) {
+		dedup_init_done(dedup, rc);
+	}
+}
+
+static int
+dedup_init_sb(struct vbdev_dedup *dedup, const struct vbdev_dedup_opts *opts)
+{
+	struct vbdev_dedup_sb *sb = dedup->sb;
+	uint64_t base_blocks = spdk_bdev_get_num_blocks(dedup->base_bdev);
+	uint64_t logical_size, unit_blocks, avail_blocks, data_blocks;
+
+	sb->dedup_block_size = opts->block_size ? opts->block_size :
+			       VBDEV_DEDUP_DEFAULT_BLOCK_SIZE;
+	if (sb->dedup_block_size % dedup->base_blocklen != 0 ||
+	    sb->dedup_block_size > VBDEV_DEDUP_MAX_BLOCK_SIZE) {
+		SPDK_ERRLOG("Block size %u must be a multiple of base block size %u, max block size "
+			    "is %u\n", sb->dedup_block_size, dedup->base_blocklen,
+			    VBDEV_DEDUP_MAX_BLOCK_SIZE);
+		return -EINVAL;
+	}
+
+	memcpy(sb->signature, DEDUP_SB_SIGNATURE, sizeof(sb->signature));
+	sb->version = DEDUP_SB_VERSION;
+	sb->length = sizeof(*sb);
+	sb->block_size = dedup->base_blocklen;
+	spdk_uuid_generate(&sb->uuid);
+	snprintf(sb->name, sizeof(sb->name), "%s", opts->name);
+	sb->generation = 1;
+
+	logical_size = opts->size_in_mib ? opts->size_in_mib * 1024 * 1024 :
+		       base_blocks * dedup->base_blocklen;
+	sb->num_blocks = logical_size / sb->dedup_block_size;
+
+	unit_blocks = sb->dedup_block_size / dedup->base_blocklen;
+	sb->md_offset = unit_blocks;
+	sb->map_blocks = SPDK_ALIGN_CEIL(spdk_divide_round_up(sb->num_blocks * sizeof(uint64_t),
+					 dedup->base_blocklen), unit_blocks);
+	sb->log_blocks = SPDK_ALIGN_CEIL(spdk_divide_round_up(DEDUP_LOG_SIZE, dedup->base_blocklen),
+					 unit_blocks);
+	if (sb->num_blocks == 0 ||
+	    sb->md_offset + sb->map_blocks + sb->log_blocks + unit_blocks >= base_blocks) {
+		SPDK_ERRLOG("Base bdev %s is too small\n", spdk_bdev_get_name(dedup->base_bdev));
+		return -ENOSPC;
+	}
+
+	/* The remaining space is shared by the data blocks and their fingerprints */
+	avail_blocks = base_blocks - sb->md_offset - sb->map_blocks - sb->log_blocks;
+	data_blocks = avail_blocks * dedup->base_blocklen / (sb->dedup_block_size + DEDUP_FP_SIZE);
+	sb->fp_blocks = SPDK_ALIGN_CEIL(spdk_divide_round_up(data_blocks * DEDUP_FP_SIZE,
+					dedup->base_blocklen), unit_blocks);
+	sb->log_offset = sb->md_offset + sb->map_blocks + sb->fp_blocks;
+	sb->data_offset = sb->log_offset + sb->log_blocks;
+	if (sb->data_offset >= base_blocks) {
+		SPDK_ERRLOG("Base bdev %s is too small\n", spdk_bdev_get_name(dedup->base_bdev));
+		return -ENOSPC;
+	}
+	sb->data_blocks = spdk_min(data_blocks, (base_blocks - sb->data_offset) / unit_blocks);
+
+	/* The block bitmaps and the index slots are 32-bit */
+	if (sb->data_blocks == 0 || sb->num_blocks > UINT32_MAX || sb->data_blocks > INT32_MAX) {
+		SPDK_ERRLOG("Unsupported volume size, use a larger block size\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int
+create_dedup_disk(const struct vbdev_dedup_opts *opts, vbdev_dedup_create_cb cb_fn, void *cb_arg)
+{
+	struct vbdev_dedup *dedup;
+	int rc;
+
+	if (strnlen(opts->name, sizeof(dedup->sb->name)) == sizeof(dedup->sb->name)) {
+		SPDK_ERRLOG("Dedup bdev name %s is too long\n", opts->name);
+		return -EINVAL;
+	}
+
+	if (spdk_bdev_get_by_name(opts->name) != NULL) {
+		SPDK_ERRLOG("Bdev %s already exists\n", opts->name);
+		return -EEXIST;
+	}
+
+	rc = dedup_open(opts->base_bdev_name, &dedup);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev %s: %s\n", opts->base_bdev_name, spdk_strerror(-rc));
+		return rc;
+	}
+
+	rc = dedup_init_sb(dedup, opts);
+	if (rc != 0) {
+		goto err;
+	}
+
+	rc = spdk_bdev_module_claim_bdev(dedup->base_bdev, dedup->base_desc, &dedup_if);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to claim bdev %s\n", opts->base_bdev_name);
+		goto err;
+	}
+	dedup->base_claimed = true;
+
+	rc = dedup_init_runtime(dedup);
+	if (rc != 0) {
+		goto err;
+	}
+
+	dedup->init_cb = cb_fn;
+	dedup->init_cb_arg = cb_arg;
+
+	/* Start with an empty block map.  The fingerprints are only valid for referenced blocks
+	 * and the log blocks only if they match the volume UUID and the current generation, so
+	 * neither needs initialization.
+	 */
+	rc = spdk_bdev_write_blocks(dedup->base_desc, dedup->base_ch, dedup->map,
+				    dedup->sb->md_offset, dedup->sb->map_blocks,
+				    dedup_create_map_done, dedup);
+	if (rc != 0) {
+		goto err;
+	}
+
+	return 0;
+err:
+	dedup_free(dedup);
+	return rc;
+}
+
+static bool
+dedup_sb_valid(struct vbdev_dedup *dedup)
+{
+	struct vbdev_dedup_sb *sb = dedup->sb;
+	uint64_t base_blocks = spdk_bdev_get_num_blocks(dedup->base_bdev);
+	uint64_t unit_blocks;
+
+	if (memcmp(sb->signature, DEDUP_SB_SIGNATURE, sizeof(sb->signature)) != 0) {
+		return false;
+	}
+
+	if (sb->version != DEDUP_SB_VERSION || sb->length != sizeof(*sb) ||
+	    sb->crc != dedup_sb_crc(sb)) {
+		SPDK_WARNLOG("Invalid dedup superblock on bdev %s\n",
+			     spdk_bdev_get_name(dedup->base_bdev));
+		return false;
+	}
+
+	if (sb->block_size != dedup->base_blocklen || sb->dedup_block_size == 0 ||
+	    sb->dedup_block_size % dedup->base_blocklen != 0 ||
+	    sb->dedup_block_size > VBDEV_DEDUP_MAX_BLOCK_SIZE) {
+		goto unsupported;
+	}
+
+	unit_blocks = sb->dedup_block_size / dedup->base_blocklen;
+	if (sb->num_blocks == 0 || sb->num_blocks > UINT32_MAX || sb->data_blocks == 0 ||
+	    sb->data_blocks > INT32_MAX || sb->name[sizeof(sb->name) - 1] != '\0' ||
+	    sb->map_blocks * dedup->base_blocklen < sb->num_blocks * sizeof(uint64_t) ||
+	    sb->fp_blocks * dedup->base_blocklen < sb->data_blocks * DEDUP_FP_SIZE ||
+	    sb->log_blocks == 0 || sb->log_offset < sb->md_offset + sb->map_blocks + sb->fp_blocks ||
+	    sb->data_offset < sb->log_offset + sb->log_blocks ||
+	    sb->data_offset + sb->data_blocks * unit_blocks > base_blocks) {
+		goto unsupported;
+	}
+
+	return true;
+unsupported:
+	SPDK_ERRLOG("Unsupported dedup volume parameters on bdev %s\n",
+		    spdk_bdev_get_name(dedup->base_bdev));
+	return false;
+}
+
+/* Apply the log blocks of the current generation to the block map and fingerprint table */
+static int
+dedup_load_replay(struct vbdev_dedup *dedup)
+{
+	struct vbdev_dedup_sb *sb = dedup->sb;
+	struct vbdev_dedup_log_hdr *hdr;
+	struct vbdev_dedup_log_entry *entries;
+	uint64_t entry;
+	uint32_t seq, i;
+
+	for (seq = 0; seq < sb->log_blocks; seq++) {
+		hdr = (void *)((uint8_t *)dedup->init_buf + (uint64_t)seq * dedup->base_blocklen);
+		if (hdr->magic != DEDUP_LOG_MAGIC || spdk_uuid_compare(&hdr->uuid, &sb->uuid) != 0 ||
+		    hdr->generation != sb->generation || hdr->seq != seq ||
+		    hdr->num_entries > dedup->log_entries_per_block ||
+		    hdr->crc != dedup_log_crc(dedup, hdr)) {
+			break;
+		}
+
+		entries = dedup_log_entries(hdr);
+		for (i = 0; i < hdr->num_entries; i++) {
+			entry = entries[i].map_entry & ~DEDUP_LOG_FP;
+			if (entries[i].lba >= sb->num_blocks || entry > sb->data_blocks ||
+			    (entry == 0 && (entries[i].map_entry & DEDUP_LOG_FP))) {
+				SPDK_ERRLOG("Invalid entry 0x%" PRIx64 " of block %" PRIu64 " in metadata "
+					    "log\n", entries[i].map_entry, entries[i].lba);
+				return -EILSEQ;
+			}
+
+			dedup->map[entries[i].lba] = entry;
+			dedup_map_set_dirty(dedup, entries[i].lba);
+			if (entries[i].map_entry & DEDUP_LOG_FP) {
+				memcpy(dedup_fp(dedup, entry - 1), entries[i].fp, DEDUP_FP_SIZE);
+				dedup_fp_set_dirty(dedup, entry - 1);
+			}
+		}
+	}
+
+	SPDK_DEBUGLOG(vbdev_dedup, "%s: replayed %u log blocks of generation %" PRIu64 "\n",
+		      sb->name, seq, sb->generation);
+
+	return 0;
+}
+
+/* Rebuild the reference counts and the fingerprint index from the block map */
+static int
+dedup_load_build_index(struct vbdev_dedup *dedup)
+{
+	uint64_t lba, entry;
+	uint32_t pba;
+
+	for (lba = 0; lba < dedup->sb->num_blocks; lba++) {
+		entry = dedup->map[lba];
+		if (entry == 0) {
+			continue;
+		}
+
+		if (entry > dedup->sb->data_blocks) {
+			SPDK_ERRLOG("Invalid map entry 0x%" PRIx64 " of block %" PRIu64 "\n", entry, lba);
+			return -EILSEQ;
+		}
+
+		if (dedup->refcnt[entry - 1]++ == 0) {
+			spdk_bit_array_set(dedup->allocated, entry - 1);
+			dedup->used_blocks++;
+		}
+		dedup->mapped_blocks++;
+	}
+
+	for (pba = spdk_bit_array_find_first_set(dedup->allocated, 0); pba != UINT32_MAX;
+	     pba = spdk_bit_array_find_first_set(dedup->allocated, pba + 1)) {
+		dedup_index_insert(dedup, pba);
+	}
+
+	return 0;
+}
+
+static void
+dedup_load_checkpoint_done(struct vbdev_dedup *dedup, int status)
+{
+	dedup_init_done(dedup, status);
+}
+
+static void
+dedup_load_log_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		dedup_init_done(dedup, -EIO);
+		return;
+	}
+
+	rc = dedup_load_replay(dedup);
+	if (rc == 0) {
+		rc = dedup_load_build_index(dedup);
+	}
+	if (rc != 0) {
+		dedup_init_done(dedup, rc);
+		return;
+	}
+
+	/* Log blocks past the last valid one may be leftovers of an older generation, start a
+	 * fresh generation right away so that they're never mistaken for new entries.
+	 */
+	dedup_checkpoint(dedup, dedup_load_checkpoint_done);
+}
+
+static void
+dedup_load_md_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		dedup_init_done(dedup, -EIO);
+		return;
+	}
+
+	dedup->init_buf = spdk_zmalloc(dedup->sb->log_blocks * dedup->base_blocklen,
+				       DEDUP_BUF_ALIGN, NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (dedup->init_buf == NULL) {
+		dedup_init_done(dedup, -ENOMEM);
+		return;
+	}
+
+	rc = spdk_bdev_read_blocks(dedup->base_desc, dedup->base_ch, dedup->init_buf,
+				   dedup->sb->log_offset, dedup->sb->log_blocks,
+				   dedup_load_log_done, dedup);
+	if (rc != 0) {
+		dedup_init_done(dedup, rc);
+	}
+}
+
+static void
+dedup_examine_done(void *cb_arg, int status)
+{
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to load dedup volume: %s\n", spdk_strerror(-status));
+	}
+
+	spdk_bdev_module_examine_done(&dedup_if);
+}
+
+static void
+dedup_load_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_dedup *dedup = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success || !dedup_sb_valid(dedup)) {
+		dedup_free(dedup);
+		spdk_bdev_module_examine_done(&dedup_if);
+		return;
+	}
+
+	SPDK_NOTICELOG("Found dedup volume %s on bdev %s\n", dedup->sb->name,
+		       spdk_bdev_get_name(dedup->base_bdev));
+
+	rc = spdk_bdev_module_claim_bdev(dedup->base_bdev, dedup->base_desc, &dedup_if);
+	if (rc != 0) {
+		dedup_init_done(dedup, rc);
+		return;
+	}
+	dedup->base_claimed = true;
+
+	rc = dedup_init_runtime(dedup);
+	if (rc != 0) {
+		dedup_init_done(dedup, rc);
+		return;
+	}
+
+	rc = spdk_bdev_read_blocks(dedup->base_desc, dedup->base_ch, dedup->md, dedup->sb->md_offset,
+				   dedup->sb->map_blocks + dedup->sb->fp_blocks,
+				   dedup_load_md_done, dedup);
+	if (rc != 0) {
+		dedup_init_done(dedup, rc);
+	}
+}
+
+static void
+vbdev_dedup_examine(struct spdk_bdev *bdev)
+{
+	struct vbdev_dedup *dedup;
+	int rc;
+
+	rc = dedup_open(spdk_bdev_get_name(bdev), &dedup);
+	if (rc != 0) {
+		spdk_bdev_module_examine_done(&dedup_if);
+		return;
+	}
+
+	dedup->init_cb = dedup_examine_done;
+
+	rc = spdk_bdev_read_blocks(dedup->base_desc, dedup->base_ch, dedup->sb, 0, 1,
+				   dedup_load_sb_done, dedup);
+	if (rc != 0) {
+		dedup_free(dedup);
+		spdk_bdev_module_examine_done(&dedup_if);
+	}
+}
+
+void
+delete_dedup_disk(const char *bdev_name, vbdev_dedup_delete_cb cb_fn, void *cb_arg)
+{
+	struct spdk_bdev *bdev;
+	struct vbdev_dedup *dedup;
+	int rc;
+
+	bdev = spdk_bdev_get_by_name(bdev_name);
+	if (bdev == NULL || bdev->module != &dedup_if) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	dedup = SPDK_CONTAINEROF(bdev, struct vbdev_dedup, dedup_bdev);
+	dedup->delete_pending = true;
+
+	rc = spdk_bdev_unregister_by_name(bdev_name, &dedup_if, cb_fn, cb_arg);
+	if (rc != 0) {
+		dedup->delete_pending = false;
+		cb_fn(cb_arg, rc);
+	}
+}
+
+static int
+vbdev_dedup_init(void)
+{
+	return 0;
+}
+
+static int
+vbdev_dedup_get_ctx_size(void)
+{
+	return sizeof(struct dedup_bdev_io);
+}
+
+static struct spdk_bdev_module dedup_if = {
+	.name = "dedup",
+	.module_init = vbdev_dedup_init,
+	.get_ctx_size = vbdev_dedup_get_ctx_size,
+	.examine_disk = vbdev_dedup_examine,
+};
+
+SPDK_BDEV_MODULE_REGISTER(dedup, &dedup_if)
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_dedup)
@@ -0,0 +1,55 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_DEDUP_H
+#define SPDK_VBDEV_DEDUP_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+
+#define VBDEV_DEDUP_DEFAULT_BLOCK_SIZE	4096
+#define VBDEV_DEDUP_MAX_BLOCK_SIZE	(64 * 1024)
+
+/* Options used to create a new dedup vbdev on top of a base bdev. */
+struct vbdev_dedup_opts {
+	/* Name of the dedup vbdev to create */
+	const char	*name;
+	/* Name of the base bdev */
+	const char	*base_bdev_name;
+	/* Logical size in MiB, 0 means the size of the base bdev */
+	uint64_t	size_in_mib;
+	/* Block size of the dedup vbdev in bytes, the unit of deduplication */
+	uint32_t	block_size;
+};
+
+typedef void (*vbdev_dedup_create_cb)(void *cb_arg, int bdeverrno);
+typedef void (*vbdev_dedup_delete_cb)(void *cb_arg, int bdeverrno);
+
+/**
+ * Initialize a dedup volume on the base bdev and create a dedup vbdev on top of it.
+ *
+ * Any data previously stored on the base bdev is discarded.  The volume metadata is persisted
+ * on the base bdev, so the vbdev is recreated automatically when the base bdev is examined.
+ *
+ * \param opts Dedup vbdev options.
+ * \param cb_fn Function to call after the volume is initialized and the vbdev registered.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if initialization was started, negative errno on failure. cb_fn is only called
+ * if 0 is returned.
+ */
+int create_dedup_disk(const struct vbdev_dedup_opts *opts, vbdev_dedup_create_cb cb_fn,
+		      void *cb_arg);
+
+/**
+ * Delete a dedup vbdev and destroy the volume metadata on its base bdev.
+ *
+ * \param bdev_name Dedup bdev name.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void delete_dedup_disk(const char *bdev_name, vbdev_dedup_delete_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_DEDUP_H */
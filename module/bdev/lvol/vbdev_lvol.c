@@ -15,6 +15,8 @@
 
 struct vbdev_lvol_io {
 	struct spdk_blob_ext_io_opts ext_io_opts;
+	/* Zero-copy request on the lvolstore's bdev, NULL if the data is copied */
+	struct spdk_bdev_io *zcopy_base_io;
 };
 
 static TAILQ_HEAD(, lvol_store_bdev) g_spdk_lvol_pairs = TAILQ_HEAD_INITIALIZER(
@@ -839,6 +841,18 @@ vbdev_lvol_get_io_channel(void *ctx)
 	return spdk_lvol_get_io_channel(lvol);
 }
 
+static bool
+vbdev_lvol_zcopy_supported(struct spdk_lvol *lvol)
+{
+	struct spdk_bs_dev *bs_dev = lvol->lvol_store->bs_dev;
+	struct spdk_bdev *base_bdev = bs_dev->get_base_bdev(bs_dev);
+
+	/* Without zero-copy support in the lvolstore's bdev, all the data would be copied */
+	return spdk_bdev_io_type_supported(base_bdev, SPDK_BDEV_IO_TYPE_ZCOPY) &&
+	       spdk_bdev_get_block_size(base_bdev) == lvol->bdev->blocklen &&
+	       spdk_bdev_get_md_size(base_bdev) == 0;
+}
+
 static bool
 vbdev_lvol_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
@@ -854,6 +868,8 @@ vbdev_lvol_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 	case SPDK_BDEV_IO_TYPE_SEEK_DATA:
 	case SPDK_BDEV_IO_TYPE_SEEK_HOLE:
 		return true;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		return vbdev_lvol_zcopy_supported(lvol);
 	default:
 		return false;
 	}
@@ -955,6 +971,148 @@ lvol_write(struct spdk_lvol *lvol, struct spdk_io_channel *ch, struct spdk_bdev_
 				num_pages, lvol_op_comp, bdev_io, &lvol_io->ext_io_opts);
 }
 
+/* The clusters may be handed over to a snapshot once the lvolstore bdev is done with them */
+static void
+lvol_zcopy_release_dev_lba(struct spdk_bdev_io *bdev_io, struct spdk_bdev_io *base_io)
+{
+	struct spdk_lvol *lvol = bdev_io->bdev->ctxt;
+
+	spdk_bdev_free_io(base_io);
+	spdk_blob_release_dev_lba(lvol->blob);
+}
+
+static void
+lvol_zcopy_release_complete(struct spdk_bdev_io *base_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *bdev_io = cb_arg;
+
+	lvol_zcopy_release_dev_lba(bdev_io, base_io);
+	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+lvol_zcopy_start_complete(struct spdk_bdev_io *base_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *bdev_io = cb_arg;
+	struct vbdev_lvol_io *lvol_io = (struct vbdev_lvol_io *)bdev_io->driver_ctx;
+
+	if (!success) {
+		lvol_zcopy_release_dev_lba(bdev_io, base_io);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Hand out the lvolstore bdev's buffers, it keeps them until the end of the request */
+	if (base_io->u.bdev.iovcnt == 1) {
+		spdk_bdev_io_set_buf(bdev_io, base_io->u.bdev.iovs[0].iov_base,
+				     base_io->u.bdev.iovs[0].iov_len);
+	} else if (bdev_io->u.bdev.iovs == NULL) {
+		bdev_io->u.bdev.iovs = base_io->u.bdev.iovs;
+		bdev_io->u.bdev.iovcnt = base_io->u.bdev.iovcnt;
+	} else if (bdev_io->u.bdev.iovcnt >= base_io->u.bdev.iovcnt) {
+		memcpy(bdev_io->u.bdev.iovs, base_io->u.bdev.iovs,
+		       sizeof(struct iovec) * base_io->u.bdev.iovcnt);
+		bdev_io->u.bdev.iovcnt = base_io->u.bdev.iovcnt;
+	} else {
+		SPDK_ERRLOG("Zcopy buffer of bdev %s doesn't fit in %d iovecs\n",
+			    spdk_bdev_get_name(base_io->bdev), bdev_io->u.bdev.iovcnt);
+		spdk_bdev_zcopy_end(base_io, false, lvol_zcopy_release_complete, bdev_io);
+		return;
+	}
+
+	lvol_io->zcopy_base_io = base_io;
+	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+lvol_zcopy_end_complete(struct spdk_bdev_io *base_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *bdev_io = cb_arg;
+
+	lvol_zcopy_release_dev_lba(bdev_io, base_io);
+	spdk_bdev_io_complete(bdev_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+lvol_zcopy_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct spdk_lvol *lvol = bdev_io->bdev->ctxt;
+
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (bdev_io->u.bdev.zcopy.populate) {
+		spdk_blob_io_readv(lvol->blob, ch, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+				   bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks,
+				   lvol_op_comp, bdev_io);
+	} else {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+}
+
+static void
+lvol_zcopy_start(struct spdk_lvol *lvol, struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct spdk_bs_dev *bs_dev = lvol->lvol_store->bs_dev;
+	struct vbdev_lvol_io *lvol_io = (struct vbdev_lvol_io *)bdev_io->driver_ctx;
+	uint64_t lba;
+	int rc;
+
+	lvol_io->zcopy_base_io = NULL;
+
+	if (!bdev_io->u.bdev.zcopy.populate && spdk_blob_is_read_only(lvol->blob)) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Only the clusters allocated in the blob itself can be accessed on the lvolstore's bdev.
+	 * They're held by the blob, not moved to a snapshot, until the end of the request.
+	 */
+	rc = spdk_blob_get_dev_lba(lvol->blob, bdev_io->u.bdev.offset_blocks,
+				   bdev_io->u.bdev.num_blocks, &lba);
+	if (rc == 0) {
+		rc = spdk_bdev_zcopy_start(spdk_bs_bdev_get_desc(bs_dev),
+					   spdk_bs_get_dev_io_channel(ch), NULL, 0, lba,
+					   bdev_io->u.bdev.num_blocks,
+					   bdev_io->u.bdev.zcopy.populate, lvol_zcopy_start_complete,
+					   bdev_io);
+		if (rc == 0) {
+			return;
+		}
+
+		spdk_blob_release_dev_lba(lvol->blob);
+		if (rc == -ENOMEM) {
+			spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_NOMEM);
+			return;
+		}
+	}
+
+	/* Otherwise, the data is copied through a buffer, like for regular reads and writes */
+	spdk_bdev_io_get_buf(bdev_io, lvol_zcopy_get_buf_cb,
+			     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+}
+
+static void
+lvol_zcopy_end(struct spdk_lvol *lvol, struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_lvol_io *lvol_io = (struct vbdev_lvol_io *)bdev_io->driver_ctx;
+	struct spdk_bdev_io *base_io = lvol_io->zcopy_base_io;
+
+	if (base_io != NULL) {
+		spdk_bdev_zcopy_end(base_io, bdev_io->u.bdev.zcopy.commit, lvol_zcopy_end_complete,
+				    bdev_io);
+	} else if (bdev_io->u.bdev.zcopy.commit && !bdev_io->u.bdev.zcopy.populate) {
+		spdk_blob_io_writev(lvol->blob, ch, bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt,
+				    bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks,
+				    lvol_op_comp, bdev_io);
+	} else {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+}
+
 static int
 lvol_reset(struct spdk_bdev_io *bdev_io)
 {
@@ -1002,6 +1160,13 @@ vbdev_lvol_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_
 	case SPDK_BDEV_IO_TYPE_SEEK_HOLE:
 		lvol_seek_hole(lvol, bdev_io);
 		break;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		if (bdev_io->u.bdev.zcopy.start) {
+			lvol_zcopy_start(lvol, ch, bdev_io);
+		} else {
+			lvol_zcopy_end(lvol, ch, bdev_io);
+		}
+		break;
 	default:
 		SPDK_INFOLOG(vbdev_lvol, "lvol: unsupported I/O type %d\n", bdev_io->type);
 		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
@@ -1106,6 +1271,15 @@ vbdev_lvol_get_memory_domain_types(void *ctx, enum spdk_dma_device_type *types,
 	return rc;
 }
 
+static uint64_t
+vbdev_lvol_get_contiguous_blocks(void *ctx, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_lvol *lvol = ctx;
+
+	/* Clusters placed back to back on the lvs bdev can be served by a single blob I/O */
+	return spdk_blob_get_num_contiguous_io_units(lvol->blob, offset_blocks, num_blocks);
+}
+
 static struct spdk_bdev_fn_table vbdev_lvol_fn_table = {
 	.destruct		= vbdev_lvol_unregister,
 	.io_type_supported	= vbdev_lvol_io_type_supported,
@@ -1115,6 +1289,7 @@ static struct spdk_bdev_fn_table vbdev_lvol_fn_table = {
 	.write_config_json	= vbdev_lvol_write_config_json,
 	.get_memory_domains	= vbdev_lvol_get_memory_domains,
 	.get_memory_domain_types = vbdev_lvol_get_memory_domain_types,
+	.get_contiguous_blocks	= vbdev_lvol_get_contiguous_blocks,
 };
 
 static void
@@ -33,6 +33,7 @@ struct null_io_channel {
 
 static TAILQ_HEAD(, null_bdev) g_null_bdev_head = TAILQ_HEAD_INITIALIZER(g_null_bdev_head);
 static void *g_null_read_buf;
+static void *g_null_write_buf;
 
 static int bdev_null_initialize(void);
 static void bdev_null_finish(void);
@@ -166,6 +167,23 @@ bdev_null_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_
 		}
 		TAILQ_INSERT_TAIL(&ch->io, null_io, link);
 		break;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		if (bdev_io->u.bdev.zcopy.start) {
+			if (spdk_unlikely(bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen >
+					  SPDK_BDEV_LARGE_BUF_MAX_SIZE)) {
+				SPDK_ERRLOG("Overflow occurred. Zcopy I/O size %" PRIu64 " was larger than permitted %d\n",
+					    bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen,
+					    SPDK_BDEV_LARGE_BUF_MAX_SIZE);
+				spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+				return;
+			}
+			/* Reads see zeroes and written data is dropped, as with regular I/O */
+			spdk_bdev_io_set_buf(bdev_io, bdev_io->u.bdev.zcopy.populate ?
+					     g_null_read_buf : g_null_write_buf,
+					     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		}
+		TAILQ_INSERT_TAIL(&ch->io, null_io, link);
+		break;
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 	case SPDK_BDEV_IO_TYPE_RESET:
 		TAILQ_INSERT_TAIL(&ch->io, null_io, link);
@@ -188,6 +206,8 @@ bdev_null_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_
 static bool
 bdev_null_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
+	struct null_bdev *null_disk = ctx;
+
 	switch (io_type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 	case SPDK_BDEV_IO_TYPE_WRITE:
@@ -195,6 +215,9 @@ bdev_null_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 	case SPDK_BDEV_IO_TYPE_RESET:
 	case SPDK_BDEV_IO_TYPE_ABORT:
 		return true;
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		/* The shared buffers can't hold the protection information of each I/O */
+		return null_disk->bdev.dif_type == SPDK_DIF_DISABLE;
 	case SPDK_BDEV_IO_TYPE_FLUSH:
 	case SPDK_BDEV_IO_TYPE_UNMAP:
 	default:
@@ -464,6 +487,15 @@ bdev_null_initialize(void)
 		return -1;
 	}
 
+	/* Zero-copy writes get this buffer to fill in, its contents are never read */
+	g_null_write_buf = spdk_zmalloc(SPDK_BDEV_LARGE_BUF_MAX_SIZE, 0, NULL,
+					SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (g_null_write_buf == NULL) {
+		spdk_free(g_null_read_buf);
+		g_null_read_buf = NULL;
+		return -1;
+	}
+
 	/*
 	 * We need to pick some unique address as our "io device" - so just use the
 	 *  address of the global tailq.
@@ -524,6 +556,7 @@ static void
 _bdev_null_finish_cb(void *arg)
 {
 	spdk_free(g_null_read_buf);
+	spdk_free(g_null_write_buf);
 	spdk_bdev_module_fini_done();
 }
 
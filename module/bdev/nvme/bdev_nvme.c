@@ -3765,6 +3765,9 @@ bdev_nvme_create_ctrlr_channel_cb(void *io_device, void *ctx_buf)
 	struct nvme_ctrlr *nvme_ctrlr = io_device;
 	struct nvme_ctrlr_channel *ctrlr_ch = ctx_buf;
 
+	spdk_io_channel_set_numa_id(spdk_io_channel_from_ctx(ctrlr_ch),
+				    spdk_nvme_ctrlr_get_numa_id(nvme_ctrlr->ctrlr));
+
 	return nvme_qpair_create(nvme_ctrlr, ctrlr_ch);
 }
 
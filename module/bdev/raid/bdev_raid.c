@@ -5,6 +5,7 @@
  */
 
 #include "bdev_raid.h"
+#include "spdk/bit_array.h"
 #include "spdk/env.h"
 #include "spdk/thread.h"
 #include "spdk/log.h"
@@ -21,6 +22,8 @@
 #define RAID_BDEV_PROCESS_WINDOW_SIZE_KB_DEFAULT	1024
 #define RAID_BDEV_PROCESS_MAX_BANDWIDTH_MB_SEC_DEFAULT	0
 
+#define RAID_BDEV_WIB_SWEEP_PERIOD_US	(5 * 1000 * 1000)
+
 static bool g_shutdown_started = false;
 
 /* List of all raid bdevs */
@@ -45,6 +48,18 @@ struct raid_bdev_io_channel {
 		struct spdk_io_channel *target_ch;
 		struct raid_bdev_io_channel *ch_processed;
 	} process;
+
+	/* Write-intent bitmap data, shared with the ch_processed channel */
+	struct {
+		uint8_t region_shift;
+		uint32_t num_regions;
+		/* Regions known to be marked in the on-disk bitmap */
+		struct spdk_bit_array *dirty;
+		/* Regions written to since the last sweep */
+		struct spdk_bit_array *touched;
+		/* Number of outstanding writes per region */
+		uint32_t *writes_outstanding;
+	} wib;
 };
 
 enum raid_bdev_process_state {
@@ -80,6 +95,9 @@ struct raid_bdev_process {
 	int				status;
 	TAILQ_HEAD(, raid_process_finish_action) finish_actions;
 	struct raid_process_qos		qos;
+	/* Regions to resync, taken from the write-intent bitmap */
+	struct spdk_bit_array		*resync_regions;
+	uint8_t				resync_region_shift;
 };
 
 struct raid_process_finish_action {
@@ -91,6 +109,8 @@ struct raid_process_finish_action {
 static struct spdk_raid_bdev_opts g_opts = {
 	.process_window_size_kb = RAID_BDEV_PROCESS_WINDOW_SIZE_KB_DEFAULT,
 	.process_max_bandwidth_mb_sec = RAID_BDEV_PROCESS_MAX_BANDWIDTH_MB_SEC_DEFAULT,
+	.raid1_read_policy = SPDK_BDEV_RAID1_READ_POLICY_QUEUE_DEPTH,
+	.write_intent_bitmap = false,
 };
 
 void
@@ -106,6 +126,11 @@ raid_bdev_set_opts(const struct spdk_raid_bdev_opts *opts)
 		return -EINVAL;
 	}
 
+	if (opts->raid1_read_policy != SPDK_BDEV_RAID1_READ_POLICY_QUEUE_DEPTH &&
+	    opts->raid1_read_policy != SPDK_BDEV_RAID1_READ_POLICY_LATENCY) {
+		return -EINVAL;
+	}
+
 	g_opts = *opts;
 
 	return 0;
@@ -175,6 +200,7 @@ static void	raid_bdev_examine(struct spdk_bdev *bdev);
 static int	raid_bdev_init(void);
 static void	raid_bdev_deconfigure(struct raid_bdev *raid_bdev,
 				      raid_bdev_action_cb cb_fn, void *cb_arg);
+static int	raid_bdev_start_resync(struct raid_bdev *raid_bdev);
 
 static void
 raid_bdev_ch_process_cleanup(struct raid_bdev_io_channel *raid_ch)
@@ -200,12 +226,14 @@ raid_bdev_ch_process_setup(struct raid_bdev_io_channel *raid_ch, struct raid_bde
 	struct raid_bdev_io_channel *raid_ch_processed;
 	struct raid_base_bdev_info *base_info;
 
-	raid_ch->process.offset = process->window_offset;
+	if (process->target == NULL) {
+		/* A process without a target, like resync, doesn't change the set of base bdevs
+		 * the I/O is submitted to, so the channel doesn't need to split the I/O. */
+		raid_ch->process.offset = RAID_OFFSET_BLOCKS_INVALID;
+		return 0;
+	}
 
-	/* In the future we may have other types of processes which don't use a target bdev,
-	 * like data scrubbing or strip size migration. Until then, expect that there always is
-	 * a process target. */
-	assert(process->target != NULL);
+	raid_ch->process.offset = process->window_offset;
 
 	raid_ch->process.target_ch = spdk_bdev_get_io_channel(process->target->desc);
 	if (raid_ch->process.target_ch == NULL) {
@@ -236,6 +264,7 @@ raid_bdev_ch_process_setup(struct raid_bdev_io_channel *raid_ch, struct raid_bde
 
 	raid_ch_processed->module_channel = raid_ch->module_channel;
 	raid_ch_processed->process.offset = RAID_OFFSET_BLOCKS_INVALID;
+	raid_ch_processed->wib = raid_ch->wib;
 
 	return 0;
 err:
@@ -243,6 +272,33 @@ err:
 	return -ENOMEM;
 }
 
+static void
+raid_bdev_ch_wib_cleanup(struct raid_bdev_io_channel *raid_ch)
+{
+	spdk_bit_array_free(&raid_ch->wib.dirty);
+	spdk_bit_array_free(&raid_ch->wib.touched);
+	free(raid_ch->wib.writes_outstanding);
+	raid_ch->wib.writes_outstanding = NULL;
+}
+
+static int
+raid_bdev_ch_wib_setup(struct raid_bdev_io_channel *raid_ch, struct raid_bdev_wib *wib)
+{
+	raid_ch->wib.region_shift = wib->region_shift;
+	raid_ch->wib.num_regions = wib->num_regions;
+	raid_ch->wib.dirty = spdk_bit_array_create(wib->num_regions);
+	raid_ch->wib.touched = spdk_bit_array_create(wib->num_regions);
+	raid_ch->wib.writes_outstanding = calloc(wib->num_regions,
+					  sizeof(*raid_ch->wib.writes_outstanding));
+	if (raid_ch->wib.dirty == NULL || raid_ch->wib.touched == NULL ||
+	    raid_ch->wib.writes_outstanding == NULL) {
+		raid_bdev_ch_wib_cleanup(raid_ch);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 /*
  * brief:
  * raid_bdev_create_cb function is a cb function for raid bdev which creates the
@@ -300,6 +356,14 @@ raid_bdev_create_cb(void *io_device, void *ctx_buf)
 		}
 	}
 
+	if (raid_bdev->wib != NULL) {
+		ret = raid_bdev_ch_wib_setup(raid_ch, raid_bdev->wib);
+		if (ret != 0) {
+			SPDK_ERRLOG("Unable to allocate write-intent bitmap channel data\n");
+			goto err;
+		}
+	}
+
 	if (raid_bdev->process != NULL) {
 		ret = raid_bdev_ch_process_setup(raid_ch, raid_bdev->process);
 		if (ret != 0) {
@@ -320,6 +384,7 @@ err:
 	free(raid_ch->base_channel);
 
 	raid_bdev_ch_process_cleanup(raid_ch);
+	raid_bdev_ch_wib_cleanup(raid_ch);
 
 	return ret;
 }
@@ -360,6 +425,376 @@ raid_bdev_destroy_cb(void *io_device, void *ctx_buf)
 	raid_ch->base_channel = NULL;
 
 	raid_bdev_ch_process_cleanup(raid_ch);
+	raid_bdev_ch_wib_cleanup(raid_ch);
+}
+
+static void raid_bdev_submit_rw_request(struct raid_bdev_io *raid_io);
+static void raid_bdev_submit_null_payload_request(struct raid_bdev_io *raid_io);
+
+static inline uint32_t
+raid_bdev_wib_region(uint64_t offset_blocks, uint8_t region_shift, uint32_t num_regions)
+{
+	/* The last region also covers the remainder of the raid bdev */
+	return spdk_min(offset_blocks >> region_shift, num_regions - 1);
+}
+
+static void
+raid_bdev_wib_free(struct raid_bdev_wib *wib)
+{
+	assert(TAILQ_EMPTY(&wib->queued));
+	assert(TAILQ_EMPTY(&wib->writing));
+
+	spdk_poller_unregister(&wib->sweep_poller);
+	spdk_bit_array_free(&wib->regions);
+	spdk_bit_array_free(&wib->regions_written);
+	spdk_bit_array_free(&wib->sweep_regions);
+	spdk_bit_array_free(&wib->sweep_regions_marked);
+	spdk_dma_free(wib->buf);
+	free(wib);
+}
+
+static int
+raid_bdev_wib_alloc(struct raid_bdev *raid_bdev, uint8_t region_shift)
+{
+	struct raid_bdev_wib *wib;
+	uint64_t num_regions;
+
+	assert(raid_bdev->wib == NULL);
+
+	if (region_shift >= 64) {
+		return -EINVAL;
+	}
+
+	num_regions = spdk_divide_round_up(raid_bdev->bdev.blockcnt, 1ULL << region_shift);
+	if (num_regions == 0 || num_regions > RAID_BDEV_WIB_MAX_REGIONS) {
+		return -EINVAL;
+	}
+
+	wib = calloc(1, sizeof(*wib));
+	if (wib == NULL) {
+		return -ENOMEM;
+	}
+
+	wib->region_shift = region_shift;
+	wib->num_regions = num_regions;
+	wib->buf_size = SPDK_ALIGN_CEIL(spdk_divide_round_up(num_regions, 8), raid_bdev->bdev.blocklen);
+	TAILQ_INIT(&wib->queued);
+	TAILQ_INIT(&wib->writing);
+
+	wib->buf = spdk_dma_zmalloc(wib->buf_size, 0x1000, NULL);
+	wib->regions = spdk_bit_array_create(num_regions);
+	wib->regions_written = spdk_bit_array_create(num_regions);
+	wib->sweep_regions = spdk_bit_array_create(num_regions);
+	wib->sweep_regions_marked = spdk_bit_array_create(num_regions);
+	if (wib->buf == NULL || wib->regions == NULL || wib->regions_written == NULL ||
+	    wib->sweep_regions == NULL || wib->sweep_regions_marked == NULL) {
+		raid_bdev_wib_free(wib);
+		return -ENOMEM;
+	}
+
+	raid_bdev->wib = wib;
+
+	return 0;
+}
+
+static void
+raid_bdev_wib_destroy(struct raid_bdev *raid_bdev)
+{
+	if (raid_bdev->wib != NULL) {
+		raid_bdev_wib_free(raid_bdev->wib);
+		raid_bdev->wib = NULL;
+	}
+}
+
+static void raid_bdev_wib_write(struct raid_bdev *raid_bdev);
+
+static void
+raid_bdev_wib_try_stop(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	raid_bdev_action_cb cb = wib->stop_cb;
+	void *cb_ctx = wib->stop_cb_ctx;
+
+	if (cb == NULL || wib->write_in_progress || wib->sweep_in_progress) {
+		return;
+	}
+
+	/*
+	 * There are no writes in flight when the raid bdev is stopped so the bitmap can be
+	 * cleared, unless there are regions that still need to be resynchronized.
+	 */
+	if (!wib->resync_needed && spdk_bit_array_count_set(wib->regions_written) > 0) {
+		spdk_bit_array_clear_mask(wib->regions);
+		raid_bdev_wib_write(raid_bdev);
+		return;
+	}
+
+	raid_bdev_wib_destroy(raid_bdev);
+
+	cb(cb_ctx, 0);
+}
+
+static void
+raid_bdev_wib_stop(struct raid_bdev *raid_bdev, raid_bdev_action_cb cb, void *cb_ctx)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+
+	if (wib == NULL) {
+		cb(cb_ctx, 0);
+		return;
+	}
+
+	assert(wib->stop_cb == NULL);
+	spdk_poller_unregister(&wib->sweep_poller);
+	wib->stop_cb = cb;
+	wib->stop_cb_ctx = cb_ctx;
+
+	raid_bdev_wib_try_stop(raid_bdev);
+}
+
+static void
+raid_bdev_wib_submit(struct raid_bdev_io *raid_io)
+{
+	if (raid_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		raid_bdev_submit_rw_request(raid_io);
+	} else {
+		raid_bdev_submit_null_payload_request(raid_io);
+	}
+}
+
+static void
+raid_bdev_wib_mark_done(void *ctx)
+{
+	struct raid_bdev_io *raid_io = ctx;
+	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+	uint64_t offset_end = raid_io->offset_blocks + raid_io->num_blocks - 1;
+	uint32_t region, last;
+
+	region = raid_bdev_wib_region(raid_io->offset_blocks, raid_ch->wib.region_shift,
+				      raid_ch->wib.num_regions);
+	last = raid_bdev_wib_region(offset_end, raid_ch->wib.region_shift, raid_ch->wib.num_regions);
+	for (; region <= last; region++) {
+		spdk_bit_array_set(raid_ch->wib.dirty, region);
+	}
+
+	raid_bdev_wib_submit(raid_io);
+}
+
+static void
+raid_bdev_wib_mark_reply(struct raid_bdev_io *raid_io)
+{
+	struct spdk_io_channel *ch = spdk_io_channel_from_ctx(raid_io->raid_ch);
+
+	spdk_thread_send_msg(spdk_io_channel_get_thread(ch), raid_bdev_wib_mark_done, raid_io);
+}
+
+static void
+raid_bdev_wib_write_done(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	struct raid_bdev_io *raid_io;
+
+	assert(wib->write_in_progress);
+	wib->write_in_progress = false;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to write raid bdev '%s' write-intent bitmap: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+	}
+
+	while ((raid_io = TAILQ_FIRST(&wib->writing)) != NULL) {
+		TAILQ_REMOVE(&wib->writing, raid_io, wib_link);
+		raid_bdev_wib_mark_reply(raid_io);
+	}
+
+	if (wib->write_pending) {
+		wib->write_pending = false;
+		raid_bdev_wib_write(raid_bdev);
+	} else {
+		raid_bdev_wib_try_stop(raid_bdev);
+	}
+}
+
+static void
+raid_bdev_wib_write(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+
+	if (wib->write_in_progress) {
+		wib->write_pending = true;
+		return;
+	}
+
+	memset(wib->buf, 0, wib->buf_size);
+	spdk_bit_array_store_mask(wib->regions, wib->buf);
+	spdk_bit_array_load_mask(wib->regions_written, wib->buf);
+	TAILQ_CONCAT(&wib->writing, &wib->queued, wib_link);
+	wib->write_in_progress = true;
+
+	raid_bdev_write_wib(raid_bdev, wib->buf, wib->buf_size, raid_bdev_wib_write_done, NULL);
+}
+
+static void
+raid_bdev_wib_mark(void *ctx)
+{
+	struct raid_bdev_io *raid_io = ctx;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	uint64_t offset_end = raid_io->offset_blocks + raid_io->num_blocks - 1;
+	uint32_t region, last;
+	bool written = true;
+
+	assert(wib != NULL);
+
+	region = raid_bdev_wib_region(raid_io->offset_blocks, wib->region_shift, wib->num_regions);
+	last = raid_bdev_wib_region(offset_end, wib->region_shift, wib->num_regions);
+	for (; region <= last; region++) {
+		spdk_bit_array_set(wib->regions, region);
+		if (wib->sweep_in_progress) {
+			spdk_bit_array_set(wib->sweep_regions_marked, region);
+		}
+		if (!spdk_bit_array_get(wib->regions_written, region)) {
+			written = false;
+		}
+	}
+
+	if (written) {
+		if (wib->write_in_progress) {
+			TAILQ_INSERT_TAIL(&wib->writing, raid_io, wib_link);
+		} else {
+			raid_bdev_wib_mark_reply(raid_io);
+		}
+	} else {
+		TAILQ_INSERT_TAIL(&wib->queued, raid_io, wib_link);
+		raid_bdev_wib_write(raid_bdev);
+	}
+}
+
+/*
+ * Account a write in the write-intent bitmap. Returns true if the regions it covers are
+ * already marked on disk and the write can be submitted right away. Otherwise, the app
+ * thread marks them and the write is submitted when the bitmap is persisted.
+ */
+static bool
+raid_bdev_wib_start_write(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+	uint64_t offset_end = raid_io->offset_blocks + raid_io->num_blocks - 1;
+	uint32_t region, last;
+	bool marked = true;
+
+	if (raid_io->num_blocks == 0) {
+		return true;
+	}
+
+	region = raid_bdev_wib_region(raid_io->offset_blocks, raid_ch->wib.region_shift,
+				      raid_ch->wib.num_regions);
+	last = raid_bdev_wib_region(offset_end, raid_ch->wib.region_shift, raid_ch->wib.num_regions);
+	for (; region <= last; region++) {
+		raid_ch->wib.writes_outstanding[region]++;
+		spdk_bit_array_set(raid_ch->wib.touched, region);
+		if (!spdk_bit_array_get(raid_ch->wib.dirty, region)) {
+			marked = false;
+		}
+	}
+
+	if (!marked) {
+		spdk_thread_send_msg(spdk_thread_get_app_thread(), raid_bdev_wib_mark, raid_io);
+	}
+
+	return marked;
+}
+
+static void
+raid_bdev_wib_complete_write(struct raid_bdev_io_channel *raid_ch, uint64_t offset_blocks,
+			     uint64_t num_blocks)
+{
+	uint32_t region, last;
+
+	if (num_blocks == 0) {
+		return;
+	}
+
+	region = raid_bdev_wib_region(offset_blocks, raid_ch->wib.region_shift, raid_ch->wib.num_regions);
+	last = raid_bdev_wib_region(offset_blocks + num_blocks - 1, raid_ch->wib.region_shift,
+				    raid_ch->wib.num_regions);
+	for (; region <= last; region++) {
+		assert(raid_ch->wib.writes_outstanding[region] > 0);
+		raid_ch->wib.writes_outstanding[region]--;
+	}
+}
+
+static void
+raid_bdev_wib_sweep_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct raid_bdev *raid_bdev = spdk_io_channel_iter_get_ctx(i);
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	uint32_t region;
+
+	/* Clear the regions that weren't written to on any channel since the previous sweep */
+	for (region = spdk_bit_array_find_first_set(wib->sweep_regions, 0);
+	     region != UINT32_MAX;
+	     region = spdk_bit_array_find_first_set(wib->sweep_regions, region + 1)) {
+		if (!spdk_bit_array_get(wib->sweep_regions_marked, region)) {
+			spdk_bit_array_clear(wib->regions, region);
+		}
+	}
+	spdk_bit_array_clear_mask(wib->sweep_regions_marked);
+	wib->sweep_in_progress = false;
+
+	raid_bdev_wib_write(raid_bdev);
+}
+
+static void
+raid_bdev_channel_wib_sweep(struct spdk_io_channel_iter *i)
+{
+	struct raid_bdev *raid_bdev = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	uint32_t region;
+
+	for (region = spdk_bit_array_find_first_set(wib->sweep_regions, 0);
+	     region != UINT32_MAX;
+	     region = spdk_bit_array_find_first_set(wib->sweep_regions, region + 1)) {
+		if (raid_ch->wib.writes_outstanding[region] > 0 ||
+		    spdk_bit_array_get(raid_ch->wib.touched, region)) {
+			spdk_bit_array_clear(wib->sweep_regions, region);
+		} else {
+			spdk_bit_array_clear(raid_ch->wib.dirty, region);
+		}
+	}
+	spdk_bit_array_clear_mask(raid_ch->wib.touched);
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static int
+raid_bdev_wib_sweep(void *ctx)
+{
+	struct raid_bdev *raid_bdev = ctx;
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	uint32_t region;
+
+	if (wib->sweep_in_progress || wib->resync_needed || wib->stop_cb != NULL ||
+	    spdk_bit_array_count_set(wib->regions) == 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	spdk_bit_array_clear_mask(wib->sweep_regions);
+	for (region = spdk_bit_array_find_first_set(wib->regions, 0);
+	     region != UINT32_MAX;
+	     region = spdk_bit_array_find_first_set(wib->regions, region + 1)) {
+		spdk_bit_array_set(wib->sweep_regions, region);
+	}
+	wib->sweep_in_progress = true;
+
+	spdk_for_each_channel(raid_bdev, raid_bdev_channel_wib_sweep, raid_bdev,
+			      raid_bdev_wib_sweep_done);
+
+	return SPDK_POLLER_BUSY;
 }
 
 /*
@@ -392,6 +827,7 @@ raid_bdev_cleanup(struct raid_bdev *raid_bdev)
 static void
 raid_bdev_free(struct raid_bdev *raid_bdev)
 {
+	raid_bdev_wib_destroy(raid_bdev);
 	raid_bdev_free_superblock(raid_bdev);
 	free(raid_bdev->base_bdev_info);
 	free(raid_bdev->bdev.name);
@@ -483,15 +919,11 @@ raid_bdev_module_stop_done(struct raid_bdev *raid_bdev)
 }
 
 static void
-_raid_bdev_destruct(void *ctxt)
+raid_bdev_destruct_cont(void *ctxt, int status)
 {
 	struct raid_bdev *raid_bdev = ctxt;
 	struct raid_base_bdev_info *base_info;
 
-	SPDK_DEBUGLOG(bdev_raid, "raid_bdev_destruct\n");
-
-	assert(raid_bdev->process == NULL);
-
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		/*
 		 * Close all base bdev descriptors for which call has come from below
@@ -515,6 +947,19 @@ _raid_bdev_destruct(void *ctxt)
 	raid_bdev_module_stop_done(raid_bdev);
 }
 
+static void
+_raid_bdev_destruct(void *ctxt)
+{
+	struct raid_bdev *raid_bdev = ctxt;
+
+	SPDK_DEBUGLOG(bdev_raid, "raid_bdev_destruct\n");
+
+	assert(raid_bdev->process == NULL);
+
+	/* Flush the write-intent bitmap while the base bdevs are still open */
+	raid_bdev_wib_stop(raid_bdev, raid_bdev_destruct_cont, raid_bdev);
+}
+
 static int
 raid_bdev_destruct(void *ctx)
 {
@@ -677,6 +1122,12 @@ raid_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status sta
 				status = SPDK_BDEV_IO_STATUS_FAILED;
 			}
 		}
+		if (raid_io->raid_ch->wib.writes_outstanding != NULL &&
+		    (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE ||
+		     bdev_io->type == SPDK_BDEV_IO_TYPE_UNMAP)) {
+			raid_bdev_wib_complete_write(raid_io->raid_ch, bdev_io->u.bdev.offset_blocks,
+						     bdev_io->u.bdev.num_blocks);
+		}
 		spdk_bdev_io_complete(bdev_io, status);
 	}
 }
@@ -981,7 +1432,13 @@ raid_bdev_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		raid_bdev_submit_rw_request(raid_io);
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		if (raid_io->raid_ch->wib.writes_outstanding != NULL &&
+		    !raid_bdev_wib_start_write(raid_io)) {
+			/* Submitted after the write-intent bitmap is updated */
+			break;
+		}
+		raid_bdev_wib_submit(raid_io);
 		break;
 
 	case SPDK_BDEV_IO_TYPE_RESET:
@@ -989,10 +1446,13 @@ raid_bdev_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_i
 		break;
 
 	case SPDK_BDEV_IO_TYPE_FLUSH:
-	case SPDK_BDEV_IO_TYPE_UNMAP:
 		raid_bdev_submit_null_payload_request(raid_io);
 		break;
 
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
+		raid_io->raid_bdev->module->submit_zcopy_request(raid_io);
+		break;
+
 	default:
 		SPDK_ERRLOG("submit request, invalid io type %u\n", bdev_io->type);
 		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
@@ -1025,6 +1485,15 @@ _raid_bdev_io_type_supported(struct raid_bdev *raid_bdev, enum spdk_bdev_io_type
 		}
 	}
 
+	if (io_type == SPDK_BDEV_IO_TYPE_ZCOPY) {
+		/* The base bdevs' buffers are handed out as is, without remapping the metadata */
+		if (raid_bdev->module->submit_zcopy_request == NULL ||
+		    raid_bdev->bdev.dif_type != SPDK_DIF_DISABLE ||
+		    spdk_bdev_is_md_separate(&raid_bdev->bdev)) {
+			return false;
+		}
+	}
+
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		if (base_info->desc == NULL) {
 			continue;
@@ -1061,6 +1530,7 @@ raid_bdev_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 	case SPDK_BDEV_IO_TYPE_FLUSH:
 	case SPDK_BDEV_IO_TYPE_RESET:
 	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_ZCOPY:
 		return _raid_bdev_io_type_supported(ctx, io_type);
 
 	default:
@@ -1100,6 +1570,7 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 	spdk_json_write_named_string(w, "state", raid_bdev_state_to_str(raid_bdev->state));
 	spdk_json_write_named_string(w, "raid_level", raid_bdev_level_to_str(raid_bdev->level));
 	spdk_json_write_named_bool(w, "superblock", raid_bdev->superblock_enabled);
+	spdk_json_write_named_bool(w, "write_intent_bitmap", raid_bdev->wib != NULL);
 	spdk_json_write_named_uint32(w, "num_base_bdevs", raid_bdev->num_base_bdevs);
 	spdk_json_write_named_uint32(w, "num_base_bdevs_discovered", raid_bdev->num_base_bdevs_discovered);
 	spdk_json_write_named_uint32(w, "num_base_bdevs_operational",
@@ -1111,7 +1582,9 @@ raid_bdev_write_info_json(struct raid_bdev *raid_bdev, struct spdk_json_write_ct
 		spdk_json_write_named_object_begin(w, "process");
 		spdk_json_write_name(w, "type");
 		spdk_json_write_string(w, raid_bdev_process_to_str(process->type));
-		spdk_json_write_named_string(w, "target", process->target->name);
+		if (process->target != NULL) {
+			spdk_json_write_named_string(w, "target", process->target->name);
+		}
 		spdk_json_write_named_object_begin(w, "progress");
 		spdk_json_write_named_uint64(w, "blocks", offset);
 		spdk_json_write_named_uint32(w, "percent", offset * 100.0 / raid_bdev->bdev.blockcnt);
@@ -1327,6 +1800,8 @@ static struct {
 	{ "1", SPDK_BDEV_RAID_LEVEL_RAID1 },
 	{ "raid5f", SPDK_BDEV_RAID_LEVEL_RAID5F },
 	{ "5f", SPDK_BDEV_RAID_LEVEL_RAID5F },
+	{ "raid6", SPDK_BDEV_RAID_LEVEL_RAID6 },
+	{ "6", SPDK_BDEV_RAID_LEVEL_RAID6 },
 	{ "concat", SPDK_BDEV_RAID_LEVEL_CONCAT },
 	{ }
 };
@@ -1341,6 +1816,7 @@ const char *g_raid_state_names[] = {
 static const char *g_raid_process_type_names[] = {
 	[RAID_PROCESS_NONE]	= "none",
 	[RAID_PROCESS_REBUILD]	= "rebuild",
+	[RAID_PROCESS_RESYNC]	= "resync",
 	[RAID_PROCESS_MAX]	= NULL
 };
 
@@ -1458,6 +1934,12 @@ raid_bdev_opts_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "process_window_size_kb", g_opts.process_window_size_kb);
 	spdk_json_write_named_uint32(w, "process_max_bandwidth_mb_sec",
 				     g_opts.process_max_bandwidth_mb_sec);
+	if (g_opts.raid1_read_policy == SPDK_BDEV_RAID1_READ_POLICY_LATENCY) {
+		spdk_json_write_named_string(w, "raid1_read_policy", "latency");
+	} else {
+		spdk_json_write_named_string(w, "raid1_read_policy", "queue_depth");
+	}
+	spdk_json_write_named_bool(w, "write_intent_bitmap", g_opts.write_intent_bitmap);
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -1880,6 +2362,7 @@ raid_bdev_configure_cont(struct raid_bdev *raid_bdev)
 		if (raid_bdev->module->stop != NULL) {
 			raid_bdev->module->stop(raid_bdev);
 		}
+		raid_bdev_wib_destroy(raid_bdev);
 		raid_bdev->configure_cb_status = rc;
 		spdk_io_device_unregister(raid_bdev, raid_bdev_configure_unregister_io_device_cb);
 		return;
@@ -1910,6 +2393,21 @@ raid_bdev_configure_cont(struct raid_bdev *raid_bdev)
 	SPDK_DEBUGLOG(bdev_raid, "raid bdev is created with name %s, raid_bdev %p\n",
 		      raid_bdev_gen->name, raid_bdev);
 
+	if (raid_bdev->wib != NULL) {
+		raid_bdev->wib->sweep_poller = SPDK_POLLER_REGISTER(raid_bdev_wib_sweep, raid_bdev,
+					       RAID_BDEV_WIB_SWEEP_PERIOD_US);
+
+		if (raid_bdev->wib->resync_needed &&
+		    raid_bdev->num_base_bdevs_discovered == raid_bdev->num_base_bdevs) {
+			int ret = raid_bdev_start_resync(raid_bdev);
+
+			if (ret != 0) {
+				SPDK_ERRLOG("Failed to start resync on raid bdev '%s': %s\n",
+					    raid_bdev_gen->name, spdk_strerror(-ret));
+			}
+		}
+	}
+
 	raid_bdev_configure_done(raid_bdev, rc);
 }
 
@@ -1924,8 +2422,71 @@ raid_bdev_configure_write_sb_cb(int status, struct raid_bdev *raid_bdev, void *c
 		if (raid_bdev->module->stop != NULL) {
 			raid_bdev->module->stop(raid_bdev);
 		}
+		raid_bdev_wib_destroy(raid_bdev);
+		raid_bdev_configure_done(raid_bdev, status);
+	}
+}
+
+static void
+raid_bdev_configure_wib_cb(int status, struct raid_bdev *raid_bdev, void *ctx)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to set up raid bdev '%s' write-intent bitmap: %s\n",
+			    raid_bdev->bdev.name, spdk_strerror(-status));
+		if (raid_bdev->module->stop != NULL) {
+			raid_bdev->module->stop(raid_bdev);
+		}
+		raid_bdev_wib_destroy(raid_bdev);
 		raid_bdev_configure_done(raid_bdev, status);
+		return;
+	}
+
+	spdk_bit_array_load_mask(wib->regions, wib->buf);
+	spdk_bit_array_load_mask(wib->regions_written, wib->buf);
+
+	if (spdk_bit_array_count_set(wib->regions) > 0) {
+		SPDK_NOTICELOG("raid bdev '%s' was not stopped cleanly, %u regions need to be resynchronized\n",
+			       raid_bdev->bdev.name, spdk_bit_array_count_set(wib->regions));
+		wib->resync_needed = true;
 	}
+
+	raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+}
+
+static uint8_t
+raid_bdev_wib_default_region_shift(struct raid_bdev *raid_bdev)
+{
+	uint64_t region_blocks;
+
+	region_blocks = spdk_max(RAID_BDEV_WIB_MIN_REGION_SIZE / raid_bdev->bdev.blocklen,
+				 spdk_divide_round_up(raid_bdev->bdev.blockcnt, RAID_BDEV_WIB_MAX_REGIONS));
+
+	return spdk_u64log2(spdk_align64pow2(region_blocks));
+}
+
+static bool
+raid_bdev_wib_supported(struct raid_bdev *raid_bdev)
+{
+	struct raid_base_bdev_info *base_info;
+	uint64_t wib_end;
+
+	if (!raid_bdev->module->resync_supported || raid_bdev->bdev.md_len != 0) {
+		return false;
+	}
+
+	wib_end = RAID_BDEV_WIB_OFFSET_SIZE +
+		  SPDK_ALIGN_CEIL(RAID_BDEV_WIB_MAX_REGIONS / 8, raid_bdev->bdev.blocklen);
+
+	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+		if (base_info->desc != NULL &&
+		    base_info->data_offset * raid_bdev->bdev.blocklen < wib_end) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 /*
@@ -1970,8 +2531,14 @@ raid_bdev_configure(struct raid_bdev *raid_bdev, raid_bdev_action_cb cb, void *c
 	raid_bdev->configure_cb_ctx = cb_ctx;
 
 	if (raid_bdev->superblock_enabled) {
+		bool wib_new = false;
+
 		if (raid_bdev->sb == NULL) {
 			rc = raid_bdev_alloc_superblock(raid_bdev, data_block_size);
+			if (rc == 0 && g_opts.write_intent_bitmap && raid_bdev_wib_supported(raid_bdev)) {
+				rc = raid_bdev_wib_alloc(raid_bdev, raid_bdev_wib_default_region_shift(raid_bdev));
+				wib_new = true;
+			}
 			if (rc == 0) {
 				raid_bdev_init_superblock(raid_bdev);
 			}
@@ -1985,6 +2552,15 @@ raid_bdev_configure(struct raid_bdev *raid_bdev, raid_bdev_action_cb cb, void *c
 				SPDK_ERRLOG("blockcnt does not match value in superblock\n");
 				rc = -EINVAL;
 			}
+			if (rc == 0 && raid_bdev->sb->flags & RAID_BDEV_SB_FLAG_WRITE_INTENT_BITMAP) {
+				if (raid_bdev_wib_supported(raid_bdev)) {
+					rc = raid_bdev_wib_alloc(raid_bdev, raid_bdev->sb->wib_region_shift);
+				} else {
+					SPDK_WARNLOG("Write-intent bitmap is not supported on raid bdev '%s', disabling it\n",
+						     raid_bdev->bdev.name);
+					raid_bdev->sb->flags &= ~RAID_BDEV_SB_FLAG_WRITE_INTENT_BITMAP;
+				}
+			}
 		}
 
 		if (rc != 0) {
@@ -1992,10 +2568,20 @@ raid_bdev_configure(struct raid_bdev *raid_bdev, raid_bdev_action_cb cb, void *c
 			if (raid_bdev->module->stop != NULL) {
 				raid_bdev->module->stop(raid_bdev);
 			}
+			raid_bdev_wib_destroy(raid_bdev);
 			return rc;
 		}
 
-		raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+		if (raid_bdev->wib == NULL) {
+			raid_bdev_write_superblock(raid_bdev, raid_bdev_configure_write_sb_cb, NULL);
+		} else if (wib_new) {
+			/* Write a clean bitmap before the superblock that references it */
+			raid_bdev_write_wib(raid_bdev, raid_bdev->wib->buf, raid_bdev->wib->buf_size,
+					    raid_bdev_configure_wib_cb, NULL);
+		} else {
+			raid_bdev_load_wib(raid_bdev, raid_bdev->wib->buf, raid_bdev->wib->buf_size,
+					   raid_bdev_configure_wib_cb, NULL);
+		}
 	} else {
 		raid_bdev_configure_cont(raid_bdev);
 	}
@@ -2260,7 +2846,7 @@ _raid_bdev_process_base_bdev_remove(void *_ctx)
 	struct raid_bdev_process *process = ctx->process;
 	int ret;
 
-	if (ctx->base_info != process->target &&
+	if (process->target != NULL && ctx->base_info != process->target &&
 	    ctx->num_base_bdevs_operational > process->raid_bdev->min_base_bdevs_operational) {
 		/* process doesn't need to be stopped */
 		raid_bdev_process_base_bdev_remove_cont(ctx);
@@ -2699,12 +3285,17 @@ static void
 raid_bdev_process_finish_unquiesced(void *ctx, int status)
 {
 	struct raid_bdev_process *process = ctx;
+	struct raid_bdev *raid_bdev = process->raid_bdev;
 
 	if (status != 0) {
 		SPDK_ERRLOG("Failed to unquiesce bdev: %s\n", spdk_strerror(-status));
 	}
 
 	if (process->status != 0) {
+		if (process->target == NULL) {
+			spdk_thread_send_msg(process->thread, _raid_bdev_process_finish_done, process);
+			return;
+		}
 		status = _raid_bdev_remove_base_bdev(process->target, raid_bdev_process_finish_target_removed,
 						     process);
 		if (status != 0) {
@@ -2713,6 +3304,20 @@ raid_bdev_process_finish_unquiesced(void *ctx, int status)
 		return;
 	}
 
+	if (raid_bdev->wib != NULL) {
+		if (process->type == RAID_PROCESS_RESYNC) {
+			raid_bdev->wib->resync_needed = false;
+		} else if (raid_bdev->wib->resync_needed &&
+			   raid_bdev->num_base_bdevs_discovered == raid_bdev->num_base_bdevs) {
+			/* Regions written before an unclean stop still need to be resynchronized */
+			status = raid_bdev_start_resync(raid_bdev);
+			if (status != 0) {
+				SPDK_ERRLOG("Failed to start resync on raid bdev '%s': %s\n",
+					    raid_bdev->bdev.name, spdk_strerror(-status));
+			}
+		}
+	}
+
 	spdk_thread_send_msg(process->thread, _raid_bdev_process_finish_done, process);
 }
 
@@ -2745,7 +3350,7 @@ raid_bdev_process_finish_done(void *ctx)
 		SPDK_NOTICELOG("Finished %s on raid bdev %s\n",
 			       raid_bdev_process_to_str(process->type),
 			       raid_bdev->bdev.name);
-		if (raid_bdev->superblock_enabled) {
+		if (raid_bdev->superblock_enabled && process->target != NULL) {
 			spdk_thread_send_msg(spdk_thread_get_app_thread(),
 					     raid_bdev_process_finish_write_sb,
 					     raid_bdev);
@@ -2776,7 +3381,7 @@ raid_bdev_channel_process_finish(struct spdk_io_channel_iter *i)
 	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
 	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
 
-	if (process->status == 0) {
+	if (process->status == 0 && process->target != NULL) {
 		uint8_t slot = raid_bdev_base_bdev_slot(process->target);
 
 		raid_ch->base_channel[slot] = raid_ch->process.target_ch;
@@ -2800,7 +3405,9 @@ raid_bdev_process_finish_quiesced(void *ctx, int status)
 	}
 
 	raid_bdev->process = NULL;
-	process->target->is_process_target = false;
+	if (process->target != NULL) {
+		process->target->is_process_target = false;
+	}
 
 	spdk_for_each_channel(process->raid_bdev, raid_bdev_channel_process_finish, process,
 			      __raid_bdev_process_finish);
@@ -2898,7 +3505,9 @@ raid_bdev_process_channel_update(struct spdk_io_channel_iter *i)
 	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
 	struct raid_bdev_io_channel *raid_ch = spdk_io_channel_get_ctx(ch);
 
-	raid_ch->process.offset = process->window_offset + process->window_size;
+	if (process->target != NULL) {
+		raid_ch->process.offset = process->window_offset + process->window_size;
+	}
 
 	spdk_for_each_channel_continue(i, 0);
 }
@@ -3065,6 +3674,26 @@ raid_bdev_process_continue_poll(void *arg)
 	return SPDK_POLLER_IDLE;
 }
 
+/* Advance the process window to the next region that needs to be resynchronized */
+static void
+raid_bdev_process_skip_clean_regions(struct raid_bdev_process *process)
+{
+	struct raid_bdev *raid_bdev = process->raid_bdev;
+	uint64_t align = spdk_max(raid_bdev->bdev.write_unit_size, 1);
+	uint64_t offset;
+	uint32_t region;
+
+	region = spdk_bit_array_find_first_set(process->resync_regions,
+					       process->window_offset >> process->resync_region_shift);
+	if (region == UINT32_MAX) {
+		process->window_offset = raid_bdev->bdev.blockcnt;
+		return;
+	}
+
+	offset = ((uint64_t)region << process->resync_region_shift) / align * align;
+	process->window_offset = spdk_max(process->window_offset, offset);
+}
+
 static void
 raid_bdev_process_thread_run(struct raid_bdev_process *process)
 {
@@ -3079,6 +3708,10 @@ raid_bdev_process_thread_run(struct raid_bdev_process *process)
 		return;
 	}
 
+	if (process->resync_regions != NULL) {
+		raid_bdev_process_skip_clean_regions(process);
+	}
+
 	if (process->window_offset == raid_bdev->bdev.blockcnt) {
 		SPDK_DEBUGLOG(bdev_raid, "process completed on %s\n", raid_bdev->bdev.name);
 		raid_bdev_process_finish(process, 0);
@@ -3126,7 +3759,9 @@ raid_bdev_channels_abort_start_process_done(struct spdk_io_channel_iter *i, int
 {
 	struct raid_bdev_process *process = spdk_io_channel_iter_get_ctx(i);
 
-	_raid_bdev_remove_base_bdev(process->target, NULL, NULL);
+	if (process->target != NULL) {
+		_raid_bdev_remove_base_bdev(process->target, NULL, NULL);
+	}
 	raid_bdev_process_free(process);
 
 	/* TODO: update sb */
@@ -3151,9 +3786,19 @@ raid_bdev_channels_start_process_done(struct spdk_io_channel_iter *i, int status
 	struct spdk_thread *thread;
 	char thread_name[RAID_BDEV_SB_NAME_SIZE + 16];
 
-	if (status == 0 &&
-	    (process->target->remove_scheduled || !process->target->is_configured ||
-	     raid_bdev->num_base_bdevs_operational <= raid_bdev->min_base_bdevs_operational)) {
+	if (status == 0 && process->target == NULL) {
+		struct raid_base_bdev_info *base_info;
+
+		/* a process without a target needs all base bdevs */
+		RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
+			if (base_info->remove_scheduled || !base_info->is_configured) {
+				status = -ENODEV;
+				break;
+			}
+		}
+	} else if (status == 0 &&
+		   (process->target->remove_scheduled || !process->target->is_configured ||
+		    raid_bdev->num_base_bdevs_operational <= raid_bdev->min_base_bdevs_operational)) {
 		/* a base bdev was removed before we got here */
 		status = -ENODEV;
 	}
@@ -3256,6 +3901,7 @@ raid_bdev_process_free(struct raid_bdev_process *process)
 		raid_bdev_process_request_free(process_req);
 	}
 
+	spdk_bit_array_free(&process->resync_regions);
 	free(process);
 }
 
@@ -3320,6 +3966,43 @@ raid_bdev_start_rebuild(struct raid_base_bdev_info *target)
 	return 0;
 }
 
+static int
+raid_bdev_start_resync(struct raid_bdev *raid_bdev)
+{
+	struct raid_bdev_wib *wib = raid_bdev->wib;
+	struct raid_bdev_process *process;
+	uint32_t region;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(wib != NULL);
+
+	if (raid_bdev->process != NULL) {
+		return -EBUSY;
+	}
+
+	process = raid_bdev_process_alloc(raid_bdev, RAID_PROCESS_RESYNC, NULL);
+	if (process == NULL) {
+		return -ENOMEM;
+	}
+
+	process->resync_regions = spdk_bit_array_create(wib->num_regions);
+	if (process->resync_regions == NULL) {
+		raid_bdev_process_free(process);
+		return -ENOMEM;
+	}
+	process->resync_region_shift = wib->region_shift;
+
+	for (region = spdk_bit_array_find_first_set(wib->regions, 0);
+	     region != UINT32_MAX;
+	     region = spdk_bit_array_find_first_set(wib->regions, region + 1)) {
+		spdk_bit_array_set(process->resync_regions, region);
+	}
+
+	raid_bdev_process_start(process);
+
+	return 0;
+}
+
 static void raid_bdev_configure_base_bdev_cont(struct raid_base_bdev_info *base_info);
 
 static void
@@ -16,6 +16,7 @@
 enum raid_process_type {
 	RAID_PROCESS_NONE,
 	RAID_PROCESS_REBUILD,
+	RAID_PROCESS_RESYNC,
 	RAID_PROCESS_MAX
 };
 
@@ -128,10 +129,14 @@ struct raid_bdev_io {
 		struct iovec		*iov;
 		struct iovec		iov_copy;
 	} split;
+
+	/* Link in the write-intent bitmap queue while waiting for its regions to be marked */
+	TAILQ_ENTRY(raid_bdev_io)	wib_link;
 };
 
 struct raid_bdev_process_request {
 	struct raid_bdev_process *process;
+	/* Base bdev to write to, NULL for a resync, which rewrites the redundant data */
 	struct raid_base_bdev_info *target;
 	struct spdk_io_channel *target_ch;
 	uint64_t offset_blocks;
@@ -215,6 +220,9 @@ struct raid_bdev {
 	/* Raid bdev background process, e.g. rebuild */
 	struct raid_bdev_process	*process;
 
+	/* Write-intent bitmap, NULL if not used */
+	struct raid_bdev_wib		*wib;
+
 	/* Callback and context for raid_bdev configuration */
 	raid_bdev_action_cb		configure_cb;
 	void				*configure_cb_ctx;
@@ -225,6 +233,55 @@ struct raid_bdev {
 	void				*destroy_cb_ctx;
 };
 
+/*
+ * raid_bdev_wib is the write-intent bitmap of a raid bdev. It is accessed only on the app thread,
+ * except for the regions to clear during a sweep, which are handed over to the raid bdev's
+ * channels.
+ */
+struct raid_bdev_wib {
+	/* log2 of the region size in blocks */
+	uint8_t				region_shift;
+
+	/* number of regions */
+	uint32_t			num_regions;
+
+	/* regions currently marked dirty */
+	struct spdk_bit_array		*regions;
+
+	/* regions marked dirty in the bitmap that was last written to the base bdevs */
+	struct spdk_bit_array		*regions_written;
+
+	/* regions to clear by the sweep in progress */
+	struct spdk_bit_array		*sweep_regions;
+
+	/* regions marked dirty while the sweep is in progress, these must not be cleared */
+	struct spdk_bit_array		*sweep_regions_marked;
+
+	/* on-disk bitmap buffer */
+	void				*buf;
+	uint32_t			buf_size;
+
+	bool				write_in_progress;
+	bool				write_pending;
+	bool				sweep_in_progress;
+
+	/* set if the bitmap was dirty when the raid bdev was started, until a resync completes */
+	bool				resync_needed;
+
+	/* I/Os waiting for their regions to be included in a bitmap write */
+	TAILQ_HEAD(, raid_bdev_io)	queued;
+
+	/* I/Os waiting for the bitmap write in progress to complete */
+	TAILQ_HEAD(, raid_bdev_io)	writing;
+
+	/* periodically clears the regions without outstanding writes */
+	struct spdk_poller		*sweep_poller;
+
+	/* callback for stopping the bitmap */
+	raid_bdev_action_cb		stop_cb;
+	void				*stop_cb_ctx;
+};
+
 #define RAID_FOR_EACH_BASE_BDEV(r, i) \
 	for (i = r->base_bdev_info; i < r->base_bdev_info + r->num_base_bdevs; i++)
 
@@ -280,6 +337,13 @@ struct raid_bdev_module {
 	/* Set to true if this module supports DIF/DIX */
 	bool dif_supported;
 
+	/*
+	 * Set to true if submit_process_request() supports requests without a target, which
+	 * must make the redundant data consistent with the rest of the stripe or mirror. This
+	 * is needed for the write-intent bitmap.
+	 */
+	bool resync_supported;
+
 	/*
 	 * Called when the raid is starting, right before changing the state to
 	 * online and registering the bdev. Parameters of the bdev like blockcnt
@@ -305,6 +369,13 @@ struct raid_bdev_module {
 	/* Handler for requests without payload (flush, unmap). Optional. */
 	void (*submit_null_payload_request)(struct raid_bdev_io *raid_io);
 
+	/*
+	 * Handler for zero-copy requests, called for both the start and the end of the request.
+	 * The requests are not split for raid processes, so modules with redundancy must not
+	 * set it. Optional.
+	 */
+	void (*submit_zcopy_request)(struct raid_bdev_io *raid_io);
+
 	/*
 	 * Called when the bdev's IO channel is created to get the module's private IO channel.
 	 * Optional.
@@ -437,12 +508,25 @@ raid_bdev_flush_blocks(struct raid_base_bdev_info *base_info, struct spdk_io_cha
 				      num_blocks, cb, cb_arg);
 }
 
+/**
+ * Raid bdev I/O wrapper for spdk_bdev_zcopy_start function.
+ */
+static inline int
+raid_bdev_zcopy_start(struct raid_base_bdev_info *base_info, struct spdk_io_channel *ch,
+		      uint64_t offset_blocks, uint64_t num_blocks, bool populate,
+		      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return spdk_bdev_zcopy_start(base_info->desc, ch, NULL, 0,
+				     base_info->data_offset + offset_blocks, num_blocks, populate,
+				     cb, cb_arg);
+}
+
 /*
  * Definitions related to raid bdev superblock
  */
 
 #define RAID_BDEV_SB_VERSION_MAJOR	1
-#define RAID_BDEV_SB_VERSION_MINOR	0
+#define RAID_BDEV_SB_VERSION_MINOR	1
 
 #define RAID_BDEV_SB_NAME_SIZE		64
 
@@ -504,8 +588,10 @@ struct raid_bdev_superblock {
 	uint64_t		seq_number;
 	/* number of raid base devices */
 	uint8_t			num_base_bdevs;
+	/* log2 of the write-intent bitmap region size in blocks */
+	uint8_t			wib_region_shift;
 
-	uint8_t			reserved[118];
+	uint8_t			reserved[117];
 
 	/* size of the base bdevs array */
 	uint8_t			base_bdevs_size;
@@ -519,6 +605,23 @@ SPDK_STATIC_ASSERT(sizeof(struct raid_bdev_superblock) == 256, "incorrect size")
 SPDK_STATIC_ASSERT(RAID_BDEV_SB_MAX_LENGTH < RAID_BDEV_MIN_DATA_OFFSET_SIZE,
 		   "Incorrect min data offset");
 
+/* superblock flags */
+#define RAID_BDEV_SB_FLAG_WRITE_INTENT_BITMAP	(1u << 0)
+
+/*
+ * The write-intent bitmap is stored on each base bdev at a fixed offset after the superblock.
+ * Bit N (byte N / 8, bit N % 8) is set when region N of the raid bdev may have inconsistent
+ * redundant data, e.g. because of writes interrupted by an unclean shutdown.
+ */
+#define RAID_BDEV_WIB_OFFSET_SIZE	(512 * 1024)
+#define RAID_BDEV_WIB_MAX_REGIONS	(16 * 1024)
+#define RAID_BDEV_WIB_MIN_REGION_SIZE	(64 * 1024 * 1024)
+
+SPDK_STATIC_ASSERT(RAID_BDEV_SB_MAX_LENGTH <= RAID_BDEV_WIB_OFFSET_SIZE,
+		   "Write-intent bitmap overlaps the superblock");
+SPDK_STATIC_ASSERT(RAID_BDEV_WIB_OFFSET_SIZE + RAID_BDEV_WIB_MAX_REGIONS / 8 <=
+		   RAID_BDEV_MIN_DATA_OFFSET_SIZE, "Incorrect min data offset");
+
 typedef void (*raid_bdev_write_sb_cb)(int status, struct raid_bdev *raid_bdev, void *ctx);
 typedef void (*raid_bdev_load_sb_cb)(const struct raid_bdev_superblock *sb, int status, void *ctx);
 
@@ -531,12 +634,20 @@ void raid_bdev_clear_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_
 				void *cb_ctx);
 int raid_bdev_load_base_bdev_superblock(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 					raid_bdev_load_sb_cb cb, void *cb_ctx);
+void raid_bdev_write_wib(struct raid_bdev *raid_bdev, void *buf, uint32_t buf_size,
+			 raid_bdev_write_sb_cb cb, void *cb_ctx);
+void raid_bdev_load_wib(struct raid_bdev *raid_bdev, void *buf, uint32_t buf_size,
+			raid_bdev_write_sb_cb cb, void *cb_ctx);
 
 struct spdk_raid_bdev_opts {
 	/* Size of the background process window in KiB */
 	uint32_t process_window_size_kb;
 	/* Maximum bandwidth in MiB to process per second */
 	uint32_t process_max_bandwidth_mb_sec;
+	/* Base bdev selection policy for raid1 reads */
+	enum spdk_bdev_raid1_read_policy raid1_read_policy;
+	/* Create new raid bdevs with a write-intent bitmap, if supported */
+	bool write_intent_bitmap;
 };
 
 void raid_bdev_get_opts(struct spdk_raid_bdev_opts *opts);
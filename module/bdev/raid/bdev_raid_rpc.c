@@ -355,6 +355,8 @@ rpc_bdev_raid_set_options(struct spdk_jsonrpc_request *request, const struct spd
 	raid_bdev_get_opts(&opts);
 	req.process_window_size_kb = opts.process_window_size_kb;
 	req.process_max_bandwidth_mb_sec = opts.process_max_bandwidth_mb_sec;
+	req.raid1_read_policy = (enum rpc_bdev_raid1_read_policy)opts.raid1_read_policy;
+	req.write_intent_bitmap = opts.write_intent_bitmap;
 	if (params && spdk_json_decode_object(params, rpc_bdev_raid_set_options_decoders,
 					      SPDK_COUNTOF(rpc_bdev_raid_set_options_decoders),
 					      &req)) {
@@ -364,6 +366,8 @@ rpc_bdev_raid_set_options(struct spdk_jsonrpc_request *request, const struct spd
 	}
 	opts.process_window_size_kb = req.process_window_size_kb;
 	opts.process_max_bandwidth_mb_sec = req.process_max_bandwidth_mb_sec;
+	opts.raid1_read_policy = (enum spdk_bdev_raid1_read_policy)req.raid1_read_policy;
+	opts.write_intent_bitmap = req.write_intent_bitmap;
 
 	rc = raid_bdev_set_opts(&opts);
 	if (rc) {
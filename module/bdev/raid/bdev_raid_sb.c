@@ -14,6 +14,10 @@
 
 struct raid_bdev_write_sb_ctx {
 	struct raid_bdev *raid_bdev;
+	void *buf;
+	void *md_buf;
+	uint64_t offset_blocks;
+	uint64_t num_blocks;
 	int status;
 	uint8_t submitted;
 	uint8_t remaining;
@@ -31,6 +35,17 @@ struct raid_bdev_read_sb_ctx {
 	uint32_t buf_size;
 };
 
+struct raid_bdev_load_wib_ctx {
+	struct raid_bdev *raid_bdev;
+	void *buf;
+	void *base_buf;
+	uint32_t buf_size;
+	uint8_t idx;
+	uint8_t loaded;
+	raid_bdev_write_sb_cb cb;
+	void *cb_ctx;
+};
+
 int
 raid_bdev_alloc_superblock(struct raid_bdev *raid_bdev, uint32_t block_size)
 {
@@ -84,6 +99,11 @@ raid_bdev_init_superblock(struct raid_bdev *raid_bdev)
 	sb->num_base_bdevs = sb->base_bdevs_size = raid_bdev->num_base_bdevs;
 	sb->length = sizeof(*sb) + sizeof(*sb_base_bdev) * sb->base_bdevs_size;
 
+	if (raid_bdev->wib != NULL) {
+		sb->flags |= RAID_BDEV_SB_FLAG_WRITE_INTENT_BITMAP;
+		sb->wib_region_shift = raid_bdev->wib->region_shift;
+	}
+
 	sb_base_bdev = &sb->base_bdevs[0];
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		spdk_uuid_copy(&sb_base_bdev->uuid, &base_info->uuid);
@@ -341,7 +361,9 @@ raid_bdev_write_superblock_cb(struct spdk_bdev_io *bdev_io, bool success, void *
 	int status = 0;
 
 	if (!success) {
-		SPDK_ERRLOG("Failed to save superblock on bdev %s\n", bdev_io->bdev->name);
+		SPDK_ERRLOG("Failed to save %s on bdev %s\n",
+			    ctx->offset_blocks == 0 ? "superblock" : "write-intent bitmap",
+			    bdev_io->bdev->name);
 		status = -EIO;
 	}
 
@@ -370,9 +392,8 @@ _raid_bdev_write_superblock(void *_ctx)
 		}
 
 		rc = spdk_bdev_write_blocks_with_md(base_info->desc, base_info->app_thread_ch,
-						    raid_bdev->sb_io_buf, raid_bdev->sb_io_md_buf, 0,
-						    raid_bdev->sb_io_buf_size / raid_bdev->bdev.blocklen,
-						    raid_bdev_write_superblock_cb, ctx);
+						    ctx->buf, ctx->md_buf, ctx->offset_blocks,
+						    ctx->num_blocks, raid_bdev_write_superblock_cb, ctx);
 		if (rc != 0) {
 			struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(base_info->desc);
 
@@ -425,6 +446,9 @@ raid_bdev_write_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb
 	}
 
 	ctx->raid_bdev = raid_bdev;
+	ctx->buf = raid_bdev->sb_io_buf;
+	ctx->md_buf = raid_bdev->sb_io_md_buf;
+	ctx->num_blocks = raid_bdev->sb_io_buf_size / raid_bdev->bdev.blocklen;
 	ctx->remaining = raid_bdev->num_base_bdevs + 1;
 	ctx->cb = cb;
 	ctx->cb_ctx = cb_ctx;
@@ -472,6 +496,9 @@ raid_bdev_clear_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb
 	}
 
 	ctx->raid_bdev = raid_bdev;
+	ctx->buf = raid_bdev->sb_io_buf;
+	ctx->md_buf = raid_bdev->sb_io_md_buf;
+	ctx->num_blocks = raid_bdev->sb_io_buf_size / raid_bdev->bdev.blocklen;
 	ctx->remaining = raid_bdev->num_base_bdevs + 1;
 	ctx->cb = cb;
 	ctx->cb_ctx = cb_ctx;
@@ -490,4 +517,122 @@ err:
 	cb(rc, raid_bdev, cb_ctx);
 }
 
+void
+raid_bdev_write_wib(struct raid_bdev *raid_bdev, void *buf, uint32_t buf_size,
+		    raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	struct raid_bdev_write_sb_ctx *ctx;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(buf_size % raid_bdev->bdev.blocklen == 0);
+	assert(cb != NULL);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	ctx->raid_bdev = raid_bdev;
+	ctx->buf = buf;
+	ctx->offset_blocks = RAID_BDEV_WIB_OFFSET_SIZE / raid_bdev->bdev.blocklen;
+	ctx->num_blocks = buf_size / raid_bdev->bdev.blocklen;
+	ctx->remaining = raid_bdev->num_base_bdevs + 1;
+	ctx->cb = cb;
+	ctx->cb_ctx = cb_ctx;
+
+	_raid_bdev_write_superblock(ctx);
+}
+
+static void raid_bdev_load_wib_next(struct raid_bdev_load_wib_ctx *ctx);
+
+static void
+raid_bdev_load_wib_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_load_wib_ctx *ctx = cb_arg;
+	uint8_t *buf = ctx->buf, *base_buf = ctx->base_buf;
+	uint32_t i;
+
+	if (success) {
+		/* A region is dirty if it's marked in any copy of the bitmap */
+		for (i = 0; i < ctx->buf_size; i++) {
+			buf[i] |= base_buf[i];
+		}
+		ctx->loaded++;
+	} else {
+		SPDK_WARNLOG("Failed to read write-intent bitmap from bdev %s\n", bdev_io->bdev->name);
+	}
+
+	spdk_bdev_free_io(bdev_io);
+
+	ctx->idx++;
+	raid_bdev_load_wib_next(ctx);
+}
+
+static void
+raid_bdev_load_wib_next(struct raid_bdev_load_wib_ctx *ctx)
+{
+	struct raid_bdev *raid_bdev = ctx->raid_bdev;
+	struct raid_base_bdev_info *base_info;
+	int rc;
+
+	for (; ctx->idx < raid_bdev->num_base_bdevs; ctx->idx++) {
+		base_info = &raid_bdev->base_bdev_info[ctx->idx];
+
+		if (!base_info->is_configured || base_info->remove_scheduled) {
+			continue;
+		}
+
+		rc = spdk_bdev_read_blocks(base_info->desc, base_info->app_thread_ch, ctx->base_buf,
+					   RAID_BDEV_WIB_OFFSET_SIZE / raid_bdev->bdev.blocklen,
+					   ctx->buf_size / raid_bdev->bdev.blocklen,
+					   raid_bdev_load_wib_cb, ctx);
+		if (rc == 0) {
+			return;
+		}
+
+		SPDK_WARNLOG("Failed to read write-intent bitmap from bdev %s: %s\n",
+			     base_info->name, spdk_strerror(-rc));
+	}
+
+	ctx->cb(ctx->loaded > 0 ? 0 : -EIO, raid_bdev, ctx->cb_ctx);
+
+	spdk_dma_free(ctx->base_buf);
+	free(ctx);
+}
+
+void
+raid_bdev_load_wib(struct raid_bdev *raid_bdev, void *buf, uint32_t buf_size,
+		   raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	struct raid_bdev_load_wib_ctx *ctx;
+
+	assert(spdk_get_thread() == spdk_thread_get_app_thread());
+	assert(buf_size % raid_bdev->bdev.blocklen == 0);
+	assert(cb != NULL);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	ctx->base_buf = spdk_dma_malloc(buf_size, 0x1000, NULL);
+	if (!ctx->base_buf) {
+		free(ctx);
+		cb(-ENOMEM, raid_bdev, cb_ctx);
+		return;
+	}
+
+	ctx->raid_bdev = raid_bdev;
+	ctx->buf = buf;
+	ctx->buf_size = buf_size;
+	ctx->cb = cb;
+	ctx->cb_ctx = cb_ctx;
+
+	memset(buf, 0, buf_size);
+
+	raid_bdev_load_wib_next(ctx);
+}
+
 SPDK_LOG_REGISTER_COMPONENT(bdev_raid_sb)
@@ -359,6 +359,230 @@ raid0_submit_null_payload_request(struct raid_bdev_io *raid_io)
 	}
 }
 
+static void raid0_submit_zcopy_request(struct raid_bdev_io *raid_io);
+
+static void
+_raid0_submit_zcopy_request(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid0_submit_zcopy_request(raid_io);
+}
+
+static void
+raid0_zcopy_release_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+	raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+raid0_zcopy_start_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+	struct spdk_bdev_io *raid_bdev_io = spdk_bdev_io_from_ctx(raid_io);
+
+	if (!success) {
+		spdk_bdev_free_io(bdev_io);
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	/* Hand out the base bdev's buffers, it keeps them until the end of the request */
+	if (bdev_io->u.bdev.iovcnt == 1) {
+		spdk_bdev_io_set_buf(raid_bdev_io, bdev_io->u.bdev.iovs[0].iov_base,
+				     bdev_io->u.bdev.iovs[0].iov_len);
+	} else if (raid_bdev_io->u.bdev.iovs == NULL) {
+		raid_bdev_io->u.bdev.iovs = bdev_io->u.bdev.iovs;
+		raid_bdev_io->u.bdev.iovcnt = bdev_io->u.bdev.iovcnt;
+	} else if (raid_bdev_io->u.bdev.iovcnt >= bdev_io->u.bdev.iovcnt) {
+		memcpy(raid_bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovs,
+		       sizeof(struct iovec) * bdev_io->u.bdev.iovcnt);
+		raid_bdev_io->u.bdev.iovcnt = bdev_io->u.bdev.iovcnt;
+	} else {
+		SPDK_ERRLOG("Zcopy buffer of base bdev %s doesn't fit in %d iovecs\n",
+			    spdk_bdev_get_name(bdev_io->bdev), raid_bdev_io->u.bdev.iovcnt);
+		spdk_bdev_zcopy_end(bdev_io, false, raid0_zcopy_release_complete, raid_io);
+		return;
+	}
+
+	raid_io->module_private = bdev_io;
+	raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+raid0_zcopy_end_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct raid_bdev_io *raid_io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+	raid_bdev_io_complete(raid_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+/*
+ * brief:
+ * raid0_submit_zcopy_bounce_request function reads the data of a zero-copy request
+ * spanning multiple strips into its buffer when it starts, or writes it when it is
+ * committed. One request is submitted for each strip; it will submit as many as possible
+ * unless one base io request fails with -ENOMEM, in which case it will queue itself for
+ * later submission.
+ * params:
+ * raid_io
+ * returns:
+ * none
+ */
+static void
+raid0_submit_zcopy_bounce_request(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io		*bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev		*raid_bdev = raid_io->raid_bdev;
+	uint64_t			shift = raid_bdev->strip_size_shift;
+	uint64_t			offset_blocks = raid_io->offset_blocks;
+	uint64_t			end_blocks = offset_blocks + raid_io->num_blocks;
+	uint8_t				strip_idx = 0;
+	int				ret;
+
+	if (raid_io->base_bdev_io_remaining == 0) {
+		raid_io->base_bdev_io_remaining = ((end_blocks - 1) >> shift) -
+						  (offset_blocks >> shift) + 1;
+	}
+
+	while (offset_blocks < end_blocks) {
+		uint64_t strip = offset_blocks >> shift;
+		uint64_t num_blocks = spdk_min(end_blocks, (strip + 1) << shift) - offset_blocks;
+		uint8_t pd_idx = strip % raid_bdev->num_base_bdevs;
+		uint64_t pd_lba = ((strip / raid_bdev->num_base_bdevs) << shift) +
+				  (offset_blocks & (raid_bdev->strip_size - 1));
+		struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[pd_idx];
+		struct spdk_io_channel *base_ch;
+		void *buf;
+
+		if (strip_idx++ < raid_io->base_bdev_io_submitted) {
+			offset_blocks += num_blocks;
+			continue;
+		}
+
+		base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, pd_idx);
+		buf = (char *)bdev_io->u.bdev.iovs[0].iov_base +
+		      (offset_blocks - raid_io->offset_blocks) * raid_bdev->bdev.blocklen;
+
+		if (bdev_io->u.bdev.zcopy.populate) {
+			ret = spdk_bdev_read_blocks(base_info->desc, base_ch, buf,
+						    base_info->data_offset + pd_lba, num_blocks,
+						    raid0_base_io_complete, raid_io);
+		} else {
+			ret = spdk_bdev_write_blocks(base_info->desc, base_ch, buf,
+						     base_info->data_offset + pd_lba, num_blocks,
+						     raid0_base_io_complete, raid_io);
+		}
+
+		if (ret == 0) {
+			raid_io->base_bdev_io_submitted++;
+		} else if (ret == -ENOMEM) {
+			raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+						base_ch, _raid0_submit_zcopy_request);
+			return;
+		} else {
+			SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+			assert(false);
+			raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+			return;
+		}
+
+		offset_blocks += num_blocks;
+	}
+}
+
+static void
+raid0_zcopy_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	struct raid_bdev_io *raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
+
+	if (!success) {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (bdev_io->u.bdev.zcopy.populate) {
+		raid0_submit_zcopy_bounce_request(raid_io);
+	} else {
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+}
+
+/*
+ * brief:
+ * raid0_submit_zcopy_request function handles zero-copy requests. A request
+ * within a single strip is passed through to the member disk, which provides
+ * the buffer. A request spanning multiple strips gets a buffer from the bdev
+ * layer instead, which is filled from the member disks when it starts and
+ * written back to them when it is committed.
+ * params:
+ * raid_io
+ * returns:
+ * none
+ */
+static void
+raid0_submit_zcopy_request(struct raid_bdev_io *raid_io)
+{
+	struct spdk_bdev_io		*bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	struct raid_bdev		*raid_bdev = raid_io->raid_bdev;
+	struct spdk_bdev_io		*base_io;
+	struct raid_base_bdev_info	*base_info;
+	struct spdk_io_channel		*base_ch;
+	uint64_t			start_strip;
+	uint64_t			end_strip;
+	uint64_t			pd_lba;
+	uint8_t				pd_idx;
+	int				ret;
+
+	if (!bdev_io->u.bdev.zcopy.start) {
+		base_io = raid_io->module_private;
+		if (base_io != NULL) {
+			ret = spdk_bdev_zcopy_end(base_io, bdev_io->u.bdev.zcopy.commit,
+						  raid0_zcopy_end_complete, raid_io);
+			assert(ret == 0);
+		} else if (bdev_io->u.bdev.zcopy.commit && !bdev_io->u.bdev.zcopy.populate) {
+			raid0_submit_zcopy_bounce_request(raid_io);
+		} else {
+			raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		}
+		return;
+	}
+
+	raid_io->module_private = NULL;
+
+	start_strip = raid_io->offset_blocks >> raid_bdev->strip_size_shift;
+	end_strip = (raid_io->offset_blocks + raid_io->num_blocks - 1) >>
+		    raid_bdev->strip_size_shift;
+	if (start_strip != end_strip && raid_bdev->num_base_bdevs > 1) {
+		spdk_bdev_io_get_buf(bdev_io, raid0_zcopy_get_buf_cb,
+				     raid_io->num_blocks * raid_bdev->bdev.blocklen);
+		return;
+	}
+
+	pd_idx = start_strip % raid_bdev->num_base_bdevs;
+	pd_lba = ((start_strip / raid_bdev->num_base_bdevs) << raid_bdev->strip_size_shift) +
+		 (raid_io->offset_blocks & (raid_bdev->strip_size - 1));
+	base_info = &raid_bdev->base_bdev_info[pd_idx];
+	base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch, pd_idx);
+
+	ret = raid_bdev_zcopy_start(base_info, base_ch, pd_lba, raid_io->num_blocks,
+				    bdev_io->u.bdev.zcopy.populate, raid0_zcopy_start_complete,
+				    raid_io);
+	if (ret == -ENOMEM) {
+		raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+					base_ch, _raid0_submit_zcopy_request);
+	} else if (ret != 0) {
+		SPDK_ERRLOG("bdev io submit error not due to ENOMEM, it should not happen\n");
+		assert(false);
+		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
 static int
 raid0_start(struct raid_bdev *raid_bdev)
 {
@@ -442,6 +666,7 @@ static struct raid_bdev_module g_raid0_module = {
 	.start = raid0_start,
 	.submit_rw_request = raid0_submit_rw_request,
 	.submit_null_payload_request = raid0_submit_null_payload_request,
+	.submit_zcopy_request = raid0_submit_zcopy_request,
 	.resize = raid0_resize,
 };
 RAID_MODULE_REGISTER(&g_raid0_module)
@@ -5,17 +5,57 @@
 
 #include "bdev_raid.h"
 
+#include "spdk/env.h"
 #include "spdk/likely.h"
 #include "spdk/log.h"
 
+/* Weight of a new sample in the moving average of read latency is 1/2^shift */
+#define RAID1_READ_LATENCY_EWMA_SHIFT	3
+
+/*
+ * The read latency estimate of a base bdev is halved for every period of this length without
+ * a read completing on it, so a base bdev avoided after a latency spike eventually gets a read
+ * again and its estimate is refreshed.
+ */
+#define RAID1_READ_LATENCY_DECAY_US	100000
+
+/*
+ * A sequential read stays on the base bdev of the previous read unless it is expected
+ * to take more than this many times longer than the best one.
+ */
+#define RAID1_SEQ_READ_STICKY_FACTOR	2
+
 struct raid1_info {
 	/* The parent raid bdev */
 	struct raid_bdev *raid_bdev;
+
+	/* Policy for choosing the base bdev to read from */
+	enum spdk_bdev_raid1_read_policy read_policy;
+
+	/* RAID1_READ_LATENCY_DECAY_US in ticks */
+	uint64_t read_latency_decay_ticks;
+};
+
+struct raid1_base_channel {
+	/* Number of outstanding read blocks on this base bdev */
+	uint64_t read_blocks_outstanding;
+
+	/* Moving average of read completion latency in ticks, 0 until the first completion */
+	uint64_t read_latency_ticks;
+
+	/* Time of the last update or decay of read_latency_ticks */
+	uint64_t read_latency_tsc;
 };
 
 struct raid1_io_channel {
-	/* Array of per-base_bdev counters of outstanding read blocks on this channel */
-	uint64_t read_blocks_outstanding[0];
+	/* Base bdev index of the last submitted read, UINT8_MAX if none */
+	uint8_t last_read_idx;
+
+	/* Block following the last submitted read, used to detect sequential reads */
+	uint64_t last_read_end;
+
+	/* Array of per-base_bdev read statistics of this channel */
+	struct raid1_base_channel base[0];
 };
 
 static void
@@ -24,8 +64,8 @@ raid1_channel_inc_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t id
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
 
-	assert(raid1_ch->read_blocks_outstanding[idx] <= UINT64_MAX - num_blocks);
-	raid1_ch->read_blocks_outstanding[idx] += num_blocks;
+	assert(raid1_ch->base[idx].read_blocks_outstanding <= UINT64_MAX - num_blocks);
+	raid1_ch->base[idx].read_blocks_outstanding += num_blocks;
 }
 
 static void
@@ -34,8 +74,46 @@ raid1_channel_dec_read_counters(struct raid_bdev_io_channel *raid_ch, uint8_t id
 {
 	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
 
-	assert(raid1_ch->read_blocks_outstanding[idx] >= num_blocks);
-	raid1_ch->read_blocks_outstanding[idx] -= num_blocks;
+	assert(raid1_ch->base[idx].read_blocks_outstanding >= num_blocks);
+	raid1_ch->base[idx].read_blocks_outstanding -= num_blocks;
+}
+
+static void
+raid1_channel_update_read_latency(struct raid_bdev_io_channel *raid_ch, uint8_t idx,
+				  uint64_t ticks, uint64_t now)
+{
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint64_t *latency = &raid1_ch->base[idx].read_latency_ticks;
+
+	raid1_ch->base[idx].read_latency_tsc = now;
+
+	if (*latency == 0) {
+		*latency = spdk_max(ticks, 1);
+	} else if (ticks > *latency) {
+		*latency += (ticks - *latency) >> RAID1_READ_LATENCY_EWMA_SHIFT;
+	} else {
+		*latency -= (*latency - ticks) >> RAID1_READ_LATENCY_EWMA_SHIFT;
+	}
+}
+
+static void
+raid1_channel_decay_read_latency(struct raid1_base_channel *base, uint64_t now,
+				 uint64_t decay_ticks)
+{
+	uint64_t periods;
+
+	if (base->read_latency_ticks == 0 || now <= base->read_latency_tsc) {
+		return;
+	}
+
+	periods = (now - base->read_latency_tsc) / decay_ticks;
+	if (periods == 0) {
+		return;
+	}
+
+	/* once it drops to 0 the estimate is unknown again and the next completion resets it */
+	base->read_latency_ticks = periods < 64 ? base->read_latency_ticks >> periods : 0;
+	base->read_latency_tsc += periods * decay_ticks;
 }
 
 static void
@@ -192,6 +270,15 @@ raid1_read_bdev_io_completion(struct spdk_bdev_io *bdev_io, bool success, void *
 {
 	struct raid_bdev_io *raid_io = cb_arg;
 
+	struct raid1_info *r1info = raid_io->raid_bdev->module_private;
+	uint64_t now;
+
+	if (r1info->read_policy == SPDK_BDEV_RAID1_READ_POLICY_LATENCY && success) {
+		now = spdk_get_ticks();
+		raid1_channel_update_read_latency(raid_io->raid_ch, raid_io->base_bdev_io_submitted,
+						  now - spdk_bdev_io_get_submit_tsc(bdev_io), now);
+	}
+
 	spdk_bdev_free_io(bdev_io);
 
 	raid1_channel_dec_read_counters(raid_io->raid_ch, raid_io->base_bdev_io_submitted,
@@ -226,8 +313,63 @@ raid1_channel_next_read_base_bdev(struct raid_bdev *raid_bdev, struct raid_bdev_
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
 		if (raid_bdev_channel_get_base_channel(raid_ch, i) != NULL &&
-		    raid1_ch->read_blocks_outstanding[i] < read_blocks_min) {
-			read_blocks_min = raid1_ch->read_blocks_outstanding[i];
+		    raid1_ch->base[i].read_blocks_outstanding < read_blocks_min) {
+			read_blocks_min = raid1_ch->base[i].read_blocks_outstanding;
+			idx = i;
+		}
+	}
+
+	return idx;
+}
+
+/*
+ * Estimated time for a base bdev to complete a read of num_blocks: the average latency
+ * scaled by the amount of data it will have to read, including what is already queued.
+ */
+static inline uint64_t
+raid1_channel_read_cost(struct raid1_io_channel *raid1_ch, uint8_t idx, uint64_t num_blocks)
+{
+	return raid1_ch->base[idx].read_latency_ticks *
+	       (raid1_ch->base[idx].read_blocks_outstanding + num_blocks);
+}
+
+static uint8_t
+raid1_channel_next_read_base_bdev_latency(struct raid_bdev_io *raid_io)
+{
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct raid1_info *r1info = raid_bdev->module_private;
+	uint64_t cost, cost_min = UINT64_MAX;
+	uint64_t now = spdk_get_ticks();
+	uint8_t idx = UINT8_MAX;
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (raid_bdev_channel_get_base_channel(raid_ch, i) == NULL) {
+			continue;
+		}
+
+		raid1_channel_decay_read_latency(&raid1_ch->base[i], now,
+						 r1info->read_latency_decay_ticks);
+		cost = raid1_channel_read_cost(raid1_ch, i, raid_io->num_blocks);
+		if (idx == UINT8_MAX || cost < cost_min) {
+			cost_min = cost;
+			idx = i;
+		} else if (cost == cost_min && raid1_ch->base[i].read_blocks_outstanding <
+			   raid1_ch->base[idx].read_blocks_outstanding) {
+			/* e.g. before any latency is known, fall back to queue depth */
+			idx = i;
+		}
+	}
+
+	/* keep sequential reads on the same base bdev to let its readahead work */
+	i = raid1_ch->last_read_idx;
+	if (idx != UINT8_MAX && i != idx && i != UINT8_MAX &&
+	    raid_io->offset_blocks == raid1_ch->last_read_end &&
+	    raid_bdev_channel_get_base_channel(raid_ch, i) != NULL) {
+		cost = raid1_channel_read_cost(raid1_ch, i, raid_io->num_blocks);
+		if (cost / RAID1_SEQ_READ_STICKY_FACTOR <= cost_min) {
 			idx = i;
 		}
 	}
@@ -239,14 +381,20 @@ static int
 raid1_submit_read_request(struct raid_bdev_io *raid_io)
 {
 	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid1_info *r1info = raid_bdev->module_private;
 	struct raid_bdev_io_channel *raid_ch = raid_io->raid_ch;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
 	struct spdk_bdev_ext_io_opts io_opts;
 	struct raid_base_bdev_info *base_info;
 	struct spdk_io_channel *base_ch;
 	uint8_t idx;
 	int ret;
 
-	idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_ch);
+	if (r1info->read_policy == SPDK_BDEV_RAID1_READ_POLICY_LATENCY) {
+		idx = raid1_channel_next_read_base_bdev_latency(raid_io);
+	} else {
+		idx = raid1_channel_next_read_base_bdev(raid_bdev, raid_ch);
+	}
 	if (spdk_unlikely(idx == UINT8_MAX)) {
 		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
 		return 0;
@@ -263,6 +411,8 @@ raid1_submit_read_request(struct raid_bdev_io *raid_io)
 	if (spdk_likely(ret == 0)) {
 		raid1_channel_inc_read_counters(raid_ch, idx, raid_io->num_blocks);
 		raid_io->base_bdev_io_submitted = idx;
+		raid1_ch->last_read_idx = idx;
+		raid1_ch->last_read_end = raid_io->offset_blocks + raid_io->num_blocks;
 	} else if (spdk_unlikely(ret == -ENOMEM)) {
 		raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
 					base_ch, _raid1_submit_rw_request);
@@ -440,6 +590,10 @@ raid1_ioch_destroy(void *io_device, void *ctx_buf)
 static int
 raid1_ioch_create(void *io_device, void *ctx_buf)
 {
+	struct raid1_io_channel *raid1_ch = ctx_buf;
+
+	raid1_ch->last_read_idx = UINT8_MAX;
+
 	return 0;
 }
 
@@ -459,6 +613,7 @@ raid1_start(struct raid_bdev *raid_bdev)
 	uint64_t min_blockcnt = UINT64_MAX;
 	struct raid_base_bdev_info *base_info;
 	struct raid1_info *r1info;
+	struct spdk_raid_bdev_opts opts;
 	char name[256];
 
 	r1info = calloc(1, sizeof(*r1info));
@@ -468,6 +623,11 @@ raid1_start(struct raid_bdev *raid_bdev)
 	}
 	r1info->raid_bdev = raid_bdev;
 
+	raid_bdev_get_opts(&opts);
+	r1info->read_policy = opts.raid1_read_policy;
+	r1info->read_latency_decay_ticks = spdk_max(RAID1_READ_LATENCY_DECAY_US *
+					   spdk_get_ticks_hz() / SPDK_SEC_TO_USEC, 1);
+
 	RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_info) {
 		min_blockcnt = spdk_min(min_blockcnt, base_info->data_size);
 	}
@@ -481,7 +641,8 @@ raid1_start(struct raid_bdev *raid_bdev)
 
 	snprintf(name, sizeof(name), "raid1_%s", raid_bdev->bdev.name);
 	spdk_io_device_register(r1info, raid1_ioch_create, raid1_ioch_destroy,
-				sizeof(struct raid1_io_channel) + raid_bdev->num_base_bdevs * sizeof(uint64_t),
+				sizeof(struct raid1_io_channel) +
+				raid_bdev->num_base_bdevs * sizeof(struct raid1_base_channel),
 				name);
 
 	return 0;
@@ -547,6 +708,35 @@ raid1_process_submit_write(struct raid_bdev_process_request *process_req)
 	}
 }
 
+static void
+raid1_process_resync_write_completed(struct raid_bdev_io *raid_io,
+				     enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_process_request *process_req = SPDK_CONTAINEROF(raid_io,
+			struct raid_bdev_process_request, raid_io);
+
+	raid_bdev_process_request_complete(process_req,
+					   status == SPDK_BDEV_IO_STATUS_SUCCESS ? 0 : -EIO);
+}
+
+static void
+raid1_process_submit_resync_write(struct raid_bdev_process_request *process_req)
+{
+	struct raid_bdev_io *raid_io = &process_req->raid_io;
+	int ret;
+
+	/* Write the data that was read back to all the mirrors */
+	raid_bdev_io_init(raid_io, raid_io->raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+			  process_req->offset_blocks, process_req->num_blocks,
+			  &process_req->iov, 1, process_req->md_buf, NULL, NULL);
+	raid_io->completion_cb = raid1_process_resync_write_completed;
+
+	ret = raid1_submit_write_request(raid_io);
+	if (spdk_unlikely(ret != 0)) {
+		raid_bdev_process_request_complete(process_req, ret);
+	}
+}
+
 static void
 raid1_process_read_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
 {
@@ -558,7 +748,11 @@ raid1_process_read_completed(struct raid_bdev_io *raid_io, enum spdk_bdev_io_sta
 		return;
 	}
 
-	raid1_process_submit_write(process_req);
+	if (process_req->target == NULL) {
+		raid1_process_submit_resync_write(process_req);
+	} else {
+		raid1_process_submit_write(process_req);
+	}
 }
 
 static int
@@ -628,6 +822,7 @@ static struct raid_bdev_module g_raid1_module = {
 	.get_io_channel = raid1_get_io_channel,
 	.submit_process_request = raid1_submit_process_request,
 	.resize = raid1_resize,
+	.resync_supported = true,
 };
 RAID_MODULE_REGISTER(&g_raid1_module)
 
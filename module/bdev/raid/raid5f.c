@@ -16,6 +16,15 @@
 /* Maximum concurrent full stripe writes per io channel */
 #define RAID5F_MAX_STRIPES 32
 
+/* Number of buckets of the stripe lock hash table */
+#define RAID5F_STRIPE_LOCK_BUCKETS 256
+
+/* Maximum number of stripes collecting sequential writes per io channel */
+#define RAID5F_MAX_CACHED_STRIPES 8
+
+/* Time after which writes collected in an incomplete stripe are submitted anyway */
+#define RAID5F_STRIPE_CACHE_FLUSH_TIMEOUT_US 100
+
 struct chunk {
 	/* Corresponds to base_bdev index */
 	uint8_t index;
@@ -31,6 +40,20 @@ struct chunk {
 
 	/* Pointer to buffer with I/O metadata */
 	void *md_buf;
+
+	/* Range of the chunk's blocks written by a partial stripe write */
+	uint64_t req_offset;
+	uint64_t req_blocks;
+
+	/* Ranges of the chunk's old blocks read by a partial stripe write */
+	struct chunk_read {
+		uint64_t offset;
+		uint64_t blocks;
+		struct iovec iov;
+	} reads[2];
+
+	/* Number of used chunk reads */
+	uint8_t reads_num;
 };
 
 struct stripe_request;
@@ -40,6 +63,7 @@ struct stripe_request {
 	enum stripe_request_type {
 		STRIPE_REQ_WRITE,
 		STRIPE_REQ_RECONSTRUCT,
+		STRIPE_REQ_PARTIAL_WRITE,
 	} type;
 
 	struct raid5f_io_channel *r5ch;
@@ -60,6 +84,30 @@ struct stripe_request {
 
 			/* Buffer for stripe io metadata parity */
 			void *parity_md_buf;
+
+			/* Sequential sub-stripe writes collected into this stripe, in order */
+			struct raid_bdev_io **raid_ios;
+			int raid_ios_num;
+			int raid_ios_max;
+
+			/* Combined iovecs of the collected writes */
+			struct iovec *iovs;
+			int iovcnt;
+			int iovcnt_max;
+
+			/* Offset from stripe start where the collected writes end */
+			uint64_t end_offset;
+
+			/* Tick count at which the collected writes are submitted if the stripe is not full */
+			uint64_t flush_tsc;
+
+			/* The first collected write carries the stripe write, its original values */
+			struct {
+				uint64_t offset_blocks;
+				uint64_t num_blocks;
+				struct iovec *iovs;
+				int iovcnt;
+			} raid_io_orig;
 		} write;
 
 		struct {
@@ -75,6 +123,39 @@ struct stripe_request {
 			/* Offset from chunk start */
 			uint64_t chunk_offset;
 		} reconstruct;
+
+		struct {
+			/* Array of buffers for reading old chunk data, indexed by chunk */
+			void **chunk_buffers;
+
+			/* Buffer for the updated stripe parity */
+			void *parity_buf;
+
+			/* Offset from stripe start and number of blocks of the current step */
+			uint64_t stripe_offset;
+			uint64_t num_blocks;
+
+			/* Range of the chunks covered by the parity update */
+			uint64_t parity_offset;
+			uint64_t parity_blocks;
+
+			/* How the parity is updated */
+			enum raid5f_parity_update {
+				RAID5F_PARITY_UPDATE_NONE,
+				/* Read-modify-write: old parity ^ old data ^ new data */
+				RAID5F_PARITY_UPDATE_RMW,
+				/* Reconstruct-write: new data ^ data of the other chunks */
+				RAID5F_PARITY_UPDATE_RCW,
+			} parity_update;
+
+			/* Number of base bdev reads and writes of the current step */
+			uint8_t reads_num;
+			uint8_t writes_num;
+
+			/* Array of iovecs of the parity calculation sources */
+			struct iovec *xor_iovs;
+			int xor_iovcnt_max;
+		} partial_write;
 	};
 
 	/* Array of iovec iterators for each chunk */
@@ -87,6 +168,7 @@ struct stripe_request {
 	void **chunk_xor_md_buffers;
 
 	struct {
+		uint32_t n_src;
 		size_t len;
 		size_t remaining;
 		size_t remaining_md;
@@ -96,6 +178,12 @@ struct stripe_request {
 
 	TAILQ_ENTRY(stripe_request) link;
 
+	/* Link in the stripe lock bucket or in the lock holder's waiters list */
+	TAILQ_ENTRY(stripe_request) lock_link;
+
+	/* Requests waiting for the stripe lock held by this request */
+	TAILQ_HEAD(, stripe_request) lock_waiters;
+
 	/* Array of chunks corresponding to base_bdevs */
 	struct chunk chunks[0];
 };
@@ -115,6 +203,15 @@ struct raid5f_info {
 
 	/* block length bit shift for optimized calculation, only valid when no interleaved md */
 	uint32_t blocklen_shift;
+
+	/* Zeroed buffer of strip size, used for aligning partial chunk data in parity calculation */
+	void *zero_buf;
+
+	/* Stripes locked by writes, hashed by stripe index */
+	struct raid5f_stripe_lock_bucket {
+		struct spdk_spinlock lock;
+		TAILQ_HEAD(, stripe_request) locked;
+	} stripe_locks[RAID5F_STRIPE_LOCK_BUCKETS];
 };
 
 struct raid5f_io_channel {
@@ -122,8 +219,12 @@ struct raid5f_io_channel {
 	struct {
 		TAILQ_HEAD(, stripe_request) write;
 		TAILQ_HEAD(, stripe_request) reconstruct;
+		TAILQ_HEAD(, stripe_request) partial_write;
 	} free_stripe_requests;
 
+	/* Number of write and partial write stripe requests in use, including cached stripes */
+	int writes_outstanding;
+
 	/* accel_fw channel */
 	struct spdk_io_channel *accel_ch;
 
@@ -133,6 +234,18 @@ struct raid5f_io_channel {
 	/* For iterating over chunk iovecs during xor calculation */
 	struct iovec **chunk_xor_iovs;
 	size_t *chunk_xor_iovcnt;
+
+	/* Stripes collecting sequential sub-stripe writes, oldest first */
+	struct {
+		TAILQ_HEAD(, stripe_request) stripes;
+		int stripes_num;
+
+		/* End of the last write on this channel, for detecting sequential writes */
+		uint64_t next_offset_blocks;
+
+		/* Submits the collected writes of stripes which didn't fill up in time */
+		struct spdk_poller *poller;
+	} stripe_cache;
 };
 
 #define __CHUNK_IN_RANGE(req, c) \
@@ -175,13 +288,88 @@ raid5f_stripe_parity_chunk_index(const struct raid_bdev *raid_bdev, uint64_t str
 	return raid5f_stripe_data_chunks_num(raid_bdev) - stripe_index % raid_bdev->num_base_bdevs;
 }
 
+static void raid5f_stripe_request_locked(struct stripe_request *stripe_req);
+
+static void
+_raid5f_stripe_request_locked(void *_stripe_req)
+{
+	struct stripe_request *stripe_req = _stripe_req;
+
+	raid5f_stripe_request_locked(stripe_req);
+}
+
+static inline struct raid5f_stripe_lock_bucket *
+raid5f_stripe_lock_bucket(struct stripe_request *stripe_req)
+{
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+
+	return &r5f_info->stripe_locks[stripe_req->stripe_index % RAID5F_STRIPE_LOCK_BUCKETS];
+}
+
+/*
+ * Writes updating the same stripe's parity must not run concurrently. The first writer
+ * of a stripe becomes the lock holder, later ones are queued on it and get the lock
+ * in order when it is released.
+ */
+static void
+raid5f_stripe_lock(struct stripe_request *stripe_req)
+{
+	struct raid5f_stripe_lock_bucket *bucket = raid5f_stripe_lock_bucket(stripe_req);
+	struct stripe_request *holder;
+
+	spdk_spin_lock(&bucket->lock);
+	TAILQ_FOREACH(holder, &bucket->locked, lock_link) {
+		if (holder->stripe_index == stripe_req->stripe_index) {
+			TAILQ_INSERT_TAIL(&holder->lock_waiters, stripe_req, lock_link);
+			break;
+		}
+	}
+	if (holder == NULL) {
+		TAILQ_INSERT_TAIL(&bucket->locked, stripe_req, lock_link);
+	}
+	spdk_spin_unlock(&bucket->lock);
+
+	if (holder == NULL) {
+		raid5f_stripe_request_locked(stripe_req);
+	}
+}
+
+static void
+raid5f_stripe_unlock(struct stripe_request *stripe_req)
+{
+	struct raid5f_stripe_lock_bucket *bucket = raid5f_stripe_lock_bucket(stripe_req);
+	struct stripe_request *next;
+
+	spdk_spin_lock(&bucket->lock);
+	TAILQ_REMOVE(&bucket->locked, stripe_req, lock_link);
+	next = TAILQ_FIRST(&stripe_req->lock_waiters);
+	if (next != NULL) {
+		TAILQ_REMOVE(&stripe_req->lock_waiters, next, lock_link);
+		TAILQ_CONCAT(&next->lock_waiters, &stripe_req->lock_waiters, lock_link);
+		TAILQ_INSERT_TAIL(&bucket->locked, next, lock_link);
+	}
+	spdk_spin_unlock(&bucket->lock);
+
+	if (next != NULL) {
+		struct spdk_thread *thread = spdk_io_channel_get_thread(spdk_io_channel_from_ctx(next->r5ch));
+
+		spdk_thread_send_msg(thread, _raid5f_stripe_request_locked, next);
+	}
+}
+
 static inline void
 raid5f_stripe_request_release(struct stripe_request *stripe_req)
 {
 	if (spdk_likely(stripe_req->type == STRIPE_REQ_WRITE)) {
+		raid5f_stripe_unlock(stripe_req);
 		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.write, stripe_req, link);
+		stripe_req->r5ch->writes_outstanding--;
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.reconstruct, stripe_req, link);
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		raid5f_stripe_unlock(stripe_req);
+		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.partial_write, stripe_req, link);
+		stripe_req->r5ch->writes_outstanding--;
 	} else {
 		assert(false);
 	}
@@ -251,9 +439,7 @@ static void
 raid5f_xor_stripe_continue(struct stripe_request *stripe_req)
 {
 	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
-	struct raid_bdev_io *raid_io = stripe_req->raid_io;
-	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
-	uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
+	uint32_t n_src = stripe_req->xor.n_src;
 	int ret;
 
 	assert(stripe_req->xor.len > 0);
@@ -271,6 +457,106 @@ raid5f_xor_stripe_continue(struct stripe_request *stripe_req)
 	}
 }
 
+static inline struct iovec *
+raid5f_xor_iov_add(struct iovec *iov, void *buf, uint64_t num_blocks, uint32_t blocklen)
+{
+	if (num_blocks > 0) {
+		iov->iov_base = buf;
+		iov->iov_len = num_blocks * blocklen;
+		iov++;
+	}
+
+	return iov;
+}
+
+static inline struct iovec *
+raid5f_xor_iov_add_chunk(struct iovec *iov, struct chunk *chunk)
+{
+	memcpy(iov, chunk->iovs, chunk->iovcnt * sizeof(*iov));
+
+	return iov + chunk->iovcnt;
+}
+
+static inline void
+raid5f_xor_src_add(struct raid5f_io_channel *r5ch, uint32_t *n_src, struct iovec *iov,
+		   struct iovec *iov_end)
+{
+	r5ch->chunk_xor_iovs[*n_src] = iov;
+	r5ch->chunk_xor_iovcnt[*n_src] = iov_end - iov;
+	(*n_src)++;
+}
+
+/*
+ * Set up the parity calculation sources of a partial stripe write. All sources span the
+ * parity update range. With read-modify-write, the sources are the old parity and the
+ * old and new data of each written chunk, padded with zeroes where the chunk is not
+ * written. With reconstruct-write, there is one source per data chunk, composed of its
+ * new data and its old data read around it. Returns the number of sources.
+ */
+static uint32_t
+raid5f_partial_write_map_xor_iovecs(struct stripe_request *stripe_req)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(r5ch);
+	uint32_t blocklen = r5f_info->raid_bdev->bdev.blocklen;
+	uint64_t parity_offset = stripe_req->partial_write.parity_offset;
+	uint64_t parity_blocks = stripe_req->partial_write.parity_blocks;
+	void **chunk_buffers = stripe_req->partial_write.chunk_buffers;
+	struct iovec *iov = stripe_req->partial_write.xor_iovs;
+	struct iovec *src;
+	struct chunk *chunk;
+	uint32_t n_src = 0;
+
+	if (stripe_req->partial_write.parity_update == RAID5F_PARITY_UPDATE_RMW) {
+		src = iov;
+		iov = raid5f_xor_iov_add(iov, chunk_buffers[stripe_req->parity_chunk->index], parity_blocks,
+					 blocklen);
+		raid5f_xor_src_add(r5ch, &n_src, src, iov);
+	}
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		void *buf = chunk_buffers[chunk->index];
+		uint64_t pre_blocks = chunk->req_offset - parity_offset;
+		uint64_t post_blocks = parity_offset + parity_blocks - chunk->req_offset - chunk->req_blocks;
+
+		if (stripe_req->partial_write.parity_update == RAID5F_PARITY_UPDATE_RMW) {
+			if (chunk->req_blocks == 0) {
+				continue;
+			}
+
+			src = iov;
+			iov = raid5f_xor_iov_add(iov, r5f_info->zero_buf, pre_blocks, blocklen);
+			iov = raid5f_xor_iov_add(iov, buf + pre_blocks * blocklen, chunk->req_blocks, blocklen);
+			iov = raid5f_xor_iov_add(iov, r5f_info->zero_buf, post_blocks, blocklen);
+			raid5f_xor_src_add(r5ch, &n_src, src, iov);
+
+			src = iov;
+			iov = raid5f_xor_iov_add(iov, r5f_info->zero_buf, pre_blocks, blocklen);
+			iov = raid5f_xor_iov_add_chunk(iov, chunk);
+			iov = raid5f_xor_iov_add(iov, r5f_info->zero_buf, post_blocks, blocklen);
+			raid5f_xor_src_add(r5ch, &n_src, src, iov);
+		} else {
+			src = iov;
+			if (chunk->req_blocks == 0) {
+				iov = raid5f_xor_iov_add(iov, buf, parity_blocks, blocklen);
+			} else {
+				iov = raid5f_xor_iov_add(iov, buf, pre_blocks, blocklen);
+				iov = raid5f_xor_iov_add_chunk(iov, chunk);
+				iov = raid5f_xor_iov_add(iov, buf + (pre_blocks + chunk->req_blocks) * blocklen,
+							 post_blocks, blocklen);
+			}
+			raid5f_xor_src_add(r5ch, &n_src, src, iov);
+		}
+	}
+
+	r5ch->chunk_xor_iovs[n_src] = stripe_req->parity_chunk->iovs;
+	r5ch->chunk_xor_iovcnt[n_src] = stripe_req->parity_chunk->iovcnt;
+
+	assert(iov - stripe_req->partial_write.xor_iovs <= stripe_req->partial_write.xor_iovcnt_max);
+
+	return n_src;
+}
+
 static void
 raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 {
@@ -280,6 +566,7 @@ raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 	struct chunk *chunk;
 	struct chunk *dest_chunk = NULL;
 	uint64_t num_blocks = 0;
+	uint32_t n_src;
 	uint8_t c;
 
 	assert(cb != NULL);
@@ -290,24 +577,32 @@ raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		num_blocks = raid_io->num_blocks;
 		dest_chunk = stripe_req->reconstruct.chunk;
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		num_blocks = stripe_req->partial_write.parity_blocks;
 	} else {
 		assert(false);
 	}
 
-	c = 0;
-	FOR_EACH_CHUNK(stripe_req, chunk) {
-		if (chunk == dest_chunk) {
-			continue;
+	if (dest_chunk != NULL) {
+		c = 0;
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			if (chunk == dest_chunk) {
+				continue;
+			}
+			r5ch->chunk_xor_iovs[c] = chunk->iovs;
+			r5ch->chunk_xor_iovcnt[c] = chunk->iovcnt;
+			c++;
 		}
-		r5ch->chunk_xor_iovs[c] = chunk->iovs;
-		r5ch->chunk_xor_iovcnt[c] = chunk->iovcnt;
-		c++;
+		r5ch->chunk_xor_iovs[c] = dest_chunk->iovs;
+		r5ch->chunk_xor_iovcnt[c] = dest_chunk->iovcnt;
+		n_src = c;
+	} else {
+		n_src = raid5f_partial_write_map_xor_iovecs(stripe_req);
 	}
-	r5ch->chunk_xor_iovs[c] = dest_chunk->iovs;
-	r5ch->chunk_xor_iovcnt[c] = dest_chunk->iovcnt;
 
+	stripe_req->xor.n_src = n_src;
 	stripe_req->xor.len = spdk_ioviter_firstv(stripe_req->chunk_iov_iters,
-			      raid_bdev->num_base_bdevs,
+			      n_src + 1,
 			      r5ch->chunk_xor_iovs,
 			      r5ch->chunk_xor_iovcnt,
 			      stripe_req->chunk_xor_buffers);
@@ -316,7 +611,6 @@ raid5f_xor_stripe(struct stripe_request *stripe_req, stripe_req_xor_cb cb)
 	stripe_req->xor.cb = cb;
 
 	if (raid_io->md_buf != NULL) {
-		uint8_t n_src = raid5f_stripe_data_chunks_num(raid_bdev);
 		uint64_t len = num_blocks * raid_bdev->bdev.md_len;
 		int ret;
 
@@ -389,6 +683,8 @@ raid5f_chunk_complete_bdev_io(struct spdk_bdev_io *bdev_io, bool success, void *
 		raid5f_stripe_request_chunk_write_complete(stripe_req, status);
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		raid5f_stripe_request_chunk_read_complete(stripe_req, status);
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		raid_bdev_io_complete_part(stripe_req->raid_io, 1, status);
 	} else {
 		assert(false);
 	}
@@ -608,8 +904,8 @@ raid5f_stripe_write_request_xor_done(struct stripe_request *stripe_req, int stat
 	struct raid_bdev_io *raid_io = stripe_req->raid_io;
 
 	if (status != 0) {
-		raid5f_stripe_request_release(stripe_req);
 		raid_bdev_io_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		raid5f_stripe_request_release(stripe_req);
 	} else {
 		raid5f_stripe_request_submit_chunks(stripe_req);
 	}
@@ -636,19 +932,490 @@ raid5f_submit_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index)
 	}
 
 	TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
+	r5ch->writes_outstanding++;
 
 	raid_io->module_private = stripe_req;
 	raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
 
+	raid5f_stripe_lock(stripe_req);
+
+	return 0;
+}
+
+static void
+raid5f_stripe_write_request_start(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
 	if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, stripe_req->parity_chunk->index) != NULL) {
 		raid5f_xor_stripe(stripe_req, raid5f_stripe_write_request_xor_done);
 	} else {
 		raid5f_stripe_write_request_xor_done(stripe_req, 0);
 	}
+}
+
+static int
+raid5f_chunk_map_iovecs(struct chunk *chunk, const struct iovec *iovs, int iovcnt,
+			size_t offset, size_t len)
+{
+	size_t remaining;
+	int chunk_iovcnt;
+	int i;
+	int ret;
+
+	while (iovcnt > 0 && offset >= iovs->iov_len) {
+		offset -= iovs->iov_len;
+		iovs++;
+		iovcnt--;
+	}
+
+	remaining = offset + len;
+	for (i = 0; i < iovcnt && remaining > 0; i++) {
+		remaining -= spdk_min(remaining, iovs[i].iov_len);
+	}
+
+	if (spdk_unlikely(remaining > 0)) {
+		return -EINVAL;
+	}
+	chunk_iovcnt = i;
+
+	ret = raid5f_chunk_set_iovcnt(chunk, chunk_iovcnt);
+	if (ret) {
+		return ret;
+	}
+
+	for (i = 0; i < chunk_iovcnt; i++) {
+		chunk->iovs[i].iov_base = iovs[i].iov_base + offset;
+		chunk->iovs[i].iov_len = spdk_min(len, iovs[i].iov_len - offset);
+		len -= chunk->iovs[i].iov_len;
+		offset = 0;
+	}
+
+	return 0;
+}
+
+static void
+raid5f_chunk_add_read(struct stripe_request *stripe_req, struct chunk *chunk, uint64_t offset,
+		      uint64_t num_blocks)
+{
+	struct raid_bdev *raid_bdev = stripe_req->raid_io->raid_bdev;
+	void *buf = stripe_req->partial_write.chunk_buffers[chunk->index];
+	struct chunk_read *read;
+
+	if (num_blocks == 0) {
+		return;
+	}
+
+	assert(chunk->reads_num < SPDK_COUNTOF(chunk->reads));
+	read = &chunk->reads[chunk->reads_num++];
+	read->offset = offset;
+	read->blocks = num_blocks;
+	read->iov.iov_base = buf + (offset - stripe_req->partial_write.parity_offset) *
+			     raid_bdev->bdev.blocklen;
+	read->iov.iov_len = num_blocks * raid_bdev->bdev.blocklen;
+
+	stripe_req->partial_write.reads_num++;
+}
+
+/*
+ * Prepare the current step of a partial stripe write: map the written data to the chunks,
+ * choose how to update the parity and set up the reads it needs. Read-modify-write reads
+ * the old data of the written chunks and the old parity, reconstruct-write reads the rest
+ * of the data chunks - whichever reads less is used. If the written data can't be fully
+ * handled in one step because of a missing base bdev, the step is shortened and the rest
+ * is written in the next step.
+ */
+static int
+raid5f_partial_write_prepare(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t req_start = stripe_req->partial_write.stripe_offset;
+	uint64_t req_end = req_start + stripe_req->partial_write.num_blocks;
+	uint64_t raid_io_stripe_offset = raid_io->offset_blocks % r5f_info->stripe_blocks;
+	uint64_t parity_start = UINT64_MAX;
+	uint64_t parity_end = 0;
+	uint64_t parity_blocks;
+	uint64_t data_offset = 0;
+	uint64_t write_blocks = 0;
+	uint64_t rmw_blocks, rcw_blocks;
+	struct chunk *parity_chunk = stripe_req->parity_chunk;
+	struct chunk *missing = NULL;
+	struct chunk *chunk;
+	int xor_iovcnt = 2;
+	int ret;
+
+	FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+		uint64_t start = spdk_max(req_start, data_offset);
+		uint64_t end = spdk_min(req_end, data_offset + raid_bdev->strip_size);
+
+		chunk->reads_num = 0;
+		chunk->req_offset = 0;
+		chunk->req_blocks = 0;
+
+		if (start < end) {
+			chunk->req_offset = start - data_offset;
+			chunk->req_blocks = end - start;
+
+			ret = raid5f_chunk_map_iovecs(chunk, raid_io->iovs, raid_io->iovcnt,
+						      (start - raid_io_stripe_offset) * blocklen,
+						      chunk->req_blocks * blocklen);
+			if (spdk_unlikely(ret)) {
+				return ret;
+			}
+
+			parity_start = spdk_min(parity_start, chunk->req_offset);
+			parity_end = spdk_max(parity_end, chunk->req_offset + chunk->req_blocks);
+			write_blocks += chunk->req_blocks;
+			xor_iovcnt += chunk->iovcnt;
+		}
+		xor_iovcnt += 6;
+
+		if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, chunk->index) == NULL) {
+			missing = chunk;
+		}
+
+		data_offset += raid_bdev->strip_size;
+	}
+
+	parity_blocks = parity_end - parity_start;
+	parity_chunk->reads_num = 0;
+	parity_chunk->req_offset = 0;
+	parity_chunk->req_blocks = 0;
+
+	if (raid_bdev_channel_get_base_channel(raid_io->raid_ch, parity_chunk->index) == NULL) {
+		stripe_req->partial_write.parity_update = RAID5F_PARITY_UPDATE_NONE;
+	} else if (missing != NULL && missing->req_blocks != 0 && missing->req_blocks != parity_blocks) {
+		/*
+		 * The missing chunk's data only takes part in the parity calculation if it is
+		 * written over the whole parity update range. Write it separately from the
+		 * other chunks in this case.
+		 */
+		if (missing->req_offset != 0) {
+			stripe_req->partial_write.num_blocks = missing->req_blocks;
+		} else {
+			stripe_req->partial_write.num_blocks -= missing->req_blocks;
+		}
+
+		return raid5f_partial_write_prepare(stripe_req);
+	} else if (missing != NULL) {
+		stripe_req->partial_write.parity_update = missing->req_blocks != 0 ?
+				RAID5F_PARITY_UPDATE_RCW : RAID5F_PARITY_UPDATE_RMW;
+	} else {
+		rmw_blocks = parity_blocks + write_blocks;
+		rcw_blocks = raid5f_stripe_data_chunks_num(raid_bdev) * parity_blocks - write_blocks;
+
+		stripe_req->partial_write.parity_update = rmw_blocks <= rcw_blocks ?
+				RAID5F_PARITY_UPDATE_RMW : RAID5F_PARITY_UPDATE_RCW;
+	}
+
+	stripe_req->partial_write.parity_offset = parity_start;
+	stripe_req->partial_write.parity_blocks = parity_blocks;
+	stripe_req->partial_write.reads_num = 0;
+
+	switch (stripe_req->partial_write.parity_update) {
+	case RAID5F_PARITY_UPDATE_RMW:
+		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+			if (chunk != missing) {
+				raid5f_chunk_add_read(stripe_req, chunk, chunk->req_offset, chunk->req_blocks);
+			}
+		}
+		raid5f_chunk_add_read(stripe_req, parity_chunk, parity_start, parity_blocks);
+		break;
+	case RAID5F_PARITY_UPDATE_RCW:
+		FOR_EACH_DATA_CHUNK(stripe_req, chunk) {
+			if (chunk == missing) {
+				continue;
+			}
+			if (chunk->req_blocks == 0) {
+				raid5f_chunk_add_read(stripe_req, chunk, parity_start, parity_blocks);
+			} else {
+				raid5f_chunk_add_read(stripe_req, chunk, parity_start,
+						      chunk->req_offset - parity_start);
+				raid5f_chunk_add_read(stripe_req, chunk, chunk->req_offset + chunk->req_blocks,
+						      parity_end - chunk->req_offset - chunk->req_blocks);
+			}
+		}
+		break;
+	default:
+		break;
+	}
+
+	if (stripe_req->partial_write.parity_update != RAID5F_PARITY_UPDATE_NONE) {
+		parity_chunk->req_offset = parity_start;
+		parity_chunk->req_blocks = parity_blocks;
+		parity_chunk->iovs[0].iov_base = stripe_req->partial_write.parity_buf;
+		parity_chunk->iovs[0].iov_len = parity_blocks * blocklen;
+		parity_chunk->iovcnt = 1;
+
+		if (xor_iovcnt > stripe_req->partial_write.xor_iovcnt_max) {
+			struct iovec *iovs;
+
+			iovs = realloc(stripe_req->partial_write.xor_iovs, xor_iovcnt * sizeof(*iovs));
+			if (!iovs) {
+				return -ENOMEM;
+			}
+			stripe_req->partial_write.xor_iovs = iovs;
+			stripe_req->partial_write.xor_iovcnt_max = xor_iovcnt;
+		}
+	}
+
+	stripe_req->partial_write.writes_num = 0;
+	FOR_EACH_CHUNK(stripe_req, chunk) {
+		if (chunk->req_blocks != 0 &&
+		    raid_bdev_channel_get_base_channel(raid_io->raid_ch, chunk->index) != NULL) {
+			stripe_req->partial_write.writes_num++;
+		}
+	}
 
 	return 0;
 }
 
+static void raid5f_partial_write_start(struct stripe_request *stripe_req);
+
+static void
+raid5f_partial_write_finish(struct stripe_request *stripe_req, enum spdk_bdev_io_status status)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	raid5f_stripe_request_release(stripe_req);
+	raid_bdev_io_complete(raid_io, status);
+}
+
+static void
+raid5f_partial_write_writes_completed_cb(struct raid_bdev_io *raid_io,
+		enum spdk_bdev_io_status status)
+{
+	struct stripe_request *stripe_req = raid_io->module_private;
+	struct raid5f_info *r5f_info = raid_io->raid_bdev->module_private;
+	uint64_t raid_io_end = raid_io->offset_blocks % r5f_info->stripe_blocks + raid_io->num_blocks;
+	uint64_t step_end = stripe_req->partial_write.stripe_offset + stripe_req->partial_write.num_blocks;
+
+	raid_io->completion_cb = NULL;
+
+	if (status == SPDK_BDEV_IO_STATUS_SUCCESS && step_end < raid_io_end) {
+		stripe_req->partial_write.stripe_offset = step_end;
+		stripe_req->partial_write.num_blocks = raid_io_end - step_end;
+		raid5f_partial_write_start(stripe_req);
+		return;
+	}
+
+	raid5f_partial_write_finish(stripe_req, status);
+}
+
+static void
+raid5f_partial_write_reads_completed_cb(struct raid_bdev_io *raid_io,
+					enum spdk_bdev_io_status status);
+
+static void raid5f_partial_write_submit_chunks(struct stripe_request *stripe_req);
+
+static void
+_raid5f_partial_write_submit_chunks(void *_raid_io)
+{
+	struct raid_bdev_io *raid_io = _raid_io;
+
+	raid5f_partial_write_submit_chunks(raid_io->module_private);
+}
+
+static int
+raid5f_partial_write_chunk_submit(struct stripe_request *stripe_req, struct chunk *chunk,
+				  struct iovec *iovs, int iovcnt, uint64_t offset_blocks,
+				  uint64_t num_blocks, bool write, uint8_t io_num)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid_base_bdev_info *base_info = &raid_bdev->base_bdev_info[chunk->index];
+	struct spdk_io_channel *base_ch = raid_bdev_channel_get_base_channel(raid_io->raid_ch,
+					  chunk->index);
+	uint64_t base_offset_blocks = (stripe_req->stripe_index << raid_bdev->strip_size_shift) +
+				      offset_blocks;
+	struct spdk_bdev_ext_io_opts io_opts;
+	int ret;
+
+	raid5f_init_ext_io_opts(&io_opts, raid_io);
+	io_opts.metadata = NULL;
+
+	if (write) {
+		ret = raid_bdev_writev_blocks_ext(base_info, base_ch, iovs, iovcnt, base_offset_blocks,
+						  num_blocks, raid5f_chunk_complete_bdev_io, chunk, &io_opts);
+	} else {
+		ret = raid_bdev_readv_blocks_ext(base_info, base_ch, iovs, iovcnt, base_offset_blocks,
+						 num_blocks, raid5f_chunk_complete_bdev_io, chunk, &io_opts);
+	}
+
+	if (spdk_likely(ret == 0)) {
+		raid_io->base_bdev_io_submitted++;
+	} else if (ret == -ENOMEM) {
+		raid_bdev_queue_io_wait(raid_io, spdk_bdev_desc_get_bdev(base_info->desc),
+					base_ch, _raid5f_partial_write_submit_chunks);
+	} else {
+		/* Implicitly complete any I/Os not yet submitted as FAILED. */
+		raid_bdev_io_complete_part(raid_io, io_num - raid_io->base_bdev_io_submitted,
+					   SPDK_BDEV_IO_STATUS_FAILED);
+	}
+
+	return ret;
+}
+
+/*
+ * Submit the reads or the writes of the current step, depending on which phase the
+ * request is in. Resumes after the already submitted I/Os when retried.
+ */
+static void
+raid5f_partial_write_submit_chunks(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	uint64_t skip = raid_io->base_bdev_io_submitted;
+	struct chunk *chunk;
+	uint8_t i;
+
+	if (raid_io->completion_cb == raid5f_partial_write_reads_completed_cb) {
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			for (i = 0; i < chunk->reads_num; i++) {
+				struct chunk_read *read = &chunk->reads[i];
+
+				if (skip > 0) {
+					skip--;
+					continue;
+				}
+
+				if (raid5f_partial_write_chunk_submit(stripe_req, chunk, &read->iov, 1,
+								      read->offset, read->blocks, false,
+								      stripe_req->partial_write.reads_num) != 0) {
+					return;
+				}
+			}
+		}
+	} else {
+		FOR_EACH_CHUNK(stripe_req, chunk) {
+			if (chunk->req_blocks == 0 ||
+			    raid_bdev_channel_get_base_channel(raid_io->raid_ch, chunk->index) == NULL) {
+				continue;
+			}
+
+			if (skip > 0) {
+				skip--;
+				continue;
+			}
+
+			if (raid5f_partial_write_chunk_submit(stripe_req, chunk, chunk->iovs, chunk->iovcnt,
+							      chunk->req_offset, chunk->req_blocks, true,
+							      stripe_req->partial_write.writes_num) != 0) {
+				return;
+			}
+		}
+	}
+}
+
+static void
+raid5f_partial_write_submit_writes(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	if (stripe_req->partial_write.writes_num == 0) {
+		raid5f_partial_write_writes_completed_cb(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	raid_io->base_bdev_io_remaining = stripe_req->partial_write.writes_num;
+	raid_io->base_bdev_io_submitted = 0;
+	raid_io->completion_cb = raid5f_partial_write_writes_completed_cb;
+
+	raid5f_partial_write_submit_chunks(stripe_req);
+}
+
+static void
+raid5f_partial_write_xor_done(struct stripe_request *stripe_req, int status)
+{
+	if (status != 0) {
+		raid5f_partial_write_finish(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
+	} else {
+		raid5f_partial_write_submit_writes(stripe_req);
+	}
+}
+
+static void
+raid5f_partial_write_reads_completed_cb(struct raid_bdev_io *raid_io,
+					enum spdk_bdev_io_status status)
+{
+	struct stripe_request *stripe_req = raid_io->module_private;
+
+	raid_io->completion_cb = NULL;
+
+	if (status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		raid5f_partial_write_finish(stripe_req, status);
+	} else if (stripe_req->partial_write.parity_update != RAID5F_PARITY_UPDATE_NONE) {
+		raid5f_xor_stripe(stripe_req, raid5f_partial_write_xor_done);
+	} else {
+		raid5f_partial_write_submit_writes(stripe_req);
+	}
+}
+
+static void
+raid5f_partial_write_start(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+	int ret;
+
+	ret = raid5f_partial_write_prepare(stripe_req);
+	if (spdk_unlikely(ret)) {
+		raid5f_partial_write_finish(stripe_req, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (stripe_req->partial_write.reads_num == 0) {
+		raid5f_partial_write_reads_completed_cb(raid_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	raid_io->base_bdev_io_remaining = stripe_req->partial_write.reads_num;
+	raid_io->base_bdev_io_submitted = 0;
+	raid_io->completion_cb = raid5f_partial_write_reads_completed_cb;
+
+	raid5f_partial_write_submit_chunks(stripe_req);
+}
+
+static int
+raid5f_submit_partial_write_request(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+				    uint64_t stripe_offset)
+{
+	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	struct stripe_request *stripe_req;
+
+	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.partial_write);
+	if (!stripe_req) {
+		return -ENOMEM;
+	}
+
+	raid5f_stripe_request_init(stripe_req, raid_io, stripe_index);
+
+	stripe_req->partial_write.stripe_offset = stripe_offset;
+	stripe_req->partial_write.num_blocks = raid_io->num_blocks;
+
+	TAILQ_REMOVE(&r5ch->free_stripe_requests.partial_write, stripe_req, link);
+	r5ch->writes_outstanding++;
+
+	raid_io->module_private = stripe_req;
+
+	raid5f_stripe_lock(stripe_req);
+
+	return 0;
+}
+
+static void
+raid5f_stripe_request_locked(struct stripe_request *stripe_req)
+{
+	if (spdk_likely(stripe_req->type == STRIPE_REQ_WRITE)) {
+		raid5f_stripe_write_request_start(stripe_req);
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		raid5f_partial_write_start(stripe_req);
+	} else {
+		assert(false);
+	}
+}
+
 static void
 raid5f_chunk_read_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -795,6 +1562,239 @@ raid5f_submit_read_request(struct raid_bdev_io *raid_io, uint64_t stripe_index,
 	return ret;
 }
 
+static void
+raid5f_submit_partial_write(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+			    uint64_t stripe_offset)
+{
+	int ret;
+
+	ret = raid5f_submit_partial_write_request(raid_io, stripe_index, stripe_offset);
+	if (spdk_unlikely(ret)) {
+		raid_bdev_io_complete(raid_io, ret == -ENOMEM ? SPDK_BDEV_IO_STATUS_NOMEM :
+				      SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static bool
+raid5f_stripe_cache_append(struct stripe_request *stripe_req, struct raid_bdev_io *raid_io)
+{
+	int raid_ios_num = stripe_req->write.raid_ios_num + 1;
+	int iovcnt = stripe_req->write.iovcnt + raid_io->iovcnt;
+
+	if (raid_ios_num > stripe_req->write.raid_ios_max) {
+		struct raid_bdev_io **raid_ios;
+
+		raid_ios = realloc(stripe_req->write.raid_ios, raid_ios_num * 2 * sizeof(*raid_ios));
+		if (!raid_ios) {
+			return false;
+		}
+		stripe_req->write.raid_ios = raid_ios;
+		stripe_req->write.raid_ios_max = raid_ios_num * 2;
+	}
+
+	if (iovcnt > stripe_req->write.iovcnt_max) {
+		struct iovec *iovs;
+
+		iovs = realloc(stripe_req->write.iovs, iovcnt * 2 * sizeof(*iovs));
+		if (!iovs) {
+			return false;
+		}
+		stripe_req->write.iovs = iovs;
+		stripe_req->write.iovcnt_max = iovcnt * 2;
+	}
+
+	memcpy(&stripe_req->write.iovs[stripe_req->write.iovcnt], raid_io->iovs,
+	       raid_io->iovcnt * sizeof(*raid_io->iovs));
+	stripe_req->write.iovcnt = iovcnt;
+	stripe_req->write.raid_ios[stripe_req->write.raid_ios_num] = raid_io;
+	stripe_req->write.raid_ios_num = raid_ios_num;
+	stripe_req->write.end_offset += raid_io->num_blocks;
+
+	return true;
+}
+
+static void
+raid5f_stripe_cache_remove(struct stripe_request *stripe_req)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+
+	TAILQ_REMOVE(&r5ch->stripe_cache.stripes, stripe_req, link);
+	r5ch->stripe_cache.stripes_num--;
+}
+
+/*
+ * Submit the writes collected in a stripe which is not full as separate partial stripe
+ * writes. The stripe request didn't take the stripe lock, so it goes directly back to
+ * the pool.
+ */
+static void
+raid5f_stripe_cache_flush(struct stripe_request *stripe_req)
+{
+	struct raid5f_io_channel *r5ch = stripe_req->r5ch;
+	struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(r5ch);
+	struct raid_bdev_io *raid_io;
+	int i;
+
+	raid5f_stripe_cache_remove(stripe_req);
+
+	for (i = 0; i < stripe_req->write.raid_ios_num; i++) {
+		raid_io = stripe_req->write.raid_ios[i];
+		raid5f_submit_partial_write(raid_io, stripe_req->stripe_index,
+					    raid_io->offset_blocks % r5f_info->stripe_blocks);
+	}
+
+	TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.write, stripe_req, link);
+	r5ch->writes_outstanding--;
+}
+
+static void
+raid5f_stripe_cache_write_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct stripe_request *stripe_req = raid_io->module_private;
+	int i;
+
+	raid_io->completion_cb = NULL;
+	raid_io->offset_blocks = stripe_req->write.raid_io_orig.offset_blocks;
+	raid_io->num_blocks = stripe_req->write.raid_io_orig.num_blocks;
+	raid_io->iovs = stripe_req->write.raid_io_orig.iovs;
+	raid_io->iovcnt = stripe_req->write.raid_io_orig.iovcnt;
+
+	for (i = 1; i < stripe_req->write.raid_ios_num; i++) {
+		raid_bdev_io_complete(stripe_req->write.raid_ios[i], status);
+	}
+	raid_bdev_io_complete(raid_io, status);
+}
+
+/*
+ * Submit a full stripe write of the collected writes. The first one is turned into a
+ * write of the whole stripe, completing it completes all the others.
+ */
+static void
+raid5f_stripe_cache_submit_stripe(struct stripe_request *stripe_req)
+{
+	struct raid_bdev_io *raid_io = stripe_req->write.raid_ios[0];
+	struct raid_bdev *raid_bdev = raid_io->raid_bdev;
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	int ret;
+
+	raid5f_stripe_cache_remove(stripe_req);
+
+	stripe_req->write.raid_io_orig.offset_blocks = raid_io->offset_blocks;
+	stripe_req->write.raid_io_orig.num_blocks = raid_io->num_blocks;
+	stripe_req->write.raid_io_orig.iovs = raid_io->iovs;
+	stripe_req->write.raid_io_orig.iovcnt = raid_io->iovcnt;
+
+	raid_io->offset_blocks = stripe_req->stripe_index * r5f_info->stripe_blocks;
+	raid_io->num_blocks = r5f_info->stripe_blocks;
+	raid_io->iovs = stripe_req->write.iovs;
+	raid_io->iovcnt = stripe_req->write.iovcnt;
+	raid_io->module_private = stripe_req;
+	raid_io->completion_cb = raid5f_stripe_cache_write_complete;
+
+	ret = raid5f_stripe_request_map_iovecs(stripe_req);
+	if (spdk_unlikely(ret)) {
+		raid5f_stripe_cache_write_complete(raid_io, SPDK_BDEV_IO_STATUS_FAILED);
+		TAILQ_INSERT_HEAD(&stripe_req->r5ch->free_stripe_requests.write, stripe_req, link);
+		stripe_req->r5ch->writes_outstanding--;
+		return;
+	}
+
+	raid_io->base_bdev_io_remaining = raid_bdev->num_base_bdevs;
+
+	raid5f_stripe_lock(stripe_req);
+}
+
+/*
+ * Try to collect a sub-stripe write into a stripe, to be written together with the
+ * following sequential writes as a full stripe, without reading the old data. A stripe
+ * starts collecting only with a write at its beginning which continues a sequential
+ * stream, while other writes are in flight on the channel. A writer waiting for each write
+ * to complete would gain nothing from it and only pay the flush timeout. Writes are held
+ * (not completed) until the stripe is full or the flush timeout expires, so completed writes
+ * are always on the base bdevs. Nothing is collected while a raid process (e.g. rebuild) is
+ * active, as the process window may split the writes. Returns false if the write should be
+ * submitted directly.
+ */
+static bool
+raid5f_stripe_cache_write(struct raid_bdev_io *raid_io, uint64_t stripe_index,
+			  uint64_t stripe_offset)
+{
+	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_io->raid_ch);
+	struct raid5f_info *r5f_info = raid_io->raid_bdev->module_private;
+	bool sequential = raid_io->offset_blocks == r5ch->stripe_cache.next_offset_blocks;
+	struct stripe_request *stripe_req;
+
+	r5ch->stripe_cache.next_offset_blocks = raid_io->offset_blocks + raid_io->num_blocks;
+
+	TAILQ_FOREACH(stripe_req, &r5ch->stripe_cache.stripes, link) {
+		if (stripe_req->stripe_index == stripe_index) {
+			break;
+		}
+	}
+
+	if (stripe_req != NULL) {
+		if (stripe_offset != stripe_req->write.end_offset ||
+		    raid_io->raid_ch != stripe_req->raid_io->raid_ch ||
+		    !raid5f_stripe_cache_append(stripe_req, raid_io)) {
+			raid5f_stripe_cache_flush(stripe_req);
+			return false;
+		}
+
+		if (stripe_req->write.end_offset == r5f_info->stripe_blocks) {
+			raid5f_stripe_cache_submit_stripe(stripe_req);
+		}
+
+		return true;
+	}
+
+	if (stripe_offset != 0 || !sequential || r5ch->writes_outstanding == 0 ||
+	    r5ch->stripe_cache.stripes_num >= RAID5F_MAX_CACHED_STRIPES ||
+	    raid_io->raid_bdev->process != NULL) {
+		return false;
+	}
+
+	stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write);
+	if (!stripe_req) {
+		return false;
+	}
+
+	raid5f_stripe_request_init(stripe_req, raid_io, stripe_index);
+	stripe_req->write.raid_ios_num = 0;
+	stripe_req->write.iovcnt = 0;
+	stripe_req->write.end_offset = 0;
+
+	if (!raid5f_stripe_cache_append(stripe_req, raid_io)) {
+		return false;
+	}
+
+	stripe_req->write.flush_tsc = spdk_get_ticks() +
+				      RAID5F_STRIPE_CACHE_FLUSH_TIMEOUT_US * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+
+	TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
+	r5ch->writes_outstanding++;
+	TAILQ_INSERT_TAIL(&r5ch->stripe_cache.stripes, stripe_req, link);
+	r5ch->stripe_cache.stripes_num++;
+
+	return true;
+}
+
+static int
+raid5f_stripe_cache_poll(void *arg)
+{
+	struct raid5f_io_channel *r5ch = arg;
+	struct stripe_request *stripe_req;
+	uint64_t now = spdk_get_ticks();
+	int count = 0;
+
+	while ((stripe_req = TAILQ_FIRST(&r5ch->stripe_cache.stripes)) != NULL &&
+	       stripe_req->write.flush_tsc <= now) {
+		raid5f_stripe_cache_flush(stripe_req);
+		count++;
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static void
 raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
 {
@@ -810,9 +1810,17 @@ raid5f_submit_rw_request(struct raid_bdev_io *raid_io)
 		ret = raid5f_submit_read_request(raid_io, stripe_index, stripe_offset);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		assert(stripe_offset == 0);
-		assert(raid_io->num_blocks == r5f_info->stripe_blocks);
-		ret = raid5f_submit_write_request(raid_io, stripe_index);
+		if (spdk_likely(raid_io->num_blocks == r5f_info->stripe_blocks)) {
+			assert(stripe_offset == 0);
+			ret = raid5f_submit_write_request(raid_io, stripe_index);
+		} else {
+			assert(raid_bdev->bdev.allow_partial_write_unit);
+			assert(stripe_offset + raid_io->num_blocks <= r5f_info->stripe_blocks);
+			if (raid5f_stripe_cache_write(raid_io, stripe_index, stripe_offset)) {
+				return;
+			}
+			ret = raid5f_submit_partial_write_request(raid_io, stripe_index, stripe_offset);
+		}
 		break;
 	default:
 		ret = -EINVAL;
@@ -837,6 +1845,8 @@ raid5f_stripe_request_free(struct stripe_request *stripe_req)
 	if (stripe_req->type == STRIPE_REQ_WRITE) {
 		spdk_dma_free(stripe_req->write.parity_buf);
 		spdk_dma_free(stripe_req->write.parity_md_buf);
+		free(stripe_req->write.raid_ios);
+		free(stripe_req->write.iovs);
 	} else if (stripe_req->type == STRIPE_REQ_RECONSTRUCT) {
 		struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
 		struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
@@ -855,6 +1865,20 @@ raid5f_stripe_request_free(struct stripe_request *stripe_req)
 			}
 			free(stripe_req->reconstruct.chunk_md_buffers);
 		}
+	} else if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		struct raid5f_info *r5f_info = raid5f_ch_to_r5f_info(stripe_req->r5ch);
+		struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+		uint8_t i;
+
+		if (stripe_req->partial_write.chunk_buffers) {
+			for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+				spdk_dma_free(stripe_req->partial_write.chunk_buffers[i]);
+			}
+			free(stripe_req->partial_write.chunk_buffers);
+		}
+
+		spdk_dma_free(stripe_req->partial_write.parity_buf);
+		free(stripe_req->partial_write.xor_iovs);
 	} else {
 		assert(false);
 	}
@@ -875,6 +1899,7 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 	struct stripe_request *stripe_req;
 	struct chunk *chunk;
 	size_t chunk_len;
+	uint32_t xor_buffers_num;
 
 	stripe_req = calloc(1, sizeof(*stripe_req) + sizeof(*chunk) * raid_bdev->num_base_bdevs);
 	if (!stripe_req) {
@@ -883,6 +1908,7 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 
 	stripe_req->r5ch = r5ch;
 	stripe_req->type = type;
+	TAILQ_INIT(&stripe_req->lock_waiters);
 
 	FOR_EACH_CHUNK(stripe_req, chunk) {
 		chunk->index = chunk - stripe_req->chunks;
@@ -940,17 +1966,50 @@ raid5f_stripe_request_alloc(struct raid5f_io_channel *r5ch, enum stripe_request_
 				stripe_req->reconstruct.chunk_md_buffers[i] = buf;
 			}
 		}
+	} else if (type == STRIPE_REQ_PARTIAL_WRITE) {
+		void *buf;
+		uint8_t i;
+
+		stripe_req->partial_write.chunk_buffers = calloc(raid_bdev->num_base_bdevs, sizeof(void *));
+		if (!stripe_req->partial_write.chunk_buffers) {
+			goto err;
+		}
+
+		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+			buf = spdk_dma_malloc(chunk_len, r5f_info->buf_alignment, NULL);
+			if (!buf) {
+				goto err;
+			}
+			stripe_req->partial_write.chunk_buffers[i] = buf;
+		}
+
+		stripe_req->partial_write.parity_buf = spdk_dma_malloc(chunk_len, r5f_info->buf_alignment,
+						       NULL);
+		if (!stripe_req->partial_write.parity_buf) {
+			goto err;
+		}
+
+		stripe_req->partial_write.xor_iovcnt_max = raid_bdev->num_base_bdevs * 8;
+		stripe_req->partial_write.xor_iovs = calloc(stripe_req->partial_write.xor_iovcnt_max,
+						     sizeof(stripe_req->partial_write.xor_iovs[0]));
+		if (!stripe_req->partial_write.xor_iovs) {
+			goto err;
+		}
 	} else {
 		assert(false);
 		return NULL;
 	}
 
-	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(raid_bdev->num_base_bdevs));
+	/* Read-modify-write uses old and new data of each written chunk as separate sources */
+	xor_buffers_num = type == STRIPE_REQ_PARTIAL_WRITE ? raid_bdev->num_base_bdevs * 2 :
+			  raid_bdev->num_base_bdevs;
+
+	stripe_req->chunk_iov_iters = malloc(SPDK_IOVITER_SIZE(xor_buffers_num));
 	if (!stripe_req->chunk_iov_iters) {
 		goto err;
 	}
 
-	stripe_req->chunk_xor_buffers = calloc(raid_bdev->num_base_bdevs,
+	stripe_req->chunk_xor_buffers = calloc(xor_buffers_num,
 					       sizeof(stripe_req->chunk_xor_buffers[0]));
 	if (!stripe_req->chunk_xor_buffers) {
 		goto err;
@@ -975,6 +2034,9 @@ raid5f_ioch_destroy(void *io_device, void *ctx_buf)
 	struct stripe_request *stripe_req;
 
 	assert(TAILQ_EMPTY(&r5ch->xor_retry_queue));
+	assert(TAILQ_EMPTY(&r5ch->stripe_cache.stripes));
+
+	spdk_poller_unregister(&r5ch->stripe_cache.poller);
 
 	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.write))) {
 		TAILQ_REMOVE(&r5ch->free_stripe_requests.write, stripe_req, link);
@@ -986,6 +2048,11 @@ raid5f_ioch_destroy(void *io_device, void *ctx_buf)
 		raid5f_stripe_request_free(stripe_req);
 	}
 
+	while ((stripe_req = TAILQ_FIRST(&r5ch->free_stripe_requests.partial_write))) {
+		TAILQ_REMOVE(&r5ch->free_stripe_requests.partial_write, stripe_req, link);
+		raid5f_stripe_request_free(stripe_req);
+	}
+
 	if (r5ch->accel_ch) {
 		spdk_put_io_channel(r5ch->accel_ch);
 	}
@@ -1005,7 +2072,10 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 
 	TAILQ_INIT(&r5ch->free_stripe_requests.write);
 	TAILQ_INIT(&r5ch->free_stripe_requests.reconstruct);
+	TAILQ_INIT(&r5ch->free_stripe_requests.partial_write);
 	TAILQ_INIT(&r5ch->xor_retry_queue);
+	TAILQ_INIT(&r5ch->stripe_cache.stripes);
+	r5ch->stripe_cache.next_offset_blocks = UINT64_MAX;
 
 	for (i = 0; i < RAID5F_MAX_STRIPES; i++) {
 		stripe_req = raid5f_stripe_request_alloc(r5ch, STRIPE_REQ_WRITE);
@@ -1025,18 +2095,35 @@ raid5f_ioch_create(void *io_device, void *ctx_buf)
 		TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.reconstruct, stripe_req, link);
 	}
 
+	if (raid_bdev->bdev.allow_partial_write_unit) {
+		for (i = 0; i < RAID5F_MAX_STRIPES; i++) {
+			stripe_req = raid5f_stripe_request_alloc(r5ch, STRIPE_REQ_PARTIAL_WRITE);
+			if (!stripe_req) {
+				goto err;
+			}
+
+			TAILQ_INSERT_HEAD(&r5ch->free_stripe_requests.partial_write, stripe_req, link);
+		}
+
+		r5ch->stripe_cache.poller = SPDK_POLLER_REGISTER(raid5f_stripe_cache_poll, r5ch,
+					    RAID5F_STRIPE_CACHE_FLUSH_TIMEOUT_US);
+		if (!r5ch->stripe_cache.poller) {
+			goto err;
+		}
+	}
+
 	r5ch->accel_ch = spdk_accel_get_io_channel();
 	if (!r5ch->accel_ch) {
 		SPDK_ERRLOG("Failed to get accel framework's IO channel\n");
 		goto err;
 	}
 
-	r5ch->chunk_xor_iovs = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovs));
+	r5ch->chunk_xor_iovs = calloc(raid_bdev->num_base_bdevs * 2, sizeof(*r5ch->chunk_xor_iovs));
 	if (!r5ch->chunk_xor_iovs) {
 		goto err;
 	}
 
-	r5ch->chunk_xor_iovcnt = calloc(raid_bdev->num_base_bdevs, sizeof(*r5ch->chunk_xor_iovcnt));
+	r5ch->chunk_xor_iovcnt = calloc(raid_bdev->num_base_bdevs * 2, sizeof(*r5ch->chunk_xor_iovcnt));
 	if (!r5ch->chunk_xor_iovcnt) {
 		goto err;
 	}
@@ -1057,6 +2144,7 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	struct spdk_bdev *base_bdev;
 	struct raid5f_info *r5f_info;
 	size_t alignment = 0;
+	int i;
 
 	r5f_info = calloc(1, sizeof(*r5f_info));
 	if (!r5f_info) {
@@ -1092,6 +2180,26 @@ raid5f_start(struct raid_bdev *raid_bdev)
 	raid_bdev->bdev.write_unit_size = r5f_info->stripe_blocks;
 	raid_bdev->bdev.split_on_write_unit = true;
 
+	/*
+	 * Writes smaller than a stripe update the parity from the old data, which is not
+	 * supported with separate metadata buffers.
+	 */
+	if (raid_bdev->bdev.md_len == 0 || raid_bdev->bdev.md_interleave) {
+		r5f_info->zero_buf = spdk_dma_zmalloc(raid_bdev->strip_size * raid_bdev->bdev.blocklen,
+						      alignment, NULL);
+		if (!r5f_info->zero_buf) {
+			SPDK_ERRLOG("Failed to allocate zero buffer\n");
+			free(r5f_info);
+			return -ENOMEM;
+		}
+		raid_bdev->bdev.allow_partial_write_unit = true;
+	}
+
+	for (i = 0; i < RAID5F_STRIPE_LOCK_BUCKETS; i++) {
+		spdk_spin_init(&r5f_info->stripe_locks[i].lock);
+		TAILQ_INIT(&r5f_info->stripe_locks[i].locked);
+	}
+
 	raid_bdev->module_private = r5f_info;
 
 	spdk_io_device_register(r5f_info, raid5f_ioch_create, raid5f_ioch_destroy,
@@ -1104,9 +2212,16 @@ static void
 raid5f_io_device_unregister_done(void *io_device)
 {
 	struct raid5f_info *r5f_info = io_device;
+	int i;
 
 	raid_bdev_module_stop_done(r5f_info->raid_bdev);
 
+	for (i = 0; i < RAID5F_STRIPE_LOCK_BUCKETS; i++) {
+		assert(TAILQ_EMPTY(&r5f_info->stripe_locks[i].locked));
+		spdk_spin_destroy(&r5f_info->stripe_locks[i].lock);
+	}
+
+	spdk_dma_free(r5f_info->zero_buf);
 	free(r5f_info);
 }
 
@@ -1198,8 +2313,8 @@ raid5f_submit_process_request(struct raid_bdev_process_request *process_req,
 	struct raid_bdev *raid_bdev = spdk_io_channel_get_io_device(ch);
 	struct raid5f_info *r5f_info = raid_bdev->module_private;
 	struct raid_bdev_io *raid_io = &process_req->raid_io;
-	uint8_t chunk_idx = raid_bdev_base_bdev_slot(process_req->target);
 	uint64_t stripe_index = process_req->offset_blocks / r5f_info->stripe_blocks;
+	uint8_t chunk_idx;
 	struct iovec *iov;
 	int ret;
 
@@ -1209,6 +2324,18 @@ raid5f_submit_process_request(struct raid_bdev_process_request *process_req,
 		return 0;
 	}
 
+	if (process_req->target == NULL) {
+		/* Resync - regenerate the parity chunk of the stripe from the data chunks */
+		chunk_idx = raid5f_stripe_parity_chunk_index(raid_bdev, stripe_index);
+		process_req->target = &raid_bdev->base_bdev_info[chunk_idx];
+		process_req->target_ch = raid_bdev_channel_get_base_channel(raid_ch, chunk_idx);
+		if (process_req->target_ch == NULL) {
+			return -ENODEV;
+		}
+	} else {
+		chunk_idx = raid_bdev_base_bdev_slot(process_req->target);
+	}
+
 	iov = &process_req->iov;
 	iov->iov_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
 	raid_bdev_io_init(raid_io, raid_ch, SPDK_BDEV_IO_TYPE_READ,
@@ -1235,6 +2362,7 @@ static struct raid_bdev_module g_raid5f_module = {
 	.submit_rw_request = raid5f_submit_rw_request,
 	.get_io_channel = raid5f_get_io_channel,
 	.submit_process_request = raid5f_submit_process_request,
+	.resync_supported = true,
 };
 RAID_MODULE_REGISTER(&g_raid5f_module)
 
@@ -0,0 +1,1267 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Read cache virtual bdev.
+ *
+ * Each thread doing I/O to the vbdev keeps its own cache in hugepage memory, so a read served
+ * from the cache doesn't touch any state owned by other threads.  Writes invalidate the cached
+ * data through a table of versions shared by all the threads: a write bumps the version of the
+ * cache lines it covers before it is submitted and again after it completes, and a cache line
+ * is only used while the version it was read with is still current.  Cache lines are evicted
+ * using S3-FIFO: new lines go to a small FIFO queue and only those read again before reaching
+ * its head are moved to the main queue, so a scan doesn't flush the cache.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "vbdev_rcache.h"
+#include "spdk/env.h"
+#include "spdk/json.h"
+#include "spdk/likely.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/log.h"
+
+/* This namespace UUID was generated using uuid_generate() method. */
+#define BDEV_RCACHE_NAMESPACE_UUID "3c8a5a9e-2f41-4d5b-8e1c-7b09d6f4a2e3"
+
+/* Reads spanning more cache lines are passed to the base bdev, so that large sequential reads
+ * don't go through the cache.
+ */
+#define RCACHE_MAX_IO_LINES		16
+/* Number of entries in the table of versions shared by all the threads */
+#define RCACHE_NUM_VERSIONS		(1 << 16)
+/* Share of the cache lines kept in the small queue */
+#define RCACHE_SMALL_QUEUE_PERCENT	10
+#define RCACHE_MAX_FREQ			3
+
+static int vbdev_rcache_init(void);
+static int vbdev_rcache_get_ctx_size(void);
+static void vbdev_rcache_examine(struct spdk_bdev *bdev);
+static void vbdev_rcache_finish(void);
+static int vbdev_rcache_config_json(struct spdk_json_write_ctx *w);
+
+static struct spdk_bdev_module rcache_if = {
+	.name = "rcache",
+	.module_init = vbdev_rcache_init,
+	.get_ctx_size = vbdev_rcache_get_ctx_size,
+	.examine_config = vbdev_rcache_examine,
+	.module_fini = vbdev_rcache_finish,
+	.config_json = vbdev_rcache_config_json
+};
+
+SPDK_BDEV_MODULE_REGISTER(rcache, &rcache_if)
+
+/* Associative list to be used in examine */
+struct bdev_association {
+	char				*vbdev_name;
+	char				*bdev_name;
+	uint64_t			shard_size_mib;
+	uint32_t			line_size;
+	TAILQ_ENTRY(bdev_association)	link;
+};
+static TAILQ_HEAD(, bdev_association) g_bdev_associations = TAILQ_HEAD_INITIALIZER(
+			g_bdev_associations);
+
+enum rcache_line_state {
+	RCACHE_LINE_FREE,
+	/* Being read from the base bdev, not in any queue */
+	RCACHE_LINE_FILLING,
+	RCACHE_LINE_SMALL,
+	RCACHE_LINE_MAIN,
+};
+
+struct rcache_line {
+	/* Index of the cache line on the bdev */
+	uint64_t			line;
+	/* Version of the line when it was read from the base bdev */
+	uint32_t			version;
+	uint8_t				freq;
+	uint8_t				state;
+	uint8_t				*buf;
+	struct rcache_line		*hash_next;
+	TAILQ_ENTRY(rcache_line)	link;
+};
+
+struct vbdev_rcache {
+	struct spdk_bdev		*base_bdev; /* the thing we're attaching to */
+	struct spdk_bdev_desc		*base_desc; /* its descriptor we get from open */
+	struct spdk_bdev		rcache_bdev; /* the read cache virtual bdev */
+	uint64_t			shard_size_mib;
+	uint32_t			line_size;
+	uint32_t			line_shift; /* log2 of blocks per cache line */
+	uint64_t			num_lines; /* cache lines fully within the bdev */
+	/* Versions of the cache lines, shared by all the channels */
+	uint32_t			*versions;
+	TAILQ_ENTRY(vbdev_rcache)	link;
+	struct spdk_thread		*thread; /* thread where base device is opened */
+};
+static TAILQ_HEAD(, vbdev_rcache) g_rcache_nodes = TAILQ_HEAD_INITIALIZER(g_rcache_nodes);
+
+/* Each channel is a shard of the cache, only ever accessed by its own thread. */
+struct rcache_io_channel {
+	struct spdk_io_channel		*base_ch; /* IO channel of base device */
+	struct rcache_line		*lines;
+	uint8_t				*buf;
+	uint64_t			num_lines;
+	/* Hash table of the cached lines and direct-mapped ghost queue of the lines recently
+	 * evicted from the small queue, both of the same size.
+	 */
+	struct rcache_line		**hash;
+	uint64_t			*ghost;
+	uint64_t			hash_mask;
+	TAILQ_HEAD(, rcache_line)	free_lines;
+	TAILQ_HEAD(, rcache_line)	small;
+	TAILQ_HEAD(, rcache_line)	main;
+	uint64_t			num_small;
+	uint64_t			max_small;
+	struct vbdev_rcache_stats	stats;
+};
+
+struct rcache_bdev_io {
+	struct spdk_io_channel		*ch;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+
+	/* Cache lines filled from the base bdev, indexed relative to the first line of the read */
+	struct iovec			iovs[RCACHE_MAX_IO_LINES];
+	uint64_t			first_line;
+	uint32_t			num_lines;
+	/* Bit mask of the cache lines allocated by this read */
+	uint32_t			fill_mask;
+	uint32_t			next_line;
+	uint32_t			outstanding;
+	bool				waiting;
+	bool				failed;
+};
+
+static void vbdev_rcache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io);
+
+static inline uint64_t
+rcache_hash(struct rcache_io_channel *rch, uint64_t line)
+{
+	return ((line * 0x9E3779B97F4A7C15ULL) >> 32) & rch->hash_mask;
+}
+
+static inline uint32_t *
+rcache_version(struct vbdev_rcache *rcache, uint64_t line)
+{
+	return &rcache->versions[line & (RCACHE_NUM_VERSIONS - 1)];
+}
+
+static inline bool
+rcache_line_is_current(struct vbdev_rcache *rcache, struct rcache_line *entry)
+{
+	return entry->version == __atomic_load_n(rcache_version(rcache, entry->line),
+			__ATOMIC_ACQUIRE);
+}
+
+/* Make the cached copies of the blocks in the range stale on all the threads */
+static void
+rcache_invalidate(struct vbdev_rcache *rcache, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t first = offset_blocks >> rcache->line_shift;
+	uint64_t last = (offset_blocks + num_blocks - 1) >> rcache->line_shift;
+	uint64_t line;
+
+	if (last - first >= RCACHE_NUM_VERSIONS) {
+		first = 0;
+		last = RCACHE_NUM_VERSIONS - 1;
+	}
+
+	for (line = first; line <= last; line++) {
+		__atomic_fetch_add(rcache_version(rcache, line), 1, __ATOMIC_RELEASE);
+	}
+}
+
+static struct rcache_line *
+rcache_line_lookup(struct rcache_io_channel *rch, uint64_t line)
+{
+	struct rcache_line *entry;
+
+	for (entry = rch->hash[rcache_hash(rch, line)]; entry != NULL; entry = entry->hash_next) {
+		if (entry->line == line) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void
+rcache_line_hash_remove(struct rcache_io_channel *rch, struct rcache_line *entry)
+{
+	struct rcache_line **prev = &rch->hash[rcache_hash(rch, entry->line)];
+
+	while (*prev != entry) {
+		assert(*prev != NULL);
+		prev = &(*prev)->hash_next;
+	}
+	*prev = entry->hash_next;
+}
+
+static void
+rcache_line_free(struct rcache_io_channel *rch, struct rcache_line *entry)
+{
+	switch (entry->state) {
+	case RCACHE_LINE_SMALL:
+		TAILQ_REMOVE(&rch->small, entry, link);
+		rch->num_small--;
+		break;
+	case RCACHE_LINE_MAIN:
+		TAILQ_REMOVE(&rch->main, entry, link);
+		break;
+	default:
+		break;
+	}
+
+	rcache_line_hash_remove(rch, entry);
+	entry->state = RCACHE_LINE_FREE;
+	TAILQ_INSERT_TAIL(&rch->free_lines, entry, link);
+}
+
+static void
+rcache_ghost_insert(struct rcache_io_channel *rch, uint64_t line)
+{
+	rch->ghost[rcache_hash(rch, line)] = line + 1;
+}
+
+static bool
+rcache_ghost_remove(struct rcache_io_channel *rch, uint64_t line)
+{
+	uint64_t *ghost = &rch->ghost[rcache_hash(rch, line)];
+
+	if (*ghost != line + 1) {
+		return false;
+	}
+
+	*ghost = 0;
+
+	return true;
+}
+
+/* Evict one cache line.  Lines at the head of the small queue that were read again are moved
+ * to the main queue, the others are evicted and remembered in the ghost queue.  Lines at the
+ * head of the main queue that were read again are reinserted at its tail.
+ */
+static bool
+rcache_evict(struct rcache_io_channel *rch)
+{
+	struct rcache_line *entry;
+
+	while (true) {
+		if (rch->num_small > 0 &&
+		    (rch->num_small >= rch->max_small || TAILQ_EMPTY(&rch->main))) {
+			entry = TAILQ_FIRST(&rch->small);
+			TAILQ_REMOVE(&rch->small, entry, link);
+			rch->num_small--;
+			if (entry->freq > 0) {
+				entry->freq = 0;
+				entry->state = RCACHE_LINE_MAIN;
+				TAILQ_INSERT_TAIL(&rch->main, entry, link);
+				continue;
+			}
+			rcache_ghost_insert(rch, entry->line);
+		} else if (!TAILQ_EMPTY(&rch->main)) {
+			entry = TAILQ_FIRST(&rch->main);
+			TAILQ_REMOVE(&rch->main, entry, link);
+			if (entry->freq > 0) {
+				entry->freq--;
+				TAILQ_INSERT_TAIL(&rch->main, entry, link);
+				continue;
+			}
+		} else {
+			/* All the lines are being filled */
+			return false;
+		}
+
+		rcache_line_hash_remove(rch, entry);
+		entry->state = RCACHE_LINE_FREE;
+		TAILQ_INSERT_TAIL(&rch->free_lines, entry, link);
+		rch->stats.evictions++;
+
+		return true;
+	}
+}
+
+static struct rcache_line *
+rcache_line_alloc(struct rcache_io_channel *rch, struct vbdev_rcache *rcache, uint64_t line)
+{
+	struct rcache_line *entry;
+	uint64_t hash;
+
+	if (TAILQ_EMPTY(&rch->free_lines) && !rcache_evict(rch)) {
+		return NULL;
+	}
+
+	entry = TAILQ_FIRST(&rch->free_lines);
+	TAILQ_REMOVE(&rch->free_lines, entry, link);
+
+	entry->line = line;
+	entry->version = __atomic_load_n(rcache_version(rcache, line), __ATOMIC_ACQUIRE);
+	entry->freq = 0;
+	entry->state = RCACHE_LINE_FILLING;
+
+	hash = rcache_hash(rch, line);
+	entry->hash_next = rch->hash[hash];
+	rch->hash[hash] = entry;
+
+	return entry;
+}
+
+/* Put a filled cache line in the main queue if it was evicted recently, in the small one
+ * otherwise.
+ */
+static void
+rcache_line_insert(struct rcache_io_channel *rch, struct rcache_line *entry)
+{
+	assert(entry->state == RCACHE_LINE_FILLING);
+
+	if (rcache_ghost_remove(rch, entry->line)) {
+		entry->state = RCACHE_LINE_MAIN;
+		TAILQ_INSERT_TAIL(&rch->main, entry, link);
+	} else {
+		entry->state = RCACHE_LINE_SMALL;
+		TAILQ_INSERT_TAIL(&rch->small, entry, link);
+		rch->num_small++;
+	}
+}
+
+/* Copy the part of a cache line covered by the read to its buffers */
+static void
+rcache_line_copy_out(struct vbdev_rcache *rcache, struct spdk_bdev_io *bdev_io,
+		     struct rcache_line *entry)
+{
+	uint32_t blocklen = rcache->rcache_bdev.blocklen;
+	uint64_t line_start = entry->line << rcache->line_shift;
+	uint64_t line_end = line_start + (1ULL << rcache->line_shift);
+	uint64_t start = spdk_max(line_start, bdev_io->u.bdev.offset_blocks);
+	uint64_t end = spdk_min(line_end, bdev_io->u.bdev.offset_blocks +
+				bdev_io->u.bdev.num_blocks);
+	uint8_t *src = entry->buf + (start - line_start) * blocklen;
+	size_t offset = (start - bdev_io->u.bdev.offset_blocks) * blocklen;
+	size_t len = (end - start) * blocklen, n;
+	struct iovec *iov;
+	int i;
+
+	for (i = 0; i < bdev_io->u.bdev.iovcnt && len > 0; i++) {
+		iov = &bdev_io->u.bdev.iovs[i];
+		if (offset >= iov->iov_len) {
+			offset -= iov->iov_len;
+			continue;
+		}
+
+		n = spdk_min(len, iov->iov_len - offset);
+		memcpy((uint8_t *)iov->iov_base + offset, src, n);
+		src += n;
+		len -= n;
+		offset = 0;
+	}
+}
+
+/* Callback for unregistering the IO device. */
+static void
+_device_unregister_cb(void *io_device)
+{
+	struct vbdev_rcache *rcache = io_device;
+
+	free(rcache->versions);
+	free(rcache->rcache_bdev.name);
+	free(rcache);
+}
+
+static void
+_vbdev_rcache_destruct(void *ctx)
+{
+	struct spdk_bdev_desc *desc = ctx;
+
+	spdk_bdev_close(desc);
+}
+
+static int
+vbdev_rcache_destruct(void *ctx)
+{
+	struct vbdev_rcache *rcache = (struct vbdev_rcache *)ctx;
+
+	TAILQ_REMOVE(&g_rcache_nodes, rcache, link);
+
+	/* Unclaim the underlying bdev. */
+	spdk_bdev_module_release_bdev(rcache->base_bdev);
+
+	/* Close the underlying bdev on its same opened thread. */
+	if (rcache->thread && rcache->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(rcache->thread, _vbdev_rcache_destruct, rcache->base_desc);
+	} else {
+		spdk_bdev_close(rcache->base_desc);
+	}
+
+	/* Unregister the io_device. */
+	spdk_io_device_unregister(rcache, _device_unregister_cb);
+
+	return 0;
+}
+
+static void
+rcache_queue_io(struct spdk_bdev_io *bdev_io, spdk_bdev_io_wait_cb cb_fn)
+{
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)bdev_io->driver_ctx;
+	struct rcache_io_channel *rch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	io_ctx->bdev_io_wait.bdev = bdev_io->bdev;
+	io_ctx->bdev_io_wait.cb_fn = cb_fn;
+	io_ctx->bdev_io_wait.cb_arg = bdev_io;
+
+	/* Queue the IO using the channel of the base device. */
+	rc = spdk_bdev_queue_io_wait(bdev_io->bdev, rch->base_ch, &io_ctx->bdev_io_wait);
+	if (rc != 0) {
+		SPDK_ERRLOG("Queue io failed in rcache_queue_io, rc=%d.\n", rc);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+_rcache_complete_io(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+
+	spdk_bdev_io_complete_base_io_status(orig_io, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+_rcache_complete_write(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct vbdev_rcache *rcache = SPDK_CONTAINEROF(orig_io->bdev, struct vbdev_rcache,
+				      rcache_bdev);
+
+	/* Lines filled while the write was in progress may hold the old data */
+	rcache_invalidate(rcache, orig_io->u.bdev.offset_blocks, orig_io->u.bdev.num_blocks);
+
+	spdk_bdev_io_complete_base_io_status(orig_io, bdev_io);
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void
+rcache_read_base(void *ctx)
+{
+	struct spdk_bdev_io *bdev_io = ctx;
+	struct vbdev_rcache *rcache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_rcache,
+				      rcache_bdev);
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)bdev_io->driver_ctx;
+	struct rcache_io_channel *rch = spdk_io_channel_get_ctx(io_ctx->ch);
+	int rc;
+
+	rc = spdk_bdev_readv_blocks(rcache->base_desc, rch->base_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.num_blocks, _rcache_complete_io, bdev_io);
+	if (rc == -ENOMEM) {
+		rcache_queue_io(bdev_io, rcache_read_base);
+	} else if (rc != 0) {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static void
+rcache_fill_done(struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_rcache *rcache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_rcache,
+				      rcache_bdev);
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)bdev_io->driver_ctx;
+	struct rcache_io_channel *rch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct rcache_line *entry;
+	uint32_t i;
+
+	for (i = 0; i < io_ctx->num_lines; i++) {
+		if (!(io_ctx->fill_mask & (1U << i))) {
+			continue;
+		}
+
+		entry = rcache_line_lookup(rch, io_ctx->first_line + i);
+		assert(entry != NULL && entry->state == RCACHE_LINE_FILLING);
+		if (io_ctx->failed) {
+			rcache_line_free(rch, entry);
+		} else {
+			rcache_line_copy_out(rcache, bdev_io, entry);
+			rcache_line_insert(rch, entry);
+		}
+	}
+
+	spdk_bdev_io_complete(bdev_io, io_ctx->failed ? SPDK_BDEV_IO_STATUS_FAILED :
+			      SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static inline bool
+rcache_fill_is_done(struct rcache_bdev_io *io_ctx)
+{
+	return io_ctx->outstanding == 0 && !io_ctx->waiting &&
+	       (io_ctx->failed || io_ctx->next_line == io_ctx->num_lines);
+}
+
+static void
+rcache_fill_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *orig_io = cb_arg;
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)orig_io->driver_ctx;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		io_ctx->failed = true;
+	}
+
+	assert(io_ctx->outstanding > 0);
+	io_ctx->outstanding--;
+	if (rcache_fill_is_done(io_ctx)) {
+		rcache_fill_done(orig_io);
+	}
+}
+
+/* Read each run of consecutive cache lines that are being filled with a single I/O */
+static void
+rcache_fill_submit(void *ctx)
+{
+	struct spdk_bdev_io *bdev_io = ctx;
+	struct vbdev_rcache *rcache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_rcache,
+				      rcache_bdev);
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)bdev_io->driver_ctx;
+	struct rcache_io_channel *rch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct rcache_line *entry;
+	uint64_t line;
+	uint32_t i;
+	int rc;
+
+	io_ctx->waiting = false;
+	/* Keep the read from completing before all the runs are submitted */
+	io_ctx->outstanding++;
+
+	while (!io_ctx->failed && io_ctx->next_line < io_ctx->num_lines) {
+		if (!(io_ctx->fill_mask & (1U << io_ctx->next_line))) {
+			io_ctx->next_line++;
+			continue;
+		}
+
+		line = io_ctx->first_line + io_ctx->next_line;
+		for (i = io_ctx->next_line; i < io_ctx->num_lines; i++) {
+			if (!(io_ctx->fill_mask & (1U << i))) {
+				break;
+			}
+			entry = rcache_line_lookup(rch, io_ctx->first_line + i);
+			assert(entry != NULL);
+			io_ctx->iovs[i].iov_base = entry->buf;
+			io_ctx->iovs[i].iov_len = rcache->line_size;
+		}
+
+		rc = spdk_bdev_readv_blocks(rcache->base_desc, rch->base_ch,
+					    &io_ctx->iovs[io_ctx->next_line], i - io_ctx->next_line,
+					    line << rcache->line_shift,
+					    (uint64_t)(i - io_ctx->next_line) << rcache->line_shift,
+					    rcache_fill_complete, bdev_io);
+		if (rc == -ENOMEM) {
+			io_ctx->waiting = true;
+			rcache_queue_io(bdev_io, rcache_fill_submit);
+			break;
+		} else if (rc != 0) {
+			SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+			io_ctx->failed = true;
+			break;
+		}
+
+		io_ctx->outstanding++;
+		io_ctx->next_line = i;
+	}
+
+	io_ctx->outstanding--;
+	if (rcache_fill_is_done(io_ctx)) {
+		rcache_fill_done(bdev_io);
+	}
+}
+
+static void
+rcache_read(struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_rcache *rcache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_rcache,
+				      rcache_bdev);
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)bdev_io->driver_ctx;
+	struct rcache_io_channel *rch = spdk_io_channel_get_ctx(io_ctx->ch);
+	struct rcache_line *entry;
+	uint64_t first, last, line;
+	bool hit = true;
+
+	first = bdev_io->u.bdev.offset_blocks >> rcache->line_shift;
+	last = (bdev_io->u.bdev.offset_blocks + bdev_io->u.bdev.num_blocks - 1) >>
+	       rcache->line_shift;
+	if (last - first >= RCACHE_MAX_IO_LINES || last >= rcache->num_lines) {
+		rch->stats.bypassed++;
+		rcache_read_base(bdev_io);
+		return;
+	}
+
+	/* Serve the cached lines before making room for the missing ones, which may evict them */
+	for (line = first; line <= last; line++) {
+		entry = rcache_line_lookup(rch, line);
+		if (entry == NULL) {
+			hit = false;
+			continue;
+		}
+
+		if (entry->state == RCACHE_LINE_FILLING) {
+			/* Already being read by another I/O, don't wait for it */
+			rch->stats.bypassed++;
+			rcache_read_base(bdev_io);
+			return;
+		}
+
+		if (!rcache_line_is_current(rcache, entry)) {
+			rcache_line_free(rch, entry);
+			rch->stats.invalidations++;
+			hit = false;
+			continue;
+		}
+
+		rcache_line_copy_out(rcache, bdev_io, entry);
+		entry->freq = spdk_min(entry->freq + 1, RCACHE_MAX_FREQ);
+	}
+
+	if (hit) {
+		rch->stats.hits++;
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+		return;
+	}
+
+	io_ctx->first_line = first;
+	io_ctx->num_lines = last - first + 1;
+	io_ctx->fill_mask = 0;
+	io_ctx->next_line = 0;
+	io_ctx->outstanding = 0;
+	io_ctx->waiting = false;
+	io_ctx->failed = false;
+
+	for (line = first; line <= last; line++) {
+		if (rcache_line_lookup(rch, line) != NULL) {
+			continue;
+		}
+
+		if (rcache_line_alloc(rch, rcache, line) == NULL) {
+			break;
+		}
+		io_ctx->fill_mask |= 1U << (line - first);
+	}
+
+	if (line <= last) {
+		/* Every line of the shard is being filled, read the base bdev instead */
+		for (line = first; line <= last; line++) {
+			if (io_ctx->fill_mask & (1U << (line - first))) {
+				rcache_line_free(rch, rcache_line_lookup(rch, line));
+			}
+		}
+		rch->stats.bypassed++;
+		rcache_read_base(bdev_io);
+		return;
+	}
+
+	rch->stats.misses++;
+	rcache_fill_submit(bdev_io);
+}
+
+static void
+rcache_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	rcache_read(bdev_io);
+}
+
+static void
+vbdev_rcache_resubmit_io(void *arg)
+{
+	struct spdk_bdev_io *bdev_io = (struct spdk_bdev_io *)arg;
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)bdev_io->driver_ctx;
+
+	vbdev_rcache_submit_request(io_ctx->ch, bdev_io);
+}
+
+static void
+vbdev_rcache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_rcache *rcache = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_rcache,
+				      rcache_bdev);
+	struct rcache_io_channel *rch = spdk_io_channel_get_ctx(ch);
+	struct rcache_bdev_io *io_ctx = (struct rcache_bdev_io *)bdev_io->driver_ctx;
+	int rc = 0;
+
+	io_ctx->ch = ch;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, rcache_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		return;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		rcache_invalidate(rcache, bdev_io->u.bdev.offset_blocks,
+				  bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_writev_blocks(rcache->base_desc, rch->base_ch, bdev_io->u.bdev.iovs,
+					     bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+					     bdev_io->u.bdev.num_blocks, _rcache_complete_write,
+					     bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		rcache_invalidate(rcache, bdev_io->u.bdev.offset_blocks,
+				  bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_write_zeroes_blocks(rcache->base_desc, rch->base_ch,
+						   bdev_io->u.bdev.offset_blocks,
+						   bdev_io->u.bdev.num_blocks,
+						   _rcache_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+		rcache_invalidate(rcache, bdev_io->u.bdev.offset_blocks,
+				  bdev_io->u.bdev.num_blocks);
+		rc = spdk_bdev_unmap_blocks(rcache->base_desc, rch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _rcache_complete_write, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		rc = spdk_bdev_flush_blocks(rcache->base_desc, rch->base_ch,
+					    bdev_io->u.bdev.offset_blocks,
+					    bdev_io->u.bdev.num_blocks,
+					    _rcache_complete_io, bdev_io);
+		break;
+	case SPDK_BDEV_IO_TYPE_RESET:
+		rc = spdk_bdev_reset(rcache->base_desc, rch->base_ch,
+				     _rcache_complete_io, bdev_io);
+		break;
+	default:
+		SPDK_ERRLOG("rcache: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	if (rc == -ENOMEM) {
+		rcache_queue_io(bdev_io, vbdev_rcache_resubmit_io);
+	} else if (rc != 0) {
+		SPDK_ERRLOG("ERROR on bdev_io submission!\n");
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+	}
+}
+
+static bool
+vbdev_rcache_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	struct vbdev_rcache *rcache = (struct vbdev_rcache *)ctx;
+
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+	case SPDK_BDEV_IO_TYPE_UNMAP:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+	case SPDK_BDEV_IO_TYPE_RESET:
+		return spdk_bdev_io_type_supported(rcache->base_bdev, io_type);
+	default:
+		/* I/O types modifying the data that we don't know how to invalidate */
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_rcache_get_io_channel(void *ctx)
+{
+	struct vbdev_rcache *rcache = (struct vbdev_rcache *)ctx;
+
+	return spdk_get_io_channel(rcache);
+}
+
+static int
+vbdev_rcache_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_rcache *rcache = (struct vbdev_rcache *)ctx;
+
+	spdk_json_write_name(w, "rcache");
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&rcache->rcache_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(rcache->base_bdev));
+	spdk_json_write_named_uint64(w, "shard_size_mib", rcache->shard_size_mib);
+	spdk_json_write_named_uint32(w, "line_size", rcache->line_size);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+vbdev_rcache_config_json(struct spdk_json_write_ctx *w)
+{
+	struct vbdev_rcache *rcache;
+
+	TAILQ_FOREACH(rcache, &g_rcache_nodes, link) {
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "method", "bdev_rcache_create");
+		spdk_json_write_named_object_begin(w, "params");
+		spdk_json_write_named_string(w, "base_bdev_name",
+					     spdk_bdev_get_name(rcache->base_bdev));
+		spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&rcache->rcache_bdev));
+		spdk_json_write_named_uint64(w, "shard_size_mib", rcache->shard_size_mib);
+		spdk_json_write_named_uint32(w, "line_size", rcache->line_size);
+		spdk_json_write_object_end(w);
+		spdk_json_write_object_end(w);
+	}
+
+	return 0;
+}
+
+static void
+rcache_bdev_ch_free(struct rcache_io_channel *rch)
+{
+	spdk_dma_free(rch->buf);
+	free(rch->lines);
+	free(rch->hash);
+	free(rch->ghost);
+}
+
+/* Each channel allocates its shard of the cache from the hugepage memory of its NUMA node. */
+static int
+rcache_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	struct rcache_io_channel *rch = ctx_buf;
+	struct vbdev_rcache *rcache = io_device;
+	uint32_t core = spdk_env_get_current_core();
+	int32_t numa_id = SPDK_ENV_NUMA_ID_ANY;
+	uint64_t i, hash_size;
+
+	if (core != SPDK_ENV_LCORE_ID_ANY) {
+		numa_id = spdk_env_get_numa_id(core);
+	}
+
+	rch->num_lines = rcache->shard_size_mib * 1024 * 1024 / rcache->line_size;
+	hash_size = spdk_align64pow2(rch->num_lines);
+	rch->hash_mask = hash_size - 1;
+	rch->max_small = spdk_max(rch->num_lines * RCACHE_SMALL_QUEUE_PERCENT / 100, 1);
+
+	rch->buf = spdk_dma_malloc_socket(rch->num_lines * rcache->line_size, rcache->line_size,
+					  NULL, numa_id);
+	rch->lines = calloc(rch->num_lines, sizeof(*rch->lines));
+	rch->hash = calloc(hash_size, sizeof(*rch->hash));
+	rch->ghost = calloc(hash_size, sizeof(*rch->ghost));
+	if (rch->buf == NULL || rch->lines == NULL || rch->hash == NULL || rch->ghost == NULL) {
+		SPDK_ERRLOG("Failed to allocate %" PRIu64 " MiB read cache for %s\n",
+			    rcache->shard_size_mib, spdk_bdev_get_name(&rcache->rcache_bdev));
+		rcache_bdev_ch_free(rch);
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&rch->free_lines);
+	TAILQ_INIT(&rch->small);
+	TAILQ_INIT(&rch->main);
+	for (i = 0; i < rch->num_lines; i++) {
+		rch->lines[i].buf = rch->buf + i * rcache->line_size;
+		TAILQ_INSERT_TAIL(&rch->free_lines, &rch->lines[i], link);
+	}
+
+	rch->base_ch = spdk_bdev_get_io_channel(rcache->base_desc);
+	if (rch->base_ch == NULL) {
+		rcache_bdev_ch_free(rch);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void
+rcache_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+	struct rcache_io_channel *rch = ctx_buf;
+
+	spdk_put_io_channel(rch->base_ch);
+	rcache_bdev_ch_free(rch);
+}
+
+static struct vbdev_rcache *
+vbdev_rcache_find(const char *vbdev_name)
+{
+	struct vbdev_rcache *rcache;
+
+	TAILQ_FOREACH(rcache, &g_rcache_nodes, link) {
+		if (strcmp(spdk_bdev_get_name(&rcache->rcache_bdev), vbdev_name) == 0) {
+			return rcache;
+		}
+	}
+
+	return NULL;
+}
+
+static int
+vbdev_rcache_insert_association(const struct vbdev_rcache_opts *opts)
+{
+	struct bdev_association *assoc;
+
+	TAILQ_FOREACH(assoc, &g_bdev_associations, link) {
+		if (strcmp(opts->name, assoc->vbdev_name) == 0) {
+			SPDK_ERRLOG("rcache bdev %s already exists\n", opts->name);
+			return -EEXIST;
+		}
+	}
+
+	assoc = calloc(1, sizeof(struct bdev_association));
+	if (!assoc) {
+		SPDK_ERRLOG("could not allocate bdev_association\n");
+		return -ENOMEM;
+	}
+
+	assoc->bdev_name = strdup(opts->base_bdev_name);
+	assoc->vbdev_name = strdup(opts->name);
+	if (!assoc->bdev_name || !assoc->vbdev_name) {
+		SPDK_ERRLOG("could not allocate bdev_association names\n");
+		free(assoc->bdev_name);
+		free(assoc->vbdev_name);
+		free(assoc);
+		return -ENOMEM;
+	}
+
+	assoc->shard_size_mib = opts->shard_size_mib;
+	assoc->line_size = opts->line_size;
+	TAILQ_INSERT_TAIL(&g_bdev_associations, assoc, link);
+
+	return 0;
+}
+
+static void
+vbdev_rcache_remove_association(const char *vbdev_name)
+{
+	struct bdev_association *assoc;
+
+	TAILQ_FOREACH(assoc, &g_bdev_associations, link) {
+		if (strcmp(assoc->vbdev_name, vbdev_name) == 0) {
+			TAILQ_REMOVE(&g_bdev_associations, assoc, link);
+			free(assoc->bdev_name);
+			free(assoc->vbdev_name);
+			free(assoc);
+			break;
+		}
+	}
+}
+
+static int
+vbdev_rcache_init(void)
+{
+	return 0;
+}
+
+static void
+vbdev_rcache_finish(void)
+{
+	struct bdev_association *assoc;
+
+	while ((assoc = TAILQ_FIRST(&g_bdev_associations))) {
+		TAILQ_REMOVE(&g_bdev_associations, assoc, link);
+		free(assoc->bdev_name);
+		free(assoc->vbdev_name);
+		free(assoc);
+	}
+}
+
+static int
+vbdev_rcache_get_ctx_size(void)
+{
+	return sizeof(struct rcache_bdev_io);
+}
+
+static void
+vbdev_rcache_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w)
+{
+	/* No config per bdev needed */
+}
+
+static const struct spdk_bdev_fn_table vbdev_rcache_fn_table = {
+	.destruct		= vbdev_rcache_destruct,
+	.submit_request		= vbdev_rcache_submit_request,
+	.io_type_supported	= vbdev_rcache_io_type_supported,
+	.get_io_channel		= vbdev_rcache_get_io_channel,
+	.dump_info_json		= vbdev_rcache_dump_info_json,
+	.write_config_json	= vbdev_rcache_write_config_json,
+};
+
+static void
+vbdev_rcache_base_bdev_hotremove_cb(struct spdk_bdev *bdev_find)
+{
+	struct vbdev_rcache *rcache, *tmp;
+
+	TAILQ_FOREACH_SAFE(rcache, &g_rcache_nodes, link, tmp) {
+		if (bdev_find == rcache->base_bdev) {
+			spdk_bdev_unregister(&rcache->rcache_bdev, NULL, NULL);
+		}
+	}
+}
+
+static void
+vbdev_rcache_base_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
+				void *event_ctx)
+{
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		vbdev_rcache_base_bdev_hotremove_cb(bdev);
+		break;
+	default:
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+static int
+vbdev_rcache_register(const char *bdev_name)
+{
+	struct bdev_association *assoc;
+	struct vbdev_rcache *rcache;
+	struct spdk_bdev *bdev;
+	struct spdk_uuid ns_uuid;
+	int rc = 0;
+
+	spdk_uuid_parse(&ns_uuid, BDEV_RCACHE_NAMESPACE_UUID);
+
+	TAILQ_FOREACH(assoc, &g_bdev_associations, link) {
+		if (strcmp(assoc->bdev_name, bdev_name) != 0 ||
+		    vbdev_rcache_find(assoc->vbdev_name) != NULL) {
+			continue;
+		}
+
+		rcache = calloc(1, sizeof(struct vbdev_rcache));
+		if (!rcache) {
+			rc = -ENOMEM;
+			SPDK_ERRLOG("could not allocate rcache\n");
+			break;
+		}
+
+		rcache->versions = calloc(RCACHE_NUM_VERSIONS, sizeof(*rcache->versions));
+		rcache->rcache_bdev.name = strdup(assoc->vbdev_name);
+		if (!rcache->versions || !rcache->rcache_bdev.name) {
+			rc = -ENOMEM;
+			SPDK_ERRLOG("could not allocate rcache\n");
+			free(rcache->versions);
+			free(rcache->rcache_bdev.name);
+			free(rcache);
+			break;
+		}
+		rcache->rcache_bdev.product_name = "rcache";
+
+		rc = spdk_bdev_open_ext(bdev_name, true, vbdev_rcache_base_bdev_event_cb,
+					NULL, &rcache->base_desc);
+		if (rc) {
+			if (rc != -ENODEV) {
+				SPDK_ERRLOG("could not open bdev %s\n", bdev_name);
+			}
+			goto error_free;
+		}
+
+		bdev = spdk_bdev_desc_get_bdev(rcache->base_desc);
+		rcache->base_bdev = bdev;
+
+		if (spdk_bdev_is_md_separate(bdev)) {
+			SPDK_ERRLOG("rcache bdev %s: separate metadata is not supported\n",
+				    assoc->vbdev_name);
+			rc = -ENOTSUP;
+			goto error_close;
+		}
+
+		if (assoc->line_size < bdev->blocklen || assoc->line_size % bdev->blocklen != 0 ||
+		    !spdk_u32_is_pow2(assoc->line_size / bdev->blocklen)) {
+			SPDK_ERRLOG("rcache bdev %s: line size %" PRIu32
+				    " doesn't match block size %" PRIu32 "\n",
+				    assoc->vbdev_name, assoc->line_size, bdev->blocklen);
+			rc = -EINVAL;
+			goto error_close;
+		}
+
+		rcache->shard_size_mib = assoc->shard_size_mib;
+		rcache->line_size = assoc->line_size;
+		rcache->line_shift = spdk_u32log2(assoc->line_size / bdev->blocklen);
+		rcache->num_lines = bdev->blockcnt >> rcache->line_shift;
+
+		/* Generate UUID based on namespace UUID + base bdev UUID. */
+		rc = spdk_uuid_generate_sha1(&rcache->rcache_bdev.uuid, &ns_uuid,
+					     (const char *)&bdev->uuid, sizeof(struct spdk_uuid));
+		if (rc) {
+			SPDK_ERRLOG("Unable to generate new UUID for rcache bdev\n");
+			goto error_close;
+		}
+
+		/* Copy some properties from the underlying base bdev. */
+		rcache->rcache_bdev.write_cache = bdev->write_cache;
+		rcache->rcache_bdev.required_alignment = bdev->required_alignment;
+		rcache->rcache_bdev.optimal_io_boundary = bdev->optimal_io_boundary;
+		rcache->rcache_bdev.blocklen = bdev->blocklen;
+		rcache->rcache_bdev.blockcnt = bdev->blockcnt;
+
+		rcache->rcache_bdev.md_interleave = bdev->md_interleave;
+		rcache->rcache_bdev.md_len = bdev->md_len;
+		rcache->rcache_bdev.dif_type = bdev->dif_type;
+		rcache->rcache_bdev.dif_is_head_of_md = bdev->dif_is_head_of_md;
+		rcache->rcache_bdev.dif_check_flags = bdev->dif_check_flags;
+		rcache->rcache_bdev.dif_pi_format = bdev->dif_pi_format;
+
+		rcache->rcache_bdev.numa = bdev->numa;
+
+		rcache->rcache_bdev.ctxt = rcache;
+		rcache->rcache_bdev.fn_table = &vbdev_rcache_fn_table;
+		rcache->rcache_bdev.module = &rcache_if;
+		TAILQ_INSERT_TAIL(&g_rcache_nodes, rcache, link);
+
+		spdk_io_device_register(rcache, rcache_bdev_ch_create_cb, rcache_bdev_ch_destroy_cb,
+					sizeof(struct rcache_io_channel), assoc->vbdev_name);
+
+		/* Save the thread where the base device is opened */
+		rcache->thread = spdk_get_thread();
+
+		rc = spdk_bdev_module_claim_bdev(bdev, rcache->base_desc,
+						 rcache->rcache_bdev.module);
+		if (rc) {
+			SPDK_ERRLOG("could not claim bdev %s\n", bdev_name);
+			goto error_unregister;
+		}
+
+		rc = spdk_bdev_register(&rcache->rcache_bdev);
+		if (rc) {
+			SPDK_ERRLOG("could not register rcache_bdev\n");
+			spdk_bdev_module_release_bdev(rcache->base_bdev);
+			goto error_unregister;
+		}
+
+		continue;
+
+error_unregister:
+		TAILQ_REMOVE(&g_rcache_nodes, rcache, link);
+		spdk_io_device_unregister(rcache, NULL);
+error_close:
+		spdk_bdev_close(rcache->base_desc);
+error_free:
+		free(rcache->versions);
+		free(rcache->rcache_bdev.name);
+		free(rcache);
+		break;
+	}
+
+	return rc;
+}
+
+int
+create_rcache_disk(const struct vbdev_rcache_opts *opts)
+{
+	struct vbdev_rcache_opts _opts = *opts;
+	int rc;
+
+	if (_opts.shard_size_mib == 0) {
+		_opts.shard_size_mib = VBDEV_RCACHE_DEFAULT_SHARD_SIZE_MIB;
+	}
+	if (_opts.line_size == 0) {
+		_opts.line_size = VBDEV_RCACHE_DEFAULT_LINE_SIZE;
+	}
+
+	if (!spdk_u32_is_pow2(_opts.line_size) || _opts.line_size > VBDEV_RCACHE_MAX_LINE_SIZE) {
+		SPDK_ERRLOG("Line size must be a power of 2 not larger than %u\n",
+			    VBDEV_RCACHE_MAX_LINE_SIZE);
+		return -EINVAL;
+	}
+
+	rc = vbdev_rcache_insert_association(&_opts);
+	if (rc) {
+		return rc;
+	}
+
+	rc = vbdev_rcache_register(_opts.base_bdev_name);
+	if (rc == -ENODEV) {
+		/* This is not an error, we tracked the name above and it still
+		 * may show up later.
+		 */
+		SPDK_NOTICELOG("vbdev creation deferred pending base bdev arrival\n");
+		rc = 0;
+	} else if (rc != 0) {
+		vbdev_rcache_remove_association(_opts.name);
+	}
+
+	return rc;
+}
+
+void
+delete_rcache_disk(const char *vbdev_name, spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	int rc;
+
+	rc = spdk_bdev_unregister_by_name(vbdev_name, &rcache_if, cb_fn, cb_arg);
+	if (rc == 0) {
+		vbdev_rcache_remove_association(vbdev_name);
+	} else {
+		cb_fn(cb_arg, rc);
+	}
+}
+
+struct rcache_get_stats_ctx {
+	struct vbdev_rcache_stats	stats;
+	vbdev_rcache_get_stats_cb	cb_fn;
+	void				*cb_arg;
+};
+
+static void
+rcache_get_stats_channel(struct spdk_io_channel_iter *i)
+{
+	struct rcache_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
+	struct rcache_io_channel *rch = spdk_io_channel_get_ctx(ch);
+
+	ctx->stats.hits += rch->stats.hits;
+	ctx->stats.misses += rch->stats.misses;
+	ctx->stats.bypassed += rch->stats.bypassed;
+	ctx->stats.evictions += rch->stats.evictions;
+	ctx->stats.invalidations += rch->stats.invalidations;
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+rcache_get_stats_done(struct spdk_io_channel_iter *i, int status)
+{
+	struct rcache_get_stats_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	ctx->cb_fn(ctx->cb_arg, &ctx->stats, status);
+	free(ctx);
+}
+
+int
+vbdev_rcache_get_stats(const char *vbdev_name, vbdev_rcache_get_stats_cb cb_fn, void *cb_arg)
+{
+	struct vbdev_rcache *rcache;
+	struct rcache_get_stats_ctx *ctx;
+
+	rcache = vbdev_rcache_find(vbdev_name);
+	if (rcache == NULL) {
+		return -ENODEV;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	spdk_for_each_channel(rcache, rcache_get_stats_channel, ctx, rcache_get_stats_done);
+
+	return 0;
+}
+
+static void
+vbdev_rcache_examine(struct spdk_bdev *bdev)
+{
+	vbdev_rcache_register(bdev->name);
+
+	spdk_bdev_module_examine_done(&rcache_if);
+}
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_rcache)
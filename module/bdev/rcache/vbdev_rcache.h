@@ -0,0 +1,77 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_RCACHE_H
+#define SPDK_VBDEV_RCACHE_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+#include "spdk/bdev_module.h"
+
+#define VBDEV_RCACHE_DEFAULT_SHARD_SIZE_MIB	64
+#define VBDEV_RCACHE_DEFAULT_LINE_SIZE		4096
+#define VBDEV_RCACHE_MAX_LINE_SIZE		(128 * 1024)
+
+/* Options used to create a new read cache vbdev on top of a base bdev. */
+struct vbdev_rcache_opts {
+	/* Name of the read cache vbdev to create */
+	const char	*name;
+	/* Name of the base bdev */
+	const char	*base_bdev_name;
+	/* Size of the cache kept by each thread doing I/O to the vbdev, in MiB */
+	uint64_t	shard_size_mib;
+	/* Size of a cache line in bytes */
+	uint32_t	line_size;
+};
+
+/* Read cache statistics, summed up over all the threads. */
+struct vbdev_rcache_stats {
+	/* Reads served entirely from the cache */
+	uint64_t	hits;
+	/* Reads that needed at least one cache line to be read from the base bdev */
+	uint64_t	misses;
+	/* Reads passed to the base bdev without going through the cache */
+	uint64_t	bypassed;
+	/* Cache lines evicted to make room for new ones */
+	uint64_t	evictions;
+	/* Cache lines dropped because of a write to the same range */
+	uint64_t	invalidations;
+};
+
+typedef void (*vbdev_rcache_get_stats_cb)(void *cb_arg, const struct vbdev_rcache_stats *stats,
+		int rc);
+
+/**
+ * Create a read cache vbdev on top of the base bdev.
+ *
+ * The vbdev is created once the base bdev shows up, if it doesn't exist yet.
+ *
+ * \param opts Read cache vbdev options.
+ * \return 0 on success, negative errno on failure.
+ */
+int create_rcache_disk(const struct vbdev_rcache_opts *opts);
+
+/**
+ * Delete a read cache vbdev.
+ *
+ * \param vbdev_name Read cache bdev name.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void delete_rcache_disk(const char *vbdev_name, spdk_bdev_unregister_cb cb_fn, void *cb_arg);
+
+/**
+ * Get the statistics of a read cache vbdev, summed up over all its channels.
+ *
+ * \param vbdev_name Read cache bdev name.
+ * \param cb_fn Function to call with the statistics.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if collecting the statistics was started, -ENODEV if there is no such read cache
+ * bdev, -ENOMEM if memory allocation failed. cb_fn is only called if 0 is returned.
+ */
+int vbdev_rcache_get_stats(const char *vbdev_name, vbdev_rcache_get_stats_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_RCACHE_H */
@@ -0,0 +1,142 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_rcache.h"
+
+#include "spdk/rpc.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+#include "spdk_internal/rpc_autogen.h"
+
+static void
+rpc_bdev_rcache_create(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_rcache_create_ctx req = {};
+	struct vbdev_rcache_opts opts = {};
+	struct spdk_json_write_ctx *w;
+	int rc;
+
+	if (spdk_json_decode_object(params, rpc_bdev_rcache_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_rcache_create_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	opts.name = req.name;
+	opts.base_bdev_name = req.base_bdev_name;
+	opts.shard_size_mib = req.shard_size_mib;
+	opts.line_size = req.line_size;
+
+	rc = create_rcache_disk(&opts);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_string(w, req.name);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_rcache_create(&req);
+}
+SPDK_RPC_REGISTER("bdev_rcache_create", rpc_bdev_rcache_create, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_rcache_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_rcache_delete(struct spdk_jsonrpc_request *request,
+		       const struct spdk_json_val *params)
+{
+	struct rpc_bdev_rcache_delete_ctx req = {};
+
+	if (spdk_json_decode_object(params, rpc_bdev_rcache_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_rcache_delete_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	delete_rcache_disk(req.name, rpc_bdev_rcache_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_rcache_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_rcache_delete", rpc_bdev_rcache_delete, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_rcache_get_stats_cb(void *cb_arg, const struct vbdev_rcache_stats *stats, int rc)
+{
+	struct rpc_bdev_rcache_get_stats_ctx *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(req->request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	w = spdk_jsonrpc_begin_result(req->request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", req->name);
+	spdk_json_write_named_uint64(w, "hits", stats->hits);
+	spdk_json_write_named_uint64(w, "misses", stats->misses);
+	spdk_json_write_named_uint64(w, "bypassed", stats->bypassed);
+	spdk_json_write_named_uint64(w, "evictions", stats->evictions);
+	spdk_json_write_named_uint64(w, "invalidations", stats->invalidations);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(req->request, w);
+
+cleanup:
+	free_rpc_bdev_rcache_get_stats_heap(req);
+}
+
+static void
+rpc_bdev_rcache_get_stats(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_rcache_get_stats_ctx *req;
+	int rc;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (spdk_json_decode_object(params, rpc_bdev_rcache_get_stats_decoders,
+				    SPDK_COUNTOF(rpc_bdev_rcache_get_stats_decoders),
+				    req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	req->request = request;
+	rc = vbdev_rcache_get_stats(req->name, rpc_bdev_rcache_get_stats_cb, req);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	return;
+
+cleanup:
+	free_rpc_bdev_rcache_get_stats_heap(req);
+}
+SPDK_RPC_REGISTER("bdev_rcache_get_stats", rpc_bdev_rcache_get_stats, SPDK_RPC_RUNTIME)
@@ -0,0 +1,2086 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_wbcache.h"
+
+#include "spdk/bdev_module.h"
+#include "spdk/crc32.h"
+#include "spdk/env.h"
+#include "spdk/likely.h"
+#include "spdk/log.h"
+#include "spdk/string.h"
+#include "spdk/thread.h"
+#include "spdk/util.h"
+#include "spdk/uuid.h"
+
+#define WBCACHE_SB_SIGNATURE	"SPDKWBCH"
+#define WBCACHE_SB_VERSION	1
+#define WBCACHE_LOG_MAGIC	0x474f4c4548434257ULL /* "WBCHELOG" */
+
+/* Reads, writes and flushes in flight on the metadata thread, each one owns a header buffer */
+#define WBCACHE_NUM_REQS	128
+/* Largest record the log takes, in data blocks, and the iovecs of the I/O carrying it */
+#define WBCACHE_MAX_IO_BLOCKS	128
+#define WBCACHE_MAX_IOVS	32
+/* A read is split into runs of blocks in the log and on the backing bdev, each one can add an
+ * iovec */
+#define WBCACHE_REQ_IOVS	(WBCACHE_MAX_IOVS + WBCACHE_MAX_IO_BLOCKS)
+/* Maximum number of log blocks destaged in a batch, also the size of the replay window */
+#define WBCACHE_DESTAGE_BLOCKS	1024
+/* Number of writes to the backing bdev in flight during destage and their number of iovecs */
+#define WBCACHE_DESTAGE_QD	32
+#define WBCACHE_DESTAGE_IOVS	32
+#define WBCACHE_BUF_ALIGN	0x1000
+
+SPDK_STATIC_ASSERT(WBCACHE_DESTAGE_BLOCKS >= WBCACHE_MAX_IO_BLOCKS + 1, "destage batch too small");
+
+/*
+ * On-disk layout of the cache bdev:
+ *
+ * | superblock | log ... |
+ *
+ * Each write to the vbdev is appended to the log as a record, a header block followed by the
+ * data blocks, with a single write to the cache bdev.  Records are placed one after another and
+ * wrap around to the start of the log when the next one doesn't fit before its end.  The header
+ * holds a sequence number which increases by one with each record, and the checksums of itself
+ * and of the data, so the end of the log is found by reading the records until one doesn't
+ * match the expected sequence number or checksums.  Records are written concurrently, so a
+ * write is completed only once its record and all the earlier ones are written.
+ *
+ * Records are destaged to the backing bdev from the oldest one, in batches.  The blocks of a
+ * batch that were not overwritten by a later record are sorted by LBA and written to the
+ * backing bdev, then the superblock is updated to point to the oldest record left.
+ */
+struct vbdev_wbcache_sb {
+	uint8_t			signature[8];
+	uint32_t		version;
+	uint32_t		length;
+	uint32_t		crc;
+	uint32_t		block_size;
+	struct spdk_uuid	uuid;
+	/* UUID of the backing bdev */
+	struct spdk_uuid	base_uuid;
+	char			name[64];
+	uint64_t		num_blocks;
+	/* Offset and size of the log, in blocks */
+	uint64_t		log_offset;
+	uint64_t		log_blocks;
+	/* Position in the log and sequence number of the oldest record not destaged yet */
+	uint64_t		head;
+	uint64_t		head_seq;
+	uint32_t		high_watermark;
+	uint32_t		low_watermark;
+	uint8_t			reserved[344];
+} __attribute__((packed));
+SPDK_STATIC_ASSERT(sizeof(struct vbdev_wbcache_sb) == 512, "incorrect size");
+
+struct vbdev_wbcache_log_hdr {
+	uint64_t		magic;
+	struct spdk_uuid	uuid;
+	uint64_t		seq;
+	uint64_t		lba;
+	uint32_t		num_blocks;
+	uint32_t		data_crc;
+	uint32_t		crc;
+	uint32_t		reserved;
+};
+SPDK_STATIC_ASSERT(sizeof(struct vbdev_wbcache_log_hdr) == 56, "incorrect size");
+
+/* Index entry of a log data block, its position in the log is the index of the entry */
+struct wbcache_entry {
+	uint64_t		lba;
+	uint64_t		seq;
+	/* Next entry in the hash chain plus one, 0 ends the chain */
+	uint32_t		next;
+	uint32_t		reserved;
+};
+
+/* A record in the log, from its allocation until it is destaged */
+struct wbcache_record {
+	uint64_t		seq;
+	uint64_t		lba;
+	uint32_t		offset;
+	uint32_t		num_blocks;
+	/* The record is written, or failed to be */
+	bool			done;
+	int			status;
+	/* Write to complete once all the earlier records are written */
+	struct wbcache_req	*req;
+};
+
+struct wbcache_bdev_io;
+
+/* A vbdev I/O while it holds one of the preallocated header buffers */
+struct wbcache_req {
+	struct vbdev_wbcache	*wbc;
+	struct wbcache_bdev_io	*io;
+	struct vbdev_wbcache_log_hdr *hdr;
+	struct wbcache_record	*rec;
+	uint32_t		outstanding;
+	int			status;
+	/* Read epoch of a read from the log */
+	uint32_t		epoch;
+	bool			log_read;
+	struct iovec		iovs[WBCACHE_REQ_IOVS];
+	uint32_t		iovs_used;
+	TAILQ_ENTRY(wbcache_req) link;
+};
+
+/* A destaged block, at its LBA on the backing bdev and its position in the log */
+struct wbcache_destage_block {
+	uint64_t		lba;
+	uint64_t		pos;
+};
+
+/* A write of a run of consecutive destaged blocks to the backing bdev */
+struct wbcache_destage_io {
+	struct vbdev_wbcache	*wbc;
+	struct iovec		iovs[WBCACHE_DESTAGE_IOVS];
+	TAILQ_ENTRY(wbcache_destage_io) link;
+};
+
+struct vbdev_wbcache {
+	struct spdk_bdev		wbc_bdev;
+	struct spdk_bdev		*base_bdev;
+	struct spdk_bdev_desc		*base_desc;
+	struct spdk_bdev		*cache_bdev;
+	struct spdk_bdev_desc		*cache_desc;
+	bool				base_claimed;
+	bool				cache_claimed;
+	/* Thread owning the log and the index, with its channels to the backing and cache bdevs */
+	struct spdk_thread		*thread;
+	struct spdk_io_channel		*base_ch;
+	struct spdk_io_channel		*cache_ch;
+
+	struct vbdev_wbcache_sb		*sb;
+	uint32_t			blocklen;
+
+	/* Index of the log data blocks holding the latest data of an LBA, hashed by LBA */
+	struct wbcache_entry		*entries;
+	uint32_t			*buckets;
+	uint64_t			bucket_mask;
+	uint64_t			dirty_blocks;
+
+	/* Records in the log, oldest first */
+	struct wbcache_record		*records;
+	uint32_t			rec_cap;
+	uint32_t			rec_head;
+	uint32_t			rec_count;
+	/* Number of the oldest records that are written and whose writes were completed */
+	uint32_t			rec_acked;
+	uint64_t			log_head;
+	uint64_t			log_tail;
+	uint64_t			next_seq;
+
+	struct wbcache_req		*reqs;
+	void				*hdr_bufs;
+	TAILQ_HEAD(, wbcache_req)	free_reqs;
+	/* I/Os waiting for a header buffer, and writes waiting for destage to free log space */
+	TAILQ_HEAD(, wbcache_bdev_io)	queued_ios;
+	bool				resuming;
+	bool				space_waiting;
+
+	/* Reads from the log in progress, by epoch.  Log space of destaged records is only reused
+	 * once the reads started before they were removed from the index are done.
+	 */
+	uint32_t			log_reads[2];
+	uint32_t			read_epoch;
+
+	/* Destage state */
+	bool				cleaning;
+	bool				destage_active;
+	bool				destage_wait_reads;
+	bool				destage_io_waiting;
+	bool				replay_wrapped;
+	int				destage_status;
+	uint32_t			destage_records;
+	uint64_t			destage_start;
+	uint64_t			destage_end;
+	void				*destage_buf;
+	struct wbcache_destage_block	*destage_blocks;
+	uint32_t			destage_num;
+	uint32_t			destage_next;
+	uint32_t			destage_outstanding;
+	struct wbcache_destage_io	destage_ios[WBCACHE_DESTAGE_QD];
+	TAILQ_HEAD(, wbcache_destage_io) destage_free_ios;
+	struct spdk_bdev_io_wait_entry	destage_wait;
+	uint64_t			destaged_blocks;
+
+	/* Destage all the records, or just wait for the one in progress, then call drain_cb */
+	bool				drain_all;
+	void				(*drain_cb)(struct vbdev_wbcache *wbc, int status);
+	void				(*sb_cb)(struct vbdev_wbcache *wbc, int status);
+
+	/* Called once the cache is created, or loaded and its log replayed */
+	void				(*init_cb)(void *cb_arg, int status);
+	void				*init_cb_arg;
+
+	/* Invalidate the superblock on the cache bdev once the log is destaged */
+	bool				delete_pending;
+	TAILQ_ENTRY(vbdev_wbcache)	link;
+};
+
+static TAILQ_HEAD(, vbdev_wbcache) g_vbdev_wbcache = TAILQ_HEAD_INITIALIZER(g_vbdev_wbcache);
+/* Caches found on examine whose backing bdev didn't show up yet */
+static TAILQ_HEAD(, vbdev_wbcache) g_wbcache_pending = TAILQ_HEAD_INITIALIZER(g_wbcache_pending);
+
+/* Driver context of a vbdev I/O, bounced to the metadata thread and back */
+struct wbcache_bdev_io {
+	struct vbdev_wbcache		*wbc;
+	struct spdk_thread		*orig_thread;
+	enum spdk_bdev_io_status	status;
+	TAILQ_ENTRY(wbcache_bdev_io)	link;
+};
+
+static struct spdk_bdev_module wbcache_if;
+
+static void wbcache_resume_queued(struct vbdev_wbcache *wbc);
+static void wbcache_destage_kick(struct vbdev_wbcache *wbc);
+static void wbcache_destage_done(struct vbdev_wbcache *wbc, int status);
+static void wbcache_read_drained(struct vbdev_wbcache *wbc);
+
+static uint32_t
+wbcache_sb_crc(struct vbdev_wbcache_sb *sb)
+{
+	uint32_t crc, prev = sb->crc;
+
+	sb->crc = 0;
+	crc = spdk_crc32c_update(sb, sb->length, 0);
+	sb->crc = prev;
+
+	return crc;
+}
+
+static uint32_t
+wbcache_log_crc(struct vbdev_wbcache_log_hdr *hdr)
+{
+	uint32_t crc, prev = hdr->crc;
+
+	hdr->crc = 0;
+	crc = spdk_crc32c_update(hdr, sizeof(*hdr), 0);
+	hdr->crc = prev;
+
+	return crc;
+}
+
+static inline uint64_t
+wbcache_bucket(struct vbdev_wbcache *wbc, uint64_t lba)
+{
+	return ((lba * 0x9E3779B97F4A7C15ULL) >> 32) & wbc->bucket_mask;
+}
+
+/* Return the log block holding the latest data of the LBA plus one, 0 if it's not in the log */
+static uint32_t
+wbcache_index_lookup(struct vbdev_wbcache *wbc, uint64_t lba)
+{
+	uint32_t cur;
+
+	cur = wbc->buckets[wbcache_bucket(wbc, lba)];
+	for (; cur != 0; cur = wbc->entries[cur - 1].next) {
+		if (wbc->entries[cur - 1].lba == lba) {
+			return cur;
+		}
+	}
+
+	return 0;
+}
+
+/* Point the LBA to a log block, unless it already points to a later record */
+static void
+wbcache_index_insert(struct vbdev_wbcache *wbc, uint64_t lba, uint64_t pos, uint64_t seq)
+{
+	uint32_t *prev = &wbc->buckets[wbcache_bucket(wbc, lba)];
+	struct wbcache_entry *entry;
+
+	for (; *prev != 0; prev = &wbc->entries[*prev - 1].next) {
+		entry = &wbc->entries[*prev - 1];
+		if (entry->lba == lba) {
+			if (entry->seq > seq) {
+				return;
+			}
+			*prev = entry->next;
+			wbc->dirty_blocks--;
+			break;
+		}
+	}
+
+	entry = &wbc->entries[pos];
+	entry->lba = lba;
+	entry->seq = seq;
+	prev = &wbc->buckets[wbcache_bucket(wbc, lba)];
+	entry->next = *prev;
+	*prev = pos + 1;
+	wbc->dirty_blocks++;
+}
+
+/* Remove the LBA from the index if it still points to the log block */
+static void
+wbcache_index_remove(struct vbdev_wbcache *wbc, uint64_t lba, uint64_t pos)
+{
+	uint32_t *prev = &wbc->buckets[wbcache_bucket(wbc, lba)];
+
+	for (; *prev != 0; prev = &wbc->entries[*prev - 1].next) {
+		if (*prev == pos + 1) {
+			*prev = wbc->entries[pos].next;
+			wbc->dirty_blocks--;
+			return;
+		}
+	}
+}
+
+static inline struct wbcache_record *
+wbcache_record(struct vbdev_wbcache *wbc, uint32_t i)
+{
+	return &wbc->records[(wbc->rec_head + i) % wbc->rec_cap];
+}
+
+static uint64_t
+wbcache_log_used(struct vbdev_wbcache *wbc)
+{
+	if (wbc->rec_count == 0) {
+		return 0;
+	}
+
+	if (wbc->log_tail > wbc->log_head) {
+		return wbc->log_tail - wbc->log_head;
+	}
+
+	/* Includes the end of the log skipped by the record that wrapped around */
+	return wbc->sb->log_blocks - wbc->log_head + wbc->log_tail;
+}
+
+/* Allocate space for a record at the tail of the log */
+static bool
+wbcache_log_alloc(struct vbdev_wbcache *wbc, uint64_t size, uint64_t *pos)
+{
+	uint64_t log_blocks = wbc->sb->log_blocks;
+
+	if (wbc->rec_count == 0) {
+		*pos = wbc->log_tail + size <= log_blocks ? wbc->log_tail : 0;
+		wbc->log_head = *pos;
+	} else if (wbc->log_tail > wbc->log_head) {
+		if (wbc->log_tail + size <= log_blocks) {
+			*pos = wbc->log_tail;
+		} else if (size <= wbc->log_head) {
+			*pos = 0;
+		} else {
+			return false;
+		}
+	} else if (wbc->log_tail + size <= wbc->log_head) {
+		*pos = wbc->log_tail;
+	} else {
+		return false;
+	}
+
+	wbc->log_tail = (*pos + size) % log_blocks;
+
+	return true;
+}
+
+static struct wbcache_record *
+wbcache_record_append(struct vbdev_wbcache *wbc, uint64_t lba, uint64_t pos, uint32_t num_blocks)
+{
+	struct wbcache_record *rec;
+
+	assert(wbc->rec_count < wbc->rec_cap);
+	rec = wbcache_record(wbc, wbc->rec_count++);
+	rec->seq = wbc->next_seq++;
+	rec->lba = lba;
+	rec->offset = pos;
+	rec->num_blocks = num_blocks;
+	rec->done = false;
+	rec->status = 0;
+	rec->req = NULL;
+
+	return rec;
+}
+
+static void
+_wbcache_io_complete(void *ctx)
+{
+	struct wbcache_bdev_io *io = ctx;
+
+	spdk_bdev_io_complete(spdk_bdev_io_from_ctx(io), io->status);
+}
+
+static void
+wbcache_io_complete(struct wbcache_bdev_io *io, int status)
+{
+	if (spdk_likely(status == 0)) {
+		io->status = SPDK_BDEV_IO_STATUS_SUCCESS;
+	} else if (status == -ENOMEM) {
+		io->status = SPDK_BDEV_IO_STATUS_NOMEM;
+	} else {
+		io->status = SPDK_BDEV_IO_STATUS_FAILED;
+	}
+
+	if (io->orig_thread != spdk_get_thread()) {
+		spdk_thread_send_msg(io->orig_thread, _wbcache_io_complete, io);
+	} else {
+		_wbcache_io_complete(io);
+	}
+}
+
+static void
+wbcache_req_complete(struct wbcache_req *req, int status)
+{
+	struct vbdev_wbcache *wbc = req->wbc;
+	struct wbcache_bdev_io *io = req->io;
+
+	TAILQ_INSERT_HEAD(&wbc->free_reqs, req, link);
+
+	wbcache_io_complete(io, status);
+	wbcache_resume_queued(wbc);
+}
+
+/* Point iovs at the I/O buffers from offset, for the data blocks of a record or of a run */
+static uint32_t
+wbcache_req_slice_iovs(struct wbcache_req *req, struct iovec **iovs, uint64_t offset,
+		       uint64_t len)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	struct iovec *src, *dst = &req->iovs[req->iovs_used];
+	uint32_t i, iovcnt = 0;
+	uint64_t n;
+
+	for (i = 0; i < (uint32_t)bdev_io->u.bdev.iovcnt && len > 0; i++) {
+		src = &bdev_io->u.bdev.iovs[i];
+		if (offset >= src->iov_len) {
+			offset -= src->iov_len;
+			continue;
+		}
+
+		assert(req->iovs_used + iovcnt < WBCACHE_REQ_IOVS);
+		n = spdk_min(len, src->iov_len - offset);
+		dst[iovcnt].iov_base = (uint8_t *)src->iov_base + offset;
+		dst[iovcnt].iov_len = n;
+		iovcnt++;
+		len -= n;
+		offset = 0;
+	}
+
+	req->iovs_used += iovcnt;
+	*iovs = dst;
+
+	return iovcnt;
+}
+
+/* Complete the writes in sequence number order.  Replay stops at the first record missing from
+ * the log, so a write completed before an earlier record is written could be lost.  The writes
+ * after a failed record are held until destage moves the superblock head past it.
+ */
+static void
+wbcache_complete_writes(struct vbdev_wbcache *wbc)
+{
+	struct wbcache_record *rec;
+	struct wbcache_req *req;
+	int status;
+
+	while (wbc->rec_acked < wbc->rec_count) {
+		rec = wbcache_record(wbc, wbc->rec_acked);
+		if (!rec->done) {
+			break;
+		}
+
+		req = rec->req;
+		status = rec->status;
+		rec->req = NULL;
+		if (status == 0) {
+			wbc->rec_acked++;
+		}
+		/* This may start new writes and get back here */
+		if (req != NULL) {
+			wbcache_req_complete(req, status);
+		}
+		if (status != 0) {
+			break;
+		}
+	}
+}
+
+static void
+wbcache_write_failed(struct vbdev_wbcache *wbc, struct wbcache_record *rec, int status)
+{
+	/* Destage skips the failed record, get it past the head of the log soon */
+	rec->status = status;
+	wbc->cleaning = true;
+}
+
+static void
+wbcache_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct wbcache_req *req = cb_arg;
+	struct vbdev_wbcache *wbc = req->wbc;
+	struct wbcache_record *rec = req->rec;
+	uint32_t i;
+
+	spdk_bdev_free_io(bdev_io);
+
+	rec->done = true;
+	if (success) {
+		for (i = 0; i < rec->num_blocks; i++) {
+			wbcache_index_insert(wbc, rec->lba + i, rec->offset + 1 + i, rec->seq);
+		}
+	} else {
+		wbcache_write_failed(wbc, rec, -EIO);
+	}
+
+	wbcache_complete_writes(wbc);
+	wbcache_destage_kick(wbc);
+}
+
+/* Append the header and the data of the write to the log with a single write */
+static void
+wbcache_write(struct wbcache_req *req, uint64_t pos)
+{
+	struct vbdev_wbcache *wbc = req->wbc;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	struct vbdev_wbcache_log_hdr *hdr = req->hdr;
+	uint32_t num_blocks = bdev_io->u.bdev.num_blocks;
+	int iovcnt = bdev_io->u.bdev.iovcnt;
+	int rc;
+
+	assert(num_blocks <= WBCACHE_MAX_IO_BLOCKS && iovcnt <= WBCACHE_MAX_IOVS);
+	req->rec = wbcache_record_append(wbc, bdev_io->u.bdev.offset_blocks, pos, num_blocks);
+	req->rec->req = req;
+
+	memset(hdr, 0, wbc->blocklen);
+	hdr->magic = WBCACHE_LOG_MAGIC;
+	hdr->uuid = wbc->sb->uuid;
+	hdr->seq = req->rec->seq;
+	hdr->lba = req->rec->lba;
+	hdr->num_blocks = num_blocks;
+	hdr->data_crc = spdk_crc32c_iov_update(bdev_io->u.bdev.iovs, iovcnt, 0);
+	hdr->crc = wbcache_log_crc(hdr);
+
+	req->iovs[0].iov_base = hdr;
+	req->iovs[0].iov_len = wbc->blocklen;
+	memcpy(&req->iovs[1], bdev_io->u.bdev.iovs, iovcnt * sizeof(struct iovec));
+
+	rc = spdk_bdev_writev_blocks(wbc->cache_desc, wbc->cache_ch, req->iovs, iovcnt + 1,
+				     wbc->sb->log_offset + pos, num_blocks + 1,
+				     wbcache_write_done, req);
+	if (rc != 0) {
+		req->rec->done = true;
+		wbcache_write_failed(wbc, req->rec, rc);
+		wbcache_complete_writes(wbc);
+		wbcache_destage_kick(wbc);
+	}
+}
+
+static void
+wbcache_read_put(struct wbcache_req *req)
+{
+	struct vbdev_wbcache *wbc = req->wbc;
+
+	assert(req->outstanding > 0);
+	if (--req->outstanding > 0) {
+		return;
+	}
+
+	if (req->log_read) {
+		assert(wbc->log_reads[req->epoch] > 0);
+		if (--wbc->log_reads[req->epoch] == 0 && req->epoch != wbc->read_epoch &&
+		    wbc->destage_wait_reads) {
+			wbcache_read_drained(wbc);
+		}
+	}
+
+	wbcache_req_complete(req, req->status);
+}
+
+static void
+wbcache_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct wbcache_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		req->status = -EIO;
+	}
+
+	wbcache_read_put(req);
+}
+
+/* Read each run of blocks that are consecutive in the log, or not in the log at all, with
+ * a single I/O.
+ */
+static void
+wbcache_read(struct wbcache_req *req)
+{
+	struct vbdev_wbcache *wbc = req->wbc;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(req->io);
+	uint64_t offset = bdev_io->u.bdev.offset_blocks;
+	uint32_t num_blocks = bdev_io->u.bdev.num_blocks;
+	uint32_t i, j, pos, iovcnt;
+	struct iovec *iovs;
+	int rc;
+
+	req->outstanding = 1;
+	req->iovs_used = 0;
+	req->log_read = false;
+	req->epoch = wbc->read_epoch;
+
+	for (i = 0; i < num_blocks; i = j) {
+		pos = wbcache_index_lookup(wbc, offset + i);
+		for (j = i + 1; j < num_blocks; j++) {
+			if (wbcache_index_lookup(wbc, offset + j) != (pos == 0 ? 0 : pos + j - i)) {
+				break;
+			}
+		}
+
+		iovcnt = wbcache_req_slice_iovs(req, &iovs, (uint64_t)i * wbc->blocklen,
+						(uint64_t)(j - i) * wbc->blocklen);
+		if (pos == 0) {
+			rc = spdk_bdev_readv_blocks(wbc->base_desc, wbc->base_ch, iovs, iovcnt,
+						    offset + i, j - i, wbcache_read_done, req);
+		} else {
+			if (!req->log_read) {
+				req->log_read = true;
+				wbc->log_reads[req->epoch]++;
+			}
+			rc = spdk_bdev_readv_blocks(wbc->cache_desc, wbc->cache_ch, iovs, iovcnt,
+						    wbc->sb->log_offset + pos - 1, j - i,
+						    wbcache_read_done, req);
+		}
+		if (rc != 0) {
+			req->status = rc;
+			break;
+		}
+		req->outstanding++;
+	}
+
+	wbcache_read_put(req);
+}
+
+static void
+wbcache_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct wbcache_req *req = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	wbcache_req_complete(req, success ? 0 : -EIO);
+}
+
+/* Completed writes are durable once they're flushed from the write cache of the cache bdev */
+static void
+wbcache_flush(struct wbcache_req *req)
+{
+	struct vbdev_wbcache *wbc = req->wbc;
+	int rc;
+
+	if (!spdk_bdev_io_type_supported(wbc->cache_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		wbcache_req_complete(req, 0);
+		return;
+	}
+
+	rc = spdk_bdev_flush_blocks(wbc->cache_desc, wbc->cache_ch, 0,
+				    spdk_bdev_get_num_blocks(wbc->cache_bdev),
+				    wbcache_flush_done, req);
+	if (rc != 0) {
+		wbcache_req_complete(req, rc);
+	}
+}
+
+static void
+wbcache_write_sb_done(struct vbdev_wbcache *wbc, int status)
+{
+	void (*cb_fn)(struct vbdev_wbcache *wbc, int status) = wbc->sb_cb;
+
+	wbc->sb_cb = NULL;
+	cb_fn(wbc, status);
+}
+
+static void
+wbcache_write_sb_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_wbcache *wbc = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	wbcache_write_sb_done(wbc, success ? 0 : -EIO);
+}
+
+static void
+wbcache_write_sb_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_wbcache *wbc = cb_arg;
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		wbcache_write_sb_done(wbc, -EIO);
+		return;
+	}
+
+	/* The log space before the new head may be reused only once the superblock is durable */
+	if (!spdk_bdev_io_type_supported(wbc->cache_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		wbcache_write_sb_done(wbc, 0);
+		return;
+	}
+
+	rc = spdk_bdev_flush_blocks(wbc->cache_desc, wbc->cache_ch, 0, 1,
+				    wbcache_write_sb_flush_done, wbc);
+	if (rc != 0) {
+		wbcache_write_sb_done(wbc, rc);
+	}
+}
+
+static void
+wbcache_write_sb(struct vbdev_wbcache *wbc, uint64_t head, uint64_t head_seq,
+		 void (*cb_fn)(struct vbdev_wbcache *wbc, int status))
+{
+	int rc;
+
+	assert(wbc->sb_cb == NULL);
+	wbc->sb_cb = cb_fn;
+	wbc->sb->head = head;
+	wbc->sb->head_seq = head_seq;
+	wbc->sb->crc = wbcache_sb_crc(wbc->sb);
+
+	rc = spdk_bdev_write_blocks(wbc->cache_desc, wbc->cache_ch, wbc->sb, 0, 1,
+				    wbcache_write_sb_io_done, wbc);
+	if (rc != 0) {
+		wbcache_write_sb_done(wbc, rc);
+	}
+}
+
+/* The superblock points past the destaged records, their log space can be reused */
+static void
+wbcache_destage_sb_done(struct vbdev_wbcache *wbc, int status)
+{
+	struct wbcache_record *rec;
+	struct wbcache_req *req;
+	uint32_t i;
+
+	if (status != 0) {
+		wbcache_destage_done(wbc, status);
+		return;
+	}
+
+	/* Writes held behind a failed record are on the backing bdev now */
+	for (i = wbc->rec_acked; i < wbc->destage_records; i++) {
+		rec = wbcache_record(wbc, i);
+		req = rec->req;
+		rec->req = NULL;
+		if (req != NULL) {
+			wbcache_req_complete(req, rec->status);
+		}
+	}
+
+	wbc->rec_head = (wbc->rec_head + wbc->destage_records) % wbc->rec_cap;
+	wbc->rec_count -= wbc->destage_records;
+	wbc->rec_acked -= spdk_min(wbc->rec_acked, wbc->destage_records);
+	wbc->log_head = wbc->rec_count > 0 ? wbcache_record(wbc, 0)->offset : wbc->log_tail;
+	wbc->destaged_blocks += wbc->destage_num;
+
+	wbcache_complete_writes(wbc);
+	wbcache_destage_done(wbc, 0);
+}
+
+static void
+wbcache_read_drained(struct vbdev_wbcache *wbc)
+{
+	struct wbcache_record *next = NULL;
+
+	wbc->destage_wait_reads = false;
+	if (wbc->destage_records < wbc->rec_count) {
+		next = wbcache_record(wbc, wbc->destage_records);
+	}
+
+	wbcache_write_sb(wbc, next ? next->offset : wbc->log_tail, next ? next->seq : wbc->next_seq,
+			 wbcache_destage_sb_done);
+}
+
+/* The destaged blocks are durable on the backing bdev, drop them from the index */
+static void
+wbcache_destage_flushed(struct vbdev_wbcache *wbc)
+{
+	struct wbcache_destage_block *blk;
+	uint32_t i, epoch = wbc->read_epoch;
+
+	for (i = 0; i < wbc->destage_num; i++) {
+		blk = &wbc->destage_blocks[i];
+		wbcache_index_remove(wbc, blk->lba, blk->pos);
+	}
+
+	/* Later reads go to the backing bdev, wait for the earlier ones still reading the log */
+	wbc->read_epoch ^= 1;
+	if (wbc->log_reads[epoch] > 0) {
+		wbc->destage_wait_reads = true;
+		return;
+	}
+
+	wbcache_read_drained(wbc);
+}
+
+static void
+wbcache_destage_flush_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_wbcache *wbc = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		wbcache_destage_done(wbc, -EIO);
+		return;
+	}
+
+	wbcache_destage_flushed(wbc);
+}
+
+static void
+wbcache_destage_writes_done(struct vbdev_wbcache *wbc)
+{
+	int rc;
+
+	if (wbc->destage_status != 0) {
+		wbcache_destage_done(wbc, wbc->destage_status);
+		return;
+	}
+
+	if (!spdk_bdev_io_type_supported(wbc->base_bdev, SPDK_BDEV_IO_TYPE_FLUSH)) {
+		wbcache_destage_flushed(wbc);
+		return;
+	}
+
+	rc = spdk_bdev_flush_blocks(wbc->base_desc, wbc->base_ch, 0, wbc->sb->num_blocks,
+				    wbcache_destage_flush_done, wbc);
+	if (rc != 0) {
+		wbcache_destage_done(wbc, rc);
+	}
+}
+
+static void wbcache_destage_write_next(void *arg);
+
+static void
+wbcache_destage_write_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct wbcache_destage_io *dio = cb_arg;
+	struct vbdev_wbcache *wbc = dio->wbc;
+
+	spdk_bdev_free_io(bdev_io);
+	TAILQ_INSERT_HEAD(&wbc->destage_free_ios, dio, link);
+
+	if (!success) {
+		wbc->destage_status = -EIO;
+	}
+
+	assert(wbc->destage_outstanding > 0);
+	wbc->destage_outstanding--;
+	if (wbc->destage_status == 0 && wbc->destage_next < wbc->destage_num) {
+		if (!wbc->destage_io_waiting) {
+			wbcache_destage_write_next(wbc);
+		}
+	} else if (wbc->destage_outstanding == 0 && !wbc->destage_io_waiting) {
+		wbcache_destage_writes_done(wbc);
+	}
+}
+
+/* Write the destaged blocks in LBA order, each run of consecutive LBAs with a single I/O */
+static void
+wbcache_destage_write_next(void *arg)
+{
+	struct vbdev_wbcache *wbc = arg;
+	struct wbcache_destage_block *blocks = wbc->destage_blocks;
+	struct wbcache_destage_io *dio;
+	uint32_t first, i, iovcnt;
+	uint8_t *buf;
+	int rc;
+
+	wbc->destage_io_waiting = false;
+
+	while (wbc->destage_next < wbc->destage_num && wbc->destage_status == 0) {
+		dio = TAILQ_FIRST(&wbc->destage_free_ios);
+		if (dio == NULL) {
+			return;
+		}
+
+		first = wbc->destage_next;
+		iovcnt = 0;
+		for (i = first; i < wbc->destage_num; i++) {
+			if (i > first && blocks[i].lba != blocks[i - 1].lba + 1) {
+				break;
+			}
+
+			buf = (uint8_t *)wbc->destage_buf +
+			      (blocks[i].pos - wbc->destage_start) * wbc->blocklen;
+			if (iovcnt > 0 && (uint8_t *)dio->iovs[iovcnt - 1].iov_base +
+			    dio->iovs[iovcnt - 1].iov_len == buf) {
+				dio->iovs[iovcnt - 1].iov_len += wbc->blocklen;
+				continue;
+			}
+			if (iovcnt == WBCACHE_DESTAGE_IOVS) {
+				break;
+			}
+			dio->iovs[iovcnt].iov_base = buf;
+			dio->iovs[iovcnt].iov_len = wbc->blocklen;
+			iovcnt++;
+		}
+
+		rc = spdk_bdev_writev_blocks(wbc->base_desc, wbc->base_ch, dio->iovs, iovcnt,
+					     blocks[first].lba, i - first,
+					     wbcache_destage_write_done, dio);
+		if (rc == -ENOMEM) {
+			wbc->destage_wait.bdev = wbc->base_bdev;
+			wbc->destage_wait.cb_fn = wbcache_destage_write_next;
+			wbc->destage_wait.cb_arg = wbc;
+			rc = spdk_bdev_queue_io_wait(wbc->base_bdev, wbc->base_ch,
+						     &wbc->destage_wait);
+			if (rc == 0) {
+				wbc->destage_io_waiting = true;
+				return;
+			}
+		}
+		if (rc != 0) {
+			wbc->destage_status = rc;
+			break;
+		}
+
+		TAILQ_REMOVE(&wbc->destage_free_ios, dio, link);
+		wbc->destage_outstanding++;
+		wbc->destage_next = i;
+	}
+
+	if (wbc->destage_outstanding == 0) {
+		wbcache_destage_writes_done(wbc);
+	}
+}
+
+static int
+wbcache_destage_block_cmp(const void *a, const void *b)
+{
+	const struct wbcache_destage_block *blk_a = a, *blk_b = b;
+
+	return blk_a->lba < blk_b->lba ? -1 : blk_a->lba > blk_b->lba;
+}
+
+static void
+wbcache_destage_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_wbcache *wbc = cb_arg;
+	struct wbcache_record *rec;
+	uint64_t pos;
+	uint32_t i, j;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		wbcache_destage_done(wbc, -EIO);
+		return;
+	}
+
+	/* Only the blocks not overwritten by a later record need to be written */
+	wbc->destage_num = 0;
+	for (i = 0; i < wbc->destage_records; i++) {
+		rec = wbcache_record(wbc, i);
+		for (j = 0; j < rec->num_blocks; j++) {
+			pos = rec->offset + 1 + j;
+			if (wbcache_index_lookup(wbc, rec->lba + j) == pos + 1) {
+				wbc->destage_blocks[wbc->destage_num].lba = rec->lba + j;
+				wbc->destage_blocks[wbc->destage_num].pos = pos;
+				wbc->destage_num++;
+			}
+		}
+	}
+
+	qsort(wbc->destage_blocks, wbc->destage_num, sizeof(*wbc->destage_blocks),
+	      wbcache_destage_block_cmp);
+
+	wbc->destage_next = 0;
+	wbc->destage_outstanding = 0;
+	wbcache_destage_write_next(wbc);
+}
+
+/* Read a batch of the oldest records, those written one after another in the log */
+static void
+wbcache_destage_start(struct vbdev_wbcache *wbc)
+{
+	struct wbcache_record *rec;
+	uint64_t end;
+	uint32_t i;
+	int rc;
+
+	assert(!wbc->destage_active && wbc->rec_count > 0);
+
+	rec = wbcache_record(wbc, 0);
+	wbc->destage_start = rec->offset;
+	end = rec->offset;
+	for (i = 0; i < wbc->rec_count; i++) {
+		rec = wbcache_record(wbc, i);
+		if (!rec->done || rec->offset != end ||
+		    end + 1 + rec->num_blocks - wbc->destage_start > WBCACHE_DESTAGE_BLOCKS) {
+			break;
+		}
+		end = rec->offset + 1 + rec->num_blocks;
+	}
+
+	/* The oldest record is still being written */
+	if (i == 0) {
+		return;
+	}
+
+	wbc->destage_active = true;
+	wbc->destage_records = i;
+	wbc->destage_end = end;
+	wbc->destage_status = 0;
+
+	rc = spdk_bdev_read_blocks(wbc->cache_desc, wbc->cache_ch, wbc->destage_buf,
+				   wbc->sb->log_offset + wbc->destage_start,
+				   end - wbc->destage_start, wbcache_destage_read_done, wbc);
+	if (rc != 0) {
+		wbcache_destage_done(wbc, rc);
+	}
+}
+
+/* Start destaging once the log is filled above the high watermark, or a write is waiting for
+ * space, and keep going until it's below the low watermark.
+ */
+static void
+wbcache_destage_kick(struct vbdev_wbcache *wbc)
+{
+	uint64_t used = wbcache_log_used(wbc);
+
+	if (used * 100 >= (uint64_t)wbc->sb->high_watermark * wbc->sb->log_blocks ||
+	    wbc->space_waiting) {
+		wbc->cleaning = true;
+	}
+
+	if (!wbc->cleaning || wbc->destage_active || wbc->drain_cb != NULL || wbc->rec_count == 0) {
+		return;
+	}
+
+	wbcache_destage_start(wbc);
+}
+
+static void
+wbcache_drain_continue(struct vbdev_wbcache *wbc)
+{
+	void (*cb_fn)(struct vbdev_wbcache *wbc, int status) = wbc->drain_cb;
+
+	if (wbc->destage_active) {
+		return;
+	}
+
+	if (wbc->drain_all && wbc->destage_status == 0 && wbc->rec_count > 0) {
+		wbcache_destage_start(wbc);
+		assert(wbc->destage_active || wbc->destage_status != 0);
+		if (wbc->destage_active) {
+			return;
+		}
+	}
+
+	wbc->drain_cb = NULL;
+	cb_fn(wbc, wbc->destage_status);
+}
+
+/* Wait for the batch being destaged, and destage all the other records too if all is set */
+static void
+wbcache_drain(struct vbdev_wbcache *wbc, bool all,
+	      void (*cb_fn)(struct vbdev_wbcache *wbc, int status))
+{
+	wbc->drain_all = all;
+	wbc->drain_cb = cb_fn;
+	if (!wbc->destage_active) {
+		wbc->destage_status = 0;
+	}
+
+	wbcache_drain_continue(wbc);
+}
+
+static void
+wbcache_destage_done(struct vbdev_wbcache *wbc, int status)
+{
+	uint64_t used;
+
+	wbc->destage_active = false;
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to destage cache of bdev %s: %s\n", wbc->sb->name,
+			    spdk_strerror(-status));
+		wbc->destage_status = status;
+	} else {
+		used = wbcache_log_used(wbc);
+		if (used * 100 <= (uint64_t)wbc->sb->low_watermark * wbc->sb->log_blocks) {
+			wbc->cleaning = false;
+		}
+	}
+
+	if (wbc->drain_cb != NULL) {
+		wbcache_drain_continue(wbc);
+		return;
+	}
+
+	wbc->space_waiting = false;
+	wbcache_resume_queued(wbc);
+	if (status == 0) {
+		wbcache_destage_kick(wbc);
+	}
+}
+
+static bool
+wbcache_io_start(struct wbcache_bdev_io *io)
+{
+	struct vbdev_wbcache *wbc = io->wbc;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(io);
+	struct wbcache_req *req;
+	uint64_t pos = 0;
+
+	req = TAILQ_FIRST(&wbc->free_reqs);
+	if (req == NULL) {
+		return false;
+	}
+
+	if (bdev_io->type == SPDK_BDEV_IO_TYPE_WRITE) {
+		if (wbc->drain_cb != NULL ||
+		    !wbcache_log_alloc(wbc, bdev_io->u.bdev.num_blocks + 1, &pos)) {
+			wbc->space_waiting = true;
+			wbcache_destage_kick(wbc);
+			return false;
+		}
+	}
+
+	TAILQ_REMOVE(&wbc->free_reqs, req, link);
+	req->io = io;
+	req->status = 0;
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		wbcache_read(req);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+		wbcache_write(req, pos);
+		break;
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		wbcache_flush(req);
+		break;
+	default:
+		assert(false);
+		wbcache_req_complete(req, -EINVAL);
+		break;
+	}
+
+	return true;
+}
+
+/* Once a write has to wait for space in the log, the later writes wait behind it */
+static void
+wbcache_resume_queued(struct vbdev_wbcache *wbc)
+{
+	struct wbcache_bdev_io *io, *tmp;
+	bool write_blocked = false;
+
+	/* Header buffers freed by I/Os failing inline are taken by the loop in progress */
+	if (wbc->resuming) {
+		return;
+	}
+
+	wbc->resuming = true;
+	TAILQ_FOREACH_SAFE(io, &wbc->queued_ios, link, tmp) {
+		if (TAILQ_EMPTY(&wbc->free_reqs)) {
+			break;
+		}
+
+		if (spdk_bdev_io_from_ctx(io)->type == SPDK_BDEV_IO_TYPE_WRITE) {
+			if (write_blocked) {
+				continue;
+			}
+		}
+
+		TAILQ_REMOVE(&wbc->queued_ios, io, link);
+		if (!wbcache_io_start(io)) {
+			write_blocked = true;
+			if (tmp != NULL) {
+				TAILQ_INSERT_BEFORE(tmp, io, link);
+			} else {
+				TAILQ_INSERT_TAIL(&wbc->queued_ios, io, link);
+			}
+		}
+	}
+	wbc->resuming = false;
+}
+
+static void
+_wbcache_io_submit(void *ctx)
+{
+	struct wbcache_bdev_io *io = ctx;
+	struct vbdev_wbcache *wbc = io->wbc;
+
+	/* Keep the order of the I/Os waiting for a request or log space */
+	if (!TAILQ_EMPTY(&wbc->queued_ios) || !wbcache_io_start(io)) {
+		TAILQ_INSERT_TAIL(&wbc->queued_ios, io, link);
+	}
+}
+
+/* The log tail and the index are only touched on the metadata thread, no locking needed */
+static void
+wbcache_io_submit(struct wbcache_bdev_io *io)
+{
+	if (io->wbc->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(io->wbc->thread, _wbcache_io_submit, io);
+	} else {
+		_wbcache_io_submit(io);
+	}
+}
+
+static void
+wbcache_read_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io, bool success)
+{
+	if (!success) {
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	wbcache_io_submit((struct wbcache_bdev_io *)bdev_io->driver_ctx);
+}
+
+static void
+vbdev_wbcache_submit_request(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io)
+{
+	struct vbdev_wbcache *wbc = SPDK_CONTAINEROF(bdev_io->bdev, struct vbdev_wbcache,
+				    wbc_bdev);
+	struct wbcache_bdev_io *io = (struct wbcache_bdev_io *)bdev_io->driver_ctx;
+
+	memset(io, 0, sizeof(*io));
+	io->wbc = wbc;
+	io->orig_thread = spdk_get_thread();
+
+	switch (bdev_io->type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+		spdk_bdev_io_get_buf(bdev_io, wbcache_read_get_buf_cb,
+				     bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen);
+		break;
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		wbcache_io_submit(io);
+		break;
+	default:
+		SPDK_ERRLOG("wbcache: unknown I/O type %d\n", bdev_io->type);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		break;
+	}
+}
+
+/* Zeroes have to be logged like any other data to be ordered with the writes around them, so
+ * write zeroes is left to the bdev layer to emulate with regular writes.
+ */
+static bool
+vbdev_wbcache_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
+{
+	switch (io_type) {
+	case SPDK_BDEV_IO_TYPE_READ:
+	case SPDK_BDEV_IO_TYPE_WRITE:
+	case SPDK_BDEV_IO_TYPE_FLUSH:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static struct spdk_io_channel *
+vbdev_wbcache_get_io_channel(void *ctx)
+{
+	struct vbdev_wbcache *wbc = ctx;
+
+	return spdk_get_io_channel(wbc);
+}
+
+static int
+vbdev_wbcache_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct vbdev_wbcache *wbc = ctx;
+	struct vbdev_wbcache_sb *sb = wbc->sb;
+
+	spdk_json_write_name(w, "wbcache");
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", spdk_bdev_get_name(&wbc->wbc_bdev));
+	spdk_json_write_named_string(w, "base_bdev_name", spdk_bdev_get_name(wbc->base_bdev));
+	spdk_json_write_named_string(w, "cache_bdev_name", spdk_bdev_get_name(wbc->cache_bdev));
+	spdk_json_write_named_uint32(w, "high_watermark", sb->high_watermark);
+	spdk_json_write_named_uint32(w, "low_watermark", sb->low_watermark);
+	spdk_json_write_named_uint64(w, "log_blocks", sb->log_blocks);
+	spdk_json_write_named_uint64(w, "log_used_blocks", wbcache_log_used(wbc));
+	spdk_json_write_named_uint64(w, "dirty_blocks", wbc->dirty_blocks);
+	spdk_json_write_named_uint64(w, "destaged_blocks", wbc->destaged_blocks);
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+wbcache_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+wbcache_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+wbcache_free(struct vbdev_wbcache *wbc)
+{
+	if (wbc->base_ch != NULL) {
+		spdk_put_io_channel(wbc->base_ch);
+	}
+	if (wbc->cache_ch != NULL) {
+		spdk_put_io_channel(wbc->cache_ch);
+	}
+	if (wbc->base_claimed) {
+		spdk_bdev_module_release_bdev(wbc->base_bdev);
+	}
+	if (wbc->cache_claimed) {
+		spdk_bdev_module_release_bdev(wbc->cache_bdev);
+	}
+	if (wbc->base_desc != NULL) {
+		spdk_bdev_close(wbc->base_desc);
+	}
+	if (wbc->cache_desc != NULL) {
+		spdk_bdev_close(wbc->cache_desc);
+	}
+
+	spdk_free(wbc->entries);
+	spdk_free(wbc->buckets);
+	spdk_free(wbc->hdr_bufs);
+	spdk_free(wbc->destage_buf);
+	spdk_free(wbc->sb);
+	free(wbc->records);
+	free(wbc->destage_blocks);
+	free(wbc->reqs);
+	free(wbc->wbc_bdev.name);
+	free(wbc);
+}
+
+static void
+wbcache_device_unregister_cb(void *io_device)
+{
+	struct vbdev_wbcache *wbc = io_device;
+
+	spdk_bdev_destruct_done(&wbc->wbc_bdev, 0);
+	wbcache_free(wbc);
+}
+
+static void
+wbcache_destruct_wipe_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_wbcache *wbc = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		SPDK_ERRLOG("Failed to clear superblock of wbcache bdev %s\n", wbc->sb->name);
+	}
+
+	spdk_io_device_unregister(wbc, wbcache_device_unregister_cb);
+}
+
+static void
+wbcache_destruct_drained(struct vbdev_wbcache *wbc, int status)
+{
+	int rc;
+
+	if (wbc->delete_pending) {
+		if (status == 0) {
+			assert(wbc->rec_count == 0);
+			memset(wbc->sb, 0, wbc->blocklen);
+			rc = spdk_bdev_write_blocks(wbc->cache_desc, wbc->cache_ch, wbc->sb, 0, 1,
+						    wbcache_destruct_wipe_done, wbc);
+			if (rc == 0) {
+				return;
+			}
+			status = rc;
+		}
+		SPDK_ERRLOG("Failed to destage cache of bdev %s, keeping it on bdev %s: %s\n",
+			    wbc->sb->name, spdk_bdev_get_name(wbc->cache_bdev),
+			    spdk_strerror(-status));
+	}
+
+	spdk_io_device_unregister(wbc, wbcache_device_unregister_cb);
+}
+
+static void
+_vbdev_wbcache_destruct(void *ctx)
+{
+	struct vbdev_wbcache *wbc = ctx;
+
+	assert(TAILQ_EMPTY(&wbc->queued_ios));
+
+	/* The data left in the log is destaged when the cache is loaded again, unless the cache
+	 * is being deleted.
+	 */
+	wbcache_drain(wbc, wbc->delete_pending, wbcache_destruct_drained);
+}
+
+static int
+vbdev_wbcache_destruct(void *ctx)
+{
+	struct vbdev_wbcache *wbc = ctx;
+
+	TAILQ_REMOVE(&g_vbdev_wbcache, wbc, link);
+
+	/* The channels to the backing and cache bdevs are released on the thread that got them */
+	if (wbc->thread != spdk_get_thread()) {
+		spdk_thread_send_msg(wbc->thread, _vbdev_wbcache_destruct, wbc);
+	} else {
+		_vbdev_wbcache_destruct(wbc);
+	}
+
+	return 1;
+}
+
+static const struct spdk_bdev_fn_table vbdev_wbcache_fn_table = {
+	.destruct		= vbdev_wbcache_destruct,
+	.submit_request		= vbdev_wbcache_submit_request,
+	.io_type_supported	= vbdev_wbcache_io_type_supported,
+	.get_io_channel		= vbdev_wbcache_get_io_channel,
+	.dump_info_json		= vbdev_wbcache_dump_info_json,
+};
+
+static void
+wbcache_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *event_ctx)
+{
+	struct vbdev_wbcache *wbc, *tmp;
+
+	switch (type) {
+	case SPDK_BDEV_EVENT_REMOVE:
+		TAILQ_FOREACH_SAFE(wbc, &g_vbdev_wbcache, link, tmp) {
+			if (wbc->base_bdev == bdev || wbc->cache_bdev == bdev) {
+				spdk_bdev_unregister(&wbc->wbc_bdev, NULL, NULL);
+			}
+		}
+		TAILQ_FOREACH_SAFE(wbc, &g_wbcache_pending, link, tmp) {
+			if (wbc->cache_bdev == bdev) {
+				TAILQ_REMOVE(&g_wbcache_pending, wbc, link);
+				wbcache_free(wbc);
+			}
+		}
+		break;
+	default:
+		/* The log and the vbdev size are recorded in the superblock, resizes are ignored */
+		SPDK_NOTICELOG("Unsupported bdev event: type %d\n", type);
+		break;
+	}
+}
+
+/* Open the cache bdev and allocate the superblock buffer */
+static int
+wbcache_open(const char *cache_bdev_name, struct vbdev_wbcache **_wbc)
+{
+	struct vbdev_wbcache *wbc;
+	int rc;
+
+	wbc = calloc(1, sizeof(*wbc));
+	if (wbc == NULL) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_bdev_open_ext(cache_bdev_name, true, wbcache_bdev_event_cb, NULL,
+				&wbc->cache_desc);
+	if (rc != 0) {
+		free(wbc);
+		return rc;
+	}
+
+	wbc->cache_bdev = spdk_bdev_desc_get_bdev(wbc->cache_desc);
+	wbc->blocklen = spdk_bdev_get_block_size(wbc->cache_bdev);
+	wbc->thread = spdk_get_thread();
+
+	wbc->cache_ch = spdk_bdev_get_io_channel(wbc->cache_desc);
+	if (wbc->cache_ch == NULL) {
+		wbcache_free(wbc);
+		return -ENOMEM;
+	}
+
+	wbc->sb = spdk_zmalloc(wbc->blocklen, WBCACHE_BUF_ALIGN, NULL, SPDK_ENV_NUMA_ID_ANY,
+			       SPDK_MALLOC_DMA);
+	if (wbc->sb == NULL) {
+		wbcache_free(wbc);
+		return -ENOMEM;
+	}
+
+	*_wbc = wbc;
+
+	return 0;
+}
+
+/* Open and claim the backing bdev, which must match the superblock of the cache */
+static int
+wbcache_open_base(struct vbdev_wbcache *wbc, const char *base_bdev_name)
+{
+	int rc;
+
+	rc = spdk_bdev_open_ext(base_bdev_name, true, wbcache_bdev_event_cb, NULL,
+				&wbc->base_desc);
+	if (rc != 0) {
+		return rc;
+	}
+
+	wbc->base_bdev = spdk_bdev_desc_get_bdev(wbc->base_desc);
+	wbc->base_ch = spdk_bdev_get_io_channel(wbc->base_desc);
+	if (wbc->base_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	if (spdk_bdev_get_block_size(wbc->base_bdev) != wbc->blocklen ||
+	    spdk_bdev_get_num_blocks(wbc->base_bdev) < wbc->sb->num_blocks ||
+	    spdk_bdev_get_md_size(wbc->base_bdev) != 0) {
+		SPDK_ERRLOG("Backing bdev %s doesn't match cache bdev %s\n",
+			    spdk_bdev_get_name(wbc->base_bdev),
+			    spdk_bdev_get_name(wbc->cache_bdev));
+		return -EINVAL;
+	}
+
+	rc = spdk_bdev_module_claim_bdev(wbc->base_bdev, wbc->base_desc, &wbcache_if);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to claim bdev %s\n", spdk_bdev_get_name(wbc->base_bdev));
+		return rc;
+	}
+	wbc->base_claimed = true;
+
+	rc = spdk_bdev_module_claim_bdev(wbc->cache_bdev, wbc->cache_desc, &wbcache_if);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to claim bdev %s\n", spdk_bdev_get_name(wbc->cache_bdev));
+		return rc;
+	}
+	wbc->cache_claimed = true;
+
+	return 0;
+}
+
+/* Allocate the runtime structures described by the superblock.  The index is kept in hugepage
+ * memory, with an entry for each block of the log.
+ */
+static int
+wbcache_init_runtime(struct vbdev_wbcache *wbc)
+{
+	struct vbdev_wbcache_sb *sb = wbc->sb;
+	uint64_t num_buckets;
+	uint32_t i;
+
+	num_buckets = spdk_align64pow2(sb->log_blocks);
+	wbc->bucket_mask = num_buckets - 1;
+	wbc->buckets = spdk_zmalloc(num_buckets * sizeof(uint32_t), WBCACHE_BUF_ALIGN, NULL,
+				    SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	wbc->entries = spdk_zmalloc(sb->log_blocks * sizeof(struct wbcache_entry),
+				    WBCACHE_BUF_ALIGN, NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	/* Each record takes at least two blocks of the log */
+	wbc->rec_cap = sb->log_blocks / 2 + 1;
+	wbc->records = calloc(wbc->rec_cap, sizeof(*wbc->records));
+	if (wbc->buckets == NULL || wbc->entries == NULL || wbc->records == NULL) {
+		return -ENOMEM;
+	}
+
+	wbc->destage_buf = spdk_zmalloc(WBCACHE_DESTAGE_BLOCKS * wbc->blocklen, WBCACHE_BUF_ALIGN,
+					NULL, SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	wbc->destage_blocks = calloc(WBCACHE_DESTAGE_BLOCKS, sizeof(*wbc->destage_blocks));
+	if (wbc->destage_buf == NULL || wbc->destage_blocks == NULL) {
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&wbc->destage_free_ios);
+	for (i = 0; i < WBCACHE_DESTAGE_QD; i++) {
+		wbc->destage_ios[i].wbc = wbc;
+		TAILQ_INSERT_TAIL(&wbc->destage_free_ios, &wbc->destage_ios[i], link);
+	}
+
+	wbc->reqs = calloc(WBCACHE_NUM_REQS, sizeof(*wbc->reqs));
+	wbc->hdr_bufs = spdk_zmalloc(WBCACHE_NUM_REQS * wbc->blocklen, WBCACHE_BUF_ALIGN, NULL,
+				     SPDK_ENV_NUMA_ID_ANY, SPDK_MALLOC_DMA);
+	if (wbc->reqs == NULL || wbc->hdr_bufs == NULL) {
+		return -ENOMEM;
+	}
+
+	TAILQ_INIT(&wbc->free_reqs);
+	TAILQ_INIT(&wbc->queued_ios);
+	for (i = 0; i < WBCACHE_NUM_REQS; i++) {
+		wbc->reqs[i].wbc = wbc;
+		wbc->reqs[i].hdr = (void *)((uint8_t *)wbc->hdr_bufs + (uint64_t)i * wbc->blocklen);
+		TAILQ_INSERT_TAIL(&wbc->free_reqs, &wbc->reqs[i], link);
+	}
+
+	wbc->log_head = sb->head;
+	wbc->log_tail = sb->head;
+	wbc->next_seq = sb->head_seq;
+
+	return 0;
+}
+
+static int
+wbcache_register(struct vbdev_wbcache *wbc)
+{
+	int rc;
+
+	wbc->wbc_bdev.name = strdup(wbc->sb->name);
+	if (wbc->wbc_bdev.name == NULL) {
+		return -ENOMEM;
+	}
+
+	wbc->wbc_bdev.product_name = "wbcache";
+	/* Logged writes are only durable once the cache bdev write cache is flushed */
+	wbc->wbc_bdev.write_cache = wbc->cache_bdev->write_cache;
+	wbc->wbc_bdev.blocklen = wbc->blocklen;
+	wbc->wbc_bdev.blockcnt = wbc->sb->num_blocks;
+	/* A record must fit in a destage batch, so the bdev layer splits larger I/Os */
+	wbc->wbc_bdev.max_rw_size = WBCACHE_MAX_IO_BLOCKS;
+	wbc->wbc_bdev.max_num_segments = WBCACHE_MAX_IOVS;
+	wbc->wbc_bdev.required_alignment = spdk_max(wbc->base_bdev->required_alignment,
+					   wbc->cache_bdev->required_alignment);
+
+	wbc->wbc_bdev.uuid = wbc->sb->uuid;
+	wbc->wbc_bdev.numa = wbc->base_bdev->numa;
+	wbc->wbc_bdev.ctxt = wbc;
+	wbc->wbc_bdev.fn_table = &vbdev_wbcache_fn_table;
+	wbc->wbc_bdev.module = &wbcache_if;
+
+	spdk_io_device_register(wbc, wbcache_bdev_ch_create_cb, wbcache_bdev_ch_destroy_cb,
+				0, wbc->wbc_bdev.name);
+
+	rc = spdk_bdev_register(&wbc->wbc_bdev);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to register wbcache bdev %s: %s\n", wbc->wbc_bdev.name,
+			    spdk_strerror(-rc));
+		spdk_io_device_unregister(wbc, NULL);
+		return rc;
+	}
+
+	TAILQ_INSERT_TAIL(&g_vbdev_wbcache, wbc, link);
+	SPDK_DEBUGLOG(vbdev_wbcache, "Registered wbcache bdev %s on %s and %s\n",
+		      wbc->wbc_bdev.name, spdk_bdev_get_name(wbc->base_bdev),
+		      spdk_bdev_get_name(wbc->cache_bdev));
+
+	return 0;
+}
+
+static void
+wbcache_init_done(struct vbdev_wbcache *wbc, int status)
+{
+	void (*cb_fn)(void *cb_arg, int status) = wbc->init_cb;
+	void *cb_arg = wbc->init_cb_arg;
+
+	if (status == 0) {
+		status = wbcache_register(wbc);
+	}
+	if (status != 0) {
+		wbcache_free(wbc);
+	}
+
+	cb_fn(cb_arg, status);
+}
+
+static void
+wbcache_create_sb_done(struct vbdev_wbcache *wbc, int status)
+{
+	wbcache_init_done(wbc, status);
+}
+
+static int
+wbcache_init_sb(struct vbdev_wbcache *wbc, const struct vbdev_wbcache_opts *opts)
+{
+	struct vbdev_wbcache_sb *sb = wbc->sb;
+	uint64_t cache_blocks = spdk_bdev_get_num_blocks(wbc->cache_bdev);
+
+	sb->high_watermark = opts->high_watermark ? opts->high_watermark :
+			     VBDEV_WBCACHE_DEFAULT_HIGH_WATERMARK;
+	sb->low_watermark = opts->low_watermark ? opts->low_watermark :
+			    VBDEV_WBCACHE_DEFAULT_LOW_WATERMARK;
+	if (sb->high_watermark > 100 || sb->low_watermark >= sb->high_watermark) {
+		SPDK_ERRLOG("Invalid watermarks %u/%u, the low watermark must be below the high "
+			    "one and both at most 100\n", sb->low_watermark, sb->high_watermark);
+		return -EINVAL;
+	}
+
+	memcpy(sb->signature, WBCACHE_SB_SIGNATURE, sizeof(sb->signature));
+	sb->version = WBCACHE_SB_VERSION;
+	sb->length = sizeof(*sb);
+	sb->block_size = wbc->blocklen;
+	spdk_uuid_generate(&sb->uuid);
+	spdk_uuid_copy(&sb->base_uuid, spdk_bdev_get_uuid(wbc->base_bdev));
+	snprintf(sb->name, sizeof(sb->name), "%s", opts->name);
+	sb->num_blocks = spdk_bdev_get_num_blocks(wbc->base_bdev);
+
+	/* The log starts at 4KiB */
+	sb->log_offset = spdk_max(WBCACHE_BUF_ALIGN / wbc->blocklen, 1);
+	if (cache_blocks < sb->log_offset + 2 * (WBCACHE_MAX_IO_BLOCKS + 1)) {
+		SPDK_ERRLOG("Cache bdev %s is too small\n", spdk_bdev_get_name(wbc->cache_bdev));
+		return -ENOSPC;
+	}
+	/* Log positions are 32-bit */
+	sb->log_blocks = spdk_min(cache_blocks - sb->log_offset, UINT32_MAX - 1);
+	sb->head = 0;
+	sb->head_seq = 1;
+
+	return 0;
+}
+
+int
+create_wbcache_disk(const struct vbdev_wbcache_opts *opts, vbdev_wbcache_create_cb cb_fn,
+		    void *cb_arg)
+{
+	struct vbdev_wbcache *wbc;
+	int rc;
+
+	if (strnlen(opts->name, sizeof(wbc->sb->name)) == sizeof(wbc->sb->name)) {
+		SPDK_ERRLOG("Wbcache bdev name %s is too long\n", opts->name);
+		return -EINVAL;
+	}
+
+	if (spdk_bdev_get_by_name(opts->name) != NULL) {
+		SPDK_ERRLOG("Bdev %s already exists\n", opts->name);
+		return -EEXIST;
+	}
+
+	rc = wbcache_open(opts->cache_bdev_name, &wbc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to open bdev %s: %s\n", opts->cache_bdev_name,
+			    spdk_strerror(-rc));
+		return rc;
+	}
+
+	if (spdk_bdev_get_md_size(wbc->cache_bdev) != 0) {
+		SPDK_ERRLOG("Cache bdev %s with metadata is not supported\n",
+			    opts->cache_bdev_name);
+		rc = -ENOTSUP;
+		goto err;
+	}
+
+	/* The superblock needs the backing bdev, its size is checked later */
+	wbc->sb->num_blocks = 0;
+	rc = wbcache_open_base(wbc, opts->base_bdev_name);
+	if (rc != 0) {
+		goto err;
+	}
+
+	rc = wbcache_init_sb(wbc, opts);
+	if (rc != 0) {
+		goto err;
+	}
+
+	rc = wbcache_init_runtime(wbc);
+	if (rc != 0) {
+		goto err;
+	}
+
+	wbc->init_cb = cb_fn;
+	wbc->init_cb_arg = cb_arg;
+
+	/* Any records left in the log belong to another cache UUID, so it needs no
+	 * initialization.
+	 */
+	wbcache_write_sb(wbc, 0, 1, wbcache_create_sb_done);
+
+	return 0;
+err:
+	wbcache_free(wbc);
+	return rc;
+}
+
+static bool
+wbcache_sb_valid(struct vbdev_wbcache *wbc)
+{
+	struct vbdev_wbcache_sb *sb = wbc->sb;
+	uint64_t cache_blocks = spdk_bdev_get_num_blocks(wbc->cache_bdev);
+
+	if (memcmp(sb->signature, WBCACHE_SB_SIGNATURE, sizeof(sb->signature)) != 0) {
+		return false;
+	}
+
+	if (sb->version != WBCACHE_SB_VERSION || sb->length != sizeof(*sb) ||
+	    sb->crc != wbcache_sb_crc(sb)) {
+		SPDK_WARNLOG("Invalid wbcache superblock on bdev %s\n",
+			     spdk_bdev_get_name(wbc->cache_bdev));
+		return false;
+	}
+
+	if (sb->block_size != wbc->blocklen || sb->num_blocks == 0 ||
+	    sb->name[sizeof(sb->name) - 1] != '\0' || sb->log_offset == 0 ||
+	    sb->log_blocks < 2 * (WBCACHE_MAX_IO_BLOCKS + 1) || sb->log_blocks >= UINT32_MAX ||
+	    sb->log_offset + sb->log_blocks > cache_blocks || sb->head >= sb->log_blocks ||
+	    sb->high_watermark > 100 || sb->low_watermark >= sb->high_watermark) {
+		SPDK_ERRLOG("Unsupported wbcache parameters on bdev %s\n",
+			    spdk_bdev_get_name(wbc->cache_bdev));
+		return false;
+	}
+
+	return true;
+}
+
+static void
+wbcache_load_sb_written(struct vbdev_wbcache *wbc, int status)
+{
+	wbcache_init_done(wbc, status);
+}
+
+static void
+wbcache_load_drained(struct vbdev_wbcache *wbc, int status)
+{
+	if (status != 0) {
+		wbcache_init_done(wbc, status);
+		return;
+	}
+
+	/* Records following the last one replayed may still be found in the log with the next
+	 * sequence numbers.  Skip past any of them, so that none can be mistaken for a new record.
+	 */
+	wbc->next_seq += wbc->sb->log_blocks;
+	wbcache_write_sb(wbc, wbc->log_tail, wbc->next_seq, wbcache_load_sb_written);
+}
+
+static bool
+wbcache_replay_record_valid(struct vbdev_wbcache *wbc, struct vbdev_wbcache_log_hdr *hdr,
+			    uint64_t pos)
+{
+	return hdr->magic == WBCACHE_LOG_MAGIC &&
+	       spdk_uuid_compare(&hdr->uuid, &wbc->sb->uuid) == 0 &&
+	       hdr->seq == wbc->next_seq && hdr->crc == wbcache_log_crc(hdr) &&
+	       hdr->num_blocks > 0 && hdr->num_blocks <= WBCACHE_MAX_IO_BLOCKS &&
+	       hdr->lba + hdr->num_blocks <= wbc->sb->num_blocks &&
+	       pos + 1 + hdr->num_blocks <= wbc->sb->log_blocks;
+}
+
+static void wbcache_replay_read(struct vbdev_wbcache *wbc, uint64_t pos);
+
+/* Apply the records in the window read from the log, in sequence number order */
+static void
+wbcache_replay_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_wbcache *wbc = cb_arg;
+	struct vbdev_wbcache_log_hdr *hdr;
+	struct wbcache_record *rec;
+	uint64_t pos = wbc->destage_start, window = wbc->destage_end - wbc->destage_start;
+	uint64_t offset = 0;
+	uint32_t i;
+	uint8_t *data;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success) {
+		wbcache_init_done(wbc, -EIO);
+		return;
+	}
+
+	while (offset < window) {
+		hdr = (void *)((uint8_t *)wbc->destage_buf + offset * wbc->blocklen);
+		if (!wbcache_replay_record_valid(wbc, hdr, pos + offset)) {
+			break;
+		}
+
+		if (offset + 1 + hdr->num_blocks > window) {
+			/* Read the rest of the record with the next window */
+			wbcache_replay_read(wbc, pos + offset);
+			return;
+		}
+
+		data = (uint8_t *)hdr + wbc->blocklen;
+		if (spdk_crc32c_update(data, (uint64_t)hdr->num_blocks * wbc->blocklen, 0) !=
+		    hdr->data_crc) {
+			SPDK_NOTICELOG("%s: record %" PRIu64 " is torn, ignoring it\n",
+				       wbc->sb->name, hdr->seq);
+			break;
+		}
+
+		rec = wbcache_record_append(wbc, hdr->lba, pos + offset, hdr->num_blocks);
+		rec->done = true;
+		wbc->rec_acked++;
+		for (i = 0; i < rec->num_blocks; i++) {
+			wbcache_index_insert(wbc, rec->lba + i, rec->offset + 1 + i, rec->seq);
+		}
+		offset += 1 + hdr->num_blocks;
+		wbc->log_tail = (pos + offset) % wbc->sb->log_blocks;
+	}
+
+	if (offset == window) {
+		wbcache_replay_read(wbc, (pos + offset) % wbc->sb->log_blocks);
+		return;
+	}
+
+	/* The next record may have been placed at the start of the log, if it didn't fit before
+	 * the end.
+	 */
+	if (pos + offset != 0 && !wbc->replay_wrapped) {
+		wbc->replay_wrapped = true;
+		wbcache_replay_read(wbc, 0);
+		return;
+	}
+
+	SPDK_DEBUGLOG(vbdev_wbcache, "%s: replayed %u records\n", wbc->sb->name, wbc->rec_count);
+
+	/* Destage everything replayed, so the log is empty when the vbdev is registered */
+	wbcache_drain(wbc, true, wbcache_load_drained);
+}
+
+static void
+wbcache_replay_read(struct vbdev_wbcache *wbc, uint64_t pos)
+{
+	int rc;
+
+	wbc->destage_start = pos;
+	wbc->destage_end = pos + spdk_min(WBCACHE_DESTAGE_BLOCKS, wbc->sb->log_blocks - pos);
+
+	rc = spdk_bdev_read_blocks(wbc->cache_desc, wbc->cache_ch, wbc->destage_buf,
+				   wbc->sb->log_offset + pos, wbc->destage_end - pos,
+				   wbcache_replay_read_done, wbc);
+	if (rc != 0) {
+		wbcache_init_done(wbc, rc);
+	}
+}
+
+/* Open the backing bdev of a cache found on examine and replay its log */
+static int
+wbcache_load(struct vbdev_wbcache *wbc, const char *base_bdev_name)
+{
+	int rc;
+
+	rc = wbcache_open_base(wbc, base_bdev_name);
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = wbcache_init_runtime(wbc);
+	if (rc != 0) {
+		return rc;
+	}
+
+	SPDK_NOTICELOG("Found wbcache %s on bdev %s, backing bdev %s\n", wbc->sb->name,
+		       spdk_bdev_get_name(wbc->cache_bdev), spdk_bdev_get_name(wbc->base_bdev));
+
+	wbcache_replay_read(wbc, wbc->sb->head);
+
+	return 0;
+}
+
+static void
+wbcache_examine_done(void *cb_arg, int status)
+{
+	if (status != 0) {
+		SPDK_ERRLOG("Failed to load wbcache: %s\n", spdk_strerror(-status));
+	}
+
+	spdk_bdev_module_examine_done(&wbcache_if);
+}
+
+static void
+wbcache_load_sb_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_wbcache *wbc = cb_arg;
+	char base_uuid[SPDK_UUID_STRING_LEN];
+	int rc;
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (!success || !wbcache_sb_valid(wbc)) {
+		wbcache_free(wbc);
+		spdk_bdev_module_examine_done(&wbcache_if);
+		return;
+	}
+
+	spdk_uuid_fmt_lower(base_uuid, sizeof(base_uuid), &wbc->sb->base_uuid);
+	rc = wbcache_load(wbc, base_uuid);
+	if (rc == -ENODEV) {
+		SPDK_NOTICELOG("Found wbcache %s on bdev %s, waiting for backing bdev %s\n",
+			       wbc->sb->name, spdk_bdev_get_name(wbc->cache_bdev), base_uuid);
+		TAILQ_INSERT_TAIL(&g_wbcache_pending, wbc, link);
+		spdk_bdev_module_examine_done(&wbcache_if);
+		return;
+	}
+	if (rc != 0) {
+		wbcache_init_done(wbc, rc);
+	}
+}
+
+static void
+vbdev_wbcache_examine(struct spdk_bdev *bdev)
+{
+	struct vbdev_wbcache *wbc;
+	int rc;
+
+	/* The backing bdev of a cache examined earlier */
+	TAILQ_FOREACH(wbc, &g_wbcache_pending, link) {
+		if (spdk_uuid_compare(&wbc->sb->base_uuid, spdk_bdev_get_uuid(bdev)) == 0) {
+			TAILQ_REMOVE(&g_wbcache_pending, wbc, link);
+			wbc->init_cb = wbcache_examine_done;
+			rc = wbcache_load(wbc, spdk_bdev_get_name(bdev));
+			if (rc != 0) {
+				wbcache_init_done(wbc, rc);
+			}
+			return;
+		}
+	}
+
+	rc = wbcache_open(spdk_bdev_get_name(bdev), &wbc);
+	if (rc != 0) {
+		spdk_bdev_module_examine_done(&wbcache_if);
+		return;
+	}
+
+	wbc->init_cb = wbcache_examine_done;
+
+	rc = spdk_bdev_read_blocks(wbc->cache_desc, wbc->cache_ch, wbc->sb, 0, 1,
+				   wbcache_load_sb_done, wbc);
+	if (rc != 0) {
+		wbcache_free(wbc);
+		spdk_bdev_module_examine_done(&wbcache_if);
+	}
+}
+
+void
+delete_wbcache_disk(const char *bdev_name, vbdev_wbcache_delete_cb cb_fn, void *cb_arg)
+{
+	struct spdk_bdev *bdev;
+	struct vbdev_wbcache *wbc;
+	int rc;
+
+	bdev = spdk_bdev_get_by_name(bdev_name);
+	if (bdev == NULL || bdev->module != &wbcache_if) {
+		cb_fn(cb_arg, -ENODEV);
+		return;
+	}
+
+	wbc = SPDK_CONTAINEROF(bdev, struct vbdev_wbcache, wbc_bdev);
+	wbc->delete_pending = true;
+
+	rc = spdk_bdev_unregister_by_name(bdev_name, &wbcache_if, cb_fn, cb_arg);
+	if (rc != 0) {
+		wbc->delete_pending = false;
+		cb_fn(cb_arg, rc);
+	}
+}
+
+static int
+vbdev_wbcache_init(void)
+{
+	return 0;
+}
+
+static void
+vbdev_wbcache_finish(void)
+{
+	struct vbdev_wbcache *wbc;
+
+	while ((wbc = TAILQ_FIRST(&g_wbcache_pending))) {
+		TAILQ_REMOVE(&g_wbcache_pending, wbc, link);
+		wbcache_free(wbc);
+	}
+}
+
+static int
+vbdev_wbcache_get_ctx_size(void)
+{
+	return sizeof(struct wbcache_bdev_io);
+}
+
+static struct spdk_bdev_module wbcache_if = {
+	.name = "wbcache",
+	.module_init = vbdev_wbcache_init,
+	.module_fini = vbdev_wbcache_finish,
+	.get_ctx_size = vbdev_wbcache_get_ctx_size,
+	.examine_disk = vbdev_wbcache_examine,
+};
+
+SPDK_BDEV_MODULE_REGISTER(wbcache, &wbcache_if)
+
+SPDK_LOG_REGISTER_COMPONENT(vbdev_wbcache)
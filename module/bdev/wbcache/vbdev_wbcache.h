@@ -0,0 +1,58 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef SPDK_VBDEV_WBCACHE_H
+#define SPDK_VBDEV_WBCACHE_H
+
+#include "spdk/stdinc.h"
+
+#include "spdk/bdev.h"
+
+#define VBDEV_WBCACHE_DEFAULT_HIGH_WATERMARK	70
+#define VBDEV_WBCACHE_DEFAULT_LOW_WATERMARK	30
+
+/* Options used to create a new write-back cache vbdev. */
+struct vbdev_wbcache_opts {
+	/* Name of the write-back cache vbdev to create */
+	const char	*name;
+	/* Name of the backing bdev, which holds the data */
+	const char	*base_bdev_name;
+	/* Name of the cache bdev, which holds the log of the writes not destaged yet */
+	const char	*cache_bdev_name;
+	/* Percentage of the log in use above which the writes are destaged to the backing bdev */
+	uint32_t	high_watermark;
+	/* Percentage of the log in use below which destaging stops */
+	uint32_t	low_watermark;
+};
+
+typedef void (*vbdev_wbcache_create_cb)(void *cb_arg, int bdeverrno);
+typedef void (*vbdev_wbcache_delete_cb)(void *cb_arg, int bdeverrno);
+
+/**
+ * Initialize a write-back cache on the cache bdev and create a vbdev on top of the backing bdev.
+ *
+ * Any data previously stored on the cache bdev is discarded.  The cache metadata is persisted
+ * on the cache bdev, so the vbdev is recreated automatically when both bdevs are examined.
+ *
+ * \param opts Write-back cache vbdev options.
+ * \param cb_fn Function to call after the cache is initialized and the vbdev registered.
+ * \param cb_arg Argument to pass to cb_fn.
+ * \return 0 if initialization was started, negative errno on failure. cb_fn is only called
+ * if 0 is returned.
+ */
+int create_wbcache_disk(const struct vbdev_wbcache_opts *opts, vbdev_wbcache_create_cb cb_fn,
+			void *cb_arg);
+
+/**
+ * Delete a write-back cache vbdev.  All the data in the cache is destaged to the backing bdev
+ * before the cache metadata is destroyed.
+ *
+ * \param bdev_name Write-back cache bdev name.
+ * \param cb_fn Function to call after deletion.
+ * \param cb_arg Argument to pass to cb_fn.
+ */
+void delete_wbcache_disk(const char *bdev_name, vbdev_wbcache_delete_cb cb_fn, void *cb_arg);
+
+#endif /* SPDK_VBDEV_WBCACHE_H */
@@ -0,0 +1,103 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "vbdev_wbcache.h"
+
+#include "spdk/rpc.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+#include "spdk_internal/rpc_autogen.h"
+
+static void
+rpc_bdev_wbcache_create_cb(void *cb_arg, int bdeverrno)
+{
+	struct rpc_bdev_wbcache_create_ctx *req = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (bdeverrno == 0) {
+		w = spdk_jsonrpc_begin_result(req->request);
+		spdk_json_write_string(w, req->name);
+		spdk_jsonrpc_end_result(req->request, w);
+	} else {
+		spdk_jsonrpc_send_error_response(req->request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+
+	free_rpc_bdev_wbcache_create_heap(req);
+}
+
+static void
+rpc_bdev_wbcache_create(struct spdk_jsonrpc_request *request,
+			const struct spdk_json_val *params)
+{
+	struct rpc_bdev_wbcache_create_ctx *req;
+	struct vbdev_wbcache_opts opts = {};
+	int rc;
+
+	req = calloc(1, sizeof(*req));
+	if (req == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENOMEM, spdk_strerror(ENOMEM));
+		return;
+	}
+
+	if (spdk_json_decode_object(params, rpc_bdev_wbcache_create_decoders,
+				    SPDK_COUNTOF(rpc_bdev_wbcache_create_decoders),
+				    req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	req->request = request;
+	opts.name = req->name;
+	opts.base_bdev_name = req->base_bdev_name;
+	opts.cache_bdev_name = req->cache_bdev_name;
+	opts.high_watermark = req->high_watermark;
+	opts.low_watermark = req->low_watermark;
+
+	rc = create_wbcache_disk(&opts, rpc_bdev_wbcache_create_cb, req);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	return;
+
+cleanup:
+	free_rpc_bdev_wbcache_create_heap(req);
+}
+SPDK_RPC_REGISTER("bdev_wbcache_create", rpc_bdev_wbcache_create, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_wbcache_delete_cb(void *cb_arg, int bdeverrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+
+	if (bdeverrno == 0) {
+		spdk_jsonrpc_send_bool_response(request, true);
+	} else {
+		spdk_jsonrpc_send_error_response(request, bdeverrno, spdk_strerror(-bdeverrno));
+	}
+}
+
+static void
+rpc_bdev_wbcache_delete(struct spdk_jsonrpc_request *request,
+			const struct spdk_json_val *params)
+{
+	struct rpc_bdev_wbcache_delete_ctx req = {};
+
+	if (spdk_json_decode_object(params, rpc_bdev_wbcache_delete_decoders,
+				    SPDK_COUNTOF(rpc_bdev_wbcache_delete_decoders),
+				    &req)) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "Invalid parameters");
+		goto cleanup;
+	}
+
+	delete_wbcache_disk(req.name, rpc_bdev_wbcache_delete_cb, request);
+
+cleanup:
+	free_rpc_bdev_wbcache_delete(&req);
+}
+SPDK_RPC_REGISTER("bdev_wbcache_delete", rpc_bdev_wbcache_delete, SPDK_RPC_RUNTIME)
@@ -354,6 +354,12 @@ spdk_bs_bdev_claim(struct spdk_bs_dev *bs_dev, struct spdk_bdev_module *module)
 	return rc;
 }
 
+struct spdk_bdev_desc *
+spdk_bs_bdev_get_desc(struct spdk_bs_dev *bs_dev)
+{
+	return __get_desc(bs_dev);
+}
+
 static struct spdk_io_channel *
 bdev_blob_create_channel(struct spdk_bs_dev *dev)
 {
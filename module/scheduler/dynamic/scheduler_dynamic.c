@@ -21,6 +21,7 @@ struct core_stats {
 	uint64_t idle;
 	uint32_t thread_count;
 	bool isolated;
+	int32_t numa_id;
 };
 
 static struct core_stats *g_cores;
@@ -28,6 +29,7 @@ static struct core_stats *g_cores;
 uint8_t g_scheduler_load_limit = 20;
 uint8_t g_scheduler_core_limit = 80;
 uint8_t g_scheduler_core_busy = 95;
+uint8_t g_scheduler_numa_imbalance = 20;
 
 static uint8_t
 _busy_pct(uint64_t busy, uint64_t idle)
@@ -212,6 +214,54 @@ _can_core_fit_thread(struct spdk_scheduler_thread_info *thread_info, uint32_t ds
 	return _busy_pct(new_busy_tsc, new_idle_tsc) < g_scheduler_core_limit;
 }
 
+/* Returns the average busy percentage of the cores of a NUMA node, or -1 if it has none. */
+static int
+_numa_busy_pct(int32_t numa_id)
+{
+	uint32_t i, count = 0;
+	int pct = 0;
+
+	SPDK_ENV_FOREACH_CORE(i) {
+		if (g_cores[i].numa_id != numa_id || g_cores[i].isolated) {
+			continue;
+		}
+		pct += _busy_pct(g_cores[i].busy, g_cores[i].idle);
+		count++;
+	}
+
+	return count != 0 ? pct / (int)count : -1;
+}
+
+static bool
+_can_leave_numa(int32_t numa_id)
+{
+	int32_t last_numa_id = numa_id;
+	int local_pct, remote_pct;
+	uint32_t i;
+
+	local_pct = _numa_busy_pct(numa_id);
+	if (local_pct < 0) {
+		/* None of the cores are on that node. */
+		return true;
+	}
+
+	/* Only move threads to another node when theirs is much busier. */
+	SPDK_ENV_FOREACH_CORE(i) {
+		if (g_cores[i].isolated || g_cores[i].numa_id == numa_id ||
+		    g_cores[i].numa_id == last_numa_id) {
+			continue;
+		}
+		last_numa_id = g_cores[i].numa_id;
+
+		remote_pct = _numa_busy_pct(last_numa_id);
+		if (local_pct >= remote_pct + g_scheduler_numa_imbalance) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static uint32_t
 _find_optimal_core(struct spdk_scheduler_thread_info *thread_info)
 {
@@ -221,6 +271,8 @@ _find_optimal_core(struct spdk_scheduler_thread_info *thread_info)
 	struct spdk_thread *thread;
 	struct spdk_cpuset *cpumask;
 	bool core_at_limit = _is_core_at_limit(current_lcore);
+	int32_t numa_id = thread_info->numa_id;
+	bool cross_numa = true, off_numa = false;
 
 	thread = spdk_thread_get_by_id(thread_info->thread_id);
 	if (thread == NULL) {
@@ -228,6 +280,13 @@ _find_optimal_core(struct spdk_scheduler_thread_info *thread_info)
 	}
 	cpumask = spdk_thread_get_cpumask(thread);
 
+	/* Keep the thread on the NUMA node of the devices it uses, and bring it back there if it
+	 * has been moved off it, unless that node is overloaded compared to the other ones. */
+	if (numa_id != SPDK_ENV_NUMA_ID_ANY && g_scheduler_numa_imbalance != 0) {
+		cross_numa = _can_leave_numa(numa_id);
+		off_numa = !cross_numa && g_cores[current_lcore].numa_id != numa_id;
+	}
+
 	/* Find a core that can fit the thread. */
 	SPDK_ENV_FOREACH_CORE(i) {
 		/* Ignore cores outside cpumask. */
@@ -240,6 +299,11 @@ _find_optimal_core(struct spdk_scheduler_thread_info *thread_info)
 			continue;
 		}
 
+		/* Skip cores on other NUMA nodes, unless the thread may leave its own. */
+		if (!cross_numa && g_cores[i].numa_id != numa_id) {
+			continue;
+		}
+
 		/* Search for least busy core. */
 		if (g_cores[i].busy < g_cores[least_busy_lcore].busy) {
 			least_busy_lcore = i;
@@ -255,8 +319,9 @@ _find_optimal_core(struct spdk_scheduler_thread_info *thread_info)
 		} else if (i < current_lcore && current_lcore != g_main_lcore) {
 			/* Lower core id was found, move to consolidate threads on lowest core ids. */
 			return i;
-		} else if (core_at_limit) {
-			/* When core is over the limit, any core id is better than current one. */
+		} else if (core_at_limit || off_numa) {
+			/* When core is over the limit, or on the wrong NUMA node, any core id is
+			 * better than current one. */
 			return i;
 		}
 	}
@@ -274,6 +339,8 @@ _find_optimal_core(struct spdk_scheduler_thread_info *thread_info)
 static int
 init(void)
 {
+	uint32_t i;
+
 	g_main_lcore = spdk_scheduler_get_scheduling_lcore();
 
 	if (spdk_governor_set("dpdk_governor") != 0) {
@@ -286,6 +353,10 @@ init(void)
 		return -ENOMEM;
 	}
 
+	SPDK_ENV_FOREACH_CORE(i) {
+		g_cores[i].numa_id = spdk_env_get_numa_id(i);
+	}
+
 	return 0;
 }
 
@@ -399,12 +470,17 @@ struct json_scheduler_opts {
 	uint8_t load_limit;
 	uint8_t core_limit;
 	uint8_t core_busy;
+	uint8_t numa_imbalance;
 };
 
 static const struct spdk_json_object_decoder sched_decoders[] = {
 	{"load_limit", offsetof(struct json_scheduler_opts, load_limit), spdk_json_decode_uint8, true},
 	{"core_limit", offsetof(struct json_scheduler_opts, core_limit), spdk_json_decode_uint8, true},
 	{"core_busy", offsetof(struct json_scheduler_opts, core_busy), spdk_json_decode_uint8, true},
+	{
+		"numa_imbalance", offsetof(struct json_scheduler_opts, numa_imbalance),
+		spdk_json_decode_uint8, true
+	},
 };
 
 static int
@@ -415,6 +491,7 @@ set_opts(const struct spdk_json_val *opts)
 	scheduler_opts.load_limit = g_scheduler_load_limit;
 	scheduler_opts.core_limit = g_scheduler_core_limit;
 	scheduler_opts.core_busy = g_scheduler_core_busy;
+	scheduler_opts.numa_imbalance = g_scheduler_numa_imbalance;
 
 	if (opts != NULL) {
 		if (spdk_json_decode_object_relaxed(opts, sched_decoders,
@@ -430,6 +507,8 @@ set_opts(const struct spdk_json_val *opts)
 	g_scheduler_core_limit = scheduler_opts.core_limit;
 	SPDK_NOTICELOG("Setting scheduler core busy to %d\n", scheduler_opts.core_busy);
 	g_scheduler_core_busy = scheduler_opts.core_busy;
+	SPDK_NOTICELOG("Setting scheduler NUMA imbalance to %d\n", scheduler_opts.numa_imbalance);
+	g_scheduler_numa_imbalance = scheduler_opts.numa_imbalance;
 
 	return 0;
 }
@@ -440,6 +519,7 @@ get_opts(struct spdk_json_write_ctx *ctx)
 	spdk_json_write_named_uint8(ctx, "load_limit", g_scheduler_load_limit);
 	spdk_json_write_named_uint8(ctx, "core_limit", g_scheduler_core_limit);
 	spdk_json_write_named_uint8(ctx, "core_busy", g_scheduler_core_busy);
+	spdk_json_write_named_uint8(ctx, "numa_imbalance", g_scheduler_numa_imbalance);
 }
 
 static struct spdk_scheduler scheduler_dynamic = {
@@ -66,6 +66,7 @@ def add_parser(subparsers):
                                         load_limit=args.load_limit,
                                         core_limit=args.core_limit,
                                         core_busy=args.core_busy,
+                                        numa_imbalance=args.numa_imbalance,
                                         mappings=args.mappings)
 
     p = subparsers.add_parser(
@@ -79,6 +80,9 @@ def add_parser(subparsers):
     p.add_argument('--core-busy',
                    help='Core busy percentage at which the scheduler starts moving threads to other cores (dynamic only). Default: 95',
                    type=int)
+    p.add_argument('--numa-imbalance',
+                   help='Difference in busy percentage between NUMA nodes above which threads may leave the node of their devices; 0 disables NUMA awareness (dynamic only). Default: 20',
+                   type=int)
     p.add_argument('--mappings', help='Comma-separated list of thread:core mappings (static only)')
     p.set_defaults(func=framework_set_scheduler)
 
@@ -99,13 +103,17 @@ def add_parser(subparsers):
     def scheduler_set_options(args):
         args.client.scheduler_set_options(
                                       isolated_core_mask=args.isolated_core_mask,
-                                      scheduling_core=args.scheduling_core)
+                                      scheduling_core=args.scheduling_core,
+                                      thread_steal_period=args.thread_steal_period)
     p = subparsers.add_parser('scheduler_set_options', help='Set scheduler options')
     p.add_argument('-i', '--isolated-core-mask',
                    help='CPU mask of cores excluded from scheduling decisions; must not include scheduling_core', type=str)
     p.add_argument('-s', '--scheduling-core',
                    help='Core that the scheduler runs on; idle threads are moved here. Default: current scheduling core',
                    type=int)
+    p.add_argument('-t', '--thread-steal-period',
+                   help='Period in microseconds at which idle reactors look for threads to take from overloaded reactors on the same NUMA node. Default: 0 (disabled)',
+                   type=int)
     p.set_defaults(func=scheduler_set_options)
 
     def framework_disable_cpumask_locks(args):
@@ -147,6 +155,36 @@ def add_parser(subparsers):
         'thread_get_pollers', help='Display current pollers of all the threads')
     p.set_defaults(func=thread_get_pollers)
 
+    def thread_set_poller_backoff(args):
+        args.client.thread_set_poller_backoff(
+                                         name=args.name,
+                                         max_interval=args.max_interval)
+    p = subparsers.add_parser('thread_set_poller_backoff',
+                              help="""enable adaptive backoff of the pollers with a given name on all
+    the threads. An idle poller is then run exponentially less often.""")
+    p.add_argument('-n', '--name', help='Name of the pollers', required=True)
+    p.add_argument('-m', '--max-interval', dest='max_interval', type=int, required=True,
+                   help='Maximum number of thread iterations between two runs of an idle poller. 0 disables the backoff.')
+    p.set_defaults(func=thread_set_poller_backoff)
+
+    def thread_enable_msg_channels(args):
+        args.client.thread_enable_msg_channels(enabled=args.enabled)
+    p = subparsers.add_parser('thread_enable_msg_channels',
+                              help="""enable or disable the rings dedicated to each pair of threads
+    exchanging messages.""")
+    p.add_argument('--msg-channels', dest='enabled', action=argparse.BooleanOptionalAction,
+                   required=True, help='Enable (true) or disable (false) the message channels')
+    p.set_defaults(func=thread_enable_msg_channels)
+
+    def thread_enable_cycle_accounting(args):
+        args.client.thread_enable_cycle_accounting(enabled=args.enabled)
+    p = subparsers.add_parser('thread_enable_cycle_accounting',
+                              help="""enable or disable the accounting of the cycles spent in each
+    poller, message and interrupt handler.""")
+    p.add_argument('--cycle-accounting', dest='enabled', action=argparse.BooleanOptionalAction,
+                   required=True, help='Enable (true) or disable (false) the cycle accounting')
+    p.set_defaults(func=thread_enable_cycle_accounting)
+
     def thread_get_io_channels(args):
         print_dict(args.client.thread_get_io_channels())
 
@@ -23,7 +23,7 @@ def add_parser(subparsers):
 
     p = subparsers.add_parser('bdev_set_options',
                               help="""Set options of bdev subsystem""")
-    p.add_argument('-p', '--bdev-io-pool-size', help='Number of bdev_io structures in shared buffer pool', type=int)
+    p.add_argument('-p', '--bdev-io-pool-size', help='Number of bdev_io structures in shared buffer pool, per NUMA node with iobuf enable_numa', type=int)
     p.add_argument('-c', '--bdev-io-cache-size', help='Maximum number of bdev_io structures cached per thread', type=int)
     p.add_argument('--auto-examine', dest='bdev_auto_examine', action=argparse.BooleanOptionalAction,
                    help='Enable or disable auto examine')
@@ -46,6 +46,13 @@ def add_parser(subparsers):
                               help="""Report when all bdevs have been examined""")
     p.set_defaults(func=bdev_wait_for_examine)
 
+    def bdev_get_io_cache_stats(args):
+        print_dict(args.client.bdev_get_io_cache_stats())
+
+    p = subparsers.add_parser('bdev_get_io_cache_stats',
+                              help="""Display statistics of the per-thread bdev_io caches""")
+    p.set_defaults(func=bdev_get_io_cache_stats)
+
     def bdev_crypto_create(args):
         print_json(args.client.bdev_crypto_create(
                                                base_bdev_name=args.base_bdev_name,
@@ -72,6 +79,101 @@ def add_parser(subparsers):
     p.add_argument('name', help='crypto bdev name')
     p.set_defaults(func=bdev_crypto_delete)
 
+    def bdev_compress_create(args):
+        print_json(args.client.bdev_compress_create(
+                                                 name=args.name,
+                                                 base_bdev_name=args.base_bdev_name,
+                                                 size_in_mib=args.size_in_mib,
+                                                 chunk_size=args.chunk_size,
+                                                 io_unit_size=args.io_unit_size,
+                                                 comp_algo=args.comp_algo,
+                                                 comp_level=args.comp_level))
+    p = subparsers.add_parser('bdev_compress_create', help='Add a compress vbdev')
+    p.add_argument('base_bdev_name', help="Name of the base bdev")
+    p.add_argument('name', help="Name of the compress vbdev")
+    p.add_argument('-s', '--size-in-mib', help="Logical size in MiB (default: size of the base bdev)", type=int)
+    p.add_argument('-c', '--chunk-size', help="Size of the compressed chunk in bytes", type=int)
+    p.add_argument('-u', '--io-unit-size', help="Size of the backing allocation unit in bytes", type=int)
+    p.add_argument('-a', '--comp-algo', help="Compression algorithm", choices=['deflate', 'lz4'])
+    p.add_argument('-l', '--comp-level', help="Compression level", type=int)
+    p.set_defaults(func=bdev_compress_create)
+
+    def bdev_compress_delete(args):
+        args.client.bdev_compress_delete(name=args.name)
+
+    p = subparsers.add_parser('bdev_compress_delete', help='Delete a compress vbdev')
+    p.add_argument('name', help='compress bdev name')
+    p.set_defaults(func=bdev_compress_delete)
+
+    def bdev_dedup_create(args):
+        print_json(args.client.bdev_dedup_create(
+                                              name=args.name,
+                                              base_bdev_name=args.base_bdev_name,
+                                              size_in_mib=args.size_in_mib,
+                                              block_size=args.block_size))
+    p = subparsers.add_parser('bdev_dedup_create', help='Add a dedup vbdev')
+    p.add_argument('base_bdev_name', help="Name of the base bdev")
+    p.add_argument('name', help="Name of the dedup vbdev")
+    p.add_argument('-s', '--size-in-mib', help="Logical size in MiB (default: size of the base bdev)", type=int)
+    p.add_argument('-b', '--block-size', help="Block size in bytes, the unit of deduplication", type=int)
+    p.set_defaults(func=bdev_dedup_create)
+
+    def bdev_dedup_delete(args):
+        args.client.bdev_dedup_delete(name=args.name)
+
+    p = subparsers.add_parser('bdev_dedup_delete', help='Delete a dedup vbdev')
+    p.add_argument('name', help='dedup bdev name')
+    p.set_defaults(func=bdev_dedup_delete)
+
+    def bdev_rcache_create(args):
+        print_json(args.client.bdev_rcache_create(
+                                               name=args.name,
+                                               base_bdev_name=args.base_bdev_name,
+                                               shard_size_mib=args.shard_size_mib,
+                                               line_size=args.line_size))
+    p = subparsers.add_parser('bdev_rcache_create', help='Add a read cache vbdev')
+    p.add_argument('base_bdev_name', help="Name of the base bdev")
+    p.add_argument('name', help="Name of the read cache vbdev")
+    p.add_argument('-s', '--shard-size-mib', help="Size of the cache kept by each thread in MiB", type=int)
+    p.add_argument('-l', '--line-size', help="Cache line size in bytes", type=int)
+    p.set_defaults(func=bdev_rcache_create)
+
+    def bdev_rcache_delete(args):
+        args.client.bdev_rcache_delete(name=args.name)
+
+    p = subparsers.add_parser('bdev_rcache_delete', help='Delete a read cache vbdev')
+    p.add_argument('name', help='read cache bdev name')
+    p.set_defaults(func=bdev_rcache_delete)
+
+    def bdev_rcache_get_stats(args):
+        print_json(args.client.bdev_rcache_get_stats(name=args.name))
+
+    p = subparsers.add_parser('bdev_rcache_get_stats', help='Get the statistics of a read cache vbdev')
+    p.add_argument('name', help='read cache bdev name')
+    p.set_defaults(func=bdev_rcache_get_stats)
+
+    def bdev_wbcache_create(args):
+        print_json(args.client.bdev_wbcache_create(
+                                                name=args.name,
+                                                base_bdev_name=args.base_bdev_name,
+                                                cache_bdev_name=args.cache_bdev_name,
+                                                high_watermark=args.high_watermark,
+                                                low_watermark=args.low_watermark))
+    p = subparsers.add_parser('bdev_wbcache_create', help='Add a write-back cache vbdev')
+    p.add_argument('base_bdev_name', help="Name of the backing bdev")
+    p.add_argument('cache_bdev_name', help="Name of the cache bdev")
+    p.add_argument('name', help="Name of the write-back cache vbdev")
+    p.add_argument('-H', '--high-watermark', help="Percentage of the log in use at which destaging starts", type=int)
+    p.add_argument('-L', '--low-watermark', help="Percentage of the log in use at which destaging stops", type=int)
+    p.set_defaults(func=bdev_wbcache_create)
+
+    def bdev_wbcache_delete(args):
+        args.client.bdev_wbcache_delete(name=args.name)
+
+    p = subparsers.add_parser('bdev_wbcache_delete', help='Delete a write-back cache vbdev')
+    p.add_argument('name', help='write-back cache bdev name')
+    p.set_defaults(func=bdev_wbcache_delete)
+
     def bdev_ocf_create(args):
         print_json(args.client.bdev_ocf_create(
                                             name=args.name,
@@ -618,7 +720,8 @@ def add_parser(subparsers):
 
     def bdev_enable_histogram(args):
         args.client.bdev_enable_histogram(name=args.name, enable=args.enable, opc=args.opc,
-                                          granularity=args.granularity, min_nsec=args.min_nsec, max_nsec=args.max_nsec)
+                                          granularity=args.granularity, min_nsec=args.min_nsec, max_nsec=args.max_nsec,
+                                          per_io_class=args.per_io_class)
 
     p = subparsers.add_parser('bdev_enable_histogram',
                               help='Enable or disable histogram for specified bdev')
@@ -629,6 +732,8 @@ def add_parser(subparsers):
     p.add_argument('--granularity', help='Histogram bucket granularity.', type=int)
     p.add_argument('--min-nsec', help='Histogram min value in nanoseconds.', type=int)
     p.add_argument('--max-nsec', help='Histogram max value in nanoseconds.', type=int)
+    p.add_argument('--per-io-class', help='Also collect a histogram for each I/O type and size class.',
+                   action='store_true')
     p.add_argument('name', help='bdev name')
     p.set_defaults(func=bdev_enable_histogram)
 
@@ -640,6 +745,14 @@ def add_parser(subparsers):
     p.add_argument('name', help='bdev name')
     p.set_defaults(func=bdev_get_histogram)
 
+    def bdev_get_io_class_histograms(args):
+        print_dict(args.client.bdev_get_io_class_histograms(name=args.name))
+
+    p = subparsers.add_parser('bdev_get_io_class_histograms',
+                              help='Get latency percentiles for each I/O type and size class of bdevs')
+    p.add_argument('-b', '--name', help='bdev name, all bdevs with per I/O class histograms if omitted')
+    p.set_defaults(func=bdev_get_io_class_histograms)
+
     def bdev_get_histogram_borders(args):
         borders = None
         if args.borders:
@@ -672,6 +785,30 @@ def add_parser(subparsers):
                    type=int)
     p.set_defaults(func=bdev_set_qd_sampling_period)
 
+    def bdev_set_latency_slo(args):
+        args.client.bdev_set_latency_slo(
+                                      name=args.name,
+                                      target_latency_us=args.target_latency_us,
+                                      max_queue_depth=args.max_queue_depth)
+
+    p = subparsers.add_parser('bdev_set_latency_slo',
+                              help='Set a 99th percentile latency target on a blockdev')
+    p.add_argument('name', help='Blockdev name. Example: Nvme0n1')
+    p.add_argument('target_latency_us', help='Latency target in microseconds. 0 removes the latency SLO.',
+                   type=int)
+    p.add_argument('-q', '--max-queue-depth', dest='max_queue_depth',
+                   help='Maximum number of I/Os outstanding on each channel (default: 256)', type=int)
+    p.set_defaults(func=bdev_set_latency_slo)
+
+    def bdev_set_span_sample_rate(args):
+        args.client.bdev_set_span_sample_rate(sample_rate=args.sample_rate)
+
+    p = subparsers.add_parser('bdev_set_span_sample_rate',
+                              help='Set how often I/Os are sampled for span tracing')
+    p.add_argument('sample_rate', help='Trace one out of this many I/Os. 0 disables span tracing.',
+                   type=int)
+    p.set_defaults(func=bdev_set_span_sample_rate)
+
     def bdev_set_qos_limit(args):
         args.client.bdev_set_qos_limit(
                                     name=args.name,
@@ -697,6 +834,72 @@ def add_parser(subparsers):
                    type=int)
     p.set_defaults(func=bdev_set_qos_limit)
 
+    def bdev_qos_group_create(args):
+        args.client.bdev_qos_group_create(
+                                       name=args.name,
+                                       parent=args.parent,
+                                       weight=args.weight,
+                                       min_read_ios_per_sec=args.min_read_ios_per_sec,
+                                       rw_ios_per_sec=args.rw_ios_per_sec,
+                                       rw_mbytes_per_sec=args.rw_mbytes_per_sec,
+                                       r_mbytes_per_sec=args.r_mbytes_per_sec,
+                                       w_mbytes_per_sec=args.w_mbytes_per_sec)
+
+    p = subparsers.add_parser('bdev_qos_group_create',
+                              help='Create a QoS group shared by several blockdevs')
+    p.add_argument('name', help='QoS group name. Example: tenant0')
+    p.add_argument('-p', '--parent', help='Name of the top-level parent group')
+    p.add_argument('-w', '--weight',
+                   help='Share of the limits of the parent group relative to the sibling groups (default: 1)',
+                   type=int)
+    p.add_argument('--min-read-ios-per-sec',
+                   help='Read IOs per second allowed to bypass the limits of the group and its parent',
+                   type=int)
+    p.add_argument('--rw-ios-per-sec',
+                   help='R/W IOs per second limit (>=1000, example: 20000). 0 means unlimited.',
+                   type=int)
+    p.add_argument('--rw-mbytes-per-sec',
+                   help="R/W megabytes per second limit (>=1, example: 100). 0 means unlimited.",
+                   type=int)
+    p.add_argument('--r-mbytes-per-sec',
+                   help="Read megabytes per second limit (>=1, example: 100). 0 means unlimited.",
+                   type=int)
+    p.add_argument('--w-mbytes-per-sec',
+                   help="Write megabytes per second limit (>=1, example: 100). 0 means unlimited.",
+                   type=int)
+    p.set_defaults(func=bdev_qos_group_create)
+
+    def bdev_qos_group_delete(args):
+        args.client.bdev_qos_group_delete(name=args.name)
+
+    p = subparsers.add_parser('bdev_qos_group_delete', help='Delete a QoS group')
+    p.add_argument('name', help='QoS group name')
+    p.set_defaults(func=bdev_qos_group_delete)
+
+    def bdev_qos_group_add_bdev(args):
+        args.client.bdev_qos_group_add_bdev(name=args.name, bdev_name=args.bdev_name)
+
+    p = subparsers.add_parser('bdev_qos_group_add_bdev', help='Add a blockdev to a QoS group')
+    p.add_argument('name', help='QoS group name')
+    p.add_argument('bdev_name', help='Blockdev name. Example: Malloc0')
+    p.set_defaults(func=bdev_qos_group_add_bdev)
+
+    def bdev_qos_group_remove_bdev(args):
+        args.client.bdev_qos_group_remove_bdev(bdev_name=args.bdev_name)
+
+    p = subparsers.add_parser('bdev_qos_group_remove_bdev',
+                              help='Remove a blockdev from its QoS group')
+    p.add_argument('bdev_name', help='Blockdev name. Example: Malloc0')
+    p.set_defaults(func=bdev_qos_group_remove_bdev)
+
+    def bdev_qos_get_groups(args):
+        print_json(args.client.bdev_qos_get_groups(name=args.name))
+
+    p = subparsers.add_parser('bdev_qos_get_groups',
+                              help='Display the configuration and usage statistics of QoS groups')
+    p.add_argument('-n', '--name', help='QoS group name')
+    p.set_defaults(func=bdev_qos_get_groups)
+
     def bdev_error_inject_error(args):
         args.client.bdev_error_inject_error(
                                          name=args.name,
@@ -736,7 +939,9 @@ def add_parser(subparsers):
     def bdev_raid_set_options(args):
         args.client.bdev_raid_set_options(
                                        process_window_size_kb=args.process_window_size_kb,
-                                       process_max_bandwidth_mb_sec=args.process_max_bandwidth_mb_sec)
+                                       process_max_bandwidth_mb_sec=args.process_max_bandwidth_mb_sec,
+                                       raid1_read_policy=args.raid1_read_policy,
+                                       write_intent_bitmap=args.write_intent_bitmap)
 
     p = subparsers.add_parser('bdev_raid_set_options',
                               help='Set options for bdev raid.')
@@ -744,6 +949,10 @@ def add_parser(subparsers):
                    help="Background process (e.g. rebuild) window size in KiB")
     p.add_argument('-b', '--process-max-bandwidth-mb-sec', type=int,
                    help="Background process (e.g. rebuild) maximum bandwidth in MiB/Sec")
+    p.add_argument('-r', '--raid1-read-policy', choices=['queue_depth', 'latency'],
+                   help="Base bdev selection policy for raid1 reads")
+    p.add_argument('-i', '--write-intent-bitmap', action='store_true', default=None,
+                   help="Create new raid bdevs with a write-intent bitmap, if supported")
 
     p.set_defaults(func=bdev_raid_set_options)
 
@@ -771,7 +980,7 @@ def add_parser(subparsers):
     p = subparsers.add_parser('bdev_raid_create', help='Create new raid bdev')
     p.add_argument('-n', '--name', help='raid bdev name', required=True)
     p.add_argument('-z', '--strip-size-kb', help='strip size in KB', type=int)
-    p.add_argument('-r', '--raid-level', choices=['raid0', '0', 'raid1', '1', 'raid5f', '5f', 'concat'], help='Raid level', required=True)
+    p.add_argument('-r', '--raid-level', choices=['raid0', '0', 'raid1', '1', 'raid5f', '5f', 'raid6', '6', 'concat'], help='Raid level', required=True)
     p.add_argument('-b', '--base-bdevs', help='base bdevs name, whitespace separated list in quotes', required=True, type=str.split)
     p.add_argument('--uuid', help='UUID for this raid bdev')
     p.add_argument('-s', '--superblock', help='information about raid bdev will be stored in superblock on each base bdev, '
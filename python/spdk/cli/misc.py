@@ -200,7 +200,7 @@ def add_parser(subparsers):
                    choices=['copy', 'fill', 'dualcast', 'compare', 'crc32c', 'copy_crc32c',
                             'compress', 'decompress', 'encrypt', 'decrypt', 'xor',
                             'dif_verify', 'dif_verify_copy', 'dif_generate', 'dif_generate_copy',
-                            'dix_generate', 'dix_verify'],
+                            'dix_generate', 'dix_verify', 'sha256'],
                    help='Accel operation to inject errors into')
     p.add_argument('-t', '--type', required=True,
                    choices=['disable', 'corrupt', 'failure'],
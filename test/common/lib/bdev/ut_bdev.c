@@ -0,0 +1,472 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+/*
+ * Memory backed bdevs for the unit tests of modules stacked on top of other bdevs.  A desc is
+ * the struct ut_bdev itself and all I/O completes on the next poll of the submitting thread.
+ * Tests including this file also need common/lib/ut_multithread.c.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_internal/cunit.h"
+#include "spdk/bdev_module.h"
+#include "spdk/util.h"
+#include "spdk/uuid.h"
+
+#define UT_BDEV_MAX_BDEVS		2
+#define UT_BDEV_MAX_WRITES		64
+#define UT_BDEV_MAX_HELD_WRITES		4
+
+struct ut_bdev_io {
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	bool				success;
+	/* Held write, performed when the test releases it */
+	struct iovec			*iovs;
+	int				iovcnt;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	struct spdk_bdev_io		bdev_io;
+};
+
+struct ut_bdev {
+	struct spdk_bdev	bdev;
+	uint8_t			*data;
+	/* Hot removed, can't be opened */
+	bool			removed;
+	/* Vectored I/O only, the other calls are metadata I/O of the modules under test */
+	uint32_t		reads;
+	uint32_t		writes;
+	/* Offsets of the first UT_BDEV_MAX_WRITES writes */
+	uint64_t		write_offsets[UT_BDEV_MAX_WRITES];
+	uint32_t		flushes;
+	/* Checked for each vectored I/O if set */
+	int			max_iovcnt;
+	/* A write starting at this block fails without changing the data */
+	uint64_t		write_fail_offset;
+	/* Writes are held while set, to complete them out of order or fail them */
+	bool			hold_writes;
+	struct ut_bdev_io	*held_writes[UT_BDEV_MAX_HELD_WRITES];
+	uint32_t		num_held_writes;
+};
+
+int ut_bdev_init(struct ut_bdev *ut, const char *name, uint32_t blocklen, uint64_t blockcnt);
+void ut_bdev_fini(struct ut_bdev *ut);
+void ut_bdev_reset(struct ut_bdev *ut);
+void ut_bdev_release_write(struct ut_bdev *ut, uint32_t idx, bool success);
+uint64_t ut_iov_length(struct iovec *iovs, int iovcnt);
+void ut_cb(void *cb_arg, int status);
+
+static struct ut_bdev *g_ut_bdevs[UT_BDEV_MAX_BDEVS];
+static struct spdk_bdev *g_registered_bdev;
+static spdk_bdev_unregister_cb g_unregister_cb;
+static void *g_unregister_cb_arg;
+static uint32_t g_io_completed;
+static enum spdk_bdev_io_status g_io_status;
+static bool g_cb_called;
+static int g_cb_status;
+
+static int
+ut_bdev_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_bdev_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+/* Must be called on the thread the test runs on */
+int
+ut_bdev_init(struct ut_bdev *ut, const char *name, uint32_t blocklen, uint64_t blockcnt)
+{
+	uint32_t i;
+
+	for (i = 0; i < UT_BDEV_MAX_BDEVS; i++) {
+		if (g_ut_bdevs[i] == NULL) {
+			break;
+		}
+	}
+	if (i == UT_BDEV_MAX_BDEVS) {
+		return -ENOSPC;
+	}
+
+	memset(ut, 0, sizeof(*ut));
+	ut->data = calloc(blockcnt, blocklen);
+	if (ut->data == NULL) {
+		return -ENOMEM;
+	}
+
+	ut->bdev.name = (char *)name;
+	ut->bdev.blocklen = blocklen;
+	ut->bdev.blockcnt = blockcnt;
+	ut->write_fail_offset = UINT64_MAX;
+	spdk_uuid_generate(&ut->bdev.uuid);
+	spdk_io_device_register(ut, ut_bdev_ch_create_cb, ut_bdev_ch_destroy_cb, 0, name);
+	g_ut_bdevs[i] = ut;
+
+	return 0;
+}
+
+void
+ut_bdev_fini(struct ut_bdev *ut)
+{
+	uint32_t i;
+
+	for (i = 0; i < UT_BDEV_MAX_BDEVS; i++) {
+		if (g_ut_bdevs[i] == ut) {
+			g_ut_bdevs[i] = NULL;
+		}
+	}
+
+	spdk_io_device_unregister(ut, NULL);
+	poll_threads();
+	free(ut->data);
+	ut->data = NULL;
+}
+
+/* Zero the data and the counters */
+void
+ut_bdev_reset(struct ut_bdev *ut)
+{
+	memset(ut->data, 0, ut->bdev.blockcnt * ut->bdev.blocklen);
+	ut->reads = 0;
+	ut->writes = 0;
+	ut->flushes = 0;
+}
+
+uint64_t
+ut_iov_length(struct iovec *iovs, int iovcnt)
+{
+	uint64_t len = 0;
+	int i;
+
+	for (i = 0; i < iovcnt; i++) {
+		len += iovs[i].iov_len;
+	}
+
+	return len;
+}
+
+void
+ut_cb(void *cb_arg, int status)
+{
+	g_cb_called = true;
+	g_cb_status = status;
+}
+
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	return spdk_get_io_channel(desc);
+}
+
+/* By name or UUID */
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **desc)
+{
+	char uuid[SPDK_UUID_STRING_LEN];
+	struct ut_bdev *ut;
+	uint32_t i;
+
+	for (i = 0; i < UT_BDEV_MAX_BDEVS; i++) {
+		ut = g_ut_bdevs[i];
+		if (ut == NULL || ut->removed) {
+			continue;
+		}
+
+		spdk_uuid_fmt_lower(uuid, sizeof(uuid), &ut->bdev.uuid);
+		if (strcmp(bdev_name, ut->bdev.name) == 0 || strcmp(bdev_name, uuid) == 0) {
+			*desc = (struct spdk_bdev_desc *)ut;
+			return 0;
+		}
+	}
+
+	return -ENODEV;
+}
+
+void
+spdk_bdev_close(struct spdk_bdev_desc *desc)
+{
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	return &((struct ut_bdev *)desc)->bdev;
+}
+
+const char *
+spdk_bdev_get_name(const struct spdk_bdev *bdev)
+{
+	return bdev->name;
+}
+
+uint32_t
+spdk_bdev_get_block_size(const struct spdk_bdev *bdev)
+{
+	return bdev->blocklen;
+}
+
+uint64_t
+spdk_bdev_get_num_blocks(const struct spdk_bdev *bdev)
+{
+	return bdev->blockcnt;
+}
+
+uint32_t
+spdk_bdev_get_md_size(const struct spdk_bdev *bdev)
+{
+	return bdev->md_len;
+}
+
+bool
+spdk_bdev_is_md_separate(const struct spdk_bdev *bdev)
+{
+	return bdev->md_len != 0 && !bdev->md_interleave;
+}
+
+const struct spdk_uuid *
+spdk_bdev_get_uuid(const struct spdk_bdev *bdev)
+{
+	return &bdev->uuid;
+}
+
+struct spdk_bdev *
+spdk_bdev_get_by_name(const char *bdev_name)
+{
+	if (g_registered_bdev != NULL && strcmp(g_registered_bdev->name, bdev_name) == 0) {
+		return g_registered_bdev;
+	}
+
+	return NULL;
+}
+
+int
+spdk_bdev_register(struct spdk_bdev *bdev)
+{
+	g_registered_bdev = bdev;
+
+	return 0;
+}
+
+int
+spdk_bdev_unregister_by_name(const char *bdev_name, struct spdk_bdev_module *module,
+			     spdk_bdev_unregister_cb cb_fn, void *cb_arg)
+{
+	struct spdk_bdev *bdev = spdk_bdev_get_by_name(bdev_name);
+	int rc;
+
+	if (bdev == NULL) {
+		return -ENODEV;
+	}
+
+	g_registered_bdev = NULL;
+	g_unregister_cb = cb_fn;
+	g_unregister_cb_arg = cb_arg;
+	rc = bdev->fn_table->destruct(bdev->ctxt);
+	CU_ASSERT(rc == 0 || rc == 1);
+	if (rc == 0) {
+		spdk_bdev_destruct_done(bdev, 0);
+	}
+
+	return 0;
+}
+
+void
+spdk_bdev_destruct_done(struct spdk_bdev *bdev, int bdeverrno)
+{
+	spdk_bdev_unregister_cb cb_fn = g_unregister_cb;
+
+	/* Also called when a test destructs the vbdev directly, to unregister it */
+	if (cb_fn != NULL) {
+		g_unregister_cb = NULL;
+		cb_fn(g_unregister_cb_arg, bdeverrno);
+	}
+}
+
+static void
+ut_bdev_io_complete(void *ctx)
+{
+	struct ut_bdev_io *io = ctx;
+
+	io->cb(&io->bdev_io, io->success, io->cb_arg);
+	free(io);
+}
+
+static struct ut_bdev_io *
+ut_bdev_io_alloc(spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_bdev_io *io;
+
+	io = calloc(1, sizeof(*io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	io->success = true;
+
+	return io;
+}
+
+/* NULL iovs write zeroes */
+static int
+ut_bdev_io_submit(struct spdk_bdev_desc *desc, bool write, struct iovec *iovs, int iovcnt,
+		  uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		  void *cb_arg)
+{
+	struct ut_bdev *ut = (struct ut_bdev *)desc;
+	uint64_t len = num_blocks * ut->bdev.blocklen;
+	uint8_t *data = ut->data + offset_blocks * ut->bdev.blocklen;
+	struct ut_bdev_io *io;
+
+	SPDK_CU_ASSERT_FATAL(offset_blocks + num_blocks <= ut->bdev.blockcnt);
+	CU_ASSERT(iovs == NULL || ut_iov_length(iovs, iovcnt) == len);
+
+	io = ut_bdev_io_alloc(cb, cb_arg);
+	if (write && offset_blocks == ut->write_fail_offset) {
+		io->success = false;
+	} else if (iovs == NULL) {
+		memset(data, 0, len);
+	} else if (write) {
+		spdk_copy_iovs_to_buf(data, len, iovs, iovcnt);
+	} else {
+		spdk_copy_buf_to_iovs(iovs, iovcnt, data, len);
+	}
+
+	spdk_thread_send_msg(spdk_get_thread(), ut_bdev_io_complete, io);
+
+	return 0;
+}
+
+/* Complete a held write, a failed one leaves the data untouched */
+void
+ut_bdev_release_write(struct ut_bdev *ut, uint32_t idx, bool success)
+{
+	struct ut_bdev_io *io = ut->held_writes[idx];
+	uint32_t blocklen = ut->bdev.blocklen;
+
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	ut->held_writes[idx] = NULL;
+	if (success) {
+		spdk_copy_iovs_to_buf(ut->data + io->offset_blocks * blocklen,
+				      io->num_blocks * blocklen, io->iovs, io->iovcnt);
+	}
+	io->success = success;
+	spdk_thread_send_msg(spdk_get_thread(), ut_bdev_io_complete, io);
+}
+
+int
+spdk_bdev_readv_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_bdev *ut = (struct ut_bdev *)desc;
+
+	CU_ASSERT(ut->max_iovcnt == 0 || iovcnt <= ut->max_iovcnt);
+	ut->reads++;
+
+	return ut_bdev_io_submit(desc, false, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_writev_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_bdev *ut = (struct ut_bdev *)desc;
+	struct ut_bdev_io *io;
+
+	CU_ASSERT(ut->max_iovcnt == 0 || iovcnt <= ut->max_iovcnt);
+	if (ut->hold_writes) {
+		SPDK_CU_ASSERT_FATAL(ut->num_held_writes < UT_BDEV_MAX_HELD_WRITES);
+		io = ut_bdev_io_alloc(cb, cb_arg);
+		io->iovs = iov;
+		io->iovcnt = iovcnt;
+		io->offset_blocks = offset_blocks;
+		io->num_blocks = num_blocks;
+		ut->held_writes[ut->num_held_writes++] = io;
+		return 0;
+	}
+	if (ut->writes < UT_BDEV_MAX_WRITES) {
+		ut->write_offsets[ut->writes] = offset_blocks;
+	}
+	ut->writes++;
+
+	return ut_bdev_io_submit(desc, true, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks,
+		      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_bdev *ut = (struct ut_bdev *)desc;
+	struct iovec iov = { .iov_base = buf, .iov_len = num_blocks * ut->bdev.blocklen };
+
+	return ut_bdev_io_submit(desc, false, &iov, 1, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_bdev *ut = (struct ut_bdev *)desc;
+	struct iovec iov = { .iov_base = buf, .iov_len = num_blocks * ut->bdev.blocklen };
+
+	return ut_bdev_io_submit(desc, true, &iov, 1, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_write_zeroes_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			      uint64_t offset_blocks, uint64_t num_blocks,
+			      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_bdev_io_submit(desc, true, NULL, 0, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_unmap_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_bdev_io_submit(desc, true, NULL, 0, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_flush_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct ut_bdev *ut = (struct ut_bdev *)desc;
+
+	ut->flushes++;
+	spdk_thread_send_msg(spdk_get_thread(), ut_bdev_io_complete, ut_bdev_io_alloc(cb, cb_arg));
+
+	return 0;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	cb(NULL, bdev_io, true);
+}
+
+/* The bdev_io of the modules under test are allocated by the tests */
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	g_io_status = status;
+	g_io_completed++;
+	free(bdev_io);
+}
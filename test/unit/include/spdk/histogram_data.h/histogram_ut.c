@@ -224,6 +224,36 @@ histogram_get_with_borders_test(void)
 	spdk_histogram_data_free(h);
 }
 
+static void
+histogram_get_percentiles_test(void)
+{
+	struct spdk_histogram_data *h;
+	double percentiles[] = {50, 99, 100};
+	uint64_t values[SPDK_COUNTOF(percentiles)];
+	uint64_t i;
+
+	h = spdk_histogram_data_alloc();
+
+	/* Empty histogram reports 0 for all percentiles */
+	spdk_histogram_data_get_percentiles(h, percentiles, values, SPDK_COUNTOF(percentiles));
+	CU_ASSERT(values[0] == 0);
+	CU_ASSERT(values[1] == 0);
+	CU_ASSERT(values[2] == 0);
+
+	/* Small values have a bucket of their own, so the percentiles are exact */
+	for (i = 1; i <= 100; i++) {
+		spdk_histogram_data_tally(h, i);
+	}
+
+	/* Each value is the end of the bucket, which excludes it */
+	spdk_histogram_data_get_percentiles(h, percentiles, values, SPDK_COUNTOF(percentiles));
+	CU_ASSERT(values[0] == 51);
+	CU_ASSERT(values[1] == 100);
+	CU_ASSERT(values[2] == 101);
+
+	spdk_histogram_data_free(h);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -244,7 +274,8 @@ main(int argc, char **argv)
 		CU_add_test(suite, "histogram_test", histogram_test) == NULL ||
 		CU_add_test(suite, "histogram_merge", histogram_merge) == NULL ||
 		CU_add_test(suite, "histogram_min_max_range_test", histogram_min_max_range_test) == NULL ||
-		CU_add_test(suite, "histogram_get_with_borders_test", histogram_get_with_borders_test) == NULL
+		CU_add_test(suite, "histogram_get_with_borders_test", histogram_get_with_borders_test) == NULL ||
+		CU_add_test(suite, "histogram_get_percentiles_test", histogram_get_percentiles_test) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
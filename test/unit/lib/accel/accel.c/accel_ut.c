@@ -458,6 +458,61 @@ test_spdk_accel_submit_crc32c(void)
 	CU_ASSERT(expected_accel_task == &task);
 }
 
+static void
+test_spdk_accel_submit_sha256(void)
+{
+	uint8_t src[TEST_SUBMIT_SIZE];
+	uint8_t digests[2 * SPDK_ACCEL_SHA256_DIGEST_SIZE];
+	uint8_t expected[SPDK_ACCEL_SHA256_DIGEST_SIZE];
+	struct iovec iov = { .iov_base = src, .iov_len = sizeof(src) };
+	void *cb_arg = NULL;
+	int rc;
+	struct spdk_accel_task task;
+	struct spdk_accel_task_aux_data task_aux;
+	struct spdk_accel_task *expected_accel_task = NULL;
+
+	memset(src, 0x5a, sizeof(src) / 2);
+	memset(src + sizeof(src) / 2, 0xa5, sizeof(src) / 2);
+	g_sw_ch->sha256 = EVP_sha256();
+	g_sw_ch->md_ctx = EVP_MD_CTX_new();
+	SPDK_CU_ASSERT_FATAL(g_sw_ch->md_ctx != NULL);
+
+	STAILQ_INIT(&g_accel_ch->task_pool);
+	SLIST_INIT(&g_accel_ch->task_aux_data_pool);
+
+	/* Fail with a length that isn't a multiple of the block size */
+	rc = spdk_accel_submit_sha256(g_ch, digests, &iov, 1, sizeof(src) / 2 + 1, NULL, cb_arg);
+	CU_ASSERT(rc == -EINVAL);
+
+	/* Fail with no tasks on _get_task() */
+	rc = spdk_accel_submit_sha256(g_ch, digests, &iov, 1, sizeof(src) / 2, NULL, cb_arg);
+	CU_ASSERT(rc == -ENOMEM);
+
+	STAILQ_INSERT_TAIL(&g_accel_ch->task_pool, &task, link);
+	SLIST_INSERT_HEAD(&g_accel_ch->task_aux_data_pool, &task_aux, link);
+
+	/* accel submission OK. */
+	rc = spdk_accel_submit_sha256(g_ch, digests, &iov, 1, sizeof(src) / 2, NULL, cb_arg);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(task.digests == digests);
+	CU_ASSERT(task.block_size == sizeof(src) / 2);
+	CU_ASSERT(task.nbytes == sizeof(src));
+	CU_ASSERT(task.op_code == SPDK_ACCEL_OPC_SHA256);
+	expected_accel_task = STAILQ_FIRST(&g_sw_ch->tasks_to_complete);
+	STAILQ_REMOVE_HEAD(&g_sw_ch->tasks_to_complete, link);
+	CU_ASSERT(expected_accel_task == &task);
+
+	/* One digest per block */
+	CU_ASSERT(EVP_Digest(src, sizeof(src) / 2, expected, NULL, EVP_sha256(), NULL) == 1);
+	CU_ASSERT(memcmp(digests, expected, sizeof(expected)) == 0);
+	CU_ASSERT(EVP_Digest(src + sizeof(src) / 2, sizeof(src) / 2, expected, NULL, EVP_sha256(),
+			     NULL) == 1);
+	CU_ASSERT(memcmp(digests + SPDK_ACCEL_SHA256_DIGEST_SIZE, expected, sizeof(expected)) == 0);
+
+	EVP_MD_CTX_free(g_sw_ch->md_ctx);
+	g_sw_ch->md_ctx = NULL;
+}
+
 static void
 test_spdk_accel_submit_crc32cv(void)
 {
@@ -4527,6 +4582,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_spdk_accel_submit_compare);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_fill);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32c);
+	CU_ADD_TEST(suite, test_spdk_accel_submit_sha256);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_crc32cv);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_copy_crc32c);
 	CU_ADD_TEST(suite, test_spdk_accel_submit_xor);
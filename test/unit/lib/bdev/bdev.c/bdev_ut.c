@@ -1368,6 +1368,86 @@ bdev_io_wait_test(void)
 	ut_fini_bdev();
 }
 
+static void
+bdev_io_cache_stats_cb(struct spdk_bdev_io_cache_stats *stats, void *cb_arg)
+{
+	memcpy(cb_arg, stats, sizeof(*stats));
+}
+
+static void
+bdev_io_cache_batch_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_mgmt_channel *mgmt_ch;
+	struct spdk_bdev_opts bdev_opts = {};
+	struct spdk_bdev_io_cache_stats stats;
+	struct spdk_mempool *pool;
+	size_t pool_count;
+	int i, rc;
+
+	spdk_bdev_get_opts(&bdev_opts, sizeof(bdev_opts));
+	bdev_opts.bdev_io_pool_size = 256;
+	bdev_opts.bdev_io_cache_size = 64;
+	ut_init_bdev(&bdev_opts);
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	SPDK_CU_ASSERT_FATAL(io_ch != NULL);
+
+	mgmt_ch = __io_ch_to_bdev_ch(io_ch)->shared_resource->mgmt_ch;
+	pool = g_bdev_mgr.bdev_io_pool[0];
+	pool_count = spdk_mempool_count(pool);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 64);
+
+	/* Drain the cache, without touching the shared pool */
+	for (i = 0; i < 64; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 0);
+	CU_ASSERT(spdk_mempool_count(pool) == pool_count);
+
+	/* The next allocation refills the cache with a whole batch */
+	rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == BDEV_IO_CACHE_BATCH_SIZE - 1);
+	CU_ASSERT(spdk_mempool_count(pool) == pool_count - BDEV_IO_CACHE_BATCH_SIZE);
+
+	for (i = 0; i < BDEV_IO_CACHE_BATCH_SIZE - 1; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, NULL, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+	}
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 0);
+
+	rc = spdk_bdev_get_io_cache_stats(bdev_io_cache_stats_cb, &stats);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(stats.cache == 64 + BDEV_IO_CACHE_BATCH_SIZE - 1);
+	CU_ASSERT(stats.main == 1);
+	CU_ASSERT(stats.retry == 0);
+
+	/* Fill the cache up, the next free returns a whole batch to the shared pool */
+	stub_complete_io(65);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 64 - BDEV_IO_CACHE_BATCH_SIZE + 1);
+	CU_ASSERT(spdk_mempool_count(pool) == pool_count);
+
+	stub_complete_io(BDEV_IO_CACHE_BATCH_SIZE - 1);
+	CU_ASSERT(mgmt_ch->per_thread_cache_count == 64);
+	CU_ASSERT(spdk_mempool_count(pool) == pool_count);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
 static void
 bdev_io_spans_split_test(void)
 {
@@ -1376,6 +1456,7 @@ bdev_io_spans_split_test(void)
 	struct iovec iov[SPDK_BDEV_IO_NUM_CHILD_IOV];
 
 	memset(&bdev, 0, sizeof(bdev));
+	bdev.fn_table = &fn_table;
 	bdev_io.u.bdev.iovs = iov;
 
 	bdev_io.type = SPDK_BDEV_IO_TYPE_READ;
@@ -3299,12 +3380,185 @@ bdev_io_write_unit_split_test(void)
 	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
 	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
 
+	/* With allow_partial_write_unit, I/O shorter than write_unit_size should be submitted and
+	 * the unaligned ones should still be split on write_unit_size boundaries */
+	bdev->write_unit_size = 32;
+	bdev->allow_partial_write_unit = true;
+	g_io_done = false;
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 0, 31, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)0xF000, 31 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	rc = spdk_bdev_write_blocks(desc, io_ch, (void *)0xF000, 0, 31, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_io_done == false);
+
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	stub_complete_io(1);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	g_io_done = false;
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 1, 31, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)0xF000, 31 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 32, 1, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)(0xF000 + 31 * 512), 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	rc = spdk_bdev_write_blocks(desc, io_ch, (void *)0xF000, 1, 32, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_io_done == false);
+
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	stub_complete_io(2);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
 	spdk_put_io_channel(io_ch);
 	spdk_bdev_close(desc);
 	free_bdev(bdev);
 	ut_fini_bdev();
 }
 
+/* Blocks before this offset are laid out contiguously, the rest starts elsewhere. */
+static uint64_t g_ut_discontiguous_offset;
+
+static uint64_t
+ut_get_contiguous_blocks(void *ctx, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	if (offset_blocks < g_ut_discontiguous_offset) {
+		return spdk_min(num_blocks, g_ut_discontiguous_offset - offset_blocks);
+	}
+
+	return num_blocks;
+}
+
+static void
+bdev_io_contiguous_split_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_opts bdev_opts = {};
+	struct ut_expected_io *expected_io;
+	int rc;
+
+	spdk_bdev_get_opts(&bdev_opts, sizeof(bdev_opts));
+	bdev_opts.bdev_io_pool_size = 512;
+	bdev_opts.bdev_io_cache_size = 64;
+	ut_init_bdev(&bdev_opts);
+
+	fn_table.get_contiguous_blocks = ut_get_contiguous_blocks;
+	g_ut_discontiguous_offset = 48;
+
+	bdev = allocate_bdev("bdev0");
+
+	rc = spdk_bdev_open_ext(bdev->name, true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	bdev->optimal_io_boundary = 16;
+	bdev->split_on_optimal_io_boundary = true;
+
+	/* I/O crossing the boundary within the contiguous range should not get split */
+	g_io_done = false;
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_READ, 14, 8, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)0xF000, 8 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 14, 8, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_io_done == false);
+
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 1);
+	stub_complete_io(1);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+
+	/* I/O crossing the discontinuity should be split only there, the children on either side
+	 * should be merged across the boundaries.
+	 *  Child - Offset 20, length 28, payload 0xF000
+	 *  Child - Offset 48, length 32, payload 0xF000 + 28 * 512
+	 */
+	g_io_done = false;
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 20, 28, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)0xF000, 28 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 48, 32, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)(0xF000 + 28 * 512), 32 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	rc = spdk_bdev_write_blocks(desc, io_ch, (void *)0xF000, 20, 60, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_io_done == false);
+
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	stub_complete_io(2);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Merged children are still limited by max_rw_size
+	 *  Child - Offset 14, length 20, payload 0xF000
+	 *  Child - Offset 34, length 10, payload 0xF000 + 20 * 512
+	 */
+	bdev->max_rw_size = 20;
+	g_io_done = false;
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_READ, 14, 20, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)0xF000, 20 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_READ, 34, 10, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)(0xF000 + 20 * 512), 10 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	rc = spdk_bdev_read_blocks(desc, io_ch, (void *)0xF000, 14, 30, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_io_done == false);
+
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	stub_complete_io(2);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+	bdev->max_rw_size = 0;
+
+	/* Writes split on write_unit_size are never merged */
+	bdev->write_unit_size = 16;
+	bdev->split_on_write_unit = true;
+	g_io_done = false;
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 0, 16, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)0xF000, 16 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	expected_io = ut_alloc_expected_io(SPDK_BDEV_IO_TYPE_WRITE, 16, 16, 1);
+	ut_expected_io_set_iov(expected_io, 0, (void *)(0xF000 + 16 * 512), 16 * 512);
+	TAILQ_INSERT_TAIL(&g_bdev_ut_channel->expected_io, expected_io, link);
+
+	rc = spdk_bdev_write_blocks(desc, io_ch, (void *)0xF000, 0, 32, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_io_done == false);
+
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	stub_complete_io(2);
+	CU_ASSERT(g_io_done == true);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 0);
+
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	fn_table.get_contiguous_blocks = NULL;
+	ut_fini_bdev();
+}
+
 static void
 bdev_io_alignment(void)
 {
@@ -3790,6 +4044,117 @@ bdev_histograms(void)
 	ut_fini_bdev();
 }
 
+static void
+bdev_histograms_per_io_class(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL;
+	struct spdk_io_channel *ch;
+	struct spdk_bdev_enable_histogram_opts opts;
+	struct spdk_bdev_io_class_histograms histograms;
+	int expected[SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES][SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES] = {};
+	uint8_t *buf;
+	int i, j, rc;
+
+	ut_init_bdev(NULL);
+
+	bdev = allocate_bdev("bdev");
+
+	rc = spdk_bdev_open_ext("bdev", true, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+
+	ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(ch != NULL);
+
+	buf = calloc(1, 256 * 512);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	for (i = 0; i < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; i++) {
+		for (j = 0; j < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; j++) {
+			histograms.histogram[i][j] = spdk_histogram_data_alloc();
+			SPDK_CU_ASSERT_FATAL(histograms.histogram[i][j] != NULL);
+		}
+	}
+
+	/* Per I/O class histograms are not kept unless requested */
+	g_status = -1;
+	spdk_bdev_histogram_enable(bdev, histogram_status_cb, NULL, true);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(bdev->internal.histogram_per_io_class == false);
+
+	spdk_bdev_histogram_get_io_classes(bdev, &histograms, histogram_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == -EFAULT);
+
+	spdk_bdev_enable_histogram_opts_init(&opts, sizeof(opts));
+	opts.per_io_class = true;
+	g_status = -1;
+	spdk_bdev_histogram_enable_ext(bdev, histogram_status_cb, NULL, true, &opts);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(bdev->internal.histogram_per_io_class == true);
+
+	/* 512B read, 64KiB write, 128KiB write, 64KiB unmap and 128KiB flush */
+	rc = spdk_bdev_read_blocks(desc, ch, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(desc, ch, buf, 0, 128, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_write_blocks(desc, ch, buf, 0, 256, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_unmap_blocks(desc, ch, 0, 128, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_flush_blocks(desc, ch, 0, 256, io_done, NULL);
+	CU_ASSERT(rc == 0);
+
+	spdk_delay_us(10);
+	stub_complete_io(5);
+	poll_threads();
+
+	g_status = -1;
+	spdk_bdev_histogram_get_io_classes(bdev, &histograms, histogram_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+
+	/* The flush is accounted as other I/O type regardless of its size */
+	expected[SPDK_BDEV_HISTOGRAM_IO_TYPE_READ][SPDK_BDEV_HISTOGRAM_SIZE_4K] = 1;
+	expected[SPDK_BDEV_HISTOGRAM_IO_TYPE_WRITE][SPDK_BDEV_HISTOGRAM_SIZE_64K] = 1;
+	expected[SPDK_BDEV_HISTOGRAM_IO_TYPE_WRITE][SPDK_BDEV_HISTOGRAM_SIZE_LARGE] = 1;
+	expected[SPDK_BDEV_HISTOGRAM_IO_TYPE_UNMAP][SPDK_BDEV_HISTOGRAM_SIZE_64K] = 1;
+	expected[SPDK_BDEV_HISTOGRAM_IO_TYPE_OTHER][SPDK_BDEV_HISTOGRAM_SIZE_4K] = 1;
+
+	for (i = 0; i < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; i++) {
+		for (j = 0; j < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; j++) {
+			g_count = 0;
+			spdk_histogram_data_iterate(histograms.histogram[i][j], histogram_io_count,
+						    NULL);
+			CU_ASSERT(g_count == expected[i][j]);
+		}
+	}
+
+	/* Disabling the histograms drops the per I/O class ones too */
+	spdk_bdev_histogram_enable(bdev, histogram_status_cb, NULL, false);
+	poll_threads();
+	CU_ASSERT(g_status == 0);
+	CU_ASSERT(bdev->internal.histogram_per_io_class == false);
+
+	spdk_bdev_histogram_get_io_classes(bdev, &histograms, histogram_status_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_status == -EFAULT);
+
+	for (i = 0; i < SPDK_BDEV_HISTOGRAM_NUM_IO_TYPES; i++) {
+		for (j = 0; j < SPDK_BDEV_HISTOGRAM_NUM_SIZE_CLASSES; j++) {
+			spdk_histogram_data_free(histograms.histogram[i][j]);
+		}
+	}
+	free(buf);
+	spdk_put_io_channel(ch);
+	spdk_bdev_close(desc);
+	free_bdev(bdev);
+	ut_fini_bdev();
+}
+
 static void
 _bdev_compare(bool emulated)
 {
@@ -8346,6 +8711,162 @@ bdev_io_iobuf_wait_abort(void)
 	ut_fini_bdev();
 }
 
+static struct spdk_bdev *g_span_vbdev;
+static struct spdk_bdev_desc *g_span_base_desc;
+static struct spdk_io_channel *g_span_base_ch;
+static struct spdk_bdev_io *g_span_vbdev_io;
+
+static void
+span_base_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct spdk_bdev_io *parent_io = cb_arg;
+
+	spdk_bdev_free_io(bdev_io);
+	spdk_bdev_io_complete(parent_io, success ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+static void
+span_submit_request(struct spdk_io_channel *_ch, struct spdk_bdev_io *bdev_io)
+{
+	int rc;
+
+	if (bdev_io->bdev != g_span_vbdev) {
+		stub_submit_request(_ch, bdev_io);
+		return;
+	}
+
+	/* Forward the I/O to the base bdev, like a passthru vbdev */
+	g_span_vbdev_io = bdev_io;
+	rc = spdk_bdev_readv_blocks(g_span_base_desc, g_span_base_ch, bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt, bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.num_blocks, span_base_io_done, bdev_io);
+	CU_ASSERT(rc == 0);
+}
+
+static void
+bdev_io_span_test(void)
+{
+	struct spdk_bdev *bdev;
+	struct spdk_bdev_desc *desc = NULL, *vdesc = NULL;
+	struct spdk_io_channel *io_ch, *vio_ch;
+	struct spdk_bdev_io *bdev_io, *child_io;
+	struct bdev_ut_io *bio;
+	void (*submit_request)(struct spdk_io_channel *, struct spdk_bdev_io *);
+	char buf[32 * 512];
+	uint64_t span_id;
+	int rc, i;
+
+	ut_init_bdev(NULL);
+	submit_request = fn_table.submit_request;
+	fn_table.submit_request = span_submit_request;
+
+	bdev = allocate_bdev("bdev0");
+	g_span_vbdev = allocate_vbdev("vbdev0");
+
+	rc = spdk_bdev_open_ext("bdev0", false, bdev_ut_event_cb, NULL, &desc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(desc != NULL);
+	io_ch = spdk_bdev_get_io_channel(desc);
+	CU_ASSERT(io_ch != NULL);
+
+	rc = spdk_bdev_open_ext("vbdev0", false, bdev_ut_event_cb, NULL, &vdesc);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(vdesc != NULL);
+	vio_ch = spdk_bdev_get_io_channel(vdesc);
+	CU_ASSERT(vio_ch != NULL);
+
+	g_span_base_desc = desc;
+	g_span_base_ch = io_ch;
+
+	/* Sampling is disabled by default */
+	CU_ASSERT(spdk_bdev_get_span_sample_rate() == 0);
+	rc = spdk_bdev_read_blocks(desc, io_ch, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_io->internal.span_id == 0);
+	CU_ASSERT(stub_complete_io(1) == 1);
+
+	/* Only every third I/O starts a span */
+	spdk_bdev_set_span_sample_rate(3);
+	CU_ASSERT(spdk_bdev_get_span_sample_rate() == 3);
+	span_id = 0;
+	for (i = 0; i < 6; i++) {
+		rc = spdk_bdev_read_blocks(desc, io_ch, buf, 0, 1, io_done, NULL);
+		CU_ASSERT(rc == 0);
+		if (i % 3 == 2) {
+			CU_ASSERT(g_bdev_io->internal.span_id > span_id);
+			CU_ASSERT(g_bdev_io->internal.span_parent == NULL);
+			CU_ASSERT(g_bdev_io->internal.span_depth == 0);
+			span_id = g_bdev_io->internal.span_id;
+		} else {
+			CU_ASSERT(g_bdev_io->internal.span_id == 0);
+		}
+		CU_ASSERT(stub_complete_io(1) == 1);
+	}
+
+	/* The I/O a vbdev submits to its base bdev joins the span of the vbdev I/O */
+	spdk_bdev_set_span_sample_rate(1);
+	g_io_done = false;
+	rc = spdk_bdev_read_blocks(vdesc, vio_ch, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_bdev_io != g_span_vbdev_io);
+	CU_ASSERT(g_span_vbdev_io->internal.span_id != 0);
+	CU_ASSERT(g_span_vbdev_io->internal.span_depth == 0);
+	CU_ASSERT(g_bdev_io->internal.span_id == g_span_vbdev_io->internal.span_id);
+	CU_ASSERT(g_bdev_io->internal.span_parent == g_span_vbdev_io);
+	CU_ASSERT(g_bdev_io->internal.span_depth == 1);
+	CU_ASSERT(stub_complete_io(1) == 1);
+	CU_ASSERT(g_io_done == true);
+
+	/* The base I/O of an I/O that was not sampled is not sampled either */
+	spdk_bdev_set_span_sample_rate(2);
+	rc = spdk_bdev_read_blocks(vdesc, vio_ch, buf, 0, 1, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_span_vbdev_io->internal.span_id == 0);
+	CU_ASSERT(g_bdev_io->internal.span_id == 0);
+	CU_ASSERT(stub_complete_io(1) == 1);
+
+	/* Split children join the span of their parent */
+	bdev->optimal_io_boundary = 16;
+	bdev->split_on_optimal_io_boundary = true;
+	spdk_bdev_set_span_sample_rate(1);
+	g_io_done = false;
+	rc = spdk_bdev_read_blocks(desc, io_ch, buf, 8, 16, io_done, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_bdev_ut_channel->outstanding_io_count == 2);
+	bio = TAILQ_FIRST(&g_bdev_ut_channel->outstanding_io);
+	SPDK_CU_ASSERT_FATAL(bio != NULL);
+	child_io = spdk_bdev_io_from_ctx(bio);
+	SPDK_CU_ASSERT_FATAL(child_io->internal.f.child_io);
+	bdev_io = child_io->internal.caller_ctx;
+	CU_ASSERT(bdev_io->internal.span_id != 0);
+	TAILQ_FOREACH(bio, &g_bdev_ut_channel->outstanding_io, link) {
+		child_io = spdk_bdev_io_from_ctx(bio);
+		CU_ASSERT(child_io->internal.span_id == bdev_io->internal.span_id);
+		CU_ASSERT(child_io->internal.span_parent == bdev_io);
+		CU_ASSERT(child_io->internal.span_depth == 1);
+	}
+	CU_ASSERT(stub_complete_io(2) == 2);
+	CU_ASSERT(g_io_done == true);
+	bdev->split_on_optimal_io_boundary = false;
+
+	spdk_bdev_set_span_sample_rate(0);
+
+	spdk_put_io_channel(vio_ch);
+	spdk_put_io_channel(io_ch);
+	spdk_bdev_close(vdesc);
+	spdk_bdev_close(desc);
+	free_vbdev(g_span_vbdev);
+	free_bdev(bdev);
+	g_span_vbdev = NULL;
+	g_span_base_desc = NULL;
+	g_span_base_ch = NULL;
+	g_span_vbdev_io = NULL;
+
+	fn_table.submit_request = submit_request;
+	ut_fini_bdev();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -8366,15 +8887,18 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, get_device_stat_test);
 	CU_ADD_TEST(suite, bdev_io_types_test);
 	CU_ADD_TEST(suite, bdev_io_wait_test);
+	CU_ADD_TEST(suite, bdev_io_cache_batch_test);
 	CU_ADD_TEST(suite, bdev_io_spans_split_test);
 	CU_ADD_TEST(suite, bdev_io_boundary_split_test);
 	CU_ADD_TEST(suite, bdev_io_max_size_and_segment_split_test);
 	CU_ADD_TEST(suite, bdev_io_mix_split_test);
 	CU_ADD_TEST(suite, bdev_io_split_with_io_wait);
 	CU_ADD_TEST(suite, bdev_io_write_unit_split_test);
+	CU_ADD_TEST(suite, bdev_io_contiguous_split_test);
 	CU_ADD_TEST(suite, bdev_io_alignment_with_boundary);
 	CU_ADD_TEST(suite, bdev_io_alignment);
 	CU_ADD_TEST(suite, bdev_histograms);
+	CU_ADD_TEST(suite, bdev_histograms_per_io_class);
 	CU_ADD_TEST(suite, bdev_write_zeroes);
 	CU_ADD_TEST(suite, bdev_write_uncorrectable);
 	CU_ADD_TEST(suite, bdev_compare_and_write);
@@ -8427,6 +8951,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, bdev_io_init_dif_ctx_test);
 	CU_ADD_TEST(suite, bdev_io_dif_error_status_test);
 	CU_ADD_TEST(suite, bdev_io_iobuf_wait_abort);
+	CU_ADD_TEST(suite, bdev_io_span_test);
 
 	allocate_cores(1);
 	allocate_threads(1);
@@ -0,0 +1,783 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk_internal/cunit.h"
+
+#include "common/lib/ut_multithread.c"
+#include "spdk_internal/mock.h"
+#include "unit/lib/json_mock.c"
+#include "common/lib/bdev/ut_bdev.c"
+
+#include "bdev/compress/vbdev_compress.c"
+
+#define UT_BLOCKLEN		512
+#define UT_BASE_BLOCKS		(24ULL * 1024 * 1024 / UT_BLOCKLEN)
+#define UT_CHUNK_SIZE		(16 * 1024)
+#define UT_CHUNK_BLOCKS		(UT_CHUNK_SIZE / UT_BLOCKLEN)
+#define UT_SIZE_IN_MIB		2
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB_V(spdk_bdev_io_complete_base_io_status, (struct spdk_bdev_io *bdev_io,
+		const struct spdk_bdev_io *base_io));
+DEFINE_STUB(spdk_bdev_reset, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_accel_get_buf_align, uint8_t,
+	    (enum spdk_accel_opcode opcode, const struct spdk_accel_operation_exec_ctx *ctx), 0);
+
+static struct ut_bdev g_base;
+static uint32_t g_compress_ops;
+static int g_compress_status;
+static int g_accel_dev;
+
+static int
+ut_accel_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_accel_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_accel_get_io_channel(void)
+{
+	return spdk_get_io_channel(&g_accel_dev);
+}
+
+int
+spdk_accel_get_compress_level_range(enum spdk_accel_comp_algo comp_algo,
+				    uint32_t *min_level, uint32_t *max_level)
+{
+	*min_level = 0;
+	*max_level = 9;
+
+	return 0;
+}
+
+/* The fake compression format is the length of the data without its trailing zeroes followed
+ * by the data itself.
+ */
+static int
+ut_compress(void *dst, uint64_t nbytes, void *src, uint32_t len, uint32_t *output_size)
+{
+	uint8_t *data = src;
+	uint32_t n = len;
+
+	while (n > 0 && data[n - 1] == 0) {
+		n--;
+	}
+
+	if (sizeof(n) + n > nbytes) {
+		return -ENOSPC;
+	}
+
+	memcpy(dst, &n, sizeof(n));
+	memcpy((uint8_t *)dst + sizeof(n), data, n);
+	*output_size = sizeof(n) + n;
+
+	return 0;
+}
+
+static void
+ut_decompress(struct iovec *dst_iovs, uint32_t dst_iovcnt, void *src)
+{
+	uint32_t n;
+
+	memcpy(&n, src, sizeof(n));
+	spdk_iov_memset(dst_iovs, dst_iovcnt, 0);
+	spdk_copy_buf_to_iovs(dst_iovs, dst_iovcnt, (uint8_t *)src + sizeof(n), n);
+}
+
+struct ut_compress_ctx {
+	spdk_accel_completion_cb cb_fn;
+	void *cb_arg;
+	int status;
+};
+
+static void
+ut_compress_complete(void *ctx)
+{
+	struct ut_compress_ctx *compress_ctx = ctx;
+
+	compress_ctx->cb_fn(compress_ctx->cb_arg, compress_ctx->status);
+	free(compress_ctx);
+}
+
+int
+spdk_accel_submit_compress_ext(struct spdk_io_channel *ch, void *dst, uint64_t nbytes,
+			       struct iovec *src_iovs, size_t src_iovcnt,
+			       enum spdk_accel_comp_algo comp_algo, uint32_t comp_level,
+			       uint32_t *output_size, spdk_accel_completion_cb cb_fn, void *cb_arg)
+{
+	struct ut_compress_ctx *ctx;
+	uint64_t len = ut_iov_length(src_iovs, src_iovcnt);
+	void *buf;
+
+	ctx = calloc(1, sizeof(*ctx));
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->status = g_compress_status;
+
+	if (ctx->status == 0) {
+		buf = calloc(1, len);
+		SPDK_CU_ASSERT_FATAL(buf != NULL);
+		spdk_copy_iovs_to_buf(buf, len, src_iovs, src_iovcnt);
+		ctx->status = ut_compress(dst, nbytes, buf, len, output_size);
+		free(buf);
+	}
+	g_compress_ops++;
+
+	spdk_thread_send_msg(spdk_get_thread(), ut_compress_complete, ctx);
+
+	return 0;
+}
+
+#define UT_SEQ_MAX_STEPS 2
+
+struct ut_seq_step {
+	enum spdk_accel_opcode	opc;
+	struct iovec		*dst_iovs;
+	uint32_t		dst_iovcnt;
+	struct iovec		*src_iovs;
+	uint32_t		src_iovcnt;
+};
+
+struct spdk_accel_sequence {
+	struct ut_seq_step	steps[UT_SEQ_MAX_STEPS];
+	uint32_t		num_steps;
+};
+
+static int
+ut_seq_append(struct spdk_accel_sequence **pseq, enum spdk_accel_opcode opc,
+	      struct iovec *dst_iovs, uint32_t dst_iovcnt, struct iovec *src_iovs, uint32_t src_iovcnt)
+{
+	struct spdk_accel_sequence *seq = *pseq;
+	struct ut_seq_step *step;
+
+	if (seq == NULL) {
+		seq = calloc(1, sizeof(*seq));
+		SPDK_CU_ASSERT_FATAL(seq != NULL);
+		*pseq = seq;
+	}
+
+	SPDK_CU_ASSERT_FATAL(seq->num_steps < UT_SEQ_MAX_STEPS);
+	step = &seq->steps[seq->num_steps++];
+	step->opc = opc;
+	step->dst_iovs = dst_iovs;
+	step->dst_iovcnt = dst_iovcnt;
+	step->src_iovs = src_iovs;
+	step->src_iovcnt = src_iovcnt;
+
+	return 0;
+}
+
+int
+spdk_accel_append_decompress_ext(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+				 struct iovec *dst_iovs, size_t dst_iovcnt,
+				 struct spdk_memory_domain *dst_domain, void *dst_domain_ctx,
+				 struct iovec *src_iovs, size_t src_iovcnt,
+				 struct spdk_memory_domain *src_domain, void *src_domain_ctx,
+				 enum spdk_accel_comp_algo decomp_algo,
+				 spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	return ut_seq_append(pseq, SPDK_ACCEL_OPC_DECOMPRESS, dst_iovs, dst_iovcnt,
+			     src_iovs, src_iovcnt);
+}
+
+int
+spdk_accel_append_copy(struct spdk_accel_sequence **pseq, struct spdk_io_channel *ch,
+		       struct iovec *dst_iovs, uint32_t dst_iovcnt,
+		       struct spdk_memory_domain *dst_domain, void *dst_domain_ctx,
+		       struct iovec *src_iovs, uint32_t src_iovcnt,
+		       struct spdk_memory_domain *src_domain, void *src_domain_ctx,
+		       spdk_accel_step_cb cb_fn, void *cb_arg)
+{
+	return ut_seq_append(pseq, SPDK_ACCEL_OPC_COPY, dst_iovs, dst_iovcnt, src_iovs, src_iovcnt);
+}
+
+void
+spdk_accel_sequence_abort(struct spdk_accel_sequence *seq)
+{
+	free(seq);
+}
+
+static void
+ut_seq_execute(struct spdk_accel_sequence *seq)
+{
+	struct ut_seq_step *step;
+	uint64_t len;
+	uint32_t i;
+	void *buf;
+
+	for (i = 0; i < seq->num_steps; i++) {
+		step = &seq->steps[i];
+		SPDK_CU_ASSERT_FATAL(step->src_iovcnt == 1);
+		if (step->opc == SPDK_ACCEL_OPC_DECOMPRESS) {
+			ut_decompress(step->dst_iovs, step->dst_iovcnt, step->src_iovs[0].iov_base);
+		} else {
+			len = step->src_iovs[0].iov_len;
+			buf = step->src_iovs[0].iov_base;
+			CU_ASSERT(ut_iov_length(step->dst_iovs, step->dst_iovcnt) == len);
+			spdk_copy_buf_to_iovs(step->dst_iovs, step->dst_iovcnt, buf, len);
+		}
+	}
+
+	free(seq);
+}
+
+/* Decompression is done by the sequence passed along with the read of the compressed chunk */
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			   spdk_bdev_io_completion_cb cb, void *cb_arg,
+			   struct spdk_bdev_ext_io_opts *opts)
+{
+	int rc;
+
+	rc = spdk_bdev_readv_blocks(desc, ch, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+	if (rc == 0 && opts != NULL && opts->accel_sequence != NULL) {
+		ut_seq_execute(opts->accel_sequence);
+	}
+
+	return rc;
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+			    spdk_bdev_io_completion_cb cb, void *cb_arg,
+			    struct spdk_bdev_ext_io_opts *opts)
+{
+	return spdk_bdev_writev_blocks(desc, ch, iov, iovcnt, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+static struct vbdev_compress *
+ut_create(void)
+{
+	struct vbdev_compress_opts opts = {
+		.name = "comp0",
+		.base_bdev_name = g_base.bdev.name,
+		.size_in_mib = UT_SIZE_IN_MIB,
+		.chunk_size = UT_CHUNK_SIZE,
+		.comp_algo = SPDK_ACCEL_COMP_ALGO_DEFLATE,
+		.comp_level = 1,
+	};
+
+	g_cb_called = false;
+	CU_ASSERT(create_compress_disk(&opts, ut_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_registered_bdev != NULL);
+
+	return g_registered_bdev->ctxt;
+}
+
+static struct vbdev_compress *
+ut_examine(void)
+{
+	vbdev_compress_examine(&g_base.bdev);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(g_registered_bdev != NULL);
+
+	return g_registered_bdev->ctxt;
+}
+
+/* Unregister the vbdev without destroying the volume */
+static void
+ut_unregister(struct vbdev_compress *comp)
+{
+	g_registered_bdev = NULL;
+	CU_ASSERT(vbdev_compress_destruct(comp) == 1);
+	poll_threads();
+}
+
+static void
+ut_delete(void)
+{
+	g_cb_called = false;
+	delete_compress_disk("comp0", ut_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	CU_ASSERT(g_registered_bdev == NULL);
+}
+
+static void
+ut_submit_io(struct vbdev_compress *comp, struct spdk_io_channel *ch,
+	     enum spdk_bdev_io_type type, void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct comp_bdev_io) + sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &comp->comp_bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.iovs = (struct iovec *)((uint8_t *)bdev_io->driver_ctx +
+						sizeof(struct comp_bdev_io));
+	bdev_io->u.bdev.iovs[0].iov_base = buf;
+	bdev_io->u.bdev.iovs[0].iov_len = num_blocks * UT_BLOCKLEN;
+	bdev_io->u.bdev.iovcnt = 1;
+
+	vbdev_compress_submit_request(ch, bdev_io);
+}
+
+static void
+ut_io(struct vbdev_compress *comp, struct spdk_io_channel *ch, enum spdk_bdev_io_type type,
+      void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	g_io_completed = 0;
+	ut_submit_io(comp, ch, type, buf, offset_blocks, num_blocks);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+ut_fill(void *buf, uint64_t len, uint64_t data_len, uint8_t pattern)
+{
+	memset(buf, 0, len);
+	memset(buf, pattern, data_len);
+}
+
+static void
+ut_verify(struct vbdev_compress *comp, struct spdk_io_channel *ch, const uint8_t *expected,
+	  uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t len = num_blocks * UT_BLOCKLEN;
+	uint8_t *buf;
+
+	buf = calloc(1, len);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, 0xff, len);
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_READ, buf, offset_blocks, num_blocks);
+	CU_ASSERT(memcmp(buf, expected, len) == 0);
+	free(buf);
+}
+
+static int
+test_setup(void)
+{
+	int rc;
+
+	rc = ut_bdev_init(&g_base, "base0", UT_BLOCKLEN, UT_BASE_BLOCKS);
+	if (rc != 0) {
+		return rc;
+	}
+
+	spdk_io_device_register(&g_accel_dev, ut_accel_ch_create_cb, ut_accel_ch_destroy_cb, 0,
+				"accel");
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	spdk_io_device_unregister(&g_accel_dev, NULL);
+	ut_bdev_fini(&g_base);
+
+	return 0;
+}
+
+static void
+test_create_delete(void)
+{
+	struct vbdev_compress_opts opts = {
+		.name = "comp0",
+		.base_bdev_name = g_base.bdev.name,
+		.comp_algo = SPDK_ACCEL_COMP_ALGO_DEFLATE,
+		.comp_level = 1,
+	};
+	struct vbdev_compress *comp;
+	struct vbdev_compress_sb *sb;
+
+	/* Invalid options */
+	opts.chunk_size = UT_CHUNK_SIZE + UT_BLOCKLEN;
+	CU_ASSERT(create_compress_disk(&opts, ut_cb, NULL) == -EINVAL);
+	opts.chunk_size = 0;
+	opts.comp_level = 10;
+	CU_ASSERT(create_compress_disk(&opts, ut_cb, NULL) == -EINVAL);
+	opts.comp_level = 1;
+	opts.base_bdev_name = "nonexistent";
+	CU_ASSERT(create_compress_disk(&opts, ut_cb, NULL) == -ENODEV);
+	poll_threads();
+	CU_ASSERT(g_registered_bdev == NULL);
+
+	comp = ut_create();
+	CU_ASSERT(comp->comp_bdev.blockcnt == UT_SIZE_IN_MIB * 1024 * 1024 / UT_BLOCKLEN);
+	CU_ASSERT(comp->comp_bdev.optimal_io_boundary == UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp->comp_bdev.split_on_optimal_io_boundary);
+	CU_ASSERT(comp->allocated_chunks == 0);
+
+	/* The superblock is persisted */
+	sb = (struct vbdev_compress_sb *)g_base.data;
+	CU_ASSERT(memcmp(sb->signature, COMP_SB_SIGNATURE, sizeof(sb->signature)) == 0);
+	CU_ASSERT(sb->crc == comp_sb_crc(sb));
+	CU_ASSERT(strcmp(sb->name, "comp0") == 0);
+
+	/* Name is taken */
+	opts.base_bdev_name = g_base.bdev.name;
+	CU_ASSERT(create_compress_disk(&opts, ut_cb, NULL) == -EEXIST);
+
+	/* Delete wipes the superblock so the volume isn't found on examine */
+	ut_delete();
+	CU_ASSERT(spdk_mem_all_zero(sb, sizeof(*sb)));
+	vbdev_compress_examine(&g_base.bdev);
+	poll_threads();
+	CU_ASSERT(g_registered_bdev == NULL);
+
+	g_cb_called = false;
+	delete_compress_disk("comp0", ut_cb, NULL);
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == -ENODEV);
+}
+
+static void
+test_write_read(void)
+{
+	struct vbdev_compress *comp;
+	struct spdk_io_channel *ch;
+	uint8_t *buf, *expected;
+	uint32_t used;
+
+	comp = ut_create();
+	ch = spdk_get_io_channel(comp);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	buf = calloc(1, UT_CHUNK_SIZE);
+	expected = calloc(1, UT_CHUNK_SIZE);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && expected != NULL);
+
+	/* Unallocated chunks read as zeroes */
+	g_base.reads = 0;
+	ut_verify(comp, ch, expected, 0, UT_CHUNK_BLOCKS);
+	CU_ASSERT(g_base.reads == 0);
+
+	/* Compressible full chunk write takes a single io unit */
+	ut_fill(buf, UT_CHUNK_SIZE, 1000, 0xa5);
+	memcpy(expected, buf, UT_CHUNK_SIZE);
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp->allocated_chunks == 1);
+	CU_ASSERT(comp->used_units == 1);
+	CU_ASSERT(comp_map_entry_len(comp->map[0]) == sizeof(uint32_t) + 1000);
+	ut_verify(comp, ch, expected, 0, UT_CHUNK_BLOCKS);
+	ut_verify(comp, ch, expected + 3 * UT_BLOCKLEN, 3, 2);
+
+	/* Partial write of a compressed chunk is read-modify-write */
+	memset(buf, 0x5a, 2 * UT_BLOCKLEN);
+	memcpy(expected + 4 * UT_BLOCKLEN, buf, 2 * UT_BLOCKLEN);
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 4, 2);
+	CU_ASSERT(comp->allocated_chunks == 1);
+	CU_ASSERT(comp->used_units == 1);
+	ut_verify(comp, ch, expected, 0, UT_CHUNK_BLOCKS);
+
+	/* Incompressible data is stored raw and read directly */
+	memset(buf, 0x11, UT_CHUNK_SIZE);
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp_map_entry_len(comp->map[1]) == UT_CHUNK_SIZE);
+	CU_ASSERT(comp->used_units == 1 + UT_CHUNK_SIZE / VBDEV_COMPRESS_DEFAULT_IO_UNIT_SIZE);
+	ut_verify(comp, ch, buf, UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	ut_verify(comp, ch, buf, UT_CHUNK_BLOCKS + 7, 9);
+
+	/* Partial write of an unallocated chunk */
+	ut_fill(buf, UT_CHUNK_SIZE, 0, 0);
+	memset(buf + 8 * UT_BLOCKLEN, 0x77, UT_BLOCKLEN);
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf + 8 * UT_BLOCKLEN, 2 * UT_CHUNK_BLOCKS + 8, 1);
+	ut_verify(comp, ch, buf, 2 * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+
+	/* Failed compression falls back to storing the chunk raw */
+	used = comp->used_units;
+	g_compress_ops = 0;
+	g_compress_status = -EIO;
+	ut_fill(buf, UT_CHUNK_SIZE, 10, 0x33);
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 3 * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	g_compress_status = 0;
+	CU_ASSERT(g_compress_ops == 1);
+	CU_ASSERT(comp_map_entry_len(comp->map[3]) == UT_CHUNK_SIZE);
+	CU_ASSERT(comp->used_units == used + UT_CHUNK_SIZE / VBDEV_COMPRESS_DEFAULT_IO_UNIT_SIZE);
+	ut_verify(comp, ch, buf, 3 * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+
+	/* Overwriting a raw chunk with compressible data releases the old units */
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 3 * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp->used_units == used + 1);
+	ut_verify(comp, ch, buf, 3 * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	free(buf);
+	free(expected);
+}
+
+static void
+test_queued_io(void)
+{
+	struct vbdev_compress *comp;
+	struct spdk_io_channel *ch;
+	uint8_t *bufs[4], *expected;
+	uint32_t i;
+
+	comp = ut_create();
+	ch = spdk_get_io_channel(comp);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	expected = calloc(1, UT_CHUNK_SIZE);
+	SPDK_CU_ASSERT_FATAL(expected != NULL);
+
+	/* Writes to the same chunk are serialized and applied in order */
+	g_io_completed = 0;
+	for (i = 0; i < SPDK_COUNTOF(bufs); i++) {
+		bufs[i] = calloc(1, UT_BLOCKLEN);
+		SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+		memset(bufs[i], i + 1, UT_BLOCKLEN);
+		ut_submit_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, bufs[i], i % 2, 1);
+	}
+	CU_ASSERT(!TAILQ_EMPTY(&comp->queued_ios));
+	poll_threads();
+	CU_ASSERT(g_io_completed == SPDK_COUNTOF(bufs));
+	CU_ASSERT(TAILQ_EMPTY(&comp->queued_ios));
+
+	memset(expected, 3, UT_BLOCKLEN);
+	memset(expected + UT_BLOCKLEN, 4, UT_BLOCKLEN);
+	ut_verify(comp, ch, expected, 0, UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp->used_units == 1);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	for (i = 0; i < SPDK_COUNTOF(bufs); i++) {
+		free(bufs[i]);
+	}
+	free(expected);
+}
+
+static void
+test_unmap(void)
+{
+	struct vbdev_compress *comp;
+	struct spdk_io_channel *ch;
+	uint8_t *buf, *expected;
+	uint32_t i;
+
+	comp = ut_create();
+	ch = spdk_get_io_channel(comp);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	buf = calloc(1, UT_CHUNK_SIZE);
+	expected = calloc(1, UT_CHUNK_SIZE);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && expected != NULL);
+	ut_fill(buf, UT_CHUNK_SIZE, 100, 0xc3);
+
+	for (i = 0; i < 4; i++) {
+		ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, i * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	}
+	CU_ASSERT(comp->allocated_chunks == 4);
+	CU_ASSERT(comp->used_units == 4);
+
+	/* Only the chunks fully covered by the range are released */
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, UT_CHUNK_BLOCKS / 2, 3 * UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp->allocated_chunks == 2);
+	CU_ASSERT(comp->used_units == 2);
+	ut_verify(comp, ch, buf, 0, UT_CHUNK_BLOCKS);
+	ut_verify(comp, ch, expected, UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	ut_verify(comp, ch, expected, 2 * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	ut_verify(comp, ch, buf, 3 * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+
+	/* Unmap of unallocated chunks */
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, UT_CHUNK_BLOCKS, 2 * UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp->allocated_chunks == 2);
+
+	/* Unmap of a chunk that is being read waits for the read */
+	g_io_completed = 0;
+	ut_submit_io(comp, ch, SPDK_BDEV_IO_TYPE_READ, expected, 3 * UT_CHUNK_BLOCKS,
+		     UT_CHUNK_BLOCKS);
+	ut_submit_io(comp, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, 4 * UT_CHUNK_BLOCKS);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 2);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(expected, buf, UT_CHUNK_SIZE) == 0);
+	CU_ASSERT(comp->allocated_chunks == 0);
+	CU_ASSERT(comp_map_entry_len(comp->map[3]) == 0);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	free(buf);
+	free(expected);
+}
+
+static void
+test_replaced_units(void)
+{
+	struct vbdev_compress *comp;
+	struct spdk_io_channel *ch;
+	uint64_t entry, unit;
+	uint8_t *buf;
+	uint32_t i;
+
+	comp = ut_create();
+	ch = spdk_get_io_channel(comp);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	buf = calloc(1, UT_CHUNK_SIZE);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	ut_fill(buf, UT_CHUNK_SIZE, 100, 0x3c);
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, UT_CHUNK_BLOCKS);
+	entry = comp->map[0];
+	unit = comp_map_entry_unit(entry);
+
+	/* Units of an overwritten chunk aren't reused until the base bdev is flushed */
+	ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, UT_CHUNK_BLOCKS);
+	CU_ASSERT(comp->map[0] != entry);
+	CU_ASSERT(comp->used_units == 1);
+	CU_ASSERT(comp->quarantine_units == 1);
+	CU_ASSERT(spdk_bit_array_get(comp->allocated, unit));
+	CU_ASSERT(spdk_bit_array_get(comp->quarantine, unit));
+
+	for (i = 1; i < COMP_QUARANTINE_CHUNKS * comp->chunk_units; i++) {
+		ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, UT_CHUNK_BLOCKS);
+	}
+	CU_ASSERT(comp->quarantine_units == 0);
+	CU_ASSERT(!comp->quarantine_flush_active);
+	CU_ASSERT(!spdk_bit_array_get(comp->allocated, unit));
+	CU_ASSERT(spdk_bit_array_count_set(comp->allocated) == 1);
+	CU_ASSERT(comp->used_units == 1);
+
+	/* A failed log write restores the previous map entry and frees the new units */
+	entry = comp->map[0];
+	g_base.write_fail_offset = comp->sb->log_offset + comp->log_seq;
+	g_io_completed = 0;
+	ut_submit_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, UT_CHUNK_BLOCKS);
+	poll_threads();
+	g_base.write_fail_offset = UINT64_MAX;
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(comp->map[0] == entry);
+	CU_ASSERT(comp->allocated_chunks == 1);
+	CU_ASSERT(comp->used_units == 1);
+	CU_ASSERT(comp->quarantine_units == 0);
+	CU_ASSERT(spdk_bit_array_count_set(comp->allocated) == 1);
+	ut_verify(comp, ch, buf, 0, UT_CHUNK_BLOCKS);
+
+	/* Same for a failed unmap */
+	g_base.write_fail_offset = comp->sb->log_offset + comp->log_seq;
+	g_io_completed = 0;
+	ut_submit_io(comp, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, UT_CHUNK_BLOCKS);
+	poll_threads();
+	g_base.write_fail_offset = UINT64_MAX;
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(comp->map[0] == entry);
+	CU_ASSERT(comp->allocated_chunks == 1);
+	CU_ASSERT(comp->stored_bytes == comp_map_entry_len(entry));
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	free(buf);
+}
+
+static void
+test_reload(void)
+{
+	struct vbdev_compress *comp;
+	struct spdk_io_channel *ch;
+	uint64_t num_chunks, generation, i;
+	uint8_t *buf, *expected;
+
+	comp = ut_create();
+	ch = spdk_get_io_channel(comp);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	num_chunks = comp->sb->num_chunks;
+	generation = comp->sb->generation;
+
+	buf = calloc(1, UT_CHUNK_SIZE);
+	expected = calloc(1, UT_CHUNK_SIZE);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && expected != NULL);
+
+	/* Write enough chunks to wrap the log a few times and trigger checkpoints */
+	for (i = 0; i < 3 * comp->sb->log_blocks; i++) {
+		ut_fill(buf, UT_CHUNK_SIZE, 64 + i % 128, (uint8_t)i);
+		ut_io(comp, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, (i % num_chunks) * UT_CHUNK_BLOCKS,
+		      UT_CHUNK_BLOCKS);
+	}
+	CU_ASSERT(comp->sb->generation > generation);
+	CU_ASSERT(comp->allocated_chunks == num_chunks);
+	CU_ASSERT(comp->used_units == num_chunks);
+
+	/* The last writes are only recorded in the log */
+	CU_ASSERT(comp->log_seq > 0);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_unregister(comp);
+
+	/* Examine replays the log and starts a new generation */
+	comp = ut_examine();
+	CU_ASSERT(comp->allocated_chunks == num_chunks);
+	CU_ASSERT(comp->used_units == num_chunks);
+	CU_ASSERT(comp->log_seq == 0);
+	ch = spdk_get_io_channel(comp);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	for (i = 3 * comp->sb->log_blocks - num_chunks; i < 3 * comp->sb->log_blocks; i++) {
+		ut_fill(expected, UT_CHUNK_SIZE, 64 + i % 128, (uint8_t)i);
+		ut_verify(comp, ch, expected, (i % num_chunks) * UT_CHUNK_BLOCKS, UT_CHUNK_BLOCKS);
+	}
+
+	/* Log blocks of the previous generation are ignored after another reload */
+	generation = comp->sb->generation;
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_unregister(comp);
+	comp = ut_examine();
+	CU_ASSERT(comp->sb->generation == generation + 1);
+	CU_ASSERT(comp->allocated_chunks == num_chunks);
+
+	ut_delete();
+	free(buf);
+	free(expected);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("compress", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_create_delete);
+	CU_ADD_TEST(suite, test_write_read);
+	CU_ADD_TEST(suite, test_queued_io);
+	CU_ADD_TEST(suite, test_unmap);
+	CU_ADD_TEST(suite, test_replaced_units);
+	CU_ADD_TEST(suite, test_reload);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+
+	free_threads();
+
+	CU_cleanup_registry();
+	return num_failures;
+}
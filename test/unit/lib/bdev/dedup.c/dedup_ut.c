@@ -0,0 +1,684 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk_internal/cunit.h"
+
+#include "common/lib/ut_multithread.c"
+#include "spdk_internal/mock.h"
+#include "unit/lib/json_mock.c"
+#include "common/lib/bdev/ut_bdev.c"
+
+#include "bdev/dedup/vbdev_dedup.c"
+
+#include <openssl/evp.h>
+
+#define UT_BLOCKLEN		512
+#define UT_BASE_BLOCKS		(24ULL * 1024 * 1024 / UT_BLOCKLEN)
+#define UT_DEDUP_BLOCKLEN	VBDEV_DEDUP_DEFAULT_BLOCK_SIZE
+#define UT_SIZE_IN_MIB		2
+#define UT_MAX_IOVS		4
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB_V(spdk_bdev_io_complete_base_io_status, (struct spdk_bdev_io *bdev_io,
+		const struct spdk_bdev_io *base_io));
+DEFINE_STUB(spdk_bdev_reset, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_accel_get_buf_align, uint8_t,
+	    (enum spdk_accel_opcode opcode, const struct spdk_accel_operation_exec_ctx *ctx), 0);
+
+/* Data blocks are written with writev, the metadata with write_blocks */
+static struct ut_bdev g_base;
+static uint32_t g_sha256_ops;
+static int g_accel_dev;
+
+static int
+ut_accel_ch_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_accel_ch_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+struct spdk_io_channel *
+spdk_accel_get_io_channel(void)
+{
+	return spdk_get_io_channel(&g_accel_dev);
+}
+
+struct ut_sha256_ctx {
+	spdk_accel_completion_cb cb_fn;
+	void *cb_arg;
+};
+
+static void
+ut_sha256_complete(void *ctx)
+{
+	struct ut_sha256_ctx *sha256_ctx = ctx;
+
+	sha256_ctx->cb_fn(sha256_ctx->cb_arg, 0);
+	free(sha256_ctx);
+}
+
+int
+spdk_accel_submit_sha256(struct spdk_io_channel *ch, uint8_t *digests, struct iovec *iovs,
+			 uint32_t iovcnt, uint32_t block_size, spdk_accel_completion_cb cb_fn,
+			 void *cb_arg)
+{
+	struct ut_sha256_ctx *ctx;
+	uint64_t len = ut_iov_length(iovs, iovcnt), offset;
+	uint8_t *buf;
+
+	CU_ASSERT(len % block_size == 0);
+
+	buf = calloc(1, len);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	spdk_copy_iovs_to_buf(buf, len, iovs, iovcnt);
+	for (offset = 0; offset < len; offset += block_size) {
+		CU_ASSERT(EVP_Digest(buf + offset, block_size, digests, NULL, EVP_sha256(), NULL) == 1);
+		digests += SPDK_ACCEL_SHA256_DIGEST_SIZE;
+	}
+	free(buf);
+
+	ctx = calloc(1, sizeof(*ctx));
+	SPDK_CU_ASSERT_FATAL(ctx != NULL);
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	g_sha256_ops++;
+
+	spdk_thread_send_msg(spdk_get_thread(), ut_sha256_complete, ctx);
+
+	return 0;
+}
+
+static struct vbdev_dedup *
+ut_create(void)
+{
+	struct vbdev_dedup_opts opts = {
+		.name = "dedup0",
+		.base_bdev_name = g_base.bdev.name,
+		.size_in_mib = UT_SIZE_IN_MIB,
+	};
+
+	g_cb_called = false;
+	CU_ASSERT(create_dedup_disk(&opts, ut_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_registered_bdev != NULL);
+
+	return g_registered_bdev->ctxt;
+}
+
+static struct vbdev_dedup *
+ut_examine(void)
+{
+	vbdev_dedup_examine(&g_base.bdev);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(g_registered_bdev != NULL);
+
+	return g_registered_bdev->ctxt;
+}
+
+/* Destruct leaves the metadata on the base bdev for examine to load */
+static void
+ut_unregister(struct vbdev_dedup *dedup)
+{
+	g_registered_bdev = NULL;
+	CU_ASSERT(vbdev_dedup_destruct(dedup) == 1);
+	poll_threads();
+}
+
+static void
+ut_delete(void)
+{
+	g_cb_called = false;
+	delete_dedup_disk("dedup0", ut_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	CU_ASSERT(g_registered_bdev == NULL);
+}
+
+/* Submit an I/O with its buffer split into iovcnt parts, at arbitrary offsets */
+static void
+ut_submit_iov(struct vbdev_dedup *dedup, struct spdk_io_channel *ch, enum spdk_bdev_io_type type,
+	      void *buf, uint64_t offset_blocks, uint64_t num_blocks, int iovcnt)
+{
+	struct spdk_bdev_io *bdev_io;
+	uint64_t len = num_blocks * UT_DEDUP_BLOCKLEN, part = len / iovcnt;
+	int i;
+
+	SPDK_CU_ASSERT_FATAL(iovcnt <= UT_MAX_IOVS);
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct dedup_bdev_io) +
+			 UT_MAX_IOVS * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &dedup->dedup_bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.iovs = (struct iovec *)((uint8_t *)bdev_io->driver_ctx +
+						sizeof(struct dedup_bdev_io));
+	for (i = 0; i < iovcnt; i++) {
+		bdev_io->u.bdev.iovs[i].iov_base = (uint8_t *)buf + i * part;
+		bdev_io->u.bdev.iovs[i].iov_len = i < iovcnt - 1 ? part : len - i * part;
+	}
+	bdev_io->u.bdev.iovcnt = iovcnt;
+
+	vbdev_dedup_submit_request(ch, bdev_io);
+}
+
+static void
+ut_submit_io(struct vbdev_dedup *dedup, struct spdk_io_channel *ch, enum spdk_bdev_io_type type,
+	     void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	ut_submit_iov(dedup, ch, type, buf, offset_blocks, num_blocks, 1);
+}
+
+static void
+ut_io(struct vbdev_dedup *dedup, struct spdk_io_channel *ch, enum spdk_bdev_io_type type,
+      void *buf, uint64_t offset_blocks, uint64_t num_blocks)
+{
+	g_io_completed = 0;
+	ut_submit_io(dedup, ch, type, buf, offset_blocks, num_blocks);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+ut_verify(struct vbdev_dedup *dedup, struct spdk_io_channel *ch, const uint8_t *expected,
+	  uint64_t offset_blocks, uint64_t num_blocks)
+{
+	uint64_t len = num_blocks * UT_DEDUP_BLOCKLEN;
+	uint8_t *buf;
+
+	buf = calloc(1, len);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, 0xff, len);
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_READ, buf, offset_blocks, num_blocks);
+	CU_ASSERT(memcmp(buf, expected, len) == 0);
+	free(buf);
+}
+
+/* Fill each block with a pattern derived from its seed */
+static void
+ut_fill(uint8_t *buf, uint32_t num_blocks, const uint8_t *seeds)
+{
+	uint32_t i;
+
+	for (i = 0; i < num_blocks; i++) {
+		memset(buf + i * UT_DEDUP_BLOCKLEN, seeds[i], UT_DEDUP_BLOCKLEN);
+	}
+}
+
+static int
+test_setup(void)
+{
+	int rc;
+
+	rc = ut_bdev_init(&g_base, "base0", UT_BLOCKLEN, UT_BASE_BLOCKS);
+	if (rc != 0) {
+		return rc;
+	}
+
+	spdk_io_device_register(&g_accel_dev, ut_accel_ch_create_cb, ut_accel_ch_destroy_cb, 0,
+				"accel");
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	spdk_io_device_unregister(&g_accel_dev, NULL);
+	ut_bdev_fini(&g_base);
+
+	return 0;
+}
+
+static void
+test_create_delete(void)
+{
+	struct vbdev_dedup_opts opts = {
+		.name = "dedup0",
+		.base_bdev_name = g_base.bdev.name,
+	};
+	struct vbdev_dedup *dedup;
+	struct vbdev_dedup_sb *sb;
+
+	/* Block size that isn't a multiple of the base block size, or too large */
+	opts.block_size = UT_BLOCKLEN + 1;
+	CU_ASSERT(create_dedup_disk(&opts, ut_cb, NULL) == -EINVAL);
+	opts.block_size = 2 * VBDEV_DEDUP_MAX_BLOCK_SIZE;
+	CU_ASSERT(create_dedup_disk(&opts, ut_cb, NULL) == -EINVAL);
+	opts.block_size = 0;
+	opts.base_bdev_name = "nonexistent";
+	CU_ASSERT(create_dedup_disk(&opts, ut_cb, NULL) == -ENODEV);
+	poll_threads();
+	CU_ASSERT(g_registered_bdev == NULL);
+
+	dedup = ut_create();
+	CU_ASSERT(dedup->dedup_bdev.blocklen == UT_DEDUP_BLOCKLEN);
+	CU_ASSERT(dedup->dedup_bdev.blockcnt == UT_SIZE_IN_MIB * 1024 * 1024 / UT_DEDUP_BLOCKLEN);
+	CU_ASSERT(dedup->dedup_bdev.max_rw_size == DEDUP_MAX_IO_BLOCKS);
+	CU_ASSERT(dedup->dedup_bdev.max_num_segments == DEDUP_MAX_IOVS);
+	CU_ASSERT(dedup->mapped_blocks == 0);
+	CU_ASSERT(dedup->used_blocks == 0);
+
+	/* The regions don't overlap and fit on the base bdev */
+	sb = dedup->sb;
+	CU_ASSERT(sb->fp_blocks * UT_BLOCKLEN >= sb->data_blocks * DEDUP_FP_SIZE);
+	CU_ASSERT(sb->log_offset >= sb->md_offset + sb->map_blocks + sb->fp_blocks);
+	CU_ASSERT(sb->data_offset + sb->data_blocks * UT_DEDUP_BLOCKLEN / UT_BLOCKLEN <=
+		  UT_BASE_BLOCKS);
+
+	/* The superblock is written to the first block of the base bdev */
+	sb = (struct vbdev_dedup_sb *)g_base.data;
+	CU_ASSERT(memcmp(sb->signature, DEDUP_SB_SIGNATURE, sizeof(sb->signature)) == 0);
+	CU_ASSERT(sb->crc == dedup_sb_crc(sb));
+	CU_ASSERT(strcmp(sb->name, "dedup0") == 0);
+
+	/* Only one dedup vbdev per name */
+	opts.base_bdev_name = g_base.bdev.name;
+	CU_ASSERT(create_dedup_disk(&opts, ut_cb, NULL) == -EEXIST);
+
+	/* Examine ignores a base bdev whose superblock was zeroed by delete */
+	ut_delete();
+	CU_ASSERT(spdk_mem_all_zero(sb, sizeof(*sb)));
+	vbdev_dedup_examine(&g_base.bdev);
+	poll_threads();
+	CU_ASSERT(g_registered_bdev == NULL);
+
+	g_cb_called = false;
+	delete_dedup_disk("dedup0", ut_cb, NULL);
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == -ENODEV);
+}
+
+static void
+test_write_read(void)
+{
+	struct vbdev_dedup *dedup;
+	struct spdk_io_channel *ch;
+	uint8_t seeds[] = { 1, 2, 3, 4 }, dup_seeds[] = { 3, 3, 5, 1 };
+	uint8_t *buf, *expected;
+
+	dedup = ut_create();
+	ch = spdk_get_io_channel(dedup);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	buf = calloc(4, UT_DEDUP_BLOCKLEN);
+	expected = calloc(4, UT_DEDUP_BLOCKLEN);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && expected != NULL);
+
+	/* Unmapped blocks read back as zeroes without any base bdev I/O */
+	g_base.reads = 0;
+	ut_verify(dedup, ch, expected, 0, 4);
+	CU_ASSERT(g_base.reads == 0);
+
+	/* Unique blocks are stored with a single write and read back with a single read */
+	ut_fill(buf, 4, seeds);
+	g_base.writes = 0;
+	g_sha256_ops = 0;
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, 4);
+	CU_ASSERT(g_sha256_ops == 1);
+	CU_ASSERT(g_base.writes == 1);
+	CU_ASSERT(dedup->mapped_blocks == 4);
+	CU_ASSERT(dedup->used_blocks == 4);
+	g_base.reads = 0;
+	ut_verify(dedup, ch, buf, 0, 4);
+	CU_ASSERT(g_base.reads == 1);
+
+	/* Duplicates, including one within the same write, only store the new data */
+	ut_fill(expected, 4, dup_seeds);
+	g_base.writes = 0;
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, expected, 8, 4);
+	CU_ASSERT(g_base.writes == 1);
+	CU_ASSERT(dedup->mapped_blocks == 8);
+	CU_ASSERT(dedup->used_blocks == 5);
+	CU_ASSERT(dedup->map[8] == dedup->map[2]);
+	CU_ASSERT(dedup->map[9] == dedup->map[2]);
+	CU_ASSERT(dedup->map[11] == dedup->map[0]);
+	CU_ASSERT(dedup->refcnt[dedup->map[2] - 1] == 3);
+	ut_verify(dedup, ch, expected, 8, 4);
+	ut_verify(dedup, ch, buf, 0, 4);
+
+	/* Buffers split within blocks */
+	memset(buf, 0, 4 * UT_DEDUP_BLOCKLEN);
+	g_io_completed = 0;
+	ut_submit_iov(dedup, ch, SPDK_BDEV_IO_TYPE_READ, buf, 8, 4, 3);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(memcmp(buf, expected, 4 * UT_DEDUP_BLOCKLEN) == 0);
+
+	seeds[0] = 6;
+	ut_fill(buf, 2, seeds);
+	g_io_completed = 0;
+	ut_submit_iov(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 20, 2, 3);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(dedup->used_blocks == 6);
+	CU_ASSERT(dedup->map[21] == dedup->map[1]);
+	ut_verify(dedup, ch, buf, 20, 2);
+
+	/* Overwriting the last reference releases the physical block */
+	ut_fill(buf, 1, &dup_seeds[2]);
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 20, 1);
+	CU_ASSERT(dedup->used_blocks == 5);
+	CU_ASSERT(dedup->mapped_blocks == 10);
+
+	/* Released blocks are removed from the index */
+	seeds[0] = 6;
+	ut_fill(buf, 1, seeds);
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 30, 1);
+	CU_ASSERT(dedup->used_blocks == 6);
+	ut_verify(dedup, ch, buf, 30, 1);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	free(buf);
+	free(expected);
+}
+
+static void
+test_hash_batch(void)
+{
+	struct vbdev_dedup *dedup;
+	struct spdk_io_channel *ch;
+	uint8_t *bufs[6], seed;
+	uint32_t i;
+
+	dedup = ut_create();
+	ch = spdk_get_io_channel(dedup);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	/* Writes submitted while all batches are busy are fingerprinted together */
+	g_sha256_ops = 0;
+	g_io_completed = 0;
+	for (i = 0; i < SPDK_COUNTOF(bufs); i++) {
+		bufs[i] = calloc(1, UT_DEDUP_BLOCKLEN);
+		SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+		seed = i;
+		ut_fill(bufs[i], 1, &seed);
+		ut_submit_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, bufs[i], i, 1);
+	}
+	CU_ASSERT(g_sha256_ops == DEDUP_HASH_BATCHES);
+	CU_ASSERT(!TAILQ_EMPTY(&dedup->hash_queue));
+	poll_threads();
+	CU_ASSERT(g_io_completed == SPDK_COUNTOF(bufs));
+	CU_ASSERT(g_sha256_ops == DEDUP_HASH_BATCHES + 1);
+	CU_ASSERT(TAILQ_EMPTY(&dedup->hash_queue));
+	CU_ASSERT(dedup->mapped_blocks == SPDK_COUNTOF(bufs));
+	CU_ASSERT(dedup->used_blocks == SPDK_COUNTOF(bufs));
+
+	for (i = 0; i < SPDK_COUNTOF(bufs); i++) {
+		ut_verify(dedup, ch, bufs[i], i, 1);
+	}
+
+	/* Writes to one block wait for each other, the last one submitted wins */
+	g_io_completed = 0;
+	for (i = 0; i < SPDK_COUNTOF(bufs); i++) {
+		ut_submit_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, bufs[i], 100, 1);
+	}
+	CU_ASSERT(!TAILQ_EMPTY(&dedup->queued_ios));
+	poll_threads();
+	CU_ASSERT(g_io_completed == SPDK_COUNTOF(bufs));
+	CU_ASSERT(TAILQ_EMPTY(&dedup->queued_ios));
+	ut_verify(dedup, ch, bufs[SPDK_COUNTOF(bufs) - 1], 100, 1);
+	CU_ASSERT(dedup->used_blocks == SPDK_COUNTOF(bufs));
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	for (i = 0; i < SPDK_COUNTOF(bufs); i++) {
+		free(bufs[i]);
+	}
+}
+
+static void
+test_unmap(void)
+{
+	struct vbdev_dedup *dedup;
+	struct spdk_io_channel *ch;
+	uint8_t seeds[] = { 7, 7, 8, 9 };
+	uint8_t *buf, *expected;
+
+	dedup = ut_create();
+	ch = spdk_get_io_channel(dedup);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	buf = calloc(4, UT_DEDUP_BLOCKLEN);
+	expected = calloc(4, UT_DEDUP_BLOCKLEN);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && expected != NULL);
+	ut_fill(buf, 4, seeds);
+
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, 4);
+	CU_ASSERT(dedup->mapped_blocks == 4);
+	CU_ASSERT(dedup->used_blocks == 3);
+
+	/* A shared block is only released with its last reference */
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 1, 2);
+	CU_ASSERT(dedup->mapped_blocks == 2);
+	CU_ASSERT(dedup->used_blocks == 2);
+	ut_verify(dedup, ch, buf, 0, 1);
+	ut_verify(dedup, ch, expected, 1, 2);
+	ut_verify(dedup, ch, buf + 3 * UT_DEDUP_BLOCKLEN, 3, 1);
+
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, 1);
+	CU_ASSERT(dedup->mapped_blocks == 1);
+	CU_ASSERT(dedup->used_blocks == 1);
+
+	/* Unmapping blocks that aren't mapped changes nothing */
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, 3);
+	CU_ASSERT(dedup->mapped_blocks == 1);
+
+	/* An unmap overlapping an in-flight read is deferred until the read is done */
+	g_io_completed = 0;
+	ut_submit_io(dedup, ch, SPDK_BDEV_IO_TYPE_READ, expected, 3, 1);
+	ut_submit_io(dedup, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, 4);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 2);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(expected, buf + 3 * UT_DEDUP_BLOCKLEN, UT_DEDUP_BLOCKLEN) == 0);
+	CU_ASSERT(dedup->mapped_blocks == 0);
+	CU_ASSERT(dedup->map[3] == 0);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	free(buf);
+	free(expected);
+}
+
+static void
+ut_fill_unique(uint8_t *buf, uint32_t id)
+{
+	memset(buf, 0xa5, UT_DEDUP_BLOCKLEN);
+	memcpy(buf, &id, sizeof(id));
+}
+
+static void
+test_released_blocks(void)
+{
+	struct vbdev_dedup *dedup;
+	struct spdk_io_channel *ch;
+	uint64_t entry, pba;
+	uint8_t *buf;
+	uint32_t i;
+
+	dedup = ut_create();
+	ch = spdk_get_io_channel(dedup);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	buf = calloc(1, UT_DEDUP_BLOCKLEN);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	ut_fill_unique(buf, 0);
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, 1);
+	pba = dedup->map[0] - 1;
+
+	/* Overwritten data stays quarantined, not even deduplicated against, until a flush */
+	ut_fill_unique(buf, 1);
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, 1);
+	CU_ASSERT(dedup->used_blocks == 1);
+	CU_ASSERT(dedup->quarantine_blocks == 1);
+	CU_ASSERT(spdk_bit_array_get(dedup->allocated, pba));
+	CU_ASSERT(spdk_bit_array_get(dedup->quarantine, pba));
+	ut_fill_unique(buf, 0);
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 1, 1);
+	CU_ASSERT(dedup->map[1] != pba + 1);
+	CU_ASSERT(dedup->used_blocks == 2);
+
+	for (i = 2; i <= DEDUP_QUARANTINE_BLOCKS; i++) {
+		ut_fill_unique(buf, i);
+		ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, 1);
+	}
+	CU_ASSERT(dedup->quarantine_blocks == 0);
+	CU_ASSERT(!dedup->quarantine_flush_active);
+	CU_ASSERT(!spdk_bit_array_get(dedup->allocated, pba));
+	CU_ASSERT(spdk_bit_array_count_set(dedup->allocated) == 2);
+	CU_ASSERT(dedup->used_blocks == 2);
+
+	/* The old mapping survives a write whose log record fails */
+	entry = dedup->map[0];
+	ut_fill_unique(buf, i);
+	g_base.write_fail_offset = dedup->sb->log_offset + dedup->log_seq;
+	g_io_completed = 0;
+	ut_submit_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, 1);
+	poll_threads();
+	g_base.write_fail_offset = UINT64_MAX;
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(dedup->map[0] == entry);
+	CU_ASSERT(dedup->refcnt[entry - 1] == 1);
+	CU_ASSERT(dedup->mapped_blocks == 2);
+	CU_ASSERT(dedup->used_blocks == 2);
+	ut_fill_unique(buf, i - 1);
+	ut_verify(dedup, ch, buf, 0, 1);
+
+	/* An unmap whose log record fails keeps the mapping as well */
+	g_base.write_fail_offset = dedup->sb->log_offset + dedup->log_seq;
+	g_io_completed = 0;
+	ut_submit_io(dedup, ch, SPDK_BDEV_IO_TYPE_UNMAP, NULL, 0, 1);
+	poll_threads();
+	g_base.write_fail_offset = UINT64_MAX;
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(dedup->map[0] == entry);
+	CU_ASSERT(dedup->refcnt[entry - 1] == 1);
+	CU_ASSERT(dedup->mapped_blocks == 2);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_delete();
+	free(buf);
+}
+
+static void
+test_reload(void)
+{
+	struct vbdev_dedup *dedup;
+	struct spdk_io_channel *ch;
+	uint64_t num_blocks, num_writes, generation, used, i;
+	uint8_t *buf, seed;
+
+	dedup = ut_create();
+	ch = spdk_get_io_channel(dedup);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	num_blocks = dedup->sb->num_blocks;
+	generation = dedup->sb->generation;
+	num_writes = 3 * dedup->sb->log_blocks;
+
+	buf = calloc(1, UT_DEDUP_BLOCKLEN);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	/* Three passes over the log, each wrap checkpoints the map */
+	for (i = 0; i < num_writes; i++) {
+		seed = (uint8_t)i;
+		ut_fill(buf, 1, &seed);
+		ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, i % num_blocks, 1);
+	}
+	CU_ASSERT(dedup->sb->generation > generation);
+	CU_ASSERT(dedup->mapped_blocks == num_blocks);
+	CU_ASSERT(dedup->used_blocks == spdk_min(num_blocks, 256));
+	used = dedup->used_blocks;
+
+	/* Mapping updates since the last checkpoint are only in the log */
+	CU_ASSERT(dedup->log_seq > 0);
+
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_unregister(dedup);
+
+	/* Loading replays the log on top of the checkpoint and rebuilds the index */
+	dedup = ut_examine();
+	CU_ASSERT(dedup->mapped_blocks == num_blocks);
+	CU_ASSERT(dedup->used_blocks == used);
+	CU_ASSERT(dedup->log_seq == 0);
+	ch = spdk_get_io_channel(dedup);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	for (i = num_writes - num_blocks; i < num_writes; i++) {
+		seed = (uint8_t)i;
+		ut_fill(buf, 1, &seed);
+		ut_verify(dedup, ch, buf, i % num_blocks, 1);
+	}
+
+	/* Existing data is found in the rebuilt index */
+	g_base.writes = 0;
+	ut_io(dedup, ch, SPDK_BDEV_IO_TYPE_WRITE, buf, 0, 1);
+	CU_ASSERT(g_base.writes == 0);
+	CU_ASSERT(dedup->used_blocks == used);
+
+	/* Stale log records of the previous generation aren't replayed */
+	generation = dedup->sb->generation;
+	spdk_put_io_channel(ch);
+	poll_threads();
+	ut_unregister(dedup);
+	dedup = ut_examine();
+	CU_ASSERT(dedup->sb->generation == generation + 1);
+	CU_ASSERT(dedup->mapped_blocks == num_blocks);
+
+	ut_delete();
+	free(buf);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("dedup", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_create_delete);
+	CU_ADD_TEST(suite, test_write_read);
+	CU_ADD_TEST(suite, test_hash_batch);
+	CU_ADD_TEST(suite, test_unmap);
+	CU_ADD_TEST(suite, test_released_blocks);
+	CU_ADD_TEST(suite, test_reload);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+
+	free_threads();
+
+	CU_cleanup_registry();
+	return num_failures;
+}
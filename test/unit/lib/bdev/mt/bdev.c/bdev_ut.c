@@ -1267,6 +1267,401 @@ io_during_qos_queue(void)
 	teardown_test();
 }
 
+static void
+io_during_qos_quota_grant(void)
+{
+	struct spdk_io_channel *io_ch[2];
+	struct spdk_bdev_channel *bdev_ch[2];
+	struct bdev_qos_quota *quota[2];
+	struct spdk_bdev_qos_limit *limit;
+	struct spdk_bdev *bdev;
+	enum spdk_bdev_io_status status[20];
+	int i, rc;
+
+	setup_test();
+	MOCK_SET(spdk_get_ticks, 0);
+
+	/* Enable QoS */
+	bdev = &g_bdev.bdev;
+	bdev->internal.qos = calloc(1, sizeof(*bdev->internal.qos));
+	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
+
+	/* 320000 read/write I/O per second, or 320 per millisecond, granted 20 at most */
+	bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].limit = 320000;
+
+	g_get_io_channel = true;
+
+	/* Create channels */
+	set_thread(0);
+	io_ch[0] = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch[0] = spdk_io_channel_get_ctx(io_ch[0]);
+	CU_ASSERT(bdev_ch[0]->flags == BDEV_CH_QOS_ENABLED);
+	quota[0] = &bdev_ch[0]->qos_quota[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT];
+
+	set_thread(1);
+	io_ch[1] = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch[1] = spdk_io_channel_get_ctx(io_ch[1]);
+	CU_ASSERT(bdev_ch[1]->flags == BDEV_CH_QOS_ENABLED);
+	quota[1] = &bdev_ch[1]->qos_quota[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT];
+
+	limit = &bdev->internal.qos->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT];
+	CU_ASSERT(limit->max_per_timeslice == 320);
+	CU_ASSERT(limit->quota_per_grant == 20);
+
+	/* Without a previous timeslice to size them from, the grants cover a single I/O */
+	set_thread(0);
+	for (i = 0; i < 20; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done,
+					   &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(limit->remaining_this_timeslice == 300);
+	CU_ASSERT(quota[0]->remaining == 0);
+	CU_ASSERT(quota[0]->used == 20);
+
+	set_thread(1);
+	status[0] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(limit->remaining_this_timeslice == 299);
+	CU_ASSERT(quota[1]->remaining == 0);
+
+	set_thread(0);
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 20);
+	set_thread(1);
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+	poll_threads();
+	for (i = 0; i < 20; i++) {
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	/* The unused quota is not added to the refilled one.  In the new timeslice, each
+	 * channel is granted what it used in the previous one, so the lightly loaded channel
+	 * on thread 1 doesn't hold quota it won't use.
+	 */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(limit->remaining_this_timeslice == 320);
+
+	status[0] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[1], NULL, 0, 1, io_during_io_done, &status[0]);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(limit->remaining_this_timeslice == 319);
+	CU_ASSERT(quota[1]->grant == 1);
+	CU_ASSERT(quota[1]->remaining == 0);
+
+	set_thread(0);
+	status[1] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &status[1]);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(quota[0]->grant == 20);
+	CU_ASSERT(limit->remaining_this_timeslice == 300);
+	CU_ASSERT(quota[0]->remaining == 18);
+
+	/* Once the quota runs low, the grants shrink with it */
+	for (i = 2; i < 20; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done,
+					   &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(limit->remaining_this_timeslice == 300);
+	CU_ASSERT(quota[0]->remaining == 0);
+
+	limit->remaining_this_timeslice = 40;
+	status[2] = SPDK_BDEV_IO_STATUS_PENDING;
+	rc = spdk_bdev_read_blocks(g_desc, io_ch[0], NULL, 0, 1, io_during_io_done, &status[2]);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(limit->remaining_this_timeslice == 38);
+	CU_ASSERT(quota[0]->remaining == 1);
+
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 20);
+	set_thread(1);
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+	poll_threads();
+	for (i = 0; i < 20; i++) {
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	/* Tear down the channels */
+	set_thread(1);
+	spdk_put_io_channel(io_ch[1]);
+	set_thread(0);
+	spdk_put_io_channel(io_ch[0]);
+	poll_threads();
+
+	teardown_test();
+}
+
+static void
+qos_group_status_cb(void *cb_arg, int status)
+{
+	*(int *)cb_arg = status;
+}
+
+static void
+io_during_qos_group(void)
+{
+	struct spdk_bdev_qos_group_opts opts;
+	struct spdk_bdev_qos_group *group, *parent, *child[2];
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_channel *bdev_ch;
+	struct spdk_bdev *bdev;
+	enum spdk_bdev_io_status status[3];
+	int i, rc, cb_rc;
+
+	setup_test();
+	MOCK_SET(spdk_get_ticks, 0);
+	set_thread(0);
+
+	/* 2000 read/write I/O per second, or 2 per millisecond, shared by the member bdevs */
+	spdk_bdev_qos_group_opts_init(&opts, sizeof(opts));
+	opts.limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 2000;
+	rc = spdk_bdev_qos_group_create("group0", &opts);
+	CU_ASSERT(rc == 0);
+	rc = spdk_bdev_qos_group_create("group0", &opts);
+	CU_ASSERT(rc == -EEXIST);
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	group = bdev_qos_group_find("group0");
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+	SPDK_CU_ASSERT_FATAL(group != NULL);
+	CU_ASSERT(group->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].alloc_per_timeslice == 2);
+
+	g_get_io_channel = true;
+	io_ch = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch = spdk_io_channel_get_ctx(io_ch);
+	CU_ASSERT(bdev_ch->flags == 0);
+
+	/* Adding the bdev enables QoS, even though the bdev doesn't have any limits itself */
+	bdev = &g_bdev.bdev;
+	cb_rc = -1;
+	spdk_bdev_qos_group_add_bdev("group0", bdev, qos_group_status_cb, &cb_rc);
+	poll_threads();
+	CU_ASSERT(cb_rc == 0);
+	CU_ASSERT(bdev_ch->flags == BDEV_CH_QOS_ENABLED);
+	SPDK_CU_ASSERT_FATAL(bdev->internal.qos != NULL);
+	CU_ASSERT(bdev->internal.qos->group == group);
+	CU_ASSERT(group->num_bdevs == 1);
+
+	cb_rc = -1;
+	spdk_bdev_qos_group_add_bdev("group0", bdev, qos_group_status_cb, &cb_rc);
+	poll_threads();
+	CU_ASSERT(cb_rc == -EEXIST);
+	CU_ASSERT(group->num_bdevs == 1);
+
+	/* The group's quota only allows 2 of the 3 I/O in this timeslice */
+	for (i = 0; i < 3; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 2);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status[1] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(status[2] == SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT(group->num_ios == 2);
+
+	/* The queued I/O is submitted in the next timeslice */
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 0) == 1);
+	poll_threads();
+	CU_ASSERT(status[2] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(group->num_ios == 3);
+
+	/* Children share the limits of their parent in proportion to their weights */
+	spdk_bdev_qos_group_opts_init(&opts, sizeof(opts));
+	opts.limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT] = 4000;
+	rc = spdk_bdev_qos_group_create("parent", &opts);
+	CU_ASSERT(rc == 0);
+
+	spdk_bdev_qos_group_opts_init(&opts, sizeof(opts));
+	opts.parent = "parent";
+	opts.weight = 3;
+	rc = spdk_bdev_qos_group_create("child0", &opts);
+	CU_ASSERT(rc == 0);
+	opts.weight = 1;
+	rc = spdk_bdev_qos_group_create("child1", &opts);
+	CU_ASSERT(rc == 0);
+
+	/* Only two levels of groups are supported */
+	opts.parent = "child0";
+	rc = spdk_bdev_qos_group_create("grandchild", &opts);
+	CU_ASSERT(rc == -EINVAL);
+	opts.parent = "nonexistent";
+	rc = spdk_bdev_qos_group_create("grandchild", &opts);
+	CU_ASSERT(rc == -ENOENT);
+
+	spdk_spin_lock(&g_bdev_mgr.spinlock);
+	parent = bdev_qos_group_find("parent");
+	child[0] = bdev_qos_group_find("child0");
+	child[1] = bdev_qos_group_find("child1");
+	spdk_spin_unlock(&g_bdev_mgr.spinlock);
+	SPDK_CU_ASSERT_FATAL(parent != NULL && child[0] != NULL && child[1] != NULL);
+	CU_ASSERT(parent->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].alloc_per_timeslice == 4);
+	CU_ASSERT(child[0]->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].alloc_per_timeslice == 3);
+	CU_ASSERT(child[1]->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].alloc_per_timeslice == 1);
+
+	/* An active child gets the whole limit of the parent while its sibling is idle */
+	child[1]->num_ios++;
+	spdk_delay_us(SPDK_BDEV_QOS_TIMESLICE_IN_USEC);
+	poll_threads();
+	CU_ASSERT(child[0]->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].alloc_per_timeslice == 3);
+	CU_ASSERT(child[1]->rate_limits[SPDK_BDEV_QOS_RW_IOPS_RATE_LIMIT].alloc_per_timeslice == 4);
+
+	rc = spdk_bdev_qos_group_delete("parent");
+	CU_ASSERT(rc == -EBUSY);
+	rc = spdk_bdev_qos_group_delete("group0");
+	CU_ASSERT(rc == -EBUSY);
+
+	/* Removing the bdev disables QoS, as the bdev doesn't have any limits itself */
+	cb_rc = -1;
+	spdk_bdev_qos_group_remove_bdev(bdev, qos_group_status_cb, &cb_rc);
+	poll_threads();
+	CU_ASSERT(cb_rc == 0);
+	CU_ASSERT(bdev->internal.qos == NULL);
+	CU_ASSERT(bdev_ch->flags == 0);
+	CU_ASSERT(group->num_bdevs == 0);
+
+	CU_ASSERT(spdk_bdev_qos_group_delete("group0") == 0);
+	CU_ASSERT(spdk_bdev_qos_group_delete("child0") == 0);
+	CU_ASSERT(spdk_bdev_qos_group_delete("child1") == 0);
+	CU_ASSERT(spdk_bdev_qos_group_delete("parent") == 0);
+	CU_ASSERT(spdk_bdev_qos_group_delete("parent") == -ENOENT);
+
+	spdk_put_io_channel(io_ch);
+	poll_threads();
+
+	teardown_test();
+}
+
+static void
+io_during_latency_slo(void)
+{
+	struct spdk_io_channel *io_ch;
+	struct spdk_bdev_channel *bdev_ch;
+	struct spdk_bdev *bdev;
+	enum spdk_bdev_io_status status[10];
+	uint32_t limit;
+	int i, rc, cb_rc;
+
+	setup_test();
+	MOCK_CLEAR(spdk_get_ticks);
+	set_thread(0);
+
+	g_get_io_channel = true;
+	io_ch = spdk_bdev_get_io_channel(g_desc);
+	bdev_ch = spdk_io_channel_get_ctx(io_ch);
+	CU_ASSERT(bdev_ch->latency_slo == NULL);
+
+	/* Target a p99 latency of 100us with at most 8 I/O outstanding */
+	bdev = &g_bdev.bdev;
+	cb_rc = -1;
+	spdk_bdev_set_latency_slo(bdev, 100, 8, qos_group_status_cb, &cb_rc);
+	poll_threads();
+	CU_ASSERT(cb_rc == 0);
+	CU_ASSERT(spdk_bdev_get_latency_slo(bdev) == 100);
+	SPDK_CU_ASSERT_FATAL(bdev_ch->latency_slo != NULL);
+	CU_ASSERT(bdev_ch->latency_slo->queue_depth_limit == 8);
+
+	/* The I/O over the queue depth limit are held back by the bdev layer */
+	for (i = 0; i < 10; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(bdev_ch->io_outstanding == 8);
+	CU_ASSERT(bdev_ch->latency_slo->num_throttled == 2);
+	/* They are held on the channel, not on the nomem queue shared with other channels */
+	CU_ASSERT(!TAILQ_EMPTY(&bdev_ch->latency_slo_queued_io));
+	CU_ASSERT(TAILQ_EMPTY(&bdev_ch->shared_resource->nomem_io));
+	CU_ASSERT(bdev_ch->shared_resource->nomem_threshold == 0);
+
+	/* Completing one I/O lets exactly one of the held back I/O through */
+	CU_ASSERT(stub_complete_io(g_bdev.io_target, 1) == 1);
+	poll_threads();
+	CU_ASSERT(status[0] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(bdev_ch->io_outstanding == 8);
+	CU_ASSERT(status[9] == SPDK_BDEV_IO_STATUS_PENDING);
+
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	CU_ASSERT(bdev_ch->io_outstanding == 0);
+	CU_ASSERT(status[9] == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* A latency of 400us misses the target, so the limit is halved at the end of the window */
+	limit = bdev_ch->latency_slo->queue_depth_limit;
+	while (bdev_ch->latency_slo->queue_depth_limit == limit) {
+		for (i = 0; i < 8; i++) {
+			rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done,
+						   &status[i]);
+			CU_ASSERT(rc == 0);
+		}
+		spdk_delay_us(400);
+		stub_complete_io(g_bdev.io_target, 0);
+		poll_threads();
+	}
+	CU_ASSERT(bdev_ch->latency_slo->queue_depth_limit == 4);
+	CU_ASSERT(bdev_ch->latency_slo->p99_ticks == 400);
+
+	/* A latency of 10us meets the target, so the limit grows while it is fully used */
+	limit = bdev_ch->latency_slo->queue_depth_limit;
+	while (bdev_ch->latency_slo->queue_depth_limit == limit) {
+		for (i = 0; i < (int)limit; i++) {
+			rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done,
+						   &status[i]);
+			CU_ASSERT(rc == 0);
+		}
+		spdk_delay_us(10);
+		stub_complete_io(g_bdev.io_target, 0);
+		poll_threads();
+	}
+	CU_ASSERT(bdev_ch->latency_slo->queue_depth_limit == 7);
+	CU_ASSERT(bdev_ch->latency_slo->p99_ticks == 12);
+
+	for (i = 0; i < 9; i++) {
+		status[i] = SPDK_BDEV_IO_STATUS_PENDING;
+		rc = spdk_bdev_read_blocks(g_desc, io_ch, NULL, 0, 1, io_during_io_done, &status[i]);
+		CU_ASSERT(rc == 0);
+	}
+	poll_threads();
+	CU_ASSERT(bdev_ch->io_outstanding == 7);
+
+	/* Removing the target frees the SLO state of the channels and submits the I/O that
+	 * were held back.
+	 */
+	cb_rc = -1;
+	spdk_bdev_set_latency_slo(bdev, 0, 0, qos_group_status_cb, &cb_rc);
+	poll_threads();
+	CU_ASSERT(cb_rc == 0);
+	CU_ASSERT(spdk_bdev_get_latency_slo(bdev) == 0);
+	CU_ASSERT(bdev_ch->latency_slo == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&bdev_ch->latency_slo_queued_io));
+	CU_ASSERT(bdev_ch->io_outstanding == 9);
+
+	stub_complete_io(g_bdev.io_target, 0);
+	poll_threads();
+	for (i = 0; i < 9; i++) {
+		CU_ASSERT(status[i] == SPDK_BDEV_IO_STATUS_SUCCESS);
+	}
+
+	spdk_put_io_channel(io_ch);
+	poll_threads();
+
+	teardown_test();
+}
+
 static void
 io_during_qos_reset(void)
 {
@@ -2870,6 +3265,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, io_during_reset);
 	CU_ADD_TEST(suite, reset_completions);
 	CU_ADD_TEST(suite, io_during_qos_queue);
+	CU_ADD_TEST(suite, io_during_qos_quota_grant);
+	CU_ADD_TEST(suite, io_during_qos_group);
+	CU_ADD_TEST(suite, io_during_latency_slo);
 	CU_ADD_TEST(suite, io_during_qos_reset);
 	CU_ADD_TEST(suite, enomem);
 	CU_ADD_TEST(suite, enomem_multi_bdev);
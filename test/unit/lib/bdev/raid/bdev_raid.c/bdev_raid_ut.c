@@ -58,6 +58,8 @@ uint8_t g_test_multi_raids;
 uint64_t g_bdev_ch_io_device;
 bool g_bdev_io_defer_completion;
 TAILQ_HEAD(, spdk_bdev_io) g_deferred_ios = TAILQ_HEAD_INITIALIZER(g_deferred_ios);
+uint8_t g_wib_disk[4 * 4096];
+uint32_t g_wib_writes;
 struct spdk_thread *g_app_thread;
 struct spdk_thread *g_latest_thread;
 
@@ -138,6 +140,7 @@ static struct raid_bdev_module g_ut_raid_module = {
 	.submit_rw_request = ut_raid_submit_rw_request,
 	.submit_null_payload_request = ut_raid_submit_null_payload_request,
 	.submit_process_request = ut_raid_submit_process_request,
+	.resync_supported = true,
 };
 RAID_MODULE_REGISTER(&g_ut_raid_module)
 
@@ -227,6 +230,25 @@ raid_bdev_clear_superblock(struct raid_bdev *raid_bdev, raid_bdev_write_sb_cb cb
 	cb(0, raid_bdev, cb_ctx);
 }
 
+void
+raid_bdev_write_wib(struct raid_bdev *raid_bdev, void *buf, uint32_t buf_size,
+		    raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	SPDK_CU_ASSERT_FATAL(buf_size <= sizeof(g_wib_disk));
+	memcpy(g_wib_disk, buf, buf_size);
+	g_wib_writes++;
+	cb(0, raid_bdev, cb_ctx);
+}
+
+void
+raid_bdev_load_wib(struct raid_bdev *raid_bdev, void *buf, uint32_t buf_size,
+		   raid_bdev_write_sb_cb cb, void *cb_ctx)
+{
+	SPDK_CU_ASSERT_FATAL(buf_size <= sizeof(g_wib_disk));
+	memcpy(buf, g_wib_disk, buf_size);
+	cb(0, raid_bdev, cb_ctx);
+}
+
 const struct spdk_uuid *
 spdk_bdev_get_uuid(const struct spdk_bdev *bdev)
 {
@@ -1455,6 +1477,7 @@ test_raid_process_with_qos(void)
 	pbdev->module_private = &num_blocks_processed;
 	pbdev->min_base_bdevs_operational = 0;
 
+	raid_bdev_get_opts(&opts);
 	opts.process_window_size_kb = 1024;
 	opts.process_max_bandwidth_mb_sec = 1;
 	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
@@ -1492,6 +1515,162 @@ test_raid_process_with_qos(void)
 	reset_globals();
 }
 
+static bool
+wib_disk_region_marked(uint32_t region)
+{
+	return g_wib_disk[region / 8] & (1 << (region % 8));
+}
+
+static void
+test_raid_write_intent_bitmap(void)
+{
+	struct rpc_bdev_raid_create_ctx req;
+	struct rpc_bdev_raid_delete_ctx destroy_req;
+	struct raid_bdev *pbdev;
+	struct spdk_bdev *base_bdev;
+	struct spdk_io_channel *ch;
+	struct raid_bdev_io_channel *raid_ch;
+	struct spdk_bdev_io *bdev_io, *bdev_io2;
+	struct spdk_thread *process_thread;
+	struct spdk_raid_bdev_opts opts;
+	uint64_t num_blocks_processed = 0;
+	uint64_t region_blocks;
+	uint32_t wib_writes, i;
+
+	set_globals();
+	CU_ASSERT(raid_bdev_init() == 0);
+
+	MOCK_SET(spdk_bdev_get_md_size, 0);
+	MOCK_SET(spdk_bdev_is_md_separate, false);
+	raid_bdev_get_opts(&opts);
+	opts.process_max_bandwidth_mb_sec = 0;
+	opts.write_intent_bitmap = true;
+	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
+	memset(g_wib_disk, 0xff, sizeof(g_wib_disk));
+
+	/* 8 regions of the minimum size */
+	region_blocks = RAID_BDEV_WIB_MIN_REGION_SIZE / g_block_len;
+	create_raid_bdev_create_req(&req, "raid1", 0, true, 0, true);
+	TAILQ_FOREACH(base_bdev, &g_bdev_list, internal.link) {
+		base_bdev->blockcnt = RAID_BDEV_MIN_DATA_OFFSET_SIZE / g_block_len + 8 * region_blocks;
+	}
+	rpc_bdev_raid_create(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	free_test_req(&req);
+
+	TAILQ_FOREACH(pbdev, &g_raid_bdev_list, global_link) {
+		if (strcmp(pbdev->bdev.name, "raid1") == 0) {
+			break;
+		}
+	}
+	SPDK_CU_ASSERT_FATAL(pbdev != NULL);
+	CU_ASSERT(pbdev->state == SPDK_BDEV_RAID_STATE_ONLINE);
+	SPDK_CU_ASSERT_FATAL(pbdev->wib != NULL);
+	CU_ASSERT(pbdev->wib->num_regions == 8);
+	CU_ASSERT(1ULL << pbdev->wib->region_shift == region_blocks);
+	CU_ASSERT(pbdev->wib->resync_needed == false);
+	/* a clean bitmap is written when the raid bdev is created */
+	CU_ASSERT(spdk_mem_all_zero(g_wib_disk, pbdev->wib->buf_size));
+
+	ch = spdk_get_io_channel(pbdev);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	raid_ch = spdk_io_channel_get_ctx(ch);
+	g_bdev_io_defer_completion = true;
+
+	/* the first write to a region is submitted after the region is marked on disk */
+	bdev_io = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct raid_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	_bdev_io_initialize(bdev_io, ch, &pbdev->bdev, region_blocks + 8, 8, SPDK_BDEV_IO_TYPE_WRITE,
+			    1, 8 * g_block_len);
+	raid_bdev_submit_request(ch, bdev_io);
+	CU_ASSERT(TAILQ_EMPTY(&g_deferred_ios));
+	CU_ASSERT(!wib_disk_region_marked(1));
+
+	poll_app_thread();
+	CU_ASSERT(TAILQ_FIRST(&g_deferred_ios) == bdev_io);
+	CU_ASSERT(wib_disk_region_marked(1));
+	CU_ASSERT(spdk_bit_array_get(raid_ch->wib.dirty, 1));
+
+	/* next writes to the region are submitted right away */
+	wib_writes = g_wib_writes;
+	bdev_io2 = calloc(1, sizeof(struct spdk_bdev_io) + sizeof(struct raid_bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io2 != NULL);
+	_bdev_io_initialize(bdev_io2, ch, &pbdev->bdev, region_blocks, 8, SPDK_BDEV_IO_TYPE_WRITE,
+			    1, 8 * g_block_len);
+	raid_bdev_submit_request(ch, bdev_io2);
+	CU_ASSERT(TAILQ_NEXT(bdev_io, internal.link) == bdev_io2);
+	poll_app_thread();
+	CU_ASSERT(g_wib_writes == wib_writes);
+
+	/* a region with outstanding writes is not cleared */
+	raid_bdev_wib_sweep(pbdev);
+	poll_app_thread();
+	CU_ASSERT(wib_disk_region_marked(1));
+	CU_ASSERT(spdk_bit_array_get(raid_ch->wib.dirty, 1));
+
+	/* an idle region is cleared */
+	complete_deferred_ios();
+	CU_ASSERT(raid_ch->wib.writes_outstanding[1] == 0);
+	raid_bdev_wib_sweep(pbdev);
+	poll_app_thread();
+	CU_ASSERT(!wib_disk_region_marked(1));
+	CU_ASSERT(!spdk_bit_array_get(raid_ch->wib.dirty, 1));
+	CU_ASSERT(spdk_bit_array_count_set(pbdev->wib->regions) == 0);
+
+	bdev_io_cleanup(bdev_io);
+	bdev_io_cleanup(bdev_io2);
+	g_bdev_io_defer_completion = false;
+	spdk_put_io_channel(ch);
+	poll_app_thread();
+
+	/* resync processes only the marked regions */
+	spdk_bit_array_set(pbdev->wib->regions, 2);
+	spdk_bit_array_set(pbdev->wib->regions, 5);
+	pbdev->wib->resync_needed = true;
+	pbdev->module_private = &num_blocks_processed;
+
+	CU_ASSERT(raid_bdev_start_resync(pbdev) == 0);
+	poll_app_thread();
+
+	SPDK_CU_ASSERT_FATAL(pbdev->process != NULL);
+	CU_ASSERT(pbdev->process->target == NULL);
+
+	process_thread = g_latest_thread;
+	spdk_thread_poll(process_thread, 0, 0);
+	SPDK_CU_ASSERT_FATAL(pbdev->process->thread == process_thread);
+
+	while (spdk_thread_poll(process_thread, 0, 0) > 0) {
+		poll_app_thread();
+	}
+
+	CU_ASSERT(pbdev->process == NULL);
+	CU_ASSERT(num_blocks_processed == 2 * region_blocks);
+	CU_ASSERT(pbdev->wib->resync_needed == false);
+
+	poll_app_thread();
+
+	/* the bitmap is cleared when the raid bdev is stopped */
+	raid_bdev_wib_write(pbdev);
+	CU_ASSERT(wib_disk_region_marked(2));
+	CU_ASSERT(wib_disk_region_marked(5));
+	create_raid_bdev_delete_req(&destroy_req, "raid1", 0);
+	rpc_bdev_raid_delete(NULL, NULL);
+	CU_ASSERT(g_rpc_err == 0);
+	verify_raid_bdev_present("raid1", false);
+	for (i = 0; i < 8; i++) {
+		CU_ASSERT(!wib_disk_region_marked(i));
+	}
+
+	opts.write_intent_bitmap = false;
+	CU_ASSERT(raid_bdev_set_opts(&opts) == 0);
+	MOCK_CLEAR(spdk_bdev_get_md_size);
+	MOCK_CLEAR(spdk_bdev_is_md_separate);
+
+	raid_bdev_exit();
+	base_bdevs_cleanup();
+	reset_globals();
+}
+
 static void
 test_raid_io_split(void)
 {
@@ -1825,6 +2004,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid_io_split);
 	CU_ADD_TEST(suite, test_raid_process);
 	CU_ADD_TEST(suite, test_raid_process_with_qos);
+	CU_ADD_TEST(suite, test_raid_write_intent_bitmap);
 
 	spdk_thread_lib_init(test_new_thread_fn, 0);
 	g_app_thread = spdk_thread_create("app_thread", NULL);
@@ -57,6 +57,7 @@ DEFINE_STUB(spdk_bdev_flush_blocks, int, (struct spdk_bdev_desc *desc, struct sp
 		void *cb_arg), 0);
 DEFINE_STUB(spdk_bdev_is_dif_head_of_md, bool, (const struct spdk_bdev *bdev), false);
 DEFINE_STUB(spdk_bdev_notify_blockcnt_change, int, (struct spdk_bdev *bdev, uint64_t size), 0);
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "test_bdev");
 
 bool
 spdk_bdev_is_md_interleaved(const struct spdk_bdev *bdev)
@@ -408,6 +409,99 @@ spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *
 	return 0;
 }
 
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks,
+		      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct io_output *output = &g_io_output[g_io_output_index];
+	struct spdk_bdev_io *child_io;
+
+	set_io_output(output, desc, ch, offset_blocks, num_blocks, cb, cb_arg,
+		      SPDK_BDEV_IO_TYPE_READ, NULL, 0, NULL);
+	g_io_output_index++;
+
+	child_io = get_child_io(output);
+	cb(child_io, g_child_io_status_flag, cb_arg);
+
+	return 0;
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct io_output *output = &g_io_output[g_io_output_index];
+	struct spdk_bdev_io *child_io;
+
+	set_io_output(output, desc, ch, offset_blocks, num_blocks, cb, cb_arg,
+		      SPDK_BDEV_IO_TYPE_WRITE, NULL, 0, NULL);
+	g_io_output_index++;
+
+	child_io = get_child_io(output);
+	cb(child_io, g_child_io_status_flag, cb_arg);
+
+	return 0;
+}
+
+char g_zcopy_buf[4096];
+bool g_zcopy_commit;
+
+int
+spdk_bdev_zcopy_start(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		      struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		      bool populate, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct io_output *output = &g_io_output[g_io_output_index];
+	struct spdk_bdev_io *child_io;
+
+	set_io_output(output, desc, ch, offset_blocks, num_blocks, cb, cb_arg,
+		      SPDK_BDEV_IO_TYPE_ZCOPY, NULL, 0, NULL);
+	g_io_output_index++;
+
+	child_io = get_child_io(output);
+	child_io->u.bdev.iovs = &child_io->iov;
+	child_io->u.bdev.iovcnt = 1;
+	child_io->iov.iov_base = g_zcopy_buf;
+	child_io->iov.iov_len = sizeof(g_zcopy_buf);
+	cb(child_io, g_child_io_status_flag, cb_arg);
+
+	return 0;
+}
+
+int
+spdk_bdev_zcopy_end(struct spdk_bdev_io *bdev_io, bool commit,
+		    spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	g_zcopy_commit = commit;
+	cb(bdev_io, g_child_io_status_flag, cb_arg);
+
+	return 0;
+}
+
+void
+spdk_bdev_io_set_buf(struct spdk_bdev_io *bdev_io, void *buf, size_t len)
+{
+	if (bdev_io->u.bdev.iovs == NULL) {
+		bdev_io->u.bdev.iovs = &bdev_io->iov;
+		bdev_io->u.bdev.iovcnt = 1;
+	}
+
+	bdev_io->u.bdev.iovs[0].iov_base = buf;
+	bdev_io->u.bdev.iovs[0].iov_len = len;
+}
+
+void
+spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
+{
+	void *buf = calloc(1, len);
+
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	spdk_bdev_io_set_buf(bdev_io, buf, len);
+	cb(NULL, bdev_io, true);
+}
+
 static void
 raid_io_cleanup(struct raid_bdev_io *raid_io)
 {
@@ -877,6 +971,144 @@ test_io_failure(void)
 	reset_globals();
 }
 
+static struct raid_bdev_io *
+zcopy_io_initialize(struct raid_bdev_io_channel *raid_ch, struct raid_bdev *raid_bdev,
+		    uint64_t lba, uint64_t blocks, bool populate)
+{
+	struct spdk_bdev_io *bdev_io;
+	struct raid_bdev_io *raid_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(*raid_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &raid_bdev->bdev;
+	bdev_io->type = SPDK_BDEV_IO_TYPE_ZCOPY;
+	bdev_io->u.bdev.offset_blocks = lba;
+	bdev_io->u.bdev.num_blocks = blocks;
+	bdev_io->u.bdev.zcopy.start = 1;
+	bdev_io->u.bdev.zcopy.populate = populate;
+
+	raid_io = (struct raid_bdev_io *)bdev_io->driver_ctx;
+	raid_test_bdev_io_init(raid_io, raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_ZCOPY, lba, blocks,
+			       NULL, 0, NULL);
+
+	memset(g_io_output, 0, ((g_max_io_size / g_strip_size) + 1) * sizeof(struct io_output));
+	g_io_output_index = 0;
+	g_io_comp_status = false;
+
+	return raid_io;
+}
+
+static void
+zcopy_io_end(struct raid_bdev_io *raid_io, bool commit)
+{
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	void *base_io = raid_io->module_private;
+
+	/* The raid bdev_io is initialized again when it is resubmitted, except for module_private */
+	bdev_io->u.bdev.zcopy.start = 0;
+	bdev_io->u.bdev.zcopy.commit = commit;
+	raid_test_bdev_io_init(raid_io, raid_io->raid_bdev, raid_io->raid_ch, SPDK_BDEV_IO_TYPE_ZCOPY,
+			       bdev_io->u.bdev.offset_blocks, bdev_io->u.bdev.num_blocks,
+			       bdev_io->u.bdev.iovs, bdev_io->u.bdev.iovcnt, NULL);
+	raid_io->module_private = base_io;
+
+	memset(g_io_output, 0, ((g_max_io_size / g_strip_size) + 1) * sizeof(struct io_output));
+	g_io_output_index = 0;
+	g_io_comp_status = false;
+
+	raid0_submit_zcopy_request(raid_io);
+}
+
+static void
+test_zcopy_io(void)
+{
+	struct raid_bdev *raid_bdev;
+	struct raid_bdev_io *raid_io;
+	struct raid_bdev_io_channel *raid_ch;
+	struct spdk_bdev_io *bdev_io;
+	uint64_t lba;
+
+	/* Zero-copy is not supported with DIF */
+	if (g_enable_dif) {
+		return;
+	}
+
+	set_globals();
+
+	raid_bdev = create_raid0();
+	raid_ch = raid_test_create_io_channel(raid_bdev);
+
+	/* I/O within the second strip is passed through to the second base bdev */
+	lba = g_strip_size + g_strip_size / 4;
+	raid_io = zcopy_io_initialize(raid_ch, raid_bdev, lba, g_strip_size / 2, true);
+	bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	raid0_submit_zcopy_request(raid_io);
+	CU_ASSERT(g_io_comp_status == true);
+	CU_ASSERT(g_io_output_index == 1);
+	CU_ASSERT(g_io_output[0].iotype == SPDK_BDEV_IO_TYPE_ZCOPY);
+	CU_ASSERT(g_io_output[0].desc == raid_bdev->base_bdev_info[1].desc);
+	CU_ASSERT(g_io_output[0].offset_blocks == g_strip_size / 4);
+	CU_ASSERT(g_io_output[0].num_blocks == g_strip_size / 2);
+	CU_ASSERT(bdev_io->u.bdev.iovcnt == 1);
+	CU_ASSERT(bdev_io->u.bdev.iovs[0].iov_base == g_zcopy_buf);
+	SPDK_CU_ASSERT_FATAL(raid_io->module_private != NULL);
+
+	g_zcopy_commit = false;
+	zcopy_io_end(raid_io, true);
+	CU_ASSERT(g_io_comp_status == true);
+	CU_ASSERT(g_io_output_index == 0);
+	CU_ASSERT(g_zcopy_commit == true);
+	free(bdev_io);
+
+	/* I/O spanning two strips is read into a buffer when it starts */
+	lba = g_strip_size * 3 - 8;
+	raid_io = zcopy_io_initialize(raid_ch, raid_bdev, lba, 16, true);
+	bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	raid0_submit_zcopy_request(raid_io);
+	CU_ASSERT(g_io_comp_status == true);
+	CU_ASSERT(g_io_output_index == 2);
+	CU_ASSERT(g_io_output[0].iotype == SPDK_BDEV_IO_TYPE_READ);
+	CU_ASSERT(g_io_output[0].desc == raid_bdev->base_bdev_info[2].desc);
+	CU_ASSERT(g_io_output[0].offset_blocks == g_strip_size - 8);
+	CU_ASSERT(g_io_output[0].num_blocks == 8);
+	CU_ASSERT(g_io_output[1].iotype == SPDK_BDEV_IO_TYPE_READ);
+	CU_ASSERT(g_io_output[1].desc == raid_bdev->base_bdev_info[3].desc);
+	CU_ASSERT(g_io_output[1].offset_blocks == 0);
+	CU_ASSERT(g_io_output[1].num_blocks == 8);
+	CU_ASSERT(raid_io->module_private == NULL);
+
+	/* Nothing is written back at the end of a read */
+	zcopy_io_end(raid_io, false);
+	CU_ASSERT(g_io_comp_status == true);
+	CU_ASSERT(g_io_output_index == 0);
+	free(bdev_io->u.bdev.iovs[0].iov_base);
+	free(bdev_io);
+
+	/* ... and written from the buffer when a write is committed */
+	raid_io = zcopy_io_initialize(raid_ch, raid_bdev, lba, 16, false);
+	bdev_io = spdk_bdev_io_from_ctx(raid_io);
+	raid0_submit_zcopy_request(raid_io);
+	CU_ASSERT(g_io_comp_status == true);
+	CU_ASSERT(g_io_output_index == 0);
+
+	zcopy_io_end(raid_io, true);
+	CU_ASSERT(g_io_comp_status == true);
+	CU_ASSERT(g_io_output_index == 2);
+	CU_ASSERT(g_io_output[0].iotype == SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_io_output[0].desc == raid_bdev->base_bdev_info[2].desc);
+	CU_ASSERT(g_io_output[0].offset_blocks == g_strip_size - 8);
+	CU_ASSERT(g_io_output[1].iotype == SPDK_BDEV_IO_TYPE_WRITE);
+	CU_ASSERT(g_io_output[1].desc == raid_bdev->base_bdev_info[3].desc);
+	CU_ASSERT(g_io_output[1].offset_blocks == 0);
+	free(bdev_io->u.bdev.iovs[0].iov_base);
+	free(bdev_io);
+
+	raid_test_destroy_io_channel(raid_ch);
+	delete_raid0(raid_bdev);
+
+	reset_globals();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -887,6 +1119,7 @@ main(int argc, char **argv)
 		{ "test_read_io", test_read_io },
 		{ "test_unmap_io", test_unmap_io },
 		{ "test_io_failure", test_io_failure },
+		{ "test_zcopy_io", test_zcopy_io },
 		CU_TEST_INFO_NULL,
 	};
 	CU_SuiteInfo suites[] = {
@@ -38,6 +38,19 @@ DEFINE_STUB(spdk_bdev_unmap_blocks, int, (struct spdk_bdev_desc *desc, struct sp
 		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
 		void *cb_arg), 0);
 
+void
+raid_bdev_get_opts(struct spdk_raid_bdev_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->raid1_read_policy = SPDK_BDEV_RAID1_READ_POLICY_QUEUE_DEPTH;
+}
+
+uint64_t
+spdk_bdev_io_get_submit_tsc(struct spdk_bdev_io *bdev_io)
+{
+	return bdev_io->internal.submit_tsc;
+}
+
 int
 spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc,
 			   struct spdk_io_channel *ch,
@@ -223,8 +236,8 @@ _test_raid1_read_balancing(struct raid_bdev *raid_bdev, struct raid_bdev_io_chan
 	}
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
-		CU_ASSERT(raid1_ch->read_blocks_outstanding[i] == n * small_io_blocks);
-		raid1_ch->read_blocks_outstanding[i] = 0;
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == n * small_io_blocks);
+		raid1_ch->base[i].read_blocks_outstanding = 0;
 	}
 
 	/*
@@ -246,7 +259,7 @@ _test_raid1_read_balancing(struct raid_bdev *raid_bdev, struct raid_bdev_io_chan
 	}
 
 	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
-		CU_ASSERT(raid1_ch->read_blocks_outstanding[i] == big_io_blocks);
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == big_io_blocks);
 	}
 
 	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, small_io_blocks);
@@ -261,6 +274,164 @@ test_raid1_read_balancing(void)
 	run_for_each_raid1_config(_test_raid1_read_balancing);
 }
 
+static void
+read_and_complete(struct raid1_info *r1_info, struct raid_bdev_io_channel *raid_ch,
+		  uint64_t offset_blocks, uint64_t num_blocks, uint64_t latency_ticks, uint8_t *idx)
+{
+	struct raid_bdev_io *raid_io;
+	struct spdk_bdev_io bdev_io = {};
+
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, num_blocks);
+	raid_io->offset_blocks = offset_blocks;
+	bdev_io.internal.submit_tsc = spdk_get_ticks();
+	raid1_submit_read_request(raid_io);
+	*idx = raid_io->base_bdev_io_submitted;
+
+	spdk_delay_us(latency_ticks);
+	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
+	raid1_read_bdev_io_completion(&bdev_io, true, raid_io);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+_test_raid1_read_balancing_latency(struct raid_bdev *raid_bdev,
+				   struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid1_info *r1_info = raid_bdev->module_private;
+	struct raid1_io_channel *raid1_ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	const uint64_t io_blocks = 8;
+	const uint64_t fast_latency = 10;
+	const uint64_t slow_latency = 100;
+	struct raid_bdev_io *raid_io;
+	uint64_t latency, offset;
+	uint8_t idx, i;
+	int n;
+
+	r1_info->read_policy = SPDK_BDEV_RAID1_READ_POLICY_LATENCY;
+
+	/* before any latency is known, reads are spread by queue depth */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+		raid_io->offset_blocks = i * 2 * io_blocks;
+		raid1_submit_read_request(raid_io);
+		CU_ASSERT(raid_io->base_bdev_io_submitted == i);
+		put_raid_io(raid_io);
+	}
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == io_blocks);
+		raid1_ch->base[i].read_blocks_outstanding = 0;
+	}
+
+	/* the first completion sets the latency, following ones are averaged */
+	raid1_ch->last_read_idx = UINT8_MAX;
+	read_and_complete(r1_info, raid_ch, 0, io_blocks, 80, &idx);
+	CU_ASSERT(idx == 0);
+	CU_ASSERT(raid1_ch->base[0].read_latency_ticks == 80);
+	CU_ASSERT(raid1_ch->base[0].read_blocks_outstanding == 0);
+	raid1_ch->last_read_idx = UINT8_MAX;
+	raid1_ch->base[0].read_latency_ticks = 80;
+	raid1_ch->base[0].read_blocks_outstanding = 1000;
+	read_and_complete(r1_info, raid_ch, 0, io_blocks, 0, &idx);
+	CU_ASSERT(idx == 1);
+	raid1_ch->base[0].read_blocks_outstanding = 0;
+	raid1_channel_update_read_latency(raid_ch, 0, 160, spdk_get_ticks());
+	latency = 80 + (80 >> RAID1_READ_LATENCY_EWMA_SHIFT);
+	CU_ASSERT(raid1_ch->base[0].read_latency_ticks == latency);
+	raid1_channel_update_read_latency(raid_ch, 0, 0, spdk_get_ticks());
+	CU_ASSERT(raid1_ch->base[0].read_latency_ticks < 90);
+
+	/* base bdev #0 is slow, the rest are fast */
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_latency_ticks = i == 0 ? slow_latency : fast_latency;
+		raid1_ch->base[i].read_latency_tsc = spdk_get_ticks();
+		raid1_ch->base[i].read_blocks_outstanding = 0;
+	}
+
+	/* random reads without queueing avoid the slow base bdev */
+	offset = 0;
+	for (n = 0; n < 16; n++) {
+		offset += 4 * io_blocks;
+		idx = raid1_channel_next_read_base_bdev_latency(&(struct raid_bdev_io) {
+			.raid_bdev = raid_bdev, .raid_ch = raid_ch,
+			.offset_blocks = offset, .num_blocks = io_blocks
+		});
+		CU_ASSERT(idx != 0);
+	}
+
+	/* and get back to it once its estimate decays without completions on it */
+	spdk_delay_us(RAID1_READ_LATENCY_DECAY_US * 4);
+	for (i = 1; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_latency_tsc = spdk_get_ticks();
+	}
+	raid1_ch->last_read_idx = UINT8_MAX;
+	read_and_complete(r1_info, raid_ch, 0, io_blocks, slow_latency, &idx);
+	CU_ASSERT(idx == 0);
+	CU_ASSERT(raid1_ch->base[0].read_latency_ticks > slow_latency >> 4);
+	CU_ASSERT(raid1_ch->base[0].read_latency_tsc == spdk_get_ticks());
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_latency_ticks = i == 0 ? slow_latency : fast_latency;
+		raid1_ch->base[i].read_latency_tsc = spdk_get_ticks();
+	}
+
+	/* but get to it once the fast ones have enough outstanding reads */
+	for (i = 1; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_blocks_outstanding = io_blocks * slow_latency / fast_latency;
+	}
+	raid1_ch->last_read_idx = UINT8_MAX;
+	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, io_blocks);
+	raid1_submit_read_request(raid_io);
+	CU_ASSERT(raid_io->base_bdev_io_submitted == 0);
+	put_raid_io(raid_io);
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		raid1_ch->base[i].read_blocks_outstanding = 0;
+	}
+
+	/* a sequential stream stays on its base bdev while it is not much slower than the best */
+	raid1_ch->base[0].read_latency_ticks = fast_latency;
+	raid1_ch->base[raid_bdev->num_base_bdevs - 1].read_latency_ticks = fast_latency;
+	offset = 1000 * io_blocks;
+	read_and_complete(r1_info, raid_ch, offset, io_blocks, fast_latency, &idx);
+	CU_ASSERT(idx == 0);
+	for (n = 0; n < 8; n++) {
+		offset += io_blocks;
+		raid1_ch->base[0].read_blocks_outstanding = io_blocks;
+		read_and_complete(r1_info, raid_ch, offset, io_blocks, fast_latency, &i);
+		CU_ASSERT(i == idx);
+		raid1_ch->base[0].read_blocks_outstanding = 0;
+	}
+
+	/* a non-sequential read is balanced again */
+	raid1_ch->base[0].read_blocks_outstanding = io_blocks;
+	read_and_complete(r1_info, raid_ch, offset + 2 * io_blocks, io_blocks, fast_latency, &idx);
+	CU_ASSERT(idx != 0);
+	raid1_ch->base[0].read_blocks_outstanding = 0;
+
+	/* the stream moves away when its base bdev gets too slow */
+	latency = fast_latency * RAID1_SEQ_READ_STICKY_FACTOR * 2;
+	raid1_ch->base[idx].read_latency_ticks = latency;
+	offset += 3 * io_blocks;
+	read_and_complete(r1_info, raid_ch, offset, io_blocks, latency, &i);
+	CU_ASSERT(i != idx);
+
+	/* or when it fails */
+	idx = i;
+	raid_ch->_base_channels[idx] = NULL;
+	offset += io_blocks;
+	read_and_complete(r1_info, raid_ch, offset, io_blocks, fast_latency, &i);
+	CU_ASSERT(i != idx);
+	raid_ch->_base_channels[idx] = (void *)1;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		CU_ASSERT(raid1_ch->base[i].read_blocks_outstanding == 0);
+	}
+}
+
+static void
+test_raid1_read_balancing_latency(void)
+{
+	run_for_each_raid1_config(_test_raid1_read_balancing_latency);
+}
+
 static void
 _test_raid1_write_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
 {
@@ -446,7 +617,7 @@ _test_raid1_read_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel
 	/* read from base bdev #1 fails, read from #0 succeeds */
 	base_info->is_failed = false;
 	base_info = &raid_bdev->base_bdev_info[1];
-	raid1_ch->read_blocks_outstanding[0] = 123;
+	raid1_ch->base[0].read_blocks_outstanding = 123;
 	g_io_status = SPDK_BDEV_IO_STATUS_PENDING;
 	raid_io = get_raid_io(r1_info, raid_ch, SPDK_BDEV_IO_TYPE_READ, 64);
 	raid1_submit_read_request(raid_io);
@@ -519,6 +690,7 @@ main(int argc, char **argv)
 	suite = CU_add_suite("raid1", test_setup, test_cleanup);
 	CU_ADD_TEST(suite, test_raid1_start);
 	CU_ADD_TEST(suite, test_raid1_read_balancing);
+	CU_ADD_TEST(suite, test_raid1_read_balancing_latency);
 	CU_ADD_TEST(suite, test_raid1_write_error);
 	CU_ADD_TEST(suite, test_raid1_read_error);
 
@@ -190,6 +190,8 @@ test_raid5f_start(void)
 		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
 		CU_ASSERT_TRUE(r5f_info->raid_bdev->bdev.split_on_optimal_io_boundary);
 		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.write_unit_size, r5f_info->stripe_blocks);
+		CU_ASSERT_EQUAL(r5f_info->raid_bdev->bdev.allow_partial_write_unit,
+				params->md_type != RAID_PARAMS_MD_SEPARATE);
 
 		delete_raid5f(r5f_info);
 	}
@@ -422,7 +424,18 @@ spdk_bdev_writev_blocks_with_md(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	r5f_info = io_info->r5f_info;
 	raid_bdev = r5f_info->raid_bdev;
 
-	if (chunk == stripe_req->parity_chunk) {
+	if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+		/* Partial stripe writes update the stripe contents in degraded_buf and parity_buf */
+		SPDK_CU_ASSERT_FATAL(md_buf == NULL);
+		if (chunk == stripe_req->parity_chunk) {
+			dest.iov_base = io_info->parity_buf;
+		} else {
+			data_chunk_idx = chunk < stripe_req->parity_chunk ? chunk->index : chunk->index - 1;
+			dest.iov_base = io_info->degraded_buf +
+					data_chunk_idx * raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+		}
+		dest.iov_base += (offset_blocks % raid_bdev->strip_size) * raid_bdev->bdev.blocklen;
+	} else if (chunk == stripe_req->parity_chunk) {
 		if (io_info->parity_buf == NULL) {
 			goto submit;
 		}
@@ -473,7 +486,11 @@ spdk_bdev_readv_blocks_degraded(struct spdk_bdev_desc *desc, struct spdk_io_chan
 	raid_bdev = io_info->r5f_info->raid_bdev;
 
 	if (chunk == stripe_req->parity_chunk) {
-		buf = io_info->reference_parity;
+		if (stripe_req->type == STRIPE_REQ_PARTIAL_WRITE) {
+			buf = io_info->parity_buf;
+		} else {
+			buf = io_info->reference_parity;
+		}
 	} else {
 		data_chunk_idx = chunk < stripe_req->parity_chunk ? chunk->index : chunk->index - 1;
 		buf = io_info->degraded_buf +
@@ -826,6 +843,92 @@ io_info_setup_degraded(struct raid_io_info *io_info)
 	}
 }
 
+static void
+io_info_setup_stripe(struct raid_io_info *io_info)
+{
+	struct raid5f_info *r5f_info = io_info->r5f_info;
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t block;
+
+	/* Initial stripe data, partial writes update it in place along with the parity */
+	io_info->degraded_buf = malloc(r5f_info->stripe_blocks * blocklen);
+	SPDK_CU_ASSERT_FATAL(io_info->degraded_buf != NULL);
+	for (block = 0; block < r5f_info->stripe_blocks; block++) {
+		memset(io_info->degraded_buf + block * blocklen, 0xa0 + block % 0x50, blocklen);
+	}
+
+	io_info_setup_parity(io_info, io_info->degraded_buf, NULL);
+	memcpy(io_info->parity_buf, io_info->reference_parity, io_info->parity_buf_size);
+}
+
+static void
+test_raid5f_partial_write_request(struct raid_io_info *io_info)
+{
+	struct raid5f_info *r5f_info = io_info->r5f_info;
+	struct raid_bdev *raid_bdev = r5f_info->raid_bdev;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	size_t strip_len = raid_bdev->strip_size * blocklen;
+	size_t stripe_len = r5f_info->stripe_blocks * blocklen;
+	uint8_t p_idx = raid5f_stripe_parity_chunk_index(raid_bdev, io_info->stripe_index);
+	struct raid_bdev_io *raid_io;
+	void *expected;
+	uint8_t i;
+	int n;
+
+	SPDK_CU_ASSERT_FATAL(io_info->stripe_offset_blocks + io_info->num_blocks <=
+			     r5f_info->stripe_blocks);
+
+	io_info_setup_stripe(io_info);
+
+	expected = malloc(stripe_len);
+	SPDK_CU_ASSERT_FATAL(expected != NULL);
+	memcpy(expected, io_info->degraded_buf, stripe_len);
+	memcpy(expected + io_info->stripe_offset_blocks * blocklen, io_info->src_buf, io_info->buf_size);
+
+	memset(io_info->reference_parity, 0, strip_len);
+	for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+		xor_block(io_info->reference_parity, expected + i * strip_len, strip_len);
+	}
+
+	raid_io = get_raid_io(io_info);
+
+	raid5f_submit_rw_request(raid_io);
+
+	/* reads, xor and writes, possibly repeated if the write is done in steps */
+	for (n = 0; n < 16 && io_info->status == SPDK_BDEV_IO_STATUS_PENDING; n++) {
+		poll_threads();
+		process_io_completions(io_info);
+	}
+
+	CU_ASSERT(io_info->status != SPDK_BDEV_IO_STATUS_PENDING);
+
+	if (io_info->status != SPDK_BDEV_IO_STATUS_SUCCESS) {
+		free(expected);
+		return;
+	}
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		if (!raid_bdev_channel_get_base_channel(io_info->raid_ch, i)) {
+			continue;
+		}
+
+		if (i == p_idx) {
+			CU_ASSERT(memcmp(io_info->parity_buf, io_info->reference_parity, strip_len) == 0);
+		} else {
+			uint8_t data_chunk_idx = i < p_idx ? i : i - 1;
+
+			CU_ASSERT(memcmp(io_info->degraded_buf + data_chunk_idx * strip_len,
+					 expected + data_chunk_idx * strip_len, strip_len) == 0);
+		}
+	}
+
+	/* the stripe contents were verified above, dest_buf is not used by partial writes */
+	memcpy(io_info->dest_buf, io_info->src_buf, io_info->buf_size);
+
+	free(expected);
+}
+
 static void
 test_raid5f_submit_rw_request(struct raid5f_info *r5f_info, struct raid_bdev_io_channel *raid_ch,
 			      enum spdk_bdev_io_type io_type, uint64_t stripe_index, uint64_t stripe_offset_blocks,
@@ -843,6 +946,10 @@ test_raid5f_submit_rw_request(struct raid5f_info *r5f_info, struct raid_bdev_io_
 		test_raid5f_read_request(&io_info);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
+		if (num_blocks < r5f_info->stripe_blocks) {
+			test_raid5f_partial_write_request(&io_info);
+			break;
+		}
 		io_info_setup_parity(&io_info, io_info.src_buf, io_info.src_md_buf);
 		test_raid5f_write_request(&io_info);
 		break;
@@ -1004,6 +1111,326 @@ test_raid5f_submit_full_stripe_write_request(void)
 	run_for_each_raid5f_config(__test_raid5f_submit_full_stripe_write_request);
 }
 
+static void
+__test_raid5f_submit_partial_stripe_write_request(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint64_t stripe_index;
+	struct {
+		uint64_t offset;
+		uint64_t num_blocks;
+	} reqs[] = {
+		/* part of a chunk */
+		{ 0, 1 },
+		{ strip_size / 2, strip_size / 4 },
+		{ r5f_info->stripe_blocks - 1, 1 },
+		/* whole chunk */
+		{ strip_size, strip_size },
+		/* spanning chunks */
+		{ strip_size - 1, 2 },
+		{ strip_size / 2, strip_size * 2 },
+		{ 1, r5f_info->stripe_blocks - 2 },
+		{ 0, r5f_info->stripe_blocks - 1 },
+	};
+	unsigned int i;
+
+	if (!raid_bdev->bdev.allow_partial_write_unit) {
+		return;
+	}
+
+	RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		for (i = 0; i < SPDK_COUNTOF(reqs); i++) {
+			if (reqs[i].num_blocks == 0 ||
+			    reqs[i].offset + reqs[i].num_blocks >= r5f_info->stripe_blocks) {
+				continue;
+			}
+
+			test_raid5f_submit_rw_request(r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+						      stripe_index, reqs[i].offset, reqs[i].num_blocks);
+		}
+	}
+}
+static void
+test_raid5f_submit_partial_stripe_write_request(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_submit_partial_stripe_write_request);
+}
+
+static void
+__test_raid5f_partial_stripe_write_error(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid_base_bdev_info *base_bdev_info;
+	uint64_t stripe_index;
+	struct raid_io_info io_info;
+	enum test_bdev_error_type error_type;
+
+	if (!raid_bdev->bdev.allow_partial_write_unit || r5f_info->stripe_blocks < 2) {
+		return;
+	}
+
+	for (error_type = TEST_BDEV_ERROR_SUBMIT; error_type <= TEST_BDEV_ERROR_NOMEM; error_type++) {
+		RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+			RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_bdev_info) {
+				/* writes to all the chunks */
+				init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+					     stripe_index, 0, r5f_info->stripe_blocks - 1);
+
+				io_info.error.type = error_type;
+				io_info.error.bdev = base_bdev_info->desc->bdev;
+
+				test_raid5f_partial_write_request(&io_info);
+
+				if (error_type == TEST_BDEV_ERROR_NOMEM) {
+					CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+				} else {
+					CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_FAILED);
+				}
+
+				deinit_io_info(&io_info);
+			}
+		}
+	}
+}
+static void
+test_raid5f_partial_stripe_write_error(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_partial_stripe_write_error);
+}
+
+static void
+__test_raid5f_partial_stripe_write_lock(struct raid_bdev *raid_bdev,
+					struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	size_t strip_len = raid_bdev->strip_size * raid_bdev->bdev.blocklen;
+	struct raid_io_info io_info[2];
+	struct raid_bdev_io *raid_io;
+	void *parity;
+	uint8_t i;
+	int n;
+
+	if (!raid_bdev->bdev.allow_partial_write_unit || r5f_info->stripe_blocks < 2) {
+		return;
+	}
+
+	init_io_info(&io_info[0], r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 0, 1);
+	init_io_info(&io_info[1], r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0,
+		     r5f_info->stripe_blocks - 1, 1);
+
+	/* both writes update the same stripe */
+	io_info_setup_stripe(&io_info[0]);
+	io_info[1].degraded_buf = io_info[0].degraded_buf;
+	io_info[1].parity_buf = io_info[0].parity_buf;
+
+	raid_io = get_raid_io(&io_info[0]);
+	raid5f_submit_rw_request(raid_io);
+	CU_ASSERT(!TAILQ_EMPTY(&io_info[0].bdev_io_queue));
+
+	/* the second write must wait for the first one to finish */
+	raid_io = get_raid_io(&io_info[1]);
+	raid5f_submit_rw_request(raid_io);
+	CU_ASSERT(TAILQ_EMPTY(&io_info[1].bdev_io_queue));
+
+	for (n = 0; n < 16 && io_info[0].status == SPDK_BDEV_IO_STATUS_PENDING; n++) {
+		CU_ASSERT(TAILQ_EMPTY(&io_info[1].bdev_io_queue));
+		poll_threads();
+		process_io_completions(&io_info[0]);
+	}
+	CU_ASSERT(io_info[0].status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	for (n = 0; n < 16 && io_info[1].status == SPDK_BDEV_IO_STATUS_PENDING; n++) {
+		poll_threads();
+		process_io_completions(&io_info[1]);
+	}
+	CU_ASSERT(io_info[1].status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	CU_ASSERT(memcmp(io_info[0].degraded_buf, io_info[0].src_buf, io_info[0].buf_size) == 0);
+	CU_ASSERT(memcmp(io_info[0].degraded_buf + io_info[1].stripe_offset_blocks *
+			 raid_bdev->bdev.blocklen, io_info[1].src_buf, io_info[1].buf_size) == 0);
+
+	parity = calloc(1, strip_len);
+	SPDK_CU_ASSERT_FATAL(parity != NULL);
+	for (i = 0; i < raid5f_stripe_data_chunks_num(raid_bdev); i++) {
+		xor_block(parity, io_info[0].degraded_buf + i * strip_len, strip_len);
+	}
+	CU_ASSERT(memcmp(io_info[0].parity_buf, parity, strip_len) == 0);
+	free(parity);
+
+	io_info[1].degraded_buf = NULL;
+	io_info[1].parity_buf = NULL;
+	deinit_io_info(&io_info[0]);
+	deinit_io_info(&io_info[1]);
+}
+static void
+test_raid5f_partial_stripe_write_lock(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_partial_stripe_write_lock);
+}
+
+static void
+__test_raid5f_stripe_cache_full_stripe(struct raid_bdev *raid_bdev,
+				       struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint64_t part_blocks = spdk_max(r5f_info->stripe_blocks / 3, 1);
+	uint64_t stripe_index;
+	struct raid_io_info io_info;
+	struct raid_bdev_io *raid_io;
+	uint64_t offset;
+	void *src_buf;
+
+	if (!raid_bdev->bdev.allow_partial_write_unit || r5f_info->stripe_blocks < 2) {
+		return;
+	}
+
+	RAID5F_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+			     stripe_index, 0, r5f_info->stripe_blocks);
+		io_info_setup_parity(&io_info, io_info.src_buf, NULL);
+		src_buf = io_info.src_buf;
+
+		/* continue a sequential stream, with another write in flight */
+		r5ch->stripe_cache.next_offset_blocks = io_info.offset_blocks;
+		r5ch->writes_outstanding++;
+
+		for (offset = 0; offset < r5f_info->stripe_blocks; offset += part_blocks) {
+			io_info.offset_blocks = stripe_index * r5f_info->stripe_blocks + offset;
+			io_info.num_blocks = spdk_min(part_blocks, r5f_info->stripe_blocks - offset);
+			io_info.src_buf = src_buf + offset * blocklen;
+
+			raid_io = get_raid_io(&io_info);
+			raid5f_submit_rw_request(raid_io);
+
+			poll_threads();
+
+			/* nothing is written until the stripe is full */
+			if (offset + io_info.num_blocks < r5f_info->stripe_blocks) {
+				CU_ASSERT(TAILQ_EMPTY(&io_info.bdev_io_queue));
+				CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_PENDING);
+			}
+		}
+		io_info.src_buf = src_buf;
+		CU_ASSERT(TAILQ_EMPTY(&r5ch->stripe_cache.stripes));
+		r5ch->writes_outstanding--;
+
+		process_io_completions(&io_info);
+
+		CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+		CU_ASSERT(memcmp(io_info.src_buf, io_info.dest_buf, io_info.buf_size) == 0);
+		CU_ASSERT(memcmp(io_info.parity_buf, io_info.reference_parity,
+				 io_info.parity_buf_size) == 0);
+
+		deinit_io_info(&io_info);
+	}
+}
+static void
+test_raid5f_stripe_cache_full_stripe(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_stripe_cache_full_stripe);
+}
+
+static void
+__test_raid5f_stripe_cache_flush_timeout(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid5f_info *r5f_info = raid_bdev->module_private;
+	struct raid5f_io_channel *r5ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	struct raid_io_info io_info;
+	struct raid_bdev_io *raid_io;
+	int n;
+
+	if (!raid_bdev->bdev.allow_partial_write_unit || r5f_info->stripe_blocks < 2) {
+		return;
+	}
+
+	init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 0,
+		     r5f_info->stripe_blocks - 1);
+	io_info_setup_stripe(&io_info);
+
+	r5ch->stripe_cache.next_offset_blocks = io_info.offset_blocks;
+	r5ch->writes_outstanding++;
+
+	raid_io = get_raid_io(&io_info);
+	raid5f_submit_rw_request(raid_io);
+
+	poll_threads();
+	CU_ASSERT(TAILQ_EMPTY(&io_info.bdev_io_queue));
+	CU_ASSERT(!TAILQ_EMPTY(&r5ch->stripe_cache.stripes));
+	r5ch->writes_outstanding--;
+
+	/* the stripe is not filled in time, the write is submitted as it is */
+	spdk_delay_us(RAID5F_STRIPE_CACHE_FLUSH_TIMEOUT_US);
+	for (n = 0; n < 16 && io_info.status == SPDK_BDEV_IO_STATUS_PENDING; n++) {
+		poll_threads();
+		process_io_completions(&io_info);
+	}
+
+	CU_ASSERT(TAILQ_EMPTY(&r5ch->stripe_cache.stripes));
+	CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(io_info.degraded_buf, io_info.src_buf, io_info.buf_size) == 0);
+
+	/* a write which doesn't continue a sequential stream is not held */
+	deinit_io_info(&io_info);
+	init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 0, 0, 1);
+	io_info_setup_stripe(&io_info);
+
+	raid_io = get_raid_io(&io_info);
+	raid5f_submit_rw_request(raid_io);
+
+	CU_ASSERT(TAILQ_EMPTY(&r5ch->stripe_cache.stripes));
+	CU_ASSERT(!TAILQ_EMPTY(&io_info.bdev_io_queue));
+
+	for (n = 0; n < 16 && io_info.status == SPDK_BDEV_IO_STATUS_PENDING; n++) {
+		poll_threads();
+		process_io_completions(&io_info);
+	}
+	CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(io_info.degraded_buf, io_info.src_buf, blocklen) == 0);
+
+	/* neither is a sequential write when no other write is in flight */
+	deinit_io_info(&io_info);
+	init_io_info(&io_info, r5f_info, raid_ch, SPDK_BDEV_IO_TYPE_WRITE, 1, 0, 1);
+	io_info_setup_stripe(&io_info);
+
+	r5ch->stripe_cache.next_offset_blocks = io_info.offset_blocks;
+	CU_ASSERT(r5ch->writes_outstanding == 0);
+
+	raid_io = get_raid_io(&io_info);
+	raid5f_submit_rw_request(raid_io);
+
+	CU_ASSERT(TAILQ_EMPTY(&r5ch->stripe_cache.stripes));
+	CU_ASSERT(!TAILQ_EMPTY(&io_info.bdev_io_queue));
+
+	for (n = 0; n < 16 && io_info.status == SPDK_BDEV_IO_STATUS_PENDING; n++) {
+		poll_threads();
+		process_io_completions(&io_info);
+	}
+	CU_ASSERT(io_info.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(io_info.degraded_buf, io_info.src_buf, blocklen) == 0);
+	CU_ASSERT(r5ch->writes_outstanding == 0);
+
+	deinit_io_info(&io_info);
+}
+static void
+test_raid5f_stripe_cache_flush_timeout(void)
+{
+	run_for_each_raid5f_config(__test_raid5f_stripe_cache_flush_timeout);
+}
+
+static void
+test_raid5f_submit_partial_stripe_write_request_degraded(void)
+{
+	g_test_degraded = true;
+	run_for_each_raid5f_config(__test_raid5f_submit_partial_stripe_write_request);
+}
+
 static void
 __test_raid5f_chunk_write_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
 {
@@ -1133,6 +1560,12 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_raid5f_chunk_write_error_with_enomem);
 	CU_ADD_TEST(suite, test_raid5f_submit_full_stripe_write_request_degraded);
 	CU_ADD_TEST(suite, test_raid5f_submit_read_request_degraded);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_stripe_write_request);
+	CU_ADD_TEST(suite, test_raid5f_partial_stripe_write_error);
+	CU_ADD_TEST(suite, test_raid5f_partial_stripe_write_lock);
+	CU_ADD_TEST(suite, test_raid5f_stripe_cache_full_stripe);
+	CU_ADD_TEST(suite, test_raid5f_stripe_cache_flush_timeout);
+	CU_ADD_TEST(suite, test_raid5f_submit_partial_stripe_write_request_degraded);
 
 	allocate_threads(1);
 	set_thread(0);
@@ -0,0 +1,991 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk_internal/cunit.h"
+#include "spdk/env.h"
+
+#include "common/lib/ut_multithread.c"
+
+#include "bdev/raid/raid6.c"
+#include "../common.c"
+
+DEFINE_STUB_V(raid_bdev_module_list_add, (struct raid_bdev_module *raid_module));
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB_V(raid_bdev_module_stop_done, (struct raid_bdev *raid_bdev));
+DEFINE_STUB_V(raid_bdev_process_request_complete, (struct raid_bdev_process_request *process_req,
+		int status));
+DEFINE_STUB_V(raid_bdev_io_init, (struct raid_bdev_io *raid_io,
+				  struct raid_bdev_io_channel *raid_ch,
+				  enum spdk_bdev_io_type type, uint64_t offset_blocks,
+				  uint64_t num_blocks, struct iovec *iovs, int iovcnt, void *md_buf,
+				  struct spdk_memory_domain *memory_domain, void *memory_domain_ctx));
+DEFINE_STUB(raid_bdev_remap_dix_reftag, int, (void *md_buf, uint64_t num_blocks,
+		struct spdk_bdev *bdev, uint32_t remapped_offset), -1);
+
+enum test_bdev_error_type {
+	TEST_BDEV_ERROR_NONE,
+	TEST_BDEV_ERROR_SUBMIT,
+	TEST_BDEV_ERROR_COMPLETE,
+	TEST_BDEV_ERROR_NOMEM,
+};
+
+/* Contents of the base bdevs of the raid bdev under test */
+struct test_disk {
+	uint8_t *data;
+	uint8_t *md;
+};
+
+static struct test_disk *g_disks;
+
+static struct {
+	enum test_bdev_error_type type;
+	struct spdk_bdev *bdev;
+} g_error;
+
+static TAILQ_HEAD(, spdk_bdev_io) g_bdev_io_queue = TAILQ_HEAD_INITIALIZER(g_bdev_io_queue);
+static TAILQ_HEAD(, spdk_bdev_io_wait_entry) g_bdev_io_wait_queue =
+	TAILQ_HEAD_INITIALIZER(g_bdev_io_wait_queue);
+
+static int
+test_suite_init(void)
+{
+	uint8_t num_base_bdevs_values[] = { 4, 5, 6 };
+	uint64_t base_bdev_blockcnt_values[] = { 1, 128 };
+	uint32_t base_bdev_blocklen_values[] = { 512, 4096 };
+	uint32_t strip_size_kb_values[] = { 1, 4, 16 };
+	enum raid_params_md_type md_type_values[] = { RAID_PARAMS_MD_NONE, RAID_PARAMS_MD_SEPARATE, RAID_PARAMS_MD_INTERLEAVED };
+	uint8_t *num_base_bdevs;
+	uint64_t *base_bdev_blockcnt;
+	uint32_t *base_bdev_blocklen;
+	uint32_t *strip_size_kb;
+	enum raid_params_md_type *md_type;
+	uint64_t params_count;
+	int rc;
+
+	params_count = SPDK_COUNTOF(num_base_bdevs_values) *
+		       SPDK_COUNTOF(base_bdev_blockcnt_values) *
+		       SPDK_COUNTOF(base_bdev_blocklen_values) *
+		       SPDK_COUNTOF(strip_size_kb_values) *
+		       SPDK_COUNTOF(md_type_values);
+	rc = raid_test_params_alloc(params_count);
+	if (rc) {
+		return rc;
+	}
+
+	ARRAY_FOR_EACH(num_base_bdevs_values, num_base_bdevs) {
+		ARRAY_FOR_EACH(base_bdev_blockcnt_values, base_bdev_blockcnt) {
+			ARRAY_FOR_EACH(base_bdev_blocklen_values, base_bdev_blocklen) {
+				ARRAY_FOR_EACH(strip_size_kb_values, strip_size_kb) {
+					ARRAY_FOR_EACH(md_type_values, md_type) {
+						struct raid_params params = {
+							.num_base_bdevs = *num_base_bdevs,
+							.base_bdev_blockcnt = *base_bdev_blockcnt,
+							.base_bdev_blocklen = *base_bdev_blocklen,
+							.strip_size = *strip_size_kb * 1024 / *base_bdev_blocklen,
+							.md_type = *md_type,
+						};
+						if (params.strip_size == 0 ||
+						    params.strip_size > params.base_bdev_blockcnt) {
+							continue;
+						}
+						raid_test_params_add(&params);
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+test_suite_cleanup(void)
+{
+	raid_test_params_free();
+	return 0;
+}
+
+static void
+test_setup(void)
+{
+	memset(&g_error, 0, sizeof(g_error));
+}
+
+static struct raid6_info *
+create_raid6(struct raid_params *params)
+{
+	struct raid_bdev *raid_bdev = raid_test_create_raid_bdev(params, &g_raid6_module);
+	uint8_t i;
+
+	SPDK_CU_ASSERT_FATAL(raid6_start(raid_bdev) == 0);
+
+	g_disks = calloc(raid_bdev->num_base_bdevs, sizeof(*g_disks));
+	SPDK_CU_ASSERT_FATAL(g_disks != NULL);
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		g_disks[i].data = calloc(params->base_bdev_blockcnt, raid_bdev->bdev.blocklen);
+		SPDK_CU_ASSERT_FATAL(g_disks[i].data != NULL);
+		if (raid_bdev->bdev.md_len && !raid_bdev->bdev.md_interleave) {
+			g_disks[i].md = calloc(params->base_bdev_blockcnt, raid_bdev->bdev.md_len);
+			SPDK_CU_ASSERT_FATAL(g_disks[i].md != NULL);
+		}
+	}
+
+	return raid_bdev->module_private;
+}
+
+static void
+delete_raid6(struct raid6_info *r6_info)
+{
+	struct raid_bdev *raid_bdev = r6_info->raid_bdev;
+	uint8_t i;
+
+	for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+		free(g_disks[i].data);
+		free(g_disks[i].md);
+	}
+	free(g_disks);
+	g_disks = NULL;
+
+	raid6_stop(raid_bdev);
+
+	raid_test_delete_raid_bdev(raid_bdev);
+}
+
+static void
+test_raid6_start(void)
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid6_info *r6_info;
+
+		r6_info = create_raid6(params);
+
+		SPDK_CU_ASSERT_FATAL(r6_info != NULL);
+
+		CU_ASSERT_EQUAL(r6_info->stripe_blocks, params->strip_size * (params->num_base_bdevs - 2));
+		CU_ASSERT_EQUAL(r6_info->total_stripes, params->base_bdev_blockcnt / params->strip_size);
+		CU_ASSERT_EQUAL(r6_info->raid_bdev->bdev.blockcnt,
+				(params->base_bdev_blockcnt - params->base_bdev_blockcnt % params->strip_size) *
+				(params->num_base_bdevs - 2));
+		CU_ASSERT_EQUAL(r6_info->raid_bdev->bdev.optimal_io_boundary, params->strip_size);
+		CU_ASSERT_TRUE(r6_info->raid_bdev->bdev.split_on_optimal_io_boundary);
+		CU_ASSERT_EQUAL(r6_info->raid_bdev->bdev.write_unit_size, r6_info->stripe_blocks);
+
+		delete_raid6(r6_info);
+	}
+}
+
+static void
+test_raid6_chunk_layout(void)
+{
+	struct raid_params *params;
+	uint64_t stripe_index;
+	uint8_t i, idx, p_idx, q_idx;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid6_info *r6_info = create_raid6(params);
+		struct raid_bdev *raid_bdev = r6_info->raid_bdev;
+
+		for (stripe_index = 0; stripe_index < raid_bdev->num_base_bdevs * 2; stripe_index++) {
+			uint8_t used[UINT8_MAX] = {};
+
+			p_idx = raid6_stripe_p_chunk_index(raid_bdev, stripe_index);
+			q_idx = raid6_stripe_q_chunk_index(raid_bdev, stripe_index);
+			CU_ASSERT(p_idx != q_idx);
+			used[p_idx]++;
+			used[q_idx]++;
+
+			for (i = 0; i < raid6_stripe_data_chunks_num(raid_bdev); i++) {
+				idx = raid6_stripe_data_chunk_index(raid_bdev, stripe_index, i);
+				SPDK_CU_ASSERT_FATAL(idx < raid_bdev->num_base_bdevs);
+				used[idx]++;
+			}
+
+			for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+				CU_ASSERT(used[i] == 1);
+			}
+		}
+
+		delete_raid6(r6_info);
+	}
+}
+
+struct test_raid_bdev_io {
+	struct raid_bdev_io raid_io;
+	enum spdk_bdev_io_status *status;
+};
+
+void
+raid_bdev_queue_io_wait(struct raid_bdev_io *raid_io, struct spdk_bdev *bdev,
+			struct spdk_io_channel *ch, spdk_bdev_io_wait_cb cb_fn)
+{
+	raid_io->waitq_entry.bdev = bdev;
+	raid_io->waitq_entry.cb_fn = cb_fn;
+	raid_io->waitq_entry.cb_arg = raid_io;
+	TAILQ_INSERT_TAIL(&g_bdev_io_wait_queue, &raid_io->waitq_entry, link);
+}
+
+void
+raid_test_bdev_io_complete(struct raid_bdev_io *raid_io, enum spdk_bdev_io_status status)
+{
+	struct test_raid_bdev_io *test_raid_bdev_io = SPDK_CONTAINEROF(raid_io, struct test_raid_bdev_io,
+			raid_io);
+
+	*test_raid_bdev_io->status = status;
+
+	free(raid_io->iovs);
+	free(test_raid_bdev_io);
+}
+
+static struct raid_bdev_io *
+get_raid_io(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+	    enum spdk_bdev_io_type io_type, uint64_t offset_blocks, uint64_t num_blocks,
+	    void *buf, void *md_buf, enum spdk_bdev_io_status *status)
+{
+	struct test_raid_bdev_io *test_raid_bdev_io;
+	struct iovec *iovs;
+	int iovcnt;
+	size_t iov_len, remaining;
+	struct iovec *iov;
+	int i;
+
+	test_raid_bdev_io = calloc(1, sizeof(*test_raid_bdev_io));
+	SPDK_CU_ASSERT_FATAL(test_raid_bdev_io != NULL);
+
+	test_raid_bdev_io->status = status;
+	*status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	iovcnt = 5;
+	iovs = calloc(iovcnt, sizeof(*iovs));
+	SPDK_CU_ASSERT_FATAL(iovs != NULL);
+
+	remaining = num_blocks * raid_bdev->bdev.blocklen;
+	iov_len = remaining / iovcnt;
+
+	for (i = 0; i < iovcnt; i++) {
+		iov = &iovs[i];
+		iov->iov_base = buf;
+		iov->iov_len = iov_len;
+		buf += iov_len;
+		remaining -= iov_len;
+	}
+	iov->iov_len += remaining;
+
+	raid_test_bdev_io_init(&test_raid_bdev_io->raid_io, raid_bdev, raid_ch, io_type,
+			       offset_blocks, num_blocks, iovs, iovcnt, md_buf);
+
+	return &test_raid_bdev_io->raid_io;
+}
+
+void
+spdk_bdev_free_io(struct spdk_bdev_io *bdev_io)
+{
+	free(bdev_io);
+}
+
+static void
+process_io_completions(void)
+{
+	struct spdk_bdev_io_wait_entry *waitq_entry;
+	struct spdk_bdev_io *bdev_io;
+	bool success;
+
+	while (!TAILQ_EMPTY(&g_bdev_io_queue) || !TAILQ_EMPTY(&g_bdev_io_wait_queue)) {
+		while ((bdev_io = TAILQ_FIRST(&g_bdev_io_queue))) {
+			TAILQ_REMOVE(&g_bdev_io_queue, bdev_io, internal.link);
+
+			success = !(g_error.type == TEST_BDEV_ERROR_COMPLETE && g_error.bdev == bdev_io->bdev);
+
+			bdev_io->internal.cb(bdev_io, success, bdev_io->internal.caller_ctx);
+		}
+
+		if (g_error.type == TEST_BDEV_ERROR_NOMEM) {
+			g_error.type = TEST_BDEV_ERROR_NONE;
+		}
+
+		while ((waitq_entry = TAILQ_FIRST(&g_bdev_io_wait_queue))) {
+			TAILQ_REMOVE(&g_bdev_io_wait_queue, waitq_entry, link);
+			waitq_entry->cb_fn(waitq_entry->cb_arg);
+		}
+	}
+}
+
+static int
+submit_io(struct spdk_bdev_desc *desc, struct iovec *iov, int iovcnt, void *md_buf,
+	  uint64_t offset_blocks, uint64_t num_blocks, bool write,
+	  spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct spdk_bdev *bdev = desc->bdev;
+	struct raid_base_bdev_info *base_info = bdev->ctxt;
+	struct test_disk *disk = &g_disks[base_info - base_info->raid_bdev->base_bdev_info];
+	struct iovec disk_iov = {
+		.iov_base = disk->data + offset_blocks * bdev->blocklen,
+		.iov_len = num_blocks * bdev->blocklen,
+	};
+	struct spdk_bdev_io *bdev_io;
+
+	if (bdev == g_error.bdev) {
+		if (g_error.type == TEST_BDEV_ERROR_SUBMIT) {
+			return -EINVAL;
+		} else if (g_error.type == TEST_BDEV_ERROR_NOMEM) {
+			return -ENOMEM;
+		}
+	}
+
+	SPDK_CU_ASSERT_FATAL(offset_blocks + num_blocks <= bdev->blockcnt);
+	CU_ASSERT((md_buf != NULL) == (disk->md != NULL));
+
+	if (write) {
+		spdk_iovcpy(iov, iovcnt, &disk_iov, 1);
+		if (md_buf != NULL) {
+			memcpy(disk->md + offset_blocks * bdev->md_len, md_buf, num_blocks * bdev->md_len);
+		}
+	} else {
+		spdk_iovcpy(&disk_iov, 1, iov, iovcnt);
+		if (md_buf != NULL) {
+			memcpy(md_buf, disk->md + offset_blocks * bdev->md_len, num_blocks * bdev->md_len);
+		}
+	}
+
+	bdev_io = calloc(1, sizeof(*bdev_io));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = bdev;
+	bdev_io->internal.cb = cb;
+	bdev_io->internal.caller_ctx = cb_arg;
+
+	TAILQ_INSERT_TAIL(&g_bdev_io_queue, bdev_io, internal.link);
+
+	return 0;
+}
+
+int
+spdk_bdev_writev_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			    struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			    uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			    struct spdk_bdev_ext_io_opts *opts)
+{
+	CU_ASSERT_PTR_NULL(opts->memory_domain);
+	CU_ASSERT_PTR_NULL(opts->memory_domain_ctx);
+
+	return submit_io(desc, iov, iovcnt, opts->metadata, offset_blocks, num_blocks, true, cb,
+			 cb_arg);
+}
+
+int
+spdk_bdev_readv_blocks_ext(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+			   struct iovec *iov, int iovcnt, uint64_t offset_blocks,
+			   uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg,
+			   struct spdk_bdev_ext_io_opts *opts)
+{
+	CU_ASSERT_PTR_NULL(opts->memory_domain);
+	CU_ASSERT_PTR_NULL(opts->memory_domain_ctx);
+
+	return submit_io(desc, iov, iovcnt, opts->metadata, offset_blocks, num_blocks, false, cb,
+			 cb_arg);
+}
+
+/* Reference bitwise multiplication with the 0x11d polynomial */
+static uint8_t
+ref_gf_mul(uint8_t a, uint8_t b)
+{
+	uint8_t r = 0;
+
+	while (b) {
+		if (b & 1) {
+			r ^= a;
+		}
+		a = (a << 1) ^ ((a & 0x80) ? 0x1d : 0);
+		b >>= 1;
+	}
+
+	return r;
+}
+
+static void
+fill_buf(uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		buf[i] = rand();
+	}
+}
+
+struct test_stripe {
+	uint8_t *data;
+	uint8_t *md;
+	size_t data_len;
+	size_t md_len;
+};
+
+static void
+test_stripe_init(struct test_stripe *stripe, struct raid_bdev *raid_bdev)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	uint32_t md_len = raid_bdev->bdev.md_interleave ? 0 : raid_bdev->bdev.md_len;
+
+	stripe->data_len = r6_info->stripe_blocks * raid_bdev->bdev.blocklen;
+	stripe->data = spdk_dma_malloc(stripe->data_len, 4096, NULL);
+	SPDK_CU_ASSERT_FATAL(stripe->data != NULL);
+	fill_buf(stripe->data, stripe->data_len);
+
+	stripe->md_len = r6_info->stripe_blocks * md_len;
+	if (stripe->md_len) {
+		stripe->md = spdk_dma_malloc(stripe->md_len, 4096, NULL);
+		SPDK_CU_ASSERT_FATAL(stripe->md != NULL);
+		fill_buf(stripe->md, stripe->md_len);
+	} else {
+		stripe->md = NULL;
+	}
+}
+
+static void
+test_stripe_free(struct test_stripe *stripe)
+{
+	spdk_dma_free(stripe->data);
+	spdk_dma_free(stripe->md);
+}
+
+static void
+write_stripe(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+	     uint64_t stripe_index, struct test_stripe *stripe, enum spdk_bdev_io_status *status)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	struct raid_bdev_io *raid_io;
+
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_WRITE,
+			      stripe_index * r6_info->stripe_blocks, r6_info->stripe_blocks,
+			      stripe->data, stripe->md, status);
+
+	raid6_submit_rw_request(raid_io);
+
+	process_io_completions();
+}
+
+/* Verify data, P and Q of a stripe on the disks against the reference computation */
+static void
+verify_stripe_on_disks(struct raid_bdev *raid_bdev, uint64_t stripe_index,
+		       struct test_stripe *stripe, uint8_t skip_a, uint8_t skip_b)
+{
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint32_t md_len = raid_bdev->bdev.md_len;
+	size_t strip_len = raid_bdev->strip_size * blocklen;
+	size_t strip_md_len = raid_bdev->strip_size * md_len;
+	uint64_t base_offset = stripe_index * raid_bdev->strip_size;
+	uint8_t p_idx = raid6_stripe_p_chunk_index(raid_bdev, stripe_index);
+	uint8_t q_idx = raid6_stripe_q_chunk_index(raid_bdev, stripe_index);
+	uint8_t *p, *q, *p_md = NULL, *q_md = NULL;
+	uint8_t i, idx, coef;
+	size_t j;
+
+	p = calloc(1, strip_len);
+	q = calloc(1, strip_len);
+	SPDK_CU_ASSERT_FATAL(p != NULL && q != NULL);
+	if (stripe->md) {
+		p_md = calloc(1, strip_md_len);
+		q_md = calloc(1, strip_md_len);
+		SPDK_CU_ASSERT_FATAL(p_md != NULL && q_md != NULL);
+	}
+
+	for (i = 0; i < raid6_stripe_data_chunks_num(raid_bdev); i++) {
+		uint8_t *data = stripe->data + i * strip_len;
+
+		idx = raid6_stripe_data_chunk_index(raid_bdev, stripe_index, i);
+		coef = spdk_gf_exp(i);
+
+		for (j = 0; j < strip_len; j++) {
+			p[j] ^= data[j];
+			q[j] ^= ref_gf_mul(coef, data[j]);
+		}
+
+		if (idx != skip_a && idx != skip_b) {
+			CU_ASSERT(memcmp(g_disks[idx].data + base_offset * blocklen, data, strip_len) == 0);
+		}
+
+		if (stripe->md) {
+			uint8_t *md = stripe->md + i * strip_md_len;
+
+			for (j = 0; j < strip_md_len; j++) {
+				p_md[j] ^= md[j];
+				q_md[j] ^= ref_gf_mul(coef, md[j]);
+			}
+
+			if (idx != skip_a && idx != skip_b) {
+				CU_ASSERT(memcmp(g_disks[idx].md + base_offset * md_len, md, strip_md_len) == 0);
+			}
+		}
+	}
+
+	if (p_idx != skip_a && p_idx != skip_b) {
+		CU_ASSERT(memcmp(g_disks[p_idx].data + base_offset * blocklen, p, strip_len) == 0);
+		if (stripe->md) {
+			CU_ASSERT(memcmp(g_disks[p_idx].md + base_offset * md_len, p_md, strip_md_len) == 0);
+		}
+	}
+	if (q_idx != skip_a && q_idx != skip_b) {
+		CU_ASSERT(memcmp(g_disks[q_idx].data + base_offset * blocklen, q, strip_len) == 0);
+		if (stripe->md) {
+			CU_ASSERT(memcmp(g_disks[q_idx].md + base_offset * md_len, q_md, strip_md_len) == 0);
+		}
+	}
+
+	free(p);
+	free(q);
+	free(p_md);
+	free(q_md);
+}
+
+static void
+read_and_verify(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+		uint64_t stripe_index, uint64_t stripe_offset, uint64_t num_blocks,
+		struct test_stripe *stripe)
+{
+	struct raid6_info *r6_info = raid_bdev->module_private;
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint32_t md_len = raid_bdev->bdev.md_len;
+	enum spdk_bdev_io_status status;
+	struct raid_bdev_io *raid_io;
+	void *buf, *md_buf = NULL;
+
+	buf = spdk_dma_malloc(num_blocks * blocklen, 4096, NULL);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, 0xcd, num_blocks * blocklen);
+	if (stripe->md) {
+		md_buf = spdk_dma_malloc(num_blocks * md_len, 4096, NULL);
+		SPDK_CU_ASSERT_FATAL(md_buf != NULL);
+		memset(md_buf, 0xcd, num_blocks * md_len);
+	}
+
+	raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+			      stripe_index * r6_info->stripe_blocks + stripe_offset, num_blocks,
+			      buf, md_buf, &status);
+
+	raid6_submit_rw_request(raid_io);
+
+	process_io_completions();
+
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(memcmp(buf, stripe->data + stripe_offset * blocklen, num_blocks * blocklen) == 0);
+	if (stripe->md) {
+		CU_ASSERT(memcmp(md_buf, stripe->md + stripe_offset * md_len, num_blocks * md_len) == 0);
+	}
+
+	spdk_dma_free(buf);
+	spdk_dma_free(md_buf);
+}
+
+static void
+read_and_verify_stripe(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch,
+		       uint64_t stripe_index, struct test_stripe *stripe)
+{
+	uint32_t strip_size = raid_bdev->strip_size;
+	uint8_t i;
+
+	for (i = 0; i < raid6_stripe_data_chunks_num(raid_bdev); i++) {
+		uint64_t stripe_offset = i * strip_size;
+
+		read_and_verify(raid_bdev, raid_ch, stripe_index, stripe_offset, strip_size, stripe);
+		read_and_verify(raid_bdev, raid_ch, stripe_index, stripe_offset + strip_size - 1, 1,
+				stripe);
+		if (strip_size > 2) {
+			read_and_verify(raid_bdev, raid_ch, stripe_index, stripe_offset + 1, strip_size - 2,
+					stripe);
+		}
+	}
+}
+
+static void
+wipe_disk(struct raid_bdev *raid_bdev, uint8_t idx)
+{
+	struct spdk_bdev *bdev = raid_bdev->base_bdev_info[idx].desc->bdev;
+
+	memset(g_disks[idx].data, 0xab, bdev->blockcnt * bdev->blocklen);
+	if (g_disks[idx].md) {
+		memset(g_disks[idx].md, 0xab, bdev->blockcnt * bdev->md_len);
+	}
+}
+
+static void
+run_for_each_raid6_config(void (*test_fn)(struct raid_bdev *raid_bdev,
+			  struct raid_bdev_io_channel *raid_ch))
+{
+	struct raid_params *params;
+
+	RAID_PARAMS_FOR_EACH(params) {
+		struct raid6_info *r6_info;
+		struct raid_bdev_io_channel *raid_ch;
+
+		r6_info = create_raid6(params);
+		raid_ch = raid_test_create_io_channel(r6_info->raid_bdev);
+
+		test_fn(r6_info->raid_bdev, raid_ch);
+
+		raid_test_destroy_io_channel(raid_ch);
+		delete_raid6(r6_info);
+	}
+}
+
+#define RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, i) \
+	for (i = 0; i < spdk_min(raid_bdev->num_base_bdevs, ((struct raid6_info *)raid_bdev->module_private)->total_stripes); i++)
+
+static void
+__test_raid6_submit_rw_request(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	enum spdk_bdev_io_status status;
+	struct test_stripe stripe;
+	uint64_t stripe_index;
+
+	RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		test_stripe_init(&stripe, raid_bdev);
+
+		write_stripe(raid_bdev, raid_ch, stripe_index, &stripe, &status);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+		verify_stripe_on_disks(raid_bdev, stripe_index, &stripe, UINT8_MAX, UINT8_MAX);
+		read_and_verify_stripe(raid_bdev, raid_ch, stripe_index, &stripe);
+
+		test_stripe_free(&stripe);
+	}
+}
+static void
+test_raid6_submit_rw_request(void)
+{
+	run_for_each_raid6_config(__test_raid6_submit_rw_request);
+}
+
+static void
+__test_raid6_submit_read_request_degraded(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	enum spdk_bdev_io_status status;
+	struct test_stripe stripe;
+	uint64_t stripe_index;
+	uint8_t a, b;
+
+	RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		test_stripe_init(&stripe, raid_bdev);
+
+		write_stripe(raid_bdev, raid_ch, stripe_index, &stripe, &status);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+		/* a == b means a single missing base bdev */
+		for (a = 0; a < raid_bdev->num_base_bdevs; a++) {
+			for (b = a; b < raid_bdev->num_base_bdevs; b++) {
+				void *ch_a = raid_ch->_base_channels[a];
+				void *ch_b = raid_ch->_base_channels[b];
+
+				raid_ch->_base_channels[a] = NULL;
+				raid_ch->_base_channels[b] = NULL;
+
+				read_and_verify_stripe(raid_bdev, raid_ch, stripe_index, &stripe);
+
+				raid_ch->_base_channels[a] = ch_a;
+				raid_ch->_base_channels[b] = ch_b;
+			}
+		}
+
+		test_stripe_free(&stripe);
+	}
+}
+static void
+test_raid6_submit_read_request_degraded(void)
+{
+	run_for_each_raid6_config(__test_raid6_submit_read_request_degraded);
+}
+
+static void
+__test_raid6_submit_write_request_degraded(struct raid_bdev *raid_bdev,
+		struct raid_bdev_io_channel *raid_ch)
+{
+	enum spdk_bdev_io_status status;
+	struct test_stripe stripe;
+	uint64_t stripe_index;
+	uint8_t a, b;
+
+	for (a = 0; a < raid_bdev->num_base_bdevs; a++) {
+		for (b = a; b < raid_bdev->num_base_bdevs; b++) {
+			void *ch_a = raid_ch->_base_channels[a];
+			void *ch_b = raid_ch->_base_channels[b];
+
+			raid_ch->_base_channels[a] = NULL;
+			raid_ch->_base_channels[b] = NULL;
+			wipe_disk(raid_bdev, a);
+			wipe_disk(raid_bdev, b);
+
+			RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+				test_stripe_init(&stripe, raid_bdev);
+
+				write_stripe(raid_bdev, raid_ch, stripe_index, &stripe, &status);
+				CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+				verify_stripe_on_disks(raid_bdev, stripe_index, &stripe, a, b);
+				read_and_verify_stripe(raid_bdev, raid_ch, stripe_index, &stripe);
+
+				test_stripe_free(&stripe);
+			}
+
+			raid_ch->_base_channels[a] = ch_a;
+			raid_ch->_base_channels[b] = ch_b;
+		}
+	}
+}
+static void
+test_raid6_submit_write_request_degraded(void)
+{
+	run_for_each_raid6_config(__test_raid6_submit_write_request_degraded);
+}
+
+static void
+test_reconstruct_done(struct stripe_request *stripe_req, int status)
+{
+	struct raid_bdev_io *raid_io = stripe_req->raid_io;
+
+	raid6_stripe_request_release(stripe_req);
+
+	raid_bdev_io_complete(raid_io, status == 0 ? SPDK_BDEV_IO_STATUS_SUCCESS :
+			      SPDK_BDEV_IO_STATUS_FAILED);
+}
+
+/* Reconstruct every chunk of a stripe, including P and Q, as done by the rebuild process */
+static void
+__test_raid6_reconstruct_chunk(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	uint32_t md_len = raid_bdev->bdev.md_interleave ? 0 : raid_bdev->bdev.md_len;
+	size_t strip_len = raid_bdev->strip_size * blocklen;
+	size_t strip_md_len = raid_bdev->strip_size * md_len;
+	enum spdk_bdev_io_status status;
+	struct test_stripe stripe;
+	struct raid_bdev_io *raid_io;
+	uint64_t stripe_index;
+	uint64_t base_offset;
+	void *buf, *md_buf = NULL;
+	uint8_t target, other;
+	int ret;
+
+	buf = spdk_dma_malloc(strip_len, 4096, NULL);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	if (strip_md_len) {
+		md_buf = spdk_dma_malloc(strip_md_len, 4096, NULL);
+		SPDK_CU_ASSERT_FATAL(md_buf != NULL);
+	}
+
+	RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+		test_stripe_init(&stripe, raid_bdev);
+
+		write_stripe(raid_bdev, raid_ch, stripe_index, &stripe, &status);
+		CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+		base_offset = stripe_index * raid_bdev->strip_size;
+
+		/* other == target means no other base bdev is missing */
+		for (target = 0; target < raid_bdev->num_base_bdevs; target++) {
+			for (other = 0; other < raid_bdev->num_base_bdevs; other++) {
+				void *ch_other = raid_ch->_base_channels[other];
+
+				raid_ch->_base_channels[other] = NULL;
+
+				memset(buf, 0xcd, strip_len);
+				if (md_buf) {
+					memset(md_buf, 0xcd, strip_md_len);
+				}
+
+				raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ,
+						      stripe_index * raid_bdev->strip_size, raid_bdev->strip_size,
+						      buf, md_buf, &status);
+
+				ret = raid6_submit_reconstruct_read(raid_io, stripe_index, target, 0,
+								    test_reconstruct_done);
+				CU_ASSERT(ret == 0);
+
+				process_io_completions();
+
+				CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+				CU_ASSERT(memcmp(buf, g_disks[target].data + base_offset * blocklen,
+						 strip_len) == 0);
+				if (md_buf) {
+					CU_ASSERT(memcmp(md_buf, g_disks[target].md + base_offset * md_len,
+							 strip_md_len) == 0);
+				}
+
+				raid_ch->_base_channels[other] = ch_other;
+			}
+		}
+
+		test_stripe_free(&stripe);
+	}
+
+	spdk_dma_free(buf);
+	spdk_dma_free(md_buf);
+}
+static void
+test_raid6_reconstruct_chunk(void)
+{
+	run_for_each_raid6_config(__test_raid6_reconstruct_chunk);
+}
+
+static void
+__test_raid6_chunk_write_error(struct raid_bdev *raid_bdev, struct raid_bdev_io_channel *raid_ch)
+{
+	struct raid_base_bdev_info *base_bdev_info;
+	enum spdk_bdev_io_status status;
+	enum test_bdev_error_type error_type;
+	struct test_stripe stripe;
+	uint64_t stripe_index;
+
+	for (error_type = TEST_BDEV_ERROR_SUBMIT; error_type <= TEST_BDEV_ERROR_NOMEM; error_type++) {
+		RAID6_TEST_FOR_EACH_STRIPE(raid_bdev, stripe_index) {
+			RAID_FOR_EACH_BASE_BDEV(raid_bdev, base_bdev_info) {
+				test_stripe_init(&stripe, raid_bdev);
+
+				g_error.type = error_type;
+				g_error.bdev = base_bdev_info->desc->bdev;
+
+				write_stripe(raid_bdev, raid_ch, stripe_index, &stripe, &status);
+
+				if (error_type == TEST_BDEV_ERROR_NOMEM) {
+					CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+					verify_stripe_on_disks(raid_bdev, stripe_index, &stripe, UINT8_MAX, UINT8_MAX);
+				} else {
+					CU_ASSERT(status == SPDK_BDEV_IO_STATUS_FAILED);
+				}
+
+				g_error.type = TEST_BDEV_ERROR_NONE;
+				test_stripe_free(&stripe);
+			}
+		}
+	}
+}
+static void
+test_raid6_chunk_write_error(void)
+{
+	run_for_each_raid6_config(__test_raid6_chunk_write_error);
+}
+
+static int
+count_free_stripe_requests(struct raid_bdev_io_channel *raid_ch, enum stripe_request_type type)
+{
+	struct raid6_io_channel *r6ch = raid_bdev_channel_get_module_ctx(raid_ch);
+	struct stripe_request *stripe_req;
+	int count = 0;
+
+	if (type == STRIPE_REQ_WRITE) {
+		TAILQ_FOREACH(stripe_req, &r6ch->free_stripe_requests.write, link) {
+			count++;
+		}
+	} else {
+		TAILQ_FOREACH(stripe_req, &r6ch->free_stripe_requests.reconstruct, link) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+static void
+__test_raid6_reconstruct_read_error(struct raid_bdev *raid_bdev,
+				    struct raid_bdev_io_channel *raid_ch)
+{
+	uint32_t blocklen = raid_bdev->bdev.blocklen;
+	enum spdk_bdev_io_status status;
+	enum test_bdev_error_type error_type;
+	struct test_stripe stripe;
+	struct raid_bdev_io *raid_io;
+	void *buf, *md_buf = NULL;
+	uint8_t missing, i;
+	void *ch;
+
+	test_stripe_init(&stripe, raid_bdev);
+	write_stripe(raid_bdev, raid_ch, 0, &stripe, &status);
+	CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	buf = spdk_dma_malloc(raid_bdev->strip_size * blocklen, 4096, NULL);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	if (stripe.md) {
+		md_buf = spdk_dma_malloc(raid_bdev->strip_size * raid_bdev->bdev.md_len, 4096, NULL);
+		SPDK_CU_ASSERT_FATAL(md_buf != NULL);
+	}
+
+	missing = raid6_stripe_data_chunk_index(raid_bdev, 0, 0);
+	ch = raid_ch->_base_channels[missing];
+	raid_ch->_base_channels[missing] = NULL;
+
+	for (error_type = TEST_BDEV_ERROR_SUBMIT; error_type <= TEST_BDEV_ERROR_NOMEM; error_type++) {
+		for (i = 0; i < raid_bdev->num_base_bdevs; i++) {
+			if (i == missing) {
+				continue;
+			}
+
+			g_error.type = error_type;
+			g_error.bdev = raid_bdev->base_bdev_info[i].desc->bdev;
+
+			raid_io = get_raid_io(raid_bdev, raid_ch, SPDK_BDEV_IO_TYPE_READ, 0,
+					      raid_bdev->strip_size, buf, md_buf, &status);
+
+			raid6_submit_rw_request(raid_io);
+
+			process_io_completions();
+
+			/* The base bdev that is not needed for reconstruction may fail without harm */
+			if (error_type == TEST_BDEV_ERROR_NOMEM ||
+			    i == raid6_stripe_q_chunk_index(raid_bdev, 0)) {
+				CU_ASSERT(status == SPDK_BDEV_IO_STATUS_SUCCESS);
+				CU_ASSERT(memcmp(buf, stripe.data, raid_bdev->strip_size * blocklen) == 0);
+			} else {
+				CU_ASSERT(status == SPDK_BDEV_IO_STATUS_FAILED);
+			}
+
+			g_error.type = TEST_BDEV_ERROR_NONE;
+		}
+	}
+
+	raid_ch->_base_channels[missing] = ch;
+
+	/* All stripe requests must have been returned to the pool */
+	CU_ASSERT(count_free_stripe_requests(raid_ch, STRIPE_REQ_WRITE) == RAID6_MAX_STRIPES);
+	CU_ASSERT(count_free_stripe_requests(raid_ch, STRIPE_REQ_RECONSTRUCT) == RAID6_MAX_STRIPES);
+
+	spdk_dma_free(buf);
+	spdk_dma_free(md_buf);
+	test_stripe_free(&stripe);
+}
+static void
+test_raid6_reconstruct_read_error(void)
+{
+	run_for_each_raid6_config(__test_raid6_reconstruct_read_error);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite_with_setup_and_teardown("raid6", test_suite_init, test_suite_cleanup,
+			test_setup, NULL);
+	CU_ADD_TEST(suite, test_raid6_start);
+	CU_ADD_TEST(suite, test_raid6_chunk_layout);
+	CU_ADD_TEST(suite, test_raid6_submit_rw_request);
+	CU_ADD_TEST(suite, test_raid6_submit_read_request_degraded);
+	CU_ADD_TEST(suite, test_raid6_submit_write_request_degraded);
+	CU_ADD_TEST(suite, test_raid6_reconstruct_chunk);
+	CU_ADD_TEST(suite, test_raid6_chunk_write_error);
+	CU_ADD_TEST(suite, test_raid6_reconstruct_read_error);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+	CU_cleanup_registry();
+
+	free_threads();
+
+	return num_failures;
+}
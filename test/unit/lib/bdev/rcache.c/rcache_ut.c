@@ -0,0 +1,464 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk_internal/cunit.h"
+
+#include "common/lib/ut_multithread.c"
+#include "spdk_internal/mock.h"
+#include "unit/lib/json_mock.c"
+#include "common/lib/bdev/ut_bdev.c"
+
+#include "bdev/rcache/vbdev_rcache.c"
+
+#define UT_BLOCKLEN		512
+#define UT_BASE_BLOCKS		(8ULL * 1024 * 1024 / UT_BLOCKLEN)
+#define UT_LINE_SIZE		VBDEV_RCACHE_DEFAULT_LINE_SIZE
+#define UT_LINE_BLOCKS		(UT_LINE_SIZE / UT_BLOCKLEN)
+#define UT_MAX_IOVS		4
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB_V(spdk_bdev_module_examine_done, (struct spdk_bdev_module *module));
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_reset, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+
+static struct ut_bdev g_base;
+static struct vbdev_rcache_stats g_stats;
+
+void
+spdk_bdev_io_complete_base_io_status(struct spdk_bdev_io *bdev_io,
+				     const struct spdk_bdev_io *base_io)
+{
+	spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+ut_stats_cb(void *cb_arg, const struct vbdev_rcache_stats *stats, int rc)
+{
+	g_cb_called = true;
+	g_cb_status = rc;
+	g_stats = *stats;
+}
+
+static struct vbdev_rcache *
+ut_create(uint64_t shard_size_mib, uint32_t line_size)
+{
+	struct vbdev_rcache_opts opts = {
+		.name = "rcache0",
+		.base_bdev_name = g_base.bdev.name,
+		.shard_size_mib = shard_size_mib,
+		.line_size = line_size,
+	};
+
+	CU_ASSERT(create_rcache_disk(&opts) == 0);
+	SPDK_CU_ASSERT_FATAL(g_registered_bdev != NULL);
+
+	return g_registered_bdev->ctxt;
+}
+
+static void
+ut_delete(void)
+{
+	g_cb_called = false;
+	delete_rcache_disk("rcache0", ut_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	CU_ASSERT(g_registered_bdev == NULL);
+}
+
+static struct spdk_io_channel *
+ut_get_io_channel(struct vbdev_rcache *rcache, int thread_id)
+{
+	struct spdk_io_channel *ch;
+
+	set_thread(thread_id);
+	ch = spdk_get_io_channel(rcache);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+
+	return ch;
+}
+
+static void
+ut_put_io_channel(struct spdk_io_channel *ch, int thread_id)
+{
+	set_thread(thread_id);
+	spdk_put_io_channel(ch);
+	poll_threads();
+}
+
+/* Submit an I/O with its buffer split into iovcnt parts, on the current thread */
+static void
+ut_submit_iov(struct vbdev_rcache *rcache, struct spdk_io_channel *ch,
+	      enum spdk_bdev_io_type type, void *buf, uint64_t offset_blocks,
+	      uint64_t num_blocks, int iovcnt)
+{
+	struct spdk_bdev_io *bdev_io;
+	uint64_t len = num_blocks * UT_BLOCKLEN, part = len / iovcnt;
+	int i;
+
+	SPDK_CU_ASSERT_FATAL(iovcnt <= UT_MAX_IOVS);
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct rcache_bdev_io) +
+			 UT_MAX_IOVS * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &rcache->rcache_bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.iovs = (struct iovec *)((uint8_t *)bdev_io->driver_ctx +
+						sizeof(struct rcache_bdev_io));
+	for (i = 0; i < iovcnt; i++) {
+		bdev_io->u.bdev.iovs[i].iov_base = (uint8_t *)buf + i * part;
+		bdev_io->u.bdev.iovs[i].iov_len = i < iovcnt - 1 ? part : len - i * part;
+	}
+	bdev_io->u.bdev.iovcnt = iovcnt;
+
+	CU_ASSERT(spdk_io_channel_get_thread(ch) == spdk_get_thread());
+	vbdev_rcache_submit_request(ch, bdev_io);
+}
+
+static void
+ut_io(struct vbdev_rcache *rcache, struct spdk_io_channel *ch, enum spdk_bdev_io_type type,
+      void *buf, uint64_t offset_blocks, uint64_t num_blocks, int iovcnt)
+{
+	g_io_completed = 0;
+	ut_submit_iov(rcache, ch, type, buf, offset_blocks, num_blocks, iovcnt);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+/* Read the blocks through the cache and check they match the base bdev */
+static void
+ut_verify(struct vbdev_rcache *rcache, struct spdk_io_channel *ch, uint64_t offset_blocks,
+	  uint64_t num_blocks, int iovcnt)
+{
+	uint64_t len = num_blocks * UT_BLOCKLEN;
+	uint8_t *buf;
+
+	buf = calloc(1, len);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf, 0xff, len);
+	ut_io(rcache, ch, SPDK_BDEV_IO_TYPE_READ, buf, offset_blocks, num_blocks, iovcnt);
+	CU_ASSERT(memcmp(buf, g_base.data + offset_blocks * UT_BLOCKLEN, len) == 0);
+	free(buf);
+}
+
+static void
+ut_get_stats(void)
+{
+	memset(&g_stats, 0, sizeof(g_stats));
+	g_cb_called = false;
+	set_thread(0);
+	CU_ASSERT(vbdev_rcache_get_stats("rcache0", ut_stats_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+}
+
+static int
+test_setup(void)
+{
+	uint64_t i;
+	int rc;
+
+	set_thread(0);
+	rc = ut_bdev_init(&g_base, "base0", UT_BLOCKLEN, UT_BASE_BLOCKS);
+	if (rc != 0) {
+		return rc;
+	}
+
+	/* Each block holds a different pattern */
+	for (i = 0; i < UT_BASE_BLOCKS * UT_BLOCKLEN / sizeof(uint64_t); i++) {
+		((uint64_t *)g_base.data)[i] = i;
+	}
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	set_thread(0);
+	ut_bdev_fini(&g_base);
+
+	return 0;
+}
+
+static void
+test_create_delete(void)
+{
+	struct vbdev_rcache_opts opts = {
+		.name = "rcache0",
+		.base_bdev_name = g_base.bdev.name,
+	};
+	struct vbdev_rcache *rcache;
+
+	set_thread(0);
+
+	/* Line size not a power of two, too large or smaller than a block */
+	opts.line_size = UT_LINE_SIZE + 1;
+	CU_ASSERT(create_rcache_disk(&opts) == -EINVAL);
+	opts.line_size = 2 * VBDEV_RCACHE_MAX_LINE_SIZE;
+	CU_ASSERT(create_rcache_disk(&opts) == -EINVAL);
+	opts.line_size = UT_BLOCKLEN / 2;
+	CU_ASSERT(create_rcache_disk(&opts) == -EINVAL);
+	CU_ASSERT(g_registered_bdev == NULL);
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_associations));
+
+	/* Creation is deferred until the base bdev shows up */
+	opts.line_size = 0;
+	opts.base_bdev_name = "nonexistent";
+	CU_ASSERT(create_rcache_disk(&opts) == 0);
+	CU_ASSERT(g_registered_bdev == NULL);
+	CU_ASSERT(!TAILQ_EMPTY(&g_bdev_associations));
+	vbdev_rcache_finish();
+
+	rcache = ut_create(0, 0);
+	CU_ASSERT(rcache->rcache_bdev.blocklen == UT_BLOCKLEN);
+	CU_ASSERT(rcache->rcache_bdev.blockcnt == UT_BASE_BLOCKS);
+	CU_ASSERT(rcache->shard_size_mib == VBDEV_RCACHE_DEFAULT_SHARD_SIZE_MIB);
+	CU_ASSERT(rcache->line_size == VBDEV_RCACHE_DEFAULT_LINE_SIZE);
+	CU_ASSERT(1U << rcache->line_shift == UT_LINE_BLOCKS);
+	CU_ASSERT(rcache->num_lines == UT_BASE_BLOCKS / UT_LINE_BLOCKS);
+
+	/* A second rcache of the same name */
+	opts.base_bdev_name = g_base.bdev.name;
+	CU_ASSERT(create_rcache_disk(&opts) == -EEXIST);
+
+	ut_delete();
+	CU_ASSERT(TAILQ_EMPTY(&g_bdev_associations));
+	CU_ASSERT(vbdev_rcache_get_stats("rcache0", ut_stats_cb, NULL) == -ENODEV);
+
+	g_cb_called = false;
+	delete_rcache_disk("rcache0", ut_cb, NULL);
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == -ENODEV);
+}
+
+static void
+test_read_hit(void)
+{
+	struct vbdev_rcache *rcache;
+	struct spdk_io_channel *ch;
+
+	rcache = ut_create(1, UT_LINE_SIZE);
+	ch = ut_get_io_channel(rcache, 0);
+
+	/* A part of a single line is read from the base bdev once */
+	g_base.reads = 0;
+	ut_verify(rcache, ch, 3, 4, 1);
+	CU_ASSERT(g_base.reads == 1);
+	ut_verify(rcache, ch, 1, 6, 2);
+	ut_verify(rcache, ch, 0, UT_LINE_BLOCKS, 3);
+	CU_ASSERT(g_base.reads == 1);
+
+	/* Only the missing lines are read, each run of them with a single I/O */
+	ut_verify(rcache, ch, 2 * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 1);
+	CU_ASSERT(g_base.reads == 2);
+	ut_verify(rcache, ch, UT_LINE_BLOCKS - 1, 5 * UT_LINE_BLOCKS, 3);
+	CU_ASSERT(g_base.reads == 4);
+	ut_verify(rcache, ch, 0, 6 * UT_LINE_BLOCKS, 4);
+	CU_ASSERT(g_base.reads == 4);
+
+	ut_get_stats();
+	CU_ASSERT(g_stats.hits == 3);
+	CU_ASSERT(g_stats.misses == 3);
+	CU_ASSERT(g_stats.bypassed == 0);
+	CU_ASSERT(g_stats.evictions == 0);
+	CU_ASSERT(g_stats.invalidations == 0);
+
+	ut_put_io_channel(ch, 0);
+	ut_delete();
+}
+
+static void
+test_write_invalidate(void)
+{
+	enum spdk_bdev_io_type io_types[] = {
+		SPDK_BDEV_IO_TYPE_WRITE, SPDK_BDEV_IO_TYPE_WRITE_ZEROES, SPDK_BDEV_IO_TYPE_UNMAP
+	};
+	struct vbdev_rcache *rcache;
+	struct spdk_io_channel *ch0, *ch1;
+	uint8_t *buf, wbuf[UT_BLOCKLEN];
+	uint32_t i;
+
+	rcache = ut_create(1, UT_LINE_SIZE);
+	ch0 = ut_get_io_channel(rcache, 0);
+	ch1 = ut_get_io_channel(rcache, 1);
+	buf = calloc(UT_LINE_BLOCKS, UT_BLOCKLEN);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+
+	/* A write on one thread invalidates the lines cached by the others */
+	for (i = 0; i < SPDK_COUNTOF(io_types); i++) {
+		set_thread(0);
+		ut_verify(rcache, ch0, 0, 2 * UT_LINE_BLOCKS, 1);
+		set_thread(1);
+		ut_verify(rcache, ch1, 0, 2 * UT_LINE_BLOCKS, 1);
+
+		g_base.reads = 0;
+		memset(buf, 0xa5, UT_LINE_BLOCKS * UT_BLOCKLEN);
+		set_thread(0);
+		ut_io(rcache, ch0, io_types[i], buf, UT_LINE_BLOCKS + 1, 2, 1);
+		CU_ASSERT(g_base.data[(UT_LINE_BLOCKS + 1) * UT_BLOCKLEN] ==
+			  (io_types[i] == SPDK_BDEV_IO_TYPE_WRITE ? 0xa5 : 0));
+
+		/* Only the line covering the write is read again */
+		set_thread(1);
+		ut_verify(rcache, ch1, 0, 2 * UT_LINE_BLOCKS, 1);
+		CU_ASSERT(g_base.reads == 1);
+		set_thread(0);
+		ut_verify(rcache, ch0, 0, 2 * UT_LINE_BLOCKS, 1);
+		CU_ASSERT(g_base.reads == 2);
+	}
+
+	/* A write submitted while a line is being read invalidates it too */
+	g_io_completed = 0;
+	set_thread(0);
+	ut_submit_iov(rcache, ch0, SPDK_BDEV_IO_TYPE_READ, buf, 8 * UT_LINE_BLOCKS, UT_LINE_BLOCKS,
+		      1);
+	memset(wbuf, 0x5a, sizeof(wbuf));
+	set_thread(1);
+	ut_submit_iov(rcache, ch1, SPDK_BDEV_IO_TYPE_WRITE, wbuf, 8 * UT_LINE_BLOCKS + 1, 1, 1);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 2);
+	CU_ASSERT(g_base.data[(8 * UT_LINE_BLOCKS + 1) * UT_BLOCKLEN] == 0x5a);
+	g_base.reads = 0;
+	set_thread(0);
+	ut_verify(rcache, ch0, 8 * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 1);
+	CU_ASSERT(g_base.reads == 1);
+
+	ut_get_stats();
+	CU_ASSERT(g_stats.invalidations == SPDK_COUNTOF(io_types) * 2 + 1);
+
+	free(buf);
+	ut_put_io_channel(ch0, 0);
+	ut_put_io_channel(ch1, 1);
+	ut_delete();
+}
+
+static void
+test_bypass(void)
+{
+	struct vbdev_rcache *rcache;
+	struct spdk_io_channel *ch;
+	uint64_t len = (RCACHE_MAX_IO_LINES + 1) * UT_LINE_SIZE;
+	uint8_t *buf, *buf2;
+
+	rcache = ut_create(1, UT_LINE_SIZE);
+	ch = ut_get_io_channel(rcache, 0);
+	buf = calloc(1, len);
+	buf2 = calloc(1, len);
+	SPDK_CU_ASSERT_FATAL(buf != NULL && buf2 != NULL);
+
+	/* Large reads aren't cached */
+	g_base.reads = 0;
+	ut_verify(rcache, ch, 0, RCACHE_MAX_IO_LINES * UT_LINE_BLOCKS + 1, 2);
+	ut_verify(rcache, ch, 0, UT_LINE_BLOCKS, 1);
+	CU_ASSERT(g_base.reads == 2);
+
+	/* Reads of a line being filled don't wait for it */
+	g_io_completed = 0;
+	ut_submit_iov(rcache, ch, SPDK_BDEV_IO_TYPE_READ, buf, 4 * UT_LINE_BLOCKS, 2, 1);
+	ut_submit_iov(rcache, ch, SPDK_BDEV_IO_TYPE_READ, buf2, 4 * UT_LINE_BLOCKS, 3, 1);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 2);
+	CU_ASSERT(memcmp(buf, g_base.data + 4 * UT_LINE_SIZE, 2 * UT_BLOCKLEN) == 0);
+	CU_ASSERT(memcmp(buf2, g_base.data + 4 * UT_LINE_SIZE, 3 * UT_BLOCKLEN) == 0);
+	CU_ASSERT(g_base.reads == 4);
+	ut_verify(rcache, ch, 4 * UT_LINE_BLOCKS, UT_LINE_BLOCKS, 1);
+	CU_ASSERT(g_base.reads == 4);
+
+	ut_get_stats();
+	CU_ASSERT(g_stats.hits == 1);
+	CU_ASSERT(g_stats.misses == 2);
+	CU_ASSERT(g_stats.bypassed == 2);
+
+	free(buf);
+	free(buf2);
+	ut_put_io_channel(ch, 0);
+	ut_delete();
+}
+
+static void
+test_scan_resistance(void)
+{
+	uint32_t line_size = 64 * 1024, line_blocks = line_size / UT_BLOCKLEN;
+	struct vbdev_rcache *rcache;
+	struct rcache_io_channel *rch;
+	struct spdk_io_channel *ch;
+	uint64_t line;
+
+	/* A 1 MiB shard holds 16 cache lines */
+	rcache = ut_create(1, line_size);
+	ch = ut_get_io_channel(rcache, 0);
+	rch = spdk_io_channel_get_ctx(ch);
+	CU_ASSERT(rch->num_lines == 16);
+	CU_ASSERT(rch->max_small == 1);
+
+	/* Lines read more than once survive a scan of the whole bdev */
+	for (line = 0; line < 4; line++) {
+		ut_verify(rcache, ch, line * line_blocks, line_blocks, 1);
+		ut_verify(rcache, ch, line * line_blocks, line_blocks, 1);
+	}
+	for (line = 4; line < rcache->num_lines; line++) {
+		ut_verify(rcache, ch, line * line_blocks, line_blocks, 1);
+	}
+
+	g_base.reads = 0;
+	for (line = 0; line < 4; line++) {
+		ut_verify(rcache, ch, line * line_blocks, line_blocks, 1);
+		CU_ASSERT(rcache_line_lookup(rch, line)->state == RCACHE_LINE_MAIN);
+	}
+	CU_ASSERT(g_base.reads == 0);
+
+	ut_get_stats();
+	CU_ASSERT(g_stats.hits == 8);
+	CU_ASSERT(g_stats.misses == rcache->num_lines);
+	CU_ASSERT(g_stats.evictions == rcache->num_lines - rch->num_lines);
+
+	/* A line evicted from the small queue goes to the main one when read again */
+	line = rcache->num_lines - rch->num_lines;
+	CU_ASSERT(rcache_line_lookup(rch, line) == NULL);
+	ut_verify(rcache, ch, line * line_blocks, line_blocks, 1);
+	CU_ASSERT(rcache_line_lookup(rch, line)->state == RCACHE_LINE_MAIN);
+
+	ut_put_io_channel(ch, 0);
+	ut_delete();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("rcache", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_create_delete);
+	CU_ADD_TEST(suite, test_read_hit);
+	CU_ADD_TEST(suite, test_write_invalidate);
+	CU_ADD_TEST(suite, test_bypass);
+	CU_ADD_TEST(suite, test_scan_resistance);
+
+	allocate_threads(2);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+
+	free_threads();
+
+	CU_cleanup_registry();
+	return num_failures;
+}
@@ -61,6 +61,14 @@ DEFINE_STUB(spdk_lvs_esnap_missing_add, int,
 DEFINE_STUB(spdk_blob_get_esnap_bs_dev, struct spdk_bs_dev *, (const struct spdk_blob *blob), NULL);
 DEFINE_STUB(spdk_lvol_is_degraded, bool, (const struct spdk_lvol *lvol), false);
 DEFINE_STUB(spdk_blob_get_num_allocated_clusters, uint64_t, (struct spdk_blob *blob), 0);
+DEFINE_STUB(spdk_blob_get_num_contiguous_io_units, uint64_t,
+	    (struct spdk_blob *blob, uint64_t offset, uint64_t length), 0);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool,
+	    (struct spdk_bdev *bdev, enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bs_bdev_get_desc, struct spdk_bdev_desc *, (struct spdk_bs_dev *bs_dev), NULL);
+DEFINE_STUB(spdk_bs_get_dev_io_channel, struct spdk_io_channel *,
+	    (struct spdk_io_channel *channel), NULL);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
 
 struct spdk_blob {
 	uint64_t	id;
@@ -677,10 +685,87 @@ struct spdk_io_channel *spdk_lvol_get_io_channel(struct spdk_lvol *lvol)
 	return g_ch;
 }
 
+spdk_bdev_io_get_buf_cb g_get_buf_cb;
+
 void
 spdk_bdev_io_get_buf(struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb, uint64_t len)
 {
-	CU_ASSERT(cb == lvol_get_buf_cb);
+	CU_ASSERT(cb == lvol_get_buf_cb || cb == lvol_zcopy_get_buf_cb);
+	g_get_buf_cb = cb;
+}
+
+void
+spdk_bdev_io_set_buf(struct spdk_bdev_io *bdev_io, void *buf, size_t len)
+{
+	if (bdev_io->u.bdev.iovs == NULL) {
+		bdev_io->u.bdev.iovs = &bdev_io->iov;
+		bdev_io->u.bdev.iovcnt = 1;
+	}
+
+	bdev_io->u.bdev.iovs[0].iov_base = buf;
+	bdev_io->u.bdev.iovs[0].iov_len = len;
+}
+
+int g_blob_dev_lba_rc;
+uint64_t g_zcopy_lba;
+bool g_zcopy_commit;
+struct spdk_bdev_io *g_zcopy_base_io;
+char g_zcopy_buf[4096];
+
+int g_blob_dev_lba_refs;
+
+int
+spdk_blob_get_dev_lba(struct spdk_blob *blob, uint64_t offset, uint64_t length, uint64_t *lba)
+{
+	*lba = offset + 100;
+	if (g_blob_dev_lba_rc == 0) {
+		g_blob_dev_lba_refs++;
+	}
+	return g_blob_dev_lba_rc;
+}
+
+void
+spdk_blob_release_dev_lba(struct spdk_blob *blob)
+{
+	CU_ASSERT(g_blob_dev_lba_refs > 0);
+	g_blob_dev_lba_refs--;
+}
+
+DEFINE_RETURN_MOCK(spdk_bdev_zcopy_start, int);
+int
+spdk_bdev_zcopy_start(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		      struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks,
+		      bool populate, spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	struct spdk_bdev_io *base_io;
+
+	HANDLE_RETURN_MOCK(spdk_bdev_zcopy_start);
+
+	base_io = calloc(1, sizeof(*base_io));
+	SPDK_CU_ASSERT_FATAL(base_io != NULL);
+	base_io->u.bdev.iovs = &base_io->iov;
+	base_io->u.bdev.iovcnt = 1;
+	base_io->iov.iov_base = g_zcopy_buf;
+	base_io->iov.iov_len = sizeof(g_zcopy_buf);
+
+	g_zcopy_lba = offset_blocks;
+	g_zcopy_base_io = base_io;
+	cb(base_io, true, cb_arg);
+
+	return 0;
+}
+
+int
+spdk_bdev_zcopy_end(struct spdk_bdev_io *bdev_io, bool commit,
+		    spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	CU_ASSERT(bdev_io == g_zcopy_base_io);
+	g_zcopy_commit = commit;
+	cb(bdev_io, true, cb_arg);
+	free(bdev_io);
+	g_zcopy_base_io = NULL;
+
+	return 0;
 }
 
 void
@@ -1763,6 +1848,106 @@ ut_lvol_read_write(void)
 	free(g_lvol);
 }
 
+static void
+ut_lvol_zcopy(void)
+{
+	struct spdk_lvol_store lvs = {};
+	struct ut_bs_dev ut_bs_dev = {};
+	struct spdk_bdev lvol_bdev = {};
+	struct spdk_bdev base_bdev = {};
+
+	g_io = calloc(1, sizeof(struct spdk_bdev_io) + vbdev_lvs_get_ctx_size());
+	SPDK_CU_ASSERT_FATAL(g_io != NULL);
+	g_lvol = calloc(1, sizeof(struct spdk_lvol));
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+
+	ut_bs_dev.bdev = &base_bdev;
+	ut_bs_dev.bs_dev.get_base_bdev = ut_bs_dev_get_base_bdev;
+	lvs.bs_dev = &ut_bs_dev.bs_dev;
+	g_lvol->lvol_store = &lvs;
+	g_lvol->bdev = &lvol_bdev;
+	base_bdev.blocklen = 512;
+	lvol_bdev.blocklen = 512;
+	g_blob_is_read_only = false;
+
+	/* Zero-copy is only supported if the lvolstore's bdev supports it */
+	CU_ASSERT(vbdev_lvol_io_type_supported(g_lvol, SPDK_BDEV_IO_TYPE_ZCOPY) == true);
+	MOCK_SET(spdk_bdev_io_type_supported, false);
+	CU_ASSERT(vbdev_lvol_io_type_supported(g_lvol, SPDK_BDEV_IO_TYPE_ZCOPY) == false);
+	MOCK_CLEAR(spdk_bdev_io_type_supported);
+	base_bdev.blocklen = 4096;
+	CU_ASSERT(vbdev_lvol_io_type_supported(g_lvol, SPDK_BDEV_IO_TYPE_ZCOPY) == false);
+	base_bdev.blocklen = 512;
+
+	g_io->bdev = &g_bdev;
+	g_io->bdev->ctxt = g_lvol;
+	g_io->type = SPDK_BDEV_IO_TYPE_ZCOPY;
+	g_io->u.bdev.offset_blocks = 20;
+	g_io->u.bdev.num_blocks = 8;
+
+	/* Allocated range - passed through with a translated LBA */
+	g_blob_dev_lba_rc = 0;
+	g_io->u.bdev.zcopy.start = 1;
+	g_io->u.bdev.zcopy.populate = 0;
+	vbdev_lvol_submit_request(g_ch, g_io);
+	CU_ASSERT(g_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_zcopy_lba == 120);
+	SPDK_CU_ASSERT_FATAL(g_zcopy_base_io != NULL);
+	CU_ASSERT(g_io->u.bdev.iovcnt == 1);
+	CU_ASSERT(g_io->u.bdev.iovs[0].iov_base == g_zcopy_buf);
+	CU_ASSERT(g_blob_dev_lba_refs == 1);
+
+	g_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_io->u.bdev.zcopy.start = 0;
+	g_io->u.bdev.zcopy.commit = 1;
+	vbdev_lvol_submit_request(g_ch, g_io);
+	CU_ASSERT(g_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(g_zcopy_commit == true);
+	CU_ASSERT(g_zcopy_base_io == NULL);
+	CU_ASSERT(g_blob_dev_lba_refs == 0);
+
+	/* Base bdev out of bdev_ios - retried by the bdev layer */
+	g_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_io->u.bdev.iovs = NULL;
+	g_io->u.bdev.zcopy.start = 1;
+	MOCK_SET(spdk_bdev_zcopy_start, -ENOMEM);
+	vbdev_lvol_submit_request(g_ch, g_io);
+	CU_ASSERT(g_io->internal.status == SPDK_BDEV_IO_STATUS_NOMEM);
+	CU_ASSERT(g_blob_dev_lba_refs == 0);
+	MOCK_CLEAR(spdk_bdev_zcopy_start);
+
+	/* Unallocated range - copied through a buffer from the bdev layer */
+	g_blob_dev_lba_rc = -ENODATA;
+	g_get_buf_cb = NULL;
+	g_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_io->u.bdev.zcopy.populate = 1;
+	vbdev_lvol_submit_request(g_ch, g_io);
+	CU_ASSERT(g_io->internal.status == SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT(g_get_buf_cb == lvol_zcopy_get_buf_cb);
+	lvol_zcopy_get_buf_cb(g_ch, g_io, true);
+	CU_ASSERT(g_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	g_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_io->u.bdev.zcopy.start = 0;
+	g_io->u.bdev.zcopy.commit = 0;
+	vbdev_lvol_submit_request(g_ch, g_io);
+	CU_ASSERT(g_io->internal.status == SPDK_BDEV_IO_STATUS_SUCCESS);
+
+	/* Zero-copy writes to a read-only lvol fail */
+	g_blob_is_read_only = true;
+	g_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+	g_io->u.bdev.zcopy.start = 1;
+	g_io->u.bdev.zcopy.populate = 0;
+	vbdev_lvol_submit_request(g_ch, g_io);
+	CU_ASSERT(g_io->internal.status == SPDK_BDEV_IO_STATUS_FAILED);
+	g_blob_is_read_only = false;
+
+	g_blob_dev_lba_rc = 0;
+	g_bdev.ctxt = NULL;
+	free(g_io);
+	free(g_lvol);
+}
+
 static void
 ut_vbdev_lvol_submit_request(void)
 {
@@ -2096,6 +2281,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, ut_vbdev_lvol_get_io_channel);
 	CU_ADD_TEST(suite, ut_vbdev_lvol_io_type_supported);
 	CU_ADD_TEST(suite, ut_lvol_read_write);
+	CU_ADD_TEST(suite, ut_lvol_zcopy);
 	CU_ADD_TEST(suite, ut_vbdev_lvol_submit_request);
 	CU_ADD_TEST(suite, ut_lvol_examine_config);
 	CU_ADD_TEST(suite, ut_lvol_examine_disk);
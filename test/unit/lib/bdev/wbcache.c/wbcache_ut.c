@@ -0,0 +1,665 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk_internal/cunit.h"
+
+#include "common/lib/ut_multithread.c"
+#include "spdk_internal/mock.h"
+#include "unit/lib/json_mock.c"
+#include "common/lib/bdev/ut_bdev.c"
+
+#include "bdev/wbcache/vbdev_wbcache.c"
+
+#define UT_BLOCKLEN		512
+#define UT_BASE_BLOCKS		(8ULL * 1024 * 1024 / UT_BLOCKLEN)
+/* Superblock area of 4KiB and a log of 1024 blocks */
+#define UT_LOG_OFFSET		(WBCACHE_BUF_ALIGN / UT_BLOCKLEN)
+#define UT_LOG_BLOCKS		1024
+#define UT_CACHE_BLOCKS		(UT_LOG_OFFSET + UT_LOG_BLOCKS)
+#define UT_MAX_IOVS		4
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB_V(spdk_bdev_module_release_bdev, (struct spdk_bdev *bdev));
+DEFINE_STUB(spdk_bdev_module_claim_bdev, int, (struct spdk_bdev *bdev, struct spdk_bdev_desc *desc,
+		struct spdk_bdev_module *module), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), true);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+
+static struct ut_bdev g_base;
+static struct ut_bdev g_cache;
+static uint32_t g_examine_done;
+
+void
+spdk_bdev_module_examine_done(struct spdk_bdev_module *module)
+{
+	g_examine_done++;
+}
+
+static struct vbdev_wbcache *
+ut_create(uint32_t high_watermark, uint32_t low_watermark)
+{
+	struct vbdev_wbcache_opts opts = {
+		.name = "wbcache0",
+		.base_bdev_name = g_base.bdev.name,
+		.cache_bdev_name = g_cache.bdev.name,
+		.high_watermark = high_watermark,
+		.low_watermark = low_watermark,
+	};
+
+	g_cb_called = false;
+	CU_ASSERT(create_wbcache_disk(&opts, ut_cb, NULL) == 0);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	SPDK_CU_ASSERT_FATAL(g_registered_bdev != NULL);
+
+	return g_registered_bdev->ctxt;
+}
+
+static struct vbdev_wbcache *
+ut_examine(struct spdk_bdev *bdev)
+{
+	g_examine_done = 0;
+	vbdev_wbcache_examine(bdev);
+	poll_threads();
+	CU_ASSERT(g_examine_done == 1);
+
+	return g_registered_bdev != NULL ? g_registered_bdev->ctxt : NULL;
+}
+
+/* Unregister the vbdev without destroying the cache */
+static void
+ut_unregister(struct vbdev_wbcache *wbc)
+{
+	g_registered_bdev = NULL;
+	CU_ASSERT(vbdev_wbcache_destruct(wbc) == 1);
+	poll_threads();
+}
+
+static void
+ut_delete(void)
+{
+	g_cb_called = false;
+	delete_wbcache_disk("wbcache0", ut_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	CU_ASSERT(g_registered_bdev == NULL);
+}
+
+static void
+ut_submit(struct vbdev_wbcache *wbc, enum spdk_bdev_io_type type, void *buf,
+	  uint64_t offset_blocks, uint64_t num_blocks, int iovcnt)
+{
+	struct spdk_bdev_io *bdev_io;
+	uint64_t len = num_blocks * UT_BLOCKLEN, part = len / iovcnt;
+	int i;
+
+	SPDK_CU_ASSERT_FATAL(iovcnt <= UT_MAX_IOVS);
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct wbcache_bdev_io) +
+			 UT_MAX_IOVS * sizeof(struct iovec));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->bdev = &wbc->wbc_bdev;
+	bdev_io->type = type;
+	bdev_io->u.bdev.offset_blocks = offset_blocks;
+	bdev_io->u.bdev.num_blocks = num_blocks;
+	bdev_io->u.bdev.iovs = (struct iovec *)((uint8_t *)bdev_io->driver_ctx +
+						sizeof(struct wbcache_bdev_io));
+	for (i = 0; i < iovcnt; i++) {
+		bdev_io->u.bdev.iovs[i].iov_base = (uint8_t *)buf + i * part;
+		bdev_io->u.bdev.iovs[i].iov_len = i < iovcnt - 1 ? part : len - i * part;
+	}
+	bdev_io->u.bdev.iovcnt = iovcnt;
+
+	vbdev_wbcache_submit_request(NULL, bdev_io);
+}
+
+static void
+ut_io(struct vbdev_wbcache *wbc, enum spdk_bdev_io_type type, void *buf,
+      uint64_t offset_blocks, uint64_t num_blocks, int iovcnt)
+{
+	g_io_completed = 0;
+	ut_submit(wbc, type, buf, offset_blocks, num_blocks, iovcnt);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 1);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+}
+
+static void
+ut_fill(void *buf, uint64_t num_blocks, uint8_t seed)
+{
+	memset(buf, seed, num_blocks * UT_BLOCKLEN);
+}
+
+static void
+ut_write(struct vbdev_wbcache *wbc, uint64_t offset_blocks, uint64_t num_blocks, uint8_t seed)
+{
+	uint8_t *buf = calloc(num_blocks, UT_BLOCKLEN);
+
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	ut_fill(buf, num_blocks, seed);
+	ut_io(wbc, SPDK_BDEV_IO_TYPE_WRITE, buf, offset_blocks, num_blocks,
+	      num_blocks % 2 == 0 ? 2 : 1);
+	free(buf);
+}
+
+/* Check that each block of the range is filled with the seed */
+static bool
+ut_check(const uint8_t *data, uint64_t num_blocks, uint8_t seed)
+{
+	uint64_t i;
+
+	for (i = 0; i < num_blocks * UT_BLOCKLEN; i++) {
+		if (data[i] != seed) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool
+ut_read_check(struct vbdev_wbcache *wbc, uint64_t offset_blocks, uint64_t num_blocks,
+	      uint8_t seed)
+{
+	uint8_t *buf = calloc(num_blocks, UT_BLOCKLEN);
+	bool rc;
+
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	ut_io(wbc, SPDK_BDEV_IO_TYPE_READ, buf, offset_blocks, num_blocks, 1);
+	rc = ut_check(buf, num_blocks, seed);
+	free(buf);
+
+	return rc;
+}
+
+static void
+ut_drain_cb(struct vbdev_wbcache *wbc, int status)
+{
+	g_cb_called = true;
+	g_cb_status = status;
+}
+
+/* Destage all the records in the log */
+static void
+ut_destage_all(struct vbdev_wbcache *wbc)
+{
+	g_cb_called = false;
+	wbcache_drain(wbc, true, ut_drain_cb);
+	poll_threads();
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == 0);
+	CU_ASSERT(wbc->rec_count == 0);
+	CU_ASSERT(wbc->dirty_blocks == 0);
+}
+
+static int
+test_setup(void)
+{
+	int rc;
+
+	set_thread(0);
+	rc = ut_bdev_init(&g_base, "base0", UT_BLOCKLEN, UT_BASE_BLOCKS);
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = ut_bdev_init(&g_cache, "cache0", UT_BLOCKLEN, UT_CACHE_BLOCKS);
+	if (rc != 0) {
+		ut_bdev_fini(&g_base);
+		return rc;
+	}
+
+	/* I/O to the backing bdev is limited to WBCACHE_DESTAGE_IOVS iovs */
+	g_base.max_iovcnt = WBCACHE_DESTAGE_IOVS;
+
+	return 0;
+}
+
+static int
+test_cleanup(void)
+{
+	set_thread(0);
+	ut_bdev_fini(&g_cache);
+	ut_bdev_fini(&g_base);
+
+	return 0;
+}
+
+static void
+ut_reset_data(void)
+{
+	ut_bdev_reset(&g_base);
+	ut_bdev_reset(&g_cache);
+}
+
+static void
+test_create_delete(void)
+{
+	struct vbdev_wbcache_opts opts = {
+		.name = "wbcache0",
+		.base_bdev_name = g_base.bdev.name,
+		.cache_bdev_name = g_cache.bdev.name,
+	};
+	struct vbdev_wbcache_sb *sb = (struct vbdev_wbcache_sb *)g_cache.data;
+	struct vbdev_wbcache *wbc;
+
+	set_thread(0);
+	ut_reset_data();
+
+	/* Watermarks out of order or out of range, then a missing cache bdev */
+	opts.high_watermark = 30;
+	opts.low_watermark = 30;
+	CU_ASSERT(create_wbcache_disk(&opts, ut_cb, NULL) == -EINVAL);
+	opts.high_watermark = 101;
+	opts.low_watermark = 10;
+	CU_ASSERT(create_wbcache_disk(&opts, ut_cb, NULL) == -EINVAL);
+	opts.high_watermark = 0;
+	opts.low_watermark = 0;
+	opts.cache_bdev_name = "nonexistent";
+	CU_ASSERT(create_wbcache_disk(&opts, ut_cb, NULL) == -ENODEV);
+	opts.cache_bdev_name = g_cache.bdev.name;
+
+	/* The block sizes of both bdevs must match */
+	g_base.bdev.blocklen = 4096;
+	CU_ASSERT(create_wbcache_disk(&opts, ut_cb, NULL) == -EINVAL);
+	g_base.bdev.blocklen = UT_BLOCKLEN;
+
+	wbc = ut_create(0, 0);
+	CU_ASSERT(wbc->wbc_bdev.blockcnt == UT_BASE_BLOCKS);
+	CU_ASSERT(wbc->wbc_bdev.max_rw_size == WBCACHE_MAX_IO_BLOCKS);
+	CU_ASSERT(sb->high_watermark == VBDEV_WBCACHE_DEFAULT_HIGH_WATERMARK);
+	CU_ASSERT(sb->low_watermark == VBDEV_WBCACHE_DEFAULT_LOW_WATERMARK);
+	CU_ASSERT(sb->log_offset == UT_LOG_OFFSET);
+	CU_ASSERT(sb->log_blocks == UT_LOG_BLOCKS);
+	CU_ASSERT(sb->crc == wbcache_sb_crc(sb));
+	CU_ASSERT(spdk_uuid_compare(&sb->base_uuid, &g_base.bdev.uuid) == 0);
+	CU_ASSERT(!vbdev_wbcache_io_type_supported(wbc, SPDK_BDEV_IO_TYPE_UNMAP));
+	CU_ASSERT(!vbdev_wbcache_io_type_supported(wbc, SPDK_BDEV_IO_TYPE_WRITE_ZEROES));
+
+	/* The name is taken */
+	CU_ASSERT(create_wbcache_disk(&opts, ut_cb, NULL) == -EEXIST);
+
+	/* Delete wipes the superblock so the cache isn't found on examine */
+	ut_delete();
+	CU_ASSERT(spdk_mem_all_zero(sb, sizeof(*sb)));
+	CU_ASSERT(ut_examine(&g_cache.bdev) == NULL);
+
+	g_cb_called = false;
+	delete_wbcache_disk("wbcache0", ut_cb, NULL);
+	CU_ASSERT(g_cb_called);
+	CU_ASSERT(g_cb_status == -ENODEV);
+}
+
+static void
+test_write_read(void)
+{
+	struct vbdev_wbcache *wbc;
+	uint8_t *buf;
+
+	set_thread(0);
+	ut_reset_data();
+	wbc = ut_create(0, 0);
+
+	/* Writes only go to the log */
+	ut_write(wbc, 16, 8, 0xa5);
+	ut_write(wbc, 32, 4, 0x5a);
+	CU_ASSERT(g_base.writes == 0);
+	CU_ASSERT(ut_check(g_base.data + 16 * UT_BLOCKLEN, 8, 0));
+	CU_ASSERT(wbc->dirty_blocks == 12);
+	CU_ASSERT(wbcache_log_used(wbc) == 9 + 5);
+
+	/* Both records are found in the log */
+	g_base.reads = 0;
+	g_cache.reads = 0;
+	CU_ASSERT(ut_read_check(wbc, 16, 8, 0xa5));
+	CU_ASSERT(ut_read_check(wbc, 32, 4, 0x5a));
+	CU_ASSERT(g_base.reads == 0);
+	CU_ASSERT(g_cache.reads == 2);
+
+	/* A read spanning logged and unlogged blocks reads each run from where it is */
+	buf = calloc(32, UT_BLOCKLEN);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	g_cache.reads = 0;
+	ut_io(wbc, SPDK_BDEV_IO_TYPE_READ, buf, 8, 32, 1);
+	CU_ASSERT(ut_check(buf, 8, 0));
+	CU_ASSERT(ut_check(buf + 8 * UT_BLOCKLEN, 8, 0xa5));
+	CU_ASSERT(ut_check(buf + 16 * UT_BLOCKLEN, 8, 0));
+	CU_ASSERT(ut_check(buf + 24 * UT_BLOCKLEN, 4, 0x5a));
+	CU_ASSERT(ut_check(buf + 28 * UT_BLOCKLEN, 4, 0));
+	CU_ASSERT(g_base.reads == 3);
+	CU_ASSERT(g_cache.reads == 2);
+	free(buf);
+
+	/* The latest write of a block is returned */
+	ut_write(wbc, 20, 2, 0x11);
+	CU_ASSERT(wbc->dirty_blocks == 12);
+	CU_ASSERT(ut_read_check(wbc, 16, 4, 0xa5));
+	CU_ASSERT(ut_read_check(wbc, 20, 2, 0x11));
+	CU_ASSERT(ut_read_check(wbc, 22, 2, 0xa5));
+
+	/* Flush goes to the cache bdev */
+	g_base.flushes = 0;
+	ut_io(wbc, SPDK_BDEV_IO_TYPE_FLUSH, NULL, 0, 0, 1);
+	CU_ASSERT(g_base.flushes == 0);
+
+	/* Delete destages everything to the backing bdev */
+	ut_delete();
+	CU_ASSERT(ut_check(g_base.data + 16 * UT_BLOCKLEN, 4, 0xa5));
+	CU_ASSERT(ut_check(g_base.data + 20 * UT_BLOCKLEN, 2, 0x11));
+	CU_ASSERT(ut_check(g_base.data + 22 * UT_BLOCKLEN, 2, 0xa5));
+	CU_ASSERT(ut_check(g_base.data + 32 * UT_BLOCKLEN, 4, 0x5a));
+	CU_ASSERT(g_base.flushes > 0);
+}
+
+static void
+test_destage(void)
+{
+	struct vbdev_wbcache_sb *sb = (struct vbdev_wbcache_sb *)g_cache.data;
+	struct vbdev_wbcache *wbc;
+	uint64_t lba, seq;
+	uint32_t i;
+
+	set_thread(0);
+	ut_reset_data();
+	wbc = ut_create(20, 5);
+
+	/* Block 150 is overwritten before it's destaged */
+	ut_write(wbc, 150, 1, 0xff);
+	for (lba = 199; lba >= 100; lba--) {
+		ut_write(wbc, lba, 1, (uint8_t)lba);
+	}
+	CU_ASSERT(wbcache_log_used(wbc) == 202);
+	CU_ASSERT(g_base.writes == 0);
+	seq = wbc->next_seq;
+
+	/* Going over the high watermark destages everything below the low one */
+	ut_write(wbc, 1000, 8, 0x77);
+	CU_ASSERT(wbc->destaged_blocks == 108);
+	CU_ASSERT(wbc->dirty_blocks == 0);
+	CU_ASSERT(wbc->rec_count == 0);
+	CU_ASSERT(wbcache_log_used(wbc) == 0);
+	CU_ASSERT(!wbc->cleaning);
+	CU_ASSERT(g_base.flushes == 1);
+	CU_ASSERT(sb->head == 211);
+	CU_ASSERT(sb->head_seq == seq + 1);
+	CU_ASSERT(sb->crc == wbcache_sb_crc(sb));
+
+	/* Blocks are written in LBA order, consecutive ones merged up to the iovec limit */
+	CU_ASSERT(g_base.writes == 5);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(g_base.write_offsets[i] == 100 + i * WBCACHE_DESTAGE_IOVS);
+	}
+	CU_ASSERT(g_base.write_offsets[4] == 1000);
+	for (lba = 100; lba < 200; lba++) {
+		CU_ASSERT(ut_check(g_base.data + lba * UT_BLOCKLEN, 1, (uint8_t)lba));
+	}
+	CU_ASSERT(ut_check(g_base.data + 1000 * UT_BLOCKLEN, 8, 0x77));
+
+	/* Reads now go to the backing bdev */
+	g_cache.reads = 0;
+	CU_ASSERT(ut_read_check(wbc, 150, 1, 150));
+	CU_ASSERT(ut_read_check(wbc, 1000, 8, 0x77));
+	CU_ASSERT(g_cache.reads == 0);
+
+	ut_delete();
+}
+
+static void
+test_log_full(void)
+{
+	struct vbdev_wbcache *wbc;
+	uint32_t i;
+
+	set_thread(0);
+	ut_reset_data();
+	wbc = ut_create(100, 99);
+
+	/* Fill up the log, the write that doesn't fit waits for the log to be destaged */
+	for (i = 0; i < UT_LOG_BLOCKS / 9; i++) {
+		ut_write(wbc, i * 8, 8, (uint8_t)i);
+	}
+	CU_ASSERT(g_base.writes == 0);
+	CU_ASSERT(wbc->log_tail == UT_LOG_BLOCKS / 9 * 9);
+
+	ut_write(wbc, 4096, 8, 0xee);
+	CU_ASSERT(g_base.writes > 0);
+	CU_ASSERT(wbc->rec_count == 1);
+	CU_ASSERT(wbcache_record(wbc, 0)->offset == 0);
+	CU_ASSERT(wbc->log_head == 0);
+	CU_ASSERT(wbc->log_tail == 9);
+	for (i = 0; i < UT_LOG_BLOCKS / 9; i++) {
+		CU_ASSERT(ut_check(g_base.data + i * 8 * UT_BLOCKLEN, 8, (uint8_t)i));
+	}
+	CU_ASSERT(ut_read_check(wbc, 4096, 8, 0xee));
+
+	ut_delete();
+}
+
+static void
+test_recovery(void)
+{
+	struct vbdev_wbcache_sb *sb = (struct vbdev_wbcache_sb *)g_cache.data;
+	struct vbdev_wbcache *wbc;
+	uint64_t seq;
+	uint32_t i;
+
+	set_thread(0);
+	ut_reset_data();
+	wbc = ut_create(100, 99);
+
+	/* Leave records at the end of the log and at its start */
+	for (i = 0; i < 60; i++) {
+		ut_write(wbc, 2048 + i * 8, 8, 0x33);
+	}
+	ut_destage_all(wbc);
+	CU_ASSERT(sb->head == 540);
+	g_base.writes = 0;
+	for (i = 0; i < 60; i++) {
+		ut_write(wbc, i * 8, 8, (uint8_t)(i + 1));
+	}
+	CU_ASSERT(wbc->log_tail == 7 * 9);
+	seq = wbc->next_seq;
+	ut_unregister(wbc);
+	CU_ASSERT(g_base.writes == 0);
+	CU_ASSERT(sb->head == 540);
+
+	/* The log is replayed and destaged before the vbdev is registered */
+	wbc = ut_examine(&g_cache.bdev);
+	SPDK_CU_ASSERT_FATAL(wbc != NULL);
+	CU_ASSERT(wbc->rec_count == 0);
+	CU_ASSERT(wbc->destaged_blocks == 60 * 8);
+	CU_ASSERT(wbc->next_seq == seq + UT_LOG_BLOCKS);
+	CU_ASSERT(sb->head == 7 * 9);
+	CU_ASSERT(sb->head_seq == wbc->next_seq);
+	for (i = 0; i < 60; i++) {
+		CU_ASSERT(ut_check(g_base.data + i * 8 * UT_BLOCKLEN, 8, (uint8_t)(i + 1)));
+		CU_ASSERT(ut_read_check(wbc, i * 8, 8, (uint8_t)(i + 1)));
+	}
+
+	/* Nothing to replay the next time */
+	ut_write(wbc, 0, 8, 0x44);
+	ut_unregister(wbc);
+	g_base.writes = 0;
+	wbc = ut_examine(&g_cache.bdev);
+	SPDK_CU_ASSERT_FATAL(wbc != NULL);
+	CU_ASSERT(g_base.writes == 1);
+	CU_ASSERT(ut_read_check(wbc, 0, 8, 0x44));
+	CU_ASSERT(ut_read_check(wbc, 8, 8, 2));
+
+	ut_delete();
+}
+
+static void
+test_torn_record(void)
+{
+	struct vbdev_wbcache *wbc;
+	uint64_t pos;
+
+	set_thread(0);
+	ut_reset_data();
+	wbc = ut_create(0, 0);
+
+	ut_write(wbc, 0, 8, 0x01);
+	ut_write(wbc, 8, 8, 0x02);
+	pos = wbcache_record(wbc, 1)->offset;
+	ut_write(wbc, 16, 8, 0x03);
+	ut_unregister(wbc);
+
+	/* The second record was only partially written, the ones after it are lost too */
+	g_cache.data[(UT_LOG_OFFSET + pos + 4) * UT_BLOCKLEN] ^= 0xff;
+	wbc = ut_examine(&g_cache.bdev);
+	SPDK_CU_ASSERT_FATAL(wbc != NULL);
+	CU_ASSERT(wbc->destaged_blocks == 8);
+	CU_ASSERT(ut_read_check(wbc, 0, 8, 0x01));
+	CU_ASSERT(ut_read_check(wbc, 8, 16, 0));
+
+	/* New records don't pick up the ones left after the torn one */
+	ut_write(wbc, 32, 8, 0x04);
+	CU_ASSERT(wbcache_record(wbc, 0)->offset == pos);
+	ut_unregister(wbc);
+	wbc = ut_examine(&g_cache.bdev);
+	SPDK_CU_ASSERT_FATAL(wbc != NULL);
+	CU_ASSERT(ut_read_check(wbc, 32, 8, 0x04));
+	CU_ASSERT(ut_read_check(wbc, 8, 16, 0));
+
+	ut_delete();
+}
+
+static void
+test_write_order(void)
+{
+	struct vbdev_wbcache *wbc;
+	uint8_t *bufs[4];
+	uint32_t i;
+
+	set_thread(0);
+	ut_reset_data();
+	wbc = ut_create(100, 99);
+
+	g_cache.hold_writes = true;
+	g_cache.num_held_writes = 0;
+	g_io_completed = 0;
+	for (i = 0; i < 4; i++) {
+		bufs[i] = calloc(8, UT_BLOCKLEN);
+		SPDK_CU_ASSERT_FATAL(bufs[i] != NULL);
+		ut_fill(bufs[i], 8, (uint8_t)(i + 1));
+	}
+	ut_submit(wbc, SPDK_BDEV_IO_TYPE_WRITE, bufs[0], 0, 8, 1);
+	ut_submit(wbc, SPDK_BDEV_IO_TYPE_WRITE, bufs[1], 8, 8, 1);
+	poll_threads();
+	CU_ASSERT(g_cache.num_held_writes == 2);
+
+	/* The second write is only completed once the first record is in the log too */
+	ut_bdev_release_write(&g_cache, 1, true);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 0);
+	ut_bdev_release_write(&g_cache, 0, true);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 2);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(wbc->rec_acked == 2);
+
+	/* A write after a failed record waits for destage to move the head past it */
+	ut_submit(wbc, SPDK_BDEV_IO_TYPE_WRITE, bufs[2], 16, 8, 1);
+	ut_submit(wbc, SPDK_BDEV_IO_TYPE_WRITE, bufs[3], 24, 8, 1);
+	poll_threads();
+	CU_ASSERT(g_cache.num_held_writes == 4);
+	ut_bdev_release_write(&g_cache, 3, true);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 2);
+	ut_bdev_release_write(&g_cache, 2, false);
+	poll_thread_times(0, 1);
+	CU_ASSERT(g_io_completed == 3);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_FAILED);
+	CU_ASSERT(wbc->cleaning);
+	CU_ASSERT(g_base.writes == 0);
+	poll_threads();
+	CU_ASSERT(g_io_completed == 4);
+	CU_ASSERT(g_io_status == SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT(wbc->rec_count == 0);
+	CU_ASSERT(wbc->rec_acked == 0);
+	CU_ASSERT(ut_check(g_base.data + 8 * UT_BLOCKLEN, 8, 0x02));
+	CU_ASSERT(ut_check(g_base.data + 16 * UT_BLOCKLEN, 8, 0));
+	CU_ASSERT(ut_check(g_base.data + 24 * UT_BLOCKLEN, 8, 0x04));
+	g_cache.hold_writes = false;
+
+	/* Writes to a log with nothing held are completed right away again */
+	ut_write(wbc, 32, 8, 0x05);
+	CU_ASSERT(wbc->rec_acked == 1);
+	CU_ASSERT(ut_read_check(wbc, 0, 8, 0x01));
+	CU_ASSERT(ut_read_check(wbc, 8, 8, 0x02));
+	CU_ASSERT(ut_read_check(wbc, 16, 8, 0));
+	CU_ASSERT(ut_read_check(wbc, 24, 8, 0x04));
+
+	for (i = 0; i < 4; i++) {
+		free(bufs[i]);
+	}
+	ut_delete();
+}
+
+static void
+test_examine_pending(void)
+{
+	struct vbdev_wbcache *wbc;
+
+	set_thread(0);
+	ut_reset_data();
+	wbc = ut_create(0, 0);
+	ut_write(wbc, 64, 8, 0x55);
+	ut_unregister(wbc);
+
+	/* The cache waits for its backing bdev */
+	g_base.removed = true;
+	CU_ASSERT(ut_examine(&g_cache.bdev) == NULL);
+	CU_ASSERT(!TAILQ_EMPTY(&g_wbcache_pending));
+	g_base.removed = false;
+
+	/* An unrelated bdev is examined as a cache and ignored */
+	g_cache.data[0] ^= 0xff;
+	CU_ASSERT(ut_examine(&g_cache.bdev) == NULL);
+	g_cache.data[0] ^= 0xff;
+
+	wbc = ut_examine(&g_base.bdev);
+	SPDK_CU_ASSERT_FATAL(wbc != NULL);
+	CU_ASSERT(TAILQ_EMPTY(&g_wbcache_pending));
+	CU_ASSERT(ut_check(g_base.data + 64 * UT_BLOCKLEN, 8, 0x55));
+	CU_ASSERT(ut_read_check(wbc, 64, 8, 0x55));
+
+	ut_delete();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("wbcache", test_setup, test_cleanup);
+	CU_ADD_TEST(suite, test_create_delete);
+	CU_ADD_TEST(suite, test_write_read);
+	CU_ADD_TEST(suite, test_destage);
+	CU_ADD_TEST(suite, test_log_full);
+	CU_ADD_TEST(suite, test_recovery);
+	CU_ADD_TEST(suite, test_torn_record);
+	CU_ADD_TEST(suite, test_write_order);
+	CU_ADD_TEST(suite, test_examine_pending);
+
+	allocate_threads(1);
+	set_thread(0);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+
+	free_threads();
+
+	CU_cleanup_registry();
+	return num_failures;
+}
@@ -1686,6 +1686,7 @@ blob_rw_verify_iov_nomem(void)
 	uint8_t payload_write[10 * BLOCKLEN];
 	struct iovec iov_write[3];
 	uint32_t req_count;
+	uint64_t cluster_lba;
 
 	channel = spdk_bs_alloc_io_channel(bs);
 	CU_ASSERT(channel != NULL);
@@ -1694,6 +1695,13 @@ blob_rw_verify_iov_nomem(void)
 	poll_threads();
 	CU_ASSERT(g_bserrno == 0);
 
+	/*
+	 * Move the second cluster away from the first one, so the I/O crossing the cluster
+	 *  boundary can't be submitted as a single I/O and needs to be split.
+	 */
+	cluster_lba = blob->active.clusters[1];
+	blob->active.clusters[1] += bs_cluster_to_lba(bs, 1);
+
 	/*
 	 * Choose a page offset just before the cluster boundary.  The first 6 pages of payload
 	 *  will get written to the first cluster, the last 4 to the second cluster.
@@ -1712,6 +1720,8 @@ blob_rw_verify_iov_nomem(void)
 	CU_ASSERT(req_count == bs_channel_get_req_count(channel));
 	MOCK_CLEAR(calloc);
 
+	blob->active.clusters[1] = cluster_lba;
+
 	spdk_bs_free_io_channel(channel);
 	poll_threads();
 }
@@ -4678,6 +4688,326 @@ blob_thin_prov_rw(void)
 	g_blobid = 0;
 }
 
+static void
+blob_thin_prov_reserved_clusters(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *ch;
+	struct spdk_bs_channel *bs_ch;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	uint64_t free_clusters;
+	uint8_t payload_write[BLOCKLEN];
+	const uint32_t CLUSTER_SZ = g_phys_blocklen * 4;
+	const uint32_t num_writes = SPDK_BS_CHANNEL_RESERVED_CLUSTERS + 1;
+	uint32_t io_units_per_cluster;
+	uint32_t i;
+
+	/* Use a small cluster size, so that there are enough free clusters to reserve them
+	 * in batches.
+	 */
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = CLUSTER_SZ;
+
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+	SPDK_CU_ASSERT_FATAL(spdk_bs_free_cluster_count(bs) >= 8 * SPDK_BS_CHANNEL_RESERVED_CLUSTERS);
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	io_units_per_cluster = CLUSTER_SZ / spdk_bs_get_io_unit_size(bs);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = num_writes;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	/* Allocate from a channel on another thread than the md thread */
+	set_thread(1);
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	bs_ch = spdk_io_channel_get_ctx(ch);
+
+	/* The first allocation reserves a batch of clusters, the next ones are taken from it.
+	 * Reserved clusters are still reported as free.
+	 */
+	for (i = 0; i < num_writes; i++) {
+		g_bserrno = -1;
+		spdk_blob_io_write(blob, ch, payload_write, i * io_units_per_cluster, 1,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - i - 1);
+		CU_ASSERT(bs_ch->num_reserved_clusters ==
+			  SPDK_BS_CHANNEL_RESERVED_CLUSTERS - 1 - i % SPDK_BS_CHANNEL_RESERVED_CLUSTERS);
+	}
+	CU_ASSERT(spdk_bit_pool_count_free(bs->used_clusters) ==
+		  free_clusters - 2 * SPDK_BS_CHANNEL_RESERVED_CLUSTERS);
+
+	/* Clusters of a batch are allocated in ascending order */
+	for (i = 1; i < SPDK_BS_CHANNEL_RESERVED_CLUSTERS; i++) {
+		CU_ASSERT(blob->active.clusters[i] ==
+			  blob->active.clusters[i - 1] + bs_cluster_to_lba(bs, 1));
+	}
+
+	/* Destroying the channel returns the reserved clusters */
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
+	set_thread(0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - num_writes);
+	CU_ASSERT(spdk_bit_pool_count_free(bs->used_clusters) == free_clusters - num_writes);
+
+	/* Clusters reserved by the md thread channel aren't persisted as used */
+	ch = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	spdk_blob_resize(blob, num_writes + 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, ch, payload_write, num_writes * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - num_writes - 1);
+	spdk_bs_free_io_channel(ch);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+
+	ut_bs_reload(&bs, NULL);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+	CU_ASSERT(spdk_bit_pool_count_free(bs->used_clusters) == free_clusters);
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+static void
+blob_thin_prov_reclaim_clusters(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *ch0, *ch1;
+	struct spdk_bs_channel *bs_ch0, *bs_ch1;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	uint64_t free_clusters;
+	uint8_t payload_write[BLOCKLEN];
+	const uint32_t CLUSTER_SZ = g_phys_blocklen * 4;
+	uint32_t io_units_per_cluster;
+	uint32_t *drained;
+	uint32_t num_drained = 0;
+
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = CLUSTER_SZ;
+
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+	SPDK_CU_ASSERT_FATAL(spdk_bs_free_cluster_count(bs) >= 8 * SPDK_BS_CHANNEL_RESERVED_CLUSTERS);
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	io_units_per_cluster = CLUSTER_SZ / spdk_bs_get_io_unit_size(bs);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+	drained = calloc(free_clusters, sizeof(*drained));
+	SPDK_CU_ASSERT_FATAL(drained != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 3;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+
+	/* Let the channel on thread 1 reserve a batch of clusters */
+	set_thread(1);
+	ch1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch1 != NULL);
+	bs_ch1 = spdk_io_channel_get_ctx(ch1);
+	spdk_blob_io_write(blob, ch1, payload_write, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_ch1->num_reserved_clusters == SPDK_BS_CHANNEL_RESERVED_CLUSTERS - 1);
+
+	/* Take all the clusters left in the pool */
+	set_thread(0);
+	spdk_spin_lock(&bs->used_lock);
+	while ((drained[num_drained] = bs_claim_cluster(bs)) != UINT32_MAX) {
+		num_drained++;
+	}
+	spdk_spin_unlock(&bs->used_lock);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == SPDK_BS_CHANNEL_RESERVED_CLUSTERS - 1);
+
+	/* An allocation on thread 0 reclaims the clusters reserved on thread 1 */
+	ch0 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch0 != NULL);
+	bs_ch0 = spdk_io_channel_get_ctx(ch0);
+	g_bserrno = -1;
+	spdk_blob_io_write(blob, ch0, payload_write, io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_ch1->num_reserved_clusters == 0);
+	CU_ASSERT(bs_ch0->num_reserved_clusters == 0);
+	CU_ASSERT(bs->num_reserved_clusters == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == SPDK_BS_CHANNEL_RESERVED_CLUSTERS - 2);
+	CU_ASSERT(TAILQ_EMPTY(&bs_ch0->need_cluster_alloc));
+
+	/* Without reservations left to reclaim, the allocation fails */
+	spdk_spin_lock(&bs->used_lock);
+	while ((drained[num_drained] = bs_claim_cluster(bs)) != UINT32_MAX) {
+		num_drained++;
+	}
+	spdk_spin_unlock(&bs->used_lock);
+	g_bserrno = -1;
+	spdk_blob_io_write(blob, ch0, payload_write, 2 * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOSPC);
+	CU_ASSERT(TAILQ_EMPTY(&bs_ch0->need_cluster_alloc));
+	CU_ASSERT(bs_ch0->clusters_reclaimed == false);
+
+	spdk_spin_lock(&bs->used_lock);
+	while (num_drained > 0) {
+		bs_release_cluster(bs, drained[--num_drained]);
+	}
+	spdk_spin_unlock(&bs->used_lock);
+	free(drained);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 2);
+
+	spdk_bs_free_io_channel(ch0);
+	set_thread(1);
+	spdk_bs_free_io_channel(ch1);
+	set_thread(0);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
+static void
+blob_thick_reclaim_clusters(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_blob *thin_blob, *blob;
+	struct spdk_io_channel *ch1;
+	struct spdk_bs_channel *bs_ch1;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts bs_opts;
+	struct spdk_blob_opts opts;
+	uint64_t free_clusters;
+	uint8_t payload_write[BLOCKLEN];
+	spdk_blob_id blobid;
+
+	dev = init_dev();
+	spdk_bs_opts_init(&bs_opts, sizeof(bs_opts));
+	bs_opts.cluster_sz = g_phys_blocklen * 4;
+
+	spdk_bs_init(dev, &bs_opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	SPDK_CU_ASSERT_FATAL(free_clusters >= 8 * SPDK_BS_CHANNEL_RESERVED_CLUSTERS);
+	memset(payload_write, 0xE5, sizeof(payload_write));
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 1;
+	thin_blob = ut_blob_create_and_open(bs, &opts);
+
+	/* Let the channel on thread 1 reserve a batch of clusters */
+	set_thread(1);
+	ch1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(ch1 != NULL);
+	bs_ch1 = spdk_io_channel_get_ctx(ch1);
+	spdk_blob_io_write(thin_blob, ch1, payload_write, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_ch1->num_reserved_clusters == SPDK_BS_CHANNEL_RESERVED_CLUSTERS - 1);
+	set_thread(0);
+
+	/* A thick blob can take all the free clusters, including the reserved ones */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = spdk_bs_free_cluster_count(bs);
+	g_bserrno = -1;
+	spdk_bs_create_blob_ext(bs, &opts, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+	CU_ASSERT(bs_ch1->num_reserved_clusters == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == 0);
+	blobid = g_blobid;
+
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 1);
+
+	/* Same for growing a thick blob */
+	ut_spdk_blob_opts_init(&opts);
+	opts.num_clusters = 1;
+	blob = ut_blob_create_and_open(bs, &opts);
+
+	spdk_blob_resize(thin_blob, 2, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	set_thread(1);
+	spdk_blob_io_write(thin_blob, ch1, payload_write,
+			   spdk_bs_get_cluster_size(bs) / spdk_bs_get_io_unit_size(bs), 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_ch1->num_reserved_clusters == SPDK_BS_CHANNEL_RESERVED_CLUSTERS - 1);
+	set_thread(0);
+
+	g_bserrno = -1;
+	spdk_blob_resize(blob, 1 + spdk_bs_free_cluster_count(bs), blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs_ch1->num_reserved_clusters == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == 0);
+
+	/* Without reservations left to reclaim, growing fails */
+	g_bserrno = -1;
+	spdk_blob_resize(blob, 2 + spdk_blob_get_num_clusters(blob), blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOSPC);
+
+	set_thread(1);
+	spdk_bs_free_io_channel(ch1);
+	set_thread(0);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, thin_blob);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+}
+
 static void
 blob_thin_prov_write_count_io(void)
 {
@@ -5506,6 +5836,94 @@ blob_thin_prov_alloc_extpage_concurrently(void)
 	set_thread(0);
 }
 
+static void
+blob_thin_prov_batch_extpage_writes(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_blob_opts opts;
+	struct spdk_blob_md_page *page;
+	spdk_blob_id blobid;
+	uint64_t cluster[4], write_bytes;
+	uint32_t extent_page, free_md_pages;
+	int rc[4];
+	int i;
+
+	free_md_pages = spdk_bit_array_count_clear(bs->used_md_pages);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	if (!blob->use_extent_table) {
+		ut_blob_close_and_delete(bs, blob);
+		return;
+	}
+
+	page = calloc(1, bs->md_page_size);
+	SPDK_CU_ASSERT_FATAL(page != NULL);
+
+	/* Allocate the first cluster alone, so that the extent page gets written */
+	extent_page = 0;
+	spdk_spin_lock(&bs->used_lock);
+	CU_ASSERT(bs_allocate_cluster(blob, 0, &cluster[0], &extent_page, false) == 0);
+	spdk_spin_unlock(&bs->used_lock);
+	CU_ASSERT(extent_page != 0);
+
+	rc[0] = -1;
+	blob_insert_cluster_on_md_thread(blob, 0, cluster[0], extent_page, page, blob_op_complete, &rc[0]);
+	poll_threads();
+	CU_ASSERT(rc[0] == 0);
+	CU_ASSERT(free_md_pages - 2 == spdk_bit_array_count_clear(bs->used_md_pages));
+
+	/* Insert the remaining clusters of the same extent page concurrently. The first insertion
+	 * writes the extent page, the two queued behind it are persisted by a single write. */
+	spdk_spin_lock(&bs->used_lock);
+	for (i = 1; i < 4; i++) {
+		extent_page = 0;
+		CU_ASSERT(bs_allocate_cluster(blob, i, &cluster[i], &extent_page, false) == 0);
+		CU_ASSERT(extent_page == 0);
+	}
+	spdk_spin_unlock(&bs->used_lock);
+
+	write_bytes = g_dev_write_bytes;
+	for (i = 1; i < 4; i++) {
+		rc[i] = -1;
+		blob_insert_cluster_on_md_thread(blob, i, cluster[i], 0, page, blob_op_complete, &rc[i]);
+	}
+	poll_threads();
+	for (i = 1; i < 4; i++) {
+		CU_ASSERT(rc[i] == 0);
+		CU_ASSERT(bs_io_unit_is_allocated(blob, i * bs->io_units_per_cluster));
+	}
+	CU_ASSERT(g_dev_write_bytes - write_bytes == 2 * bs->md_page_size);
+	CU_ASSERT(TAILQ_EMPTY(&blob->cluster_op_queue));
+	CU_ASSERT(free_md_pages - 2 == spdk_bit_array_count_clear(bs->used_md_pages));
+	free(page);
+
+	/* The merged extent page write must have persisted all of the clusters */
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	ut_bs_reload(&bs, NULL);
+
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(blob->active.clusters[i] == bs_cluster_to_lba(bs, cluster[i]));
+	}
+
+	ut_blob_close_and_delete(bs, blob);
+	CU_ASSERT(free_md_pages == spdk_bit_array_count_clear(bs->used_md_pages));
+}
+
 struct iter_ctx {
 	int		current_iter;
 	spdk_blob_id	blobid[4];
@@ -5602,6 +6020,112 @@ bs_load_iter_test(void)
 	g_bs = NULL;
 }
 
+/* Dirty load replays the md region in windows; blobs whose md page chains and extent pages
+ * cross windows have to be recovered as well.
+ */
+static void
+bs_load_replay_md_windows(void)
+{
+	struct spdk_blob_store *bs;
+	struct spdk_bs_dev *dev;
+	struct spdk_bs_opts opts;
+	struct spdk_blob *blob;
+	const uint32_t num_blobs = BS_LOAD_REPLAY_WINDOW_PAGES + 16;
+	spdk_blob_id *blobids;
+	uint64_t free_clusters;
+	size_t xattr_length = 4072 - sizeof(struct spdk_blob_md_descriptor_xattr) -
+			      strlen("large0");
+	const void *value;
+	size_t value_len;
+	char *xattr;
+	uint32_t i;
+	int rc;
+
+	blobids = calloc(num_blobs, sizeof(*blobids));
+	xattr = calloc(1, xattr_length);
+	SPDK_CU_ASSERT_FATAL(blobids != NULL && xattr != NULL);
+	memset(xattr, 0xa5, xattr_length);
+
+	dev = init_dev();
+	spdk_bs_opts_init(&opts, sizeof(opts));
+	opts.num_md_pages = 2 * BS_LOAD_REPLAY_WINDOW_PAGES;
+
+	spdk_bs_init(dev, &opts, bs_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_bs != NULL);
+	bs = g_bs;
+
+	for (i = 0; i < num_blobs; i++) {
+		blob = ut_blob_create_and_open(bs, NULL);
+		blobids[i] = spdk_blob_get_id(blob);
+
+		/* Some of the blobs get an extent page */
+		if (i % 64 == 0) {
+			spdk_blob_resize(blob, 1, blob_op_complete, NULL);
+			poll_threads();
+			CU_ASSERT(g_bserrno == 0);
+		}
+
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	/* The md page chain of the first blob continues in the next window, the chain of the
+	 * last blob stays within its window.
+	 */
+	for (i = 0; i < num_blobs; i += num_blobs - 1) {
+		spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+		blob = g_blob;
+
+		rc = spdk_blob_set_xattr(blob, "large0", xattr, xattr_length);
+		CU_ASSERT(rc == 0);
+		rc = spdk_blob_set_xattr(blob, "large1", xattr, xattr_length);
+		CU_ASSERT(rc == 0);
+
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	ut_bs_dirty_load(&bs, NULL);
+	CU_ASSERT(free_clusters == spdk_bs_free_cluster_count(bs));
+
+	for (i = 0; i < num_blobs; i++) {
+		spdk_bs_open_blob(bs, blobids[i], blob_op_with_handle_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+		SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+		blob = g_blob;
+
+		CU_ASSERT(spdk_blob_get_num_clusters(blob) == (i % 64 == 0 ? 1 : 0));
+		if (i == 0 || i == num_blobs - 1) {
+			rc = spdk_blob_get_xattr_value(blob, "large1", &value, &value_len);
+			CU_ASSERT(rc == 0);
+			CU_ASSERT(value_len == xattr_length);
+			CU_ASSERT(value != NULL && memcmp(value, xattr, xattr_length) == 0);
+		}
+
+		spdk_blob_close(blob, blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+
+	spdk_bs_unload(bs, bs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	g_bs = NULL;
+	g_blob = NULL;
+	free(blobids);
+	free(xattr);
+}
+
 static void
 blob_snapshot_rw(void)
 {
@@ -8528,6 +9052,108 @@ blob_seek_io_unit(void)
 	ut_blob_close_and_delete(bs, blob);
 }
 
+static void
+blob_contiguous_io_units(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	uint8_t payload[10 * BLOCKLEN];
+	uint64_t io_units_per_cluster;
+	uint64_t lba_per_cluster;
+	uint64_t lba;
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	CU_ASSERT(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+
+	blob = ut_blob_create_and_open(bs, &opts);
+
+	io_units_per_cluster = bs_io_units_per_cluster(blob);
+	lba_per_cluster = bs_cluster_to_lba(bs, 1);
+
+	spdk_blob_resize(blob, 5, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+
+	/* Allocate clusters 0, 1 and 3 */
+	spdk_blob_io_write(blob, channel, payload, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload, io_units_per_cluster, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload, 3 * io_units_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(blob->active.clusters[1] ==
+			     blob->active.clusters[0] + lba_per_cluster);
+
+	/* Clusters 0 and 1 are contiguous, cluster 2 is not allocated */
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 0, UINT64_MAX) ==
+		  2 * io_units_per_cluster);
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 1, UINT64_MAX) ==
+		  2 * io_units_per_cluster - 1);
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 1, 3) == 3);
+
+	/* Unallocated cluster reports the distance to the cluster boundary */
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 2 * io_units_per_cluster + 1,
+			UINT64_MAX) == io_units_per_cluster - 1);
+
+	/* Cluster 3 is followed by unallocated cluster 4, which ends the blob */
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 3 * io_units_per_cluster,
+			UINT64_MAX) == io_units_per_cluster);
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 5 * io_units_per_cluster - 1,
+			UINT64_MAX) == 1);
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 5 * io_units_per_cluster,
+			UINT64_MAX) == 0);
+
+	/* Move cluster 1 away, so it is no longer contiguous with cluster 0 */
+	blob->active.clusters[1] += lba_per_cluster;
+	CU_ASSERT(spdk_blob_get_num_contiguous_io_units(blob, 0, UINT64_MAX) ==
+		  io_units_per_cluster);
+	blob->active.clusters[1] -= lba_per_cluster;
+
+	/* LBA on the device is returned only for fully allocated, contiguous ranges */
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 1, 2 * io_units_per_cluster - 1, &lba) == 0);
+	CU_ASSERT(lba == bs_blob_io_unit_to_lba(blob, 1));
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 1, 2 * io_units_per_cluster, &lba) == -ENODATA);
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 2 * io_units_per_cluster, 1, &lba) == -ENODATA);
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 3 * io_units_per_cluster, 1, &lba) == 0);
+	CU_ASSERT(lba == blob->active.clusters[3]);
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 0, 0, &lba) == -EINVAL);
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 5 * io_units_per_cluster - 1, 2, &lba) == -EINVAL);
+	blob->frozen_refcnt++;
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 0, 1, &lba) == -EBUSY);
+	blob->frozen_refcnt--;
+
+	/* Freezing the blob waits for the device ranges handed out to be released */
+	CU_ASSERT(blob->dev_lba_refcnt == 2);
+	spdk_blob_release_dev_lba(blob);
+	g_bserrno = -1;
+	blob_freeze_io(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -1);
+	CU_ASSERT(spdk_blob_get_dev_lba(blob, 0, 1, &lba) == -EBUSY);
+	spdk_blob_release_dev_lba(blob);
+	spdk_delay_us(BLOB_FREEZE_DEV_LBA_POLL_US);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(blob->dev_lba_refcnt == 0);
+	blob_unfreeze_io(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(blob->frozen_refcnt == 0);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+}
+
 static void
 blob_esnap_create(void)
 {
@@ -10618,13 +11244,18 @@ main(int argc, char **argv)
 		CU_ADD_TEST(suite_bs, blob_insert_cluster_msg_test);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rw);
 		CU_ADD_TEST(suite, blob_thin_prov_write_count_io);
+		CU_ADD_TEST(suite, blob_thin_prov_reserved_clusters);
+		CU_ADD_TEST(suite, blob_thick_reclaim_clusters);
+		CU_ADD_TEST(suite, blob_thin_prov_reclaim_clusters);
 		CU_ADD_TEST(suite, blob_thin_prov_unmap_cluster);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rle);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_rw_iov);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_update_extpage_ordered);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_alloc_extpage_concurrently);
+		CU_ADD_TEST(suite_bs, blob_thin_prov_batch_extpage_writes);
 		CU_ADD_TEST(suite_bs, blob_thin_prov_unmap_update_extpage_ordered);
 		CU_ADD_TEST(suite, bs_load_iter_test);
+		CU_ADD_TEST(suite, bs_load_replay_md_windows);
 		CU_ADD_TEST(suite_bs, blob_snapshot_rw);
 		CU_ADD_TEST(suite_bs, blob_snapshot_rw_iov);
 		CU_ADD_TEST(suite, blob_relations);
@@ -10644,6 +11275,7 @@ main(int argc, char **argv)
 		CU_ADD_TEST(suite_bs, blob_persist_test);
 		CU_ADD_TEST(suite_bs, blob_decouple_snapshot);
 		CU_ADD_TEST(suite_bs, blob_seek_io_unit);
+		CU_ADD_TEST(suite_bs, blob_contiguous_io_units);
 		CU_ADD_TEST(suite_esnap_bs, blob_esnap_create);
 		CU_ADD_TEST(suite_bs, blob_nested_freezes);
 		CU_ADD_TEST(suite, blob_ext_md_pages);
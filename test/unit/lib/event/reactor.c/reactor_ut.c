@@ -1224,6 +1224,394 @@ test_mixed_workload(void)
 	free_cores();
 }
 
+static void
+test_thread_steal(void)
+{
+	struct spdk_cpuset cpuset = {};
+	struct spdk_thread *thread[3];
+	struct spdk_lw_thread *lw_thread[3];
+	struct spdk_poller *busy[3];
+	struct spdk_reactor *reactor0, *reactor1;
+	uint64_t busy_time[3] = {100, 60, 40};
+	int i;
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+	MOCK_SET(spdk_get_ticks, 0);
+
+	allocate_cores(2);
+
+	CU_ASSERT(spdk_reactors_init(SPDK_DEFAULT_MSG_MEMPOOL_SIZE) == 0);
+
+	spdk_cpuset_set_cpu(&g_reactor_core_mask, 0, true);
+	spdk_cpuset_set_cpu(&g_reactor_core_mask, 1, true);
+
+	/* Isolated cores don't take part in thread stealing */
+	spdk_cpuset_zero(&g_scheduler_isolated_core_mask);
+
+	/* 1 tick per us, so a steal period is 10 ticks */
+	spdk_scheduler_set_thread_steal_period(10);
+	CU_ASSERT(spdk_scheduler_get_thread_steal_period() == 10);
+
+	reactor0 = spdk_reactor_get(0);
+	SPDK_CU_ASSERT_FATAL(reactor0 != NULL);
+	reactor1 = spdk_reactor_get(1);
+	SPDK_CU_ASSERT_FATAL(reactor1 != NULL);
+
+	/* Create all threads on core 0. Thread 0 may only run on core 0. */
+	for (i = 0; i < 3; i++) {
+		spdk_cpuset_zero(&cpuset);
+		spdk_cpuset_set_cpu(&cpuset, 0, true);
+		spdk_cpuset_set_cpu(&cpuset, 1, i != 0);
+		g_next_core = 0;
+		thread[i] = spdk_thread_create(NULL, &cpuset);
+		SPDK_CU_ASSERT_FATAL(thread[i] != NULL);
+		lw_thread[i] = spdk_thread_get_ctx(thread[i]);
+	}
+
+	CU_ASSERT(event_queue_run_batch(reactor0) == 3);
+	CU_ASSERT(reactor0->thread_count == 3);
+
+	g_reactor_state = SPDK_REACTOR_STATE_RUNNING;
+
+	for (i = 0; i < 3; i++) {
+		spdk_set_thread(thread[i]);
+		busy[i] = spdk_poller_register(poller_run_busy, (void *)busy_time[i], 0);
+		CU_ASSERT(busy[i] != NULL);
+	}
+	spdk_set_thread(NULL);
+
+	/* Core 0 is overloaded */
+	MOCK_SET(spdk_get_ticks, 1000);
+	reactor0->tsc_last = 1000;
+	_reactor_run(reactor0);
+	CU_ASSERT(reactor0->tsc_last == 1200);
+	reactor_steal_period(reactor0);
+	CU_ASSERT(reactor0->steal_load == 100);
+
+	/* Core 1 only steals after being idle for REACTOR_STEAL_IDLE_PERIODS periods */
+	MOCK_SET(spdk_env_get_current_core, 1);
+	reactor1->tsc_last = 1200;
+	MOCK_SET(spdk_get_ticks, 1300);
+	_reactor_run(reactor1);
+	reactor_steal_period(reactor1);
+	CU_ASSERT(reactor1->steal_load == 0);
+	CU_ASSERT(reactor1->steal_idle_periods == 1);
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+	CU_ASSERT(event_queue_run_batch(reactor0) == 0);
+
+	MOCK_SET(spdk_env_get_current_core, 1);
+	MOCK_SET(spdk_get_ticks, 1400);
+	_reactor_run(reactor1);
+	reactor_steal_period(reactor1);
+	CU_ASSERT(reactor1->steal_idle_periods == 0);
+	CU_ASSERT(reactor1->steal_resume_tsc == 1400 + REACTOR_STEAL_HOLDOFF_PERIODS * 10);
+
+	/* Core 0 gives up thread 1, which has the load closest to half of the core's load.
+	 * Thread 0 is the closest, but it cannot run on core 1.
+	 */
+	MOCK_SET(spdk_env_get_current_core, 0);
+	CU_ASSERT(event_queue_run_batch(reactor0) == 1);
+	CU_ASSERT(lw_thread[0]->resched == false);
+	CU_ASSERT(lw_thread[1]->resched == true);
+	CU_ASSERT(lw_thread[1]->lcore == 1);
+	CU_ASSERT(lw_thread[2]->resched == false);
+
+	MOCK_SET(spdk_get_ticks, 1400);
+	reactor0->tsc_last = 1400;
+	_reactor_run(reactor0);
+	CU_ASSERT(reactor0->thread_count == 2);
+
+	MOCK_SET(spdk_env_get_current_core, 1);
+	CU_ASSERT(event_queue_run_batch(reactor1) == 1);
+	CU_ASSERT(reactor1->thread_count == 1);
+	CU_ASSERT(TAILQ_FIRST(&reactor1->threads) == lw_thread[1]);
+
+	/* Core 1 doesn't steal another thread until the holdoff expires */
+	reactor1->tsc_last = 1450;
+	reactor_steal_period(reactor1);
+	reactor_steal_period(reactor1);
+	CU_ASSERT(reactor1->steal_idle_periods == 2);
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+	CU_ASSERT(event_queue_run_batch(reactor0) == 0);
+
+	spdk_scheduler_set_thread_steal_period(0);
+	g_reactor_state = SPDK_REACTOR_STATE_INITIALIZED;
+
+	for (i = 0; i < 3; i++) {
+		spdk_set_thread(thread[i]);
+		spdk_poller_unregister(&busy[i]);
+		spdk_thread_exit(thread[i]);
+	}
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+	reactor_run(reactor0);
+	MOCK_SET(spdk_env_get_current_core, 1);
+	reactor_run(reactor1);
+
+	spdk_set_thread(NULL);
+
+	MOCK_CLEAR(spdk_env_get_current_core);
+	MOCK_CLEAR(spdk_get_ticks);
+
+	spdk_reactors_fini();
+
+	free_cores();
+}
+
+static int
+numa_dev_create_cb(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+numa_dev_destroy_cb(void *io_device, void *ctx_buf)
+{
+}
+
+static void
+test_numa_aware_scheduler(void)
+{
+	struct spdk_cpuset cpuset = {};
+	struct spdk_scheduler_thread_info thread_info = {};
+	struct spdk_io_channel *ch0, *ch1, *ch2;
+	struct spdk_thread *thread;
+	struct spdk_reactor *reactor;
+	int dev0, dev1, dev2;
+	int32_t numa_ids[4] = {0, 0, 1, 1};
+	uint32_t i;
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+
+	allocate_cores(4);
+
+	CU_ASSERT(spdk_reactors_init(SPDK_DEFAULT_MSG_MEMPOOL_SIZE) == 0);
+
+	for (i = 0; i < 4; i++) {
+		spdk_cpuset_set_cpu(&g_reactor_core_mask, i, true);
+		spdk_cpuset_set_cpu(&cpuset, i, true);
+	}
+	spdk_cpuset_zero(&g_scheduler_isolated_core_mask);
+
+	reactor = spdk_reactor_get(0);
+	SPDK_CU_ASSERT_FATAL(reactor != NULL);
+
+	g_next_core = 0;
+	thread = spdk_thread_create(NULL, &cpuset);
+	SPDK_CU_ASSERT_FATAL(thread != NULL);
+	CU_ASSERT(event_queue_run_batch(reactor) == 1);
+
+	/* The NUMA affinity of a thread follows the NUMA node of most of its channels */
+	spdk_set_thread(thread);
+	spdk_io_device_register(&dev0, numa_dev_create_cb, numa_dev_destroy_cb, 0, "dev0");
+	spdk_io_device_register(&dev1, numa_dev_create_cb, numa_dev_destroy_cb, 0, "dev1");
+	spdk_io_device_register(&dev2, numa_dev_create_cb, numa_dev_destroy_cb, 0, "dev2");
+	ch0 = spdk_get_io_channel(&dev0);
+	ch1 = spdk_get_io_channel(&dev1);
+	ch2 = spdk_get_io_channel(&dev2);
+	SPDK_CU_ASSERT_FATAL(ch0 != NULL && ch1 != NULL && ch2 != NULL);
+	CU_ASSERT(spdk_io_channel_get_numa_id(ch0) == SPDK_ENV_NUMA_ID_ANY);
+	CU_ASSERT(spdk_thread_get_numa_id(thread) == SPDK_ENV_NUMA_ID_ANY);
+
+	spdk_io_channel_set_numa_id(ch0, 1);
+	CU_ASSERT(spdk_io_channel_get_numa_id(ch0) == 1);
+	CU_ASSERT(spdk_thread_get_numa_id(thread) == 1);
+	spdk_io_channel_set_numa_id(ch1, 0);
+	CU_ASSERT(spdk_thread_get_numa_id(thread) == SPDK_ENV_NUMA_ID_ANY);
+	spdk_io_channel_set_numa_id(ch2, 1);
+	CU_ASSERT(spdk_thread_get_numa_id(thread) == 1);
+
+	/* Cores 0 and 1 are on NUMA node 0, cores 2 and 3 on NUMA node 1.  Switch schedulers,
+	 * so that the dynamic one set by the previous tests is deinitialized first.
+	 */
+	spdk_scheduler_set(NULL);
+	CU_ASSERT(spdk_scheduler_set("dynamic") == 0);
+	for (i = 0; i < 4; i++) {
+		g_cores[i].numa_id = numa_ids[i];
+		g_cores[i].thread_count = 1;
+		g_cores[i].busy = 100;
+		g_cores[i].idle = 900;
+	}
+
+	thread_info.thread_id = spdk_thread_get_id(thread);
+	thread_info.numa_id = spdk_thread_get_numa_id(thread);
+	thread_info.current_stats.busy_tsc = 100;
+	thread_info.current_stats.idle_tsc = 900;
+
+	/* A thread on node 1 is not consolidated on the main core, on node 0 */
+	thread_info.lcore = 3;
+	CU_ASSERT(_find_optimal_core(&thread_info) == 2);
+
+	/* Unless the NUMA awareness is disabled, or the thread has no NUMA affinity */
+	g_scheduler_numa_imbalance = 0;
+	CU_ASSERT(_find_optimal_core(&thread_info) == 0);
+	g_scheduler_numa_imbalance = 20;
+	thread_info.numa_id = SPDK_ENV_NUMA_ID_ANY;
+	CU_ASSERT(_find_optimal_core(&thread_info) == 0);
+	thread_info.numa_id = 1;
+
+	/* A thread off its node is brought back, even if its core is not at the limit */
+	thread_info.lcore = 0;
+	CU_ASSERT(_find_optimal_core(&thread_info) == 2);
+
+	/* Node 1 is overloaded, while node 0 is mostly idle */
+	for (i = 2; i < 4; i++) {
+		g_cores[i].thread_count = 2;
+		g_cores[i].busy = 900;
+		g_cores[i].idle = 100;
+	}
+	thread_info.lcore = 3;
+	CU_ASSERT(_find_optimal_core(&thread_info) == 0);
+
+	/* Below the imbalance threshold, the thread stays on node 1 */
+	for (i = 0; i < 2; i++) {
+		g_cores[i].busy = 800;
+		g_cores[i].idle = 200;
+	}
+	CU_ASSERT(_find_optimal_core(&thread_info) == 3);
+
+	spdk_scheduler_set(NULL);
+
+	spdk_put_io_channel(ch0);
+	spdk_put_io_channel(ch1);
+	spdk_put_io_channel(ch2);
+	spdk_io_device_unregister(&dev0, NULL);
+	spdk_io_device_unregister(&dev1, NULL);
+	spdk_io_device_unregister(&dev2, NULL);
+	spdk_thread_exit(thread);
+	reactor_run(reactor);
+
+	spdk_set_thread(NULL);
+
+	MOCK_CLEAR(spdk_env_get_current_core);
+
+	spdk_reactors_fini();
+
+	free_cores();
+}
+
+static void
+test_thread_steal_interrupt(void)
+{
+	struct spdk_cpuset cpuset = {};
+	struct spdk_thread *thread[2];
+	struct spdk_lw_thread *lw_thread[2];
+	struct spdk_poller *busy[2];
+	struct spdk_reactor *reactor0, *reactor1;
+	uint64_t busy_time[2] = {100, 60};
+	int i;
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+	MOCK_SET(spdk_get_ticks, 0);
+
+	allocate_cores(2);
+
+	CU_ASSERT(spdk_reactors_init(SPDK_DEFAULT_MSG_MEMPOOL_SIZE) == 0);
+
+	spdk_cpuset_set_cpu(&g_reactor_core_mask, 0, true);
+	spdk_cpuset_set_cpu(&g_reactor_core_mask, 1, true);
+	spdk_cpuset_zero(&g_scheduler_isolated_core_mask);
+
+	spdk_scheduler_set_thread_steal_period(10);
+
+	reactor0 = spdk_reactor_get(0);
+	SPDK_CU_ASSERT_FATAL(reactor0 != NULL);
+	reactor1 = spdk_reactor_get(1);
+	SPDK_CU_ASSERT_FATAL(reactor1 != NULL);
+
+	spdk_cpuset_set_cpu(&cpuset, 0, true);
+	spdk_cpuset_set_cpu(&cpuset, 1, true);
+	for (i = 0; i < 2; i++) {
+		g_next_core = 0;
+		thread[i] = spdk_thread_create(NULL, &cpuset);
+		SPDK_CU_ASSERT_FATAL(thread[i] != NULL);
+		lw_thread[i] = spdk_thread_get_ctx(thread[i]);
+	}
+
+	CU_ASSERT(event_queue_run_batch(reactor0) == 2);
+	CU_ASSERT(reactor0->thread_count == 2);
+
+	g_reactor_state = SPDK_REACTOR_STATE_RUNNING;
+
+	for (i = 0; i < 2; i++) {
+		spdk_set_thread(thread[i]);
+		busy[i] = spdk_poller_register(poller_run_busy, (void *)busy_time[i], 0);
+		CU_ASSERT(busy[i] != NULL);
+	}
+	spdk_set_thread(NULL);
+
+	/* Core 1 was put in interrupt mode by the scheduler, it doesn't run steal periods */
+	reactor1->in_interrupt = true;
+
+	/* Core 0 hands a thread to core 1 after being overloaded for REACTOR_STEAL_IDLE_PERIODS
+	 * periods.
+	 */
+	MOCK_SET(spdk_get_ticks, 1000);
+	reactor0->tsc_last = 1000;
+	_reactor_run(reactor0);
+	reactor_steal_period(reactor0);
+	CU_ASSERT(reactor0->steal_load == 100);
+	CU_ASSERT(reactor0->steal_busy_periods == 1);
+	CU_ASSERT(lw_thread[0]->resched == false);
+	CU_ASSERT(lw_thread[1]->resched == false);
+
+	_reactor_run(reactor0);
+	reactor_steal_period(reactor0);
+	CU_ASSERT(reactor0->steal_busy_periods == 0);
+	CU_ASSERT(reactor0->steal_resume_tsc ==
+		  reactor0->tsc_last + REACTOR_STEAL_HOLDOFF_PERIODS * 10);
+
+	/* Both threads are as close to half the load of the core, the first one is moved */
+	CU_ASSERT(lw_thread[0]->resched == true);
+	CU_ASSERT(lw_thread[0]->lcore == 1);
+	CU_ASSERT(lw_thread[1]->resched == false);
+
+	_reactor_run(reactor0);
+	CU_ASSERT(reactor0->thread_count == 1);
+
+	/* The event scheduling the thread wakes core 1 up */
+	MOCK_SET(spdk_env_get_current_core, 1);
+	CU_ASSERT(event_queue_run_batch(reactor1) == 1);
+	CU_ASSERT(reactor1->thread_count == 1);
+	CU_ASSERT(TAILQ_FIRST(&reactor1->threads) == lw_thread[0]);
+
+	/* A reactor left with a single thread doesn't give it away */
+	MOCK_SET(spdk_env_get_current_core, 0);
+	reactor0->steal_resume_tsc = 0;
+	_reactor_run(reactor0);
+	reactor_steal_period(reactor0);
+	_reactor_run(reactor0);
+	reactor_steal_period(reactor0);
+	CU_ASSERT(reactor0->steal_busy_periods == 2);
+	CU_ASSERT(lw_thread[1]->resched == false);
+
+	reactor1->in_interrupt = false;
+	spdk_scheduler_set_thread_steal_period(0);
+	g_reactor_state = SPDK_REACTOR_STATE_INITIALIZED;
+
+	for (i = 0; i < 2; i++) {
+		spdk_set_thread(thread[i]);
+		spdk_poller_unregister(&busy[i]);
+		spdk_thread_exit(thread[i]);
+	}
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+	reactor_run(reactor0);
+	MOCK_SET(spdk_env_get_current_core, 1);
+	reactor_run(reactor1);
+
+	spdk_set_thread(NULL);
+
+	MOCK_CLEAR(spdk_env_get_current_core);
+	MOCK_CLEAR(spdk_get_ticks);
+
+	spdk_reactors_fini();
+
+	free_cores();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1249,6 +1637,9 @@ main(int argc, char **argv)
 #endif
 	CU_ADD_TEST(suite, test_scheduler_set_isolated_core_mask);
 	CU_ADD_TEST(suite, test_mixed_workload);
+	CU_ADD_TEST(suite, test_thread_steal);
+	CU_ADD_TEST(suite, test_thread_steal_interrupt);
+	CU_ADD_TEST(suite, test_numa_aware_scheduler);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
 	CU_cleanup_registry();
@@ -2236,6 +2236,427 @@ poller_get_stats(void)
 	free_threads();
 }
 
+static int
+ut_backoff_poll(void *ctx)
+{
+	int *rc = ctx;
+
+	return *rc;
+}
+
+static void
+poller_backoff(void)
+{
+	struct spdk_poller *poller;
+	struct spdk_poller_stats stats;
+	int rc = SPDK_POLLER_IDLE;
+
+	allocate_threads(1);
+	set_thread(0);
+
+	poller = spdk_poller_register(ut_backoff_poll, &rc, 0);
+	SPDK_CU_ASSERT_FATAL(poller != NULL);
+	spdk_poller_set_backoff(poller, 4);
+
+	/* The poller is run on every iteration until it's been idle for
+	 * SPDK_POLLER_BACKOFF_IDLE_RUNS runs.
+	 */
+	poll_thread_times(0, SPDK_POLLER_BACKOFF_IDLE_RUNS);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, SPDK_POLLER_BACKOFF_IDLE_RUNS);
+	CU_ASSERT_EQUAL(stats.skip_count, 0);
+	CU_ASSERT_EQUAL(stats.backoff_interval, 2);
+
+	/* Then it's run every other iteration, until it's been idle again */
+	poll_thread_times(0, SPDK_POLLER_BACKOFF_IDLE_RUNS * 2);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 2);
+	CU_ASSERT_EQUAL(stats.skip_count, SPDK_POLLER_BACKOFF_IDLE_RUNS);
+	CU_ASSERT_EQUAL(stats.backoff_interval, 4);
+
+	/* The interval doesn't grow past the maximum */
+	poll_thread_times(0, SPDK_POLLER_BACKOFF_IDLE_RUNS * 8);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 4);
+	CU_ASSERT_EQUAL(stats.skip_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 7);
+	CU_ASSERT_EQUAL(stats.backoff_interval, 4);
+
+	/* The first busy run brings the poller back to full rate */
+	rc = SPDK_POLLER_BUSY;
+	poll_thread_times(0, 4);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 4 + 1);
+	CU_ASSERT_EQUAL(stats.busy_count, 1);
+	CU_ASSERT_EQUAL(stats.backoff_interval, 1);
+
+	rc = SPDK_POLLER_IDLE;
+	poll_thread_times(0, 2);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 4 + 3);
+	CU_ASSERT_EQUAL(stats.skip_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 7 + 3);
+
+	/* Disable the backoff */
+	spdk_poller_set_backoff(poller, 0);
+	poll_thread_times(0, SPDK_POLLER_BACKOFF_IDLE_RUNS * 2);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT_EQUAL(stats.run_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 6 + 3);
+	CU_ASSERT_EQUAL(stats.skip_count, SPDK_POLLER_BACKOFF_IDLE_RUNS * 7 + 3);
+	CU_ASSERT_EQUAL(stats.backoff_interval, 0);
+
+	spdk_poller_unregister(&poller);
+	poll_thread(0);
+	free_threads();
+}
+
+static uintptr_t g_msg_order[64];
+static uint32_t g_msg_order_count;
+
+static void
+record_msg_cb(void *ctx)
+{
+	SPDK_CU_ASSERT_FATAL(g_msg_order_count < SPDK_COUNTOF(g_msg_order));
+	g_msg_order[g_msg_order_count++] = (uintptr_t)ctx;
+}
+
+static void
+thread_msg_channels(void)
+{
+	struct spdk_thread *thread0, *thread1;
+	struct spdk_msg_channel *ch;
+	void *ctxs[40];
+	uint32_t i;
+
+	g_msg_order_count = 0;
+	allocate_threads(3);
+	thread0 = g_ut_threads[0].thread;
+	thread1 = g_ut_threads[1].thread;
+
+	/* Messages sent before enabling the channels go through the ring of thread 0 */
+	set_thread(1);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)1);
+	CU_ASSERT(TAILQ_EMPTY(&thread1->msg_channels_out));
+
+	/* The first message sent afterwards creates a channel and registers it */
+	spdk_thread_enable_msg_channels(true);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)2);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)3);
+	ch = TAILQ_FIRST(&thread1->msg_channels_out);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	CU_ASSERT(TAILQ_NEXT(ch, producer_link) == NULL);
+	CU_ASSERT(!ch->active);
+	CU_ASSERT(spdk_ring_count(ch->ring) == 2);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 2);
+
+	/* Registering the channel drains it, after the earlier messages */
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(ch->active);
+	CU_ASSERT(g_msg_order_count == 3);
+	for (i = 0; i < g_msg_order_count; i++) {
+		CU_ASSERT(g_msg_order[i] == i + 1);
+	}
+	CU_ASSERT(thread0->msg_doorbell == 0);
+
+	/* Once registered, the producer rings the doorbell */
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)4);
+	CU_ASSERT(thread0->msg_doorbell == 1ULL << ch->doorbell_bit);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 0);
+	CU_ASSERT(!spdk_thread_is_idle(thread0));
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(g_msg_order_count == 4);
+	CU_ASSERT(thread0->msg_doorbell == 0);
+
+	/* Messages that don't fit in the ring are kept in order by the producer */
+	MOCK_SET(spdk_ring_enqueue, 0);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)5);
+	ctxs[0] = (void *)6;
+	ctxs[1] = (void *)7;
+	spdk_thread_send_msg_batch(thread0, record_msg_cb, ctxs, 2);
+	MOCK_CLEAR(spdk_ring_enqueue);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)8);
+	CU_ASSERT(thread1->msg_overflow_count == 4);
+	CU_ASSERT(ch->overflow_count == 4);
+	CU_ASSERT(!spdk_thread_is_idle(thread1));
+
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(g_msg_order_count == 4);
+
+	spdk_thread_poll(thread1, 0, 0);
+	CU_ASSERT(thread1->msg_overflow_count == 0);
+	CU_ASSERT(ch->overflow_count == 0);
+	CU_ASSERT(STAILQ_EMPTY(&ch->overflow));
+
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(g_msg_order_count == 8);
+
+	/* A batch larger than the ones the consumer executes per poll */
+	for (i = 0; i < SPDK_COUNTOF(ctxs); i++) {
+		ctxs[i] = (void *)(uintptr_t)(i + 9);
+	}
+	spdk_thread_send_msg_batch(thread0, record_msg_cb, ctxs, SPDK_COUNTOF(ctxs));
+	spdk_thread_poll(thread0, 0, 0);
+	CU_ASSERT(g_msg_order_count == 8 + SPDK_MSG_BATCH_SIZE);
+	CU_ASSERT(thread0->msg_doorbell == 1ULL << ch->doorbell_bit);
+	poll_thread(0);
+	CU_ASSERT(g_msg_order_count == 8 + SPDK_COUNTOF(ctxs));
+	for (i = 0; i < g_msg_order_count; i++) {
+		CU_ASSERT(g_msg_order[i] == i + 1);
+	}
+
+	/* Another producer gets its own channel, on another doorbell bit */
+	set_thread(2);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)49);
+	poll_thread(0);
+	CU_ASSERT(g_msg_order_count == 49);
+	CU_ASSERT(thread0->msg_channel_next_bit == 2);
+	CU_ASSERT(TAILQ_FIRST(&thread0->msg_channels_in[1]) ==
+		  TAILQ_FIRST(&g_ut_threads[2].thread->msg_channels_out));
+
+	/* Messages sent by a thread to itself don't use a channel */
+	set_thread(0);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)50);
+	CU_ASSERT(TAILQ_EMPTY(&thread0->msg_channels_out));
+	poll_thread(0);
+	CU_ASSERT(g_msg_order_count == 50);
+
+	/* Disabling the channels keeps the existing ones */
+	spdk_thread_enable_msg_channels(false);
+	set_thread(1);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)51);
+	CU_ASSERT(spdk_ring_count(ch->ring) == 1);
+	poll_thread(0);
+	CU_ASSERT(g_msg_order_count == 51);
+
+	free_threads();
+}
+
+static void
+thread_msg_channels_limits(void)
+{
+	struct spdk_thread *thread0, *thread1, *thread2;
+	struct spdk_msg_channel *ch;
+	uint32_t i;
+
+	g_msg_order_count = 0;
+	allocate_threads(3);
+	thread0 = g_ut_threads[0].thread;
+	thread1 = g_ut_threads[1].thread;
+	thread2 = g_ut_threads[2].thread;
+	spdk_thread_enable_msg_channels(true);
+
+	/* A consumer with too many channels already gets the messages on its regular ring */
+	thread0->msg_channel_count = SPDK_MSG_CHANNELS_PER_THREAD;
+	set_thread(1);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)1);
+	ch = TAILQ_FIRST(&thread1->msg_channels_out);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	CU_ASSERT(ch->ring == NULL);
+	CU_ASSERT(thread0->msg_channel_count == SPDK_MSG_CHANNELS_PER_THREAD);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 1);
+
+	/* The failure is remembered until the retry time */
+	thread0->msg_channel_count = 0;
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)2);
+	CU_ASSERT(TAILQ_FIRST(&thread1->msg_channels_out) == ch);
+	CU_ASSERT(TAILQ_NEXT(ch, producer_link) == NULL);
+	CU_ASSERT(thread0->msg_channel_count == 0);
+	CU_ASSERT(spdk_ring_count(thread0->messages) == 2);
+
+	spdk_delay_us(SPDK_MSG_CHANNEL_RETRY_SEC * SPDK_SEC_TO_USEC);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)3);
+	ch = TAILQ_FIRST(&thread1->msg_channels_out);
+	SPDK_CU_ASSERT_FATAL(ch != NULL);
+	CU_ASSERT(ch->ring != NULL);
+	CU_ASSERT(TAILQ_NEXT(ch, producer_link) == NULL);
+	CU_ASSERT(thread0->msg_channel_count == 1);
+
+	set_thread(2);
+	spdk_thread_send_msg(thread0, record_msg_cb, (void *)4);
+	CU_ASSERT(thread0->msg_channel_count == 2);
+	poll_thread(0);
+	CU_ASSERT(g_msg_order_count == 4);
+	CU_ASSERT(TAILQ_FIRST(&thread0->msg_channels_in[0]) ==
+		  TAILQ_FIRST(&thread1->msg_channels_out));
+	CU_ASSERT(TAILQ_FIRST(&thread0->msg_channels_in[1]) ==
+		  TAILQ_FIRST(&thread2->msg_channels_out));
+
+	/* A poll runs at most max_msgs messages from the regular ring and the channels together */
+	g_msg_order_count = 0;
+	set_thread(0);
+	for (i = 0; i < 2; i++) {
+		spdk_thread_send_msg(thread0, record_msg_cb, (void *)(uintptr_t)(i + 1));
+	}
+	set_thread(1);
+	for (i = 0; i < 8; i++) {
+		spdk_thread_send_msg(thread0, record_msg_cb, (void *)(uintptr_t)(i + 101));
+	}
+	set_thread(2);
+	for (i = 0; i < 4; i++) {
+		spdk_thread_send_msg(thread0, record_msg_cb, (void *)(uintptr_t)(i + 201));
+	}
+
+	spdk_thread_poll(thread0, 4, 0);
+	CU_ASSERT(g_msg_order_count == 4);
+	CU_ASSERT(g_msg_order[0] == 1);
+	CU_ASSERT(g_msg_order[1] == 2);
+	CU_ASSERT(g_msg_order[2] == 101);
+	CU_ASSERT(g_msg_order[3] == 102);
+
+	/* The next poll starts with the channels that didn't get a turn */
+	spdk_thread_poll(thread0, 4, 0);
+	CU_ASSERT(g_msg_order_count == 8);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(g_msg_order[4 + i] == 201 + i);
+	}
+
+	spdk_thread_poll(thread0, 4, 0);
+	CU_ASSERT(g_msg_order_count == 12);
+	for (i = 0; i < 4; i++) {
+		CU_ASSERT(g_msg_order[8 + i] == 103 + i);
+	}
+
+	poll_thread(0);
+	CU_ASSERT(g_msg_order_count == 14);
+	CU_ASSERT(thread0->msg_doorbell == 0);
+
+	spdk_thread_enable_msg_channels(false);
+	free_threads();
+	CU_ASSERT(g_msg_channel_count == 0);
+}
+
+static int
+ut_cycles_poll(void *ctx)
+{
+	int *rc = ctx;
+
+	spdk_delay_us(10);
+
+	return *rc;
+}
+
+static void
+ut_cycles_msg(void *ctx)
+{
+	spdk_delay_us(3);
+}
+
+static int
+ut_cycles_intr_unregister(void *ctx)
+{
+	struct spdk_interrupt *intr = ctx;
+
+	spdk_delay_us(5);
+	free(intr);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+ut_get_callback_stats(const struct spdk_thread_callback_stats *stats, void *ctx)
+{
+	struct spdk_thread_callback_stats *out = ctx;
+
+	if (stats->fn == out->fn) {
+		*out = *stats;
+	}
+}
+
+static void
+thread_cycle_accounting(void)
+{
+	struct spdk_thread_callback_stats cb_stats = { .fn = ut_cycles_msg };
+	struct spdk_poller_stats stats;
+	struct spdk_interrupt *intr;
+	struct spdk_thread *thread;
+	struct spdk_poller *poller;
+	int rc = SPDK_POLLER_BUSY;
+	uint32_t i;
+
+	allocate_threads(1);
+	set_thread(0);
+	thread = spdk_get_thread();
+
+	poller = spdk_poller_register(ut_cycles_poll, &rc, 0);
+	SPDK_CU_ASSERT_FATAL(poller != NULL);
+
+	/* Nothing is accounted while the cycle accounting is disabled */
+	CU_ASSERT(!spdk_thread_cycle_accounting_is_enabled());
+	spdk_thread_send_msg(thread, ut_cycles_msg, NULL);
+	poll_thread_times(0, 1);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT(stats.run_count == 1);
+	CU_ASSERT(stats.busy_tsc == 0);
+	CU_ASSERT(stats.idle_tsc == 0);
+	spdk_thread_get_callback_stats(thread, ut_get_callback_stats, &cb_stats);
+	CU_ASSERT(cb_stats.run_count == 0);
+
+	spdk_thread_enable_cycle_accounting(true);
+	CU_ASSERT(spdk_thread_cycle_accounting_is_enabled());
+
+	/* Busy and idle runs of the poller are accounted separately */
+	poll_thread_times(0, 1);
+	rc = SPDK_POLLER_IDLE;
+	poll_thread_times(0, 2);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT(stats.run_count == 4);
+	CU_ASSERT(stats.busy_tsc == 10);
+	CU_ASSERT(stats.idle_tsc == 20);
+
+	/* Messages are aggregated by callback */
+	spdk_thread_send_msg(thread, ut_cycles_msg, NULL);
+	spdk_thread_send_msg(thread, ut_cycles_msg, NULL);
+	poll_thread_times(0, 2);
+	spdk_thread_get_callback_stats(thread, ut_get_callback_stats, &cb_stats);
+	CU_ASSERT(cb_stats.fn == ut_cycles_msg);
+	CU_ASSERT(cb_stats.type == SPDK_THREAD_CALLBACK_MSG);
+	CU_ASSERT(cb_stats.run_count == 2);
+	CU_ASSERT(cb_stats.tsc == 6);
+
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT(stats.run_count == 6);
+	CU_ASSERT(stats.idle_tsc == 40);
+
+	/* An interrupt handler is accounted even if it unregisters its interrupt */
+	intr = calloc(1, sizeof(*intr));
+	SPDK_CU_ASSERT_FATAL(intr != NULL);
+	intr->thread = thread;
+	intr->fn = ut_cycles_intr_unregister;
+	intr->arg = intr;
+	CU_ASSERT(_interrupt_wrapper(intr) == SPDK_POLLER_BUSY);
+	memset(&cb_stats, 0, sizeof(cb_stats));
+	cb_stats.fn = ut_cycles_intr_unregister;
+	spdk_thread_get_callback_stats(thread, ut_get_callback_stats, &cb_stats);
+	CU_ASSERT(cb_stats.type == SPDK_THREAD_CALLBACK_INTERRUPT);
+	CU_ASSERT(cb_stats.run_count == 1);
+	CU_ASSERT(cb_stats.tsc == 5);
+
+	/* Disabling the accounting keeps the cycles accounted so far */
+	spdk_thread_enable_cycle_accounting(false);
+	spdk_thread_send_msg(thread, ut_cycles_msg, NULL);
+	poll_thread_times(0, 1);
+	spdk_poller_get_stats(poller, &stats);
+	CU_ASSERT(stats.run_count == 7);
+	CU_ASSERT(stats.busy_tsc == 10);
+	CU_ASSERT(stats.idle_tsc == 40);
+	memset(&cb_stats, 0, sizeof(cb_stats));
+	cb_stats.fn = ut_cycles_msg;
+	spdk_thread_get_callback_stats(thread, ut_get_callback_stats, &cb_stats);
+	CU_ASSERT(cb_stats.run_count == 2);
+	CU_ASSERT(cb_stats.tsc == 6);
+
+	/* Callbacks which don't fit in the table share the last entry, whatever their type */
+	for (i = 0; i < SPDK_THREAD_CALLBACK_STATS_SIZE - 1; i++) {
+		thread_account_callback(thread, (void *)(uintptr_t)(0x1000 + i * 16),
+					SPDK_THREAD_CALLBACK_INTERRUPT, 1);
+	}
+	cb_stats = thread->callback_stats[SPDK_THREAD_CALLBACK_STATS_SIZE];
+	CU_ASSERT(cb_stats.fn == NULL);
+	CU_ASSERT(cb_stats.type == SPDK_THREAD_CALLBACK_OTHER);
+	CU_ASSERT(cb_stats.run_count == 1);
+
+	spdk_poller_unregister(&poller);
+	free_threads();
+}
+
 static bool g_unregistered;
 
 static void
@@ -2306,6 +2727,10 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, poller_get_state_str);
 	CU_ADD_TEST(suite, poller_get_period_ticks);
 	CU_ADD_TEST(suite, poller_get_stats);
+	CU_ADD_TEST(suite, poller_backoff);
+	CU_ADD_TEST(suite, thread_msg_channels);
+	CU_ADD_TEST(suite, thread_msg_channels_limits);
+	CU_ADD_TEST(suite, thread_cycle_accounting);
 	CU_ADD_TEST(suite, channel_create_cb_failed);
 
 	num_failures = spdk_ut_run_tests(argc, argv, NULL);
@@ -0,0 +1,245 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2026 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_internal/cunit.h"
+
+#include "util/gf.c"
+#include "common/lib/test_env.c"
+
+#define SRC_BUF_COUNT 6
+#define BUF_SIZE 4096
+
+/* Reference bitwise multiplication with the 0x11d polynomial */
+static uint8_t
+ref_gf_mul(uint8_t a, uint8_t b)
+{
+	uint8_t r = 0;
+
+	while (b) {
+		if (b & 1) {
+			r ^= a;
+		}
+		a = (a << 1) ^ ((a & 0x80) ? 0x1d : 0);
+		b >>= 1;
+	}
+
+	return r;
+}
+
+static void
+test_gf_mul_inv(void)
+{
+	uint32_t a, b;
+
+	for (a = 0; a < 256; a++) {
+		for (b = 0; b < 256; b++) {
+			CU_ASSERT(spdk_gf_mul(a, b) == ref_gf_mul(a, b));
+		}
+	}
+
+	CU_ASSERT(spdk_gf_inv(0) == 0);
+	for (a = 1; a < 256; a++) {
+		CU_ASSERT(spdk_gf_mul(a, spdk_gf_inv(a)) == 1);
+	}
+
+	CU_ASSERT(spdk_gf_exp(0) == 1);
+	CU_ASSERT(spdk_gf_exp(1) == 2);
+	CU_ASSERT(spdk_gf_exp(8) == 0x1d);
+	CU_ASSERT(spdk_gf_exp(255) == 1);
+	for (a = 0; a < 255; a++) {
+		CU_ASSERT(spdk_gf_mul(spdk_gf_exp(a), spdk_gf_exp(-(int)a)) == 1);
+		CU_ASSERT(spdk_gf_mul(spdk_gf_exp(a), 2) == spdk_gf_exp(a + 1));
+	}
+}
+
+static void
+ref_gen_pq(uint8_t *p, uint8_t *q, void **sources, uint32_t n, uint32_t len)
+{
+	uint32_t i, j;
+
+	memset(p, 0, len);
+	memset(q, 0, len);
+
+	for (i = 0; i < n; i++) {
+		uint8_t *s = sources[i];
+
+		for (j = 0; j < len; j++) {
+			p[j] ^= s[j];
+			q[j] ^= ref_gf_mul(spdk_gf_exp(i), s[j]);
+		}
+	}
+}
+
+static void
+test_gf_gen_pq(void)
+{
+	void *bufs[SRC_BUF_COUNT];
+	void *bufs2[SRC_BUF_COUNT];
+	uint8_t *p, *q, *ref_p, *ref_q;
+	int ret;
+	size_t i, j;
+
+	for (i = 0; i < SRC_BUF_COUNT; i++) {
+		ret = posix_memalign(&bufs[i], 64, BUF_SIZE);
+		SPDK_CU_ASSERT_FATAL(ret == 0);
+
+		for (j = 0; j < BUF_SIZE; j++) {
+			((uint8_t *)bufs[i])[j] = rand();
+		}
+	}
+
+	ret = posix_memalign((void **)&p, 64, BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ret == 0);
+	ret = posix_memalign((void **)&q, 64, BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ret == 0);
+	ref_p = malloc(BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref_p != NULL);
+	ref_q = malloc(BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref_q != NULL);
+
+	/* aligned buffers */
+	ref_gen_pq(ref_p, ref_q, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	ret = spdk_gf_gen_pq(p, q, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE) == 0);
+
+	/* len not multiple of alignment */
+	memset(p, 0xba, BUF_SIZE);
+	memset(q, 0xba, BUF_SIZE);
+	ret = spdk_gf_gen_pq(p, q, bufs, SRC_BUF_COUNT, BUF_SIZE - 1);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE - 1) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE - 1) == 0);
+
+	/* unaligned buffers */
+	memcpy(bufs2, bufs, sizeof(bufs2));
+	bufs2[1] += 1;
+	bufs2[2] += 2;
+	bufs2[3] += 3;
+
+	ref_gen_pq(ref_p, ref_q, bufs2, SRC_BUF_COUNT, BUF_SIZE - SRC_BUF_COUNT);
+	memset(p, 0xba, BUF_SIZE);
+	memset(q, 0xba, BUF_SIZE);
+	ret = spdk_gf_gen_pq(p, q, bufs2, SRC_BUF_COUNT, BUF_SIZE - SRC_BUF_COUNT);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref_p, p, BUF_SIZE - SRC_BUF_COUNT) == 0);
+	CU_ASSERT(memcmp(ref_q, q, BUF_SIZE - SRC_BUF_COUNT) == 0);
+
+	/* invalid number of sources */
+	CU_ASSERT(spdk_gf_gen_pq(p, q, bufs, 1, BUF_SIZE) == -EINVAL);
+
+	for (i = 0; i < SRC_BUF_COUNT; i++) {
+		free(bufs[i]);
+	}
+	free(p);
+	free(q);
+	free(ref_p);
+	free(ref_q);
+}
+
+static void
+test_gf_vect_dot_prod(void)
+{
+	void *bufs[SRC_BUF_COUNT + 2];
+	void *srcs[SRC_BUF_COUNT];
+	uint8_t coefs[SRC_BUF_COUNT];
+	uint8_t *p, *q, *dest, *ref;
+	uint8_t a, b, denom;
+	uint32_t x, y, i, k;
+	size_t j;
+	int ret;
+
+	for (i = 0; i < SRC_BUF_COUNT + 2; i++) {
+		ret = posix_memalign(&bufs[i], 64, BUF_SIZE);
+		SPDK_CU_ASSERT_FATAL(ret == 0);
+
+		for (j = 0; j < BUF_SIZE; j++) {
+			((uint8_t *)bufs[i])[j] = rand();
+		}
+	}
+	p = bufs[SRC_BUF_COUNT];
+	q = bufs[SRC_BUF_COUNT + 1];
+	dest = malloc(BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(dest != NULL);
+	ref = malloc(BUF_SIZE);
+	SPDK_CU_ASSERT_FATAL(ref != NULL);
+
+	/* plain dot product */
+	memset(ref, 0, BUF_SIZE);
+	for (i = 0; i < SRC_BUF_COUNT; i++) {
+		coefs[i] = 3 * i + 1;
+		for (j = 0; j < BUF_SIZE; j++) {
+			ref[j] ^= ref_gf_mul(coefs[i], ((uint8_t *)bufs[i])[j]);
+		}
+	}
+
+	ret = spdk_gf_vect_dot_prod(dest, bufs, coefs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+	CU_ASSERT(memcmp(ref, dest, BUF_SIZE) == 0);
+
+	/* recover any two data buffers from P, Q and the remaining data buffers */
+	ret = spdk_gf_gen_pq(p, q, bufs, SRC_BUF_COUNT, BUF_SIZE);
+	CU_ASSERT(ret == 0);
+
+	for (x = 0; x < SRC_BUF_COUNT; x++) {
+		for (y = x + 1; y < SRC_BUF_COUNT; y++) {
+			denom = spdk_gf_inv(spdk_gf_exp(y - x) ^ 1);
+			a = spdk_gf_mul(spdk_gf_exp(y - x), denom);
+			b = spdk_gf_mul(spdk_gf_exp(-(int)x), denom);
+
+			k = 0;
+			for (i = 0; i < SRC_BUF_COUNT; i++) {
+				if (i == x || i == y) {
+					continue;
+				}
+				srcs[k] = bufs[i];
+				coefs[k] = a ^ spdk_gf_mul(b, spdk_gf_exp(i));
+				k++;
+			}
+			srcs[k] = p;
+			coefs[k++] = a;
+			srcs[k] = q;
+			coefs[k++] = b;
+
+			memset(dest, 0, BUF_SIZE);
+			ret = spdk_gf_vect_dot_prod(dest, srcs, coefs, k, BUF_SIZE);
+			CU_ASSERT(ret == 0);
+			CU_ASSERT(memcmp(bufs[x], dest, BUF_SIZE) == 0);
+		}
+	}
+
+	/* invalid number of sources */
+	CU_ASSERT(spdk_gf_vect_dot_prod(dest, bufs, coefs, 0, BUF_SIZE) == -EINVAL);
+
+	for (i = 0; i < SRC_BUF_COUNT + 2; i++) {
+		free(bufs[i]);
+	}
+	free(dest);
+	free(ref);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite	suite = NULL;
+	unsigned int	num_failures;
+
+	CU_initialize_registry();
+
+	suite = CU_add_suite("gf", NULL, NULL);
+
+	CU_ADD_TEST(suite, test_gf_mul_inv);
+	CU_ADD_TEST(suite, test_gf_gen_pq);
+	CU_ADD_TEST(suite, test_gf_vect_dot_prod);
+
+	num_failures = spdk_ut_run_tests(argc, argv, NULL);
+
+	CU_cleanup_registry();
+
+	return num_failures;
+}
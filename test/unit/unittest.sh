@@ -18,12 +18,17 @@ cd "$rootdir"
 
 function unittest_bdev() {
 	$valgrind $testdir/lib/bdev/bdev.c/bdev_ut
+	$valgrind $testdir/lib/bdev/compress.c/compress_ut
+	$valgrind $testdir/lib/bdev/dedup.c/dedup_ut
+	$valgrind $testdir/lib/bdev/rcache.c/rcache_ut
+	$valgrind $testdir/lib/bdev/wbcache.c/wbcache_ut
 	$valgrind $testdir/lib/bdev/nvme/bdev_nvme.c/bdev_nvme_ut
 	$valgrind $testdir/lib/bdev/raid/bdev_raid.c/bdev_raid_ut
 	$valgrind $testdir/lib/bdev/raid/bdev_raid_sb.c/bdev_raid_sb_ut
 	$valgrind $testdir/lib/bdev/raid/concat.c/concat_ut
 	$valgrind $testdir/lib/bdev/raid/raid0.c/raid0_ut
 	$valgrind $testdir/lib/bdev/raid/raid1.c/raid1_ut
+	$valgrind $testdir/lib/bdev/raid/raid6.c/raid6_ut
 	$valgrind $testdir/lib/bdev/bdev_zone.c/bdev_zone_ut
 	$valgrind $testdir/lib/bdev/gpt/gpt.c/gpt_ut
 	$valgrind $testdir/lib/bdev/part.c/part_ut
@@ -135,6 +140,7 @@ function unittest_util() {
 	$valgrind $testdir/lib/util/crc64.c/crc64_ut
 	$valgrind $testdir/lib/util/string.c/string_ut
 	$valgrind $testdir/lib/util/dif.c/dif_ut
+	$valgrind $testdir/lib/util/gf.c/gf_ut
 	$valgrind $testdir/lib/util/iov.c/iov_ut
 	$valgrind $testdir/lib/util/math.c/math_ut
 	$valgrind $testdir/lib/util/pipe.c/pipe_ut